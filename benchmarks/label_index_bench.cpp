@@ -0,0 +1,82 @@
+// BSD 3-Clause License
+// Copyright (c) 2021-2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file label_index_bench.cpp
+ * @brief Benchmark for selector resolution in the inverted label index
+ * @details Resolves Prometheus-style selectors against 1M series with
+ *          service, endpoint, instance and region labels
+ *
+ * Target Metrics:
+ * - {service="auth", endpoint=~"/api/.*"} over 1M series: < 1ms
+ * - Two equality matchers over 1M series: < 100us
+ */
+
+#include <benchmark/benchmark.h>
+#include <kcenon/monitoring/utils/label_index.h>
+#include <string>
+#include <vector>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+constexpr int series_count = 1'000'000;
+
+const label_index& shared_index() {
+    static const label_index& index = [] () -> const label_index& {
+        static label_index built;
+        for (int i = 0; i < series_count; ++i) {
+            const int service = i % 50;
+            const int endpoint = (i / 50) % 200;
+            built.add(label_set{
+                {"service", service == 0 ? std::string("auth") : "service-" + std::to_string(service)},
+                {"endpoint", (endpoint % 2 == 0 ? "/api/v1/resource-" : "/internal/job-") + std::to_string(endpoint)},
+                {"instance", "10.0." + std::to_string((i / 10000) % 100) + "." + std::to_string(i % 10)},
+                {"region", "region-" + std::to_string((i / 7) % 5)}});
+        }
+        return built;
+    }();
+    return index;
+}
+
+void run_selector(benchmark::State& state, const char* selector) {
+    const auto& index = shared_index();
+    const auto matchers = parse_label_selector(selector).value();
+    size_t matched = 0;
+
+    for (auto _ : state) {
+        auto ids = index.select(matchers);
+        matched = ids.value().size();
+        benchmark::DoNotOptimize(ids);
+    }
+
+    state.counters["matched"] = static_cast<double>(matched);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Selector resolution over 1M series
+//-----------------------------------------------------------------------------
+
+static void BM_LabelIndex_EqualAndRegex(benchmark::State& state) {
+    run_selector(state, R"({service="auth", endpoint=~"/api/.*"})");
+}
+BENCHMARK(BM_LabelIndex_EqualAndRegex)->Unit(benchmark::kMicrosecond);
+
+static void BM_LabelIndex_TwoEquals(benchmark::State& state) {
+    run_selector(state, R"({service="auth", region="region-0"})");
+}
+BENCHMARK(BM_LabelIndex_TwoEquals)->Unit(benchmark::kMicrosecond);
+
+static void BM_LabelIndex_RegexAlternation(benchmark::State& state) {
+    run_selector(state, R"({service=~"service-1|service-2", endpoint="/internal/job-7"})");
+}
+BENCHMARK(BM_LabelIndex_RegexAlternation)->Unit(benchmark::kMicrosecond);
+
+static void BM_LabelIndex_NegativeMatcher(benchmark::State& state) {
+    run_selector(state, R"({service="auth", region!="region-0", endpoint!~"/internal/.*"})");
+}
+BENCHMARK(BM_LabelIndex_NegativeMatcher)->Unit(benchmark::kMicrosecond);
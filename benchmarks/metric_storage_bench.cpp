@@ -0,0 +1,170 @@
+// BSD 3-Clause License
+// Copyright (c) 2021-2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file metric_storage_bench.cpp
+ * @brief Benchmark for metric_storage ingest throughput
+ * @details Producer threads store batches into their own series and flush
+ *          them into the sharded time series, optionally while background
+ *          threads keep summarizing the first producer's series
+ *
+ * Target Metrics:
+ * - Aggregate ingest (store + flush) across threads: > 10M points/sec
+ *   on many cores, scaling with the number of producer threads
+ * - Concurrent queries never make a flush wait, so ingest with readers
+ *   scales with the producer threads as well
+ */
+
+#include <benchmark/benchmark.h>
+#include <kcenon/monitoring/utils/metric_storage.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+constexpr int series_per_thread = 64;
+constexpr int batch_points = 4096;
+
+std::unique_ptr<metric_storage> shared_storage;
+std::vector<std::thread> query_threads;
+std::atomic<bool> querying{false};
+std::atomic<size_t> queries{0};
+
+std::string series_name(int thread, int series) {
+    return "ingest_" + std::to_string(thread) + "_" + std::to_string(series);
+}
+
+void setup_storage() {
+    metric_storage_config config;
+    config.ring_buffer_capacity = 1 << 14;
+    config.shard_count = 64;
+    config.max_metrics = 100000;
+    config.enable_background_processing = false;
+    shared_storage = std::make_unique<metric_storage>(config);
+}
+
+/**
+ * @brief Batch spreading batch_points across one thread's series
+ */
+metric_batch make_batch(int thread) {
+    metric_batch batch;
+    batch.metrics.reserve(batch_points);
+    for (int i = 0; i < batch_points; ++i) {
+        const auto name = series_name(thread, i % series_per_thread);
+        shared_storage->register_metric_name(name);
+        batch.add_metric(compact_metric_value(create_metric_metadata(name, metric_type::gauge),
+                                              static_cast<double>(i % 100)));
+    }
+    return batch;
+}
+
+/**
+ * @brief Store and flush one batch, moving its timestamps forward
+ */
+void ingest(metric_batch& batch) {
+    for (auto& metric : batch.metrics) {
+        metric.timestamp_us += 1000;
+    }
+    benchmark::DoNotOptimize(shared_storage->store_metrics_batch(batch));
+    shared_storage->flush();
+}
+
+/**
+ * @brief Start threads summarizing the ingested series until stop_queries()
+ */
+void start_queries(int threads) {
+    querying = true;
+    queries = 0;
+    for (int t = 0; t < threads; ++t) {
+        query_threads.emplace_back([t] {
+            for (int i = 0; querying.load(std::memory_order_relaxed); ++i) {
+                const auto now = std::chrono::system_clock::now();
+                auto summary = shared_storage->summarize_metric(
+                    series_name(0, (i + t) % series_per_thread),
+                    now - std::chrono::minutes(5), now + std::chrono::hours(1));
+                benchmark::DoNotOptimize(summary);
+                queries.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+}
+
+/**
+ * @return Number of queries run
+ */
+size_t stop_queries() {
+    querying = false;
+    for (auto& thread : query_threads) {
+        thread.join();
+    }
+    query_threads.clear();
+    return queries.load();
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Ingest throughput
+//-----------------------------------------------------------------------------
+
+static void BM_MetricStorage_Ingest(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        setup_storage();
+    }
+    metric_batch batch;
+
+    for (auto _ : state) {
+        if (batch.metrics.empty()) {
+            state.PauseTiming();
+            batch = make_batch(state.thread_index());
+            state.ResumeTiming();
+        }
+        ingest(batch);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * batch_points);
+    if (state.thread_index() == 0) {
+        state.counters["dropped"] = static_cast<double>(
+            shared_storage->get_stats().total_metrics_dropped.load());
+        shared_storage.reset();
+    }
+}
+BENCHMARK(BM_MetricStorage_Ingest)
+    ->ThreadRange(1, 16)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_MetricStorage_IngestWithReaders(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        setup_storage();
+        start_queries(static_cast<int>(state.range(0)));
+    }
+    metric_batch batch;
+
+    for (auto _ : state) {
+        if (batch.metrics.empty()) {
+            state.PauseTiming();
+            batch = make_batch(state.thread_index());
+            state.ResumeTiming();
+        }
+        ingest(batch);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * batch_points);
+    if (state.thread_index() == 0) {
+        state.counters["queries"] = static_cast<double>(stop_queries());
+        shared_storage.reset();
+    }
+}
+BENCHMARK(BM_MetricStorage_IngestWithReaders)
+    ->Arg(2)
+    ->ThreadRange(1, 16)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,412 @@
+// BSD 3-Clause License
+// Copyright (c) 2021-2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+#pragma once
+
+/**
+ * @file collection_arena.h
+ * @brief Per-collection-cycle arena for transient snapshot storage
+ *
+ * A collection cycle builds a snapshot, hands it to exporters and storage,
+ * and then throws it away. With the heap-backed metrics_snapshot every
+ * metric name, tag key and tag value of that cycle is a separate malloc
+ * that is freed again a few microseconds later.
+ *
+ * collection_arena replaces those allocations with bump-pointer allocation
+ * from a retained buffer that is released wholesale when the cycle ends.
+ * The buffer grows to the observed high-water mark, so once the metric set
+ * is stable a cycle performs no upstream allocations at all.
+ *
+ * @code
+ * collection_arena arena;
+ * while (running) {
+ *     collection_cycle cycle(arena, "web-01");
+ *     collector.collect_into(cycle.snapshot());
+ *     exporter.export_arena_snapshot(cycle.snapshot());
+ * }   // cycle end: snapshot destroyed, arena reset
+ * @endcode
+ *
+ * performance_monitor::collect_and_export() runs this cycle on an arena
+ * owned by the monitor.
+ *
+ * @warning Anything allocated from the arena is invalidated by reset().
+ *          Use materialize() (monitoring_core.h) to keep a snapshot beyond
+ *          its cycle. An arena is not thread-safe; use one per collection
+ *          thread.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @struct collection_arena_config
+ * @brief Configuration for a collection cycle arena
+ */
+struct collection_arena_config {
+    std::size_t initial_capacity = 64 * 1024;            ///< Retained buffer size at start
+    std::size_t max_retained_capacity = 16 * 1024 * 1024; ///< Upper bound for adaptive growth
+    bool adaptive_growth = true;                          ///< Grow retained buffer to the cycle high-water mark
+
+    /**
+     * @brief Validate configuration
+     * @return true if configuration is valid
+     */
+    bool validate() const {
+        if (initial_capacity == 0) {
+            return false;
+        }
+        if (max_retained_capacity < initial_capacity) {
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @struct collection_arena_stats
+ * @brief Usage statistics of a collection cycle arena
+ */
+struct collection_arena_stats {
+    std::size_t cycles = 0;                 ///< Number of completed resets
+    std::size_t retained_capacity = 0;      ///< Current retained buffer size
+    std::size_t current_cycle_bytes = 0;    ///< Bytes requested in the running cycle
+    std::size_t last_cycle_bytes = 0;       ///< Bytes requested in the previous cycle
+    std::size_t peak_cycle_bytes = 0;       ///< Largest per-cycle request total so far
+    std::size_t upstream_allocations = 0;   ///< Total allocations that spilled past the retained buffer
+};
+
+/**
+ * @class collection_arena
+ * @brief Monotonic memory resource that is reset once per collection cycle
+ *
+ * Deallocation is a no-op; memory is reclaimed only by reset(). The arena is
+ * itself a std::pmr::memory_resource so it can be handed to any pmr
+ * container.
+ */
+class collection_arena : public std::pmr::memory_resource {
+public:
+    /**
+     * @brief Constructor with configuration
+     * @param config Arena configuration options
+     * @throws std::invalid_argument if configuration validation fails
+     */
+    explicit collection_arena(const collection_arena_config& config = {})
+        : config_(config)
+        , upstream_(this) {
+        if (!config_.validate()) {
+            throw std::invalid_argument("Invalid collection arena configuration");
+        }
+        allocate_buffer(config_.initial_capacity);
+    }
+
+    collection_arena(const collection_arena&) = delete;
+    collection_arena& operator=(const collection_arena&) = delete;
+    collection_arena(collection_arena&&) = delete;
+    collection_arena& operator=(collection_arena&&) = delete;
+
+    ~collection_arena() override {
+        monotonic_.reset();
+    }
+
+    /**
+     * @brief Memory resource to build cycle-scoped containers with
+     */
+    std::pmr::memory_resource* resource() noexcept { return this; }
+
+    /**
+     * @brief Release everything allocated in the current cycle
+     *
+     * When the cycle spilled past the retained buffer and adaptive growth is
+     * enabled, the retained buffer is enlarged to cover the high-water mark
+     * so the next cycle of the same shape stays within it.
+     */
+    void reset() {
+        const std::size_t used = stats_.current_cycle_bytes;
+        const bool spilled = cycle_upstream_allocations_ > 0;
+
+        stats_.last_cycle_bytes = used;
+        stats_.peak_cycle_bytes = std::max(stats_.peak_cycle_bytes, used);
+        stats_.current_cycle_bytes = 0;
+        ++stats_.cycles;
+        cycle_upstream_allocations_ = 0;
+
+        if (spilled && config_.adaptive_growth &&
+            capacity_ < config_.max_retained_capacity) {
+            std::size_t wanted = capacity_;
+            // Leave headroom for alignment padding and slow metric growth
+            const std::size_t target = used + used / 4;
+            while (wanted < target && wanted < config_.max_retained_capacity) {
+                wanted *= 2;
+            }
+            wanted = std::min(wanted, config_.max_retained_capacity);
+            monotonic_.reset();
+            allocate_buffer(wanted);
+            return;
+        }
+
+        monotonic_->release();
+    }
+
+    /**
+     * @brief Get arena statistics
+     */
+    collection_arena_stats get_stats() const {
+        auto stats = stats_;
+        stats.retained_capacity = capacity_;
+        return stats;
+    }
+
+    /**
+     * @brief Bytes requested since the last reset
+     */
+    std::size_t bytes_in_use() const noexcept { return stats_.current_cycle_bytes; }
+
+    /**
+     * @brief Size of the retained buffer
+     */
+    std::size_t retained_capacity() const noexcept { return capacity_; }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        stats_.current_cycle_bytes += bytes;
+        return monotonic_->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* /*p*/, std::size_t /*bytes*/, std::size_t /*alignment*/) override {
+        // Memory is reclaimed wholesale in reset()
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    /**
+     * @brief Upstream that forwards to the heap and counts spills
+     */
+    class upstream_resource : public std::pmr::memory_resource {
+    public:
+        explicit upstream_resource(collection_arena* owner) : owner_(owner) {}
+
+    protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++owner_->cycle_upstream_allocations_;
+            ++owner_->stats_.upstream_allocations;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        collection_arena* owner_;
+    };
+
+    void allocate_buffer(std::size_t capacity) {
+        buffer_ = std::make_unique<std::byte[]>(capacity);
+        capacity_ = capacity;
+        monotonic_.emplace(buffer_.get(), capacity_, &upstream_);
+    }
+
+    collection_arena_config config_;
+    upstream_resource upstream_;
+    std::unique_ptr<std::byte[]> buffer_;
+    std::size_t capacity_ = 0;
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic_;
+    collection_arena_stats stats_;
+    std::size_t cycle_upstream_allocations_ = 0;
+};
+
+/**
+ * @brief Flat tag list used by arena snapshots
+ *
+ * Tags per metric are few, so a flat vector is both smaller and faster to
+ * build than a node-based map and iterates with the same structured
+ * bindings as the heap snapshot's tag map.
+ */
+using arena_tag_list = std::pmr::vector<std::pair<std::pmr::string, std::pmr::string>>;
+
+/**
+ * @struct arena_metric_value
+ * @brief Arena-backed counterpart of metric_value
+ */
+struct arena_metric_value {
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::pmr::string name;
+    double value;
+    std::chrono::system_clock::time_point timestamp;
+    arena_tag_list tags;
+
+    arena_metric_value(std::string_view n, double v, allocator_type alloc = {})
+        : name(n, alloc)
+        , value(v)
+        , timestamp(std::chrono::system_clock::now())
+        , tags(alloc) {}
+
+    arena_metric_value(const arena_metric_value& other, allocator_type alloc = {})
+        : name(other.name, alloc)
+        , value(other.value)
+        , timestamp(other.timestamp)
+        , tags(other.tags, alloc) {}
+
+    arena_metric_value(arena_metric_value&& other) noexcept = default;
+
+    arena_metric_value(arena_metric_value&& other, allocator_type alloc)
+        : name(std::move(other.name), alloc)
+        , value(other.value)
+        , timestamp(other.timestamp)
+        , tags(std::move(other.tags), alloc) {}
+
+    arena_metric_value& operator=(const arena_metric_value&) = default;
+    arena_metric_value& operator=(arena_metric_value&&) = default;
+
+    allocator_type get_allocator() const { return name.get_allocator(); }
+
+    /**
+     * @brief Append a tag
+     */
+    void add_tag(std::string_view key, std::string_view tag_value) {
+        tags.emplace_back(std::piecewise_construct,
+                          std::forward_as_tuple(key),
+                          std::forward_as_tuple(tag_value));
+    }
+
+    /**
+     * @brief Look up a tag value
+     * @return View into arena storage, valid until the arena is reset
+     */
+    std::optional<std::string_view> get_tag(std::string_view key) const {
+        for (const auto& [k, v] : tags) {
+            if (k == key) {
+                return std::string_view(v);
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+/**
+ * @struct arena_metrics_snapshot
+ * @brief Arena-backed counterpart of metrics_snapshot
+ *
+ * All strings and containers allocate from the allocator passed at
+ * construction, normally collection_arena::resource().
+ */
+struct arena_metrics_snapshot {
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::pmr::vector<arena_metric_value> metrics;
+    std::chrono::system_clock::time_point capture_time;
+    std::pmr::string source_id;
+
+    explicit arena_metrics_snapshot(allocator_type alloc = {})
+        : metrics(alloc)
+        , capture_time(std::chrono::system_clock::now())
+        , source_id(alloc) {}
+
+    arena_metrics_snapshot(const arena_metrics_snapshot& other, allocator_type alloc = {})
+        : metrics(other.metrics, alloc)
+        , capture_time(other.capture_time)
+        , source_id(other.source_id, alloc) {}
+
+    arena_metrics_snapshot(arena_metrics_snapshot&& other) noexcept = default;
+
+    arena_metrics_snapshot& operator=(const arena_metrics_snapshot&) = default;
+    arena_metrics_snapshot& operator=(arena_metrics_snapshot&&) = default;
+
+    allocator_type get_allocator() const { return metrics.get_allocator(); }
+
+    /**
+     * @brief Reserve room for metrics
+     *
+     * Worth calling when the metric count is known: the arena never reuses
+     * memory released by vector growth within a cycle.
+     */
+    void reserve(std::size_t count) { metrics.reserve(count); }
+
+    /**
+     * @brief Add a metric to the snapshot
+     * @return Reference to the new metric, e.g. for add_tag()
+     */
+    arena_metric_value& add_metric(std::string_view name, double value) {
+        return metrics.emplace_back(name, value);
+    }
+
+    /**
+     * @brief Add a metric with tags from any key/value range
+     * @param tags Range of pairs convertible to std::string_view
+     */
+    template<typename TagRange>
+    arena_metric_value& add_metric(std::string_view name, double value, const TagRange& tags) {
+        auto& metric = metrics.emplace_back(name, value);
+        for (const auto& [key, tag_value] : tags) {
+            metric.add_tag(key, tag_value);
+        }
+        return metric;
+    }
+
+    /**
+     * @brief Get a specific metric value
+     */
+    std::optional<double> get_metric(std::string_view name) const {
+        for (const auto& m : metrics) {
+            if (m.name == name) {
+                return m.value;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+/**
+ * @class collection_cycle
+ * @brief RAII scope of one collection cycle
+ *
+ * Owns the cycle's arena snapshot and resets the arena on destruction, after
+ * the snapshot itself has been destroyed.
+ */
+class collection_cycle {
+public:
+    explicit collection_cycle(collection_arena& arena, std::string_view source_id = {})
+        : arena_(arena) {
+        snapshot_.emplace(arena_.resource());
+        snapshot_->source_id = source_id;
+    }
+
+    collection_cycle(const collection_cycle&) = delete;
+    collection_cycle& operator=(const collection_cycle&) = delete;
+
+    ~collection_cycle() {
+        snapshot_.reset();
+        arena_.reset();
+    }
+
+    arena_metrics_snapshot& snapshot() noexcept { return *snapshot_; }
+    const arena_metrics_snapshot& snapshot() const noexcept { return *snapshot_; }
+
+    collection_arena& arena() noexcept { return arena_; }
+
+private:
+    collection_arena& arena_;
+    std::optional<arena_metrics_snapshot> snapshot_;
+};
+
+} } // namespace kcenon::monitoring
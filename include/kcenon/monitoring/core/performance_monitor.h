@@ -27,16 +27,21 @@
 #include <numeric>
 #include <cmath>
 #include <shared_mutex>
+#include <span>
 
 #include "../core/result_types.h"
 #include "../core/error_codes.h"
 #include "../interfaces/monitoring_core.h"
+#include "../core/collection_arena.h"
+#include "../utils/label_index.h"
 
 // Use common_system interfaces (Phase 2.3.4)
 #include <kcenon/common/interfaces/monitoring_interface.h>
 
 namespace kcenon { namespace monitoring {
 
+class metric_exporter_interface;
+
 /**
  * @brief Type alias for metric tags/labels
  *
@@ -177,6 +182,32 @@ public:
      * @brief Get all performance metrics
      */
     std::vector<performance_metrics> get_all_metrics() const;
+
+    /**
+     * @brief Call @p fn(name, mean_duration) for every profiled operation
+     *
+     * Yields the same mean as get_all_metrics() without copying or sorting
+     * the samples. @p fn runs with the profile table locked for reading.
+     */
+    template<typename Fn>
+    void for_each_mean_duration(Fn&& fn) const {
+        std::shared_lock<std::shared_mutex> lock(profiles_mutex_);
+        for (const auto& [name, profile] : profiles_) {
+            std::chrono::nanoseconds total{0};
+            std::size_t count = 0;
+            {
+                std::lock_guard<std::mutex> sample_lock(profile->mutex);
+                for (const auto& sample : profile->samples) {
+                    total += sample;
+                }
+                count = profile->samples.size();
+            }
+            const auto mean = count == 0
+                ? std::chrono::nanoseconds::zero()
+                : total / static_cast<std::chrono::nanoseconds::rep>(count);
+            fn(name, mean);
+        }
+    }
     
     /**
      * @brief Clear samples for an operation
@@ -376,7 +407,11 @@ private:
         std::size_t max_histogram_samples{1000};
     };
     std::unordered_map<std::string, std::unique_ptr<metric_data>> tagged_metrics_;
-    mutable std::shared_mutex metrics_mutex_;  // Protects tagged_metrics_
+    label_index tagged_index_;                          // Name and tags of each tagged metric
+    std::vector<std::vector<std::string>> tagged_keys_; // tagged_metrics_ keys by series id
+    mutable std::shared_mutex metrics_mutex_;  // Protects tagged_metrics_ and tagged_keys_
+    collection_arena cycle_arena_;             // Snapshot storage of collect_and_export()
+    mutable std::mutex cycle_mutex_;           // Serializes cycles on cycle_arena_
     
 public:
     explicit performance_monitor(const std::string& name = "performance_monitor")
@@ -419,6 +454,43 @@ public:
     }
 
     common::Result<metrics_snapshot> collect() override;
+
+    /**
+     * @brief Collect metrics directly into a cycle arena snapshot
+     *
+     * Produces the same metrics as collect() without building an
+     * intermediate heap snapshot.
+     */
+    common::VoidResult collect_into(arena_metrics_snapshot& snapshot) override;
+
+    /**
+     * @brief Run one collect/export cycle on the monitor's cycle arena
+     *
+     * Collects into an arena snapshot, passes it to each exporter's
+     * export_arena_snapshot() and resets the arena when the cycle ends, so
+     * once the metric set is stable a cycle allocates no snapshot storage.
+     * Every exporter runs even if an earlier one fails; the first error is
+     * returned.
+     *
+     * @thread_safety Thread-safe. Cycles are serialized on one arena.
+     */
+    common::VoidResult collect_and_export(std::span<metric_exporter_interface* const> exporters);
+
+    /**
+     * @brief Run one collect/export cycle for a single exporter
+     */
+    common::VoidResult collect_and_export(metric_exporter_interface& exporter) {
+        metric_exporter_interface* const exporters[] = {&exporter};
+        return collect_and_export(exporters);
+    }
+
+    /**
+     * @brief Usage statistics of the arena behind collect_and_export()
+     */
+    collection_arena_stats get_cycle_arena_stats() const {
+        std::lock_guard<std::mutex> lock(cycle_mutex_);
+        return cycle_arena_.get_stats();
+    }
     
     /**
      * @brief Create a scoped timer for an operation
@@ -584,6 +656,26 @@ public:
      */
     std::vector<tagged_metric> get_all_tagged_metrics() const;
 
+    /**
+     * @brief Get the tagged metrics matching a label selector
+     *
+     * The metric name is matched as the "__name__" label. Lookups go through
+     * an inverted label index instead of scanning every metric.
+     *
+     * @param matchers Conditions that every returned metric satisfies
+     * @return Matching metrics, or an error for an invalid regex
+     *
+     * @thread_safety Thread-safe, uses shared_mutex for synchronization
+     *
+     * @example
+     * @code
+     * auto selector = parse_label_selector(R"(requests{service="auth", endpoint=~"/api/.*"})");
+     * auto metrics = monitor.find_tagged_metrics(selector.value());
+     * @endcode
+     */
+    common::Result<std::vector<tagged_metric>> find_tagged_metrics(
+        const std::vector<label_matcher>& matchers) const;
+
     /**
      * @brief Clear all recorded tagged metrics
      *
@@ -597,6 +689,20 @@ private:
      */
     static std::string make_metric_key(const std::string& name, const tag_map& tags);
 
+    /**
+     * @brief Build the public view of a stored metric
+     */
+    static tagged_metric to_tagged_metric(const std::string& key, const metric_data& data);
+
+    /**
+     * @brief Append system, profiler and tagged metrics to @p snapshot
+     *
+     * Shared body of collect() and collect_into(); tagged metrics are read
+     * in place under the metrics lock rather than copied out first.
+     */
+    template<typename Snapshot>
+    void append_collected_metrics(Snapshot& snapshot);
+
     /**
      * @brief Internal method to record a metric with type and tags
      */
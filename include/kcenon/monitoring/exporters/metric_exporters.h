@@ -23,11 +23,15 @@
 #include "../interfaces/monitoring_core.h"
 #include "../interfaces/monitorable_interface.h"
 #include "opentelemetry_adapter.h"
+#include "otlp_metrics_encoder.h"
+#include "prometheus_text_format.h"
 #include "udp_transport.h"
 #include "http_transport.h"
 #include "grpc_transport.h"
 #include <vector>
 #include <string>
+#include <string_view>
+#include <span>
 #include <memory>
 #include <chrono>
 #include <optional>
@@ -36,10 +40,11 @@
 #include <algorithm>
 #include <unordered_map>
 #include <sstream>
-#include <regex>
 #include <mutex>
 #include <cctype>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 namespace kcenon { namespace monitoring {
 
@@ -86,6 +91,7 @@ struct metric_export_config {
     std::unordered_map<std::string, std::string> labels;    ///< Default labels/tags
     std::string job_name = "monitoring_system";             ///< Prometheus job name
     std::string instance_id;                                ///< Instance identifier
+    std::size_t max_packet_size = 1432;                     ///< Max UDP payload bytes (1432 for 1500 MTU, 8932 for jumbo frames)
     
     /**
      * @brief Validate export configuration
@@ -111,6 +117,11 @@ struct metric_export_config {
                              "Queue size must be at least batch size", "monitoring_system").to_common_error());
         }
 
+        if (max_packet_size == 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                             "Packet size must be greater than 0", "monitoring_system").to_common_error());
+        }
+
         return common::ok();
     }
 };
@@ -175,18 +186,405 @@ struct prometheus_metric_data {
         ss << "\n";
         return ss.str();
     }
-    
-private:
-    std::string escape_label_value(const std::string& label_value) const {
-        std::string escaped = label_value;
-        // Escape backslashes, quotes, and newlines
-        escaped = std::regex_replace(escaped, std::regex("\\\\"), "\\\\");
-        escaped = std::regex_replace(escaped, std::regex("\""), "\\\"");
-        escaped = std::regex_replace(escaped, std::regex("\n"), "\\n");
+
+    /**
+     * @brief Prometheus type keyword for a metric type
+     */
+    static const char* type_name(metric_type type) {
+        switch (type) {
+            case metric_type::counter: return "counter";
+            case metric_type::gauge: return "gauge";
+            case metric_type::histogram: return "histogram";
+            case metric_type::summary: return "summary";
+            case metric_type::timer: return "gauge"; // Timer as gauge in Prometheus
+        }
+        return "gauge";
+    }
+
+    /**
+     * @brief Escape a label value for the text exposition format
+     */
+    static std::string escape_label_value(const std::string& label_value) {
+        std::string escaped;
+        escaped.reserve(label_value.size());
+        prometheus_append_escaped_label_value(escaped, label_value);
         return escaped;
     }
 };
 
+namespace detail {
+
+/**
+ * @brief Case-insensitive substring test without a lowered copy
+ * @param needle Lowercase text to look for
+ */
+inline bool contains_lowercase(std::string_view haystack, std::string_view needle) noexcept {
+    if (needle.size() > haystack.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        std::size_t j = 0;
+        while (j < needle.size() &&
+               std::tolower(static_cast<unsigned char>(haystack[i + j])) == needle[j]) {
+            ++j;
+        }
+        if (j == needle.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace detail
+
+/**
+ * @class prometheus_series_registry
+ * @brief Series-keyed store of pre-rendered Prometheus exposition text
+ *
+ * Each series is keyed by its rendered `name{labels}` prefix (labels sorted
+ * by name), which is kept as the cached prefix. Updating a known series only
+ * rewrites its value text, and only when the value or timestamp changed.
+ * Series are grouped into families so HELP/TYPE lines are written once per
+ * metric name. Rendering concatenates the cached fragments.
+ *
+ * Every series belongs to the source that last upserted it, and each source
+ * has its own generation, so sweeping one source (e.g. one snapshot
+ * producer) never drops the series of another.
+ *
+ * Not thread-safe; prometheus_exporter guards it with its metrics mutex.
+ */
+class prometheus_series_registry {
+public:
+    /**
+     * @brief Borrowed label for the view-based upsert()
+     */
+    struct label_view {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /// Source of series upserted without naming one
+    static constexpr std::uint32_t default_source = 0;
+
+    /**
+     * @brief Id of the source called @p name, assigned on first use
+     */
+    std::uint32_t source(std::string_view name) {
+        auto it = source_index_.find(name);
+        if (it != source_index_.end()) {
+            return it->second;
+        }
+        source_generations_.push_back(0);
+        const auto id = static_cast<std::uint32_t>(source_generations_.size() - 1);
+        source_index_.emplace(std::string(name), id);
+        return id;
+    }
+
+    /**
+     * @brief Start a generation of @p source; sweep(@p source) drops its
+     *        series not upserted since
+     */
+    void begin_generation(std::uint32_t source = default_source) {
+        source_generations_.at(source) = ++generation_;
+    }
+
+    /**
+     * @brief Insert or update the series described by @p metric
+     */
+    void upsert(const prometheus_metric_data& metric, std::uint32_t source = default_source) {
+        label_views_.clear();
+        for (const auto& [name, value] : metric.labels) {
+            label_views_.push_back({name, value});
+        }
+        upsert(metric.name, metric.type, metric.help_text, metric.value, metric.timestamp,
+               label_views_, source);
+    }
+
+    /**
+     * @brief Insert or update a series described by borrowed views
+     * @param name Sanitized metric name
+     * @param labels Sanitized labels, reordered in place; when a name
+     *        repeats, the last occurrence wins
+     * @param source Source the series now belongs to
+     *
+     * Updating an existing series does not allocate.
+     */
+    void upsert(std::string_view name, metric_type type, std::string_view help, double value,
+                std::chrono::system_clock::time_point timestamp, std::vector<label_view>& labels,
+                std::uint32_t source = default_source) {
+        render_prefix(name, labels);
+        const auto generation = source_generations_.at(source);
+
+        auto it = index_.find(std::string_view(key_scratch_));
+        if (it == index_.end()) {
+            auto family_idx = find_or_add_family(name, type, help);
+            auto& family = families_[family_idx];
+            it = index_.emplace(key_scratch_,
+                                series_ref{family_idx, family.series.size()}).first;
+            if (family.series.empty()) {
+                total_bytes_ += family.header.size();
+            }
+            family.series.push_back(series_entry{&it->first, {}, 0.0, 0, false, source, generation});
+            total_bytes_ += it->first.size();
+            set_value(family.series.back(), value, timestamp, true);
+            return;
+        }
+
+        auto& family = families_[it->second.family];
+        update_header(family, type, help);
+        auto& entry = family.series[it->second.slot];
+        entry.source = source;
+        entry.generation = generation;
+        set_value(entry, value, timestamp, false);
+    }
+
+    /**
+     * @brief Remove series of @p source not upserted in its current generation
+     * @return Number of series removed
+     */
+    std::size_t sweep(std::uint32_t source = default_source) {
+        const auto generation = source_generations_.at(source);
+        std::size_t removed = 0;
+        for (std::size_t f = 0; f < families_.size();) {
+            auto& family = families_[f];
+            for (std::size_t i = 0; i < family.series.size();) {
+                const auto& entry = family.series[i];
+                if (entry.source != source || entry.generation == generation) {
+                    ++i;
+                    continue;
+                }
+                remove_series(f, i);
+                ++removed;
+            }
+
+            if (family.series.empty()) {
+                remove_family(f);
+            } else {
+                ++f;
+            }
+        }
+        return removed;
+    }
+
+    /**
+     * @brief Replace @p out with the exposition text, reusing its capacity
+     * @return Number of bytes written
+     */
+    std::size_t render(std::string& out) const {
+        out.clear();
+        out.reserve(total_bytes_);
+        for (const auto& family : families_) {
+            out.append(family.header);
+            for (const auto& entry : family.series) {
+                out.append(*entry.prefix);
+                out.append(entry.value_text);
+            }
+        }
+        return out.size();
+    }
+
+    std::size_t series_count() const {
+        return index_.size();
+    }
+
+    std::size_t family_count() const {
+        return families_.size();
+    }
+
+    /**
+     * @brief Exact size of the rendered exposition text
+     */
+    std::size_t byte_size() const {
+        return total_bytes_;
+    }
+
+    void clear() {
+        index_.clear();
+        families_.clear();
+        family_index_.clear();
+        total_bytes_ = 0;
+    }
+
+private:
+    struct series_entry {
+        const std::string* prefix;  ///< Key of the owning index_ node (stable)
+        std::string value_text;     ///< " <value>[ <timestamp_ms>]\n"
+        double value;
+        std::int64_t timestamp_ms;
+        bool has_timestamp;
+        std::uint32_t source;       ///< Source that last upserted the series
+        std::uint64_t generation;   ///< That source's generation at the time
+    };
+
+    struct family_entry {
+        std::string name;
+        std::string help;
+        metric_type type;
+        std::string header;  ///< Rendered HELP/TYPE lines
+        std::vector<series_entry> series;
+    };
+
+    struct series_ref {
+        std::size_t family;
+        std::size_t slot;
+    };
+
+    struct name_hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const noexcept {
+            return std::hash<std::string_view>()(name);
+        }
+    };
+
+    void render_prefix(std::string_view name, std::vector<label_view>& labels) {
+        key_scratch_.assign(name);
+        if (labels.empty()) {
+            return;
+        }
+
+        // Stable, so the last of several equal names is the one kept
+        std::stable_sort(labels.begin(), labels.end(),
+                         [](const label_view& a, const label_view& b) { return a.name < b.name; });
+
+        key_scratch_ += '{';
+        bool first = true;
+        for (std::size_t i = 0; i < labels.size(); ++i) {
+            if (i + 1 < labels.size() && labels[i + 1].name == labels[i].name) {
+                continue;
+            }
+            if (!first) key_scratch_ += ',';
+            key_scratch_ += labels[i].name;
+            key_scratch_ += "=\"";
+            prometheus_append_escaped_label_value(key_scratch_, labels[i].value);
+            key_scratch_ += '"';
+            first = false;
+        }
+        key_scratch_ += '}';
+    }
+
+    std::size_t find_or_add_family(std::string_view name, metric_type type, std::string_view help) {
+        auto it = family_index_.find(name);
+        if (it != family_index_.end()) {
+            auto& existing = families_[it->second];
+            if (!existing.series.empty()) {
+                update_header(existing, type, help);
+            } else {
+                existing.help = help;
+                existing.type = type;
+                render_header(existing);
+            }
+            return it->second;
+        }
+
+        family_entry created;
+        created.name = name;
+        created.help = help;
+        created.type = type;
+        render_header(created);
+        families_.push_back(std::move(created));
+        family_index_.emplace(std::string(name), families_.size() - 1);
+        return families_.size() - 1;
+    }
+
+    void update_header(family_entry& target, metric_type type, std::string_view help) {
+        if (target.type == type && target.help == help) {
+            return;
+        }
+        target.help = help;
+        target.type = type;
+        total_bytes_ -= target.header.size();
+        render_header(target);
+        total_bytes_ += target.header.size();
+    }
+
+    static void render_header(family_entry& target) {
+        target.header.clear();
+        if (!target.help.empty()) {
+            target.header += "# HELP ";
+            target.header += target.name;
+            target.header += ' ';
+            target.header += target.help;
+            target.header += '\n';
+        }
+        target.header += "# TYPE ";
+        target.header += target.name;
+        target.header += ' ';
+        target.header += prometheus_metric_data::type_name(target.type);
+        target.header += '\n';
+    }
+
+    void set_value(series_entry& entry, double value,
+                   std::chrono::system_clock::time_point timestamp, bool force) {
+        const bool has_timestamp = timestamp != std::chrono::system_clock::time_point{};
+        const std::int64_t timestamp_ms = has_timestamp
+            ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                  timestamp.time_since_epoch()).count()
+            : 0;
+
+        if (!force && entry.has_timestamp == has_timestamp &&
+            entry.timestamp_ms == timestamp_ms &&
+            std::memcmp(&entry.value, &value, sizeof(double)) == 0) {
+            return;
+        }
+
+        entry.value = value;
+        entry.timestamp_ms = timestamp_ms;
+        entry.has_timestamp = has_timestamp;
+
+        // Same formatting as std::ostream's default (%g) used by to_prometheus_text()
+        char buffer[64];
+        int length = has_timestamp
+            ? std::snprintf(buffer, sizeof(buffer), " %g %lld\n", value,
+                            static_cast<long long>(timestamp_ms))
+            : std::snprintf(buffer, sizeof(buffer), " %g\n", value);
+
+        total_bytes_ -= entry.value_text.size();
+        entry.value_text.assign(buffer, static_cast<std::size_t>(length));
+        total_bytes_ += entry.value_text.size();
+    }
+
+    void remove_series(std::size_t family_idx, std::size_t slot) {
+        auto& family = families_[family_idx];
+        auto& entry = family.series[slot];
+        total_bytes_ -= entry.prefix->size() + entry.value_text.size();
+        index_.erase(index_.find(std::string_view(*entry.prefix)));
+
+        if (slot + 1 != family.series.size()) {
+            entry = std::move(family.series.back());
+            index_.find(std::string_view(*entry.prefix))->second.slot = slot;
+        }
+        family.series.pop_back();
+
+        if (family.series.empty()) {
+            total_bytes_ -= family.header.size();
+        }
+    }
+
+    void remove_family(std::size_t family_idx) {
+        family_index_.erase(family_index_.find(std::string_view(families_[family_idx].name)));
+        if (family_idx + 1 != families_.size()) {
+            families_[family_idx] = std::move(families_.back());
+            family_index_.find(std::string_view(families_[family_idx].name))->second = family_idx;
+            for (const auto& entry : families_[family_idx].series) {
+                index_.find(std::string_view(*entry.prefix))->second.family = family_idx;
+            }
+        }
+        families_.pop_back();
+    }
+
+    std::unordered_map<std::string, series_ref, name_hash, std::equal_to<>> index_;
+    std::unordered_map<std::string, std::size_t, name_hash, std::equal_to<>> family_index_;
+    std::vector<family_entry> families_;
+    std::unordered_map<std::string, std::uint32_t, name_hash, std::equal_to<>> source_index_;
+    std::vector<std::uint64_t> source_generations_{0};  ///< Current generation per source
+    std::uint64_t generation_{0};
+    std::size_t total_bytes_{0};
+
+    // Reused while keying upserts
+    std::string key_scratch_;
+    std::vector<label_view> label_views_;
+};
+
 /**
  * @struct statsd_metric_data
  * @brief StatsD-specific metric representation
@@ -199,40 +597,161 @@ struct statsd_metric_data {
     std::unordered_map<std::string, std::string> tags;
     
     /**
-     * @brief Convert to StatsD format
+     * @brief Append the StatsD line for this metric to @p out
+     *
+     * Renders in place without temporaries; the value and sample rate use
+     * the same shortest "%g" form as the default stream formatting.
      */
-    std::string to_statsd_format(bool datadog_format = false) const {
-        std::ostringstream ss;
-        
-        ss << name << ":" << value << "|";
-        
+    void append_to(std::string& out, bool datadog_format = false) const {
+        char number[32];
+
+        out.append(name);
+        out += ':';
+        out.append(number, static_cast<std::size_t>(std::snprintf(number, sizeof(number), "%g", value)));
+        out += '|';
+
         // Add type indicator
         switch (type) {
-            case metric_type::counter: ss << "c"; break;
-            case metric_type::gauge: ss << "g"; break;
-            case metric_type::timer: ss << "ms"; break;
-            case metric_type::histogram: ss << "h"; break;
-            case metric_type::summary: ss << "s"; break;
+            case metric_type::counter: out += 'c'; break;
+            case metric_type::gauge: out += 'g'; break;
+            case metric_type::timer: out.append("ms"); break;
+            case metric_type::histogram: out += 'h'; break;
+            case metric_type::summary: out += 's'; break;
         }
-        
+
         // Add sample rate if not 1.0
         if (sample_rate != 1.0) {
-            ss << "|@" << sample_rate;
+            out.append("|@");
+            out.append(number, static_cast<std::size_t>(std::snprintf(number, sizeof(number), "%g", sample_rate)));
         }
-        
+
         // Add tags (DataDog format)
         if (datadog_format && !tags.empty()) {
-            ss << "|#";
+            out.append("|#");
             bool first = true;
             for (const auto& [key, tag_value] : tags) {
-                if (!first) ss << ",";
-                ss << key << ":" << tag_value;
+                if (!first) out += ',';
+                out.append(key);
+                out += ':';
+                out.append(tag_value);
                 first = false;
             }
         }
-        
-        return ss.str();
     }
+
+    /**
+     * @brief Convert to StatsD format
+     */
+    std::string to_statsd_format(bool datadog_format = false) const {
+        std::string line;
+        append_to(line, datadog_format);
+        return line;
+    }
+};
+
+/**
+ * @class statsd_packet_packer
+ * @brief Packs StatsD lines into datagrams of bounded payload size
+ *
+ * Lines are rendered directly into one reusable buffer and grouped into
+ * newline-separated packets that each fit in @c max_payload bytes. A line
+ * that does not fit in the current packet starts the next one; a single
+ * line larger than @c max_payload is sent in a packet of its own and
+ * counted in oversized_lines(). Spans returned by finish() stay valid
+ * until the next reset() or add().
+ */
+class statsd_packet_packer {
+public:
+    explicit statsd_packet_packer(std::size_t max_payload = 1432)
+        : max_payload_(max_payload == 0 ? 1 : max_payload) {}
+
+    void set_max_payload(std::size_t max_payload) {
+        max_payload_ = max_payload == 0 ? 1 : max_payload;
+    }
+
+    std::size_t max_payload() const { return max_payload_; }
+
+    /**
+     * @brief Discard packed data, keeping buffer capacity
+     */
+    void reset() {
+        buffer_.clear();
+        packet_ends_.clear();
+        packets_.clear();
+        packet_start_ = 0;
+        oversized_lines_ = 0;
+    }
+
+    /**
+     * @brief Render @p metric into the current packet
+     */
+    void add(const statsd_metric_data& metric, bool datadog_format) {
+        add_line([&](std::string& out) { metric.append_to(out, datadog_format); });
+    }
+
+    /**
+     * @brief Add one line written by @p render into the current packet
+     * @param render Callable appending a single line, without a trailing
+     *        newline, to the std::string it is given
+     */
+    template<typename Render>
+    void add_line(Render&& render) {
+        const std::size_t separator = buffer_.size();
+        const bool has_lines = separator > packet_start_;
+        if (has_lines) {
+            buffer_ += '\n';
+        }
+        const std::size_t line_start = buffer_.size();
+        render(buffer_);
+        const std::size_t line_size = buffer_.size() - line_start;
+
+        if (has_lines && buffer_.size() - packet_start_ > max_payload_) {
+            // Close the packet before the separator and let the line open
+            // the next one.
+            buffer_.erase(separator, 1);
+            packet_ends_.push_back(separator);
+            packet_start_ = separator;
+        }
+
+        if (line_size > max_payload_) {
+            ++oversized_lines_;
+            close_packet();
+        }
+    }
+
+    /**
+     * @brief Close the last packet and return all packets in order
+     */
+    std::span<const std::span<const uint8_t>> finish() {
+        close_packet();
+        packets_.clear();
+        std::size_t begin = 0;
+        const auto* base = reinterpret_cast<const uint8_t*>(buffer_.data());
+        for (std::size_t end : packet_ends_) {
+            packets_.emplace_back(base + begin, end - begin);
+            begin = end;
+        }
+        return packets_;
+    }
+
+    std::size_t packet_count() const { return packet_ends_.size(); }
+    std::size_t oversized_lines() const { return oversized_lines_; }
+    std::size_t byte_size() const { return buffer_.size(); }
+
+private:
+    void close_packet() {
+        if (buffer_.size() > packet_start_) {
+            packet_ends_.push_back(buffer_.size());
+            packet_start_ = buffer_.size();
+        }
+    }
+
+    std::size_t max_payload_;
+    std::string buffer_;
+    std::vector<std::size_t> packet_ends_;
+    std::vector<std::span<const uint8_t>> packets_;
+    std::size_t packet_start_{0};
+    std::size_t oversized_lines_{0};
 };
 
 /**
@@ -252,6 +771,18 @@ public:
      * @brief Export a single metrics snapshot
      */
     virtual common::VoidResult export_snapshot(const metrics_snapshot& snapshot) = 0;
+
+    /**
+     * @brief Export a cycle-scoped arena snapshot
+     *
+     * The default implementation materializes a heap copy and forwards to
+     * export_snapshot(). Exporters that consume the data synchronously
+     * override this to read arena storage directly. Nothing may retain
+     * references into @p snapshot after returning.
+     */
+    virtual common::VoidResult export_arena_snapshot(const arena_metrics_snapshot& snapshot) {
+        return export_snapshot(materialize(snapshot));
+    }
     
     /**
      * @brief Flush any pending metrics
@@ -289,8 +820,14 @@ private:
     std::atomic<std::size_t> exported_metrics_{0};
     std::atomic<std::size_t> failed_exports_{0};
     std::atomic<std::size_t> scrape_requests_{0};
-    std::vector<prometheus_metric_data> current_metrics_;
+    prometheus_series_registry registry_;
     mutable std::mutex metrics_mutex_;
+
+    // Snapshot export scratch, guarded by metrics_mutex_
+    std::string name_scratch_;
+    std::string label_name_scratch_;
+    std::vector<std::size_t> label_name_ends_;
+    std::vector<prometheus_series_registry::label_view> labels_scratch_;
     
 public:
     explicit prometheus_exporter(const metric_export_config& config)
@@ -304,7 +841,7 @@ public:
         
         for (const auto& [name, value] : data.get_metrics()) {
             prometheus_metric_data metric;
-            metric.name = sanitize_metric_name(name);
+            prometheus_append_metric_name(metric.name, name);
             metric.type = infer_metric_type(name, value);
             metric.value = value;
             metric.timestamp = data.get_timestamp();
@@ -320,7 +857,7 @@ public:
             
             // Add tags as labels
             for (const auto& [key, tag_value] : data.get_tags()) {
-                metric.labels[sanitize_label_name(key)] = tag_value;
+                metric.labels[prometheus_sanitize_label_name(key)] = tag_value;
             }
             
             if (!config_.instance_id.empty()) {
@@ -334,14 +871,15 @@ public:
     }
     
     /**
-     * @brief Convert metrics_snapshot to Prometheus format
+     * @brief Convert metrics_snapshot or arena_metrics_snapshot to Prometheus format
      */
-    std::vector<prometheus_metric_data> convert_snapshot(const metrics_snapshot& snapshot) const {
+    template<typename Snapshot>
+    std::vector<prometheus_metric_data> convert_snapshot(const Snapshot& snapshot) const {
         std::vector<prometheus_metric_data> prom_metrics;
         
         for (const auto& metric_val : snapshot.metrics) {
             prometheus_metric_data metric;
-            metric.name = sanitize_metric_name(metric_val.name);
+            prometheus_append_metric_name(metric.name, metric_val.name);
             metric.type = infer_metric_type(metric_val.name, metric_val.value);
             metric.value = metric_val.value;
             metric.timestamp = metric_val.timestamp;
@@ -359,7 +897,7 @@ public:
             
             // Add tags as labels
             for (const auto& [key, tag_value] : metric_val.tags) {
-                metric.labels[sanitize_label_name(key)] = tag_value;
+                metric.labels[prometheus_sanitize_label_name(key)] = tag_value;
             }
             
             if (!config_.instance_id.empty()) {
@@ -375,13 +913,15 @@ public:
     common::VoidResult export_metrics(const std::vector<monitoring_data>& metrics) override {
         try {
             std::lock_guard<std::mutex> lock(metrics_mutex_);
-            current_metrics_.clear();
+            // Replaces the series of earlier batches; snapshot series are kept
+            registry_.begin_generation();
             
             for (const auto& data : metrics) {
-                auto prom_metrics = convert_monitoring_data(data);
-                current_metrics_.insert(current_metrics_.end(), 
-                                      prom_metrics.begin(), prom_metrics.end());
+                for (const auto& metric : convert_monitoring_data(data)) {
+                    registry_.upsert(metric);
+                }
             }
+            registry_.sweep();
             
             exported_metrics_ += metrics.size();
             return common::ok();
@@ -394,37 +934,40 @@ public:
     }
     
     common::VoidResult export_snapshot(const metrics_snapshot& snapshot) override {
-        try {
-            std::lock_guard<std::mutex> lock(metrics_mutex_);
-            auto prom_metrics = convert_snapshot(snapshot);
-            current_metrics_.insert(current_metrics_.end(), 
-                                  prom_metrics.begin(), prom_metrics.end());
-            
-            exported_metrics_++;
-            return common::ok();
+        return export_snapshot_impl(snapshot);
+    }
 
-        } catch (const std::exception& e) {
-            failed_exports_++;
-            return common::VoidResult::err(error_info(monitoring_error_code::operation_failed,
-                             "Prometheus snapshot export failed: " + std::string(e.what()), "monitoring_system").to_common_error());
-        }
+    common::VoidResult export_arena_snapshot(const arena_metrics_snapshot& snapshot) override {
+        return export_snapshot_impl(snapshot);
     }
     
     /**
      * @brief Get current metrics in Prometheus format (for HTTP endpoint)
      */
     std::string get_metrics_text() const {
-        std::lock_guard<std::mutex> lock(metrics_mutex_);
-        std::ostringstream ss;
-        
-        for (const auto& metric : current_metrics_) {
-            ss << metric.to_prometheus_text();
+        std::string text;
+        write_metrics_text(text);
+        return text;
+    }
+
+    /**
+     * @brief Render current metrics into @p buffer, replacing its contents
+     * @return Number of bytes written
+     *
+     * Reusing the same buffer across scrapes avoids reallocating it; the
+     * text is a concatenation of per-series fragments cached at export time.
+     */
+    std::size_t write_metrics_text(std::string& buffer) const {
+        std::size_t written = 0;
+        {
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            written = registry_.render(buffer);
         }
-        
+
         // Increment scrape counter
         const_cast<std::atomic<std::size_t>&>(scrape_requests_)++;
-        
-        return ss.str();
+
+        return written;
     }
     
     common::VoidResult flush() override {
@@ -437,57 +980,99 @@ public:
     }
     
     std::unordered_map<std::string, std::size_t> get_stats() const override {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
         return {
             {"exported_metrics", exported_metrics_.load()},
             {"failed_exports", failed_exports_.load()},
             {"scrape_requests", scrape_requests_.load()},
-            {"current_metrics_count", current_metrics_.size()}
+            {"current_metrics_count", registry_.series_count()},
+            {"current_families_count", registry_.family_count()},
+            {"exposition_bytes", registry_.byte_size()}
         };
     }
     
 private:
-    std::string sanitize_metric_name(const std::string& name) const {
-        std::string sanitized = name;
-        // Replace invalid characters with underscores
-        std::regex invalid_chars("[^a-zA-Z0-9_:]");
-        sanitized = std::regex_replace(sanitized, invalid_chars, "_");
-        
-        // Ensure it starts with a letter or underscore
-        if (!sanitized.empty() && !std::isalpha(sanitized[0]) && sanitized[0] != '_') {
-            sanitized = "_" + sanitized;
+    template<typename Snapshot>
+    common::VoidResult export_snapshot_impl(const Snapshot& snapshot) {
+        try {
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            // Snapshots update series in place; repeated series are not
+            // duplicated. A snapshot replaces only its own source's series.
+            const auto source = registry_.source(std::string_view(snapshot.source_id));
+            registry_.begin_generation(source);
+            for (const auto& metric_val : snapshot.metrics) {
+                upsert_snapshot_metric(snapshot.source_id, metric_val, source);
+            }
+            registry_.sweep(source);
+            
+            exported_metrics_++;
+            return common::ok();
+
+        } catch (const std::exception& e) {
+            failed_exports_++;
+            return common::VoidResult::err(error_info(monitoring_error_code::operation_failed,
+                             "Prometheus snapshot export failed: " + std::string(e.what()), "monitoring_system").to_common_error());
         }
-        
-        return sanitized;
     }
-    
-    std::string sanitize_label_name(const std::string& name) const {
-        std::string sanitized = name;
-        // Replace invalid characters with underscores
-        std::regex invalid_chars("[^a-zA-Z0-9_]");
-        sanitized = std::regex_replace(sanitized, invalid_chars, "_");
-        
-        // Ensure it starts with a letter or underscore
-        if (!sanitized.empty() && !std::isalpha(sanitized[0]) && sanitized[0] != '_') {
-            sanitized = "_" + sanitized;
+
+    /**
+     * @brief Upsert one snapshot entry, labelled as convert_snapshot() would
+     *
+     * Reads names and tags in place, so arena snapshots are exported
+     * without building intermediate heap copies. Must be called with
+     * metrics_mutex_ held.
+     */
+    template<typename Metric>
+    void upsert_snapshot_metric(std::string_view source_id, const Metric& metric_val,
+                                std::uint32_t source) {
+        name_scratch_.clear();
+        prometheus_append_metric_name(name_scratch_, metric_val.name);
+
+        // Sanitize tag names first; views into the scratch are taken once
+        // it has stopped growing.
+        label_name_scratch_.clear();
+        label_name_ends_.clear();
+        for (const auto& tag : metric_val.tags) {
+            prometheus_append_label_name(label_name_scratch_, tag.first);
+            label_name_ends_.push_back(label_name_scratch_.size());
         }
-        
-        return sanitized;
+
+        // Same precedence as convert_snapshot(): later labels win
+        labels_scratch_.clear();
+        if (!source_id.empty()) {
+            labels_scratch_.push_back({"source", source_id});
+        }
+        for (const auto& [key, label_value] : config_.labels) {
+            labels_scratch_.push_back({key, label_value});
+        }
+        std::size_t begin = 0;
+        std::size_t index = 0;
+        for (const auto& tag : metric_val.tags) {
+            const std::size_t end = label_name_ends_[index++];
+            labels_scratch_.push_back({std::string_view(label_name_scratch_).substr(begin, end - begin),
+                                       tag.second});
+            begin = end;
+        }
+        if (!config_.instance_id.empty()) {
+            labels_scratch_.push_back({"instance", config_.instance_id});
+        }
+
+        registry_.upsert(name_scratch_, infer_metric_type(metric_val.name, metric_val.value),
+                         "System metric", metric_val.value, metric_val.timestamp, labels_scratch_,
+                         source);
     }
-    
-    metric_type infer_metric_type(const std::string& name, double /*value*/) const {
+
+    metric_type infer_metric_type(std::string_view name, double /*value*/) const {
         // Simple heuristics for metric type inference
-        std::string lower_name = name;
-        std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
-        
-        if (lower_name.find("count") != std::string::npos ||
-            lower_name.find("total") != std::string::npos ||
-            lower_name.find("requests") != std::string::npos) {
+        if (detail::contains_lowercase(name, "count") ||
+            detail::contains_lowercase(name, "total") ||
+            detail::contains_lowercase(name, "requests")) {
             return metric_type::counter;
-        } else if (lower_name.find("histogram") != std::string::npos ||
-                  lower_name.find("bucket") != std::string::npos) {
+        } else if (detail::contains_lowercase(name, "histogram") ||
+                  detail::contains_lowercase(name, "bucket")) {
             return metric_type::histogram;
-        } else if (lower_name.find("summary") != std::string::npos ||
-                  lower_name.find("quantile") != std::string::npos) {
+        } else if (detail::contains_lowercase(name, "summary") ||
+                  detail::contains_lowercase(name, "quantile")) {
             return metric_type::summary;
         } else {
             return metric_type::gauge; // Default to gauge
@@ -501,16 +1086,26 @@ private:
  *
  * Exports metrics to StatsD-compatible backends via UDP.
  * Supports both plain StatsD and DataDog extension formats.
+ * Lines are packed into datagrams of at most
+ * metric_export_config::max_packet_size bytes and handed to the transport
+ * as one batch per export.
  */
 class statsd_exporter : public metric_exporter_interface {
 private:
     metric_export_config config_;
     std::unique_ptr<udp_transport> transport_;
+    std::mutex send_mutex_;
+    statsd_packet_packer packer_{config_.max_packet_size};
     std::atomic<std::size_t> exported_metrics_{0};
     std::atomic<std::size_t> failed_exports_{0};
     std::atomic<std::size_t> sent_packets_{0};
+    std::atomic<std::size_t> oversized_lines_{0};
+    std::atomic<std::size_t> last_export_packets_{0};
     bool started_{false};
 
+    // Datadog tag views for the line being rendered, guarded by send_mutex_
+    std::vector<std::pair<std::string_view, std::string_view>> tag_scratch_;
+
 public:
     /**
      * @brief Construct StatsD exporter with default UDP transport
@@ -567,9 +1162,10 @@ public:
     }
     
     /**
-     * @brief Convert metrics_snapshot to StatsD format
+     * @brief Convert metrics_snapshot or arena_metrics_snapshot to StatsD format
      */
-    std::vector<statsd_metric_data> convert_snapshot(const metrics_snapshot& snapshot) const {
+    template<typename Snapshot>
+    std::vector<statsd_metric_data> convert_snapshot(const Snapshot& snapshot) const {
         std::vector<statsd_metric_data> statsd_metrics;
         
         for (const auto& metric_val : snapshot.metrics) {
@@ -591,7 +1187,7 @@ public:
             
             // Add tags from metric
             for (const auto& [key, tag_value] : metric_val.tags) {
-                metric.tags[key] = tag_value;
+                metric.tags[std::string(key)] = tag_value;
             }
             
             if (!config_.instance_id.empty()) {
@@ -606,21 +1202,26 @@ public:
     
     common::VoidResult export_metrics(const std::vector<monitoring_data>& metrics) override {
         try {
-            std::vector<std::string> statsd_lines;
-            
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            const bool datadog_format = (config_.format == metric_export_format::statsd_datadog);
+            packer_.reset();
+
+            // Render lines straight into the packets; the tags are the same
+            // for every metric of one monitoring_data
             for (const auto& data : metrics) {
-                auto statsd_metrics = convert_monitoring_data(data);
-                for (const auto& metric : statsd_metrics) {
-                    bool datadog_format = (config_.format == metric_export_format::statsd_datadog);
-                    statsd_lines.push_back(metric.to_statsd_format(datadog_format));
+                if (datadog_format) {
+                    collect_data_tags(data);
+                }
+                for (const auto& [name, value] : data.get_metrics()) {
+                    packer_.add_line([&](std::string& out) {
+                        append_line(out, name, value, datadog_format);
+                    });
                 }
             }
-            
-            // Send via UDP (simulated)
-            auto send_result = send_udp_batch(statsd_lines);
+
+            auto send_result = send_packets();
             if (send_result.is_ok()) {
                 exported_metrics_ += metrics.size();
-                sent_packets_++;
             } else {
                 failed_exports_++;
                 return send_result;
@@ -636,32 +1237,11 @@ public:
     }
     
     common::VoidResult export_snapshot(const metrics_snapshot& snapshot) override {
-        try {
-            auto statsd_metrics = convert_snapshot(snapshot);
-            std::vector<std::string> statsd_lines;
-            
-            for (const auto& metric : statsd_metrics) {
-                bool datadog_format = (config_.format == metric_export_format::statsd_datadog);
-                statsd_lines.push_back(metric.to_statsd_format(datadog_format));
-            }
-            
-            // Send via UDP (simulated)
-            auto send_result = send_udp_batch(statsd_lines);
-            if (send_result.is_ok()) {
-                exported_metrics_++;
-                sent_packets_++;
-            } else {
-                failed_exports_++;
-                return send_result;
-            }
-
-            return common::ok();
+        return export_snapshot_impl(snapshot);
+    }
 
-        } catch (const std::exception& e) {
-            failed_exports_++;
-            return common::VoidResult::err(error_info(monitoring_error_code::operation_failed,
-                             "StatsD snapshot export failed: " + std::string(e.what()), "monitoring_system").to_common_error());
-        }
+    common::VoidResult export_arena_snapshot(const arena_metrics_snapshot& snapshot) override {
+        return export_snapshot_impl(snapshot);
     }
     
     common::VoidResult start() override {
@@ -713,7 +1293,10 @@ public:
         std::unordered_map<std::string, std::size_t> stats = {
             {"exported_metrics", exported_metrics_.load()},
             {"failed_exports", failed_exports_.load()},
-            {"sent_packets", sent_packets_.load()}
+            {"sent_packets", sent_packets_.load()},
+            {"last_export_packets", last_export_packets_.load()},
+            {"oversized_lines", oversized_lines_.load()},
+            {"max_packet_size", config_.max_packet_size}
         };
 
         // Add transport statistics if available
@@ -728,7 +1311,42 @@ public:
     }
     
 private:
-    common::VoidResult send_udp_batch(const std::vector<std::string>& lines) {
+    template<typename Snapshot>
+    common::VoidResult export_snapshot_impl(const Snapshot& snapshot) {
+        try {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            const bool datadog_format = (config_.format == metric_export_format::statsd_datadog);
+            packer_.reset();
+
+            for (const auto& metric_val : snapshot.metrics) {
+                packer_.add_line([&](std::string& out) {
+                    append_snapshot_line(out, snapshot.source_id, metric_val, datadog_format);
+                });
+            }
+
+            auto send_result = send_packets();
+            if (send_result.is_ok()) {
+                exported_metrics_++;
+            } else {
+                failed_exports_++;
+                return send_result;
+            }
+
+            return common::ok();
+
+        } catch (const std::exception& e) {
+            failed_exports_++;
+            return common::VoidResult::err(error_info(monitoring_error_code::operation_failed,
+                             "StatsD snapshot export failed: " + std::string(e.what()), "monitoring_system").to_common_error());
+        }
+    }
+    
+    /**
+     * @brief Send the packets currently held by packer_
+     *
+     * Must be called with send_mutex_ held.
+     */
+    common::VoidResult send_packets() {
         if (!transport_) {
             return common::VoidResult::err(error_info(
                 monitoring_error_code::dependency_missing,
@@ -745,39 +1363,153 @@ private:
             }
         }
 
-        // Combine lines into a single packet (newline-separated)
-        // StatsD typically accepts multiple metrics per packet
-        std::string batch;
-        for (const auto& line : lines) {
-            if (!batch.empty()) {
-                batch += '\n';
-            }
-            batch += line;
+        const auto packets = packer_.finish();
+        last_export_packets_.store(packets.size(), std::memory_order_relaxed);
+        oversized_lines_.fetch_add(packer_.oversized_lines(), std::memory_order_relaxed);
+        if (packets.empty()) {
+            return common::ok();
         }
 
-        // Send the batch
-        return transport_->send(batch);
+        auto result = transport_->send_batch(packets);
+        if (result.is_ok()) {
+            sent_packets_.fetch_add(packets.size(), std::memory_order_relaxed);
+        }
+        return result;
     }
     
-    std::string sanitize_metric_name(const std::string& name) const {
-        std::string sanitized = name;
-        // Replace dots and spaces with underscores for StatsD
-        std::regex invalid_chars("[.\\s]+");
-        sanitized = std::regex_replace(sanitized, invalid_chars, "_");
+    std::string sanitize_metric_name(std::string_view name) const {
+        std::string sanitized;
+        sanitized.reserve(name.size());
+        append_metric_name(sanitized, name);
         return sanitized;
     }
+
+    /**
+     * @brief Append @p name with each run of dots and whitespace replaced
+     *        by a single underscore
+     */
+    static void append_metric_name(std::string& out, std::string_view name) {
+        bool in_run = false;
+        for (char c : name) {
+            if (c == '.' || std::isspace(static_cast<unsigned char>(c))) {
+                if (!in_run) {
+                    out += '_';
+                    in_run = true;
+                }
+                continue;
+            }
+            out += c;
+            in_run = false;
+        }
+    }
+
+    /**
+     * @brief Append the line convert_snapshot() would produce for one entry
+     *
+     * Reads names and tags in place. Must be called with send_mutex_ held.
+     */
+    template<typename Metric>
+    void append_snapshot_line(std::string& out, std::string_view source_id,
+                              const Metric& metric_val, bool datadog_format) {
+        if (datadog_format) {
+            tag_scratch_.clear();
+            if (!source_id.empty()) {
+                tag_scratch_.emplace_back("source", source_id);
+            }
+            for (const auto& [key, tag_value] : config_.labels) {
+                tag_scratch_.emplace_back(key, tag_value);
+            }
+            for (const auto& tag : metric_val.tags) {
+                tag_scratch_.emplace_back(tag.first, tag.second);
+            }
+            if (!config_.instance_id.empty()) {
+                tag_scratch_.emplace_back("instance", config_.instance_id);
+            }
+            drop_overridden_tags();
+        }
+        append_line(out, metric_val.name, metric_val.value, datadog_format);
+    }
+
+    /**
+     * @brief Fill tag_scratch_ with the tags convert_monitoring_data() gives
+     *        every metric of @p data
+     *
+     * Must be called with send_mutex_ held.
+     */
+    void collect_data_tags(const monitoring_data& data) {
+        tag_scratch_.clear();
+        tag_scratch_.emplace_back("component", data.get_component_name());
+        for (const auto& [key, tag_value] : config_.labels) {
+            tag_scratch_.emplace_back(key, tag_value);
+        }
+        for (const auto& [key, tag_value] : data.get_tags()) {
+            tag_scratch_.emplace_back(key, tag_value);
+        }
+        if (!config_.instance_id.empty()) {
+            tag_scratch_.emplace_back("instance", config_.instance_id);
+        }
+        drop_overridden_tags();
+    }
+
+    /**
+     * @brief Keep only the last value of each repeated tag key
+     */
+    void drop_overridden_tags() {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < tag_scratch_.size(); ++i) {
+            const auto& key = tag_scratch_[i].first;
+            const bool overridden = std::any_of(
+                tag_scratch_.begin() + static_cast<std::ptrdiff_t>(i) + 1, tag_scratch_.end(),
+                [&](const auto& later) { return later.first == key; });
+            if (!overridden) {
+                tag_scratch_[kept++] = tag_scratch_[i];
+            }
+        }
+        tag_scratch_.resize(kept);
+    }
+
+    /**
+     * @brief Append one StatsD line, with tag_scratch_ as its Datadog tags
+     *
+     * Must be called with send_mutex_ held.
+     */
+    void append_line(std::string& out, std::string_view name, double value, bool datadog_format) {
+        char number[32];
+
+        append_metric_name(out, name);
+        out += ':';
+        out.append(number, static_cast<std::size_t>(
+            std::snprintf(number, sizeof(number), "%g", value)));
+        out += '|';
+        switch (infer_metric_type(name, value)) {
+            case metric_type::counter: out += 'c'; break;
+            case metric_type::gauge: out += 'g'; break;
+            case metric_type::timer: out.append("ms"); break;
+            case metric_type::histogram: out += 'h'; break;
+            case metric_type::summary: out += 's'; break;
+        }
+
+        if (!datadog_format) {
+            return;
+        }
+        bool first = true;
+        for (const auto& [key, tag_value] : tag_scratch_) {
+            out.append(first ? "|#" : ",");
+            out.append(key);
+            out += ':';
+            out.append(tag_value);
+            first = false;
+        }
+    }
     
-    metric_type infer_metric_type(const std::string& name, double /*value*/) const {
+    metric_type infer_metric_type(std::string_view name, double /*value*/) const {
         // Simple heuristics for StatsD metric type inference
-        std::string lower_name = name;
-        std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
-        
-        if (lower_name.find("count") != std::string::npos ||
-            lower_name.find("total") != std::string::npos) {
+        if (detail::contains_lowercase(name, "count") ||
+            detail::contains_lowercase(name, "total")) {
             return metric_type::counter;
-        } else if (lower_name.find("time") != std::string::npos ||
-                  lower_name.find("duration") != std::string::npos ||
-                  lower_name.find("latency") != std::string::npos) {
+        } else if (detail::contains_lowercase(name, "time") ||
+                  detail::contains_lowercase(name, "duration") ||
+                  detail::contains_lowercase(name, "latency")) {
             return metric_type::timer;
         } else {
             return metric_type::gauge; // Default to gauge
@@ -802,6 +1534,12 @@ private:
     std::atomic<std::size_t> failed_exports_{0};
     bool started_{false};
 
+    // Encoding state reused across exports, guarded by send_mutex_
+    std::mutex send_mutex_;
+    otlp_metrics_encoder encoder_;
+    otlp_export_request request_scratch_;
+    std::vector<uint8_t> body_buffer_;
+
 public:
     /**
      * @brief Construct OTLP exporter with default transports
@@ -890,6 +1628,38 @@ public:
         }
     }
     
+    /**
+     * @brief Export a pre-built OTLP request
+     * @param request Resource/scope/metric tree with typed data points
+     *
+     * Unlike export_metrics(), which only produces gauges, this carries
+     * sums, histograms, exponential histograms and summaries. Requires a
+     * protobuf format (otlp_grpc or otlp_http_protobuf).
+     */
+    common::VoidResult export_otlp_request(const otlp_export_request& request) {
+        if (!is_protobuf_format()) {
+            return common::VoidResult::err(error_info(
+                monitoring_error_code::invalid_configuration,
+                "export_otlp_request requires a protobuf OTLP format",
+                "otlp_metrics_exporter"
+            ).to_common_error());
+        }
+
+        common::VoidResult send_result = common::ok();
+        {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            encoder_.encode(request, body_buffer_);
+            send_result = is_grpc_protocol() ? send_body_via_grpc() : send_body_via_http();
+        }
+        if (send_result.is_err()) {
+            failed_exports_++;
+            return send_result;
+        }
+
+        exported_metrics_++;
+        return common::ok();
+    }
+
     common::VoidResult start() override {
         if (started_) {
             return common::ok();
@@ -945,6 +1715,11 @@ private:
         return config_.format == metric_export_format::otlp_grpc;
     }
 
+    bool is_protobuf_format() const {
+        return config_.format == metric_export_format::otlp_grpc ||
+               config_.format == metric_export_format::otlp_http_protobuf;
+    }
+
     bool is_http_protocol() const {
         return config_.format == metric_export_format::otlp_http_json ||
                config_.format == metric_export_format::otlp_http_protobuf;
@@ -962,14 +1737,16 @@ private:
     }
 
     common::VoidResult send_otlp_batch(const std::vector<otel_metric_data>& metrics) {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        serialize_metrics(metrics);
         if (is_grpc_protocol()) {
-            return send_via_grpc(metrics);
+            return send_body_via_grpc();
         } else {
-            return send_via_http(metrics);
+            return send_body_via_http();
         }
     }
 
-    common::VoidResult send_via_http(const std::vector<otel_metric_data>& metrics) {
+    common::VoidResult send_body_via_http() {
         if (!http_transport_) {
             return common::VoidResult::err(error_info(
                 monitoring_error_code::dependency_missing,
@@ -985,14 +1762,11 @@ private:
         }
         endpoint += "/v1/metrics";
 
-        // Serialize metrics to JSON or Protobuf
-        std::vector<uint8_t> body = serialize_metrics(metrics);
-
         http_request request;
         request.url = endpoint;
         request.method = "POST";
         request.headers["Content-Type"] = get_content_type();
-        request.body = std::move(body);
+        request.body = std::move(body_buffer_);
         request.timeout = config_.timeout;
 
         // Add custom headers
@@ -1001,6 +1775,8 @@ private:
         }
 
         auto result = http_transport_->send(request);
+        // Take the buffer back so its capacity is reused by the next export
+        body_buffer_ = std::move(request.body);
         if (result.is_err()) {
             return common::VoidResult::err(error_info(
                 monitoring_error_code::network_error,
@@ -1021,7 +1797,7 @@ private:
         return common::ok();
     }
 
-    common::VoidResult send_via_grpc(const std::vector<otel_metric_data>& metrics) {
+    common::VoidResult send_body_via_grpc() {
         if (!grpc_transport_) {
             return common::VoidResult::err(error_info(
                 monitoring_error_code::dependency_missing,
@@ -1038,16 +1814,14 @@ private:
             }
         }
 
-        // Serialize metrics to protobuf
-        std::vector<uint8_t> body = serialize_metrics(metrics);
-
         grpc_request request;
         request.service = "opentelemetry.proto.collector.metrics.v1.MetricsService";
         request.method = "Export";
-        request.body = std::move(body);
+        request.body = std::move(body_buffer_);
         request.timeout = config_.timeout;
 
         auto result = grpc_transport_->send(request);
+        body_buffer_ = std::move(request.body);
         if (result.is_err()) {
             return common::VoidResult::err(error_info(
                 monitoring_error_code::network_error,
@@ -1068,11 +1842,19 @@ private:
         return common::ok();
     }
 
-    std::vector<uint8_t> serialize_metrics(const std::vector<otel_metric_data>& metrics) const {
-        // Serialize metrics based on format
-        // For JSON format, convert to JSON string
-        // For protobuf format, serialize to protobuf bytes
-        // This is a simplified implementation
+    /**
+     * @brief Serialize metrics into body_buffer_
+     *
+     * Protobuf formats use otlp_metrics_encoder; otlp_http_json keeps the
+     * simplified JSON encoding.
+     */
+    void serialize_metrics(const std::vector<otel_metric_data>& metrics) {
+        if (is_protobuf_format()) {
+            build_otlp_gauge_request(metrics, request_scratch_);
+            encoder_.encode(request_scratch_, body_buffer_);
+            return;
+        }
+
         std::string json = "{\"resourceMetrics\":[";
 
         bool first = true;
@@ -1089,7 +1871,7 @@ private:
 
         json += "]}";
 
-        return std::vector<uint8_t>(json.begin(), json.end());
+        body_buffer_.assign(json.begin(), json.end());
     }
 };
 
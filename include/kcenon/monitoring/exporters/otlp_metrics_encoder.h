@@ -0,0 +1,718 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file otlp_metrics_encoder.h
+ * @brief Hand-written protobuf wire encoder for OTLP metrics
+ *
+ * Encodes the OTLP metrics data model (opentelemetry/proto/metrics/v1) as an
+ * ExportMetricsServiceRequest without generated protobuf code:
+ * - Gauge, Sum (temporality, monotonicity), Histogram,
+ *   ExponentialHistogram and Summary metrics
+ * - Resource, instrumentation scope and data point attributes
+ *
+ * Encoding is done in two passes over the same traversal. The first pass
+ * computes every nested message length in pre-order and caches it, so the
+ * second pass can write each length prefix before the message body directly
+ * into an exactly sized output buffer. Both the size cache and the output
+ * buffer are reused across calls, so steady-state encoding does not allocate.
+ */
+
+#include "opentelemetry_adapter.h"
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @enum otlp_metric_type
+ * @brief OTLP metric data kinds (the Metric.data oneof)
+ */
+enum class otlp_metric_type {
+    gauge,
+    sum,
+    histogram,
+    exponential_histogram,
+    summary
+};
+
+/**
+ * @enum otlp_aggregation_temporality
+ * @brief OTLP AggregationTemporality values
+ */
+enum class otlp_aggregation_temporality : std::uint32_t {
+    unspecified = 0,
+    delta = 1,
+    cumulative = 2
+};
+
+/**
+ * @struct otlp_number_data_point
+ * @brief NumberDataPoint used by gauges and sums
+ */
+struct otlp_number_data_point {
+    std::vector<otel_attribute> attributes;
+    std::uint64_t start_time_unix_nano{0};
+    std::uint64_t time_unix_nano{0};
+    std::variant<double, std::int64_t> value{0.0};
+};
+
+/**
+ * @struct otlp_histogram_data_point
+ * @brief HistogramDataPoint with explicit bucket bounds
+ *
+ * bucket_counts has explicit_bounds.size() + 1 entries.
+ */
+struct otlp_histogram_data_point {
+    std::vector<otel_attribute> attributes;
+    std::uint64_t start_time_unix_nano{0};
+    std::uint64_t time_unix_nano{0};
+    std::uint64_t count{0};
+    std::optional<double> sum;
+    std::vector<std::uint64_t> bucket_counts;
+    std::vector<double> explicit_bounds;
+    std::optional<double> min;
+    std::optional<double> max;
+};
+
+/**
+ * @struct otlp_exponential_buckets
+ * @brief Bucket range of an exponential histogram (one sign)
+ */
+struct otlp_exponential_buckets {
+    std::int32_t offset{0};
+    std::vector<std::uint64_t> bucket_counts;
+};
+
+/**
+ * @struct otlp_exponential_histogram_data_point
+ * @brief ExponentialHistogramDataPoint with base-2 scaled buckets
+ */
+struct otlp_exponential_histogram_data_point {
+    std::vector<otel_attribute> attributes;
+    std::uint64_t start_time_unix_nano{0};
+    std::uint64_t time_unix_nano{0};
+    std::uint64_t count{0};
+    std::optional<double> sum;
+    std::int32_t scale{0};
+    std::uint64_t zero_count{0};
+    otlp_exponential_buckets positive;
+    otlp_exponential_buckets negative;
+    std::optional<double> min;
+    std::optional<double> max;
+    double zero_threshold{0.0};
+};
+
+/**
+ * @struct otlp_summary_data_point
+ * @brief SummaryDataPoint with (quantile, value) pairs
+ */
+struct otlp_summary_data_point {
+    std::vector<otel_attribute> attributes;
+    std::uint64_t start_time_unix_nano{0};
+    std::uint64_t time_unix_nano{0};
+    std::uint64_t count{0};
+    double sum{0.0};
+    std::vector<std::pair<double, double>> quantile_values;
+};
+
+/**
+ * @struct otlp_metric
+ * @brief A single OTLP metric; only the point vector matching @c type is encoded
+ */
+struct otlp_metric {
+    std::string name;
+    std::string description;
+    std::string unit;
+    otlp_metric_type type{otlp_metric_type::gauge};
+    otlp_aggregation_temporality temporality{otlp_aggregation_temporality::cumulative};
+    bool is_monotonic{false};  ///< Sum only
+
+    std::vector<otlp_number_data_point> number_points;        ///< gauge, sum
+    std::vector<otlp_histogram_data_point> histogram_points;
+    std::vector<otlp_exponential_histogram_data_point> exponential_histogram_points;
+    std::vector<otlp_summary_data_point> summary_points;
+};
+
+/**
+ * @struct otlp_scope_metrics
+ * @brief Metrics produced by one instrumentation scope
+ */
+struct otlp_scope_metrics {
+    std::string scope_name;
+    std::string scope_version;
+    std::vector<otel_attribute> scope_attributes;
+    std::vector<otlp_metric> metrics;
+    std::string schema_url;
+};
+
+/**
+ * @struct otlp_resource_metrics
+ * @brief Metrics of one resource, grouped by scope
+ */
+struct otlp_resource_metrics {
+    std::vector<otel_attribute> resource_attributes;
+    std::vector<otlp_scope_metrics> scope_metrics;
+    std::string schema_url;
+};
+
+/**
+ * @struct otlp_export_request
+ * @brief Root ExportMetricsServiceRequest
+ */
+struct otlp_export_request {
+    std::vector<otlp_resource_metrics> resource_metrics;
+};
+
+namespace detail {
+
+/** @brief Protobuf wire types used by OTLP */
+enum class pb_wire_type : std::uint32_t {
+    varint = 0,
+    fixed64 = 1,
+    length_delimited = 2
+};
+
+inline constexpr std::size_t pb_varint_size(std::uint64_t value) noexcept {
+    std::size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline constexpr std::uint64_t pb_tag(std::uint32_t field, pb_wire_type type) noexcept {
+    return (static_cast<std::uint64_t>(field) << 3) | static_cast<std::uint32_t>(type);
+}
+
+inline constexpr std::uint32_t pb_zigzag32(std::int32_t value) noexcept {
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+/**
+ * @class pb_size_pass
+ * @brief First encoding pass: accumulates sizes and caches message lengths
+ *
+ * Each nested message reserves a slot in @c sizes before its body is
+ * measured, so lengths are stored in the order the write pass needs them.
+ */
+class pb_size_pass {
+public:
+    explicit pb_size_pass(std::vector<std::size_t>& sizes) : sizes_(sizes) {}
+
+    std::size_t total() const noexcept { return total_; }
+
+    template <typename Body>
+    void message(std::uint32_t field, Body&& body) {
+        const std::size_t slot = sizes_.size();
+        sizes_.push_back(0);
+        const std::size_t outer = total_;
+        total_ = 0;
+        body();
+        const std::size_t length = total_;
+        sizes_[slot] = length;
+        total_ = outer + tag_size(field, pb_wire_type::length_delimited) +
+                 pb_varint_size(length) + length;
+    }
+
+    void string(std::uint32_t field, std::string_view value) {
+        total_ += tag_size(field, pb_wire_type::length_delimited) +
+                  pb_varint_size(value.size()) + value.size();
+    }
+
+    void varint(std::uint32_t field, std::uint64_t value) {
+        total_ += tag_size(field, pb_wire_type::varint) + pb_varint_size(value);
+    }
+
+    void fixed64(std::uint32_t field, std::uint64_t) {
+        total_ += tag_size(field, pb_wire_type::fixed64) + 8;
+    }
+
+    void packed_fixed64(std::uint32_t field, const std::vector<std::uint64_t>& values) {
+        packed_fixed_width(field, values.size());
+    }
+
+    void packed_double(std::uint32_t field, const std::vector<double>& values) {
+        packed_fixed_width(field, values.size());
+    }
+
+    void packed_varint(std::uint32_t field, const std::vector<std::uint64_t>& values) {
+        if (values.empty()) {
+            return;
+        }
+        std::size_t length = 0;
+        for (auto v : values) {
+            length += pb_varint_size(v);
+        }
+        total_ += tag_size(field, pb_wire_type::length_delimited) +
+                  pb_varint_size(length) + length;
+    }
+
+private:
+    static std::size_t tag_size(std::uint32_t field, pb_wire_type type) noexcept {
+        return pb_varint_size(pb_tag(field, type));
+    }
+
+    void packed_fixed_width(std::uint32_t field, std::size_t count) {
+        if (count == 0) {
+            return;
+        }
+        const std::size_t length = count * 8;
+        total_ += tag_size(field, pb_wire_type::length_delimited) +
+                  pb_varint_size(length) + length;
+    }
+
+    std::vector<std::size_t>& sizes_;
+    std::size_t total_{0};
+};
+
+/**
+ * @class pb_write_pass
+ * @brief Second encoding pass: writes bytes using the cached lengths
+ */
+class pb_write_pass {
+public:
+    pb_write_pass(const std::size_t* sizes, std::uint8_t* out) noexcept
+        : sizes_(sizes), out_(out) {}
+
+    std::uint8_t* position() const noexcept { return out_; }
+
+    template <typename Body>
+    void message(std::uint32_t field, Body&& body) {
+        put_varint(pb_tag(field, pb_wire_type::length_delimited));
+        put_varint(*sizes_++);
+        body();
+    }
+
+    void string(std::uint32_t field, std::string_view value) {
+        put_varint(pb_tag(field, pb_wire_type::length_delimited));
+        put_varint(value.size());
+        for (char c : value) {
+            *out_++ = static_cast<std::uint8_t>(c);
+        }
+    }
+
+    void varint(std::uint32_t field, std::uint64_t value) {
+        put_varint(pb_tag(field, pb_wire_type::varint));
+        put_varint(value);
+    }
+
+    void fixed64(std::uint32_t field, std::uint64_t value) {
+        put_varint(pb_tag(field, pb_wire_type::fixed64));
+        put_fixed64(value);
+    }
+
+    void packed_fixed64(std::uint32_t field, const std::vector<std::uint64_t>& values) {
+        if (values.empty()) {
+            return;
+        }
+        put_varint(pb_tag(field, pb_wire_type::length_delimited));
+        put_varint(values.size() * 8);
+        for (auto v : values) {
+            put_fixed64(v);
+        }
+    }
+
+    void packed_double(std::uint32_t field, const std::vector<double>& values) {
+        if (values.empty()) {
+            return;
+        }
+        put_varint(pb_tag(field, pb_wire_type::length_delimited));
+        put_varint(values.size() * 8);
+        for (auto v : values) {
+            put_fixed64(std::bit_cast<std::uint64_t>(v));
+        }
+    }
+
+    void packed_varint(std::uint32_t field, const std::vector<std::uint64_t>& values) {
+        if (values.empty()) {
+            return;
+        }
+        std::size_t length = 0;
+        for (auto v : values) {
+            length += pb_varint_size(v);
+        }
+        put_varint(pb_tag(field, pb_wire_type::length_delimited));
+        put_varint(length);
+        for (auto v : values) {
+            put_varint(v);
+        }
+    }
+
+private:
+    void put_varint(std::uint64_t value) noexcept {
+        while (value >= 0x80) {
+            *out_++ = static_cast<std::uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out_++ = static_cast<std::uint8_t>(value);
+    }
+
+    void put_fixed64(std::uint64_t value) noexcept {
+        for (int i = 0; i < 8; ++i) {
+            *out_++ = static_cast<std::uint8_t>(value & 0xFF);
+            value >>= 8;
+        }
+    }
+
+    const std::size_t* sizes_;
+    std::uint8_t* out_;
+};
+
+} // namespace detail
+
+/**
+ * @class otlp_metrics_encoder
+ * @brief Encodes otlp_export_request into OTLP protobuf bytes
+ *
+ * Not thread-safe; use one encoder per exporting thread. The returned
+ * bytes are a serialized ExportMetricsServiceRequest suitable for both
+ * OTLP/HTTP (application/x-protobuf) and OTLP/gRPC bodies.
+ */
+class otlp_metrics_encoder {
+public:
+    /**
+     * @brief Encode into a caller-provided buffer, replacing its contents
+     * @return Number of bytes written (== out.size())
+     *
+     * The buffer's capacity is reused, so repeatedly encoding into the same
+     * vector allocates only when a request is larger than any before it.
+     */
+    std::size_t encode(const otlp_export_request& request, std::vector<std::uint8_t>& out) {
+        sizes_.clear();
+        detail::pb_size_pass sizer(sizes_);
+        encode_request(sizer, request);
+
+        out.resize(sizer.total());
+        detail::pb_write_pass writer(sizes_.data(), out.data());
+        encode_request(writer, request);
+        return out.size();
+    }
+
+    /**
+     * @brief Encode into the encoder's internal buffer
+     * @return View of the encoded bytes, valid until the next encode call
+     */
+    const std::vector<std::uint8_t>& encode(const otlp_export_request& request) {
+        encode(request, buffer_);
+        return buffer_;
+    }
+
+    /**
+     * @brief Size in bytes the encoded request would occupy
+     */
+    std::size_t encoded_size(const otlp_export_request& request) {
+        sizes_.clear();
+        detail::pb_size_pass sizer(sizes_);
+        encode_request(sizer, request);
+        return sizer.total();
+    }
+
+private:
+    // Field numbers follow opentelemetry/proto/metrics/v1/metrics.proto,
+    // common/v1/common.proto and collector/metrics/v1/metrics_service.proto.
+
+    template <typename Pass>
+    static void encode_request(Pass& p, const otlp_export_request& request) {
+        for (const auto& rm : request.resource_metrics) {
+            p.message(1, [&] { encode_resource_metrics(p, rm); });
+        }
+    }
+
+    template <typename Pass>
+    static void encode_resource_metrics(Pass& p, const otlp_resource_metrics& rm) {
+        p.message(1, [&] { encode_attributes(p, 1, rm.resource_attributes); });
+        for (const auto& sm : rm.scope_metrics) {
+            p.message(2, [&] { encode_scope_metrics(p, sm); });
+        }
+        if (!rm.schema_url.empty()) {
+            p.string(3, rm.schema_url);
+        }
+    }
+
+    template <typename Pass>
+    static void encode_scope_metrics(Pass& p, const otlp_scope_metrics& sm) {
+        p.message(1, [&] {
+            if (!sm.scope_name.empty()) {
+                p.string(1, sm.scope_name);
+            }
+            if (!sm.scope_version.empty()) {
+                p.string(2, sm.scope_version);
+            }
+            encode_attributes(p, 3, sm.scope_attributes);
+        });
+        for (const auto& metric : sm.metrics) {
+            p.message(2, [&] { encode_metric(p, metric); });
+        }
+        if (!sm.schema_url.empty()) {
+            p.string(3, sm.schema_url);
+        }
+    }
+
+    template <typename Pass>
+    static void encode_metric(Pass& p, const otlp_metric& metric) {
+        if (!metric.name.empty()) {
+            p.string(1, metric.name);
+        }
+        if (!metric.description.empty()) {
+            p.string(2, metric.description);
+        }
+        if (!metric.unit.empty()) {
+            p.string(3, metric.unit);
+        }
+
+        switch (metric.type) {
+            case otlp_metric_type::gauge:
+                p.message(5, [&] {
+                    for (const auto& point : metric.number_points) {
+                        p.message(1, [&] { encode_number_point(p, point); });
+                    }
+                });
+                break;
+            case otlp_metric_type::sum:
+                p.message(7, [&] {
+                    for (const auto& point : metric.number_points) {
+                        p.message(1, [&] { encode_number_point(p, point); });
+                    }
+                    encode_temporality(p, metric.temporality);
+                    if (metric.is_monotonic) {
+                        p.varint(3, 1);
+                    }
+                });
+                break;
+            case otlp_metric_type::histogram:
+                p.message(9, [&] {
+                    for (const auto& point : metric.histogram_points) {
+                        p.message(1, [&] { encode_histogram_point(p, point); });
+                    }
+                    encode_temporality(p, metric.temporality);
+                });
+                break;
+            case otlp_metric_type::exponential_histogram:
+                p.message(10, [&] {
+                    for (const auto& point : metric.exponential_histogram_points) {
+                        p.message(1, [&] { encode_exponential_histogram_point(p, point); });
+                    }
+                    encode_temporality(p, metric.temporality);
+                });
+                break;
+            case otlp_metric_type::summary:
+                p.message(11, [&] {
+                    for (const auto& point : metric.summary_points) {
+                        p.message(1, [&] { encode_summary_point(p, point); });
+                    }
+                });
+                break;
+        }
+    }
+
+    template <typename Pass>
+    static void encode_temporality(Pass& p, otlp_aggregation_temporality temporality) {
+        if (temporality != otlp_aggregation_temporality::unspecified) {
+            p.varint(2, static_cast<std::uint64_t>(temporality));
+        }
+    }
+
+    template <typename Pass>
+    static void encode_times(Pass& p, std::uint64_t start, std::uint64_t time) {
+        if (start != 0) {
+            p.fixed64(2, start);
+        }
+        if (time != 0) {
+            p.fixed64(3, time);
+        }
+    }
+
+    template <typename Pass>
+    static void encode_number_point(Pass& p, const otlp_number_data_point& point) {
+        encode_times(p, point.start_time_unix_nano, point.time_unix_nano);
+        // The value is a oneof, so it is written even when zero.
+        if (const auto* d = std::get_if<double>(&point.value)) {
+            p.fixed64(4, std::bit_cast<std::uint64_t>(*d));
+        } else {
+            p.fixed64(6, static_cast<std::uint64_t>(std::get<std::int64_t>(point.value)));
+        }
+        encode_attributes(p, 7, point.attributes);
+    }
+
+    template <typename Pass>
+    static void encode_histogram_point(Pass& p, const otlp_histogram_data_point& point) {
+        encode_times(p, point.start_time_unix_nano, point.time_unix_nano);
+        if (point.count != 0) {
+            p.fixed64(4, point.count);
+        }
+        encode_optional_double(p, 5, point.sum);
+        p.packed_fixed64(6, point.bucket_counts);
+        p.packed_double(7, point.explicit_bounds);
+        encode_attributes(p, 9, point.attributes);
+        encode_optional_double(p, 11, point.min);
+        encode_optional_double(p, 12, point.max);
+    }
+
+    template <typename Pass>
+    static void encode_exponential_histogram_point(
+        Pass& p, const otlp_exponential_histogram_data_point& point) {
+        encode_attributes(p, 1, point.attributes);
+        encode_times(p, point.start_time_unix_nano, point.time_unix_nano);
+        if (point.count != 0) {
+            p.fixed64(4, point.count);
+        }
+        encode_optional_double(p, 5, point.sum);
+        if (point.scale != 0) {
+            p.varint(6, detail::pb_zigzag32(point.scale));
+        }
+        if (point.zero_count != 0) {
+            p.fixed64(7, point.zero_count);
+        }
+        encode_buckets(p, 8, point.positive);
+        encode_buckets(p, 9, point.negative);
+        encode_optional_double(p, 12, point.min);
+        encode_optional_double(p, 13, point.max);
+        if (std::bit_cast<std::uint64_t>(point.zero_threshold) != 0) {
+            p.fixed64(14, std::bit_cast<std::uint64_t>(point.zero_threshold));
+        }
+    }
+
+    template <typename Pass>
+    static void encode_buckets(Pass& p, std::uint32_t field, const otlp_exponential_buckets& buckets) {
+        if (buckets.offset == 0 && buckets.bucket_counts.empty()) {
+            return;
+        }
+        p.message(field, [&] {
+            if (buckets.offset != 0) {
+                p.varint(1, detail::pb_zigzag32(buckets.offset));
+            }
+            p.packed_varint(2, buckets.bucket_counts);
+        });
+    }
+
+    template <typename Pass>
+    static void encode_summary_point(Pass& p, const otlp_summary_data_point& point) {
+        encode_times(p, point.start_time_unix_nano, point.time_unix_nano);
+        if (point.count != 0) {
+            p.fixed64(4, point.count);
+        }
+        if (std::bit_cast<std::uint64_t>(point.sum) != 0) {
+            p.fixed64(5, std::bit_cast<std::uint64_t>(point.sum));
+        }
+        for (const auto& [quantile, value] : point.quantile_values) {
+            p.message(6, [&] {
+                if (std::bit_cast<std::uint64_t>(quantile) != 0) {
+                    p.fixed64(1, std::bit_cast<std::uint64_t>(quantile));
+                }
+                if (std::bit_cast<std::uint64_t>(value) != 0) {
+                    p.fixed64(2, std::bit_cast<std::uint64_t>(value));
+                }
+            });
+        }
+        encode_attributes(p, 7, point.attributes);
+    }
+
+    template <typename Pass>
+    static void encode_optional_double(Pass& p, std::uint32_t field, const std::optional<double>& value) {
+        if (value) {
+            p.fixed64(field, std::bit_cast<std::uint64_t>(*value));
+        }
+    }
+
+    /** @brief Repeated KeyValue with string AnyValue */
+    template <typename Pass>
+    static void encode_attributes(Pass& p, std::uint32_t field,
+                                  const std::vector<otel_attribute>& attributes) {
+        for (const auto& attr : attributes) {
+            p.message(field, [&] {
+                p.string(1, attr.key);
+                p.message(2, [&] { p.string(1, attr.value); });
+            });
+        }
+    }
+
+    std::vector<std::size_t> sizes_;
+    std::vector<std::uint8_t> buffer_;
+};
+
+/**
+ * @brief Fill an OTLP request with gauges from adapter-converted metrics
+ * @param metrics Metrics produced by opentelemetry_metrics_adapter
+ * @param request Request to overwrite; its vectors and strings are reused
+ * @param scope_name Instrumentation scope name
+ * @param scope_version Instrumentation scope version
+ *
+ * Consecutive metrics sharing a resource are grouped under one
+ * ResourceMetrics entry.
+ */
+inline void build_otlp_gauge_request(const std::vector<otel_metric_data>& metrics,
+                                     otlp_export_request& request,
+                                     std::string_view scope_name = "monitoring_system",
+                                     std::string_view scope_version = "2.0.0") {
+    std::size_t groups = 0;
+    std::size_t metrics_in_group = 0;
+    const otel_resource* current = nullptr;
+
+    for (const auto& data : metrics) {
+        if (current == nullptr || current->attributes != data.resource.attributes) {
+            if (groups > 0) {
+                request.resource_metrics[groups - 1].scope_metrics[0].metrics.resize(metrics_in_group);
+            }
+            if (request.resource_metrics.size() <= groups) {
+                request.resource_metrics.emplace_back();
+            }
+            auto& rm = request.resource_metrics[groups++];
+            rm.resource_attributes = data.resource.attributes;
+            rm.schema_url.clear();
+            rm.scope_metrics.resize(1);
+            auto& sm = rm.scope_metrics[0];
+            sm.scope_name.assign(scope_name);
+            sm.scope_version.assign(scope_version);
+            sm.scope_attributes.clear();
+            sm.schema_url.clear();
+            current = &data.resource;
+            metrics_in_group = 0;
+        }
+
+        auto& scope_metrics = request.resource_metrics[groups - 1].scope_metrics[0].metrics;
+        if (scope_metrics.size() <= metrics_in_group) {
+            scope_metrics.emplace_back();
+        }
+        auto& metric = scope_metrics[metrics_in_group++];
+        metric.name = data.name;
+        metric.description = data.description;
+        metric.unit = data.unit;
+        metric.type = otlp_metric_type::gauge;
+        metric.temporality = otlp_aggregation_temporality::unspecified;
+        metric.is_monotonic = false;
+        metric.histogram_points.clear();
+        metric.exponential_histogram_points.clear();
+        metric.summary_points.clear();
+        metric.number_points.resize(1);
+
+        auto& point = metric.number_points[0];
+        point.attributes = data.attributes;
+        point.start_time_unix_nano = 0;
+        point.time_unix_nano = data.timestamp.time_since_epoch().count() > 0
+            ? static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  data.timestamp.time_since_epoch()).count())
+            : 0;
+        point.value = data.value;
+    }
+
+    if (groups > 0) {
+        request.resource_metrics[groups - 1].scope_metrics[0].metrics.resize(metrics_in_group);
+    }
+    request.resource_metrics.resize(groups);
+}
+
+} } // namespace kcenon::monitoring
@@ -0,0 +1,787 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file prometheus_http_server.h
+ * @brief Embedded HTTP/1.1 endpoint serving prometheus_exporter metrics
+ *
+ * A minimal scrape endpoint so pull-based export works without network_system
+ * or a web framework:
+ * - One I/O thread driving non-blocking sockets through epoll
+ * - HTTP/1.1 keep-alive and pipelining, HTTP/1.0 close-by-default
+ * - GET/HEAD on the configured path, rendered from the exporter's
+ *   pre-rendered series registry into a reused buffer
+ * - gzip Content-Encoding when the client accepts it and the build has zlib
+ *   (MONITORING_HAS_ZLIB)
+ *
+ * The server is Linux-only (epoll, eventfd, accept4). On other platforms
+ * start() returns an error.
+ *
+ * @code
+ * prometheus_exporter exporter(config);
+ * prometheus_http_server server(exporter, {.port = 9464});
+ * server.start();
+ * @endcode
+ */
+
+#include "../core/result_types.h"
+#include "../core/error_codes.h"
+#include "metric_exporters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef MONITORING_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @struct prometheus_http_server_config
+ * @brief Listener configuration for prometheus_http_server
+ */
+struct prometheus_http_server_config {
+    std::string bind_address{"0.0.0.0"};              ///< IPv4 address to listen on
+    std::uint16_t port{9464};                         ///< 0 picks an ephemeral port
+    std::string path{"/metrics"};                     ///< Scrape path
+    std::size_t max_connections{256};                 ///< Further accepts are closed
+    std::size_t max_request_bytes{8192};              ///< Request head limit (431 beyond)
+    std::chrono::milliseconds idle_timeout{30000};    ///< Keep-alive idle limit
+    bool enable_gzip{true};                           ///< Honour Accept-Encoding: gzip
+    std::size_t gzip_min_bytes{1024};                 ///< Smaller bodies are sent as-is
+    int gzip_level{1};                                ///< zlib level; 1 favours scrape latency
+    int listen_backlog{128};
+};
+
+/**
+ * @struct prometheus_http_server_stats
+ * @brief Counters exposed by prometheus_http_server
+ */
+struct prometheus_http_server_stats {
+    std::size_t connections_accepted{0};
+    std::size_t connections_rejected{0};
+    std::size_t active_connections{0};
+    std::size_t requests_served{0};
+    std::size_t scrapes_served{0};
+    std::size_t gzip_responses{0};
+    std::size_t bytes_sent{0};
+};
+
+/**
+ * @class prometheus_http_server
+ * @brief Single-threaded epoll HTTP server exposing a prometheus_exporter
+ *
+ * The exporter must outlive the server. start()/stop() may be called from
+ * any thread; all socket work happens on the server's I/O thread.
+ */
+class prometheus_http_server {
+public:
+    explicit prometheus_http_server(const prometheus_exporter& exporter,
+                                    prometheus_http_server_config config = {})
+        : exporter_(exporter), config_(std::move(config)) {}
+
+    ~prometheus_http_server() {
+        stop();
+#ifdef MONITORING_HAS_ZLIB
+        if (zlib_ready_) {
+            ::deflateEnd(&zstream_);
+        }
+#endif
+    }
+
+    prometheus_http_server(const prometheus_http_server&) = delete;
+    prometheus_http_server& operator=(const prometheus_http_server&) = delete;
+
+    /**
+     * @brief Bind, listen and start the I/O thread
+     */
+    common::VoidResult start() {
+#if defined(__linux__)
+        if (running_.load()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::already_started,
+                "Prometheus HTTP server is already running", "monitoring_system").to_common_error());
+        }
+
+        auto result = open_listener();
+        if (result.is_err()) {
+            close_fds();
+            return result;
+        }
+
+        running_.store(true);
+        io_thread_ = std::thread([this] { run(); });
+        return common::ok();
+#else
+        return common::VoidResult::err(error_info(monitoring_error_code::dependency_missing,
+            "prometheus_http_server requires epoll (Linux)", "monitoring_system").to_common_error());
+#endif
+    }
+
+    /**
+     * @brief Stop the I/O thread and close every socket
+     */
+    void stop() {
+#if defined(__linux__)
+        if (!running_.exchange(false)) {
+            return;
+        }
+        const std::uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(wake_fd_, &one, sizeof(one));
+        if (io_thread_.joinable()) {
+            io_thread_.join();
+        }
+        close_fds();
+#endif
+    }
+
+    bool is_running() const {
+        return running_.load();
+    }
+
+    /**
+     * @brief Port actually bound (resolves an ephemeral port request)
+     */
+    std::uint16_t port() const {
+        return bound_port_;
+    }
+
+    const prometheus_http_server_config& config() const {
+        return config_;
+    }
+
+    prometheus_http_server_stats get_stats() const {
+        prometheus_http_server_stats stats;
+        stats.connections_accepted = connections_accepted_.load(std::memory_order_relaxed);
+        stats.connections_rejected = connections_rejected_.load(std::memory_order_relaxed);
+        stats.active_connections = active_connections_.load(std::memory_order_relaxed);
+        stats.requests_served = requests_served_.load(std::memory_order_relaxed);
+        stats.scrapes_served = scrapes_served_.load(std::memory_order_relaxed);
+        stats.gzip_responses = gzip_responses_.load(std::memory_order_relaxed);
+        stats.bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+#if defined(__linux__)
+    struct connection {
+        int fd{-1};
+        std::string in;
+        std::string out;             ///< Unsent response bytes
+        std::size_t out_offset{0};
+        bool close_after_write{false};
+        bool want_write{false};
+        std::chrono::steady_clock::time_point last_activity;
+    };
+
+    struct request_head {
+        std::string_view method;
+        std::string_view target;
+        bool http10{false};
+        bool keep_alive{true};
+        bool accepts_gzip{false};
+        bool has_body{false};
+    };
+
+    static common::VoidResult socket_error(const char* what) {
+        return common::VoidResult::err(error_info(monitoring_error_code::network_error,
+            std::string(what) + ": " + std::strerror(errno), "monitoring_system").to_common_error());
+    }
+
+    common::VoidResult open_listener() {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.port);
+        const std::string host = config_.bind_address == "localhost" ? "127.0.0.1" : config_.bind_address;
+        if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Invalid bind address: " + config_.bind_address, "monitoring_system").to_common_error());
+        }
+
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            return socket_error("socket");
+        }
+        const int enable = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            return socket_error("bind");
+        }
+        if (::listen(listen_fd_, config_.listen_backlog) != 0) {
+            return socket_error("listen");
+        }
+
+        socklen_t length = sizeof(addr);
+        if (::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length) == 0) {
+            bound_port_ = ntohs(addr.sin_port);
+        }
+
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            return socket_error("epoll_create1");
+        }
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            return socket_error("eventfd");
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = listen_fd_;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) != 0) {
+            return socket_error("epoll_ctl");
+        }
+        event.data.fd = wake_fd_;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) != 0) {
+            return socket_error("epoll_ctl");
+        }
+        return common::ok();
+    }
+
+    void close_fds() {
+        for (auto& [fd, conn] : connections_) {
+            ::close(fd);
+        }
+        connections_.clear();
+        active_connections_.store(0, std::memory_order_relaxed);
+        for (int* fd : {&listen_fd_, &epoll_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    void run() {
+        std::vector<epoll_event> events(64);
+        const int tick_ms = static_cast<int>(std::clamp<std::int64_t>(
+            config_.idle_timeout.count() / 2, 10, 1000));
+
+        while (running_.load(std::memory_order_relaxed)) {
+            const int ready = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), tick_ms);
+            if (ready < 0 && errno != EINTR) {
+                break;
+            }
+
+            for (int i = 0; i < ready; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == wake_fd_) {
+                    return;
+                }
+                if (fd == listen_fd_) {
+                    accept_connections();
+                    continue;
+                }
+
+                auto it = connections_.find(fd);
+                if (it == connections_.end()) {
+                    continue;
+                }
+                auto& conn = it->second;
+                const auto flags = events[i].events;
+                bool alive = true;
+                if (flags & (EPOLLERR | EPOLLHUP)) {
+                    alive = false;
+                }
+                if (alive && (flags & EPOLLIN)) {
+                    alive = on_readable(conn);
+                }
+                if (alive && (flags & EPOLLOUT)) {
+                    alive = on_writable(conn);
+                }
+                if (!alive) {
+                    close_connection(fd);
+                }
+            }
+
+            close_idle_connections();
+        }
+    }
+
+    void accept_connections() {
+        while (true) {
+            const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;  // EAGAIN, or a transient error retried on the next wakeup
+            }
+            if (connections_.size() >= config_.max_connections) {
+                connections_rejected_.fetch_add(1, std::memory_order_relaxed);
+                ::close(fd);
+                continue;
+            }
+
+            const int enable = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.fd = fd;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+                ::close(fd);
+                continue;
+            }
+
+            auto& conn = connections_[fd];
+            conn.fd = fd;
+            conn.last_activity = std::chrono::steady_clock::now();
+            connections_accepted_.fetch_add(1, std::memory_order_relaxed);
+            active_connections_.store(connections_.size(), std::memory_order_relaxed);
+        }
+    }
+
+    void close_connection(int fd) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        connections_.erase(fd);
+        // Publish the count before the peer can observe the close
+        active_connections_.store(connections_.size(), std::memory_order_relaxed);
+        ::close(fd);
+    }
+
+    void close_idle_connections() {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<int> idle;
+        for (const auto& [fd, conn] : connections_) {
+            if (now - conn.last_activity > config_.idle_timeout) {
+                idle.push_back(fd);
+            }
+        }
+        for (int fd : idle) {
+            close_connection(fd);
+        }
+    }
+
+    /** @return false when the connection should be closed */
+    bool on_readable(connection& conn) {
+        if (conn.close_after_write || output_pending(conn)) {
+            return true;  // Not reading again until queued output drains
+        }
+
+        char chunk[16384];
+        bool peer_closed = false;
+        while (true) {
+            const ssize_t n = ::recv(conn.fd, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                conn.in.append(chunk, static_cast<std::size_t>(n));
+                if (conn.in.size() > config_.max_request_bytes * 4) {
+                    break;  // Process what we have before reading more
+                }
+                continue;
+            }
+            if (n == 0) {
+                peer_closed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+
+        conn.last_activity = std::chrono::steady_clock::now();
+        if (!serve_requests(conn)) {
+            return false;
+        }
+        // A half-closed peer still receives what it already asked for
+        return !(peer_closed && !output_pending(conn));
+    }
+
+    /** @return false when the connection should be closed */
+    bool on_writable(connection& conn) {
+        if (!flush_output(conn)) {
+            return false;
+        }
+        // Pipelined requests held back while the output queue drained
+        if (!output_pending(conn) && !conn.in.empty()) {
+            return serve_requests(conn);
+        }
+        return true;
+    }
+
+    static bool output_pending(const connection& conn) {
+        return conn.out_offset < conn.out.size();
+    }
+
+    /**
+     * @brief Answer buffered requests until they run out or output backs up
+     * @return false when the connection should be closed
+     */
+    bool serve_requests(connection& conn) {
+        while (process_requests(conn)) {
+            if (!flush_output(conn)) {
+                return false;
+            }
+            if (output_pending(conn)) {
+                return true;
+            }
+        }
+        return flush_output(conn);
+    }
+
+    /**
+     * @brief Answer complete requests in conn.in
+     * @return true when parsing stopped because a response is still queued
+     *
+     * A client that pipelines requests without reading the responses is
+     * throttled here: nothing further is parsed, and on_readable() reads
+     * nothing, until the queued bytes have been sent.
+     */
+    bool process_requests(connection& conn) {
+        std::size_t consumed = 0;
+        bool backed_up = false;
+        while (!conn.close_after_write) {
+            if (output_pending(conn)) {
+                backed_up = true;
+                break;
+            }
+            const auto end = conn.in.find("\r\n\r\n", consumed);
+            if (end == std::string::npos) {
+                if (conn.in.size() - consumed > config_.max_request_bytes) {
+                    respond_error(conn, 431, "Request Header Fields Too Large");
+                }
+                break;
+            }
+            if (end - consumed > config_.max_request_bytes) {
+                respond_error(conn, 431, "Request Header Fields Too Large");
+                break;
+            }
+
+            request_head head;
+            const std::string_view block(conn.in.data() + consumed, end - consumed);
+            consumed = end + 4;
+            if (!parse_head(block, head)) {
+                respond_error(conn, 400, "Bad Request");
+                break;
+            }
+            handle_request(conn, head);
+        }
+        if (conn.close_after_write) {
+            conn.in.clear();  // Nothing after the final response is answered
+            return false;
+        }
+        conn.in.erase(0, consumed);
+        return backed_up;
+    }
+
+    static bool iequals(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) !=
+                std::tolower(static_cast<unsigned char>(b[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    /** @brief Whether a comma-separated header lists @p token (q=0 excluded) */
+    static bool header_has_token(std::string_view value, std::string_view token) {
+        while (!value.empty()) {
+            const auto comma = value.find(',');
+            auto item = trim(value.substr(0, comma));
+            value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+
+            std::string_view params;
+            if (const auto semi = item.find(';'); semi != std::string_view::npos) {
+                params = item.substr(semi + 1);
+                item = trim(item.substr(0, semi));
+            }
+            if (!iequals(item, token) && item != "*") {
+                continue;
+            }
+            params = trim(params);
+            if (params.size() >= 2 && (params[0] == 'q' || params[0] == 'Q') && params[1] == '=') {
+                const auto q = trim(params.substr(2));
+                if (!q.empty() && q.find_first_not_of("0.") == std::string_view::npos) {
+                    continue;  // q=0 / q=0.000 refuses the coding
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    static bool parse_head(std::string_view block, request_head& head) {
+        auto line_end = block.find("\r\n");
+        const auto request_line = block.substr(0, line_end);
+        const auto sp1 = request_line.find(' ');
+        const auto sp2 = request_line.rfind(' ');
+        if (sp1 == std::string_view::npos || sp2 == sp1) {
+            return false;
+        }
+        head.method = request_line.substr(0, sp1);
+        head.target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+        const auto version = request_line.substr(sp2 + 1);
+        if (version == "HTTP/1.0") {
+            head.http10 = true;
+            head.keep_alive = false;
+        } else if (version != "HTTP/1.1") {
+            return false;
+        }
+
+        while (line_end != std::string_view::npos) {
+            const auto start = line_end + 2;
+            line_end = block.find("\r\n", start);
+            const auto line = block.substr(start, line_end == std::string_view::npos
+                                                      ? std::string_view::npos
+                                                      : line_end - start);
+            const auto colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                return false;
+            }
+            const auto name = line.substr(0, colon);
+            const auto value = trim(line.substr(colon + 1));
+            if (iequals(name, "connection")) {
+                if (header_has_token(value, "close")) {
+                    head.keep_alive = false;
+                } else if (header_has_token(value, "keep-alive")) {
+                    head.keep_alive = true;
+                }
+            } else if (iequals(name, "accept-encoding")) {
+                head.accepts_gzip = header_has_token(value, "gzip");
+            } else if (iequals(name, "content-length")) {
+                head.has_body = value != "0";
+            } else if (iequals(name, "transfer-encoding")) {
+                head.has_body = true;
+            }
+        }
+        return true;
+    }
+
+    void handle_request(connection& conn, const request_head& head) {
+        requests_served_.fetch_add(1, std::memory_order_relaxed);
+
+        const bool is_get = head.method == "GET";
+        const bool is_head = head.method == "HEAD";
+        if ((!is_get && !is_head) || head.has_body) {
+            // Request bodies are not read, so the stream cannot be reused
+            respond_error(conn, 405, "Method Not Allowed", "Allow: GET, HEAD\r\n");
+            return;
+        }
+
+        auto path = head.target;
+        if (const auto query = path.find('?'); query != std::string_view::npos) {
+            path = path.substr(0, query);
+        }
+        if (path != config_.path) {
+            respond(conn, 404, "Not Found", "text/plain; charset=utf-8", "Not Found\n",
+                    false, is_head, head.keep_alive);
+            return;
+        }
+
+        exporter_.write_metrics_text(body_);
+        scrapes_served_.fetch_add(1, std::memory_order_relaxed);
+
+        std::string_view body = body_;
+        bool gzipped = false;
+        if (head.accepts_gzip && config_.enable_gzip && body_.size() >= config_.gzip_min_bytes &&
+            gzip(body_, gzip_body_)) {
+            body = gzip_body_;
+            gzipped = true;
+            gzip_responses_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        respond(conn, 200, "OK", "text/plain; version=0.0.4; charset=utf-8", body,
+                gzipped, is_head, head.keep_alive);
+    }
+
+    void respond_error(connection& conn, int status, const char* reason,
+                       const char* extra_headers = "") {
+        std::string body = std::string(reason) + "\n";
+        respond(conn, status, reason, "text/plain; charset=utf-8", body, false, false, false,
+                extra_headers);
+    }
+
+    void respond(connection& conn, int status, const char* reason, const char* content_type,
+                 std::string_view body, bool gzipped, bool head_only, bool keep_alive,
+                 const char* extra_headers = "") {
+        header_.clear();
+        header_ += "HTTP/1.1 ";
+        header_ += std::to_string(status);
+        header_ += ' ';
+        header_ += reason;
+        header_ += "\r\nContent-Type: ";
+        header_ += content_type;
+        header_ += "\r\nContent-Length: ";
+        header_ += std::to_string(body.size());
+        header_ += "\r\n";
+        if (gzipped) {
+            header_ += "Content-Encoding: gzip\r\n";
+        }
+        if (config_.enable_gzip) {
+            header_ += "Vary: Accept-Encoding\r\n";
+        }
+        header_ += extra_headers;
+        header_ += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+        if (head_only) {
+            body = {};
+        }
+        if (!keep_alive) {
+            conn.close_after_write = true;
+        }
+
+        std::size_t sent = 0;
+        if (conn.out.size() == conn.out_offset) {
+            // Nothing queued: try to send straight from the render buffers
+            iovec parts[2] = {
+                {header_.data(), header_.size()},
+                {const_cast<char*>(body.data()), body.size()},
+            };
+            msghdr message{};
+            message.msg_iov = parts;
+            message.msg_iovlen = body.empty() ? 1 : 2;
+            const ssize_t n = ::sendmsg(conn.fd, &message, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent = static_cast<std::size_t>(n);
+                bytes_sent_.fetch_add(sent, std::memory_order_relaxed);
+            }
+            conn.out.clear();
+            conn.out_offset = 0;
+        }
+
+        // Queue whatever the socket did not take
+        if (sent < header_.size()) {
+            conn.out.append(header_, sent, std::string::npos);
+            conn.out.append(body);
+        } else if (sent - header_.size() < body.size()) {
+            conn.out.append(body.substr(sent - header_.size()));
+        }
+    }
+
+    /** @return false when the connection should be closed */
+    bool flush_output(connection& conn) {
+        while (conn.out_offset < conn.out.size()) {
+            const ssize_t n = ::send(conn.fd, conn.out.data() + conn.out_offset,
+                                     conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+            if (n > 0) {
+                conn.out_offset += static_cast<std::size_t>(n);
+                conn.last_activity = std::chrono::steady_clock::now();
+                bytes_sent_.fetch_add(static_cast<std::size_t>(n), std::memory_order_relaxed);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                set_want_write(conn, true);
+                return true;
+            }
+            return false;
+        }
+
+        conn.out.clear();
+        conn.out_offset = 0;
+        set_want_write(conn, false);
+        return !conn.close_after_write;
+    }
+
+    void set_want_write(connection& conn, bool want) {
+        if (conn.want_write == want) {
+            return;
+        }
+        // Reading is suspended while output is queued
+        epoll_event event{};
+        event.events = want ? EPOLLOUT : (EPOLLIN | EPOLLRDHUP);
+        event.data.fd = conn.fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &event);
+        conn.want_write = want;
+    }
+#endif
+
+    /** @brief gzip @p input into @p output; false if unavailable or failed */
+    bool gzip([[maybe_unused]] const std::string& input, [[maybe_unused]] std::string& output) {
+#ifdef MONITORING_HAS_ZLIB
+        if (!zlib_ready_) {
+            std::memset(&zstream_, 0, sizeof(zstream_));
+            // windowBits 15 + 16 selects the gzip wrapper
+            if (::deflateInit2(&zstream_, config_.gzip_level, Z_DEFLATED, 15 + 16, 8,
+                               Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            zlib_ready_ = true;
+        } else if (::deflateReset(&zstream_) != Z_OK) {
+            return false;
+        }
+
+        output.resize(::deflateBound(&zstream_, static_cast<uLong>(input.size())));
+        zstream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        zstream_.avail_in = static_cast<uInt>(input.size());
+        zstream_.next_out = reinterpret_cast<Bytef*>(output.data());
+        zstream_.avail_out = static_cast<uInt>(output.size());
+        if (::deflate(&zstream_, Z_FINISH) != Z_STREAM_END) {
+            return false;
+        }
+        output.resize(zstream_.total_out);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    const prometheus_exporter& exporter_;
+    prometheus_http_server_config config_;
+
+    std::atomic<bool> running_{false};
+    std::thread io_thread_;
+    std::uint16_t bound_port_{0};
+
+#if defined(__linux__)
+    int listen_fd_{-1};
+    int epoll_fd_{-1};
+    int wake_fd_{-1};
+    std::unordered_map<int, connection> connections_;
+#endif
+
+    // Owned by the I/O thread and reused across requests
+    std::string body_;
+    std::string gzip_body_;
+    std::string header_;
+#ifdef MONITORING_HAS_ZLIB
+    z_stream zstream_{};
+    bool zlib_ready_{false};
+#endif
+
+    std::atomic<std::size_t> connections_accepted_{0};
+    std::atomic<std::size_t> connections_rejected_{0};
+    std::atomic<std::size_t> active_connections_{0};
+    std::atomic<std::size_t> requests_served_{0};
+    std::atomic<std::size_t> scrapes_served_{0};
+    std::atomic<std::size_t> gzip_responses_{0};
+    std::atomic<std::size_t> bytes_sent_{0};
+};
+
+} } // namespace kcenon::monitoring
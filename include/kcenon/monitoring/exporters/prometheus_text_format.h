@@ -0,0 +1,181 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file prometheus_text_format.h
+ * @brief Name sanitizing and label escaping for the Prometheus text format
+ *
+ * Table-driven replacements for the regex-based helpers previously used by
+ * prometheus_exporter, producing byte-identical output:
+ * - Metric names: bytes outside [a-zA-Z0-9_:] become '_', and a leading
+ *   '_' is prepended unless the result starts with a letter or '_'
+ * - Label names: same, with ':' also replaced
+ * - Label values: '\\' -> "\\\\", '"' -> "\\\"", newline -> "\\n"
+ *
+ * The functions append into caller-owned strings and do not allocate once
+ * the destination has capacity.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+    #define PROMETHEUS_TEXT_SSE2 1
+#endif
+
+namespace kcenon { namespace monitoring {
+
+namespace detail {
+
+enum : std::uint8_t {
+    prom_label_char = 0x01,    ///< [a-zA-Z0-9_]
+    prom_metric_char = 0x02,   ///< [a-zA-Z0-9_:]
+    prom_leading_char = 0x04,  ///< [a-zA-Z_]
+    prom_escape_char = 0x08    ///< '\\', '"', '\n'
+};
+
+inline constexpr std::array<std::uint8_t, 256> prom_char_table = [] {
+    std::array<std::uint8_t, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        const bool digit = c >= '0' && c <= '9';
+        std::uint8_t bits = 0;
+        if (letter || digit || c == '_') {
+            bits |= prom_label_char | prom_metric_char;
+        }
+        if (c == ':') {
+            bits |= prom_metric_char;
+        }
+        if (letter || c == '_') {
+            bits |= prom_leading_char;
+        }
+        if (c == '\\' || c == '"' || c == '\n') {
+            bits |= prom_escape_char;
+        }
+        table[static_cast<std::size_t>(c)] = bits;
+    }
+    return table;
+}();
+
+inline std::uint8_t prom_char_class(char c) noexcept {
+    return prom_char_table[static_cast<unsigned char>(c)];
+}
+
+inline void prom_append_sanitized(std::string& out, std::string_view name, std::uint8_t valid) {
+    if (name.empty()) {
+        return;
+    }
+    const bool valid_first = (prom_char_class(name[0]) & valid) != 0;
+    // The first output byte is either the original (valid) byte or '_'
+    if (valid_first && (prom_char_class(name[0]) & prom_leading_char) == 0) {
+        out += '_';
+    }
+
+    const std::size_t start = out.size();
+    out.append(name);
+    for (std::size_t i = start; i < out.size(); ++i) {
+        if ((prom_char_class(out[i]) & valid) == 0) {
+            out[i] = '_';
+        }
+    }
+}
+
+inline bool prom_is_sanitized(std::string_view name, std::uint8_t valid) noexcept {
+    if (name.empty()) {
+        return true;
+    }
+    if ((prom_char_class(name[0]) & prom_leading_char) == 0) {
+        return false;
+    }
+    for (char c : name) {
+        if ((prom_char_class(c) & valid) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief Append the sanitized form of a metric name to @p out
+ */
+inline void prometheus_append_metric_name(std::string& out, std::string_view name) {
+    detail::prom_append_sanitized(out, name, detail::prom_metric_char);
+}
+
+/**
+ * @brief Append the sanitized form of a label name to @p out
+ */
+inline void prometheus_append_label_name(std::string& out, std::string_view name) {
+    detail::prom_append_sanitized(out, name, detail::prom_label_char);
+}
+
+inline std::string prometheus_sanitize_metric_name(std::string_view name) {
+    std::string out;
+    out.reserve(name.size() + 1);
+    prometheus_append_metric_name(out, name);
+    return out;
+}
+
+inline std::string prometheus_sanitize_label_name(std::string_view name) {
+    std::string out;
+    out.reserve(name.size() + 1);
+    prometheus_append_label_name(out, name);
+    return out;
+}
+
+/**
+ * @brief Offset of the first byte in @p value that needs escaping, or npos
+ *
+ * Scans 16 bytes at a time with SSE2 where available.
+ */
+inline std::size_t prometheus_find_label_escape(std::string_view value, std::size_t from = 0) noexcept {
+    std::size_t i = from;
+#if defined(PROMETHEUS_TEXT_SSE2)
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= value.size(); i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value.data() + i));
+        const __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, quote)),
+            _mm_cmpeq_epi8(chunk, newline));
+        const int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    for (; i < value.size(); ++i) {
+        if (detail::prom_char_class(value[i]) & detail::prom_escape_char) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+/**
+ * @brief Append @p value escaped for a quoted label value
+ */
+inline void prometheus_append_escaped_label_value(std::string& out, std::string_view value) {
+    std::size_t done = 0;
+    for (std::size_t pos = prometheus_find_label_escape(value); pos != std::string_view::npos;
+         pos = prometheus_find_label_escape(value, done)) {
+        out.append(value.data() + done, pos - done);
+        out += '\\';
+        out += value[pos] == '\n' ? 'n' : value[pos];
+        done = pos + 1;
+    }
+    out.append(value.data() + done, value.size() - done);
+}
+
+} } // namespace kcenon::monitoring
@@ -0,0 +1,721 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file shm_metric_transport.h
+ * @brief Shared-memory metric ring for out-of-process collection agents
+ *
+ * An instrumented process publishes fixed-layout metric records into a
+ * POSIX shared memory segment (shm_open, or memfd on Linux); a sidecar agent
+ * attaches to the same segment and reads them without any syscall or text
+ * serialization per sample.
+ *
+ * The segment holds a versioned header followed by a power-of-two array of
+ * cache-line sized slots. Like ring_buffer with overwrite_old, writers never
+ * wait for readers: they claim a sequence number and overwrite the oldest
+ * slot. Each slot is guarded by its own sequence word (a per-slot seqlock)
+ * that only ever increases, so any number of readers can follow the ring
+ * independently, each with a private cursor, and detect when they were
+ * lapped. A slot left mid-write (e.g. by a writer process that died) is
+ * waited on for at most stall_spin_limit yields by writers and readers,
+ * which then skip it.
+ *
+ * @code
+ * // Instrumented process
+ * auto writer = shm_metric_writer::create("/myservice_metrics").value();
+ * writer->write("http_requests_total", 1.0, metric_type::counter);
+ *
+ * // Agent process
+ * auto reader = shm_metric_reader::attach("/myservice_metrics").value();
+ * std::vector<shm_metric_record> records;
+ * reader->read_batch(records, 1024);
+ * @endcode
+ *
+ * @note Available on POSIX platforms. Elsewhere create()/attach() return
+ *       monitoring_error_code::system_resource_unavailable.
+ */
+
+#include "../core/result_types.h"
+#include "../core/error_codes.h"
+#include "../utils/metric_types.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MONITORING_HAS_POSIX_SHM 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @struct shm_metric_record
+ * @brief Fixed-layout metric sample exchanged through shared memory
+ *
+ * Trivially copyable and free of pointers so it means the same thing in
+ * every process mapping the segment. Names longer than max_name_length are
+ * truncated; name_hash is always computed from the full name.
+ */
+struct shm_metric_record {
+    static constexpr std::size_t max_name_length = 32;
+
+    uint64_t timestamp_ns{0};   ///< Nanoseconds since the system_clock epoch
+    double value{0.0};
+    uint32_t name_hash{0};      ///< hash_metric_name() of the full name
+    metric_type type{metric_type::gauge};
+    uint8_t name_length{0};
+    uint16_t reserved{0};
+    char name[max_name_length]{};
+
+    /**
+     * @brief Build a record stamped with the current time
+     */
+    static shm_metric_record make(std::string_view metric_name, double metric_value,
+                                  metric_type kind = metric_type::gauge) noexcept {
+        shm_metric_record record;
+        record.timestamp_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        record.value = metric_value;
+        record.name_hash = hash_metric_name(metric_name);
+        record.type = kind;
+        record.name_length = static_cast<uint8_t>(
+            (std::min)(metric_name.size(), max_name_length));
+        std::memcpy(record.name, metric_name.data(), record.name_length);
+        return record;
+    }
+
+    /**
+     * @brief Stored (possibly truncated) metric name
+     */
+    std::string_view get_name() const noexcept {
+        return std::string_view(name, name_length);
+    }
+
+    /**
+     * @brief Sample time as a time_point
+     */
+    std::chrono::system_clock::time_point get_timestamp() const noexcept {
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(timestamp_ns)));
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<shm_metric_record>,
+              "shm_metric_record must be trivially copyable");
+static_assert(sizeof(shm_metric_record) == 56, "shm_metric_record layout changed");
+
+namespace shm_layout {
+
+/// "KCMONSHM" in little-endian byte order
+inline constexpr uint64_t magic = 0x4d48534e4f4d434bULL;
+
+/// Bumped on any incompatible change to header, slot or record layout
+inline constexpr uint32_t version = 1;
+
+inline constexpr std::size_t record_words = sizeof(shm_metric_record) / sizeof(uint64_t);
+
+/// Yields a writer or reader spends on a slot that another writer has
+/// claimed but not yet published, before treating that writer as stalled
+inline constexpr unsigned stall_spin_limit = 256;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared-memory ring requires lock-free 64-bit atomics");
+
+/**
+ * @struct segment_header
+ * @brief Versioned header at offset 0 of the segment
+ *
+ * magic is published last by the writer, so a reader that attaches during
+ * initialization sees an invalid segment rather than a half-written one.
+ */
+struct alignas(64) segment_header {
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t slot_size;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint64_t creation_time_ns;
+    uint64_t writer_pid;
+    alignas(64) std::atomic<uint64_t> write_cursor;  ///< Next sequence to claim
+};
+
+/**
+ * @struct slot
+ * @brief One cache line: sequence word plus record payload
+ *
+ * sequence is 2 * seq + 1 while record seq is being written and
+ * 2 * seq + 2 once it is complete. Writers move it forward by CAS only, so
+ * it never drops below a value a reader has already observed.
+ */
+struct alignas(64) slot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> payload[record_words];
+};
+
+static_assert(sizeof(slot) == 64, "slot must occupy exactly one cache line");
+
+inline constexpr std::size_t header_size = sizeof(segment_header);
+
+inline std::size_t segment_size(std::size_t capacity) noexcept {
+    return header_size + capacity * sizeof(slot);
+}
+
+inline slot* slots(void* base) noexcept {
+    return reinterpret_cast<slot*>(static_cast<std::byte*>(base) + header_size);
+}
+
+inline std::string normalize_name(const std::string& name) {
+    return (!name.empty() && name.front() == '/') ? name : "/" + name;
+}
+
+} // namespace shm_layout
+
+/**
+ * @struct shm_ring_config
+ * @brief Configuration for a shared-memory metric ring
+ */
+struct shm_ring_config {
+    std::size_t capacity = 16384;   ///< Slots in the ring (power of 2)
+    bool replace_existing = true;   ///< Remove a stale segment with the same name
+    bool unlink_on_close = true;    ///< Remove the name when the writer is destroyed
+    unsigned int permissions = 0600;
+
+    /**
+     * @brief Validate configuration
+     */
+    common::VoidResult validate() const {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_capacity,
+                             "Shared-memory ring capacity must be a power of 2").to_common_error());
+        }
+        return common::ok();
+    }
+};
+
+/**
+ * @struct shm_reader_stats
+ * @brief Per-reader statistics
+ */
+struct shm_reader_stats {
+    std::size_t records_read{0};
+    std::size_t records_dropped{0};   ///< Records overwritten or abandoned before this reader got to them
+    std::size_t torn_reads{0};        ///< Slot reads retried because a writer raced the copy
+    std::size_t stalled_records{0};   ///< Dropped records whose writer stalled mid-copy
+};
+
+/**
+ * @enum shm_read_start
+ * @brief Where a newly attached reader starts
+ */
+enum class shm_read_start {
+    oldest,   ///< Oldest record still in the ring
+    latest    ///< Only records written after attaching
+};
+
+/**
+ * @class shm_metric_writer
+ * @brief Producer side of the shared-memory ring
+ *
+ * write() is safe to call from any number of threads and never waits for
+ * readers. The only wait is for another writer still copying into the slot
+ * it laps onto, bounded by shm_layout::stall_spin_limit yields; after that
+ * the record is dropped and counted in records_skipped(), so a writer
+ * process that died mid-copy cannot hang the others.
+ */
+class shm_metric_writer {
+public:
+    /**
+     * @brief Create a named segment (shm_open)
+     * @param name POSIX shared memory name; a leading '/' is added if missing
+     * @param config Ring configuration
+     */
+    static common::Result<std::unique_ptr<shm_metric_writer>> create(
+        const std::string& name, const shm_ring_config& config = {}) {
+        using result_type = common::Result<std::unique_ptr<shm_metric_writer>>;
+
+        auto validation = config.validate();
+        if (validation.is_err()) {
+            return result_type::err(validation.error());
+        }
+
+#ifdef MONITORING_HAS_POSIX_SHM
+        const std::string shm_name = shm_layout::normalize_name(name);
+        if (config.replace_existing) {
+            ::shm_unlink(shm_name.c_str());
+        }
+
+        int fd = ::shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR,
+                            static_cast<mode_t>(config.permissions));
+        if (fd < 0) {
+            return result_type::err(error_info(
+                errno == EACCES ? monitoring_error_code::permission_denied
+                                : monitoring_error_code::system_resource_unavailable,
+                "shm_open failed for " + shm_name + ": " + std::strerror(errno)).to_common_error());
+        }
+
+        auto writer = std::unique_ptr<shm_metric_writer>(new shm_metric_writer());
+        writer->fd_ = fd;
+        writer->name_ = shm_name;
+        writer->unlink_on_close_ = config.unlink_on_close;
+
+        auto init = writer->initialize(config.capacity);
+        if (init.is_err()) {
+            return result_type::err(init.error());
+        }
+        return common::ok(std::move(writer));
+#else
+        (void)name;
+        return result_type::err(error_info(monitoring_error_code::system_resource_unavailable,
+                         "Shared-memory transport requires POSIX shared memory").to_common_error());
+#endif
+    }
+
+#if defined(MONITORING_HAS_POSIX_SHM) && defined(__linux__)
+    /**
+     * @brief Create an anonymous segment backed by memfd_create
+     *
+     * The segment has no name; hand fd() to the agent (inheritance across
+     * fork/exec or SCM_RIGHTS) and attach with shm_metric_reader::attach_fd().
+     */
+    static common::Result<std::unique_ptr<shm_metric_writer>> create_anonymous(
+        const shm_ring_config& config = {}) {
+        using result_type = common::Result<std::unique_ptr<shm_metric_writer>>;
+
+        auto validation = config.validate();
+        if (validation.is_err()) {
+            return result_type::err(validation.error());
+        }
+
+        int fd = ::memfd_create("kcenon_monitoring_metrics", 0);
+        if (fd < 0) {
+            return result_type::err(error_info(monitoring_error_code::system_resource_unavailable,
+                             std::string("memfd_create failed: ") + std::strerror(errno)).to_common_error());
+        }
+
+        auto writer = std::unique_ptr<shm_metric_writer>(new shm_metric_writer());
+        writer->fd_ = fd;
+
+        auto init = writer->initialize(config.capacity);
+        if (init.is_err()) {
+            return result_type::err(init.error());
+        }
+        return common::ok(std::move(writer));
+    }
+#endif
+
+    ~shm_metric_writer() {
+#ifdef MONITORING_HAS_POSIX_SHM
+        if (base_ != nullptr) {
+            ::munmap(base_, size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        if (unlink_on_close_ && !name_.empty()) {
+            ::shm_unlink(name_.c_str());
+        }
+#endif
+    }
+
+    shm_metric_writer(const shm_metric_writer&) = delete;
+    shm_metric_writer& operator=(const shm_metric_writer&) = delete;
+
+    /**
+     * @brief Publish a record, overwriting the oldest one when the ring is full
+     *
+     * When writers lap each other on one slot, the newer record wins: a
+     * writer that finds a newer sequence already claimed skips the slot
+     * (the record counts as skipped), and one that finds an older record
+     * still being written waits for those few stores to finish. If they do
+     * not finish within stall_spin_limit yields, the older writer is taken
+     * to be stalled or dead and this record is skipped instead; the slot is
+     * left to its owner rather than overwritten under it.
+     */
+    void write(const shm_metric_record& record) noexcept {
+        uint64_t words[shm_layout::record_words];
+        std::memcpy(words, &record, sizeof(record));
+
+        const uint64_t seq = header()->write_cursor.fetch_add(1, std::memory_order_relaxed);
+        auto& target = slots_[seq & mask_];
+
+        const uint64_t writing = 2 * seq + 1;
+        uint64_t current = target.sequence.load(std::memory_order_relaxed);
+        unsigned spins = 0;
+        for (;;) {
+            if (current >= writing) {
+                records_skipped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if ((current & 1) != 0) {
+                // An older record is still being copied into this slot
+                if (++spins > shm_layout::stall_spin_limit) {
+                    records_skipped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                std::this_thread::yield();
+                current = target.sequence.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (target.sequence.compare_exchange_weak(current, writing,
+                                                      std::memory_order_relaxed,
+                                                      std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < shm_layout::record_words; ++i) {
+            target.payload[i].store(words[i], std::memory_order_relaxed);
+        }
+        target.sequence.store(2 * seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Publish a metric sample stamped with the current time
+     */
+    void write(std::string_view name, double value,
+               metric_type type = metric_type::gauge) noexcept {
+        write(shm_metric_record::make(name, value, type));
+    }
+
+    /**
+     * @brief Total records published since creation
+     */
+    uint64_t records_written() const noexcept {
+        return header()->write_cursor.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records dropped by this writer because a newer record had
+     *        already claimed their slot, or an older one stalled in it
+     */
+    uint64_t records_skipped() const noexcept {
+        return records_skipped_.load(std::memory_order_relaxed);
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    /**
+     * @brief Normalized segment name (empty for anonymous segments)
+     */
+    const std::string& name() const noexcept { return name_; }
+
+    /**
+     * @brief Descriptor of the segment, for handing to another process
+     */
+    int fd() const noexcept { return fd_; }
+
+private:
+    shm_metric_writer() = default;
+
+    shm_layout::segment_header* header() const noexcept {
+        return static_cast<shm_layout::segment_header*>(base_);
+    }
+
+#ifdef MONITORING_HAS_POSIX_SHM
+    common::VoidResult initialize(std::size_t capacity) {
+        size_ = shm_layout::segment_size(capacity);
+        if (::ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::memory_allocation_failed,
+                             std::string("ftruncate failed: ") + std::strerror(errno)).to_common_error());
+        }
+
+        void* base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED) {
+            return common::VoidResult::err(error_info(monitoring_error_code::memory_allocation_failed,
+                             std::string("mmap failed: ") + std::strerror(errno)).to_common_error());
+        }
+        base_ = base;
+        mask_ = capacity - 1;
+        slots_ = shm_layout::slots(base_);
+
+        // ftruncate zero-fills, so every slot sequence starts out as "never written"
+        auto* hdr = new (base_) shm_layout::segment_header{};
+        hdr->version = shm_layout::version;
+        hdr->header_size = static_cast<uint32_t>(shm_layout::header_size);
+        hdr->slot_size = static_cast<uint32_t>(sizeof(shm_layout::slot));
+        hdr->record_size = static_cast<uint32_t>(sizeof(shm_metric_record));
+        hdr->capacity = capacity;
+        hdr->creation_time_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        hdr->writer_pid = static_cast<uint64_t>(::getpid());
+        hdr->write_cursor.store(0, std::memory_order_relaxed);
+        hdr->magic.store(shm_layout::magic, std::memory_order_release);
+        return common::ok();
+    }
+#endif
+
+    int fd_{-1};
+    void* base_{nullptr};
+    std::size_t size_{0};
+    std::size_t mask_{0};
+    shm_layout::slot* slots_{nullptr};
+    std::string name_;
+    bool unlink_on_close_{false};
+    std::atomic<uint64_t> records_skipped_{0};
+};
+
+/**
+ * @class shm_metric_reader
+ * @brief Consumer side of the shared-memory ring
+ *
+ * Maps the segment read-only and keeps a private cursor, so readers never
+ * write to shared memory and cannot slow the producer down. A reader
+ * instance is meant for a single thread.
+ */
+class shm_metric_reader {
+public:
+    /**
+     * @brief Attach to a named segment
+     */
+    static common::Result<std::unique_ptr<shm_metric_reader>> attach(
+        const std::string& name, shm_read_start start = shm_read_start::oldest) {
+        using result_type = common::Result<std::unique_ptr<shm_metric_reader>>;
+
+#ifdef MONITORING_HAS_POSIX_SHM
+        const std::string shm_name = shm_layout::normalize_name(name);
+        int fd = ::shm_open(shm_name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return result_type::err(error_info(
+                errno == EACCES ? monitoring_error_code::permission_denied
+                                : monitoring_error_code::not_found,
+                "shm_open failed for " + shm_name + ": " + std::strerror(errno)).to_common_error());
+        }
+        auto result = attach_fd(fd, start);
+        ::close(fd);
+        return result;
+#else
+        (void)name;
+        (void)start;
+        return result_type::err(error_info(monitoring_error_code::system_resource_unavailable,
+                         "Shared-memory transport requires POSIX shared memory").to_common_error());
+#endif
+    }
+
+    /**
+     * @brief Attach to a segment through a descriptor (e.g. an inherited memfd)
+     *
+     * The descriptor is not retained and may be closed afterwards.
+     */
+    static common::Result<std::unique_ptr<shm_metric_reader>> attach_fd(
+        int fd, shm_read_start start = shm_read_start::oldest) {
+        using result_type = common::Result<std::unique_ptr<shm_metric_reader>>;
+
+#ifdef MONITORING_HAS_POSIX_SHM
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            return result_type::err(error_info(monitoring_error_code::system_resource_unavailable,
+                             std::string("fstat failed: ") + std::strerror(errno)).to_common_error());
+        }
+
+        const auto size = static_cast<std::size_t>(st.st_size);
+        if (size < shm_layout::header_size) {
+            return result_type::err(error_info(monitoring_error_code::storage_corrupted,
+                             "Shared-memory segment too small for header").to_common_error());
+        }
+
+        void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            return result_type::err(error_info(monitoring_error_code::memory_allocation_failed,
+                             std::string("mmap failed: ") + std::strerror(errno)).to_common_error());
+        }
+
+        auto reader = std::unique_ptr<shm_metric_reader>(new shm_metric_reader());
+        reader->base_ = base;
+        reader->size_ = size;
+
+        auto validation = reader->validate_layout();
+        if (validation.is_err()) {
+            return result_type::err(validation.error());
+        }
+
+        reader->slots_ = shm_layout::slots(base);
+        reader->mask_ = static_cast<std::size_t>(reader->header()->capacity) - 1;
+        const uint64_t written = reader->header()->write_cursor.load(std::memory_order_acquire);
+        if (start == shm_read_start::latest) {
+            reader->cursor_ = written;
+        } else {
+            reader->cursor_ = written > reader->capacity() ? written - reader->capacity() : 0;
+        }
+        return common::ok(std::move(reader));
+#else
+        (void)fd;
+        (void)start;
+        return result_type::err(error_info(monitoring_error_code::system_resource_unavailable,
+                         "Shared-memory transport requires POSIX shared memory").to_common_error());
+#endif
+    }
+
+    ~shm_metric_reader() {
+#ifdef MONITORING_HAS_POSIX_SHM
+        if (base_ != nullptr) {
+            ::munmap(base_, size_);
+        }
+#endif
+    }
+
+    shm_metric_reader(const shm_metric_reader&) = delete;
+    shm_metric_reader& operator=(const shm_metric_reader&) = delete;
+
+    /**
+     * @brief Read the next record
+     * @return Result indicating success, or storage_empty when caught up
+     */
+    common::VoidResult read(shm_metric_record& record) {
+        if (!try_read(record)) {
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_empty,
+                             "No new records in shared-memory ring").to_common_error());
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Read up to @p max_count records in publication order
+     * @param records Vector the records are appended to
+     * @param max_count Maximum number of records to read
+     * @return Number of records read
+     */
+    std::size_t read_batch(std::vector<shm_metric_record>& records, std::size_t max_count) {
+        std::size_t count = 0;
+        shm_metric_record record;
+        while (count < max_count && try_read(record)) {
+            records.push_back(record);
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Records published but not yet read by this reader
+     *
+     * Can exceed capacity() when the reader has fallen behind; the excess
+     * is reported as dropped on the next read.
+     */
+    uint64_t backlog() const noexcept {
+        const uint64_t written = header()->write_cursor.load(std::memory_order_acquire);
+        return written > cursor_ ? written - cursor_ : 0;
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    uint32_t layout_version() const noexcept { return header()->version; }
+
+    uint64_t writer_pid() const noexcept { return header()->writer_pid; }
+
+    const shm_reader_stats& get_stats() const noexcept { return stats_; }
+
+private:
+    shm_metric_reader() = default;
+
+    const shm_layout::segment_header* header() const noexcept {
+        return static_cast<const shm_layout::segment_header*>(base_);
+    }
+
+    common::VoidResult validate_layout() const {
+        const auto* hdr = header();
+        if (hdr->magic.load(std::memory_order_acquire) != shm_layout::magic) {
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_corrupted,
+                             "Not a metric ring segment or not initialized yet").to_common_error());
+        }
+        if (hdr->version != shm_layout::version) {
+            return common::VoidResult::err(error_info(monitoring_error_code::incompatible_version,
+                             "Shared-memory layout version " + std::to_string(hdr->version) +
+                             " is not supported (expected " +
+                             std::to_string(shm_layout::version) + ")").to_common_error());
+        }
+        if (hdr->header_size != shm_layout::header_size ||
+            hdr->slot_size != sizeof(shm_layout::slot) ||
+            hdr->record_size != sizeof(shm_metric_record)) {
+            return common::VoidResult::err(error_info(monitoring_error_code::incompatible_version,
+                             "Shared-memory slot layout mismatch").to_common_error());
+        }
+        const auto capacity = hdr->capacity;
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0 ||
+            shm_layout::segment_size(static_cast<std::size_t>(capacity)) > size_) {
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_corrupted,
+                             "Shared-memory segment size does not match its header").to_common_error());
+        }
+        return common::ok();
+    }
+
+    bool try_read(shm_metric_record& record) noexcept {
+        unsigned spins = 0;
+        for (;;) {
+            const auto& source = slots_[cursor_ & mask_];
+            const uint64_t expected = 2 * cursor_ + 2;
+
+            const uint64_t before = source.sequence.load(std::memory_order_acquire);
+            if (before < expected) {
+                if (cursor_ >= header()->write_cursor.load(std::memory_order_acquire)) {
+                    // Not claimed by any writer yet
+                    return false;
+                }
+                // Claimed but not published: wait for the writer, within the
+                // same bound writers use, then give the record up
+                if (++spins <= shm_layout::stall_spin_limit) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                spins = 0;
+                ++cursor_;
+                ++stats_.records_dropped;
+                ++stats_.stalled_records;
+                continue;
+            }
+
+            if (before == expected) {
+                uint64_t words[shm_layout::record_words];
+                for (std::size_t i = 0; i < shm_layout::record_words; ++i) {
+                    words[i] = source.payload[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (source.sequence.load(std::memory_order_relaxed) == expected) {
+                    std::memcpy(&record, words, sizeof(record));
+                    ++cursor_;
+                    ++stats_.records_read;
+                    return true;
+                }
+                ++stats_.torn_reads;
+            }
+
+            // The writer lapped this reader: skip to the oldest record still present
+            const uint64_t written = header()->write_cursor.load(std::memory_order_acquire);
+            const uint64_t oldest = written > capacity() ? written - capacity() : 0;
+            const uint64_t resume = (std::max)(oldest, cursor_ + 1);
+            stats_.records_dropped += static_cast<std::size_t>(resume - cursor_);
+            cursor_ = resume;
+            spins = 0;
+        }
+    }
+
+    void* base_{nullptr};
+    std::size_t size_{0};
+    std::size_t mask_{0};
+    const shm_layout::slot* slots_{nullptr};
+    uint64_t cursor_{0};
+    shm_reader_stats stats_;
+};
+
+} } // namespace kcenon::monitoring
@@ -22,6 +22,17 @@
 #include <memory>
 #include <atomic>
 #include <span>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <array>
+    #include <cerrno>
+    #include <cstring>
+    #include <netdb.h>
+    #include <sys/socket.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+#endif
 
 namespace kcenon { namespace monitoring {
 
@@ -82,6 +93,28 @@ public:
             data.size()));
     }
 
+    /**
+     * @brief Send several datagrams to the connected endpoint
+     *
+     * Each span is delivered as its own datagram. The default implementation
+     * calls send() once per datagram; transports that can submit a batch in
+     * a single system call override it. All datagrams are attempted even if
+     * one fails.
+     *
+     * @param datagrams Datagram payloads, in send order
+     * @return common::VoidResult holding the first failure, if any
+     */
+    virtual common::VoidResult send_batch(std::span<const std::span<const uint8_t>> datagrams) {
+        common::VoidResult first = common::ok();
+        for (const auto& datagram : datagrams) {
+            auto result = send(datagram);
+            if (result.is_err() && first.is_ok()) {
+                first = std::move(result);
+            }
+        }
+        return first;
+    }
+
     /**
      * @brief Check if connected to an endpoint
      * @return true if connected
@@ -222,6 +255,209 @@ public:
     uint16_t get_port() const { return port_; }
 };
 
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @class socket_udp_transport
+ * @brief UDP transport over a connected BSD datagram socket
+ *
+ * On Linux, send_batch() hands up to @c max_batch datagrams to the kernel
+ * per sendmmsg() call; elsewhere it sends them one at a time. The transport
+ * is not internally synchronized; callers serialize sends.
+ */
+class socket_udp_transport : public udp_transport {
+public:
+    /// Datagrams submitted per sendmmsg() call
+    static constexpr std::size_t max_batch = 64;
+
+    socket_udp_transport() = default;
+
+    ~socket_udp_transport() override {
+        disconnect();
+    }
+
+    socket_udp_transport(const socket_udp_transport&) = delete;
+    socket_udp_transport& operator=(const socket_udp_transport&) = delete;
+
+    using udp_transport::send;
+
+    common::VoidResult connect(const std::string& host, uint16_t port) override {
+        disconnect();
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_flags = AI_NUMERICSERV;
+
+        addrinfo* resolved = nullptr;
+        const std::string service = std::to_string(port);
+        const int rc = ::getaddrinfo(host.c_str(), service.c_str(), &hints, &resolved);
+        if (rc != 0) {
+            return common::VoidResult::err(error_info(
+                monitoring_error_code::network_error,
+                "Failed to resolve " + host + ": " + ::gai_strerror(rc),
+                "socket_udp_transport"
+            ).to_common_error());
+        }
+
+        int last_errno = 0;
+        for (addrinfo* ai = resolved; ai != nullptr; ai = ai->ai_next) {
+            const int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                last_errno = errno;
+                continue;
+            }
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                fd_ = fd;
+                break;
+            }
+            last_errno = errno;
+            ::close(fd);
+        }
+        ::freeaddrinfo(resolved);
+
+        if (fd_ < 0) {
+            return common::VoidResult::err(error_info(
+                monitoring_error_code::network_error,
+                "Failed to connect UDP socket to " + host + ": " + std::strerror(last_errno),
+                "socket_udp_transport"
+            ).to_common_error());
+        }
+        return common::ok();
+    }
+
+    common::VoidResult send(std::span<const uint8_t> data) override {
+        if (fd_ < 0) {
+            send_failures_.fetch_add(1, std::memory_order_relaxed);
+            return not_connected();
+        }
+
+        ssize_t sent;
+        do {
+            sent = ::send(fd_, data.data(), data.size(), send_flags);
+        } while (sent < 0 && errno == EINTR);
+
+        if (sent < 0) {
+            send_failures_.fetch_add(1, std::memory_order_relaxed);
+            return send_error(errno);
+        }
+        packets_sent_.fetch_add(1, std::memory_order_relaxed);
+        bytes_sent_.fetch_add(static_cast<std::size_t>(sent), std::memory_order_relaxed);
+        return common::ok();
+    }
+
+#if defined(__linux__)
+    common::VoidResult send_batch(std::span<const std::span<const uint8_t>> datagrams) override {
+        if (fd_ < 0) {
+            send_failures_.fetch_add(datagrams.size(), std::memory_order_relaxed);
+            return not_connected();
+        }
+
+        std::array<mmsghdr, max_batch> headers;
+        std::array<iovec, max_batch> vectors;
+        common::VoidResult first = common::ok();
+
+        std::size_t next = 0;
+        while (next < datagrams.size()) {
+            const std::size_t count = std::min(max_batch, datagrams.size() - next);
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto& datagram = datagrams[next + i];
+                vectors[i].iov_base = const_cast<uint8_t*>(datagram.data());
+                vectors[i].iov_len = datagram.size();
+                headers[i] = mmsghdr{};
+                headers[i].msg_hdr.msg_iov = &vectors[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            const int sent = ::sendmmsg(fd_, headers.data(), static_cast<unsigned int>(count),
+                                        send_flags);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // The datagram at the head of the batch could not be sent;
+                // record it and carry on with the rest.
+                send_failures_.fetch_add(1, std::memory_order_relaxed);
+                if (first.is_ok()) {
+                    first = send_error(errno);
+                }
+                ++next;
+                continue;
+            }
+
+            for (int i = 0; i < sent; ++i) {
+                bytes_sent_.fetch_add(headers[static_cast<std::size_t>(i)].msg_len,
+                                      std::memory_order_relaxed);
+            }
+            packets_sent_.fetch_add(static_cast<std::size_t>(sent), std::memory_order_relaxed);
+            next += static_cast<std::size_t>(sent);
+        }
+        return first;
+    }
+#endif
+
+    bool is_connected() const override {
+        return fd_ >= 0;
+    }
+
+    void disconnect() override {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    bool is_available() const override {
+        return true;
+    }
+
+    std::string name() const override {
+        return "socket";
+    }
+
+    udp_statistics get_statistics() const override {
+        return {
+            packets_sent_.load(std::memory_order_relaxed),
+            bytes_sent_.load(std::memory_order_relaxed),
+            send_failures_.load(std::memory_order_relaxed)
+        };
+    }
+
+    void reset_statistics() override {
+        packets_sent_.store(0, std::memory_order_relaxed);
+        bytes_sent_.store(0, std::memory_order_relaxed);
+        send_failures_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+#if defined(MSG_NOSIGNAL)
+    static constexpr int send_flags = MSG_NOSIGNAL;
+#else
+    static constexpr int send_flags = 0;
+#endif
+
+    static common::VoidResult not_connected() {
+        return common::VoidResult::err(error_info(
+            monitoring_error_code::network_error,
+            "Not connected",
+            "socket_udp_transport"
+        ).to_common_error());
+    }
+
+    static common::VoidResult send_error(int err) {
+        return common::VoidResult::err(error_info(
+            monitoring_error_code::network_error,
+            std::string("UDP send failed: ") + std::strerror(err),
+            "socket_udp_transport"
+        ).to_common_error());
+    }
+
+    int fd_{-1};
+    std::atomic<std::size_t> packets_sent_{0};
+    std::atomic<std::size_t> bytes_sent_{0};
+    std::atomic<std::size_t> send_failures_{0};
+};
+#endif // __unix__ || __APPLE__
+
 } } // namespace kcenon::monitoring
 
 #ifdef MONITORING_HAS_COMMON_TRANSPORT_INTERFACES
@@ -459,12 +695,15 @@ namespace kcenon { namespace monitoring {
 /**
  * @brief Create default UDP transport
  *
- * Returns a network_system-based transport if available,
- * common_system transport if available, otherwise falls back
- * to a stub implementation.
+ * Returns a native socket transport on POSIX systems, whose send_batch()
+ * submits packed datagrams with sendmmsg() on Linux; elsewhere a
+ * network_system-based transport if available, otherwise a stub
+ * implementation.
  */
 inline std::unique_ptr<udp_transport> create_default_udp_transport() {
-#ifdef MONITORING_HAS_NETWORK_SYSTEM
+#if defined(__unix__) || defined(__APPLE__)
+    return std::make_unique<socket_udp_transport>();
+#elif defined(MONITORING_HAS_NETWORK_SYSTEM)
     return std::make_unique<network_udp_transport>();
 #else
     return std::make_unique<stub_udp_transport>();
@@ -478,6 +717,15 @@ inline std::unique_ptr<stub_udp_transport> create_stub_udp_transport() {
     return std::make_unique<stub_udp_transport>();
 }
 
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @brief Create a UDP transport backed by a native datagram socket
+ */
+inline std::unique_ptr<socket_udp_transport> create_socket_udp_transport() {
+    return std::make_unique<socket_udp_transport>();
+}
+#endif
+
 #ifdef MONITORING_HAS_COMMON_TRANSPORT_INTERFACES
 /**
  * @brief Create common_system-based UDP transport
@@ -22,6 +22,7 @@
 
 #include "../core/result_types.h"
 #include "../core/error_codes.h"
+#include "../core/collection_arena.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -106,6 +107,43 @@ struct metrics_snapshot {
     }
 };
 
+/**
+ * @brief Copy an arena snapshot into heap-owned storage
+ *
+ * Use when a snapshot has to outlive its collection cycle, e.g. for
+ * history buffers or exporters that queue data asynchronously.
+ */
+inline metrics_snapshot materialize(const arena_metrics_snapshot& source) {
+    metrics_snapshot snapshot;
+    snapshot.capture_time = source.capture_time;
+    snapshot.source_id = source.source_id;
+    snapshot.metrics.reserve(source.metrics.size());
+    for (const auto& m : source.metrics) {
+        metric_value mv(std::string(m.name), m.value);
+        mv.timestamp = m.timestamp;
+        for (const auto& [key, tag_value] : m.tags) {
+            mv.tags.emplace(key, tag_value);
+        }
+        snapshot.metrics.push_back(std::move(mv));
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Append a heap snapshot's metrics to an arena snapshot
+ */
+inline void append_to(const metrics_snapshot& source, arena_metrics_snapshot& target) {
+    target.capture_time = source.capture_time;
+    if (target.source_id.empty()) {
+        target.source_id = source.source_id;
+    }
+    target.reserve(target.metrics.size() + source.metrics.size());
+    for (const auto& m : source.metrics) {
+        auto& mv = target.add_metric(m.name, m.value, m.tags);
+        mv.timestamp = m.timestamp;
+    }
+}
+
 /**
  * @enum health_status
  * @brief System health status levels
@@ -344,6 +382,24 @@ public:
      */
     virtual common::Result<metrics_snapshot> collect() = 0;
 
+    /**
+     * @brief Collect metrics into a cycle-scoped arena snapshot
+     *
+     * The default implementation copies the result of collect(). Collectors
+     * on the hot path override this to write straight into arena storage.
+     *
+     * @param snapshot Arena snapshot of the running collection cycle
+     * @return Result indicating success or error
+     */
+    virtual common::VoidResult collect_into(arena_metrics_snapshot& snapshot) {
+        auto result = collect();
+        if (result.is_err()) {
+            return common::VoidResult::err(result.error());
+        }
+        append_to(result.value(), snapshot);
+        return common::ok();
+    }
+
     /**
      * @brief Get collector name
      * @return Collector identifier
@@ -6,16 +6,24 @@
  * @file memory_pool.h
  * @brief Platform-specific aligned memory allocation pool for monitoring objects.
  *
+ * Provides a fixed-size block pool with a lock-free free list and optional
+ * per-thread magazines, a size-classed pool built on top of it, and a
+ * std::pmr::memory_resource adapter so pmr containers can allocate from it.
  */
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <new>
+#include <stdexcept>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -65,11 +73,12 @@ namespace kcenon::monitoring {
  * @brief Configuration for memory pool
  */
 struct memory_pool_config {
-    size_t initial_blocks = 256;       ///< Initial number of blocks
-    size_t max_blocks = 4096;          ///< Maximum number of blocks (0 = unlimited)
+    size_t initial_blocks = 256;       ///< Initial number of blocks (rounded up to fill a chunk)
+    size_t max_blocks = 4096;          ///< Maximum number of blocks (0 = unlimited up to 2^32 - 1)
     size_t block_size = 64;            ///< Size of each block in bytes
     size_t alignment = 8;              ///< Memory alignment (must be power of 2)
     bool use_thread_local_cache = false; ///< Use thread-local caching
+    size_t thread_cache_size = 32;     ///< Blocks held per thread magazine when caching
 
     /**
      * @brief Validate configuration
@@ -93,6 +102,10 @@ struct memory_pool_config {
         if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
             return false;
         }
+        // A magazine needs room to keep half its blocks after a flush
+        if (use_thread_local_cache && thread_cache_size < 2) {
+            return false;
+        }
         return true;
     }
 };
@@ -162,88 +175,698 @@ struct memory_pool_statistics {
     }
 };
 
+namespace detail {
+
+/// Threads beyond this many share one uncached fallback slot
+inline constexpr size_t max_thread_slots = 256;
+
+/// Chunk slots reserved up front by pools configured with max_blocks = 0
+inline constexpr size_t initial_directory_slots = 16;
+
 /**
- * @brief Thread-safe fixed-size block memory allocator
+ * @brief Interface for pools that park blocks in per-thread magazines
  *
- * This pool pre-allocates memory blocks of fixed size for efficient
- * allocation/deallocation without heap fragmentation.
+ * A magazine is only ever touched by the thread that leases its slot, so
+ * the blocks it holds must be handed back by that thread before it exits.
  */
-class memory_pool {
+class thread_cache_owner {
 public:
+    virtual ~thread_cache_owner() = default;
+
     /**
-     * @brief Default constructor with default configuration
+     * @brief Return every block cached for @p slot to the shared depot
+     * @param slot Slot being released by the exiting thread
      */
-    memory_pool() : memory_pool(memory_pool_config{}) {}
+    virtual void flush_thread_cache(size_t slot) = 0;
+};
+
+/**
+ * @brief Process-wide registry of thread slots and caching pools
+ *
+ * Threads lease a small integer slot on their first pool operation and
+ * release it on exit, flushing their magazines into every live pool first.
+ * The mutex is only taken on thread start/exit and pool construction or
+ * destruction, never on the allocation path.
+ */
+class thread_cache_registry {
+public:
+    static thread_cache_registry& instance() {
+        static thread_cache_registry registry;
+        return registry;
+    }
+
+    void register_owner(thread_cache_owner* owner) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        owners_.push_back(owner);
+    }
+
+    void unregister_owner(thread_cache_owner* owner) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        owners_.erase(std::remove(owners_.begin(), owners_.end(), owner), owners_.end());
+    }
 
     /**
-     * @brief Construct with configuration
-     * @param config Pool configuration
+     * @brief Lease a slot for the calling thread
+     * @return Slot index, or max_thread_slots when every slot is taken
      */
-    explicit memory_pool(const memory_pool_config& config)
+    size_t acquire_slot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_slots_.empty()) {
+            size_t slot = free_slots_.back();
+            free_slots_.pop_back();
+            return slot;
+        }
+        if (next_slot_ < max_thread_slots) {
+            return next_slot_++;
+        }
+        return max_thread_slots;
+    }
+
+    /**
+     * @brief Flush the slot's magazines into all live pools and recycle it
+     * @param slot Slot leased by the exiting thread
+     */
+    void release_slot(size_t slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto* owner : owners_) {
+            owner->flush_thread_cache(slot);
+        }
+        free_slots_.push_back(slot);
+    }
+
+private:
+    thread_cache_registry() = default;
+
+    std::mutex mutex_;
+    std::vector<thread_cache_owner*> owners_;
+    std::vector<size_t> free_slots_;
+    size_t next_slot_ = 0;
+};
+
+/**
+ * @brief Slot leased by the calling thread
+ * @return Slot index, or max_thread_slots for threads sharing the fallback slot
+ */
+inline size_t current_thread_slot() {
+    struct slot_lease {
+        size_t slot;
+
+        slot_lease() : slot(thread_cache_registry::instance().acquire_slot()) {}
+
+        ~slot_lease() {
+            if (slot < max_thread_slots) {
+                thread_cache_registry::instance().release_slot(slot);
+            }
+        }
+    };
+
+    thread_local slot_lease lease;
+    return lease.slot;
+}
+
+/**
+ * @brief Fixed-size block allocator with a lock-free depot and thread magazines
+ *
+ * Memory is carved from chunks that are aligned to their own power-of-two
+ * span, so the owning chunk of any pointer is found by masking the address
+ * and probing a small open-addressing table. Free blocks form an intrusive
+ * Treiber stack (the "depot") whose head packs a 32-bit block id with an
+ * ABA tag. With thread caching enabled each thread allocates from and frees
+ * into a private magazine and only reaches the depot in batches of half a
+ * magazine. Growth is the only operation that takes a lock.
+ *
+ * Unbounded pools keep growing until the 32-bit block id space is used up;
+ * their chunk directory doubles whenever it fills.
+ */
+class fixed_block_pool final : public thread_cache_owner {
+public:
+    explicit fixed_block_pool(const memory_pool_config& config)
         : config_(config)
         , block_size_(config.block_size)
-        , total_blocks_(config.initial_blocks) {
-        initialize_pool();
+        , cache_capacity_(config.use_thread_local_cache ? config.thread_cache_size : 0) {
+        if (block_size_ < sizeof(std::uint32_t) || config.initial_blocks == 0) {
+            throw std::bad_alloc();
+        }
+
+        // Chunk bases are aligned to their span, so a stride that is a
+        // multiple of the alignment aligns every block. Each chunk holds as
+        // many blocks as fit its power-of-two span, rather than leaving the
+        // rounding slack unused.
+        block_stride_ = (block_size_ + config.alignment - 1) & ~(config.alignment - 1);
+        chunk_span_ = std::bit_ceil(std::max({config.initial_blocks * block_stride_,
+                                              config.alignment, size_t{64}}));
+        blocks_per_chunk_ = chunk_span_ / block_stride_;
+        index_bits_ = static_cast<unsigned>(std::bit_width(blocks_per_chunk_ - 1));
+        if (std::has_single_bit(block_stride_)) {
+            block_shift_ = static_cast<unsigned>(std::countr_zero(block_stride_));
+        }
+        if (index_bits_ >= 32) {
+            throw std::bad_alloc();
+        }
+
+        // Block ids are 32-bit (chunk << index_bits | index) + 1, with 0 meaning "none"
+        size_t id_chunk_limit = (size_t{1} << (32 - index_bits_)) - 1;
+        max_chunks_ = config.max_blocks > 0
+            ? std::min((config.max_blocks + blocks_per_chunk_ - 1) / blocks_per_chunk_, id_chunk_limit)
+            : id_chunk_limit;
+
+        size_t slots = config.max_blocks > 0 ? max_chunks_ : std::min(initial_directory_slots, max_chunks_);
+        directories_.push_back(std::make_unique<chunk_directory>(slots));
+        directory_.store(directories_.back().get(), std::memory_order_release);
+
+        slots_ = std::make_unique<std::atomic<slot_state*>[]>(max_thread_slots + 1);
+        auto* fallback = new slot_state();
+        fallback->shared = true;
+        slots_[max_thread_slots].store(fallback, std::memory_order_relaxed);
+
+        size_t first_blocks = config.max_blocks > 0 ? std::min(blocks_per_chunk_, config.max_blocks)
+                                                     : blocks_per_chunk_;
+        if (!add_chunk(first_blocks)) {
+            release_memory();
+            throw std::bad_alloc();
+        }
+
+        if (cache_capacity_ > 0) {
+            thread_cache_registry::instance().register_owner(this);
+        }
     }
 
-    ~memory_pool() {
-        for (auto* chunk : memory_chunks_) {
-            detail::aligned_free_impl(chunk);
+    ~fixed_block_pool() override {
+        if (cache_capacity_ > 0) {
+            thread_cache_registry::instance().unregister_owner(this);
         }
+        release_memory();
     }
 
-    // Disable copy
-    memory_pool(const memory_pool&) = delete;
-    memory_pool& operator=(const memory_pool&) = delete;
+    fixed_block_pool(const fixed_block_pool&) = delete;
+    fixed_block_pool& operator=(const fixed_block_pool&) = delete;
+
+    /**
+     * @brief Allocate one block
+     * @return Block address, or nullptr when the pool is exhausted
+     */
+    void* allocate() {
+        slot_state& slot = local_slot();
+        std::uint32_t id = 0;
+
+        if (slot.magazine) {
+            if (slot.count == 0) {
+                slot.count = acquire_from_depot(cache_capacity_ / 2, slot.magazine.get());
+            }
+            if (slot.count > 0) {
+                id = slot.magazine[--slot.count];
+                slot.cached.store(slot.count, std::memory_order_relaxed);
+            }
+        } else {
+            acquire_from_depot(1, &id);
+        }
 
-    // Enable move
-    memory_pool(memory_pool&& other) noexcept
-        : config_(other.config_)
-        , block_size_(other.block_size_)
-        , total_blocks_(other.total_blocks_)
-        , free_blocks_(std::move(other.free_blocks_))
-        , memory_chunks_(std::move(other.memory_chunks_))
-        , stats_(std::move(other.stats_)) {
-        other.total_blocks_ = 0;
+        if (id == 0) {
+            stats_.allocation_failures.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        slot.count_allocation();
+        return block_address(id);
     }
 
-    memory_pool& operator=(memory_pool&& other) noexcept {
-        if (this != &other) {
-            for (auto* chunk : memory_chunks_) {
-                detail::aligned_free_impl(chunk);
+    /**
+     * @brief Return a block to the pool
+     * @param ptr Block previously returned by allocate()
+     * @return false if the pointer does not address a block of this pool
+     */
+    bool deallocate(void* ptr) {
+        std::uint32_t id = block_id(ptr);
+        if (id == 0) {
+            return false;
+        }
+
+        slot_state& slot = local_slot();
+        if (slot.magazine) {
+            if (slot.count == cache_capacity_) {
+                flush_magazine(slot, cache_capacity_ / 2);
             }
-            config_ = other.config_;
-            block_size_ = other.block_size_;
-            total_blocks_ = other.total_blocks_;
-            free_blocks_ = std::move(other.free_blocks_);
-            memory_chunks_ = std::move(other.memory_chunks_);
-            stats_ = std::move(other.stats_);
-            other.total_blocks_ = 0;
+            slot.magazine[slot.count++] = id;
+            slot.cached.store(slot.count, std::memory_order_relaxed);
+        } else {
+            push_chain(&id, 1);
         }
-        return *this;
+
+        slot.count_deallocation();
+        return true;
     }
 
     /**
-     * @brief Allocate a memory block
-     * @return common::Result<void*> containing pointer to allocated block
+     * @brief O(1) ownership check via chunk alignment
      */
-    common::Result<void*> allocate() {
-        std::lock_guard<std::mutex> lock(mutex_);
+    bool owns(const void* ptr) const {
+        return block_id(ptr) != 0;
+    }
+
+    size_t available_blocks() const {
+        size_t available = depot_free_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < max_thread_slots; ++i) {
+            if (auto* slot = slots_[i].load(std::memory_order_acquire)) {
+                available += slot->cached.load(std::memory_order_relaxed);
+            }
+        }
+        return std::min(available, total_blocks());
+    }
+
+    size_t total_blocks() const {
+        return total_blocks_.load(std::memory_order_relaxed);
+    }
+
+    size_t block_size() const {
+        return block_size_;
+    }
+
+    /**
+     * @brief Fold the per-thread counters into the shared statistics
+     */
+    const memory_pool_statistics& get_statistics() const {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        for (size_t i = 0; i <= max_thread_slots; ++i) {
+            if (auto* slot = slots_[i].load(std::memory_order_acquire)) {
+                allocations += slot->allocations.load(std::memory_order_relaxed);
+                deallocations += slot->deallocations.load(std::memory_order_relaxed);
+            }
+        }
+        stats_.total_allocations.store(allocations);
+        stats_.total_deallocations.store(deallocations);
+        return stats_;
+    }
+
+    void reset_statistics() {
+        for (size_t i = 0; i <= max_thread_slots; ++i) {
+            if (auto* slot = slots_[i].load(std::memory_order_acquire)) {
+                slot->allocations.store(0, std::memory_order_relaxed);
+                slot->deallocations.store(0, std::memory_order_relaxed);
+            }
+        }
+        stats_.reset();
+    }
+
+    void flush_thread_cache(size_t slot_index) override {
+        if (auto* slot = slots_[slot_index].load(std::memory_order_acquire)) {
+            if (slot->magazine && slot->count > 0) {
+                flush_magazine(*slot, slot->count);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) slot_state {
+        std::atomic<size_t> allocations{0};
+        std::atomic<size_t> deallocations{0};
+        std::atomic<size_t> cached{0};           ///< Mirror of count for observers
+        size_t count = 0;                         ///< Owner-thread view of the magazine size
+        bool shared = false;                      ///< Fallback slot used by several threads
+        std::unique_ptr<std::uint32_t[]> magazine;
+
+        // Private slots have a single writer, so a plain load/store avoids a locked RMW
+        void count_allocation() {
+            bump(allocations);
+        }
+
+        void count_deallocation() {
+            bump(deallocations);
+        }
+
+        void bump(std::atomic<size_t>& counter) {
+            if (shared) {
+                counter.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /**
+     * @brief Chunk bases plus the address-to-chunk hash table
+     *
+     * When it fills, a copy twice as large replaces it. Superseded copies
+     * stay alive until the pool is destroyed, so a lock-free reader still
+     * holding one never dangles; any chunk it is asked about is older than
+     * the copy it loaded.
+     */
+    struct chunk_directory {
+        explicit chunk_directory(size_t slots)
+            : capacity(slots)
+            , table_mask(std::bit_ceil(slots * 2) - 1)
+            , chunks(std::make_unique<std::atomic<char*>[]>(slots))
+            , chunk_blocks(std::make_unique<size_t[]>(slots))
+            , table_keys(std::make_unique<std::atomic<std::uintptr_t>[]>(table_mask + 1))
+            , table_chunks(std::make_unique<size_t[]>(table_mask + 1)) {}
+
+        size_t capacity;
+        size_t table_mask;
+        std::unique_ptr<std::atomic<char*>[]> chunks;
+        std::unique_ptr<size_t[]> chunk_blocks;
+        std::unique_ptr<std::atomic<std::uintptr_t>[]> table_keys;
+        std::unique_ptr<size_t[]> table_chunks;
+    };
+
+    static constexpr std::uint64_t pack(std::uint64_t tag, std::uint32_t id) {
+        return (tag << 32) | id;
+    }
+
+    static std::atomic_ref<std::uint32_t> link_of(char* block) {
+        return std::atomic_ref<std::uint32_t>(*reinterpret_cast<std::uint32_t*>(block));
+    }
+
+    slot_state& local_slot() {
+        size_t index = current_thread_slot();
+        slot_state* slot = slots_[index].load(std::memory_order_acquire);
+        if (slot == nullptr) {
+            // Only the thread leasing this slot creates its state
+            slot = new slot_state();
+            if (cache_capacity_ > 0) {
+                slot->magazine = std::make_unique<std::uint32_t[]>(cache_capacity_);
+            }
+            slots_[index].store(slot, std::memory_order_release);
+        }
+        return *slot;
+    }
+
+    char* block_address(std::uint32_t id) const {
+        std::uint32_t raw = id - 1;
+        size_t chunk = raw >> index_bits_;
+        size_t index = raw & ((std::uint32_t{1} << index_bits_) - 1);
+        return directory_.load(std::memory_order_acquire)->chunks[chunk].load(std::memory_order_acquire) +
+               index * block_stride_;
+    }
+
+    /**
+     * @brief Resolve an id read from a possibly recycled link
+     * @return Block address, or nullptr if the id is stale garbage
+     */
+    char* checked_block_address(std::uint32_t id) const {
+        std::uint32_t raw = id - 1;
+        size_t chunk = raw >> index_bits_;
+        size_t index = raw & ((std::uint32_t{1} << index_bits_) - 1);
+        const chunk_directory* dir = directory_.load(std::memory_order_acquire);
+        if (chunk >= dir->capacity) {
+            return nullptr;
+        }
+        char* base = dir->chunks[chunk].load(std::memory_order_acquire);
+        if (base == nullptr || index >= dir->chunk_blocks[chunk]) {
+            return nullptr;
+        }
+        return base + index * block_stride_;
+    }
+
+    size_t table_index(const chunk_directory& dir, std::uintptr_t base) const {
+        return static_cast<size_t>(((base / chunk_span_) * 0x9E3779B97F4A7C15ull) >> 20) & dir.table_mask;
+    }
+
+    std::uint32_t block_id(const void* ptr) const {
+        auto address = reinterpret_cast<std::uintptr_t>(ptr);
+        std::uintptr_t base = address & ~static_cast<std::uintptr_t>(chunk_span_ - 1);
+        const chunk_directory* dir = directory_.load(std::memory_order_acquire);
+
+        for (size_t i = table_index(*dir, base);; i = (i + 1) & dir->table_mask) {
+            std::uintptr_t key = dir->table_keys[i].load(std::memory_order_acquire);
+            if (key == 0) {
+                return 0;
+            }
+            if (key != base) {
+                continue;
+            }
+            size_t chunk = dir->table_chunks[i];
+            size_t offset = address - base;
+            size_t index = block_shift_ != 0 ? offset >> block_shift_ : offset / block_stride_;
+            if (index * block_stride_ != offset || index >= dir->chunk_blocks[chunk]) {
+                return 0;
+            }
+            return static_cast<std::uint32_t>(((chunk << index_bits_) | index) + 1);
+        }
+    }
 
-        if (free_blocks_.empty()) {
-            // Try to grow the pool
-            if (!grow_pool()) {
-                stats_.allocation_failures++;
-                return common::Result<void*>::err(error_info(monitoring_error_code::resource_unavailable, "Memory pool exhausted").to_common_error());
+    /**
+     * @brief Pop up to @p want blocks, growing the pool when the depot is dry
+     * @return Number of ids written to @p out (0 when exhausted)
+     */
+    size_t acquire_from_depot(size_t want, std::uint32_t* out) {
+        while (true) {
+            size_t got = pop_chain(want, out);
+            if (got > 0) {
+                return got;
+            }
+            if (!grow()) {
+                return pop_chain(want, out);
             }
         }
+    }
+
+    size_t pop_chain(size_t want, std::uint32_t* out) {
+        std::uint64_t head = depot_head_.load(std::memory_order_acquire);
+        while (true) {
+            auto first = static_cast<std::uint32_t>(head);
+            if (first == 0) {
+                return 0;
+            }
+
+            // Links of blocks popped concurrently may already hold user data;
+            // such walks are discarded by the tag check in the CAS below.
+            size_t got = 0;
+            std::uint32_t cursor = first;
+            bool stale = false;
+            while (got < want && cursor != 0) {
+                char* block = checked_block_address(cursor);
+                if (block == nullptr) {
+                    stale = true;
+                    break;
+                }
+                out[got++] = cursor;
+                cursor = link_of(block).load(std::memory_order_relaxed);
+            }
 
-        void* block = free_blocks_.back();
-        free_blocks_.pop_back();
+            if (stale) {
+                head = depot_head_.load(std::memory_order_acquire);
+                continue;
+            }
 
-        stats_.total_allocations++;
-        update_peak_usage();
+            if (depot_head_.compare_exchange_weak(head, pack((head >> 32) + 1, cursor),
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+                size_t free_after = depot_free_.fetch_sub(got, std::memory_order_relaxed) - got;
+                update_peak_usage(free_after);
+                return got;
+            }
+        }
+    }
+
+    void push_chain(const std::uint32_t* ids, size_t count) {
+        for (size_t i = 0; i + 1 < count; ++i) {
+            link_of(block_address(ids[i])).store(ids[i + 1], std::memory_order_relaxed);
+        }
+        auto last = link_of(block_address(ids[count - 1]));
+
+        // Count before publishing so the counter never underflows in pop_chain
+        depot_free_.fetch_add(count, std::memory_order_relaxed);
+
+        std::uint64_t head = depot_head_.load(std::memory_order_relaxed);
+        do {
+            last.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+        } while (!depot_head_.compare_exchange_weak(head, pack((head >> 32) + 1, ids[0]),
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Move the oldest @p count blocks of a magazine to the depot
+     */
+    void flush_magazine(slot_state& slot, size_t count) {
+        push_chain(slot.magazine.get(), count);
+        std::copy(slot.magazine.get() + count, slot.magazine.get() + slot.count, slot.magazine.get());
+        slot.count -= count;
+        slot.cached.store(slot.count, std::memory_order_relaxed);
+    }
 
+    /**
+     * @brief Double the pool, bounded by max_blocks
+     * @return true if the depot may have blocks now
+     */
+    bool grow() {
+        std::lock_guard<std::mutex> lock(grow_mutex_);
+
+        // Another thread grew or returned blocks while we waited
+        if (depot_free_.load(std::memory_order_relaxed) > 0) {
+            return true;
+        }
+
+        size_t existing = chunk_count_;
+        size_t added = 0;
+        while (added < std::max<size_t>(existing, 1) && chunk_count_ < max_chunks_) {
+            size_t blocks = blocks_per_chunk_;
+            if (config_.max_blocks > 0) {
+                blocks = std::min(blocks, config_.max_blocks - total_blocks());
+            }
+            if (blocks == 0 || !add_chunk(blocks)) {
+                break;
+            }
+            ++added;
+        }
+        return added > 0;
+    }
+
+    /**
+     * @brief Allocate, register and publish one chunk; caller holds grow_mutex_
+     *        (or is the constructor)
+     */
+    bool add_chunk(size_t blocks) {
+        chunk_directory* dir = directory_.load(std::memory_order_relaxed);
+        if (chunk_count_ == dir->capacity) {
+            dir = grow_directory(*dir);
+        }
+
+        auto* memory = static_cast<char*>(::detail::aligned_alloc_impl(chunk_span_, chunk_span_));
+        if (memory == nullptr) {
+            return false;
+        }
+
+        size_t chunk = chunk_count_++;
+        dir->chunk_blocks[chunk] = blocks;
+        dir->chunks[chunk].store(memory, std::memory_order_release);
+        register_chunk(*dir, reinterpret_cast<std::uintptr_t>(memory), chunk);
+
+        std::vector<std::uint32_t> ids(blocks);
+        for (size_t b = 0; b < blocks; ++b) {
+            ids[b] = static_cast<std::uint32_t>(((chunk << index_bits_) | b) + 1);
+        }
+        total_blocks_.fetch_add(blocks, std::memory_order_relaxed);
+        push_chain(ids.data(), blocks);
+        return true;
+    }
+
+    /**
+     * @brief Publish a copy of @p old with twice the chunk slots; caller
+     *        holds grow_mutex_ (or is the constructor)
+     */
+    chunk_directory* grow_directory(const chunk_directory& old) {
+        auto next = std::make_unique<chunk_directory>(std::min(old.capacity * 2, max_chunks_));
+        for (size_t chunk = 0; chunk < chunk_count_; ++chunk) {
+            char* memory = old.chunks[chunk].load(std::memory_order_relaxed);
+            next->chunk_blocks[chunk] = old.chunk_blocks[chunk];
+            next->chunks[chunk].store(memory, std::memory_order_relaxed);
+            register_chunk(*next, reinterpret_cast<std::uintptr_t>(memory), chunk);
+        }
+
+        directories_.push_back(std::move(next));
+        chunk_directory* published = directories_.back().get();
+        directory_.store(published, std::memory_order_release);
+        return published;
+    }
+
+    void register_chunk(chunk_directory& dir, std::uintptr_t base, size_t chunk) {
+        size_t i = table_index(dir, base);
+        while (dir.table_keys[i].load(std::memory_order_relaxed) != 0) {
+            i = (i + 1) & dir.table_mask;
+        }
+        dir.table_chunks[i] = chunk;
+        dir.table_keys[i].store(base, std::memory_order_release);
+    }
+
+    void update_peak_usage(size_t free_blocks) {
+        size_t total = total_blocks();
+        size_t in_use = total > free_blocks ? total - free_blocks : 0;
+        size_t peak = stats_.peak_usage.load(std::memory_order_relaxed);
+        while (in_use > peak) {
+            if (stats_.peak_usage.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+    }
+
+    void release_memory() {
+        const chunk_directory* dir = directory_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < chunk_count_; ++i) {
+            ::detail::aligned_free_impl(dir->chunks[i].load(std::memory_order_relaxed));
+        }
+        chunk_count_ = 0;
+        for (size_t i = 0; i <= max_thread_slots; ++i) {
+            delete slots_[i].exchange(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    memory_pool_config config_;
+    size_t block_size_;
+    size_t block_stride_ = 0;                     ///< block_size_ rounded up to the alignment
+    size_t blocks_per_chunk_ = 0;
+    size_t cache_capacity_;
+    size_t chunk_span_ = 0;
+    unsigned index_bits_ = 0;
+    unsigned block_shift_ = 0;                    ///< log2(block_stride_) when it is a power of two
+    size_t max_chunks_ = 0;
+    size_t chunk_count_ = 0;
+
+    std::atomic<chunk_directory*> directory_{nullptr};
+    std::vector<std::unique_ptr<chunk_directory>> directories_;  ///< Current and superseded
+    std::unique_ptr<std::atomic<slot_state*>[]> slots_;
+
+    alignas(64) std::atomic<std::uint64_t> depot_head_{0};
+    alignas(64) std::atomic<size_t> depot_free_{0};
+    std::atomic<size_t> total_blocks_{0};
+    std::mutex grow_mutex_;
+    mutable memory_pool_statistics stats_;
+};
+
+} // namespace detail
+
+/**
+ * @brief Thread-safe fixed-size block memory allocator
+ *
+ * This pool pre-allocates memory blocks of fixed size for efficient
+ * allocation/deallocation without heap fragmentation. The free list is a
+ * lock-free depot, ownership checks are O(1) through chunk alignment, and
+ * with use_thread_local_cache each thread works from a private magazine.
+ *
+ * Blocks are spaced block_size rounded up to the alignment apart, and each
+ * chunk is a power-of-two span filled with as many blocks as fit, so
+ * total_blocks() may start above initial_blocks (never above max_blocks).
+ *
+ * @note With thread caching, peak_usage counts blocks handed to magazines
+ *       as in use, and blocks parked in another thread's magazine are not
+ *       visible to allocate() until that thread flushes or exits.
+ */
+class memory_pool {
+public:
+    /**
+     * @brief Default constructor with default configuration
+     */
+    memory_pool() : memory_pool(memory_pool_config{}) {}
+
+    /**
+     * @brief Construct with configuration
+     * @param config Pool configuration
+     * @throws std::invalid_argument if configuration validation fails
+     *         (memory_pool_config::validate() returns false)
+     * @throws std::bad_alloc if the first chunk cannot be allocated
+     */
+    explicit memory_pool(const memory_pool_config& config)
+        : core_(make_core(config)) {}
+
+    ~memory_pool() = default;
+
+    // Disable copy
+    memory_pool(const memory_pool&) = delete;
+    memory_pool& operator=(const memory_pool&) = delete;
+
+    // Enable move; a moved-from pool is empty and every allocation fails
+    memory_pool(memory_pool&& other) noexcept = default;
+    memory_pool& operator=(memory_pool&& other) noexcept = default;
+
+    /**
+     * @brief Allocate a memory block
+     * @return common::Result<void*> containing pointer to allocated block
+     */
+    common::Result<void*> allocate() {
+        void* block = core_ ? core_->allocate() : nullptr;
+        if (block == nullptr) {
+            return common::Result<void*>::err(error_info(monitoring_error_code::resource_unavailable, "Memory pool exhausted").to_common_error());
+        }
         return common::ok(block);
     }
 
@@ -257,16 +880,10 @@ public:
             return common::VoidResult::err(error_info(monitoring_error_code::invalid_argument, "Cannot deallocate null pointer").to_common_error());
         }
 
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        // Verify the pointer belongs to this pool
-        if (!is_owned_block(ptr)) {
+        if (!core_ || !core_->deallocate(ptr)) {
             return common::VoidResult::err(error_info(monitoring_error_code::invalid_argument, "Pointer does not belong to this pool").to_common_error());
         }
 
-        free_blocks_.push_back(ptr);
-        stats_.total_deallocations++;
-
         return common::ok();
     }
 
@@ -279,7 +896,7 @@ public:
      */
     template<typename T, typename... Args>
     common::Result<T*> allocate_object(Args&&... args) {
-        if (sizeof(T) > block_size_) {
+        if (sizeof(T) > block_size()) {
             return common::Result<T*>::err(error_info(monitoring_error_code::invalid_argument, "Object size exceeds block size").to_common_error());
         }
 
@@ -310,13 +927,21 @@ public:
         return deallocate(static_cast<void*>(obj));
     }
 
+    /**
+     * @brief Check whether a pointer addresses a block of this pool
+     * @param ptr Pointer to test
+     * @return true if the pointer was carved from this pool
+     */
+    bool owns(const void* ptr) const {
+        return ptr != nullptr && core_ && core_->owns(ptr);
+    }
+
     /**
      * @brief Get number of available blocks
-     * @return Number of free blocks
+     * @return Number of free blocks (depot plus thread magazines)
      */
     size_t available_blocks() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return free_blocks_.size();
+        return core_ ? core_->available_blocks() : 0;
     }
 
     /**
@@ -324,7 +949,7 @@ public:
      * @return Total block count
      */
     size_t total_blocks() const {
-        return total_blocks_;
+        return core_ ? core_->total_blocks() : 0;
     }
 
     /**
@@ -332,7 +957,7 @@ public:
      * @return Size of each block in bytes
      */
     size_t block_size() const {
-        return block_size_;
+        return core_ ? core_->block_size() : 0;
     }
 
     /**
@@ -340,98 +965,248 @@ public:
      * @return Reference to statistics
      */
     const memory_pool_statistics& get_statistics() const {
-        return stats_;
+        static const memory_pool_statistics empty_statistics;
+        return core_ ? core_->get_statistics() : empty_statistics;
     }
 
     /**
      * @brief Reset statistics
      */
     void reset_statistics() {
-        stats_.reset();
+        if (core_) {
+            core_->reset_statistics();
+        }
     }
 
 private:
-    void initialize_pool() {
-        size_t chunk_size = total_blocks_ * block_size_;
-        void* chunk = detail::aligned_alloc_impl(config_.alignment, chunk_size);
-
-        if (chunk == nullptr) {
-            throw std::bad_alloc();
+    static std::unique_ptr<detail::fixed_block_pool> make_core(const memory_pool_config& config) {
+        if (!config.validate()) {
+            throw std::invalid_argument("Invalid memory pool configuration");
         }
+        return std::make_unique<detail::fixed_block_pool>(config);
+    }
 
-        memory_chunks_.push_back(chunk);
+    std::unique_ptr<detail::fixed_block_pool> core_;
+};
 
-        // Initialize free block list
-        free_blocks_.reserve(total_blocks_);
-        char* ptr = static_cast<char*>(chunk);
-        for (size_t i = 0; i < total_blocks_; ++i) {
-            free_blocks_.push_back(ptr + i * block_size_);
-        }
-    }
+/**
+ * @brief Configuration for size-classed memory pool
+ */
+struct size_class_pool_config {
+    size_t max_block_size = 1024;          ///< Largest request served from the pool
+    size_t initial_blocks_per_class = 64;  ///< Initial blocks carved per size class
+    size_t max_blocks_per_class = 0;       ///< Maximum blocks per size class (0 = unlimited)
+    bool use_thread_local_cache = true;    ///< Use per-thread magazines
+    size_t thread_cache_size = 32;         ///< Blocks held per thread magazine
 
-    bool grow_pool() {
-        if (config_.max_blocks > 0 && total_blocks_ >= config_.max_blocks) {
+    /**
+     * @brief Validate configuration
+     * @return true if configuration is valid
+     */
+    bool validate() const {
+        if (max_block_size < 16 || max_block_size > 65536) {
+            return false;
+        }
+        if (initial_blocks_per_class == 0) {
             return false;
         }
+        if (max_blocks_per_class != 0 && max_blocks_per_class < initial_blocks_per_class) {
+            return false;
+        }
+        if (use_thread_local_cache && thread_cache_size < 2) {
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Size-classed allocator built from one memory_pool per class
+ *
+ * Requests are rounded up to the nearest class (16-byte steps up to 128
+ * bytes, then four classes per power of two) through a lookup table, so
+ * both routing and ownership checks are O(1). Every block is at least
+ * 16-byte aligned.
+ */
+class size_class_pool {
+public:
+    /// Alignment guaranteed for every block handed out
+    static constexpr size_t block_alignment = 16;
+
+    size_class_pool() : size_class_pool(size_class_pool_config{}) {}
 
-        size_t new_blocks = std::min(total_blocks_, config_.max_blocks - total_blocks_);
-        if (new_blocks == 0) {
-            new_blocks = total_blocks_;  // Double the size
+    /**
+     * @brief Construct with configuration
+     * @param config Pool configuration
+     * @throws std::invalid_argument if configuration validation fails
+     */
+    explicit size_class_pool(const size_class_pool_config& config)
+        : config_(config) {
+        if (!config.validate()) {
+            throw std::invalid_argument("Invalid size class pool configuration");
         }
 
-        size_t chunk_size = new_blocks * block_size_;
-        void* chunk = detail::aligned_alloc_impl(config_.alignment, chunk_size);
+        size_t max_size = (config.max_block_size + 15) & ~size_t{15};
 
-        if (chunk == nullptr) {
-            return false;
+        for (size_t size = 16; size <= std::min<size_t>(128, max_size); size += 16) {
+            class_sizes_.push_back(size);
+        }
+        for (size_t base = 128; base < max_size; base *= 2) {
+            for (size_t step = 1; step <= 4; ++step) {
+                size_t size = base + step * (base / 4);
+                class_sizes_.push_back(std::min(size, max_size));
+                if (size >= max_size) {
+                    break;
+                }
+            }
         }
 
-        memory_chunks_.push_back(chunk);
+        class_lookup_.resize(max_size / 16 + 1);
+        size_t current = 0;
+        for (size_t i = 0; i < class_lookup_.size(); ++i) {
+            while (class_sizes_[current] < i * 16) {
+                ++current;
+            }
+            class_lookup_[i] = static_cast<std::uint8_t>(current);
+        }
 
-        char* ptr = static_cast<char*>(chunk);
-        for (size_t i = 0; i < new_blocks; ++i) {
-            free_blocks_.push_back(ptr + i * block_size_);
+        pools_.reserve(class_sizes_.size());
+        for (size_t size : class_sizes_) {
+            memory_pool_config pool_config;
+            pool_config.initial_blocks = config.initial_blocks_per_class;
+            pool_config.max_blocks = config.max_blocks_per_class;
+            pool_config.block_size = size;
+            pool_config.alignment = block_alignment;
+            pool_config.use_thread_local_cache = config.use_thread_local_cache;
+            pool_config.thread_cache_size = config.thread_cache_size;
+            pools_.emplace_back(pool_config);
         }
+    }
 
-        total_blocks_ += new_blocks;
-        return true;
+    /**
+     * @brief Allocate a block large enough for @p size bytes
+     * @param size Requested size in bytes
+     * @return common::Result<void*> containing pointer to allocated block
+     */
+    common::Result<void*> allocate(size_t size) {
+        if (size > max_block_size()) {
+            return common::Result<void*>::err(error_info(monitoring_error_code::invalid_argument, "Requested size exceeds largest size class").to_common_error());
+        }
+        return pools_[class_lookup_[(size + 15) / 16]].allocate();
     }
 
-    bool is_owned_block(void* ptr) const {
-        for (size_t i = 0; i < memory_chunks_.size(); ++i) {
-            char* chunk_start = static_cast<char*>(memory_chunks_[i]);
-            size_t chunk_blocks = (i == 0) ? config_.initial_blocks :
-                                  ((total_blocks_ - config_.initial_blocks) / (memory_chunks_.size() - 1));
-            char* chunk_end = chunk_start + chunk_blocks * block_size_;
+    /**
+     * @brief Return a block to its size class
+     * @param ptr Pointer returned by allocate()
+     * @param size Size passed to allocate()
+     * @return common::VoidResult indicating success or error
+     */
+    common::VoidResult deallocate(void* ptr, size_t size) {
+        if (size > max_block_size()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_argument, "Pointer does not belong to this pool").to_common_error());
+        }
+        return pools_[class_lookup_[(size + 15) / 16]].deallocate(ptr);
+    }
 
-            if (ptr >= chunk_start && ptr < chunk_end) {
-                // Verify alignment
-                size_t offset = static_cast<char*>(ptr) - chunk_start;
-                if (offset % block_size_ == 0) {
-                    return true;
-                }
+    /**
+     * @brief Check whether a pointer was carved from any size class
+     */
+    bool owns(const void* ptr) const {
+        for (const auto& pool : pools_) {
+            if (pool.owns(ptr)) {
+                return true;
             }
         }
         return false;
     }
 
-    void update_peak_usage() {
-        size_t current_usage = total_blocks_ - free_blocks_.size();
-        size_t peak = stats_.peak_usage.load();
-        while (current_usage > peak) {
-            if (stats_.peak_usage.compare_exchange_weak(peak, current_usage)) {
-                break;
+    /**
+     * @brief Index of the class serving @p size, or size_class_count() if too large
+     */
+    size_t size_class_of(size_t size) const {
+        return size > max_block_size() ? pools_.size() : class_lookup_[(size + 15) / 16];
+    }
+
+    size_t size_class_count() const {
+        return pools_.size();
+    }
+
+    size_t class_block_size(size_t index) const {
+        return class_sizes_[index];
+    }
+
+    size_t max_block_size() const {
+        return class_sizes_.back();
+    }
+
+    /**
+     * @brief Access the pool backing one size class
+     */
+    const memory_pool& class_pool(size_t index) const {
+        return pools_[index];
+    }
+
+private:
+    size_class_pool_config config_;
+    std::vector<size_t> class_sizes_;
+    std::vector<std::uint8_t> class_lookup_;
+    std::vector<memory_pool> pools_;
+};
+
+/**
+ * @brief std::pmr::memory_resource backed by a size_class_pool
+ *
+ * Requests that fit a size class and need at most 16-byte alignment are
+ * served from the pool; larger or over-aligned requests, and requests made
+ * while a class is exhausted, fall through to the upstream resource.
+ */
+class pool_memory_resource : public std::pmr::memory_resource {
+public:
+    explicit pool_memory_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : pool_memory_resource(size_class_pool_config{}, upstream) {}
+
+    explicit pool_memory_resource(const size_class_pool_config& config,
+                                  std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : pool_(config)
+        , upstream_(upstream) {}
+
+    size_class_pool& pool() {
+        return pool_;
+    }
+
+    std::pmr::memory_resource* upstream_resource() const {
+        return upstream_;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (fits_pool(bytes, alignment)) {
+            auto result = pool_.allocate(bytes);
+            if (result.is_ok()) {
+                return result.value();
             }
         }
+        return upstream_->allocate(bytes, alignment);
     }
 
-    memory_pool_config config_;
-    size_t block_size_;
-    size_t total_blocks_;
-    std::vector<void*> free_blocks_;
-    std::vector<void*> memory_chunks_;
-    mutable std::mutex mutex_;
-    mutable memory_pool_statistics stats_;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (fits_pool(bytes, alignment) && pool_.deallocate(ptr, bytes).is_ok()) {
+            return;
+        }
+        upstream_->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    bool fits_pool(size_t bytes, size_t alignment) const {
+        return alignment <= size_class_pool::block_alignment && bytes <= pool_.max_block_size();
+    }
+
+    size_class_pool pool_;
+    std::pmr::memory_resource* upstream_;
 };
 
 /**
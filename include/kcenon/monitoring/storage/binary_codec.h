@@ -0,0 +1,282 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file binary_codec.h
+ * @brief Byte-level helpers shared by the on-disk storage formats
+ *
+ * CRC-32, little-endian/LEB128 record encoding and read-only file maps used
+ * by segment_store and metric_wal.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define MONITORING_HAS_MMAP 1
+#endif
+
+namespace kcenon::monitoring {
+
+namespace detail {
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected) of a byte range
+ */
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) noexcept {
+    static constexpr auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Little-endian / LEB128 append helpers for record encoding
+ */
+class byte_writer {
+public:
+    explicit byte_writer(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put_u8(uint8_t v) { out_.push_back(v); }
+    void put_u32(uint32_t v) { put_fixed(v, 4); }
+    void put_u64(uint64_t v) { put_fixed(v, 8); }
+
+    void put_varint(uint64_t v) {
+        while (v >= 0x80) {
+            out_.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out_.push_back(static_cast<uint8_t>(v));
+    }
+
+    void put_signed(int64_t v) {
+        put_varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    void put_double(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put_u64(bits);
+    }
+
+    void put_string(std::string_view s) {
+        put_varint(s.size());
+        out_.insert(out_.end(), s.begin(), s.end());
+    }
+
+private:
+    void put_fixed(uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out_.push_back(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+
+    std::vector<uint8_t>& out_;
+};
+
+/**
+ * @brief Bounds-checked reader matching byte_writer
+ *
+ * Every getter returns false once the input is exhausted or malformed.
+ */
+class byte_reader {
+public:
+    byte_reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool get_u8(uint8_t& v) { return get_fixed(v, 1); }
+    bool get_u32(uint32_t& v) { return get_fixed(v, 4); }
+    bool get_u64(uint64_t& v) { return get_fixed(v, 8); }
+
+    bool get_varint(uint64_t& v) {
+        v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (pos_ >= size_) {
+                return false;
+            }
+            const uint8_t byte = data_[pos_++];
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool get_signed(int64_t& v) {
+        uint64_t raw;
+        if (!get_varint(raw)) {
+            return false;
+        }
+        v = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+        return true;
+    }
+
+    bool get_double(double& v) {
+        uint64_t bits;
+        if (!get_u64(bits)) {
+            return false;
+        }
+        std::memcpy(&v, &bits, sizeof(v));
+        return true;
+    }
+
+    bool get_string(std::string& s) {
+        uint64_t length;
+        if (!get_varint(length) || length > size_ - pos_) {
+            return false;
+        }
+        s.assign(reinterpret_cast<const char*>(data_ + pos_), static_cast<size_t>(length));
+        pos_ += static_cast<size_t>(length);
+        return true;
+    }
+
+    bool skip(size_t n) {
+        if (n > size_ - pos_) {
+            return false;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    size_t position() const noexcept { return pos_; }
+    size_t remaining() const noexcept { return size_ - pos_; }
+
+private:
+    template<typename T>
+    bool get_fixed(T& v, int bytes) {
+        if (static_cast<size_t>(bytes) > size_ - pos_) {
+            return false;
+        }
+        uint64_t out = 0;
+        for (int i = 0; i < bytes; ++i) {
+            out |= static_cast<uint64_t>(data_[pos_++]) << (8 * i);
+        }
+        v = static_cast<T>(out);
+        return true;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+inline int64_t to_unix_nanos(std::chrono::system_clock::time_point tp) noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+inline std::chrono::system_clock::time_point from_unix_nanos(int64_t ns) noexcept {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+/**
+ * @brief Read-only view of a whole file, memory-mapped where supported
+ */
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept { *this = std::move(other); }
+
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            reset();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            buffer_ = std::move(other.buffer_);
+        }
+        return *this;
+    }
+
+    ~mapped_file() { reset(); }
+
+    /**
+     * @brief Map the first @p size bytes of @p path
+     */
+    bool map(const std::string& path, size_t size) {
+        reset();
+        if (size == 0) {
+            return true;
+        }
+#ifdef MONITORING_HAS_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(addr);
+        size_ = size;
+        return true;
+#else
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        buffer_.resize(size);
+        const size_t read = std::fread(buffer_.data(), 1, size, file);
+        std::fclose(file);
+        if (read != size) {
+            buffer_.clear();
+            return false;
+        }
+        data_ = buffer_.data();
+        size_ = size;
+        return true;
+#endif
+    }
+
+    void reset() noexcept {
+#ifdef MONITORING_HAS_MMAP
+        if (data_ != nullptr && buffer_.empty()) {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        buffer_.clear();
+    }
+
+    const uint8_t* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<uint8_t> buffer_;  // Used when mmap is unavailable
+};
+
+} // namespace detail
+
+} // namespace kcenon::monitoring
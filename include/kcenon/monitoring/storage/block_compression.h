@@ -0,0 +1,325 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file block_compression.h
+ * @brief Block compression codecs for the on-disk storage formats
+ *
+ * lz4 is always available: a dependency-free compressor producing the LZ4
+ * block format (greedy hash-chain-free matcher, same as LZ4's fast mode),
+ * so blocks can also be inspected with stock LZ4 tooling. gzip (zlib
+ * deflate) and zstd are compiled in when CMake finds those libraries and
+ * defines MONITORING_HAS_ZLIB / MONITORING_HAS_ZSTD.
+ *
+ * Codecs work on whole blocks; the caller records the uncompressed size.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef MONITORING_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef MONITORING_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace kcenon::monitoring {
+
+/**
+ * @brief Compression algorithms
+ */
+enum class compression_algorithm {
+    none,
+    gzip,
+    lz4,
+    zstd
+};
+
+namespace detail {
+
+/**
+ * @brief LZ4 block format encoder/decoder
+ *
+ * A block is a sequence of (token, literals, 16-bit offset, match length)
+ * sequences; the last sequence carries literals only. Matches are at least
+ * 4 bytes, the last 5 bytes are always literals and the last match starts
+ * at least 12 bytes before the end, as the format requires.
+ */
+class lz4_block_codec {
+public:
+    static constexpr size_t min_match = 4;
+    static constexpr size_t last_literals = 5;
+    static constexpr size_t match_find_limit = 12;
+    static constexpr size_t max_offset = 65535;
+
+    /**
+     * @brief Append the compressed form of [src, src + size) to @p out
+     */
+    static void compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+        out.reserve(out.size() + size + size / 255 + 16);
+
+        size_t anchor = 0;
+        if (size > match_find_limit) {
+            std::vector<uint32_t> table(size_t{1} << hash_log, 0);
+            const size_t match_limit = size - last_literals;
+            const size_t input_limit = size - match_find_limit;
+
+            size_t ip = 1;
+            unsigned misses = 0;
+            while (ip <= input_limit) {
+                const uint32_t sequence = read32(src + ip);
+                const uint32_t h = hash(sequence);
+                const size_t candidate = table[h];
+                table[h] = static_cast<uint32_t>(ip);
+
+                if (candidate >= ip || ip - candidate > max_offset || read32(src + candidate) != sequence) {
+                    // Skip ahead faster through incompressible input
+                    ip += 1 + (misses++ >> 6);
+                    continue;
+                }
+                misses = 0;
+
+                size_t length = min_match;
+                while (ip + length < match_limit && src[candidate + length] == src[ip + length]) {
+                    ++length;
+                }
+
+                write_sequence(out, src + anchor, ip - anchor, ip - candidate, length);
+                ip += length;
+                anchor = ip;
+                if (ip - 2 <= input_limit) {
+                    table[hash(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+                }
+            }
+        }
+
+        // Trailing literals
+        const size_t literals = size - anchor;
+        out.push_back(static_cast<uint8_t>((literals < 15 ? literals : 15) << 4));
+        if (literals >= 15) {
+            write_length(out, literals - 15);
+        }
+        out.insert(out.end(), src + anchor, src + size);
+    }
+
+    /**
+     * @brief Decode a block into exactly @p raw_size bytes at @p dst
+     * @return false if the input is malformed or does not fill @p dst
+     */
+    static bool decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t raw_size) {
+        size_t ip = 0;
+        size_t op = 0;
+        while (ip < size) {
+            const uint8_t token = src[ip++];
+
+            size_t literals = token >> 4;
+            if (literals == 15 && !read_length(src, size, ip, literals)) {
+                return false;
+            }
+            if (literals > size - ip || literals > raw_size - op) {
+                return false;
+            }
+            std::memcpy(dst + op, src + ip, literals);
+            ip += literals;
+            op += literals;
+
+            if (ip == size) {
+                break;  // Last sequence has no match
+            }
+
+            if (size - ip < 2) {
+                return false;
+            }
+            const size_t offset = static_cast<size_t>(src[ip]) | (static_cast<size_t>(src[ip + 1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) {
+                return false;
+            }
+
+            size_t length = token & 15;
+            if (length == 15 && !read_length(src, size, ip, length)) {
+                return false;
+            }
+            length += min_match;
+            if (length > raw_size - op) {
+                return false;
+            }
+
+            const uint8_t* match = dst + op - offset;
+            if (offset >= length) {
+                std::memcpy(dst + op, match, length);
+            } else {
+                for (size_t i = 0; i < length; ++i) {
+                    dst[op + i] = match[i];  // Overlapping copy repeats the pattern
+                }
+            }
+            op += length;
+        }
+        return op == raw_size;
+    }
+
+private:
+    static constexpr unsigned hash_log = 12;
+
+    static uint32_t read32(const uint8_t* p) noexcept {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint32_t hash(uint32_t sequence) noexcept {
+        return (sequence * 2654435761u) >> (32 - hash_log);
+    }
+
+    static void write_length(std::vector<uint8_t>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    static bool read_length(const uint8_t* src, size_t size, size_t& ip, size_t& length) {
+        uint8_t byte = 255;
+        while (byte == 255) {
+            if (ip >= size) {
+                return false;
+            }
+            byte = src[ip++];
+            length += byte;
+        }
+        return true;
+    }
+
+    static void write_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_count,
+                               size_t offset, size_t match_length) {
+        const size_t match_code = match_length - min_match;
+        out.push_back(static_cast<uint8_t>(((literal_count < 15 ? literal_count : 15) << 4) |
+                                           (match_code < 15 ? match_code : 15)));
+        if (literal_count >= 15) {
+            write_length(out, literal_count - 15);
+        }
+        out.insert(out.end(), literals, literals + literal_count);
+        out.push_back(static_cast<uint8_t>(offset & 0xFF));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+        if (match_code >= 15) {
+            write_length(out, match_code - 15);
+        }
+    }
+};
+
+/**
+ * @brief Whether @p algorithm can be used in this build
+ */
+inline bool compression_available(compression_algorithm algorithm) noexcept {
+    switch (algorithm) {
+        case compression_algorithm::none:
+        case compression_algorithm::lz4:
+            return true;
+        case compression_algorithm::gzip:
+#ifdef MONITORING_HAS_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case compression_algorithm::zstd:
+#ifdef MONITORING_HAS_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+/**
+ * @brief Append the compressed form of a block to @p out
+ * @return false if the codec is unavailable or failed
+ */
+inline bool compress_block(compression_algorithm algorithm, const uint8_t* src, size_t size,
+                           std::vector<uint8_t>& out) {
+    switch (algorithm) {
+        case compression_algorithm::none:
+            out.insert(out.end(), src, src + size);
+            return true;
+        case compression_algorithm::lz4:
+            lz4_block_codec::compress(src, size, out);
+            return true;
+        case compression_algorithm::gzip: {
+#ifdef MONITORING_HAS_ZLIB
+            const size_t start = out.size();
+            uLongf bound = ::compressBound(static_cast<uLong>(size));
+            out.resize(start + bound);
+            if (::compress2(out.data() + start, &bound, src, static_cast<uLong>(size), Z_DEFAULT_COMPRESSION) != Z_OK) {
+                out.resize(start);
+                return false;
+            }
+            out.resize(start + bound);
+            return true;
+#else
+            return false;
+#endif
+        }
+        case compression_algorithm::zstd: {
+#ifdef MONITORING_HAS_ZSTD
+            const size_t start = out.size();
+            out.resize(start + ::ZSTD_compressBound(size));
+            const size_t written = ::ZSTD_compress(out.data() + start, out.size() - start, src, size, 3);
+            if (::ZSTD_isError(written)) {
+                out.resize(start);
+                return false;
+            }
+            out.resize(start + written);
+            return true;
+#else
+            return false;
+#endif
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decode a block into exactly @p raw_size bytes at @p dst
+ * @return false if the codec is unavailable or the input is malformed
+ */
+inline bool decompress_block(compression_algorithm algorithm, const uint8_t* src, size_t size,
+                             uint8_t* dst, size_t raw_size) {
+    switch (algorithm) {
+        case compression_algorithm::none:
+            if (size != raw_size) {
+                return false;
+            }
+            std::memcpy(dst, src, size);
+            return true;
+        case compression_algorithm::lz4:
+            return lz4_block_codec::decompress(src, size, dst, raw_size);
+        case compression_algorithm::gzip: {
+#ifdef MONITORING_HAS_ZLIB
+            uLongf length = static_cast<uLongf>(raw_size);
+            return ::uncompress(dst, &length, src, static_cast<uLong>(size)) == Z_OK && length == raw_size;
+#else
+            return false;
+#endif
+        }
+        case compression_algorithm::zstd: {
+#ifdef MONITORING_HAS_ZSTD
+            const size_t length = ::ZSTD_decompress(dst, raw_size, src, size);
+            return !::ZSTD_isError(length) && length == raw_size;
+#else
+            return false;
+#endif
+        }
+    }
+    return false;
+}
+
+} // namespace detail
+
+} // namespace kcenon::monitoring
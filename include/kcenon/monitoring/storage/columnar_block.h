@@ -0,0 +1,384 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file columnar_block.h
+ * @brief Columnar encoding of a block of metrics snapshots
+ *
+ * Payload layout (all offsets relative to the payload start):
+ * - dictionary: every source id, metric name, tag key and tag value of the
+ *   block, once each; everything else refers to strings by id;
+ * - snapshot column: per snapshot, capture time as a zigzag delta from the
+ *   previous snapshot, source id and metric count;
+ * - per metric name (a "series"), four columns:
+ *   - ordinals: position of each metric in block order, delta-encoded;
+ *   - timestamps: delta-of-delta nanoseconds as zigzag varints;
+ *   - values: Gorilla XOR bit stream (see time_series_chunk.h);
+ *   - tags: per metric, tag count then key/value dictionary ids;
+ * - footer index: per series its name id, row count and column offsets;
+ * - 4-byte offset of the footer.
+ *
+ * A scan for a few metrics reads the dictionary and footer and then only
+ * the timestamp and value columns of the matching series.
+ */
+
+#pragma once
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "kcenon/monitoring/interfaces/monitoring_core.h"
+#include "kcenon/monitoring/storage/binary_codec.h"
+#include "kcenon/monitoring/utils/time_series_chunk.h"
+
+namespace kcenon::monitoring {
+
+namespace detail {
+
+/**
+ * @brief Footer entry locating one series' columns
+ */
+struct columnar_series_index {
+    uint64_t name_id{0};
+    uint64_t rows{0};
+    uint64_t ordinals{0};
+    uint64_t timestamps{0};
+    uint64_t values{0};
+    uint64_t tags{0};
+    uint64_t end{0};
+};
+
+/**
+ * @brief Encode @p snapshots as one columnar block payload appended to @p out
+ */
+inline void encode_columnar_block(const std::vector<metrics_snapshot>& snapshots, std::vector<uint8_t>& out) {
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> strings;
+    auto intern = [&ids, &strings](std::string_view s) {
+        auto [it, inserted] = ids.try_emplace(s, static_cast<uint32_t>(strings.size()));
+        if (inserted) {
+            strings.push_back(s);
+        }
+        return it->second;
+    };
+
+    struct series_rows {
+        uint32_t name_id;
+        std::vector<uint64_t> ordinals;
+        std::vector<const metric_value*> metrics;
+    };
+    std::vector<series_rows> series;
+    std::unordered_map<uint32_t, size_t> series_of_name;
+
+    uint64_t ordinal = 0;
+    for (const auto& snapshot : snapshots) {
+        intern(snapshot.source_id);
+        for (const auto& metric : snapshot.metrics) {
+            const uint32_t name_id = intern(metric.name);
+            for (const auto& [key, value] : metric.tags) {
+                intern(key);
+                intern(value);
+            }
+            auto [it, inserted] = series_of_name.try_emplace(name_id, series.size());
+            if (inserted) {
+                series.push_back({name_id, {}, {}});
+            }
+            series[it->second].ordinals.push_back(ordinal++);
+            series[it->second].metrics.push_back(&metric);
+        }
+    }
+
+    const size_t base = out.size();
+    byte_writer writer(out);
+
+    writer.put_varint(strings.size());
+    for (auto s : strings) {
+        writer.put_string(s);
+    }
+
+    int64_t previous_capture = 0;
+    for (const auto& snapshot : snapshots) {
+        const int64_t capture = to_unix_nanos(snapshot.capture_time);
+        writer.put_signed(capture - previous_capture);
+        previous_capture = capture;
+        writer.put_varint(ids.at(snapshot.source_id));
+        writer.put_varint(snapshot.metrics.size());
+    }
+
+    std::vector<columnar_series_index> footer;
+    footer.reserve(series.size());
+    chunk_bit_writer bits;
+    for (const auto& rows : series) {
+        columnar_series_index entry;
+        entry.name_id = rows.name_id;
+        entry.rows = rows.metrics.size();
+
+        entry.ordinals = out.size() - base;
+        uint64_t previous_ordinal = 0;
+        for (uint64_t o : rows.ordinals) {
+            writer.put_varint(o - previous_ordinal);
+            previous_ordinal = o;
+        }
+
+        entry.timestamps = out.size() - base;
+        int64_t previous_time = 0;
+        int64_t previous_delta = 0;
+        for (const auto* metric : rows.metrics) {
+            const int64_t time = to_unix_nanos(metric->timestamp);
+            const int64_t delta = time - previous_time;
+            writer.put_signed(delta - previous_delta);
+            previous_time = time;
+            previous_delta = delta;
+        }
+
+        entry.values = out.size() - base;
+        bits.clear();
+        xor_value_encoder values;
+        for (size_t i = 0; i < rows.metrics.size(); ++i) {
+            const auto value_bits = std::bit_cast<uint64_t>(rows.metrics[i]->value);
+            if (i == 0) {
+                bits.write_bits(value_bits, 64);
+                values.reset(value_bits);
+            } else {
+                values.write(bits, value_bits);
+            }
+        }
+        out.insert(out.end(), bits.data(), bits.data() + bits.byte_count());
+
+        entry.tags = out.size() - base;
+        for (const auto* metric : rows.metrics) {
+            writer.put_varint(metric->tags.size());
+            for (const auto& [key, value] : metric->tags) {
+                writer.put_varint(ids.at(key));
+                writer.put_varint(ids.at(value));
+            }
+        }
+
+        entry.end = out.size() - base;
+        footer.push_back(entry);
+    }
+
+    const auto footer_offset = static_cast<uint32_t>(out.size() - base);
+    writer.put_varint(footer.size());
+    for (const auto& entry : footer) {
+        writer.put_varint(entry.name_id);
+        writer.put_varint(entry.rows);
+        writer.put_varint(entry.ordinals);
+        writer.put_varint(entry.timestamps);
+        writer.put_varint(entry.values);
+        writer.put_varint(entry.tags);
+        writer.put_varint(entry.end);
+    }
+    writer.put_u32(footer_offset);
+}
+
+/**
+ * @brief Read-only view of a columnar block payload
+ *
+ * parse() only reads the dictionary and footer; columns are decoded on
+ * demand.
+ */
+class columnar_block_view {
+public:
+    /**
+     * @return false if the payload is malformed
+     */
+    bool parse(const uint8_t* data, size_t size) {
+        data_ = data;
+        size_ = size;
+        strings_.clear();
+        series_.clear();
+
+        if (size < 4) {
+            return false;
+        }
+        uint32_t footer_offset = 0;
+        byte_reader tail(data + size - 4, 4);
+        tail.get_u32(footer_offset);
+        if (footer_offset > size - 4) {
+            return false;
+        }
+
+        byte_reader reader(data, footer_offset);
+        uint64_t string_count = 0;
+        if (!reader.get_varint(string_count) || string_count > reader.remaining()) {
+            return false;
+        }
+        strings_.reserve(static_cast<size_t>(string_count));
+        for (uint64_t i = 0; i < string_count; ++i) {
+            uint64_t length = 0;
+            if (!reader.get_varint(length) || length > reader.remaining()) {
+                return false;
+            }
+            strings_.emplace_back(reinterpret_cast<const char*>(data + reader.position()),
+                                  static_cast<size_t>(length));
+            reader.skip(static_cast<size_t>(length));
+        }
+        snapshots_offset_ = reader.position();
+
+        byte_reader footer(data + footer_offset, size - 4 - footer_offset);
+        uint64_t series_count = 0;
+        if (!footer.get_varint(series_count) || series_count > footer.remaining()) {
+            return false;
+        }
+        uint64_t previous_end = snapshots_offset_;
+        for (uint64_t i = 0; i < series_count; ++i) {
+            columnar_series_index entry;
+            if (!footer.get_varint(entry.name_id) || !footer.get_varint(entry.rows) ||
+                !footer.get_varint(entry.ordinals) || !footer.get_varint(entry.timestamps) ||
+                !footer.get_varint(entry.values) || !footer.get_varint(entry.tags) ||
+                !footer.get_varint(entry.end)) {
+                return false;
+            }
+            if (entry.name_id >= strings_.size() || entry.ordinals < previous_end ||
+                entry.timestamps < entry.ordinals || entry.values < entry.timestamps ||
+                entry.tags < entry.values || entry.end < entry.tags || entry.end > footer_offset ||
+                (entry.rows > 0 && entry.tags - entry.values < 8)) {
+                return false;
+            }
+            previous_end = entry.end;
+            series_.push_back(entry);
+        }
+        return footer.remaining() == 0;
+    }
+
+    const std::vector<std::string_view>& strings() const noexcept { return strings_; }
+    const std::vector<columnar_series_index>& series() const noexcept { return series_; }
+
+    std::string_view name_of(const columnar_series_index& entry) const noexcept {
+        return strings_[static_cast<size_t>(entry.name_id)];
+    }
+
+    /**
+     * @brief Decode one series' timestamp and value columns
+     *
+     * Calls fn(time_point, value) per row; the ordinal and tag columns are
+     * not touched.
+     */
+    template<typename Fn>
+    bool for_each_value(const columnar_series_index& entry, Fn&& fn) const {
+        if (entry.rows == 0) {
+            return true;
+        }
+        byte_reader times(data_ + entry.timestamps, static_cast<size_t>(entry.values - entry.timestamps));
+        chunk_bit_reader bits(data_ + entry.values, static_cast<size_t>(entry.tags - entry.values) * 8);
+
+        const uint64_t first_bits = bits.read_bits(64);
+        xor_value_decoder values(first_bits);
+        int64_t time = 0;
+        int64_t delta = 0;
+        for (uint64_t i = 0; i < entry.rows; ++i) {
+            int64_t dod = 0;
+            if (!times.get_signed(dod)) {
+                return false;
+            }
+            delta += dod;
+            time += delta;
+            const uint64_t value_bits = i == 0 ? first_bits : values.read(bits);
+            fn(from_unix_nanos(time), std::bit_cast<double>(value_bits));
+        }
+        return times.remaining() == 0;
+    }
+
+    /**
+     * @brief Rebuild the @p count snapshots of the block
+     */
+    std::optional<std::vector<metrics_snapshot>> decode(size_t count) const {
+        std::vector<metrics_snapshot> snapshots(count);
+
+        byte_reader reader(data_ + snapshots_offset_, size_ - 4 - snapshots_offset_);
+        int64_t capture = 0;
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            int64_t delta = 0;
+            uint64_t source = 0;
+            uint64_t metric_count = 0;
+            if (!reader.get_signed(delta) || !reader.get_varint(source) || source >= strings_.size() ||
+                !reader.get_varint(metric_count) || metric_count > size_) {
+                return std::nullopt;
+            }
+            capture += delta;
+            snapshots[i].capture_time = from_unix_nanos(capture);
+            snapshots[i].source_id = std::string(strings_[static_cast<size_t>(source)]);
+            snapshots[i].metrics.resize(static_cast<size_t>(metric_count));
+            total += static_cast<size_t>(metric_count);
+        }
+
+        std::vector<metric_value*> by_ordinal;
+        by_ordinal.reserve(total);
+        for (auto& snapshot : snapshots) {
+            for (auto& metric : snapshot.metrics) {
+                by_ordinal.push_back(&metric);
+            }
+        }
+
+        std::vector<metric_value*> rows;
+        size_t assigned = 0;
+        for (const auto& entry : series_) {
+            rows.clear();
+            byte_reader ordinals(data_ + entry.ordinals, static_cast<size_t>(entry.timestamps - entry.ordinals));
+            uint64_t ordinal = 0;
+            for (uint64_t i = 0; i < entry.rows; ++i) {
+                uint64_t delta = 0;
+                if (!ordinals.get_varint(delta) || (i > 0 && delta == 0) || (ordinal += delta) >= total) {
+                    return std::nullopt;
+                }
+                rows.push_back(by_ordinal[static_cast<size_t>(ordinal)]);
+            }
+
+            const std::string name(name_of(entry));
+            size_t row = 0;
+            const bool values_ok = for_each_value(entry, [&](std::chrono::system_clock::time_point time, double value) {
+                rows[row]->name = name;
+                rows[row]->timestamp = time;
+                rows[row]->value = value;
+                ++row;
+            });
+            if (!values_ok) {
+                return std::nullopt;
+            }
+
+            byte_reader tags(data_ + entry.tags, static_cast<size_t>(entry.end - entry.tags));
+            for (auto* metric : rows) {
+                uint64_t tag_count = 0;
+                if (!tags.get_varint(tag_count) || tag_count > tags.remaining()) {
+                    return std::nullopt;
+                }
+                for (uint64_t t = 0; t < tag_count; ++t) {
+                    uint64_t key = 0;
+                    uint64_t value = 0;
+                    if (!tags.get_varint(key) || !tags.get_varint(value) ||
+                        key >= strings_.size() || value >= strings_.size()) {
+                        return std::nullopt;
+                    }
+                    metric->tags.emplace(std::string(strings_[static_cast<size_t>(key)]),
+                                         std::string(strings_[static_cast<size_t>(value)]));
+                }
+            }
+            assigned += rows.size();
+        }
+
+        if (assigned != total) {
+            return std::nullopt;
+        }
+        return snapshots;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t snapshots_offset_ = 0;
+    std::vector<std::string_view> strings_;
+    std::vector<columnar_series_index> series_;
+};
+
+} // namespace detail
+
+} // namespace kcenon::monitoring
@@ -0,0 +1,797 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file metric_wal.h
+ * @brief Write-ahead log with group commit for metric_storage durability
+ *
+ * On-disk layout:
+ * - a directory of log segments named `<sequence, 20 digits>.wal`;
+ * - each segment starts with a 24-byte header (magic, format version,
+ *   sequence) followed by frames;
+ * - a frame is a 24-byte header (magic, payload length, sample count,
+ *   CRC-32 of the payload, newest sample timestamp) followed by records.
+ *   A frame is self-contained: it defines every metric name it uses once
+ *   and refers to it by a small id afterwards.
+ *
+ * Writers only encode their record into the open frame and receive a log
+ * sequence number (LSN). A single commit thread writes the open frame and
+ * issues one fdatasync for it once the durability window elapses (or the
+ * frame grows past max_pending_bytes), so concurrent writers share the
+ * cost of a sync instead of paying one each. Writers that need durability
+ * wait for their LSN to be committed.
+ *
+ * On open, frames are validated in order and a torn or corrupt tail is
+ * truncated. Appends always go to a fresh segment; replay() feeds the
+ * recovered records back to the owner. Closed segments whose newest sample
+ * is older than the retention period are deleted.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "kcenon/monitoring/core/result_types.h"
+#include "kcenon/monitoring/core/error_codes.h"
+#include "kcenon/monitoring/storage/binary_codec.h"
+#include "kcenon/monitoring/utils/metric_types.h"
+
+namespace kcenon::monitoring {
+
+/**
+ * @brief Configuration for metric_wal
+ */
+struct metric_wal_config {
+    std::string directory;                                ///< Directory holding log segments
+    std::chrono::milliseconds commit_interval{10};        ///< Durability window of a group commit
+    size_t max_pending_bytes{1024 * 1024};                ///< Commit early once a frame reaches this size
+    size_t segment_size_bytes{16 * 1024 * 1024};          ///< Rotate once a segment reaches this size
+    std::chrono::seconds segment_max_age{600};            ///< Rotate segments older than this
+    std::chrono::seconds retention_period{3600};          ///< Drop closed segments with only older samples
+    bool sync_on_commit{true};                            ///< fdatasync after each written frame
+
+    /**
+     * @brief Validate configuration
+     */
+    common::VoidResult validate() const {
+        if (directory.empty()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "WAL directory must not be empty").to_common_error());
+        }
+        if (commit_interval.count() <= 0 || max_pending_bytes == 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "WAL commit interval and pending bytes must be positive").to_common_error());
+        }
+        if (segment_size_bytes < 4096) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "WAL segment size must be at least 4096 bytes").to_common_error());
+        }
+        if (segment_max_age.count() <= 0 || retention_period.count() <= 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "WAL segment age and retention period must be positive").to_common_error());
+        }
+        return common::ok();
+    }
+};
+
+/**
+ * @brief Counters reported by metric_wal
+ */
+struct metric_wal_stats {
+    uint64_t appended_records{0};
+    uint64_t committed_records{0};   ///< Records written (and synced) to disk
+    uint64_t commits{0};             ///< Frames written; one sync each
+    uint64_t syncs{0};
+    uint64_t bytes_written{0};
+    size_t segments{0};              ///< Segment files on disk
+    size_t segments_removed{0};      ///< Dropped by retention
+    uint64_t replayed_records{0};
+    size_t recovered_bytes{0};       ///< Torn or corrupt tail bytes truncated on open
+    size_t failed_commits{0};
+};
+
+/**
+ * @class metric_wal
+ * @brief Group-committed write-ahead log of compact_metric_value records
+ *
+ * @thread_safety All public methods are thread-safe.
+ */
+class metric_wal {
+public:
+    static constexpr uint64_t segment_magic = 0x4C41574E4F4D4BULL;  // "KMONWAL"
+    static constexpr uint16_t format_version = 1;
+    static constexpr size_t segment_header_size = 24;
+    static constexpr uint32_t frame_magic = 0x4C41574Du;            // "MWAL"
+    static constexpr size_t frame_header_size = 24;
+
+    using replay_handler = std::function<void(const std::string& name, const compact_metric_value& metric)>;
+
+    /**
+     * @brief Open (or create) a log, recovering existing segments
+     */
+    static common::Result<std::unique_ptr<metric_wal>> create(const metric_wal_config& config) {
+        auto validation = config.validate();
+        if (validation.is_err()) {
+            return common::Result<std::unique_ptr<metric_wal>>::err(validation.error());
+        }
+
+        std::unique_ptr<metric_wal> wal(new metric_wal(config));
+        auto opened = wal->open();
+        if (opened.is_err()) {
+            return common::Result<std::unique_ptr<metric_wal>>::err(opened.error());
+        }
+        wal->commit_thread_ = std::thread(&metric_wal::commit_loop, wal.get());
+        return common::ok(std::move(wal));
+    }
+
+    /**
+     * @brief Commit everything appended so far and close the log
+     */
+    ~metric_wal() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        commit_cv_.notify_one();
+        if (commit_thread_.joinable()) {
+            commit_thread_.join();
+        }
+        close_active();
+    }
+
+    metric_wal(const metric_wal&) = delete;
+    metric_wal& operator=(const metric_wal&) = delete;
+
+    /**
+     * @brief Append a record to the open frame
+     * @return LSN of the record, to be passed to wait_for_commit()
+     */
+    common::Result<uint64_t> append(const std::string& name, const compact_metric_value& metric) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return common::Result<uint64_t>::err(error_info(monitoring_error_code::storage_not_initialized,
+                "WAL is closing").to_common_error());
+        }
+
+        detail::byte_writer writer(pending_);
+        auto [name_it, inserted] = frame_names_.try_emplace(name, static_cast<uint32_t>(frame_names_.size()));
+        if (inserted) {
+            writer.put_u8(record_name);
+            writer.put_varint(name_it->second);
+            writer.put_string(name);
+        }
+
+        writer.put_u8(record_sample);
+        writer.put_varint(name_it->second);
+        writer.put_u8(static_cast<uint8_t>(metric.metadata.type));
+        writer.put_u8(static_cast<uint8_t>(metric.value.index()));
+        if (const auto* d = std::get_if<double>(&metric.value)) {
+            writer.put_double(*d);
+        } else if (const auto* i = std::get_if<int64_t>(&metric.value)) {
+            writer.put_signed(*i);
+        } else {
+            writer.put_string(std::get<std::string>(metric.value));
+        }
+
+        // Timestamps are zigzag deltas from the previous sample of the frame
+        const auto timestamp = static_cast<int64_t>(metric.timestamp_us);
+        writer.put_signed(timestamp - frame_last_timestamp_);
+        frame_last_timestamp_ = timestamp;
+        frame_newest_timestamp_ = (std::max)(frame_newest_timestamp_, timestamp);
+
+        const uint64_t lsn = ++appended_lsn_;
+        const bool first = pending_count_++ == 0;
+        ++stats_.appended_records;
+
+        const bool full = pending_.size() >= config_.max_pending_bytes && !commit_requested_;
+        if (full) {
+            commit_requested_ = true;
+        }
+        lock.unlock();
+        if (first || full) {
+            commit_cv_.notify_one();
+        }
+        return common::ok(lsn);
+    }
+
+    /**
+     * @brief Block until the record with @p lsn is on disk
+     * @return Error if the frame holding the record could not be written
+     */
+    common::VoidResult wait_for_commit(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        durable_cv_.wait(lock, [this, lsn] { return committed_lsn_ >= lsn; });
+        if (in_failed_range(lsn)) {
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_write_failed,
+                "WAL commit failed").to_common_error());
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Block until every record in @p lsns is on disk
+     * @return Number of those records whose frame could not be written
+     */
+    size_t wait_for_commits(const std::vector<uint64_t>& lsns) {
+        if (lsns.empty()) {
+            return 0;
+        }
+        const uint64_t last = *std::max_element(lsns.begin(), lsns.end());
+        std::unique_lock<std::mutex> lock(mutex_);
+        durable_cv_.wait(lock, [this, last] { return committed_lsn_ >= last; });
+        return static_cast<size_t>(std::count_if(lsns.begin(), lsns.end(),
+            [this](uint64_t lsn) { return in_failed_range(lsn); }));
+    }
+
+    /**
+     * @brief Commit the open frame now and wait for it
+     */
+    common::VoidResult sync() {
+        uint64_t target = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            target = appended_lsn_;
+            commit_requested_ = true;
+        }
+        commit_cv_.notify_one();
+        return wait_for_commit(target);
+    }
+
+    /**
+     * @brief Feed every record recovered on open to @p handler, oldest first
+     * @return Number of records replayed
+     */
+    common::Result<size_t> replay(const replay_handler& handler) {
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+
+        size_t replayed = 0;
+        for (const auto& segment : closed_) {
+            if (!segment.recovered) {
+                continue;
+            }
+            detail::mapped_file map;
+            if (!map.map(segment.path, segment.bytes)) {
+                return common::Result<size_t>::err(error_info(monitoring_error_code::storage_read_failed,
+                    "Cannot map WAL segment " + segment.path).to_common_error());
+            }
+
+            size_t offset = segment_header_size;
+            while (offset < segment.bytes) {
+                detail::byte_reader header(map.data() + offset, frame_header_size);
+                uint32_t magic = 0;
+                uint32_t length = 0;
+                header.get_u32(magic);
+                header.get_u32(length);
+
+                auto decoded = decode_frame(map.data() + offset + frame_header_size, length, handler);
+                if (!decoded) {
+                    return common::Result<size_t>::err(error_info(monitoring_error_code::storage_corrupted,
+                        "Corrupt WAL frame in " + segment.path).to_common_error());
+                }
+                replayed += *decoded;
+                offset += frame_header_size + length;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.replayed_records += replayed;
+        return common::ok(replayed);
+    }
+
+    /**
+     * @brief Discard pending records and delete every segment
+     */
+    common::VoidResult clear() {
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reset_frame_locked();
+            committed_lsn_ = appended_lsn_;
+        }
+        durable_cv_.notify_all();
+
+        close_active();
+        std::error_code ec;
+        for (const auto& segment : closed_) {
+            std::filesystem::remove(segment.path, ec);
+        }
+        closed_.clear();
+        std::filesystem::remove(active_path_, ec);
+        return start_segment();
+    }
+
+    metric_wal_stats get_stats() const {
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        metric_wal_stats stats = stats_;
+        stats.segments = closed_.size() + (active_file_ != nullptr ? 1 : 0);
+        return stats;
+    }
+
+    const metric_wal_config& get_config() const noexcept { return config_; }
+
+private:
+    static constexpr uint8_t record_name = 1;    // id, name
+    static constexpr uint8_t record_sample = 2;  // id, type, value kind, value, timestamp delta
+
+    struct segment_file {
+        std::string path;
+        size_t bytes{0};
+        int64_t newest_timestamp_us{0};
+        bool recovered{false};
+    };
+
+    explicit metric_wal(const metric_wal_config& config) : config_(config) {}
+
+    static std::string segment_file_name(uint64_t sequence) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%020llu.wal", static_cast<unsigned long long>(sequence));
+        return name;
+    }
+
+    static std::optional<uint64_t> parse_segment_name(const std::string& name) {
+        if (name.size() != 24 || name.compare(20, 4, ".wal") != 0) {
+            return std::nullopt;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < 20; ++i) {
+            if (name[i] < '0' || name[i] > '9') {
+                return std::nullopt;
+            }
+            value = value * 10 + static_cast<uint64_t>(name[i] - '0');
+        }
+        return value;
+    }
+
+    static common::VoidResult io_error(const std::string& message) {
+        return common::VoidResult::err(error_info(monitoring_error_code::storage_write_failed,
+            message).to_common_error());
+    }
+
+    /**
+     * @brief Decode one frame payload, calling @p handler per sample
+     * @return Number of samples, nullopt if the payload is malformed
+     */
+    static std::optional<size_t> decode_frame(const uint8_t* data, size_t size,
+                                              const replay_handler& handler) {
+        detail::byte_reader reader(data, size);
+        std::vector<std::string> names;
+        int64_t timestamp = 0;
+        size_t samples = 0;
+
+        while (reader.remaining() > 0) {
+            uint8_t kind = 0;
+            uint64_t id = 0;
+            if (!reader.get_u8(kind) || !reader.get_varint(id)) {
+                return std::nullopt;
+            }
+
+            if (kind == record_name) {
+                std::string name;
+                if (id != names.size() || !reader.get_string(name)) {
+                    return std::nullopt;
+                }
+                names.push_back(std::move(name));
+                continue;
+            }
+
+            uint8_t type = 0;
+            uint8_t value_kind = 0;
+            if (kind != record_sample || id >= names.size() ||
+                !reader.get_u8(type) || !reader.get_u8(value_kind)) {
+                return std::nullopt;
+            }
+
+            compact_metric_value metric;
+            metric.metadata = metric_metadata(hash_metric_name(names[id]), static_cast<metric_type>(type));
+            bool ok = false;
+            if (value_kind == 0) {
+                double value = 0.0;
+                ok = reader.get_double(value);
+                metric.value = value;
+            } else if (value_kind == 1) {
+                int64_t value = 0;
+                ok = reader.get_signed(value);
+                metric.value = value;
+            } else if (value_kind == 2) {
+                std::string value;
+                ok = reader.get_string(value);
+                metric.value = std::move(value);
+            }
+
+            int64_t delta = 0;
+            if (!ok || !reader.get_signed(delta)) {
+                return std::nullopt;
+            }
+            timestamp += delta;
+            metric.timestamp_us = static_cast<uint64_t>(timestamp);
+
+            handler(names[id], metric);
+            ++samples;
+        }
+        return samples;
+    }
+
+    common::VoidResult open() {
+        std::error_code ec;
+        std::filesystem::create_directories(config_.directory, ec);
+        if (ec) {
+            return io_error("Cannot create WAL directory " + config_.directory + ": " + ec.message());
+        }
+
+        std::vector<std::pair<uint64_t, std::string>> found;
+        for (const auto& entry : std::filesystem::directory_iterator(config_.directory, ec)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+            if (auto sequence = parse_segment_name(entry.path().filename().string())) {
+                found.emplace_back(*sequence, entry.path().string());
+            }
+        }
+        if (ec) {
+            return io_error("Cannot list WAL directory " + config_.directory + ": " + ec.message());
+        }
+        std::sort(found.begin(), found.end());
+
+        for (auto& [sequence, path] : found) {
+            recover_segment(sequence, path);
+            next_sequence_ = sequence + 1;
+        }
+
+        enforce_retention();
+        return start_segment();
+    }
+
+    /**
+     * @brief Validate a segment's frames and truncate a bad tail
+     */
+    void recover_segment(uint64_t sequence, const std::string& path) {
+        std::error_code ec;
+        const auto file_size = static_cast<size_t>(std::filesystem::file_size(path, ec));
+        if (ec) {
+            return;
+        }
+
+        detail::mapped_file map;
+        if (file_size < segment_header_size || !map.map(path, file_size)) {
+            stats_.recovered_bytes += file_size;
+            std::filesystem::remove(path, ec);
+            return;
+        }
+
+        detail::byte_reader header(map.data(), segment_header_size);
+        uint64_t magic = 0;
+        uint32_t version = 0;
+        uint64_t stored_sequence = 0;
+        header.get_u64(magic);
+        header.get_u32(version);
+        header.skip(4);
+        header.get_u64(stored_sequence);
+        if (magic != segment_magic || (version & 0xFFFF) != format_version || stored_sequence != sequence) {
+            stats_.recovered_bytes += file_size;
+            map.reset();
+            std::filesystem::remove(path, ec);
+            return;
+        }
+
+        segment_file segment;
+        segment.path = path;
+        segment.recovered = true;
+
+        size_t offset = segment_header_size;
+        while (file_size - offset >= frame_header_size) {
+            detail::byte_reader frame(map.data() + offset, frame_header_size);
+            uint32_t frame_magic_value = 0;
+            uint32_t length = 0;
+            uint32_t count = 0;
+            uint32_t crc = 0;
+            uint64_t newest = 0;
+            frame.get_u32(frame_magic_value);
+            frame.get_u32(length);
+            frame.get_u32(count);
+            frame.get_u32(crc);
+            frame.get_u64(newest);
+
+            const size_t payload_offset = offset + frame_header_size;
+            if (frame_magic_value != frame_magic || count == 0 || length > file_size - payload_offset ||
+                detail::crc32(map.data() + payload_offset, length) != crc) {
+                break;
+            }
+            segment.newest_timestamp_us = (std::max)(segment.newest_timestamp_us, static_cast<int64_t>(newest));
+            offset = payload_offset + length;
+        }
+
+        segment.bytes = offset;
+        map.reset();
+        if (offset < file_size) {
+            stats_.recovered_bytes += file_size - offset;
+            std::filesystem::resize_file(path, offset, ec);
+        }
+        closed_.push_back(std::move(segment));
+    }
+
+    /**
+     * @brief Create a fresh active segment at next_sequence_
+     * @note Caller holds io_mutex_ or is the constructor
+     */
+    common::VoidResult start_segment() {
+        active_path_ = (std::filesystem::path(config_.directory) / segment_file_name(next_sequence_)).string();
+
+        std::vector<uint8_t> header;
+        detail::byte_writer writer(header);
+        writer.put_u64(segment_magic);
+        writer.put_u32(format_version);
+        writer.put_u32(0);
+        writer.put_u64(next_sequence_);
+
+        active_file_ = std::fopen(active_path_.c_str(), "wb");
+        if (active_file_ == nullptr) {
+            return io_error("Cannot create WAL segment " + active_path_);
+        }
+        if (std::fwrite(header.data(), 1, header.size(), active_file_) != header.size() ||
+            std::fflush(active_file_) != 0) {
+            close_active();
+            return io_error("Cannot write WAL segment header " + active_path_);
+        }
+
+        ++next_sequence_;
+        active_bytes_ = header.size();
+        active_created_ = std::chrono::system_clock::now();
+        active_newest_timestamp_us_ = 0;
+        return common::ok();
+    }
+
+    void close_active() {
+        if (active_file_ != nullptr) {
+            std::fclose(active_file_);
+            active_file_ = nullptr;
+        }
+    }
+
+    bool sync_active() {
+#ifdef MONITORING_HAS_MMAP
+        if (config_.sync_on_commit) {
+#if defined(__linux__)
+            return ::fdatasync(::fileno(active_file_)) == 0;
+#else
+            return ::fsync(::fileno(active_file_)) == 0;
+#endif
+        }
+#endif
+        return true;
+    }
+
+    /**
+     * @brief Commit thread: one write and one sync per durability window
+     */
+    void commit_loop() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                commit_cv_.wait(lock, [this] { return stopping_ || pending_count_ > 0; });
+                if (pending_count_ == 0) {
+                    return;
+                }
+                // The window opens with the first record of the frame
+                commit_cv_.wait_for(lock, config_.commit_interval,
+                                    [this] { return stopping_ || commit_requested_; });
+            }
+            commit_pending();
+        }
+    }
+
+    void reset_frame_locked() {
+        pending_.clear();
+        frame_names_.clear();
+        pending_count_ = 0;
+        frame_last_timestamp_ = 0;
+        frame_newest_timestamp_ = 0;
+        commit_requested_ = false;
+    }
+
+    /**
+     * @brief Write the open frame as one unit and publish its LSNs
+     */
+    void commit_pending() {
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+
+        std::vector<uint8_t> payload;
+        uint32_t count = 0;
+        int64_t newest = 0;
+        uint64_t first_lsn = 0;
+        uint64_t last_lsn = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_count_ == 0) {
+                return;
+            }
+            payload.swap(pending_);
+            pending_.reserve(payload.capacity());
+            count = static_cast<uint32_t>(pending_count_);
+            newest = frame_newest_timestamp_;
+            last_lsn = appended_lsn_;
+            first_lsn = last_lsn - count + 1;
+            reset_frame_locked();
+        }
+
+        const bool written = write_frame(payload, count, newest);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            committed_lsn_ = last_lsn;
+            if (written) {
+                stats_.committed_records += count;
+                ++stats_.commits;
+                stats_.bytes_written += frame_header_size + payload.size();
+                if (config_.sync_on_commit) {
+                    ++stats_.syncs;
+                }
+            } else {
+                record_failed_range(first_lsn, last_lsn);
+                ++stats_.failed_commits;
+            }
+        }
+        durable_cv_.notify_all();
+
+        if (written && (active_bytes_ >= config_.segment_size_bytes ||
+                        std::chrono::system_clock::now() - active_created_ >= config_.segment_max_age)) {
+            rotate();
+        }
+    }
+
+    /**
+     * @note Caller holds io_mutex_
+     */
+    bool write_frame(const std::vector<uint8_t>& payload, uint32_t count, int64_t newest) {
+        if (active_file_ == nullptr && start_segment().is_err()) {
+            return false;
+        }
+
+        std::vector<uint8_t> header;
+        header.reserve(frame_header_size);
+        detail::byte_writer writer(header);
+        writer.put_u32(frame_magic);
+        writer.put_u32(static_cast<uint32_t>(payload.size()));
+        writer.put_u32(count);
+        writer.put_u32(detail::crc32(payload.data(), payload.size()));
+        writer.put_u64(static_cast<uint64_t>(newest));
+
+        const bool written =
+            std::fwrite(header.data(), 1, header.size(), active_file_) == header.size() &&
+            std::fwrite(payload.data(), 1, payload.size(), active_file_) == payload.size() &&
+            std::fflush(active_file_) == 0 && sync_active();
+        if (!written) {
+            discard_partial_frame();
+            return false;
+        }
+
+        active_bytes_ += header.size() + payload.size();
+        active_newest_timestamp_us_ = (std::max)(active_newest_timestamp_us_, newest);
+        return true;
+    }
+
+    /**
+     * @brief Cut a failed frame off the active segment
+     *
+     * The stream is closed before truncating, since its position and
+     * buffer still point past the valid prefix, and reopened for append so
+     * the next frame follows the last committed one. If the segment cannot
+     * be repaired it is sealed and writing continues in a new segment.
+     *
+     * @note Caller holds io_mutex_
+     */
+    void discard_partial_frame() {
+        close_active();
+        std::error_code ec;
+        std::filesystem::resize_file(active_path_, active_bytes_, ec);
+        if (!ec) {
+            active_file_ = std::fopen(active_path_.c_str(), "ab");
+        }
+        if (active_file_ == nullptr) {
+            closed_.push_back({active_path_, active_bytes_, active_newest_timestamp_us_, false});
+            (void)start_segment();
+        }
+    }
+
+    /**
+     * @note Caller holds mutex_
+     */
+    void record_failed_range(uint64_t first_lsn, uint64_t last_lsn) {
+        // Frames commit in LSN order, so ranges arrive sorted; merge adjacent ones
+        if (!failed_ranges_.empty() && failed_ranges_.back().second + 1 == first_lsn) {
+            failed_ranges_.back().second = last_lsn;
+        } else {
+            failed_ranges_.emplace_back(first_lsn, last_lsn);
+        }
+    }
+
+    /**
+     * @note Caller holds mutex_
+     */
+    bool in_failed_range(uint64_t lsn) const {
+        auto it = std::upper_bound(failed_ranges_.begin(), failed_ranges_.end(), lsn,
+            [](uint64_t value, const std::pair<uint64_t, uint64_t>& range) {
+                return value < range.first;
+            });
+        return it != failed_ranges_.begin() && lsn <= std::prev(it)->second;
+    }
+
+    /**
+     * @note Caller holds io_mutex_
+     */
+    void rotate() {
+        close_active();
+        closed_.push_back({active_path_, active_bytes_, active_newest_timestamp_us_, false});
+        enforce_retention();
+        (void)start_segment();
+    }
+
+    /**
+     * @brief Delete closed segments whose newest sample is past retention
+     *
+     * Segments are checked oldest first and deletion stops at the first one
+     * still holding live samples, so replay order is preserved.
+     */
+    void enforce_retention() {
+        const int64_t cutoff = std::chrono::duration_cast<std::chrono::microseconds>(
+            (std::chrono::system_clock::now() - config_.retention_period).time_since_epoch()).count();
+
+        std::error_code ec;
+        while (!closed_.empty() && closed_.front().newest_timestamp_us < cutoff) {
+            std::filesystem::remove(closed_.front().path, ec);
+            closed_.pop_front();
+            ++stats_.segments_removed;
+        }
+    }
+
+    metric_wal_config config_;
+
+    // Writer state, guarded by mutex_
+    mutable std::mutex mutex_;
+    std::condition_variable commit_cv_;
+    std::condition_variable durable_cv_;
+    std::vector<uint8_t> pending_;                         // Payload of the open frame
+    std::unordered_map<std::string, uint32_t> frame_names_;
+    size_t pending_count_{0};
+    int64_t frame_last_timestamp_{0};
+    int64_t frame_newest_timestamp_{0};
+    uint64_t appended_lsn_{0};
+    uint64_t committed_lsn_{0};
+    std::vector<std::pair<uint64_t, uint64_t>> failed_ranges_;  // LSNs of failed frames, ascending
+    bool commit_requested_{false};
+    bool stopping_{false};
+    metric_wal_stats stats_;
+
+    // File state, guarded by io_mutex_ (taken before mutex_)
+    mutable std::mutex io_mutex_;
+    std::deque<segment_file> closed_;                      // Oldest first
+    std::string active_path_;
+    std::FILE* active_file_{nullptr};
+    size_t active_bytes_{0};
+    int64_t active_newest_timestamp_us_{0};
+    std::chrono::system_clock::time_point active_created_;
+    uint64_t next_sequence_{0};
+
+    std::thread commit_thread_;
+};
+
+} // namespace kcenon::monitoring
@@ -0,0 +1,1756 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file segment_store.h
+ * @brief Append-only segment file engine for metrics snapshot persistence
+ *
+ * On-disk layout:
+ * - a directory of segment files named `<base sequence, 20 digits>.seg`;
+ * - each segment starts with a 32-byte header (magic, format version, base
+ *   sequence, creation time) followed by blocks;
+ * - a block is a 16-byte header (magic, payload length, record count and
+ *   CRC-32 of the payload) followed by either length-prefixed records, one
+ *   per snapshot ("MBLK"), or a columnar payload holding all of the block's
+ *   snapshots ("MCOL", see columnar_block.h). With compression enabled,
+ *   either payload is wrapped as "MCMP": inner magic, codec, uncompressed
+ *   size and the compressed bytes (see block_compression.h). A store may
+ *   mix all three.
+ *
+ * Snapshots are appended to an open in-memory block that is written as a
+ * unit on flush, when it reaches block_records, or when the segment
+ * rotates. Segments rotate on size and age. On open, blocks are validated
+ * in order and a torn or corrupt tail is truncated, so a crash loses at
+ * most the unflushed block. Reads decode records straight from read-only
+ * memory maps of the segment files; scan_metrics() reads only the value
+ * columns of the requested metrics from columnar blocks.
+ *
+ * compact() (and the background compactor, when compaction_interval is
+ * set) maintains the closed segments: it deletes segments older than
+ * retention_period, rewrites segments older than rollup_after into rollup
+ * segments holding one mean per metric and resolution bucket, and merges
+ * runs of small adjacent segments. Rewrites read and write outside the
+ * store lock under an I/O budget, land in a temporary file that is synced
+ * and renamed over the first input, and record the sequence range they
+ * cover in the header, so inputs left behind by a crash are recognized as
+ * superseded on open.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "kcenon/monitoring/core/result_types.h"
+#include "kcenon/monitoring/core/error_codes.h"
+#include "kcenon/monitoring/interfaces/monitoring_core.h"
+#include "kcenon/monitoring/storage/binary_codec.h"
+#include "kcenon/monitoring/storage/block_compression.h"
+#include "kcenon/monitoring/storage/columnar_block.h"
+
+namespace kcenon::monitoring {
+
+namespace detail {
+
+/**
+ * @brief Serialize a snapshot into the compact record format
+ *
+ * capture_time as fixed 8 bytes, then varint-prefixed strings; metric
+ * timestamps are zigzag deltas from capture_time.
+ */
+inline void encode_snapshot_record(const metrics_snapshot& snapshot, std::vector<uint8_t>& out) {
+    byte_writer writer(out);
+    const int64_t capture_ns = to_unix_nanos(snapshot.capture_time);
+    writer.put_u64(static_cast<uint64_t>(capture_ns));
+    writer.put_string(snapshot.source_id);
+    writer.put_varint(snapshot.metrics.size());
+    for (const auto& metric : snapshot.metrics) {
+        writer.put_string(metric.name);
+        writer.put_double(metric.value);
+        writer.put_signed(to_unix_nanos(metric.timestamp) - capture_ns);
+        writer.put_varint(metric.tags.size());
+        for (const auto& [key, value] : metric.tags) {
+            writer.put_string(key);
+            writer.put_string(value);
+        }
+    }
+}
+
+/**
+ * @brief Decode a record produced by encode_snapshot_record()
+ */
+inline std::optional<metrics_snapshot> decode_snapshot_record(const uint8_t* data, size_t size) {
+    byte_reader reader(data, size);
+    metrics_snapshot snapshot;
+
+    uint64_t capture_bits;
+    uint64_t metric_count;
+    if (!reader.get_u64(capture_bits) || !reader.get_string(snapshot.source_id) ||
+        !reader.get_varint(metric_count) || metric_count > reader.remaining()) {
+        return std::nullopt;
+    }
+    const auto capture_ns = static_cast<int64_t>(capture_bits);
+    snapshot.capture_time = from_unix_nanos(capture_ns);
+
+    snapshot.metrics.reserve(static_cast<size_t>(metric_count));
+    for (uint64_t i = 0; i < metric_count; ++i) {
+        metric_value metric;
+        int64_t delta;
+        uint64_t tag_count;
+        if (!reader.get_string(metric.name) || !reader.get_double(metric.value) ||
+            !reader.get_signed(delta) || !reader.get_varint(tag_count)) {
+            return std::nullopt;
+        }
+        metric.timestamp = from_unix_nanos(capture_ns + delta);
+        for (uint64_t t = 0; t < tag_count; ++t) {
+            std::string key;
+            std::string value;
+            if (!reader.get_string(key) || !reader.get_string(value)) {
+                return std::nullopt;
+            }
+            metric.tags.emplace(std::move(key), std::move(value));
+        }
+        snapshot.metrics.push_back(std::move(metric));
+    }
+
+    if (reader.remaining() != 0) {
+        return std::nullopt;
+    }
+    return snapshot;
+}
+
+} // namespace detail
+
+/**
+ * @brief Encoding of the blocks a segment_store writes
+ */
+enum class segment_block_format {
+    row,        ///< One length-prefixed record per snapshot
+    columnar    ///< Dictionary-encoded columns per block, for analytical scans
+};
+
+/**
+ * @brief Configuration for segment_store
+ */
+struct segment_store_config {
+    std::string directory;                                ///< Directory holding segment files
+    size_t segment_size_bytes{8 * 1024 * 1024};           ///< Rotate once a segment reaches this size
+    std::chrono::seconds segment_max_age{3600};           ///< Rotate segments older than this
+    size_t max_total_bytes{0};                            ///< Drop oldest segments beyond this (0 = unlimited)
+    size_t max_records{0};                                ///< Retain at most this many snapshots (0 = unlimited)
+    size_t block_records{100};                            ///< Write the open block at this many records
+    bool sync_on_flush{true};                             ///< fsync after each written block
+    segment_block_format block_format{segment_block_format::row};  ///< Encoding of new blocks
+    compression_algorithm compression{compression_algorithm::none};  ///< Codec for new blocks
+    std::chrono::seconds retention_period{0};             ///< Compaction drops older data (0 = keep)
+    std::chrono::seconds rollup_after{0};                 ///< Compaction rolls up older segments (0 = never)
+    std::chrono::seconds rollup_resolution{60};           ///< Bucket width of rolled-up snapshots
+    size_t compaction_merge_bytes{1024 * 1024};           ///< Merge adjacent closed segments smaller than this
+    size_t compaction_io_bytes_per_sec{16 * 1024 * 1024}; ///< Compaction read + write budget (0 = unlimited)
+    std::chrono::milliseconds compaction_interval{0};     ///< Background compaction period (0 = compact() only)
+
+    /**
+     * @brief Validate configuration
+     */
+    common::VoidResult validate() const {
+        if (directory.empty()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Segment directory must not be empty").to_common_error());
+        }
+        if (segment_size_bytes < 4096) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Segment size must be at least 4096 bytes").to_common_error());
+        }
+        if (segment_max_age.count() <= 0 || block_records == 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Segment age and block records must be positive").to_common_error());
+        }
+        if (!detail::compression_available(compression)) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Compression algorithm is not available in this build").to_common_error());
+        }
+        if (retention_period.count() < 0 || rollup_after.count() < 0 || compaction_interval.count() < 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Retention, rollup age and compaction interval must not be negative").to_common_error());
+        }
+        if (rollup_after.count() > 0 && rollup_resolution.count() <= 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Rollup resolution must be positive").to_common_error());
+        }
+        return common::ok();
+    }
+};
+
+/**
+ * @brief Counters reported by segment_store
+ */
+struct segment_store_stats {
+    size_t records{0};               ///< Retained snapshots
+    size_t segments{0};              ///< Segment files on disk
+    size_t disk_bytes{0};            ///< Durable bytes across segments
+    size_t pending_records{0};       ///< Records in the unwritten block
+    size_t blocks_written{0};
+    size_t payload_bytes{0};         ///< Block payload bytes written, before compression
+    size_t stored_payload_bytes{0};  ///< Block payload bytes written, after compression
+    size_t segments_rotated{0};
+    size_t segments_removed{0};      ///< Dropped by retention limits
+    size_t recovered_bytes{0};       ///< Torn or corrupt tail bytes truncated on open
+    size_t corrupt_segments{0};      ///< Segments with an unreadable header, renamed to *.corrupt
+    size_t superseded_segments{0};   ///< Inputs of an interrupted compaction removed on open
+    size_t compactions{0};           ///< Compaction rewrites committed
+    size_t segments_compacted{0};    ///< Input segments replaced by compaction rewrites
+    size_t segments_expired{0};      ///< Dropped by retention_period
+    size_t snapshots_expired{0};     ///< Expired snapshots dropped while rewriting
+    size_t snapshots_rolled_up{0};   ///< Raw snapshots folded into rollup snapshots
+    size_t compaction_bytes_read{0};
+    size_t compaction_bytes_written{0};
+};
+
+/**
+ * @class segment_store
+ * @brief Append-only, crash-safe snapshot log split into segment files
+ *
+ * Snapshots are addressed by position: 0 is the oldest retained snapshot.
+ *
+ * @thread_safety All public methods are thread-safe.
+ */
+class segment_store {
+public:
+    static constexpr uint64_t segment_magic = 0x4745534E4F4D4BULL;  // "KMONSEG"
+    static constexpr uint16_t format_version = 1;
+    static constexpr uint32_t segment_flag_compacted = 1u << 16;   // Header covers a sequence range
+    static constexpr uint32_t segment_flag_rolled_up = 1u << 17;   // Holds rollup snapshots only
+    static constexpr size_t segment_header_size = 32;
+    static constexpr uint32_t block_magic = 0x4B4C424Du;            // "MBLK"
+    static constexpr uint32_t columnar_block_magic = 0x4C4F434Du;   // "MCOL"
+    static constexpr uint32_t compressed_block_magic = 0x504D434Du; // "MCMP"
+    static constexpr size_t block_header_size = 16;
+
+    /**
+     * @brief Open (or create) a store, recovering existing segments
+     */
+    static common::Result<std::unique_ptr<segment_store>> create(const segment_store_config& config) {
+        auto validation = config.validate();
+        if (validation.is_err()) {
+            return common::Result<std::unique_ptr<segment_store>>::err(validation.error());
+        }
+
+        std::unique_ptr<segment_store> store(new segment_store(config));
+        auto opened = store->open();
+        if (opened.is_err()) {
+            return common::Result<std::unique_ptr<segment_store>>::err(opened.error());
+        }
+        if (config.compaction_interval.count() > 0) {
+            store->compactor_ = std::thread(&segment_store::compaction_loop, store.get());
+        }
+        return common::ok(std::move(store));
+    }
+
+    ~segment_store() {
+        {
+            std::lock_guard<std::mutex> lock(compactor_mutex_);
+            stopping_ = true;
+        }
+        compactor_cv_.notify_all();
+        if (compactor_.joinable()) {
+            compactor_.join();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        (void)flush_locked();
+        close_active();
+    }
+
+    segment_store(const segment_store&) = delete;
+    segment_store& operator=(const segment_store&) = delete;
+
+    /**
+     * @brief Append a snapshot to the open block
+     */
+    common::VoidResult append(const metrics_snapshot& snapshot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        scratch_.clear();
+        detail::encode_snapshot_record(snapshot, scratch_);
+        const size_t framed = varint_size(scratch_.size()) + scratch_.size();
+
+        // Whole-block encodings happen on flush; the row size bounds them
+        auto& active = segments_.back();
+        const size_t pending_bytes = block_addressed() ? pending_estimate_ : pending_.size();
+        const bool full = active.durable_bytes + block_header_size + pending_bytes + framed >
+                          config_.segment_size_bytes;
+        const bool expired = std::chrono::system_clock::now() - active.created >= config_.segment_max_age;
+        if (active.record_count > 0 && (full || expired)) {
+            auto rotated = rotate_locked();
+            if (rotated.is_err()) {
+                return rotated;
+            }
+        }
+
+        auto& target = segments_.back();
+        if (block_addressed()) {
+            // Length is filled in once the block is written
+            records_.push_back({&target, target.durable_bytes + block_header_size, 0,
+                                static_cast<uint32_t>(pending_snapshots_.size())});
+            pending_snapshots_.push_back(snapshot);
+            pending_estimate_ += framed;
+        } else {
+            detail::byte_writer(pending_).put_varint(scratch_.size());
+            const uint64_t offset = target.durable_bytes + block_header_size + pending_.size();
+            pending_.insert(pending_.end(), scratch_.begin(), scratch_.end());
+            records_.push_back({&target, offset, static_cast<uint32_t>(scratch_.size()), row_slot});
+        }
+        ++target.record_count;
+        ++pending_count_;
+        ++next_sequence_;
+
+        common::VoidResult result = common::ok();
+        if (pending_count_ >= config_.block_records) {
+            result = flush_locked();
+        }
+        enforce_retention();
+        return result;
+    }
+
+    /**
+     * @brief Write the open block to disk
+     */
+    common::VoidResult flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return flush_locked();
+    }
+
+    /**
+     * @brief Read the snapshot at @p index (0 = oldest retained)
+     */
+    common::Result<metrics_snapshot> read(size_t index) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= records_.size()) {
+            return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::not_found,
+                "Snapshot index out of range").to_common_error());
+        }
+        return read_locked(records_[index]);
+    }
+
+    /**
+     * @brief Read up to @p count snapshots starting at @p start
+     */
+    common::Result<std::vector<metrics_snapshot>> read_range(size_t start, size_t count) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<metrics_snapshot> result;
+        const size_t end = start + (std::min)(count, records_.size() - (std::min)(start, records_.size()));
+        result.reserve(end > start ? end - start : 0);
+        for (size_t i = start; i < end; ++i) {
+            auto snapshot = read_locked(records_[i]);
+            if (snapshot.is_err()) {
+                return common::Result<std::vector<metrics_snapshot>>::err(snapshot.error());
+            }
+            result.push_back(std::move(snapshot.value()));
+        }
+        return common::ok(std::move(result));
+    }
+
+    /**
+     * @brief Stream the samples of selected metrics
+     * @param names Metric names to return; empty selects every metric
+     * @param fn Called as fn(const std::string& name, time_point timestamp, double value)
+     *
+     * Fully retained columnar blocks (compressed or not) decode only the
+     * timestamp and value columns of matching metrics; other blocks are
+     * decoded snapshot by snapshot. Samples come in block order, grouped by metric within a
+     * columnar block.
+     */
+    template<typename Fn>
+    common::VoidResult scan_metrics(const std::vector<std::string>& names, Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::unordered_set<std::string_view> wanted(names.begin(), names.end());
+        auto selected = [&wanted](std::string_view name) {
+            return wanted.empty() || wanted.count(name) > 0;
+        };
+
+        size_t index = 0;
+        while (index < records_.size()) {
+            const auto& ref = records_[index];
+            uint32_t magic = 0;
+            const uint8_t* payload = nullptr;
+            size_t payload_size = 0;
+            if (ref.slot == 0 && !is_pending(ref)) {
+                if (!block_payload(ref, magic, payload, payload_size, inflated_)) {
+                    return common::VoidResult::err(error_info(monitoring_error_code::storage_corrupted,
+                        "Cannot read block in " + ref.segment->path).to_common_error());
+                }
+            }
+
+            if (magic != columnar_block_magic) {
+                // Row record or block, open block or partially retained block
+                auto snapshot = read_locked(ref);
+                if (snapshot.is_err()) {
+                    return common::VoidResult::err(snapshot.error());
+                }
+                for (const auto& metric : snapshot.value().metrics) {
+                    if (selected(metric.name)) {
+                        fn(metric.name, metric.timestamp, metric.value);
+                    }
+                }
+                ++index;
+                continue;
+            }
+
+            detail::columnar_block_view view;
+            if (!view.parse(payload, payload_size)) {
+                return common::VoidResult::err(error_info(monitoring_error_code::storage_corrupted,
+                    "Cannot read columnar block in " + ref.segment->path).to_common_error());
+            }
+            for (const auto& entry : view.series()) {
+                if (!selected(view.name_of(entry))) {
+                    continue;
+                }
+                const std::string name(view.name_of(entry));
+                const bool decoded = view.for_each_value(entry,
+                    [&fn, &name](std::chrono::system_clock::time_point timestamp, double value) {
+                        fn(name, timestamp, value);
+                    });
+                if (!decoded) {
+                    return common::VoidResult::err(error_info(monitoring_error_code::storage_corrupted,
+                        "Corrupt columnar block in " + ref.segment->path).to_common_error());
+                }
+            }
+
+            while (index < records_.size() && records_[index].segment == ref.segment &&
+                   records_[index].offset == ref.offset) {
+                ++index;
+            }
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Number of retained snapshots
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return records_.size();
+    }
+
+    /**
+     * @brief Remove every snapshot and segment file
+     */
+    common::VoidResult clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_active();
+        records_.clear();
+        pending_.clear();
+        pending_snapshots_.clear();
+        pending_estimate_ = 0;
+        pending_count_ = 0;
+        decoded_block_ = {};
+
+        std::error_code ec;
+        for (auto& segment : segments_) {
+            segment.map.reset();
+            std::filesystem::remove(segment.path, ec);
+        }
+        segments_.clear();
+        return start_segment();
+    }
+
+    /**
+     * @brief Run one compaction pass over the closed segments
+     *
+     * Deletes closed segments whose successor was created before
+     * retention_period, then rewrites segments until none qualifies:
+     * segments whose successor is older than rollup_after become rollup
+     * segments, and runs of adjacent segments below compaction_merge_bytes
+     * are merged up to segment_size_bytes. Rewrites also drop snapshots
+     * captured before retention_period. Appends and reads proceed while a
+     * rewrite is read, encoded and written; only the final rename and index
+     * swap take the store lock.
+     */
+    common::VoidResult compact() {
+        std::lock_guard<std::mutex> pass(compaction_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expire_segments();
+        }
+
+        // Every rewrite removes a segment or a pending rollup, so this ends
+        while (true) {
+            compaction_job job;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!plan_compaction(job)) {
+                    return common::ok();
+                }
+            }
+            auto rewritten = run_compaction(job);
+            if (rewritten.is_err()) {
+                return common::VoidResult::err(rewritten.error());
+            }
+            if (!rewritten.value()) {
+                return common::ok();  // Shutting down, or the inputs changed underneath
+            }
+        }
+    }
+
+    segment_store_stats get_stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segment_store_stats stats = stats_;
+        stats.records = records_.size();
+        stats.segments = segments_.size();
+        stats.pending_records = pending_count_;
+        stats.disk_bytes = 0;
+        for (const auto& segment : segments_) {
+            stats.disk_bytes += segment.durable_bytes;
+        }
+        return stats;
+    }
+
+    const segment_store_config& get_config() const noexcept { return config_; }
+
+private:
+    struct segment_info {
+        uint64_t base_sequence{0};
+        std::string path;
+        std::chrono::system_clock::time_point created;
+        uint64_t durable_bytes{0};                  // Bytes written and flushed
+        size_t record_count{0};                     // Including records in the open block
+        uint64_t end_sequence{0};                   // Compacted: end of the covered sequence range
+        bool rolled_up{false};
+        mutable detail::mapped_file map;
+
+        uint64_t covered_end() const noexcept {
+            return (std::max)(end_sequence, base_sequence + record_count);
+        }
+    };
+
+    static constexpr uint32_t row_slot = 0xFFFFFFFFu;
+
+    struct record_ref {
+        const segment_info* segment;                // Stable: segments_ is a list
+        uint64_t offset;                            // Offset of the record (or columnar block payload)
+        uint32_t length;
+        uint32_t slot;                              // Snapshot index in a block-encoded block, else row_slot
+    };
+
+    /**
+     * @brief Most recently decoded slot-addressed block, for sequential reads
+     */
+    struct decoded_block {
+        const segment_info* segment{nullptr};
+        uint64_t offset{0};
+        std::vector<metrics_snapshot> snapshots;
+    };
+
+    bool columnar() const noexcept {
+        return config_.block_format == segment_block_format::columnar;
+    }
+
+    /**
+     * @brief Whether new blocks are encoded as a unit on flush
+     *
+     * Their records are then addressed by slot within the block instead of
+     * by byte offset.
+     */
+    bool block_addressed() const noexcept {
+        return columnar() || config_.compression != compression_algorithm::none;
+    }
+
+    explicit segment_store(const segment_store_config& config) : config_(config) {}
+
+    static size_t varint_size(uint64_t v) noexcept {
+        size_t n = 1;
+        while (v >= 0x80) {
+            v >>= 7;
+            ++n;
+        }
+        return n;
+    }
+
+    static std::string segment_file_name(uint64_t base_sequence) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%020llu.seg", static_cast<unsigned long long>(base_sequence));
+        return name;
+    }
+
+    static std::optional<uint64_t> parse_segment_name(const std::string& name) {
+        if (name.size() != 24 || name.compare(20, 4, ".seg") != 0) {
+            return std::nullopt;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < 20; ++i) {
+            if (name[i] < '0' || name[i] > '9') {
+                return std::nullopt;
+            }
+            value = value * 10 + static_cast<uint64_t>(name[i] - '0');
+        }
+        return value;
+    }
+
+    static common::VoidResult io_error(const std::string& message) {
+        return common::VoidResult::err(error_info(monitoring_error_code::storage_write_failed,
+            message).to_common_error());
+    }
+
+    common::VoidResult open() {
+        std::error_code ec;
+        std::filesystem::create_directories(config_.directory, ec);
+        if (ec) {
+            return io_error("Cannot create segment directory " + config_.directory + ": " + ec.message());
+        }
+
+        std::vector<std::pair<uint64_t, std::string>> found;
+        for (const auto& entry : std::filesystem::directory_iterator(config_.directory, ec)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+            const auto name = entry.path().filename().string();
+            if (auto base = parse_segment_name(name)) {
+                found.emplace_back(*base, entry.path().string());
+            } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0 &&
+                       parse_segment_name(name.substr(0, name.size() - 4))) {
+                // Unfinished compaction output; its inputs are still in place
+                std::error_code remove_ec;
+                std::filesystem::remove(entry.path(), remove_ec);
+            }
+        }
+        if (ec) {
+            return io_error("Cannot list segment directory " + config_.directory + ": " + ec.message());
+        }
+        std::sort(found.begin(), found.end());
+
+        uint64_t covered = 0;
+        for (auto& [base, path] : found) {
+            auto recovered = recover_segment(base, path, covered);
+            if (recovered.is_err()) {
+                return recovered;
+            }
+        }
+
+        if (segments_.empty()) {
+            return start_segment();
+        }
+
+        next_sequence_ = segments_.back().covered_end();
+        if (segments_.back().end_sequence != 0 || segments_.back().rolled_up) {
+            // Never append raw snapshots to a compaction output
+            enforce_retention();
+            return start_segment();
+        }
+        active_file_ = std::fopen(segments_.back().path.c_str(), "ab");
+        if (active_file_ == nullptr) {
+            return io_error("Cannot open segment " + segments_.back().path);
+        }
+        enforce_retention();
+        return common::ok();
+    }
+
+    /**
+     * @brief Validate a segment, index its records and truncate a bad tail
+     * @param covered End of the sequence range covered by earlier segments;
+     *        a segment starting below it is the input of a compaction that
+     *        was interrupted after its rename, and is removed
+     *
+     * Only a torn or corrupt block tail is truncated. A segment that cannot
+     * be mapped, comes from a newer format version or holds blocks in a
+     * codec this build lacks fails the open and is left as it is; a segment
+     * with an unrecognized header is renamed aside with a ".corrupt" suffix.
+     */
+    common::VoidResult recover_segment(uint64_t base_sequence, const std::string& path, uint64_t& covered) {
+        std::error_code ec;
+        const auto file_size = static_cast<size_t>(std::filesystem::file_size(path, ec));
+        if (ec) {
+            return open_error(monitoring_error_code::storage_read_failed,
+                              "Cannot stat segment " + path + ": " + ec.message());
+        }
+        if (file_size < segment_header_size) {
+            // Crashed while writing the header of a new segment; it holds no records
+            ++stats_.corrupt_segments;
+            std::filesystem::remove(path, ec);
+            return common::ok();
+        }
+
+        segment_info segment;
+        segment.base_sequence = base_sequence;
+        segment.path = path;
+        if (!segment.map.map(path, file_size)) {
+            return open_error(monitoring_error_code::storage_read_failed, "Cannot map segment " + path);
+        }
+
+        detail::byte_reader header(segment.map.data(), segment_header_size);
+        uint64_t magic = 0;
+        uint32_t version = 0;
+        uint32_t span = 0;
+        uint64_t stored_base = 0;
+        uint64_t created_ns = 0;
+        header.get_u64(magic);
+        header.get_u32(version);
+        header.get_u32(span);
+        header.get_u64(stored_base);
+        header.get_u64(created_ns);
+        if (magic == segment_magic && (version & 0xFFFF) > format_version) {
+            return open_error(monitoring_error_code::incompatible_version,
+                              "Segment " + path + " was written by a newer format version");
+        }
+        if (magic != segment_magic || (version & 0xFFFF) != format_version || stored_base != base_sequence) {
+            ++stats_.corrupt_segments;
+            segment.map.reset();
+            return quarantine(path);
+        }
+        if (base_sequence < covered) {
+            ++stats_.superseded_segments;
+            segment.map.reset();
+            std::filesystem::remove(path, ec);
+            return common::ok();
+        }
+        segment.created = detail::from_unix_nanos(static_cast<int64_t>(created_ns));
+        segment.rolled_up = (version & segment_flag_rolled_up) != 0;
+        if ((version & segment_flag_compacted) != 0) {
+            segment.end_sequence = base_sequence + span;
+        }
+
+        segments_.push_back(std::move(segment));
+        auto& stored = segments_.back();
+
+        std::vector<record_ref> found;
+        size_t offset = segment_header_size;
+        while (offset < file_size) {
+            const auto scanned = scan_block(stored, offset, file_size, found);
+            if (scanned == block_scan::codec_unavailable) {
+                return open_error(monitoring_error_code::incompatible_version,
+                                  "Segment " + path + " holds blocks compressed with a codec "
+                                  "that is not available in this build");
+            }
+            if (scanned == block_scan::torn) {
+                break;
+            }
+            records_.insert(records_.end(), found.begin(), found.end());
+            stored.record_count += found.size();
+            offset = static_cast<size_t>(found.back().offset + found.back().length);
+        }
+
+        stored.durable_bytes = offset;
+        covered = stored.covered_end();
+        if (offset < file_size) {
+            stats_.recovered_bytes += file_size - offset;
+            stored.map.reset();
+            std::filesystem::resize_file(path, offset, ec);
+        }
+        return common::ok();
+    }
+
+    static common::VoidResult open_error(monitoring_error_code code, const std::string& message) {
+        return common::VoidResult::err(error_info(code, message).to_common_error());
+    }
+
+    /**
+     * @brief Move an unreadable segment out of the store without deleting it
+     */
+    static common::VoidResult quarantine(const std::string& path) {
+        std::error_code ec;
+        std::filesystem::rename(path, path + ".corrupt", ec);
+        if (ec) {
+            return io_error("Cannot quarantine segment " + path + ": " + ec.message());
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Outcome of validating one block
+     */
+    enum class block_scan {
+        valid,              ///< Intact; its records were collected
+        torn,               ///< Short, malformed or failing its CRC
+        codec_unavailable   ///< Intact, but compressed with a codec this build lacks
+    };
+
+    /**
+     * @brief Validate one block and collect its records
+     */
+    block_scan scan_block(const segment_info& segment, size_t offset, size_t file_size,
+                          std::vector<record_ref>& found) const {
+        found.clear();
+        if (file_size - offset < block_header_size) {
+            return block_scan::torn;
+        }
+
+        detail::byte_reader header(segment.map.data() + offset, block_header_size);
+        uint32_t magic = 0;
+        uint32_t length = 0;
+        uint32_t count = 0;
+        uint32_t crc = 0;
+        header.get_u32(magic);
+        header.get_u32(length);
+        header.get_u32(count);
+        header.get_u32(crc);
+
+        const size_t payload_offset = offset + block_header_size;
+        if ((magic != block_magic && magic != columnar_block_magic && magic != compressed_block_magic) ||
+            count == 0 ||
+            length > file_size - payload_offset ||
+            detail::crc32(segment.map.data() + payload_offset, length) != crc) {
+            return block_scan::torn;
+        }
+
+        if (magic == compressed_block_magic) {
+            uint32_t inner = 0;
+            uint8_t codec = 0;
+            detail::byte_reader prefix(segment.map.data() + payload_offset, length);
+            if (!prefix.get_u32(inner) || !prefix.get_u8(codec) ||
+                (inner != block_magic && inner != columnar_block_magic)) {
+                return block_scan::torn;
+            }
+            if (!detail::compression_available(static_cast<compression_algorithm>(codec))) {
+                // The CRC matched, so the block is intact; it is just unreadable here
+                return block_scan::codec_unavailable;
+            }
+        }
+
+        if (magic != block_magic) {
+            if (magic == columnar_block_magic &&
+                !detail::columnar_block_view().parse(segment.map.data() + payload_offset, length)) {
+                return block_scan::torn;
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                found.push_back({&segment, payload_offset, length, i});
+            }
+            return block_scan::valid;
+        }
+
+        detail::byte_reader payload(segment.map.data() + payload_offset, length);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint64_t record_length;
+            if (!payload.get_varint(record_length) || record_length > payload.remaining()) {
+                return block_scan::torn;
+            }
+            found.push_back({&segment, payload_offset + payload.position(),
+                             static_cast<uint32_t>(record_length), row_slot});
+            payload.skip(static_cast<size_t>(record_length));
+        }
+        if (payload.remaining() != 0) {
+            return block_scan::torn;
+        }
+        return block_scan::valid;
+    }
+
+    /**
+     * @brief Create a fresh active segment starting at next_sequence_
+     */
+    common::VoidResult start_segment() {
+        segment_info segment;
+        segment.base_sequence = next_sequence_;
+        segment.path = (std::filesystem::path(config_.directory) / segment_file_name(next_sequence_)).string();
+        segment.created = std::chrono::system_clock::now();
+        const auto header = segment_header(segment);
+
+        active_file_ = std::fopen(segment.path.c_str(), "wb");
+        if (active_file_ == nullptr) {
+            return io_error("Cannot create segment " + segment.path);
+        }
+        if (std::fwrite(header.data(), 1, header.size(), active_file_) != header.size() ||
+            std::fflush(active_file_) != 0) {
+            close_active();
+            return io_error("Cannot write segment header " + segment.path);
+        }
+
+        segment.durable_bytes = header.size();
+        segments_.push_back(std::move(segment));
+        return common::ok();
+    }
+
+    /**
+     * @brief Encode the 32-byte header of @p segment
+     */
+    static std::vector<uint8_t> segment_header(const segment_info& segment) {
+        uint32_t version = format_version;
+        uint32_t span = 0;
+        if (segment.end_sequence != 0) {
+            version |= segment_flag_compacted;
+            span = static_cast<uint32_t>(segment.end_sequence - segment.base_sequence);
+        }
+        if (segment.rolled_up) {
+            version |= segment_flag_rolled_up;
+        }
+
+        std::vector<uint8_t> header;
+        detail::byte_writer writer(header);
+        writer.put_u64(segment_magic);
+        writer.put_u32(version);
+        writer.put_u32(span);
+        writer.put_u64(segment.base_sequence);
+        writer.put_u64(static_cast<uint64_t>(detail::to_unix_nanos(segment.created)));
+        return header;
+    }
+
+    common::VoidResult rotate_locked() {
+        auto flushed = flush_locked();
+        if (flushed.is_err()) {
+            return flushed;
+        }
+        close_active();
+        ++stats_.segments_rotated;
+        return start_segment();
+    }
+
+    common::VoidResult flush_locked() {
+        if (pending_count_ == 0) {
+            return common::ok();
+        }
+        if (active_file_ == nullptr) {
+            return io_error("No active segment");
+        }
+
+        uint32_t magic = block_magic;
+        if (block_addressed()) {
+            magic = encode_pending_block();
+        } else {
+            stats_.payload_bytes += pending_.size();
+        }
+
+        std::vector<uint8_t> header;
+        header.reserve(block_header_size);
+        detail::byte_writer writer(header);
+        writer.put_u32(magic);
+        writer.put_u32(static_cast<uint32_t>(pending_.size()));
+        writer.put_u32(static_cast<uint32_t>(pending_count_));
+        writer.put_u32(detail::crc32(pending_.data(), pending_.size()));
+
+        auto& active = segments_.back();
+        const bool written =
+            std::fwrite(header.data(), 1, header.size(), active_file_) == header.size() &&
+            std::fwrite(pending_.data(), 1, pending_.size(), active_file_) == pending_.size() &&
+            std::fflush(active_file_) == 0 && sync_active();
+        if (!written) {
+            discard_partial_block(active);
+            return io_error("Failed to write block to " + active.path);
+        }
+
+        if (block_addressed()) {
+            const uint64_t payload_offset = active.durable_bytes + block_header_size;
+            for (auto it = records_.rbegin(); it != records_.rend() && it->segment == &active &&
+                                              it->offset == payload_offset; ++it) {
+                it->length = static_cast<uint32_t>(pending_.size());
+            }
+            pending_snapshots_.clear();
+            pending_estimate_ = 0;
+        }
+
+        stats_.stored_payload_bytes += pending_.size();
+        active.durable_bytes += header.size() + pending_.size();
+        active.map.reset();
+        pending_.clear();
+        pending_count_ = 0;
+        ++stats_.blocks_written;
+        return common::ok();
+    }
+
+    /**
+     * @brief Cut a failed block off the active segment
+     *
+     * The stream is closed before truncating, since its position and buffer
+     * still point past the valid prefix, and reopened for append so the
+     * retried block lands at durable_bytes where its record offsets point.
+     * If the file cannot be reopened, later flushes report the error.
+     */
+    void discard_partial_block(const segment_info& active) {
+        close_active();
+        std::error_code ec;
+        std::filesystem::resize_file(active.path, active.durable_bytes, ec);
+        if (!ec) {
+            active_file_ = std::fopen(active.path.c_str(), "ab");
+        }
+    }
+
+    /**
+     * @brief Encode pending_snapshots_ into pending_ as one block
+     * @return Block magic of the encoded payload
+     */
+    uint32_t encode_pending_block() {
+        size_t raw_size = 0;
+        const uint32_t magic = encode_block(pending_snapshots_, pending_, scratch_, compressed_, raw_size);
+        stats_.payload_bytes += raw_size;
+        return magic;
+    }
+
+    /**
+     * @brief Encode @p snapshots into @p payload in the configured block format
+     * @param raw_size Set to the payload size before compression
+     * @return Block magic of the encoded payload
+     */
+    uint32_t encode_block(const std::vector<metrics_snapshot>& snapshots, std::vector<uint8_t>& payload,
+                          std::vector<uint8_t>& scratch, std::vector<uint8_t>& compressed,
+                          size_t& raw_size) const {
+        payload.clear();
+        uint32_t magic = block_magic;
+        if (columnar()) {
+            detail::encode_columnar_block(snapshots, payload);
+            magic = columnar_block_magic;
+        } else {
+            for (const auto& snapshot : snapshots) {
+                scratch.clear();
+                detail::encode_snapshot_record(snapshot, scratch);
+                detail::byte_writer(payload).put_varint(scratch.size());
+                payload.insert(payload.end(), scratch.begin(), scratch.end());
+            }
+        }
+        raw_size = payload.size();
+
+        if (config_.compression == compression_algorithm::none) {
+            return magic;
+        }
+
+        // Keep the block uncompressed unless the codec actually shrinks it
+        compressed.clear();
+        detail::byte_writer writer(compressed);
+        writer.put_u32(magic);
+        writer.put_u8(static_cast<uint8_t>(config_.compression));
+        writer.put_varint(payload.size());
+        if (detail::compress_block(config_.compression, payload.data(), payload.size(), compressed) &&
+            compressed.size() < payload.size()) {
+            payload.swap(compressed);
+            magic = compressed_block_magic;
+        }
+        return magic;
+    }
+
+    bool sync_active() {
+#ifdef MONITORING_HAS_MMAP
+        if (config_.sync_on_flush) {
+            return ::fsync(::fileno(active_file_)) == 0;
+        }
+#endif
+        return true;
+    }
+
+    void close_active() {
+        if (active_file_ != nullptr) {
+            std::fclose(active_file_);
+            active_file_ = nullptr;
+        }
+    }
+
+    bool is_pending(const record_ref& ref) const noexcept {
+        return ref.segment == &segments_.back() && ref.offset >= ref.segment->durable_bytes;
+    }
+
+    /**
+     * @brief Map the durable bytes of a record's segment
+     * @return Pointer to the record, nullptr if the segment cannot be mapped
+     */
+    const uint8_t* durable_data(const record_ref& ref) const {
+        const auto& segment = *ref.segment;
+        if (segment.map.size() < ref.offset + ref.length &&
+            !segment.map.map(segment.path, static_cast<size_t>(segment.durable_bytes))) {
+            return nullptr;
+        }
+        return segment.map.data() + ref.offset;
+    }
+
+    common::Result<metrics_snapshot> read_locked(const record_ref& ref) const {
+        if (ref.slot != row_slot) {
+            return read_slot_locked(ref);
+        }
+
+        const uint8_t* data = nullptr;
+        const auto& segment = *ref.segment;
+        if (is_pending(ref)) {
+            // Still in the open block
+            data = pending_.data() + (ref.offset - segment.durable_bytes - block_header_size);
+        } else {
+            data = durable_data(ref);
+            if (data == nullptr) {
+                return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::storage_read_failed,
+                    "Cannot map segment " + segment.path).to_common_error());
+            }
+        }
+
+        auto snapshot = detail::decode_snapshot_record(data, ref.length);
+        if (!snapshot) {
+            return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::storage_corrupted,
+                "Corrupt snapshot record in " + segment.path).to_common_error());
+        }
+        return common::ok(std::move(*snapshot));
+    }
+
+    /**
+     * @brief Locate a durable block's payload, inflating it if compressed
+     * @param magic Set to the magic of the (inner) payload
+     * @param inflated Holds an inflated payload until the next call
+     */
+    bool block_payload(const record_ref& ref, uint32_t& magic, const uint8_t*& payload, size_t& size,
+                       std::vector<uint8_t>& inflated) const {
+        const uint8_t* data = durable_data(ref);
+        if (data == nullptr) {
+            return false;
+        }
+        detail::byte_reader header(data - block_header_size, 4);
+        header.get_u32(magic);
+        payload = data;
+        size = ref.length;
+        if (magic != compressed_block_magic) {
+            return true;
+        }
+
+        detail::byte_reader prefix(data, ref.length);
+        uint8_t codec = 0;
+        uint64_t raw_size = 0;
+        if (!prefix.get_u32(magic) || !prefix.get_u8(codec) || !prefix.get_varint(raw_size) ||
+            raw_size > (uint64_t{1} << 32)) {
+            return false;
+        }
+        inflated.resize(static_cast<size_t>(raw_size));
+        if (!detail::decompress_block(static_cast<compression_algorithm>(codec), data + prefix.position(),
+                                      prefix.remaining(), inflated.data(), inflated.size())) {
+            return false;
+        }
+        payload = inflated.data();
+        size = inflated.size();
+        return true;
+    }
+
+    /**
+     * @brief Decode every snapshot of a durable block
+     */
+    std::optional<std::vector<metrics_snapshot>> decode_block(const record_ref& ref,
+                                                              std::vector<uint8_t>& inflated) const {
+        uint32_t magic = 0;
+        const uint8_t* payload = nullptr;
+        size_t size = 0;
+        if (!block_payload(ref, magic, payload, size, inflated)) {
+            return std::nullopt;
+        }
+
+        // The snapshot count lives in the block header
+        uint32_t count = 0;
+        detail::byte_reader header(durable_data(ref) - block_header_size + 8, 4);
+        header.get_u32(count);
+
+        if (magic == columnar_block_magic) {
+            detail::columnar_block_view view;
+            if (!view.parse(payload, size)) {
+                return std::nullopt;
+            }
+            return view.decode(count);
+        }
+
+        std::vector<metrics_snapshot> snapshots;
+        snapshots.reserve(count);
+        detail::byte_reader records(payload, size);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint64_t length = 0;
+            if (!records.get_varint(length) || length > records.remaining()) {
+                return std::nullopt;
+            }
+            auto snapshot = detail::decode_snapshot_record(payload + records.position(), static_cast<size_t>(length));
+            if (!snapshot) {
+                return std::nullopt;
+            }
+            snapshots.push_back(std::move(*snapshot));
+            records.skip(static_cast<size_t>(length));
+        }
+        return snapshots;
+    }
+
+    /**
+     * @brief Read a snapshot addressed by slot within a whole-block encoding
+     */
+    common::Result<metrics_snapshot> read_slot_locked(const record_ref& ref) const {
+        if (is_pending(ref)) {
+            return common::ok(metrics_snapshot(pending_snapshots_[ref.slot]));
+        }
+
+        if (decoded_block_.segment != ref.segment || decoded_block_.offset != ref.offset) {
+            auto snapshots = decode_block(ref, inflated_);
+            if (!snapshots) {
+                return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::storage_corrupted,
+                    "Corrupt block in " + ref.segment->path).to_common_error());
+            }
+            decoded_block_ = {ref.segment, ref.offset, std::move(*snapshots)};
+        }
+
+        if (ref.slot >= decoded_block_.snapshots.size()) {
+            return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::storage_corrupted,
+                "Block shorter than its index in " + ref.segment->path).to_common_error());
+        }
+        return common::ok(metrics_snapshot(decoded_block_.snapshots[ref.slot]));
+    }
+
+    /**
+     * @brief Apply max_records and max_total_bytes, deleting whole segments
+     */
+    void enforce_retention() {
+        if (config_.max_records > 0) {
+            while (records_.size() > config_.max_records) {
+                records_.pop_front();
+            }
+        }
+
+        if (config_.max_total_bytes > 0) {
+            size_t total = 0;
+            for (const auto& segment : segments_) {
+                total += segment.durable_bytes;
+            }
+            while (segments_.size() > 1 && total > config_.max_total_bytes) {
+                total -= segments_.front().durable_bytes;
+                while (!records_.empty() && records_.front().segment == &segments_.front()) {
+                    records_.pop_front();
+                }
+                remove_front_segment();
+            }
+        }
+
+        // Segments whose records all fell out of the retained window
+        while (segments_.size() > 1 &&
+               (records_.empty() || records_.front().segment != &segments_.front())) {
+            remove_front_segment();
+        }
+    }
+
+    void remove_front_segment() {
+        auto& front = segments_.front();
+        if (decoded_block_.segment == &front) {
+            decoded_block_ = {};
+        }
+        front.map.reset();
+        std::error_code ec;
+        std::filesystem::remove(front.path, ec);
+        segments_.pop_front();
+        ++stats_.segments_removed;
+    }
+
+    /**
+     * @brief A closed segment selected for a compaction rewrite
+     */
+    struct compaction_input {
+        uint64_t base_sequence{0};
+        std::string path;
+        uint64_t durable_bytes{0};
+        size_t record_count{0};
+    };
+
+    struct compaction_job {
+        std::vector<compaction_input> inputs;           // Adjacent closed segments, oldest first
+        std::chrono::system_clock::time_point created;  // Of the first input
+        uint64_t end_sequence{0};                       // covered_end() of the last input
+        size_t skip{0};                                 // Leading records already dropped by max_records
+        bool rollup{false};                             // Fold raw inputs into rollup snapshots
+        bool rolled_up{false};                          // Output holds rollup snapshots only
+    };
+
+    /**
+     * @brief Delete closed segments whose data is past retention_period
+     *
+     * A segment's snapshots were all appended before its successor was
+     * created, so the check needs no decoding.
+     */
+    void expire_segments() {
+        if (config_.retention_period.count() == 0) {
+            return;
+        }
+        const auto cutoff = std::chrono::system_clock::now() - config_.retention_period;
+        while (segments_.size() > 1 && std::next(segments_.begin())->created <= cutoff) {
+            while (!records_.empty() && records_.front().segment == &segments_.front()) {
+                records_.pop_front();
+            }
+            remove_front_segment();
+            ++stats_.segments_expired;
+        }
+    }
+
+    /**
+     * @brief Locate the retained records of segments [first, last)
+     * @return [begin, end) indices into records_
+     *
+     * Only the front of records_ is ever trimmed, so every record of the
+     * later segments is retained and the range ends where theirs start.
+     */
+    std::pair<size_t, size_t> record_range(std::list<segment_info>::const_iterator first,
+                                           std::list<segment_info>::const_iterator last) const {
+        size_t total = 0;
+        for (auto it = first; it != last; ++it) {
+            total += it->record_count;
+        }
+        size_t after = 0;
+        for (auto it = last; it != segments_.end(); ++it) {
+            after += it->record_count;
+        }
+        const size_t end = records_.size() - (std::min)(after, records_.size());
+        return {end - (std::min)(end, total), end};
+    }
+
+    /**
+     * @brief Pick the oldest run of closed segments worth rewriting
+     * @return false if nothing qualifies
+     */
+    bool plan_compaction(compaction_job& job) const {
+        const auto now = std::chrono::system_clock::now();
+        auto rollup_due = [&](std::list<segment_info>::const_iterator it) {
+            return config_.rollup_after.count() > 0 && !it->rolled_up &&
+                   std::next(it)->created <= now - config_.rollup_after;
+        };
+        auto small = [&](std::list<segment_info>::const_iterator it) {
+            return it->durable_bytes < config_.compaction_merge_bytes;
+        };
+
+        const auto active = std::prev(segments_.end());
+        for (auto first = segments_.cbegin(); first != active; ++first) {
+            const bool rollup = rollup_due(first);
+            if (!rollup && !small(first)) {
+                continue;
+            }
+
+            // Extend over adjacent segments of the same kind, up to one segment of input
+            auto last = std::next(first);
+            uint64_t bytes = first->durable_bytes;
+            while (last != active && rollup_due(last) == rollup &&
+                   (rollup || (small(last) && last->rolled_up == first->rolled_up)) &&
+                   bytes + last->durable_bytes <= config_.segment_size_bytes &&
+                   last->covered_end() - first->base_sequence <= (std::numeric_limits<uint32_t>::max)()) {
+                bytes += last->durable_bytes;
+                ++last;
+            }
+            if (!rollup && std::next(first) == last) {
+                continue;  // Nothing to merge with
+            }
+
+            job = {};
+            size_t total = 0;
+            for (auto it = first; it != last; ++it) {
+                job.inputs.push_back({it->base_sequence, it->path, it->durable_bytes, it->record_count});
+                total += it->record_count;
+            }
+            const auto [begin, end] = record_range(first, last);
+            job.created = first->created;
+            job.end_sequence = std::prev(last)->covered_end();
+            job.skip = total - (end - begin);
+            job.rollup = rollup;
+            job.rolled_up = rollup || first->rolled_up;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Rewrite the inputs of @p job into one segment and swap it in
+     * @return false if the job was abandoned (shutdown or inputs removed)
+     */
+    common::Result<bool> run_compaction(const compaction_job& job) {
+        const auto cutoff = config_.retention_period.count() > 0
+            ? std::chrono::system_clock::now() - config_.retention_period
+            : (std::chrono::system_clock::time_point::min)();
+
+        // Read the inputs through private maps; closed segments never change
+        std::vector<metrics_snapshot> kept;
+        std::vector<size_t> last_input;     // Input ordinal behind each kept snapshot
+        size_t ordinal = 0;
+        size_t expired = 0;
+        size_t bytes_read = 0;
+        std::vector<record_ref> found;
+        std::vector<uint8_t> inflated;
+        for (const auto& input : job.inputs) {
+            if (!throttle(static_cast<size_t>(input.durable_bytes))) {
+                return common::ok(false);
+            }
+            bytes_read += static_cast<size_t>(input.durable_bytes);
+
+            segment_info segment;
+            segment.path = input.path;
+            segment.durable_bytes = input.durable_bytes;
+            const auto size = static_cast<size_t>(input.durable_bytes);
+            if (!segment.map.map(input.path, size)) {
+                return common::Result<bool>::err(error_info(monitoring_error_code::storage_read_failed,
+                    "Cannot map segment " + input.path).to_common_error());
+            }
+
+            size_t offset = segment_header_size;
+            while (offset < size) {
+                if (scan_block(segment, offset, size, found) != block_scan::valid) {
+                    return common::Result<bool>::err(error_info(monitoring_error_code::storage_corrupted,
+                        "Corrupt block in " + input.path).to_common_error());
+                }
+
+                std::vector<metrics_snapshot> block;
+                if (found.front().slot == row_slot) {
+                    for (const auto& ref : found) {
+                        auto snapshot = detail::decode_snapshot_record(segment.map.data() + ref.offset, ref.length);
+                        if (!snapshot) {
+                            block.clear();
+                            break;
+                        }
+                        block.push_back(std::move(*snapshot));
+                    }
+                } else if (auto snapshots = decode_block(found.front(), inflated)) {
+                    block = std::move(*snapshots);
+                }
+                if (block.size() != found.size()) {
+                    return common::Result<bool>::err(error_info(monitoring_error_code::storage_corrupted,
+                        "Corrupt block in " + input.path).to_common_error());
+                }
+
+                for (auto& snapshot : block) {
+                    const size_t index = ordinal++;
+                    if (index < job.skip) {
+                        continue;
+                    }
+                    if (snapshot.capture_time < cutoff) {
+                        ++expired;
+                        continue;
+                    }
+                    kept.push_back(std::move(snapshot));
+                    last_input.push_back(index);
+                }
+                offset = static_cast<size_t>(found.back().offset + found.back().length);
+            }
+        }
+
+        const size_t rolled = job.rollup ? kept.size() : 0;
+        if (job.rollup) {
+            roll_up(kept, last_input);
+        }
+
+        segment_info output;
+        output.base_sequence = job.inputs.front().base_sequence;
+        output.path = job.inputs.front().path;
+        output.created = job.created;
+        output.end_sequence = job.end_sequence;
+        output.rolled_up = job.rolled_up;
+
+        const std::string temp_path = output.path + ".tmp";
+        std::vector<record_ref> refs;
+        if (!kept.empty()) {
+            auto written = write_compacted(output, temp_path, kept, refs);
+            if (written.is_err() || !written.value()) {
+                return written;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto committed = commit_compaction(job, std::move(output), temp_path, refs, last_input);
+        if (committed.is_ok() && committed.value()) {
+            stats_.snapshots_expired += expired;
+            stats_.snapshots_rolled_up += rolled;
+            stats_.compaction_bytes_read += bytes_read;
+        }
+        return committed;
+    }
+
+    /**
+     * @brief Replace snapshots by one per source and rollup_resolution bucket
+     *
+     * Each rollup snapshot carries the mean of every (name, tags) series in
+     * its bucket, stamped with the bucket start; buckets come out in time
+     * order.
+     */
+    void roll_up(std::vector<metrics_snapshot>& snapshots, std::vector<size_t>& last_input) const {
+        struct series_sum {
+            metric_value metric;
+            double sum{0.0};
+            size_t count{0};
+        };
+        struct bucket {
+            std::map<std::string, size_t> index;
+            std::vector<series_sum> series;
+            size_t last_input{0};
+        };
+
+        const int64_t width = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.rollup_resolution).count();
+        std::map<std::pair<int64_t, std::string>, bucket> buckets;
+        std::string key;
+        for (size_t i = 0; i < snapshots.size(); ++i) {
+            auto& snapshot = snapshots[i];
+            const int64_t capture_ns = detail::to_unix_nanos(snapshot.capture_time);
+            const int64_t start = capture_ns - (((capture_ns % width) + width) % width);
+            auto& target = buckets[{start, std::move(snapshot.source_id)}];
+            target.last_input = (std::max)(target.last_input, last_input[i]);
+
+            for (auto& metric : snapshot.metrics) {
+                const std::map<std::string, std::string> tags(metric.tags.begin(), metric.tags.end());
+                key = metric.name;
+                for (const auto& [tag, value] : tags) {
+                    key.append(1, '\0').append(tag).append(1, '=').append(value);
+                }
+                auto [it, inserted] = target.index.emplace(key, target.series.size());
+                if (inserted) {
+                    series_sum entry;
+                    entry.metric.name = std::move(metric.name);
+                    entry.metric.tags = std::move(metric.tags);
+                    entry.metric.timestamp = detail::from_unix_nanos(start);
+                    target.series.push_back(std::move(entry));
+                }
+                target.series[it->second].sum += metric.value;
+                ++target.series[it->second].count;
+            }
+        }
+
+        snapshots.clear();
+        last_input.clear();
+        for (auto& [slot, target] : buckets) {
+            metrics_snapshot rollup;
+            rollup.capture_time = detail::from_unix_nanos(slot.first);
+            rollup.source_id = slot.second;
+            rollup.metrics.reserve(target.series.size());
+            for (auto& entry : target.series) {
+                entry.metric.value = entry.sum / static_cast<double>(entry.count);
+                rollup.metrics.push_back(std::move(entry.metric));
+            }
+            snapshots.push_back(std::move(rollup));
+            last_input.push_back(target.last_input);
+        }
+    }
+
+    /**
+     * @brief Write @p snapshots as a complete, synced segment at @p temp_path
+     * @param refs Receives the record of each snapshot, without its segment
+     * @return false if the store started shutting down
+     */
+    common::Result<bool> write_compacted(segment_info& output, const std::string& temp_path,
+                                         std::vector<metrics_snapshot>& snapshots, std::vector<record_ref>& refs) {
+        std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+        if (file == nullptr) {
+            return common::Result<bool>::err(error_info(monitoring_error_code::storage_write_failed,
+                "Cannot create " + temp_path).to_common_error());
+        }
+        auto abandon = [&]() {
+            std::fclose(file);
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+        };
+
+        const auto header = segment_header(output);
+        uint64_t offset = header.size();
+        bool written = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+
+        std::vector<metrics_snapshot> block;
+        std::vector<uint8_t> payload;
+        std::vector<uint8_t> scratch;
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> block_header;
+        for (size_t first = 0; written && first < snapshots.size(); first += config_.block_records) {
+            const size_t last = (std::min)(first + config_.block_records, snapshots.size());
+            block.assign(std::make_move_iterator(snapshots.begin() + static_cast<std::ptrdiff_t>(first)),
+                         std::make_move_iterator(snapshots.begin() + static_cast<std::ptrdiff_t>(last)));
+            size_t raw_size = 0;
+            const uint32_t magic = encode_block(block, payload, scratch, compressed, raw_size);
+            const auto count = static_cast<uint32_t>(block.size());
+
+            block_header.clear();
+            detail::byte_writer writer(block_header);
+            writer.put_u32(magic);
+            writer.put_u32(static_cast<uint32_t>(payload.size()));
+            writer.put_u32(count);
+            writer.put_u32(detail::crc32(payload.data(), payload.size()));
+            written = std::fwrite(block_header.data(), 1, block_header.size(), file) == block_header.size() &&
+                      std::fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+
+            // Address records the way recovery will find them
+            const uint64_t payload_offset = offset + block_header_size;
+            if (magic == block_magic) {
+                detail::byte_reader records(payload.data(), payload.size());
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint64_t length = 0;
+                    records.get_varint(length);
+                    refs.push_back({nullptr, payload_offset + records.position(), static_cast<uint32_t>(length), row_slot});
+                    records.skip(static_cast<size_t>(length));
+                }
+            } else {
+                for (uint32_t i = 0; i < count; ++i) {
+                    refs.push_back({nullptr, payload_offset, static_cast<uint32_t>(payload.size()), i});
+                }
+            }
+            offset = payload_offset + payload.size();
+
+            if (written && !throttle(block_header_size + payload.size())) {
+                abandon();
+                return common::ok(false);
+            }
+        }
+
+        written = written && std::fflush(file) == 0;
+#ifdef MONITORING_HAS_MMAP
+        written = written && (!config_.sync_on_flush || ::fsync(::fileno(file)) == 0);
+#endif
+        if (!written) {
+            abandon();
+            return common::Result<bool>::err(error_info(monitoring_error_code::storage_write_failed,
+                "Failed to write " + temp_path).to_common_error());
+        }
+        std::fclose(file);
+
+        output.durable_bytes = offset;
+        output.record_count = refs.size();
+        return common::ok(true);
+    }
+
+    /**
+     * @brief Rename the rewrite over its first input and swap it into the index
+     *
+     * The rename makes the rewrite durable; inputs after the first are then
+     * deleted, and if that is interrupted recovery drops them as covered by
+     * the rewrite's sequence range.
+     */
+    common::Result<bool> commit_compaction(const compaction_job& job, segment_info output,
+                                           const std::string& temp_path, std::vector<record_ref>& refs,
+                                           const std::vector<size_t>& last_input) {
+        std::error_code ec;
+        auto first = std::find_if(segments_.begin(), segments_.end(), [&](const segment_info& segment) {
+            return segment.base_sequence == job.inputs.front().base_sequence;
+        });
+        auto last = first;
+        for (const auto& input : job.inputs) {
+            if (last == segments_.end() || last->base_sequence != input.base_sequence) {
+                std::filesystem::remove(temp_path, ec);  // Removed by retention or clear() meanwhile
+                return common::ok(false);
+            }
+            ++last;
+        }
+
+        // Rewritten records the retention limits dropped during the rewrite
+        const auto [begin, end] = record_range(first, last);
+        size_t total = 0;
+        for (const auto& input : job.inputs) {
+            total += input.record_count;
+        }
+        const size_t trimmed = total - (end - begin);
+        size_t dropped = 0;
+        while (dropped < refs.size() && last_input[dropped] < trimmed) {
+            ++dropped;
+        }
+
+        const bool empty = refs.empty();
+        if (!empty) {
+            std::filesystem::rename(temp_path, output.path, ec);
+            if (ec) {
+                std::filesystem::remove(temp_path, ec);
+                return common::Result<bool>::err(error_info(monitoring_error_code::storage_write_failed,
+                    "Cannot rename compacted segment to " + output.path).to_common_error());
+            }
+            sync_directory();
+        }
+        for (auto it = first; it != last; ++it) {
+            if (decoded_block_.segment == &*it) {
+                decoded_block_ = {};
+            }
+            it->map.reset();
+            if (empty || it != first) {
+                std::filesystem::remove(it->path, ec);
+            }
+        }
+
+        stats_.compaction_bytes_written += empty ? 0 : static_cast<size_t>(output.durable_bytes);
+        auto position = segments_.end();
+        if (!empty) {
+            position = segments_.insert(first, std::move(output));
+        }
+        segments_.erase(first, last);
+
+        records_.erase(records_.begin() + static_cast<std::ptrdiff_t>(begin),
+                       records_.begin() + static_cast<std::ptrdiff_t>(end));
+        for (auto& ref : refs) {
+            ref.segment = &*position;
+        }
+        records_.insert(records_.begin() + static_cast<std::ptrdiff_t>(begin),
+                        refs.begin() + static_cast<std::ptrdiff_t>(dropped), refs.end());
+
+        ++stats_.compactions;
+        stats_.segments_compacted += job.inputs.size();
+        enforce_retention();
+        return common::ok(true);
+    }
+
+    void sync_directory() const {
+#ifdef MONITORING_HAS_MMAP
+        if (config_.sync_on_flush) {
+            const int fd = ::open(config_.directory.c_str(), O_RDONLY);
+            if (fd >= 0) {
+                (void)::fsync(fd);
+                ::close(fd);
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief Charge @p bytes of compaction I/O against the budget
+     * @return false if the store is shutting down
+     *
+     * A token bucket refilled at compaction_io_bytes_per_sec with one second
+     * of burst; a caller in debt sleeps it off before continuing.
+     */
+    bool throttle(size_t bytes) {
+        std::unique_lock<std::mutex> lock(compactor_mutex_);
+        if (config_.compaction_io_bytes_per_sec == 0 || stopping_) {
+            return !stopping_;
+        }
+
+        const auto rate = static_cast<double>(config_.compaction_io_bytes_per_sec);
+        const auto now = std::chrono::steady_clock::now();
+        io_tokens_ = (std::min)(rate, io_tokens_ + std::chrono::duration<double>(now - io_refilled_).count() * rate);
+        io_refilled_ = now;
+        io_tokens_ -= static_cast<double>(bytes);
+        if (io_tokens_ >= 0) {
+            return true;
+        }
+        const std::chrono::duration<double> debt(-io_tokens_ / rate);
+        return !compactor_cv_.wait_for(lock, debt, [this] { return stopping_; });
+    }
+
+    void compaction_loop() {
+        std::unique_lock<std::mutex> lock(compactor_mutex_);
+        while (!compactor_cv_.wait_for(lock, config_.compaction_interval, [this] { return stopping_; })) {
+            lock.unlock();
+            (void)compact();
+            lock.lock();
+        }
+    }
+
+    segment_store_config config_;
+    mutable std::mutex mutex_;
+
+    std::list<segment_info> segments_;      // Oldest first; back() is the active segment
+    std::deque<record_ref> records_;        // Retained snapshots, oldest first
+    uint64_t next_sequence_{0};
+
+    std::FILE* active_file_{nullptr};
+    std::vector<uint8_t> pending_;          // Payload of the open block
+    size_t pending_count_{0};
+    std::vector<metrics_snapshot> pending_snapshots_;  // Open block when block_addressed(), encoded on flush
+    size_t pending_estimate_{0};            // Row-encoded size of pending_snapshots_
+    std::vector<uint8_t> scratch_;
+    std::vector<uint8_t> compressed_;
+
+    mutable decoded_block decoded_block_;
+    mutable std::vector<uint8_t> inflated_;  // Payload of the last compressed block read
+
+    segment_store_stats stats_;
+
+    std::mutex compaction_mutex_;           // One compaction pass at a time
+    std::mutex compactor_mutex_;            // Guards stopping_ and the I/O budget
+    std::condition_variable compactor_cv_;
+    bool stopping_{false};
+    double io_tokens_{0.0};
+    std::chrono::steady_clock::time_point io_refilled_;
+    std::thread compactor_;
+};
+
+} // namespace kcenon::monitoring
@@ -0,0 +1,935 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file snapshot_text_log.h
+ * @brief Append-only JSON Lines / CSV files for file_json and file_csv backends
+ *
+ * On-disk formats, one file at the configured path:
+ * - json_lines: one JSON object per snapshot and line,
+ *   `{"capture_time_ns":N,"source_id":"..","metrics":[{"name":"..",
+ *   "value":V,"timestamp_ns":N,"tags":{"k":"v"}}]}`. Non-finite values are
+ *   written as the strings "NaN", "Infinity" and "-Infinity".
+ * - csv: RFC 4180 rows under the header
+ *   `snapshot,capture_time_ns,source_id,name,value,timestamp_ns,tags`, one
+ *   row per metric. Rows with the same snapshot number form one snapshot,
+ *   a snapshot without metrics is a single row with an empty value, and
+ *   tags are a JSON object.
+ *
+ * append() encodes a snapshot into a pending buffer that is written with a
+ * single write (and fsync) on flush() or once batch_records snapshots are
+ * pending. Retained snapshots are also kept in memory and serve reads. When
+ * the file holds twice max_records snapshots it is rewritten with only the
+ * retained ones, through a synced temporary file renamed over it. On open
+ * the file is loaded and a torn last record (one without its terminating
+ * newline) is truncated; a malformed complete record fails the open and
+ * leaves the file untouched.
+ *
+ * Not thread-safe: callers serialize access.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kcenon/monitoring/core/result_types.h"
+#include "kcenon/monitoring/core/error_codes.h"
+#include "kcenon/monitoring/interfaces/monitoring_core.h"
+#include "kcenon/monitoring/storage/binary_codec.h"
+
+namespace kcenon::monitoring {
+
+/**
+ * @brief Text encodings written by snapshot_text_log
+ */
+enum class snapshot_text_format {
+    json_lines,
+    csv
+};
+
+/**
+ * @brief Configuration for snapshot_text_log
+ */
+struct snapshot_text_log_config {
+    std::string path;                                     ///< Log file
+    snapshot_text_format format{snapshot_text_format::json_lines};
+    size_t max_records{0};                                ///< Retain at most this many snapshots (0 = unlimited)
+    size_t batch_records{100};                            ///< Write once this many snapshots are pending
+    bool sync_on_flush{true};                             ///< fsync after each write
+
+    /**
+     * @brief Validate configuration
+     */
+    common::VoidResult validate() const {
+        if (path.empty()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "Snapshot log path must not be empty").to_common_error());
+        }
+        if (batch_records == 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "batch_records must be greater than 0").to_common_error());
+        }
+        return common::ok();
+    }
+};
+
+/**
+ * @brief Counters reported by snapshot_text_log::get_stats()
+ */
+struct snapshot_text_log_stats {
+    size_t records{0};                                    ///< Retained snapshots, pending included
+    size_t pending_records{0};                            ///< Snapshots not yet written
+    size_t disk_bytes{0};
+    size_t writes{0};
+    size_t rewrites{0};                                   ///< Retention rewrites of the file
+    size_t recovered_bytes{0};                            ///< Torn tail bytes truncated on open
+};
+
+namespace detail {
+
+inline void append_json_string(std::string& out, std::string_view text) {
+    static constexpr char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out.push_back(hex[(c >> 4) & 0xF]);
+                    out.push_back(hex[c & 0xF]);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+template<typename Number>
+void append_text_number(std::string& out, Number value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+inline void append_json_double(std::string& out, double value) {
+    if (std::isnan(value)) {
+        out += "\"NaN\"";
+    } else if (std::isinf(value)) {
+        out += value > 0 ? "\"Infinity\"" : "\"-Infinity\"";
+    } else {
+        append_text_number(out, value);
+    }
+}
+
+inline void append_tags_json(std::string& out, const std::unordered_map<std::string, std::string>& tags) {
+    out.push_back('{');
+    bool first = true;
+    for (const auto& [key, value] : tags) {
+        if (!first) {
+            out.push_back(',');
+        }
+        first = false;
+        append_json_string(out, key);
+        out.push_back(':');
+        append_json_string(out, value);
+    }
+    out.push_back('}');
+}
+
+/**
+ * @brief Minimal pull reader for the JSON written by snapshot_text_log
+ */
+class json_reader {
+public:
+    explicit json_reader(std::string_view text) noexcept : text_(text) {}
+
+    bool consume(char c) noexcept {
+        skip_whitespace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool at_end() noexcept {
+        skip_whitespace();
+        return pos_ == text_.size();
+    }
+
+    bool read_string(std::string& out) {
+        if (!consume('"')) {
+            return false;
+        }
+        out.clear();
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size()) {
+                return false;
+            }
+            switch (text_[pos_++]) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!read_hex4(code)) {
+                        return false;
+                    }
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        uint32_t low = 0;
+                        if (text_.substr(pos_, 2) != "\\u") {
+                            return false;
+                        }
+                        pos_ += 2;
+                        if (!read_hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool read_int64(int64_t& out) noexcept {
+        skip_whitespace();
+        const char* begin = text_.data() + pos_;
+        const auto result = std::from_chars(begin, text_.data() + text_.size(), out);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        pos_ += static_cast<size_t>(result.ptr - begin);
+        return true;
+    }
+
+    /**
+     * @brief Read a number, or one of the strings used for non-finite values
+     */
+    bool read_double(double& out) {
+        skip_whitespace();
+        if (pos_ < text_.size() && text_[pos_] == '"') {
+            std::string text;
+            if (!read_string(text)) {
+                return false;
+            }
+            return parse_special_double(text, out);
+        }
+        const char* begin = text_.data() + pos_;
+        const auto result = std::from_chars(begin, text_.data() + text_.size(), out);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        pos_ += static_cast<size_t>(result.ptr - begin);
+        return true;
+    }
+
+    /**
+     * @brief Read an object, calling @p on_member(key) to read each value
+     */
+    template<typename Fn>
+    bool read_object(Fn&& on_member) {
+        if (!consume('{')) {
+            return false;
+        }
+        if (consume('}')) {
+            return true;
+        }
+        std::string key;
+        do {
+            if (!read_string(key) || !consume(':') || !on_member(key)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume('}');
+    }
+
+    /**
+     * @brief Read an array, calling @p on_element() to read each element
+     */
+    template<typename Fn>
+    bool read_array(Fn&& on_element) {
+        if (!consume('[')) {
+            return false;
+        }
+        if (consume(']')) {
+            return true;
+        }
+        do {
+            if (!on_element()) {
+                return false;
+            }
+        } while (consume(','));
+        return consume(']');
+    }
+
+    /**
+     * @brief Skip a value of any type, so unknown members are tolerated
+     */
+    bool skip_value() {
+        skip_whitespace();
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+        const char c = text_[pos_];
+        if (c == '"') {
+            std::string ignored;
+            return read_string(ignored);
+        }
+        if (c == '{') {
+            return read_object([this](const std::string&) { return skip_value(); });
+        }
+        if (c == '[') {
+            return read_array([this] { return skip_value(); });
+        }
+        const size_t start = pos_;
+        while (pos_ < text_.size()) {
+            const char d = text_[pos_];
+            const bool literal = (d >= '0' && d <= '9') || (d >= 'a' && d <= 'z') ||
+                                 d == '-' || d == '+' || d == '.' || d == 'E';
+            if (!literal) {
+                break;
+            }
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    static bool parse_special_double(std::string_view text, double& out) noexcept {
+        if (text == "NaN") {
+            out = std::nan("");
+        } else if (text == "Infinity") {
+            out = HUGE_VAL;
+        } else if (text == "-Infinity") {
+            out = -HUGE_VAL;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void skip_whitespace() noexcept {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\r' || text_[pos_] == '\n')) {
+            ++pos_;
+        }
+    }
+
+    bool read_hex4(uint32_t& out) noexcept {
+        if (text_.size() - pos_ < 4) {
+            return false;
+        }
+        const char* begin = text_.data() + pos_;
+        const auto result = std::from_chars(begin, begin + 4, out, 16);
+        if (result.ec != std::errc() || result.ptr != begin + 4) {
+            return false;
+        }
+        pos_ += 4;
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+inline bool read_tags_json(json_reader& reader, std::unordered_map<std::string, std::string>& tags) {
+    return reader.read_object([&](const std::string& key) {
+        std::string value;
+        if (!reader.read_string(value)) {
+            return false;
+        }
+        tags[key] = std::move(value);
+        return true;
+    });
+}
+
+inline void append_snapshot_json(std::string& out, const metrics_snapshot& snapshot) {
+    out += "{\"capture_time_ns\":";
+    append_text_number(out, to_unix_nanos(snapshot.capture_time));
+    out += ",\"source_id\":";
+    append_json_string(out, snapshot.source_id);
+    out += ",\"metrics\":[";
+    for (size_t i = 0; i < snapshot.metrics.size(); ++i) {
+        const auto& metric = snapshot.metrics[i];
+        if (i > 0) {
+            out.push_back(',');
+        }
+        out += "{\"name\":";
+        append_json_string(out, metric.name);
+        out += ",\"value\":";
+        append_json_double(out, metric.value);
+        out += ",\"timestamp_ns\":";
+        append_text_number(out, to_unix_nanos(metric.timestamp));
+        out += ",\"tags\":";
+        append_tags_json(out, metric.tags);
+        out.push_back('}');
+    }
+    out += "]}\n";
+}
+
+inline bool parse_snapshot_json(std::string_view line, metrics_snapshot& snapshot) {
+    json_reader reader(line);
+    snapshot = metrics_snapshot();
+    const bool parsed = reader.read_object([&](const std::string& key) {
+        if (key == "capture_time_ns") {
+            int64_t ns = 0;
+            if (!reader.read_int64(ns)) {
+                return false;
+            }
+            snapshot.capture_time = from_unix_nanos(ns);
+            return true;
+        }
+        if (key == "source_id") {
+            return reader.read_string(snapshot.source_id);
+        }
+        if (key == "metrics") {
+            return reader.read_array([&] {
+                metric_value metric;
+                const bool read = reader.read_object([&](const std::string& field) {
+                    if (field == "name") {
+                        return reader.read_string(metric.name);
+                    }
+                    if (field == "value") {
+                        return reader.read_double(metric.value);
+                    }
+                    if (field == "timestamp_ns") {
+                        int64_t ns = 0;
+                        if (!reader.read_int64(ns)) {
+                            return false;
+                        }
+                        metric.timestamp = from_unix_nanos(ns);
+                        return true;
+                    }
+                    if (field == "tags") {
+                        return read_tags_json(reader, metric.tags);
+                    }
+                    return reader.skip_value();
+                });
+                if (read) {
+                    snapshot.metrics.push_back(std::move(metric));
+                }
+                return read;
+            });
+        }
+        return reader.skip_value();
+    });
+    return parsed && reader.at_end();
+}
+
+inline constexpr std::string_view snapshot_csv_header =
+    "snapshot,capture_time_ns,source_id,name,value,timestamp_ns,tags\n";
+
+inline void append_csv_field(std::string& out, std::string_view field) {
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(field);
+        return;
+    }
+    out.push_back('"');
+    for (char c : field) {
+        if (c == '"') {
+            out.push_back('"');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+/**
+ * @brief Append the CSV rows of @p snapshot, numbered @p number
+ * @param scratch Reused buffer for the tags JSON
+ */
+inline void append_snapshot_csv(std::string& out, const metrics_snapshot& snapshot, uint64_t number,
+                                std::string& scratch) {
+    auto row_prefix = [&] {
+        append_text_number(out, number);
+        out.push_back(',');
+        append_text_number(out, to_unix_nanos(snapshot.capture_time));
+        out.push_back(',');
+        append_csv_field(out, snapshot.source_id);
+        out.push_back(',');
+    };
+
+    if (snapshot.metrics.empty()) {
+        row_prefix();
+        out += ",,,\n";
+        return;
+    }
+    for (const auto& metric : snapshot.metrics) {
+        row_prefix();
+        append_csv_field(out, metric.name);
+        out.push_back(',');
+        append_text_number(out, metric.value);
+        out.push_back(',');
+        append_text_number(out, to_unix_nanos(metric.timestamp));
+        out.push_back(',');
+        scratch.clear();
+        append_tags_json(scratch, metric.tags);
+        append_csv_field(out, scratch);
+        out.push_back('\n');
+    }
+}
+
+/**
+ * @brief Split the CSV record starting at @p pos into @p fields
+ * @return false if the data ends before the record's terminating newline
+ */
+inline bool read_csv_record(std::string_view data, size_t& pos, std::vector<std::string>& fields) {
+    fields.clear();
+    fields.emplace_back();
+    bool quoted = false;
+    for (size_t i = pos; i < data.size(); ++i) {
+        const char c = data[i];
+        if (quoted) {
+            if (c != '"') {
+                fields.back().push_back(c);
+            } else if (i + 1 < data.size() && data[i + 1] == '"') {
+                fields.back().push_back('"');
+                ++i;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c == '\n') {
+            if (!fields.back().empty() && fields.back().back() == '\r') {
+                fields.back().pop_back();
+            }
+            pos = i + 1;
+            return true;
+        } else {
+            fields.back().push_back(c);
+        }
+    }
+    return false;
+}
+
+template<typename Number>
+bool parse_text_number(std::string_view text, Number& out) noexcept {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+} // namespace detail
+
+/**
+ * @brief Append-only JSON Lines or CSV snapshot file
+ */
+class snapshot_text_log {
+public:
+    /**
+     * @brief Open (or create) the log at config.path and load its snapshots
+     */
+    static common::Result<std::unique_ptr<snapshot_text_log>> create(const snapshot_text_log_config& config) {
+        auto validation = config.validate();
+        if (validation.is_err()) {
+            return common::Result<std::unique_ptr<snapshot_text_log>>::err(validation.error());
+        }
+        std::unique_ptr<snapshot_text_log> log(new snapshot_text_log(config));
+        auto opened = log->open();
+        if (opened.is_err()) {
+            return common::Result<std::unique_ptr<snapshot_text_log>>::err(opened.error());
+        }
+        return common::ok(std::move(log));
+    }
+
+    ~snapshot_text_log() {
+        flush();
+        close();
+    }
+
+    snapshot_text_log(const snapshot_text_log&) = delete;
+    snapshot_text_log& operator=(const snapshot_text_log&) = delete;
+
+    /**
+     * @brief Queue a snapshot, writing the pending ones once batch_records are queued
+     */
+    common::VoidResult append(const metrics_snapshot& snapshot) {
+        encode(pending_, snapshot);
+        ++pending_records_;
+        retained_.push_back(snapshot);
+        if (config_.max_records > 0 && retained_.size() > config_.max_records) {
+            retained_.pop_front();
+        }
+        if (pending_records_ >= config_.batch_records) {
+            return flush();
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Write pending snapshots; on failure they stay pending for a retry
+     */
+    common::VoidResult flush() {
+        if (pending_records_ == 0) {
+            return common::ok();
+        }
+        if (file_ == nullptr) {
+            file_ = std::fopen(config_.path.c_str(), "ab");
+        }
+        const bool written = file_ != nullptr &&
+            std::fwrite(pending_.data(), 1, pending_.size(), file_) == pending_.size() &&
+            std::fflush(file_) == 0 && sync(file_);
+        if (!written) {
+            // Drop any partial write so the file still ends on a record boundary
+            close();
+            std::error_code ec;
+            std::filesystem::resize_file(config_.path, disk_bytes_, ec);
+            return write_error("Cannot write " + config_.path);
+        }
+
+        disk_bytes_ += pending_.size();
+        file_records_ += pending_records_;
+        pending_.clear();
+        pending_records_ = 0;
+        ++writes_;
+
+        if (config_.max_records > 0 && file_records_ > 2 * config_.max_records) {
+            return rewrite();
+        }
+        return common::ok();
+    }
+
+    common::Result<metrics_snapshot> read(size_t index) const {
+        if (index >= retained_.size()) {
+            return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::not_found,
+                "Snapshot index out of range").to_common_error());
+        }
+        return common::ok(retained_[index]);
+    }
+
+    common::Result<std::vector<metrics_snapshot>> read_range(size_t start, size_t count) const {
+        std::vector<metrics_snapshot> result;
+        if (start < retained_.size()) {
+            const size_t end = start + (std::min)(count, retained_.size() - start);
+            result.assign(retained_.begin() + static_cast<std::ptrdiff_t>(start),
+                          retained_.begin() + static_cast<std::ptrdiff_t>(end));
+        }
+        return common::ok(std::move(result));
+    }
+
+    size_t size() const noexcept { return retained_.size(); }
+
+    /**
+     * @brief Drop every snapshot, pending ones included, and empty the file
+     */
+    common::VoidResult clear() {
+        pending_.clear();
+        pending_records_ = 0;
+        retained_.clear();
+        return rewrite();
+    }
+
+    snapshot_text_log_stats get_stats() const noexcept {
+        snapshot_text_log_stats stats;
+        stats.records = retained_.size();
+        stats.pending_records = pending_records_;
+        stats.disk_bytes = disk_bytes_;
+        stats.writes = writes_;
+        stats.rewrites = rewrites_;
+        stats.recovered_bytes = recovered_bytes_;
+        return stats;
+    }
+
+private:
+    explicit snapshot_text_log(const snapshot_text_log_config& config) : config_(config) {}
+
+    bool csv() const noexcept { return config_.format == snapshot_text_format::csv; }
+
+    void encode(std::string& out, const metrics_snapshot& snapshot) {
+        if (csv()) {
+            detail::append_snapshot_csv(out, snapshot, next_number_++, scratch_);
+        } else {
+            detail::append_snapshot_json(out, snapshot);
+        }
+    }
+
+    static common::VoidResult write_error(const std::string& message) {
+        return common::VoidResult::err(error_info(monitoring_error_code::storage_write_failed,
+            message).to_common_error());
+    }
+
+    bool sync(std::FILE* file) const {
+#ifdef MONITORING_HAS_MMAP
+        if (config_.sync_on_flush) {
+            return ::fsync(::fileno(file)) == 0;
+        }
+#endif
+        (void)file;
+        return true;
+    }
+
+    void close() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    common::VoidResult open() {
+        const std::filesystem::path path(config_.path);
+        std::error_code ec;
+        if (path.has_parent_path()) {
+            std::filesystem::create_directories(path.parent_path(), ec);
+        }
+
+        size_t file_size = 0;
+        if (std::filesystem::exists(path, ec)) {
+            file_size = static_cast<size_t>(std::filesystem::file_size(path, ec));
+            if (ec) {
+                return common::VoidResult::err(error_info(monitoring_error_code::storage_read_failed,
+                    "Cannot stat " + config_.path).to_common_error());
+            }
+        }
+
+        detail::mapped_file map;
+        if (!map.map(config_.path, file_size)) {
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_read_failed,
+                "Cannot read " + config_.path).to_common_error());
+        }
+        const std::string_view data(reinterpret_cast<const char*>(map.data()), map.size());
+
+        size_t complete = 0;
+        auto loaded = csv() ? load_csv(data, complete) : load_json(data, complete);
+        map.reset();
+        if (loaded.is_err()) {
+            return loaded;
+        }
+
+        if (complete < file_size) {
+            std::filesystem::resize_file(path, complete, ec);
+            if (ec) {
+                return write_error("Cannot truncate torn tail of " + config_.path);
+            }
+            recovered_bytes_ = file_size - complete;
+        }
+        disk_bytes_ = complete;
+
+        file_ = std::fopen(config_.path.c_str(), "ab");
+        if (file_ == nullptr) {
+            return write_error("Cannot open " + config_.path);
+        }
+        if (csv() && disk_bytes_ == 0) {
+            const bool written =
+                std::fwrite(detail::snapshot_csv_header.data(), 1, detail::snapshot_csv_header.size(), file_) ==
+                    detail::snapshot_csv_header.size() &&
+                std::fflush(file_) == 0 && sync(file_);
+            if (!written) {
+                return write_error("Cannot write " + config_.path);
+            }
+            disk_bytes_ = detail::snapshot_csv_header.size();
+        }
+        return common::ok();
+    }
+
+    void retain_loaded(metrics_snapshot&& snapshot) {
+        ++file_records_;
+        retained_.push_back(std::move(snapshot));
+        if (config_.max_records > 0 && retained_.size() > config_.max_records) {
+            retained_.pop_front();
+        }
+    }
+
+    common::VoidResult corrupt(size_t offset) const {
+        return common::VoidResult::err(error_info(monitoring_error_code::storage_corrupted,
+            "Malformed record at byte " + std::to_string(offset) + " of " + config_.path).to_common_error());
+    }
+
+    common::VoidResult load_json(std::string_view data, size_t& complete) {
+        size_t pos = 0;
+        while (pos < data.size()) {
+            const size_t end = data.find('\n', pos);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            const auto line = data.substr(pos, end - pos);
+            if (line.find_first_not_of(" \t\r") != std::string_view::npos) {
+                metrics_snapshot snapshot;
+                if (!detail::parse_snapshot_json(line, snapshot)) {
+                    return corrupt(pos);
+                }
+                retain_loaded(std::move(snapshot));
+            }
+            pos = end + 1;
+        }
+        complete = pos;
+        return common::ok();
+    }
+
+    common::VoidResult load_csv(std::string_view data, size_t& complete) {
+        const auto header = detail::snapshot_csv_header;
+        if (data.size() < header.size()) {
+            // Empty, or a header torn while the file was created
+            if (header.substr(0, data.size()) != data) {
+                return corrupt(0);
+            }
+            complete = 0;
+            return common::ok();
+        }
+        if (data.substr(0, header.size()) != header) {
+            return corrupt(0);
+        }
+
+        size_t pos = header.size();
+        std::vector<std::string> fields;
+        metrics_snapshot current;
+        uint64_t current_number = 0;
+        bool has_current = false;
+        while (pos < data.size()) {
+            const size_t start = pos;
+            if (!detail::read_csv_record(data, pos, fields)) {
+                break;
+            }
+            uint64_t number = 0;
+            int64_t capture_ns = 0;
+            if (fields.size() != 7 || !detail::parse_text_number(fields[0], number) ||
+                !detail::parse_text_number(fields[1], capture_ns)) {
+                return corrupt(start);
+            }
+            if (!has_current || number != current_number) {
+                if (has_current) {
+                    retain_loaded(std::move(current));
+                }
+                current = metrics_snapshot();
+                current.capture_time = detail::from_unix_nanos(capture_ns);
+                current.source_id = std::move(fields[2]);
+                current_number = number;
+                has_current = true;
+            }
+            if (fields[4].empty()) {
+                continue;  // Row of a snapshot without metrics
+            }
+
+            metric_value metric(std::move(fields[3]));
+            int64_t timestamp_ns = 0;
+            detail::json_reader tags(fields[6]);
+            if (!detail::parse_text_number(fields[4], metric.value) ||
+                !detail::parse_text_number(fields[5], timestamp_ns) ||
+                !detail::read_tags_json(tags, metric.tags) || !tags.at_end()) {
+                return corrupt(start);
+            }
+            metric.timestamp = detail::from_unix_nanos(timestamp_ns);
+            current.metrics.push_back(std::move(metric));
+        }
+        if (has_current) {
+            retain_loaded(std::move(current));
+            next_number_ = current_number + 1;
+        }
+        complete = pos;
+        return common::ok();
+    }
+
+    /**
+     * @brief Replace the file with the retained snapshots
+     */
+    common::VoidResult rewrite() {
+        const std::string temp_path = config_.path + ".tmp";
+        std::string text;
+        if (csv()) {
+            text.assign(detail::snapshot_csv_header);
+            next_number_ = 0;
+        }
+        for (const auto& snapshot : retained_) {
+            encode(text, snapshot);
+        }
+
+        std::FILE* temp = std::fopen(temp_path.c_str(), "wb");
+        bool written = temp != nullptr;
+        if (written) {
+            written = std::fwrite(text.data(), 1, text.size(), temp) == text.size() &&
+                      std::fflush(temp) == 0 && sync(temp);
+            std::fclose(temp);
+        }
+        std::error_code ec;
+        if (written) {
+            close();
+            std::filesystem::rename(temp_path, config_.path, ec);
+            written = !ec;
+        }
+        if (!written) {
+            std::filesystem::remove(temp_path, ec);
+            return write_error("Cannot rewrite " + config_.path);
+        }
+
+        file_ = std::fopen(config_.path.c_str(), "ab");
+        if (file_ == nullptr) {
+            return write_error("Cannot open " + config_.path);
+        }
+        disk_bytes_ = text.size();
+        file_records_ = retained_.size();
+        ++rewrites_;
+        return common::ok();
+    }
+
+    snapshot_text_log_config config_;
+    std::FILE* file_ = nullptr;
+    std::deque<metrics_snapshot> retained_;
+    std::string pending_;
+    size_t pending_records_ = 0;
+    size_t file_records_ = 0;
+    size_t disk_bytes_ = 0;
+    size_t writes_ = 0;
+    size_t rewrites_ = 0;
+    size_t recovered_bytes_ = 0;
+    uint64_t next_number_ = 0;                            // Next CSV snapshot number
+    std::string scratch_;
+};
+
+} // namespace kcenon::monitoring
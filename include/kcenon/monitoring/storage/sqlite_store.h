@@ -0,0 +1,926 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+/**
+ * @file sqlite_store.h
+ * @brief SQLite snapshot store for database_sqlite storage backends
+ *
+ * Available when CMake finds SQLite and defines MONITORING_HAS_SQLITE.
+ *
+ * Schema, for a table prefix `p`:
+ * - `p_snapshots(id INTEGER PRIMARY KEY, capture_ns, source_id)` with an
+ *   index on capture_ns for time range reads;
+ * - `p_values(snapshot_id, seq, name, value, ts_ns, tags)`, clustered by
+ *   (snapshot_id, seq) and indexed by (name, ts_ns). Tags are stored as a
+ *   JSON object so they can be queried with SQLite's JSON functions.
+ *
+ * The database runs in WAL journal mode. append() only queues a snapshot;
+ * a writer thread commits queued snapshots in one transaction per batch
+ * (every batch_records snapshots or commit_interval), binding them into
+ * prepared multi-row INSERT statements that are reused for every batch.
+ * Reads use a second connection, so they see the last committed batch
+ * without waiting for the writer, and queued snapshots are served from
+ * memory.
+ *
+ * Snapshots get consecutive ids; position 0 is the oldest retained one.
+ */
+
+#pragma once
+
+#ifdef MONITORING_HAS_SQLITE
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "kcenon/monitoring/core/result_types.h"
+#include "kcenon/monitoring/core/error_codes.h"
+#include "kcenon/monitoring/interfaces/monitoring_core.h"
+#include "kcenon/monitoring/storage/binary_codec.h"
+
+namespace kcenon::monitoring {
+
+/**
+ * @brief Configuration for sqlite_store
+ */
+struct sqlite_store_config {
+    std::string path;                                     ///< Database file
+    std::string table_prefix{"metrics"};                  ///< Prefix of the store's tables
+    size_t max_records{0};                                ///< Retain at most this many snapshots (0 = unlimited)
+    size_t batch_records{100};                            ///< Commit once this many snapshots are queued
+    std::chrono::milliseconds commit_interval{1000};      ///< Commit queued snapshots at least this often
+    size_t max_pending_records{8192};                     ///< Reject appends while this many are queued
+    bool synchronous_full{false};                         ///< synchronous=FULL instead of NORMAL
+
+    /**
+     * @brief Validate configuration
+     */
+    common::VoidResult validate() const {
+        if (path.empty()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "SQLite database path must not be empty").to_common_error());
+        }
+        const bool valid_prefix = !table_prefix.empty() &&
+            std::all_of(table_prefix.begin(), table_prefix.end(), [](char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            });
+        if (!valid_prefix) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "SQLite table prefix must be a non-empty identifier").to_common_error());
+        }
+        if (batch_records == 0 || commit_interval.count() <= 0 || max_pending_records < batch_records) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                "SQLite batch size and commit interval must be positive and fit the pending limit").to_common_error());
+        }
+        return common::ok();
+    }
+};
+
+/**
+ * @brief Counters reported by sqlite_store
+ */
+struct sqlite_store_stats {
+    size_t records{0};               ///< Retained snapshots, committed or queued
+    size_t pending_records{0};       ///< Snapshots waiting for the writer
+    size_t transactions{0};          ///< Committed write transactions
+    size_t snapshots_written{0};
+    size_t value_rows_written{0};
+    size_t write_errors{0};          ///< Failed (rolled back) transactions
+};
+
+namespace detail {
+
+/**
+ * @brief Owning handle of a prepared statement
+ */
+class sqlite_statement {
+public:
+    sqlite_statement() = default;
+    explicit sqlite_statement(sqlite3_stmt* stmt) noexcept : stmt_(stmt) {}
+    sqlite_statement(sqlite_statement&& other) noexcept : stmt_(std::exchange(other.stmt_, nullptr)) {}
+    sqlite_statement& operator=(sqlite_statement&& other) noexcept {
+        if (this != &other) {
+            sqlite3_finalize(stmt_);
+            stmt_ = std::exchange(other.stmt_, nullptr);
+        }
+        return *this;
+    }
+    ~sqlite_statement() { sqlite3_finalize(stmt_); }
+
+    sqlite_statement(const sqlite_statement&) = delete;
+    sqlite_statement& operator=(const sqlite_statement&) = delete;
+
+    sqlite3_stmt* get() const noexcept { return stmt_; }
+
+private:
+    sqlite3_stmt* stmt_{nullptr};
+};
+
+/**
+ * @brief Encode tags as a JSON object with sorted keys
+ */
+inline std::string encode_tags_json(const std::unordered_map<std::string, std::string>& tags) {
+    std::vector<std::pair<std::string_view, std::string_view>> sorted(tags.begin(), tags.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string out = "{";
+    auto put_string = [&out](std::string_view s) {
+        out += '"';
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                case '\r': out += "\\r"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        out += escaped;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    };
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        put_string(sorted[i].first);
+        out += ':';
+        put_string(sorted[i].second);
+    }
+    out += '}';
+    return out;
+}
+
+/**
+ * @brief Decode a JSON object of strings written by encode_tags_json()
+ * @return false if the text is not such an object
+ */
+inline bool decode_tags_json(std::string_view text, std::unordered_map<std::string, std::string>& tags) {
+    size_t pos = 0;
+    auto skip_spaces = [&] {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\t' || text[pos] == '\r')) {
+            ++pos;
+        }
+    };
+    auto get_string = [&](std::string& out) {
+        skip_spaces();
+        if (pos >= text.size() || text[pos] != '"') {
+            return false;
+        }
+        ++pos;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            c = text[pos++];
+            switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (text.size() - pos < 4) {
+                        return false;
+                    }
+                    const unsigned code = static_cast<unsigned>(std::stoul(std::string(text.substr(pos, 4)), nullptr, 16));
+                    pos += 4;
+                    if (code < 0x80) {
+                        out += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        out += static_cast<char>(0xC0 | (code >> 6));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        out += static_cast<char>(0xE0 | (code >> 12));
+                        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += c; break;
+            }
+        }
+        if (pos >= text.size()) {
+            return false;
+        }
+        ++pos;
+        return true;
+    };
+
+    skip_spaces();
+    if (pos >= text.size() || text[pos++] != '{') {
+        return false;
+    }
+    skip_spaces();
+    if (pos < text.size() && text[pos] == '}') {
+        return true;
+    }
+    while (true) {
+        std::string key;
+        std::string value;
+        if (!get_string(key)) {
+            return false;
+        }
+        skip_spaces();
+        if (pos >= text.size() || text[pos++] != ':' || !get_string(value)) {
+            return false;
+        }
+        tags[std::move(key)] = std::move(value);
+        skip_spaces();
+        if (pos < text.size() && text[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        return pos < text.size() && text[pos] == '}';
+    }
+}
+
+} // namespace detail
+
+/**
+ * @class sqlite_store
+ * @brief Snapshot history in a local SQLite database
+ *
+ * @thread_safety All public methods are thread-safe.
+ */
+class sqlite_store {
+public:
+    /// Rows bound into one multi-row INSERT
+    static constexpr size_t rows_per_statement = 64;
+
+    /**
+     * @brief Open (or create) a store
+     */
+    static common::Result<std::unique_ptr<sqlite_store>> create(const sqlite_store_config& config) {
+        auto validation = config.validate();
+        if (validation.is_err()) {
+            return common::Result<std::unique_ptr<sqlite_store>>::err(validation.error());
+        }
+
+        std::unique_ptr<sqlite_store> store(new sqlite_store(config));
+        auto opened = store->open();
+        if (opened.is_err()) {
+            return common::Result<std::unique_ptr<sqlite_store>>::err(opened.error());
+        }
+        store->writer_thread_ = std::thread(&sqlite_store::writer_loop, store.get());
+        return common::ok(std::move(store));
+    }
+
+    ~sqlite_store() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        writer_cv_.notify_one();
+        if (writer_thread_.joinable()) {
+            writer_thread_.join();
+        }
+        statements_.clear();
+        read_statements_.clear();
+        sqlite3_close(read_db_);
+        sqlite3_close(write_db_);
+    }
+
+    sqlite_store(const sqlite_store&) = delete;
+    sqlite_store& operator=(const sqlite_store&) = delete;
+
+    /**
+     * @brief Queue a snapshot for the next write transaction
+     */
+    common::VoidResult append(const metrics_snapshot& snapshot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() >= config_.max_pending_records) {
+            writer_cv_.notify_one();
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_full,
+                "SQLite writer is behind: too many queued snapshots").to_common_error());
+        }
+
+        pending_.push_back(snapshot);
+        ++next_id_;
+        if (config_.max_records > 0 && next_id_ - first_id_ > static_cast<int64_t>(config_.max_records)) {
+            first_id_ = next_id_ - static_cast<int64_t>(config_.max_records);
+        }
+        if (pending_.size() >= config_.batch_records) {
+            writer_cv_.notify_one();
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Read the snapshot at @p index (0 = oldest retained)
+     */
+    common::Result<metrics_snapshot> read(size_t index) {
+        auto snapshots = read_range(index, 1);
+        if (snapshots.is_err()) {
+            return common::Result<metrics_snapshot>::err(snapshots.error());
+        }
+        if (snapshots.value().empty()) {
+            return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::not_found,
+                "Snapshot index out of range").to_common_error());
+        }
+        return common::ok(std::move(snapshots.value().front()));
+    }
+
+    /**
+     * @brief Read up to @p count snapshots starting at @p start
+     */
+    common::Result<std::vector<metrics_snapshot>> read_range(size_t start, size_t count) {
+        std::vector<metrics_snapshot> queued;
+        int64_t from = 0;
+        int64_t to = 0;
+        int64_t committed_end = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const int64_t size = next_id_ - first_id_;
+            from = first_id_ + static_cast<int64_t>(std::min<size_t>(start, static_cast<size_t>(size)));
+            to = from + static_cast<int64_t>(std::min<size_t>(count, static_cast<size_t>(first_id_ + size - from)));
+            committed_end = std::min(to, persisted_next_id_);
+            for (int64_t id = std::max(from, persisted_next_id_); id < to; ++id) {
+                queued.push_back(pending_[static_cast<size_t>(id - persisted_next_id_)]);
+            }
+        }
+
+        std::vector<metrics_snapshot> result;
+        if (from < committed_end) {
+            std::lock_guard<std::mutex> lock(read_mutex_);
+            auto loaded = load_snapshots(read_statement(select_snapshots_by_id), from, committed_end, result);
+            if (loaded.is_err()) {
+                return common::Result<std::vector<metrics_snapshot>>::err(loaded.error());
+            }
+        }
+        result.insert(result.end(), std::make_move_iterator(queued.begin()), std::make_move_iterator(queued.end()));
+        return common::ok(std::move(result));
+    }
+
+    /**
+     * @brief Read the snapshots captured in [from, to), in storage order
+     */
+    common::Result<std::vector<metrics_snapshot>> read_time_range(std::chrono::system_clock::time_point from,
+                                                                  std::chrono::system_clock::time_point to) {
+        std::vector<metrics_snapshot> queued;
+        int64_t retained_from = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retained_from = first_id_;
+            for (size_t i = 0; i < pending_.size(); ++i) {
+                const auto& snapshot = pending_[i];
+                if (persisted_next_id_ + static_cast<int64_t>(i) >= first_id_ &&
+                    snapshot.capture_time >= from && snapshot.capture_time < to) {
+                    queued.push_back(snapshot);
+                }
+            }
+        }
+
+        std::vector<metrics_snapshot> result;
+        {
+            std::lock_guard<std::mutex> lock(read_mutex_);
+            sqlite3_stmt* stmt = read_statement(select_snapshots_by_time);
+            sqlite3_bind_int64(stmt, 1, detail::to_unix_nanos(from));
+            sqlite3_bind_int64(stmt, 2, detail::to_unix_nanos(to));
+            sqlite3_bind_int64(stmt, 3, retained_from);
+            auto loaded = load_snapshots(stmt, 0, 0, result);
+            if (loaded.is_err()) {
+                return common::Result<std::vector<metrics_snapshot>>::err(loaded.error());
+            }
+        }
+        result.insert(result.end(), std::make_move_iterator(queued.begin()), std::make_move_iterator(queued.end()));
+        return common::ok(std::move(result));
+    }
+
+    /**
+     * @brief Samples of one metric with timestamps in [from, to), oldest first
+     */
+    common::Result<std::vector<std::pair<std::chrono::system_clock::time_point, double>>> read_metric(
+        const std::string& name, std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to) {
+        using samples = std::vector<std::pair<std::chrono::system_clock::time_point, double>>;
+
+        samples queued;
+        int64_t retained_from = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retained_from = first_id_;
+            for (size_t i = 0; i < pending_.size(); ++i) {
+                if (persisted_next_id_ + static_cast<int64_t>(i) < first_id_) {
+                    continue;
+                }
+                for (const auto& metric : pending_[i].metrics) {
+                    if (metric.name == name && metric.timestamp >= from && metric.timestamp < to) {
+                        queued.emplace_back(metric.timestamp, metric.value);
+                    }
+                }
+            }
+        }
+
+        samples result;
+        {
+            std::lock_guard<std::mutex> lock(read_mutex_);
+            sqlite3_stmt* stmt = read_statement(select_metric_samples);
+            sqlite3_bind_text(stmt, 1, name.data(), static_cast<int>(name.size()), SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt, 2, detail::to_unix_nanos(from));
+            sqlite3_bind_int64(stmt, 3, detail::to_unix_nanos(to));
+            sqlite3_bind_int64(stmt, 4, retained_from);
+            int rc;
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                result.emplace_back(detail::from_unix_nanos(sqlite3_column_int64(stmt, 0)),
+                                    sqlite3_column_double(stmt, 1));
+            }
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                return common::Result<samples>::err(sqlite_error(read_db_, monitoring_error_code::storage_read_failed,
+                                                                 "Failed to read metric samples"));
+            }
+        }
+
+        result.insert(result.end(), queued.begin(), queued.end());
+        std::stable_sort(result.begin(), result.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        return common::ok(std::move(result));
+    }
+
+    /**
+     * @brief Commit every queued snapshot and wait for it
+     */
+    common::VoidResult flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const uint64_t ticket = ++flush_requested_;
+        writer_cv_.notify_one();
+        flushed_cv_.wait(lock, [this, ticket] { return flush_completed_ >= ticket; });
+        if (!last_error_.empty()) {
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_write_failed,
+                                                      last_error_).to_common_error());
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Remove every snapshot, committed or queued
+     */
+    common::VoidResult clear() {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        if (!exec(write_db_, "BEGIN IMMEDIATE") ||
+            !exec(write_db_, "DELETE FROM " + config_.table_prefix + "_values") ||
+            !exec(write_db_, "DELETE FROM " + config_.table_prefix + "_snapshots") ||
+            !exec(write_db_, "COMMIT")) {
+            auto error = sqlite_error(write_db_, monitoring_error_code::storage_write_failed, "Failed to clear SQLite store");
+            exec(write_db_, "ROLLBACK");
+            return common::VoidResult::err(error);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        persisted_next_id_ = next_id_;
+        first_id_ = next_id_;
+        deleted_before_ = next_id_;
+        return common::ok();
+    }
+
+    /**
+     * @brief Number of retained snapshots, committed or queued
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<size_t>(next_id_ - first_id_);
+    }
+
+    sqlite_store_stats get_stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sqlite_store_stats stats = stats_;
+        stats.records = static_cast<size_t>(next_id_ - first_id_);
+        stats.pending_records = pending_.size();
+        return stats;
+    }
+
+private:
+    // Write statements
+    enum write_statement_id : size_t {
+        insert_snapshots_multi,
+        insert_snapshot,
+        insert_values_multi,
+        insert_value,
+        delete_old_values,
+        delete_old_snapshots,
+        write_statement_count
+    };
+
+    // Read statements
+    enum read_statement_id : size_t {
+        select_snapshots_by_id,
+        select_snapshots_by_time,
+        select_values_by_id,
+        select_metric_samples,
+        read_statement_count
+    };
+
+    explicit sqlite_store(const sqlite_store_config& config) : config_(config) {}
+
+    static common::error_info sqlite_error(sqlite3* db, monitoring_error_code code, const std::string& what) {
+        return error_info(code, what + ": " + (db ? sqlite3_errmsg(db) : "out of memory")).to_common_error();
+    }
+
+    static bool exec(sqlite3* db, const std::string& sql) {
+        return sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+
+    static std::string values_placeholders(size_t rows, size_t columns) {
+        std::string row = "(";
+        for (size_t c = 0; c < columns; ++c) {
+            row += c == 0 ? "?" : ",?";
+        }
+        row += ")";
+        std::string sql;
+        for (size_t r = 0; r < rows; ++r) {
+            sql += r == 0 ? row : "," + row;
+        }
+        return sql;
+    }
+
+    common::VoidResult open_connection(sqlite3*& db) {
+        const int rc = sqlite3_open_v2(config_.path.c_str(), &db,
+                                       SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (rc != SQLITE_OK) {
+            return common::VoidResult::err(sqlite_error(db, monitoring_error_code::storage_not_initialized,
+                                                        "Failed to open SQLite database " + config_.path));
+        }
+        sqlite3_busy_timeout(db, 5000);
+        return common::ok();
+    }
+
+    common::VoidResult prepare(sqlite3* db, const std::string& sql, detail::sqlite_statement& out) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+            return common::VoidResult::err(sqlite_error(db, monitoring_error_code::storage_not_initialized,
+                                                        "Failed to prepare statement"));
+        }
+        out = detail::sqlite_statement(stmt);
+        return common::ok();
+    }
+
+    common::VoidResult open() {
+        auto opened = open_connection(write_db_);
+        if (opened.is_err()) {
+            return opened;
+        }
+
+        // WAL lets the read connection work while a batch is being written
+        sqlite3_stmt* mode = nullptr;
+        std::string journal_mode;
+        if (sqlite3_prepare_v2(write_db_, "PRAGMA journal_mode=WAL", -1, &mode, nullptr) == SQLITE_OK &&
+            sqlite3_step(mode) == SQLITE_ROW) {
+            journal_mode = reinterpret_cast<const char*>(sqlite3_column_text(mode, 0));
+        }
+        sqlite3_finalize(mode);
+        if (journal_mode != "wal") {
+            return common::VoidResult::err(sqlite_error(write_db_, monitoring_error_code::storage_not_initialized,
+                                                        "Failed to enable WAL journal mode"));
+        }
+
+        const std::string& p = config_.table_prefix;
+        const std::string schema =
+            std::string("PRAGMA synchronous=") + (config_.synchronous_full ? "FULL" : "NORMAL") + ";"
+            "CREATE TABLE IF NOT EXISTS " + p + "_snapshots ("
+            "id INTEGER PRIMARY KEY, capture_ns INTEGER NOT NULL, source_id TEXT NOT NULL);"
+            "CREATE INDEX IF NOT EXISTS " + p + "_snapshots_time ON " + p + "_snapshots(capture_ns);"
+            "CREATE TABLE IF NOT EXISTS " + p + "_values ("
+            "snapshot_id INTEGER NOT NULL, seq INTEGER NOT NULL, name TEXT NOT NULL, value REAL NOT NULL, "
+            "ts_ns INTEGER NOT NULL, tags TEXT NOT NULL, PRIMARY KEY (snapshot_id, seq)) WITHOUT ROWID;"
+            "CREATE INDEX IF NOT EXISTS " + p + "_values_name_time ON " + p + "_values(name, ts_ns);";
+        if (!exec(write_db_, schema)) {
+            return common::VoidResult::err(sqlite_error(write_db_, monitoring_error_code::storage_not_initialized,
+                                                        "Failed to create SQLite schema"));
+        }
+
+        // Ids are consecutive, so the retained range is [MIN(id), MAX(id)]
+        sqlite3_stmt* bounds = nullptr;
+        if (sqlite3_prepare_v2(write_db_, ("SELECT MIN(id), MAX(id) FROM " + p + "_snapshots").c_str(),
+                               -1, &bounds, nullptr) != SQLITE_OK || sqlite3_step(bounds) != SQLITE_ROW) {
+            sqlite3_finalize(bounds);
+            return common::VoidResult::err(sqlite_error(write_db_, monitoring_error_code::storage_not_initialized,
+                                                        "Failed to read SQLite snapshot ids"));
+        }
+        if (sqlite3_column_type(bounds, 0) != SQLITE_NULL) {
+            first_id_ = sqlite3_column_int64(bounds, 0);
+            next_id_ = sqlite3_column_int64(bounds, 1) + 1;
+        }
+        sqlite3_finalize(bounds);
+        persisted_next_id_ = next_id_;
+        deleted_before_ = first_id_;
+        if (config_.max_records > 0 && next_id_ - first_id_ > static_cast<int64_t>(config_.max_records)) {
+            first_id_ = next_id_ - static_cast<int64_t>(config_.max_records);
+        }
+
+        statements_.resize(write_statement_count);
+        const std::string insert_snapshots_sql = "INSERT INTO " + p + "_snapshots (id, capture_ns, source_id) VALUES ";
+        const std::string insert_values_sql = "INSERT INTO " + p + "_values (snapshot_id, seq, name, value, ts_ns, tags) VALUES ";
+        const std::pair<write_statement_id, std::string> write_sql[] = {
+            {insert_snapshots_multi, insert_snapshots_sql + values_placeholders(rows_per_statement, 3)},
+            {insert_snapshot, insert_snapshots_sql + values_placeholders(1, 3)},
+            {insert_values_multi, insert_values_sql + values_placeholders(rows_per_statement, 6)},
+            {insert_value, insert_values_sql + values_placeholders(1, 6)},
+            {delete_old_values, "DELETE FROM " + p + "_values WHERE snapshot_id < ?"},
+            {delete_old_snapshots, "DELETE FROM " + p + "_snapshots WHERE id < ?"},
+        };
+        for (const auto& [id, sql] : write_sql) {
+            auto prepared = prepare(write_db_, sql, statements_[id]);
+            if (prepared.is_err()) {
+                return prepared;
+            }
+        }
+
+        opened = open_connection(read_db_);
+        if (opened.is_err()) {
+            return opened;
+        }
+        read_statements_.resize(read_statement_count);
+        const std::string select_snapshots_sql = "SELECT id, capture_ns, source_id FROM " + p + "_snapshots ";
+        const std::pair<read_statement_id, std::string> read_sql[] = {
+            {select_snapshots_by_id, select_snapshots_sql + "WHERE id >= ? AND id < ? ORDER BY id"},
+            {select_snapshots_by_time, select_snapshots_sql +
+                "WHERE capture_ns >= ? AND capture_ns < ? AND id >= ? ORDER BY id"},
+            {select_values_by_id, "SELECT snapshot_id, name, value, ts_ns, tags FROM " + p +
+                "_values WHERE snapshot_id >= ? AND snapshot_id <= ? ORDER BY snapshot_id, seq"},
+            {select_metric_samples, "SELECT ts_ns, value FROM " + p +
+                "_values WHERE name = ? AND ts_ns >= ? AND ts_ns < ? AND snapshot_id >= ? ORDER BY ts_ns"},
+        };
+        for (const auto& [id, sql] : read_sql) {
+            auto prepared = prepare(read_db_, sql, read_statements_[id]);
+            if (prepared.is_err()) {
+                return prepared;
+            }
+        }
+        return common::ok();
+    }
+
+    sqlite3_stmt* statement(write_statement_id id) const noexcept { return statements_[id].get(); }
+    sqlite3_stmt* read_statement(read_statement_id id) const noexcept { return read_statements_[id].get(); }
+
+    /**
+     * @brief Load snapshots selected by @p stmt together with their values
+     *
+     * With @p to > @p from the statement is bound to the id range [from, to);
+     * otherwise it must already be bound.
+     * @note Caller holds read_mutex_
+     */
+    common::VoidResult load_snapshots(sqlite3_stmt* stmt, int64_t from, int64_t to,
+                                      std::vector<metrics_snapshot>& out) {
+        if (to > from) {
+            sqlite3_bind_int64(stmt, 1, from);
+            sqlite3_bind_int64(stmt, 2, to);
+        }
+
+        std::map<int64_t, size_t> positions;
+        const size_t first = out.size();
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            metrics_snapshot snapshot;
+            snapshot.capture_time = detail::from_unix_nanos(sqlite3_column_int64(stmt, 1));
+            const auto* source = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            snapshot.source_id.assign(source ? source : "", static_cast<size_t>(sqlite3_column_bytes(stmt, 2)));
+            positions.emplace(sqlite3_column_int64(stmt, 0), out.size());
+            out.push_back(std::move(snapshot));
+        }
+        sqlite3_reset(stmt);
+        if (rc != SQLITE_DONE) {
+            return common::VoidResult::err(sqlite_error(read_db_, monitoring_error_code::storage_read_failed,
+                                                        "Failed to read snapshots"));
+        }
+        if (positions.empty()) {
+            return common::ok();
+        }
+
+        sqlite3_stmt* values = read_statement(select_values_by_id);
+        sqlite3_bind_int64(values, 1, positions.begin()->first);
+        sqlite3_bind_int64(values, 2, positions.rbegin()->first);
+        while ((rc = sqlite3_step(values)) == SQLITE_ROW) {
+            auto it = positions.find(sqlite3_column_int64(values, 0));
+            if (it == positions.end()) {
+                continue;
+            }
+            const auto* name = reinterpret_cast<const char*>(sqlite3_column_text(values, 1));
+            metric_value metric(std::string(name ? name : "", static_cast<size_t>(sqlite3_column_bytes(values, 1))),
+                                sqlite3_column_double(values, 2));
+            metric.timestamp = detail::from_unix_nanos(sqlite3_column_int64(values, 3));
+            const auto* tags = reinterpret_cast<const char*>(sqlite3_column_text(values, 4));
+            if (tags && !detail::decode_tags_json(std::string_view(tags, static_cast<size_t>(sqlite3_column_bytes(values, 4))),
+                                                  metric.tags)) {
+                rc = SQLITE_CORRUPT;
+                break;
+            }
+            out[it->second].metrics.push_back(std::move(metric));
+        }
+        sqlite3_reset(values);
+        if (rc != SQLITE_DONE) {
+            out.resize(first);
+            return common::VoidResult::err(error_info(monitoring_error_code::storage_read_failed,
+                "Failed to read snapshot values").to_common_error());
+        }
+        return common::ok();
+    }
+
+    /**
+     * @brief Insert @p items through the multi-row statement, then the rest one by one
+     * @param bind Binds one item at a 1-based parameter index
+     */
+    template <typename Item, typename Bind>
+    bool insert_rows(write_statement_id multi, write_statement_id single, int columns,
+                     const std::vector<Item>& items, Bind&& bind) {
+        size_t i = 0;
+        sqlite3_stmt* stmt = statement(multi);
+        for (; i + rows_per_statement <= items.size(); i += rows_per_statement) {
+            for (size_t r = 0; r < rows_per_statement; ++r) {
+                bind(stmt, static_cast<int>(r) * columns + 1, items[i + r]);
+            }
+            const int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                return false;
+            }
+        }
+
+        stmt = statement(single);
+        for (; i < items.size(); ++i) {
+            bind(stmt, 1, items[i]);
+            const int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Commit the queued snapshots in one transaction
+     */
+    bool write_pending() {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+
+        // Queued snapshots stay in place until committed: appends only push
+        // to the back and clear() needs write_mutex_, so references are stable
+        struct snapshot_row {
+            int64_t id;
+            const metrics_snapshot* snapshot;
+        };
+        struct value_row {
+            int64_t snapshot_id;
+            int64_t seq;
+            const metric_value* metric;
+        };
+        std::vector<snapshot_row> snapshots;
+        int64_t base = 0;
+        int64_t retain_from = 0;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            count = pending_.size();
+            base = persisted_next_id_;
+            retain_from = first_id_;
+            snapshots.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                const int64_t id = base + static_cast<int64_t>(i);
+                if (id >= retain_from) {
+                    snapshots.push_back({id, &pending_[i]});
+                }
+            }
+        }
+        if (count == 0) {
+            return true;
+        }
+
+        std::vector<value_row> values;
+        for (const auto& row : snapshots) {
+            for (size_t i = 0; i < row.snapshot->metrics.size(); ++i) {
+                values.push_back({row.id, static_cast<int64_t>(i), &row.snapshot->metrics[i]});
+            }
+        }
+
+        bool ok = exec(write_db_, "BEGIN IMMEDIATE");
+        ok = ok && insert_rows(insert_snapshots_multi, insert_snapshot, 3, snapshots,
+            [](sqlite3_stmt* stmt, int at, const snapshot_row& row) {
+                const auto& source = row.snapshot->source_id;
+                sqlite3_bind_int64(stmt, at, row.id);
+                sqlite3_bind_int64(stmt, at + 1, detail::to_unix_nanos(row.snapshot->capture_time));
+                sqlite3_bind_text(stmt, at + 2, source.data(), static_cast<int>(source.size()), SQLITE_STATIC);
+            });
+        ok = ok && insert_rows(insert_values_multi, insert_value, 6, values,
+            [](sqlite3_stmt* stmt, int at, const value_row& row) {
+                const auto& name = row.metric->name;
+                const std::string tags = detail::encode_tags_json(row.metric->tags);
+                sqlite3_bind_int64(stmt, at, row.snapshot_id);
+                sqlite3_bind_int64(stmt, at + 1, row.seq);
+                sqlite3_bind_text(stmt, at + 2, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+                sqlite3_bind_double(stmt, at + 3, row.metric->value);
+                sqlite3_bind_int64(stmt, at + 4, detail::to_unix_nanos(row.metric->timestamp));
+                sqlite3_bind_text(stmt, at + 5, tags.data(), static_cast<int>(tags.size()), SQLITE_TRANSIENT);
+            });
+        if (ok && retain_from > deleted_before_) {
+            for (auto id : {delete_old_values, delete_old_snapshots}) {
+                sqlite3_stmt* stmt = statement(id);
+                sqlite3_bind_int64(stmt, 1, retain_from);
+                ok = ok && sqlite3_step(stmt) == SQLITE_DONE;
+                sqlite3_reset(stmt);
+            }
+        }
+        ok = ok && exec(write_db_, "COMMIT");
+
+        std::string error;
+        if (!ok) {
+            error = std::string("Failed to write SQLite batch: ") + sqlite3_errmsg(write_db_);
+            exec(write_db_, "ROLLBACK");
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok) {
+            last_error_ = std::move(error);
+            ++stats_.write_errors;
+            return false;
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(count));
+        persisted_next_id_ = base + static_cast<int64_t>(count);
+        deleted_before_ = std::max(deleted_before_, retain_from);
+        last_error_.clear();
+        ++stats_.transactions;
+        stats_.snapshots_written += snapshots.size();
+        stats_.value_rows_written += values.size();
+        return true;
+    }
+
+    void writer_loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            writer_cv_.wait_for(lock, config_.commit_interval, [this] {
+                return stopping_ || flush_requested_ > flush_completed_ ||
+                       pending_.size() >= config_.batch_records;
+            });
+
+            const uint64_t ticket = flush_requested_;
+            bool written = true;
+            if (!pending_.empty()) {
+                lock.unlock();
+                written = write_pending();
+                lock.lock();
+            }
+            flush_completed_ = ticket;
+            flushed_cv_.notify_all();
+
+            if (stopping_ && (pending_.empty() || !written)) {
+                break;
+            }
+            if (!written) {
+                // Back off instead of retrying a failing batch in a tight loop
+                writer_cv_.wait_for(lock, config_.commit_interval, [this] { return stopping_; });
+            }
+        }
+    }
+
+    sqlite_store_config config_;
+    sqlite3* write_db_{nullptr};
+    sqlite3* read_db_{nullptr};
+    std::vector<detail::sqlite_statement> statements_;       // write_db_, used under write_mutex_
+    std::vector<detail::sqlite_statement> read_statements_;  // read_db_, used under read_mutex_
+    std::mutex write_mutex_;                                 // Taken before mutex_
+    std::mutex read_mutex_;
+
+    mutable std::mutex mutex_;
+    std::deque<metrics_snapshot> pending_;   // Ids persisted_next_id_ ... next_id_ - 1
+    int64_t first_id_{1};                    // Oldest retained snapshot
+    int64_t next_id_{1};
+    int64_t persisted_next_id_{1};           // Ids below this are committed
+    int64_t deleted_before_{1};              // Rows below this id are deleted
+    uint64_t flush_requested_{0};
+    uint64_t flush_completed_{0};
+    bool stopping_{false};
+    std::string last_error_;
+    sqlite_store_stats stats_;
+    std::condition_variable writer_cv_;
+    std::condition_variable flushed_cv_;
+    std::thread writer_thread_;
+};
+
+} // namespace kcenon::monitoring
+
+#endif // MONITORING_HAS_SQLITE
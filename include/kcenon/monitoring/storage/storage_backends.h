@@ -21,6 +21,9 @@
 
 #include "kcenon/monitoring/core/result_types.h"
 #include "kcenon/monitoring/interfaces/monitoring_core.h"
+#include "kcenon/monitoring/storage/segment_store.h"
+#include "kcenon/monitoring/storage/snapshot_text_log.h"
+#include "kcenon/monitoring/storage/sqlite_store.h"
 
 namespace kcenon::monitoring {
 
@@ -40,16 +43,6 @@ enum class storage_backend_type {
     cloud_azure_blob
 };
 
-/**
- * @brief Compression algorithms
- */
-enum class compression_algorithm {
-    none,
-    gzip,
-    lz4,
-    zstd
-};
-
 /**
  * @brief Storage configuration
  */
@@ -72,6 +65,15 @@ struct storage_config {
     std::string username;
     std::string password;
 
+    // Segment engine settings for file_binary backends
+    size_t segment_size_bytes{8 * 1024 * 1024};
+    std::chrono::seconds segment_max_age{3600};
+    std::chrono::seconds retention_period{0};             // 0 = keep until max_capacity / max_size_mb
+    std::chrono::seconds rollup_after{0};                 // 0 = keep raw snapshots
+    std::chrono::seconds rollup_resolution{60};
+    std::chrono::milliseconds compaction_interval{0};     // 0 = no background compaction
+    size_t compaction_io_bytes_per_sec{16 * 1024 * 1024};
+
     /**
      * @brief Validate configuration
      * @return common::Result<bool> indicating validation success or failure
@@ -119,17 +121,99 @@ public:
 
 /**
  * @brief File storage backend for metrics snapshots
+ *
+ * The file_* types persist snapshots and survive restarts. Snapshots are
+ * written every @c batch_size snapshots, on flush(), and - with
+ * @c auto_flush - once @c flush_interval has passed since the last write;
+ * @c max_capacity bounds retained snapshots.
+ *
+ * file_json and file_csv append JSON Lines or CSV rows to the file named
+ * by @c path (see snapshot_text_log.h for both layouts).
+ *
+ * file_binary uses a segment_store in the directory named by @c path,
+ * writing columnar blocks (dictionary-encoded names and tags, delta
+ * timestamps and XOR-encoded values) so offline jobs can scan single
+ * metrics through segment_store::scan_metrics(). @c max_size_mb bounds its
+ * bytes on disk. Blocks are compressed with @c compression: lz4 is built
+ * in, gzip and zstd need zlib / libzstd at configure time, and an
+ * unavailable codec fails store() with the open error. With
+ * @c compaction_interval set, a background compactor merges small
+ * segments, deletes data older than @c retention_period and rolls segments
+ * older than @c rollup_after up to @c rollup_resolution, within
+ * @c compaction_io_bytes_per_sec.
+ *
+ * Other types (memory_buffer) keep snapshots in memory only.
  */
 class file_storage_backend : public snapshot_storage_backend {
 public:
     file_storage_backend() : config_() {}
 
     explicit file_storage_backend(const storage_config& config)
-        : config_(config) {}
+        : config_(config) {
+        if (!is_file_type(config_.type) || config_.path.empty()) {
+            return;
+        }
+        last_flush_ = std::chrono::steady_clock::now();
+
+        if (config_.type != storage_backend_type::file_binary) {
+            snapshot_text_log_config log_config;
+            log_config.path = config_.path;
+            log_config.format = config_.type == storage_backend_type::file_csv ? snapshot_text_format::csv
+                                                                               : snapshot_text_format::json_lines;
+            log_config.max_records = config_.max_capacity;
+            log_config.batch_records = config_.batch_size;
+
+            auto log = snapshot_text_log::create(log_config);
+            if (log.is_ok()) {
+                log_ = std::move(log.value());
+            } else {
+                open_error_ = log.error().message;
+            }
+            return;
+        }
+
+        segment_store_config store_config;
+        store_config.directory = config_.path;
+        store_config.segment_size_bytes = config_.segment_size_bytes;
+        store_config.segment_max_age = config_.segment_max_age;
+        store_config.max_total_bytes = config_.max_size_mb * 1024 * 1024;
+        store_config.max_records = config_.max_capacity;
+        store_config.block_records = config_.batch_size;
+        store_config.compression = config_.compression;
+        store_config.retention_period = config_.retention_period;
+        store_config.rollup_after = config_.rollup_after;
+        store_config.rollup_resolution = config_.rollup_resolution;
+        store_config.compaction_interval = config_.compaction_interval;
+        store_config.compaction_io_bytes_per_sec = config_.compaction_io_bytes_per_sec;
+        store_config.block_format = segment_block_format::columnar;
+
+        auto store = segment_store::create(store_config);
+        if (store.is_ok()) {
+            store_ = std::move(store.value());
+        } else {
+            open_error_ = store.error().message;
+        }
+    }
 
     common::Result<bool> store(const metrics_snapshot& snapshot) override {
         std::lock_guard<std::mutex> lock(mutex_);
 
+        if (!open_error_.empty()) {
+            return common::Result<bool>::err(error_info(monitoring_error_code::storage_not_initialized, open_error_).to_common_error());
+        }
+
+        if (store_ || log_) {
+            auto appended = store_ ? store_->append(snapshot) : log_->append(snapshot);
+            if (appended.is_err()) {
+                return common::Result<bool>::err(appended.error());
+            }
+            if (config_.auto_flush &&
+                std::chrono::steady_clock::now() - last_flush_ >= config_.flush_interval) {
+                return flush_locked();
+            }
+            return common::ok(true);
+        }
+
         // Remove oldest if at capacity
         if (snapshots_.size() >= config_.max_capacity) {
             snapshots_.pop_front();
@@ -142,6 +226,13 @@ public:
     common::Result<metrics_snapshot> retrieve(size_t index) override {
         std::lock_guard<std::mutex> lock(mutex_);
 
+        if (store_) {
+            return store_->read(index);
+        }
+        if (log_) {
+            return log_->read(index);
+        }
+
         if (index >= snapshots_.size()) {
             return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::not_found, "Snapshot index out of range").to_common_error());
         }
@@ -152,6 +243,13 @@ public:
     common::Result<std::vector<metrics_snapshot>> retrieve_range(size_t start, size_t count) override {
         std::lock_guard<std::mutex> lock(mutex_);
 
+        if (store_) {
+            return store_->read_range(start, count);
+        }
+        if (log_) {
+            return log_->read_range(start, count);
+        }
+
         std::vector<metrics_snapshot> result;
         size_t end = std::min(start + count, snapshots_.size());
 
@@ -164,7 +262,7 @@ public:
 
     size_t size() const override {
         std::lock_guard<std::mutex> lock(mutex_);
-        return snapshots_.size();
+        return store_ ? store_->size() : log_ ? log_->size() : snapshots_.size();
     }
 
     size_t capacity() const override {
@@ -172,43 +270,143 @@ public:
     }
 
     common::Result<bool> flush() override {
-        // Stub implementation - actual file I/O would go here
-        return common::ok(true);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return flush_locked();
     }
 
     common::Result<bool> clear() override {
         std::lock_guard<std::mutex> lock(mutex_);
+        if (store_ || log_) {
+            auto cleared = store_ ? store_->clear() : log_->clear();
+            if (cleared.is_err()) {
+                return common::Result<bool>::err(cleared.error());
+            }
+        }
         snapshots_.clear();
         return common::ok(true);
     }
 
     std::unordered_map<std::string, size_t> get_stats() const override {
         std::lock_guard<std::mutex> lock(mutex_);
+        if (log_) {
+            const auto stats = log_->get_stats();
+            return {
+                {"total_snapshots", stats.records},
+                {"capacity", config_.max_capacity},
+                {"disk_bytes", stats.disk_bytes},
+                {"pending_snapshots", stats.pending_records},
+                {"writes", stats.writes},
+                {"rewrites", stats.rewrites},
+                {"recovered_bytes", stats.recovered_bytes}
+            };
+        }
+        if (!store_) {
+            return {
+                {"total_snapshots", snapshots_.size()},
+                {"capacity", config_.max_capacity}
+            };
+        }
+
+        const auto stats = store_->get_stats();
         return {
-            {"total_snapshots", snapshots_.size()},
-            {"capacity", config_.max_capacity}
+            {"total_snapshots", stats.records},
+            {"capacity", config_.max_capacity},
+            {"segments", stats.segments},
+            {"disk_bytes", stats.disk_bytes},
+            {"pending_snapshots", stats.pending_records},
+            {"blocks_written", stats.blocks_written},
+            {"segments_rotated", stats.segments_rotated},
+            {"recovered_bytes", stats.recovered_bytes}
         };
     }
 
 private:
+    static bool is_file_type(storage_backend_type type) noexcept {
+        return type == storage_backend_type::file_json ||
+               type == storage_backend_type::file_binary ||
+               type == storage_backend_type::file_csv;
+    }
+
+    common::Result<bool> flush_locked() {
+        if (!store_ && !log_) {
+            return common::ok(true);
+        }
+        auto flushed = store_ ? store_->flush() : log_->flush();
+        last_flush_ = std::chrono::steady_clock::now();
+        if (flushed.is_err()) {
+            return common::Result<bool>::err(flushed.error());
+        }
+        return common::ok(true);
+    }
+
     storage_config config_;
     std::deque<metrics_snapshot> snapshots_;
+    std::unique_ptr<segment_store> store_;      // file_binary
+    std::unique_ptr<snapshot_text_log> log_;    // file_json, file_csv
+    std::string open_error_;
+    std::chrono::steady_clock::time_point last_flush_;
     mutable std::mutex mutex_;
 };
 
 /**
- * @brief Database storage backend (stub implementation)
+ * @brief Database storage backend
+ *
+ * database_sqlite persists snapshots through a sqlite_store in the database
+ * file named by @c path (or @c database_name) when SQLite was found at
+ * configure time: tables are prefixed with @c table_name, writes are
+ * batched every @c batch_size snapshots or @c flush_interval, and
+ * @c max_capacity bounds retained snapshots.
+ *
+ * PostgreSQL, MySQL and builds without SQLite keep snapshots in memory only.
  */
 class database_storage_backend : public snapshot_storage_backend {
 public:
     database_storage_backend() : config_() {}
 
     explicit database_storage_backend(const storage_config& config)
-        : config_(config), connected_(true) {}
+        : config_(config), connected_(true) {
+#ifdef MONITORING_HAS_SQLITE
+        if (config_.type != storage_backend_type::database_sqlite) {
+            return;
+        }
+
+        sqlite_store_config store_config;
+        store_config.path = config_.path.empty() ? config_.database_name : config_.path;
+        if (!config_.table_name.empty()) {
+            store_config.table_prefix = config_.table_name;
+        }
+        store_config.max_records = config_.max_capacity;
+        store_config.batch_records = config_.batch_size;
+        store_config.commit_interval = config_.flush_interval;
+        store_config.max_pending_records = std::max(store_config.max_pending_records, config_.batch_size);
+
+        auto store = sqlite_store::create(store_config);
+        if (store.is_ok()) {
+            store_ = std::move(store.value());
+        } else {
+            open_error_ = store.error().message;
+            connected_ = false;
+        }
+#endif
+    }
 
     common::Result<bool> store(const metrics_snapshot& snapshot) override {
         std::lock_guard<std::mutex> lock(mutex_);
 
+        if (!open_error_.empty()) {
+            return common::Result<bool>::err(error_info(monitoring_error_code::storage_not_initialized, open_error_).to_common_error());
+        }
+
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            auto appended = store_->append(snapshot);
+            if (appended.is_err()) {
+                return common::Result<bool>::err(appended.error());
+            }
+            return common::ok(true);
+        }
+#endif
+
         if (snapshots_.size() >= config_.max_capacity) {
             snapshots_.pop_front();
         }
@@ -220,6 +418,12 @@ public:
     common::Result<metrics_snapshot> retrieve(size_t index) override {
         std::lock_guard<std::mutex> lock(mutex_);
 
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            return store_->read(index);
+        }
+#endif
+
         if (index >= snapshots_.size()) {
             return common::Result<metrics_snapshot>::err(error_info(monitoring_error_code::not_found, "Snapshot index out of range").to_common_error());
         }
@@ -230,6 +434,12 @@ public:
     common::Result<std::vector<metrics_snapshot>> retrieve_range(size_t start, size_t count) override {
         std::lock_guard<std::mutex> lock(mutex_);
 
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            return store_->read_range(start, count);
+        }
+#endif
+
         std::vector<metrics_snapshot> result;
         size_t end = std::min(start + count, snapshots_.size());
 
@@ -240,8 +450,37 @@ public:
         return common::ok(std::move(result));
     }
 
+    /**
+     * @brief Retrieve the snapshots captured in [from, to)
+     *
+     * Served from the capture time index with SQLite.
+     */
+    common::Result<std::vector<metrics_snapshot>> retrieve_time_range(
+        std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            return store_->read_time_range(from, to);
+        }
+#endif
+
+        std::vector<metrics_snapshot> result;
+        for (const auto& snapshot : snapshots_) {
+            if (snapshot.capture_time >= from && snapshot.capture_time < to) {
+                result.push_back(snapshot);
+            }
+        }
+        return common::ok(std::move(result));
+    }
+
     size_t size() const override {
         std::lock_guard<std::mutex> lock(mutex_);
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            return store_->size();
+        }
+#endif
         return snapshots_.size();
     }
 
@@ -250,17 +489,48 @@ public:
     }
 
     common::Result<bool> flush() override {
+#ifdef MONITORING_HAS_SQLITE
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (store_) {
+            auto flushed = store_->flush();
+            if (flushed.is_err()) {
+                return common::Result<bool>::err(flushed.error());
+            }
+        }
+#endif
         return common::ok(true);
     }
 
     common::Result<bool> clear() override {
         std::lock_guard<std::mutex> lock(mutex_);
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            auto cleared = store_->clear();
+            if (cleared.is_err()) {
+                return common::Result<bool>::err(cleared.error());
+            }
+        }
+#endif
         snapshots_.clear();
         return common::ok(true);
     }
 
     std::unordered_map<std::string, size_t> get_stats() const override {
         std::lock_guard<std::mutex> lock(mutex_);
+#ifdef MONITORING_HAS_SQLITE
+        if (store_) {
+            const auto stats = store_->get_stats();
+            return {
+                {"stored_count", stats.records},
+                {"capacity", config_.max_capacity},
+                {"connected", 1UL},
+                {"pending_snapshots", stats.pending_records},
+                {"transactions", stats.transactions},
+                {"value_rows_written", stats.value_rows_written},
+                {"write_errors", stats.write_errors}
+            };
+        }
+#endif
         return {
             {"stored_count", snapshots_.size()},
             {"capacity", config_.max_capacity},
@@ -271,6 +541,10 @@ public:
 private:
     storage_config config_;
     std::deque<metrics_snapshot> snapshots_;
+#ifdef MONITORING_HAS_SQLITE
+    std::unique_ptr<sqlite_store> store_;
+#endif
+    std::string open_error_;
     mutable std::mutex mutex_;
     bool connected_{false};
 };
@@ -17,6 +17,7 @@
 #include "stream_aggregator.h"
 #include "metric_storage.h"
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -142,6 +143,8 @@ public:
      * @return Result indicating success or failure
      */
     common::VoidResult process_observation(const std::string& metric_name, double value) {
+        notify_observers(metric_name, value);
+
         std::shared_lock<std::shared_mutex> lock(mutex_);
 
         auto it = aggregators_.find(metric_name);
@@ -153,6 +156,28 @@ public:
         return it->second.aggregator->add_observation(value);
     }
 
+    /**
+     * @brief Register a function called with every processed observation,
+     *        timestamped on arrival
+     * @return Id for remove_ingest_observer()
+     */
+    size_t add_ingest_observer(ingest_observer observer) {
+        std::unique_lock<std::shared_mutex> lock(observers_mutex_);
+        const size_t id = next_observer_id_++;
+        observers_.emplace_back(id, std::move(observer));
+        return id;
+    }
+
+    /**
+     * @brief Unregister an ingest observer, waiting for running calls
+     */
+    void remove_ingest_observer(size_t id) {
+        std::unique_lock<std::shared_mutex> lock(observers_mutex_);
+        observers_.erase(std::remove_if(observers_.begin(), observers_.end(),
+                                        [id](const auto& entry) { return entry.first == id; }),
+                         observers_.end());
+    }
+
     /**
      * @brief Get current statistics for a metric
      * @param metric_name The metric name
@@ -296,9 +321,39 @@ private:
         std::chrono::system_clock::time_point last_aggregation;
     };
 
+    void notify_observers(const std::string& metric_name, double value) const {
+        std::shared_lock<std::shared_mutex> lock(observers_mutex_);
+        if (observers_.empty()) {
+            return;
+        }
+
+        // Reuse one buffer per thread; an observer that processes another
+        // observation on this thread gets a fresh one instead
+        thread_local std::vector<observed_sample> buffer;
+        thread_local bool buffer_in_use = false;
+        std::vector<observed_sample> nested;
+        auto& observed = buffer_in_use ? nested : buffer;
+        struct release_guard {
+            bool& in_use;
+            bool previous;
+            ~release_guard() { in_use = previous; }
+        } guard{buffer_in_use, buffer_in_use};
+        buffer_in_use = true;
+
+        observed.clear();
+        observed.push_back({metric_name, value, std::chrono::system_clock::now()});
+        for (const auto& [id, observer] : observers_) {
+            observer(observed);
+        }
+    }
+
     mutable std::shared_mutex mutex_;
     std::shared_ptr<metric_storage> storage_;
     std::unordered_map<std::string, aggregator_entry> aggregators_;
+
+    mutable std::shared_mutex observers_mutex_;
+    std::vector<std::pair<size_t, ingest_observer>> observers_;
+    size_t next_observer_id_ = 1;
 };
 
 /**
@@ -0,0 +1,554 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2021-2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file continuous_query.h
+ * @brief Standing queries maintained incrementally as samples are ingested
+ *
+ * A continuous query is a metric_query_engine aggregation without a time
+ * range, evaluated over a sliding window:
+ *
+ *     SELECT percentile(http_latency, 99), avg(http_latency)
+ *     WHERE service = 'api' GROUP BY endpoint          -- window 5m
+ *
+ * continuous_query_engine subscribes to metric_storage (or is fed from an
+ * aggregation_processor observer) and routes each flushed sample to the
+ * columns whose selectors match its series. Every group keeps one
+ * bucket_accumulator per pane, a slice of the window `resolution` wide, so
+ * a sample updates one pane and sliding the window drops whole panes. The
+ * window ends with the pane of the newest sample seen (or the time given to
+ * advance()) and covers the `window / resolution` panes up to it.
+ *
+ * After each ingested batch the groups it touched are re-aggregated from
+ * their panes and the query's result is published as an immutable
+ * snapshot; latest() only copies the snapshot pointer, so pollers never
+ * wait for ingestion or re-aggregation.
+ */
+
+#include "../core/result_types.h"
+#include "../core/error_codes.h"
+#include "label_index.h"
+#include "metric_query_engine.h"
+#include "metric_storage.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @struct continuous_query_options
+ * @brief Sliding window of a continuous query
+ */
+struct continuous_query_options {
+    std::chrono::milliseconds window{300000};    ///< Length of the sliding window
+    std::chrono::milliseconds resolution{5000};  ///< Pane width; the window slides in these steps
+};
+
+/**
+ * @struct continuous_query_result
+ * @brief Materialized result of a continuous query
+ *
+ * result holds one single-value series per column and group, stamped with
+ * window_end, in the layout metric_query_engine uses for aggregations.
+ */
+struct continuous_query_result {
+    query_result result;
+    std::chrono::system_clock::time_point window_start;  ///< Inclusive
+    std::chrono::system_clock::time_point window_end;    ///< Exclusive
+    uint64_t version = 0;  ///< Increases with every refresh
+};
+
+/**
+ * @struct continuous_query_stats
+ * @brief Counters of continuous_query_engine
+ */
+struct continuous_query_stats {
+    size_t queries = 0;
+    uint64_t samples_observed = 0;  ///< Samples passed to observe()
+    uint64_t samples_applied = 0;   ///< Sample x column updates of a pane
+    uint64_t late_samples = 0;      ///< Samples older than their query's window
+    uint64_t refreshes = 0;         ///< Snapshots published
+};
+
+/**
+ * @class continuous_query_engine
+ * @brief Registers standing aggregations and keeps their results current
+ *
+ * Columns must be aggregations; GROUP BY tags group them. Time predicates,
+ * GROUP BY time, ORDER BY, LIMIT and now() are rejected because the window
+ * defines the time range. rate, delta, derivative and integral expect the
+ * samples of a series in time order.
+ */
+class continuous_query_engine {
+public:
+    /**
+     * @brief Engine fed through observe(), e.g. from
+     *        aggregation_processor::add_ingest_observer(engine.observer())
+     */
+    continuous_query_engine() = default;
+
+    /**
+     * @brief Engine fed by every flush of @p storage
+     */
+    explicit continuous_query_engine(metric_storage& storage) : storage_(&storage) {
+        observer_id_ = storage.add_ingest_observer(observer());
+    }
+
+    ~continuous_query_engine() {
+        if (storage_ != nullptr) {
+            storage_->remove_ingest_observer(observer_id_);
+        }
+    }
+
+    continuous_query_engine(const continuous_query_engine&) = delete;
+    continuous_query_engine& operator=(const continuous_query_engine&) = delete;
+
+    /**
+     * @brief Register a standing query
+     * @return Query id, or invalid_argument
+     *
+     * The result starts empty and covers samples ingested from now on.
+     */
+    common::Result<size_t> register_query(const std::string& query_string,
+                                          continuous_query_options options = {}) {
+        auto fail = [](const std::string& message) {
+            return common::Result<size_t>::err(
+                error_info(monitoring_error_code::invalid_argument, message, "monitoring_system").to_common_error());
+        };
+        if (options.window.count() <= 0 || options.resolution.count() <= 0 || options.resolution > options.window) {
+            return fail("Continuous query window and resolution must be positive, resolution at most the window");
+        }
+
+        query_parser parser;
+        auto parsed = parser.parse(query_string);
+        if (parsed.is_err()) {
+            return common::Result<size_t>::err(parsed.error());
+        }
+        const auto& query = parsed.value();
+        if (query.group_by_time) {
+            return fail("Continuous queries use their window instead of GROUP BY time");
+        }
+        if (query.order_by || query.limit) {
+            return fail("Continuous queries do not support ORDER BY or LIMIT");
+        }
+        for (const auto& item : query.select) {
+            if (!item.aggregation) {
+                return fail("Continuous query column '" + item.column_name() + "' must be an aggregation");
+            }
+        }
+
+        query_function_table functions;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            functions = functions_;
+        }
+        query_optimizer optimizer;
+        auto plan = optimizer.optimize(query, query_hints(), functions, std::chrono::system_clock::now());
+        if (plan.is_err()) {
+            return common::Result<size_t>::err(plan.error());
+        }
+        const auto& applied = plan.value().optimizations_applied;
+        if (std::find(applied.begin(), applied.end(), "time range push-down") != applied.end()) {
+            return fail("Continuous queries slide over their window and cannot have time predicates");
+        }
+
+        auto state = std::make_shared<query_state>();
+        state->query = std::move(plan.value().optimized_query);
+        if (state->query.where_clause && uses_now(*state->query.where_clause)) {
+            return fail("Continuous query filters cannot use now()");
+        }
+        state->pane_ticks = to_ticks(options.resolution);
+        state->pane_count = (to_ticks(options.window) + state->pane_ticks - 1) / state->pane_ticks;
+        for (const auto& item : state->query.select) {
+            column_plan column;
+            column.item = item;
+            for (const auto& matcher : item.matchers) {
+                std::optional<std::regex> pattern;
+                if (matcher.type == label_match_type::regex || matcher.type == label_match_type::not_regex) {
+                    try {
+                        pattern.emplace(matcher.value);
+                    } catch (const std::regex_error&) {
+                        return fail("Invalid regex '" + matcher.value + "'");
+                    }
+                }
+                column.patterns.push_back(std::move(pattern));
+            }
+            state->columns.push_back(std::move(column));
+        }
+        state->groups.resize(state->columns.size());
+        state->snapshot = std::make_shared<continuous_query_result>();
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        std::unique_lock<std::shared_mutex> registry(registry_mutex_);
+        const size_t id = next_id_++;
+        queries_.emplace(id, state);
+        routes_.clear();
+        return common::Result<size_t>::ok(id);
+    }
+
+    /**
+     * @brief Stop maintaining a query
+     */
+    common::VoidResult remove_query(size_t id) {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        std::unique_lock<std::shared_mutex> registry(registry_mutex_);
+        if (queries_.erase(id) == 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::not_found,
+                "Continuous query not found: " + std::to_string(id), "monitoring_system").to_common_error());
+        }
+        routes_.clear();
+        return common::ok();
+    }
+
+    /**
+     * @brief Latest materialized result of a query, without recomputation
+     */
+    common::Result<std::shared_ptr<const continuous_query_result>> latest(size_t id) const {
+        std::shared_lock<std::shared_mutex> registry(registry_mutex_);
+        auto it = queries_.find(id);
+        if (it == queries_.end()) {
+            return common::Result<std::shared_ptr<const continuous_query_result>>::err(
+                error_info(monitoring_error_code::not_found,
+                           "Continuous query not found: " + std::to_string(id), "monitoring_system").to_common_error());
+        }
+        std::lock_guard<std::mutex> lock(it->second->snapshot_mutex);
+        return common::Result<std::shared_ptr<const continuous_query_result>>::ok(it->second->snapshot);
+    }
+
+    /**
+     * @brief Apply ingested samples and refresh the queries they touch
+     */
+    void observe(const std::vector<observed_sample>& samples) {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        detail::vector_evaluator filter(0.0, functions_);
+        std::vector<uint32_t> selection;
+        std::vector<query_state*> touched;
+        for (const auto& sample : samples) {
+            ++stats_.samples_observed;
+            for (const auto& target : routes_for(sample.name)) {
+                if (apply(*target.query, target, sample, filter, selection) && !target.query->touched) {
+                    target.query->touched = true;
+                    touched.push_back(target.query);
+                }
+            }
+        }
+        for (auto* query : touched) {
+            query->touched = false;
+            refresh(*query);
+        }
+    }
+
+    /**
+     * @brief Ingest observer forwarding to observe()
+     */
+    ingest_observer observer() {
+        return [this](const std::vector<observed_sample>& samples) { observe(samples); };
+    }
+
+    /**
+     * @brief Slide every window to end at @p now, dropping expired panes
+     *        even when no samples arrive
+     */
+    void advance(std::chrono::system_clock::time_point now) {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        std::shared_lock<std::shared_mutex> registry(registry_mutex_);
+        for (auto& [id, query] : queries_) {
+            const int64_t pane = detail::floor_div(now.time_since_epoch().count(), query->pane_ticks);
+            if (!query->has_watermark || pane > query->watermark) {
+                query->watermark = pane;
+                query->has_watermark = true;
+                refresh(*query);
+            }
+        }
+    }
+
+    continuous_query_stats get_stats() const {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        continuous_query_stats stats = stats_;
+        stats.queries = queries_.size();
+        return stats;
+    }
+
+    /**
+     * @brief Scalar functions callable from continuous query filters
+     */
+    void register_function(const std::string& name, query_function function) {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        functions_[name] = std::move(function);
+    }
+
+private:
+    /// Pane index and its partial aggregate, oldest first
+    using pane_list = std::deque<std::pair<int64_t, detail::bucket_accumulator>>;
+
+    struct group_state {
+        pane_list panes;                         ///< Aggregations over all samples
+        std::map<std::string, pane_list> series; ///< Per-series aggregations, by series name
+        std::optional<double> value;             ///< Aggregate at the last refresh
+        bool dirty = false;
+    };
+
+    struct column_plan {
+        select_item item;
+        std::vector<std::optional<std::regex>> patterns;  ///< Compiled regex of each matcher
+    };
+
+    struct query_state {
+        parsed_query query;
+        int64_t pane_ticks = 1;
+        int64_t pane_count = 1;
+        std::vector<column_plan> columns;
+        std::vector<std::map<std::vector<std::string>, group_state>> groups;  ///< Per column, by tag values
+        int64_t watermark = 0;  ///< Newest pane
+        bool has_watermark = false;
+        int64_t refreshed_watermark = std::numeric_limits<int64_t>::min();
+        bool touched = false;
+        uint64_t version = 0;
+
+        mutable std::mutex snapshot_mutex;
+        std::shared_ptr<const continuous_query_result> snapshot;
+    };
+
+    /// A column a series feeds, and the group it falls into
+    struct route {
+        query_state* query = nullptr;
+        size_t column = 0;
+        std::vector<std::string> group;
+    };
+
+    struct name_hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>()(name); }
+    };
+
+    metric_storage* storage_ = nullptr;
+    size_t observer_id_ = 0;
+
+    mutable std::mutex state_mutex_;              // Panes, routes, stats and functions
+    mutable std::shared_mutex registry_mutex_;    // queries_ membership, shared by readers
+    std::unordered_map<size_t, std::shared_ptr<query_state>> queries_;
+    std::unordered_map<std::string, std::vector<route>, name_hash, std::equal_to<>> routes_;
+    size_t next_id_ = 1;
+    continuous_query_stats stats_;
+    query_function_table functions_;
+
+    static int64_t to_ticks(std::chrono::milliseconds duration) {
+        return std::chrono::duration_cast<std::chrono::system_clock::duration>(duration).count();
+    }
+
+    static bool uses_now(const expression_node& node) {
+        if (node.type == expression_type::function_call && node.text == "now") {
+            return true;
+        }
+        return std::any_of(node.children.begin(), node.children.end(),
+                           [](const expression_ptr& child) { return uses_now(*child); });
+    }
+
+    static bool matches(const column_plan& column, const label_set& labels) {
+        for (size_t i = 0; i < column.item.matchers.size(); ++i) {
+            const auto& matcher = column.item.matchers[i];
+            auto it = std::find_if(labels.begin(), labels.end(),
+                                   [&matcher](const auto& label) { return label.first == matcher.name; });
+            const std::string value = it == labels.end() ? std::string() : it->second;  // Absent labels are empty
+            bool ok = false;
+            switch (matcher.type) {
+                case label_match_type::equal: ok = value == matcher.value; break;
+                case label_match_type::not_equal: ok = value != matcher.value; break;
+                case label_match_type::prefix: ok = value.compare(0, matcher.value.size(), matcher.value) == 0; break;
+                case label_match_type::regex: ok = std::regex_match(value, *column.patterns[i]); break;
+                case label_match_type::not_regex: ok = !std::regex_match(value, *column.patterns[i]); break;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Columns fed by a series, resolved once per name
+     * @note Caller holds state_mutex_
+     */
+    const std::vector<route>& routes_for(std::string_view name) {
+        auto it = routes_.find(name);
+        if (it != routes_.end()) {
+            return it->second;
+        }
+
+        std::vector<route> targets;
+        const label_set labels = parse_series_name(name);
+        std::shared_lock<std::shared_mutex> registry(registry_mutex_);
+        for (auto& [id, query] : queries_) {
+            for (size_t c = 0; c < query->columns.size(); ++c) {
+                if (!matches(query->columns[c], labels)) {
+                    continue;
+                }
+                route target;
+                target.query = query.get();
+                target.column = c;
+                for (const auto& tag : query->query.group_by_tags) {
+                    auto label = std::find_if(labels.begin(), labels.end(),
+                                              [&tag](const auto& l) { return l.first == tag; });
+                    target.group.push_back(label == labels.end() ? std::string() : label->second);
+                }
+                targets.push_back(std::move(target));
+            }
+        }
+        return routes_.emplace(std::string(name), std::move(targets)).first->second;
+    }
+
+    /**
+     * @brief Fold one sample into the pane of its column and group
+     * @return false if the filter rejected it or it is older than the window
+     */
+    bool apply(query_state& query, const route& target, const observed_sample& sample,
+               detail::vector_evaluator& filter, std::vector<uint32_t>& selection) {
+        const int64_t ticks = sample.timestamp.time_since_epoch().count();
+        if (query.query.where_clause) {
+            filter.select(*query.query.where_clause, &ticks, &sample.value, 1, selection);
+            if (selection.empty()) {
+                return false;
+            }
+        }
+
+        const int64_t pane = detail::floor_div(ticks, query.pane_ticks);
+        if (query.has_watermark && pane <= query.watermark - query.pane_count) {
+            ++stats_.late_samples;
+            return false;
+        }
+        if (!query.has_watermark || pane > query.watermark) {
+            query.watermark = pane;
+            query.has_watermark = true;
+        }
+
+        const auto& item = query.columns[target.column].item;
+        auto& group = query.groups[target.column][target.group];
+        pane_list& panes = detail::is_per_series(*item.aggregation) ? group.series[std::string(sample.name)]
+                                                                    : group.panes;
+        // Samples arrive mostly in order, so the pane is usually the last one
+        auto position = panes.end();
+        while (position != panes.begin() && std::prev(position)->first > pane) {
+            --position;
+        }
+        if (position == panes.begin() || std::prev(position)->first != pane) {
+            position = panes.emplace(position, pane, detail::bucket_accumulator());
+        } else {
+            --position;
+        }
+        position->second.add(ticks, sample.value, 1, *item.aggregation == aggregation_function::percentile);
+        group.dirty = true;
+        ++stats_.samples_applied;
+        return true;
+    }
+
+    /**
+     * @brief Drop expired panes, re-aggregate changed groups and publish
+     * @note Caller holds state_mutex_
+     */
+    void refresh(query_state& query) {
+        const int64_t oldest = query.watermark - query.pane_count + 1;
+        const bool slid = query.watermark != query.refreshed_watermark;
+        auto expire = [oldest](pane_list& panes) {
+            while (!panes.empty() && panes.front().first < oldest) {
+                panes.pop_front();
+            }
+        };
+
+        auto result = std::make_shared<continuous_query_result>();
+        result->window_end = std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration((query.watermark + 1) * query.pane_ticks));
+        result->window_start = result->window_end -
+            std::chrono::system_clock::duration(query.pane_count * query.pane_ticks);
+
+        for (size_t c = 0; c < query.columns.size(); ++c) {
+            const auto& item = query.columns[c].item;
+            const auto function = *item.aggregation;
+            auto& groups = query.groups[c];
+            for (auto it = groups.begin(); it != groups.end();) {
+                auto& group = it->second;
+                if (slid) {
+                    expire(group.panes);
+                    for (auto series = group.series.begin(); series != group.series.end();) {
+                        expire(series->second);
+                        series = series->second.empty() ? group.series.erase(series) : std::next(series);
+                    }
+                    group.dirty = true;
+                }
+                if (group.panes.empty() && group.series.empty()) {
+                    it = groups.erase(it);
+                    continue;
+                }
+                if (group.dirty) {
+                    group.value = aggregate(group, function, item.argument);
+                    group.dirty = false;
+                }
+                if (group.value) {
+                    query_series series;
+                    series.name = item.column_name();
+                    series.column = c;
+                    for (size_t i = 0; i < it->first.size(); ++i) {
+                        if (!it->first[i].empty()) {
+                            series.labels.emplace_back(query.query.group_by_tags[i], it->first[i]);
+                        }
+                    }
+                    std::sort(series.labels.begin(), series.labels.end());
+                    series.timestamps.push_back(result->window_end);
+                    series.values.push_back(*group.value);
+                    result->result.series.push_back(std::move(series));
+                }
+                ++it;
+            }
+        }
+
+        query.refreshed_watermark = query.watermark;
+        result->version = ++query.version;
+        ++stats_.refreshes;
+        std::lock_guard<std::mutex> lock(query.snapshot_mutex);
+        query.snapshot = std::move(result);
+    }
+
+    static std::optional<double> aggregate(const group_state& group, aggregation_function function,
+                                           double argument) {
+        if (!detail::is_per_series(function)) {
+            detail::bucket_accumulator total;
+            for (const auto& [pane, accumulator] : group.panes) {
+                total.merge(accumulator);
+            }
+            return total.finish(function, argument);
+        }
+
+        // Per-series aggregates continue across panes and are summed over the group
+        std::optional<double> sum;
+        for (const auto& [name, panes] : group.series) {
+            detail::bucket_accumulator series;
+            for (const auto& [pane, accumulator] : panes) {
+                series.append(accumulator);
+            }
+            if (auto value = series.finish(function, argument)) {
+                sum = sum.value_or(0.0) + *value;
+            }
+        }
+        return sum;
+    }
+};
+
+} } // namespace kcenon::monitoring
@@ -0,0 +1,675 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file label_index.h
+ * @brief Inverted index from label pairs to series ids
+ *
+ * Every series is a canonical (sorted, empty values dropped) set of label
+ * pairs and gets a dense, never reused series id. For each label name the
+ * index keeps:
+ * - an ordered map from value to a sorted posting list of series ids, so
+ *   equality matchers are a single lookup and prefix matchers (including
+ *   regexes with a literal prefix, such as "/api/.*") a range scan;
+ * - a column mapping series id to a value ordinal, so a candidate set can
+ *   be checked against a matcher without touching strings.
+ *
+ * A selector is resolved by taking the union of the posting lists of the
+ * cheapest matcher that cannot match an absent label, then filtering that
+ * candidate set through the columns of the remaining matchers. Cost is
+ * proportional to the smallest matching posting lists, not to the number
+ * of series, which keeps typical selectors over 1M series well below a
+ * millisecond.
+ *
+ * Matchers follow Prometheus semantics: regexes are fully anchored and an
+ * absent label behaves like an empty value.
+ */
+
+#include "../core/result_types.h"
+#include "../core/error_codes.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @brief Dense identifier of a series in a label_index
+ */
+using series_id = uint32_t;
+
+/**
+ * @brief Canonical label set: pairs sorted by name, no empty values
+ */
+using label_set = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @enum label_match_type
+ * @brief How a label_matcher compares label values
+ */
+enum class label_match_type {
+    equal,          ///< name="value"
+    not_equal,      ///< name!="value"
+    regex,          ///< name=~"pattern" (fully anchored)
+    not_regex,      ///< name!~"pattern"
+    prefix          ///< Value starts with the given string
+};
+
+/**
+ * @struct label_matcher
+ * @brief One condition of a series selector
+ */
+struct label_matcher {
+    std::string name;
+    label_match_type type = label_match_type::equal;
+    std::string value;
+
+    label_matcher() = default;
+    label_matcher(std::string n, label_match_type t, std::string v)
+        : name(std::move(n)), type(t), value(std::move(v)) {}
+};
+
+/**
+ * @brief Label name under which a metric name is indexed
+ */
+inline constexpr const char* metric_name_label = "__name__";
+
+/**
+ * @brief Parse a Prometheus-style selector such as
+ *        `http_requests_total{service="auth", endpoint=~"/api/.*"}`
+ *
+ * A leading metric name becomes an equality matcher on __name__.
+ */
+inline common::Result<std::vector<label_matcher>> parse_label_selector(std::string_view text) {
+    auto fail = [](const std::string& message) {
+        return common::Result<std::vector<label_matcher>>::err(
+            error_info(monitoring_error_code::invalid_argument,
+                       "Invalid label selector: " + message).to_common_error());
+    };
+    auto is_name_start = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+    };
+    auto is_name_char = [&is_name_start](char c) {
+        return is_name_start(c) || (c >= '0' && c <= '9');
+    };
+
+    std::vector<label_matcher> matchers;
+    size_t pos = 0;
+    auto skip_spaces = [&] {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n')) {
+            ++pos;
+        }
+    };
+    auto read_name = [&] {
+        const size_t start = pos;
+        if (pos < text.size() && is_name_start(text[pos])) {
+            while (pos < text.size() && is_name_char(text[pos])) {
+                ++pos;
+            }
+        }
+        return std::string(text.substr(start, pos - start));
+    };
+
+    skip_spaces();
+    std::string metric = read_name();
+    if (!metric.empty()) {
+        matchers.emplace_back(metric_name_label, label_match_type::equal, std::move(metric));
+    }
+    skip_spaces();
+
+    if (pos < text.size() && text[pos] == '{') {
+        ++pos;
+        while (true) {
+            skip_spaces();
+            if (pos < text.size() && text[pos] == '}') {
+                ++pos;
+                break;
+            }
+
+            std::string name = read_name();
+            if (name.empty()) {
+                return fail("expected label name at offset " + std::to_string(pos));
+            }
+            skip_spaces();
+
+            label_match_type type;
+            if (text.substr(pos, 2) == "=~") {
+                type = label_match_type::regex;
+                pos += 2;
+            } else if (text.substr(pos, 2) == "!~") {
+                type = label_match_type::not_regex;
+                pos += 2;
+            } else if (text.substr(pos, 2) == "!=") {
+                type = label_match_type::not_equal;
+                pos += 2;
+            } else if (text.substr(pos, 1) == "=") {
+                type = label_match_type::equal;
+                pos += 1;
+            } else {
+                return fail("expected matcher operator after '" + name + "'");
+            }
+            skip_spaces();
+
+            if (pos >= text.size() || (text[pos] != '"' && text[pos] != '\'')) {
+                return fail("expected quoted value for '" + name + "'");
+            }
+            const char quote = text[pos++];
+            std::string value;
+            while (pos < text.size() && text[pos] != quote) {
+                char c = text[pos++];
+                if (c == '\\' && pos < text.size()) {
+                    c = text[pos++];
+                    if (c == 'n') {
+                        c = '\n';
+                    } else if (c == 't') {
+                        c = '\t';
+                    }
+                }
+                value += c;
+            }
+            if (pos >= text.size()) {
+                return fail("unterminated value for '" + name + "'");
+            }
+            ++pos;
+            matchers.emplace_back(std::move(name), type, std::move(value));
+
+            skip_spaces();
+            if (pos < text.size() && text[pos] == ',') {
+                ++pos;
+            } else if (pos >= text.size() || text[pos] != '}') {
+                return fail("expected ',' or '}' at offset " + std::to_string(pos));
+            }
+        }
+        skip_spaces();
+    }
+
+    if (pos != text.size()) {
+        return fail("unexpected input at offset " + std::to_string(pos));
+    }
+    if (matchers.empty()) {
+        return fail("selector has no matchers");
+    }
+    return common::Result<std::vector<label_matcher>>::ok(std::move(matchers));
+}
+
+/**
+ * @brief Labels of a series whose name is written in selector form, such
+ *        as `http_requests_total{service="auth"}`
+ *
+ * A name that is not a metric name followed by equality labels is taken
+ * whole as the __name__ label.
+ */
+inline label_set parse_series_name(std::string_view name) {
+    if (name.find('{') != std::string_view::npos) {
+        auto parsed = parse_label_selector(name);
+        if (parsed.is_ok() && parsed.value().front().name == metric_name_label &&
+            std::all_of(parsed.value().begin(), parsed.value().end(),
+                        [](const label_matcher& m) { return m.type == label_match_type::equal; })) {
+            label_set labels;
+            for (auto& matcher : parsed.value()) {
+                labels.emplace_back(std::move(matcher.name), std::move(matcher.value));
+            }
+            std::sort(labels.begin(), labels.end());
+            return labels;
+        }
+    }
+    return {{metric_name_label, std::string(name)}};
+}
+
+/**
+ * @class label_index
+ * @brief Thread-safe inverted index of label sets
+ *
+ * Readers share a lock; adding or removing series takes it exclusively.
+ * Each label name costs one 32-bit column entry per series id, so the
+ * index suits label schemas with a bounded set of names.
+ */
+class label_index {
+public:
+    label_index() = default;
+    label_index(const label_index&) = delete;
+    label_index& operator=(const label_index&) = delete;
+
+    /**
+     * @brief Add a series, or return the id of an identical existing one
+     * @param labels Range of (name, value) pairs in any order
+     */
+    template <typename Labels>
+    series_id add(const Labels& labels) {
+        label_set canonical = canonicalize(labels);
+        std::string key = series_key(canonical);
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto found = ids_.find(key);
+        if (found != ids_.end()) {
+            return found->second;
+        }
+
+        const auto id = static_cast<series_id>(series_.size());
+        for (const auto& [name, value] : canonical) {
+            auto& column = columns_[name];
+            auto [it, inserted] = column.values.try_emplace(value);
+            if (inserted) {
+                it->second.ordinal = column.next_ordinal++;
+            }
+            it->second.postings.push_back(id);
+            if (column.ordinals.size() <= id) {
+                column.ordinals.resize(id + 1, 0);
+            }
+            column.ordinals[id] = it->second.ordinal;
+        }
+
+        series_.push_back(std::move(canonical));
+        live_ids_.push_back(id);
+        ids_.emplace(std::move(key), id);
+        return id;
+    }
+
+    /**
+     * @brief Find the id of a series with exactly these labels
+     */
+    template <typename Labels>
+    std::optional<series_id> find(const Labels& labels) const {
+        const std::string key = series_key(canonicalize(labels));
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(key);
+        if (it == ids_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief Remove a series; its id is not reused
+     * @return false if the id is unknown or already removed
+     */
+    bool remove(series_id id) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (id >= series_.size() || !series_[id]) {
+            return false;
+        }
+
+        const label_set& labels = *series_[id];
+        for (const auto& [name, value] : labels) {
+            auto column_it = columns_.find(name);
+            auto& column = column_it->second;
+            auto value_it = column.values.find(value);
+            auto& postings = value_it->second.postings;
+            postings.erase(std::lower_bound(postings.begin(), postings.end(), id));
+            column.ordinals[id] = 0;
+            if (postings.empty()) {
+                column.values.erase(value_it);
+            }
+            if (column.values.empty()) {
+                columns_.erase(column_it);
+            }
+        }
+
+        live_ids_.erase(std::lower_bound(live_ids_.begin(), live_ids_.end(), id));
+        ids_.erase(series_key(labels));
+        series_[id].reset();
+        return true;
+    }
+
+    /**
+     * @brief Ids of all series matching every matcher, in ascending order
+     *
+     * An empty matcher list selects every series.
+     */
+    common::Result<std::vector<series_id>> select(const std::vector<label_matcher>& matchers) const {
+        auto compiled = compile(matchers);
+        if (compiled.is_err()) {
+            return common::Result<std::vector<series_id>>::err(compiled.error());
+        }
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return common::Result<std::vector<series_id>>::ok(select_locked(compiled.value()));
+    }
+
+    /**
+     * @brief Label sets of all series matching every matcher
+     */
+    common::Result<std::vector<label_set>> select_labels(const std::vector<label_matcher>& matchers) const {
+        auto compiled = compile(matchers);
+        if (compiled.is_err()) {
+            return common::Result<std::vector<label_set>>::err(compiled.error());
+        }
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const auto ids = select_locked(compiled.value());
+        std::vector<label_set> result;
+        result.reserve(ids.size());
+        for (series_id id : ids) {
+            result.push_back(*series_[id]);
+        }
+        return common::Result<std::vector<label_set>>::ok(std::move(result));
+    }
+
+    /**
+     * @brief Labels of a series, if it exists
+     */
+    std::optional<label_set> labels(series_id id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (id >= series_.size() || !series_[id]) {
+            return std::nullopt;
+        }
+        return *series_[id];
+    }
+
+    /**
+     * @brief All label names in use, sorted
+     */
+    std::vector<std::string> label_names() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        std::vector<std::string> names;
+        names.reserve(columns_.size());
+        for (const auto& [name, column] : columns_) {
+            names.push_back(name);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    /**
+     * @brief All values of a label name, sorted
+     */
+    std::vector<std::string> label_values(const std::string& name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        std::vector<std::string> values;
+        auto it = columns_.find(name);
+        if (it != columns_.end()) {
+            values.reserve(it->second.values.size());
+            for (const auto& [value, entry] : it->second.values) {
+                values.push_back(value);
+            }
+        }
+        return values;
+    }
+
+    /**
+     * @brief Number of live series
+     */
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return live_ids_.size();
+    }
+
+    /**
+     * @brief Remove every series and restart ids from zero
+     */
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        columns_.clear();
+        series_.clear();
+        live_ids_.clear();
+        ids_.clear();
+    }
+
+private:
+    struct value_entry {
+        uint32_t ordinal = 0;
+        std::vector<series_id> postings;  // Ascending
+    };
+
+    struct label_column {
+        std::map<std::string, value_entry, std::less<>> values;
+        std::vector<uint32_t> ordinals;  // By series id; 0 = label absent
+        uint32_t next_ordinal = 1;
+    };
+
+    /**
+     * @brief Matcher reduced to a positive test plus a negation flag
+     */
+    struct compiled_matcher {
+        const label_matcher* source = nullptr;
+        label_match_type test = label_match_type::equal;  // equal, regex or prefix
+        bool negated = false;
+        std::string literal;  // Equality value, prefix, or a regex's literal prefix
+        bool literal_only = false;  // Regex without metacharacters
+        std::optional<std::regex> pattern;
+
+        bool positive(const std::string& value) const {
+            switch (test) {
+                case label_match_type::prefix:
+                    return value.compare(0, literal.size(), literal) == 0;
+                case label_match_type::regex:
+                    return literal_only ? value == literal : std::regex_match(value, *pattern);
+                default:
+                    return value == literal;
+            }
+        }
+
+        bool matches(const std::string& value) const {
+            return positive(value) != negated;
+        }
+    };
+
+    template <typename Labels>
+    static label_set canonicalize(const Labels& labels) {
+        label_set canonical;
+        for (const auto& [name, value] : labels) {
+            if (!value.empty()) {
+                canonical.emplace_back(name, value);
+            }
+        }
+        std::stable_sort(canonical.begin(), canonical.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        canonical.erase(std::unique(canonical.begin(), canonical.end(),
+                                    [](const auto& a, const auto& b) { return a.first == b.first; }),
+                        canonical.end());
+        return canonical;
+    }
+
+    static std::string series_key(const label_set& labels) {
+        std::string key;
+        for (const auto& [name, value] : labels) {
+            key += name;
+            key += '\0';
+            key += value;
+            key += '\0';
+        }
+        return key;
+    }
+
+    /**
+     * @brief Leading literal characters of a regex, usable as a range bound
+     */
+    static std::string regex_literal_prefix(const std::string& pattern, bool& literal_only) {
+        literal_only = false;
+        if (pattern.find('|') != std::string::npos) {
+            return {};
+        }
+        static constexpr std::string_view meta = ".[]()*+?{}^$\\";
+        std::string prefix;
+        for (char c : pattern) {
+            if (meta.find(c) != std::string_view::npos) {
+                if ((c == '*' || c == '?' || c == '{') && !prefix.empty()) {
+                    prefix.pop_back();  // The preceding character is optional
+                }
+                return prefix;
+            }
+            prefix += c;
+        }
+        literal_only = true;
+        return prefix;
+    }
+
+    static common::Result<std::vector<compiled_matcher>> compile(const std::vector<label_matcher>& matchers) {
+        std::vector<compiled_matcher> compiled;
+        compiled.reserve(matchers.size());
+        for (const auto& matcher : matchers) {
+            compiled_matcher c;
+            c.source = &matcher;
+            switch (matcher.type) {
+                case label_match_type::equal:
+                case label_match_type::not_equal:
+                    c.test = label_match_type::equal;
+                    c.negated = matcher.type == label_match_type::not_equal;
+                    c.literal = matcher.value;
+                    break;
+                case label_match_type::prefix:
+                    c.test = label_match_type::prefix;
+                    c.literal = matcher.value;
+                    break;
+                case label_match_type::regex:
+                case label_match_type::not_regex:
+                    c.test = label_match_type::regex;
+                    c.negated = matcher.type == label_match_type::not_regex;
+                    c.literal = regex_literal_prefix(matcher.value, c.literal_only);
+                    if (!c.literal_only && matcher.value.size() == c.literal.size() + 2 &&
+                        matcher.value.compare(c.literal.size(), 2, ".*") == 0) {
+                        c.test = label_match_type::prefix;  // "literal.*" needs no regex engine
+                    } else if (!c.literal_only) {
+                        try {
+                            c.pattern.emplace(matcher.value, std::regex::ECMAScript | std::regex::optimize);
+                        } catch (const std::regex_error& e) {
+                            return common::Result<std::vector<compiled_matcher>>::err(
+                                error_info(monitoring_error_code::invalid_argument,
+                                           "Invalid regex for label '" + matcher.name + "': " + e.what())
+                                    .to_common_error());
+                        }
+                    }
+                    break;
+            }
+            compiled.push_back(std::move(c));
+        }
+        return common::Result<std::vector<compiled_matcher>>::ok(std::move(compiled));
+    }
+
+    /**
+     * @brief Visit the values for which the matcher's positive test holds
+     */
+    template <typename Fn>
+    static void for_each_positive(const compiled_matcher& m, const label_column& column, Fn&& fn) {
+        const bool exact = m.test == label_match_type::equal ||
+                           (m.test == label_match_type::regex && m.literal_only);
+        if (exact) {
+            auto it = column.values.find(m.literal);
+            if (it != column.values.end()) {
+                fn(it->second);
+            }
+            return;
+        }
+
+        auto it = m.literal.empty() ? column.values.begin() : column.values.lower_bound(m.literal);
+        for (; it != column.values.end(); ++it) {
+            if (it->first.compare(0, m.literal.size(), m.literal) != 0) {
+                break;
+            }
+            if (m.test == label_match_type::prefix || std::regex_match(it->first, *m.pattern)) {
+                fn(it->second);
+            }
+        }
+    }
+
+    const label_column* column_for(const compiled_matcher& m) const {
+        auto it = columns_.find(m.source->name);
+        return it == columns_.end() ? nullptr : &it->second;
+    }
+
+    std::vector<series_id> select_locked(const std::vector<compiled_matcher>& matchers) const {
+        // Evaluate each matcher once against the distinct values of its label,
+        // as a flag per value ordinal (ordinal 0 stands for an absent label)
+        std::vector<std::vector<uint8_t>> accepted(matchers.size());
+        std::vector<const label_column*> columns(matchers.size());
+        size_t driver = matchers.size();
+        size_t driver_cost = 0;
+        for (size_t i = 0; i < matchers.size(); ++i) {
+            const auto& m = matchers[i];
+            const bool absent_matches = m.matches(std::string());
+            columns[i] = column_for(m);
+            if (!columns[i]) {
+                if (!absent_matches) {
+                    return {};
+                }
+                continue;
+            }
+
+            auto& flags = accepted[i];
+            flags.assign(columns[i]->next_ordinal, m.negated ? 1 : 0);
+            flags[0] = absent_matches ? 1 : 0;
+            size_t positive_cost = 0;
+            for_each_positive(m, *columns[i], [&](const value_entry& entry) {
+                flags[entry.ordinal] = m.negated ? 0 : 1;
+                positive_cost += entry.postings.size();
+            });
+
+            if (absent_matches) {
+                continue;  // Also selects series without the label, so it only filters
+            }
+            size_t cost = positive_cost;
+            if (m.negated) {
+                cost = 0;
+                for (const auto& [value, entry] : columns[i]->values) {
+                    cost += flags[entry.ordinal] ? entry.postings.size() : 0;
+                }
+            }
+            if (cost == 0) {
+                return {};
+            }
+            if (driver == matchers.size() || cost < driver_cost) {
+                driver = i;
+                driver_cost = cost;
+            }
+        }
+
+        // The cheapest matcher that requires the label produces the candidates
+        std::vector<series_id> result;
+        if (driver == matchers.size()) {
+            result = live_ids_;
+        } else {
+            const auto& flags = accepted[driver];
+            const std::vector<series_id>* single = nullptr;
+            size_t lists = 0;
+            for (const auto& [value, entry] : columns[driver]->values) {
+                if (flags[entry.ordinal] && lists++ == 0) {
+                    single = &entry.postings;
+                }
+            }
+            if (lists == 1) {
+                result = *single;
+            } else {
+                // Postings of different values of one label are disjoint
+                result.reserve(driver_cost);
+                for (const auto& [value, entry] : columns[driver]->values) {
+                    if (flags[entry.ordinal]) {
+                        result.insert(result.end(), entry.postings.begin(), entry.postings.end());
+                    }
+                }
+                std::sort(result.begin(), result.end());
+            }
+        }
+
+        // Check the candidates against the other matchers by value ordinal
+        for (size_t i = 0; i < matchers.size() && !result.empty(); ++i) {
+            if (i == driver || !columns[i]) {
+                continue;
+            }
+            const auto& flags = accepted[i];
+            const auto& ordinals = columns[i]->ordinals;
+            result.erase(std::remove_if(result.begin(), result.end(), [&](series_id id) {
+                return !flags[id < ordinals.size() ? ordinals[id] : 0];
+            }), result.end());
+        }
+        return result;
+    }
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, label_column> columns_;
+    std::vector<std::optional<label_set>> series_;  // By series id; empty once removed
+    std::vector<series_id> live_ids_;               // Ascending
+    std::unordered_map<std::string, series_id> ids_;
+};
+
+} } // namespace kcenon::monitoring
@@ -0,0 +1,2539 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2021-2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file metric_query_engine.h
+ * @brief Ad-hoc SQL-like queries over metric_storage
+ *
+ * Queries follow InfluxQL:
+ *
+ *     SELECT avg(cpu_usage), percentile('http_latency{service="api"}', 99)
+ *     WHERE time >= now() - 6h AND region = 'eu' AND value < 1000
+ *     GROUP BY time(1m), host
+ *     ORDER BY time DESC
+ *     LIMIT 60
+ *
+ * A series source is a metric name or a quoted Prometheus selector over
+ * metrics named like `http_latency{service="api",host="a"}`. `SELECT
+ * max(value) FROM a, b` is shorthand for `SELECT max(a), max(b)`. `time`
+ * is in epoch seconds, durations such as `5m` are seconds and quoted
+ * ISO-8601 strings compared with `time` are timestamps. Without a time
+ * predicate the last hour is queried.
+ *
+ * query_optimizer pushes time predicates into the scanned range and label
+ * predicates into the series selectors, leaving a residual row filter.
+ * query_executor then runs a vectorized pipeline for each selected series:
+ * time_series::scan() yields one column batch per chunk, the filter is
+ * evaluated a column at a time into a selection vector, and the selected
+ * rows are mapped to epoch-aligned time buckets and folded into per-bucket
+ * accumulators. When no row needs to be looked at, chunks that lie inside
+ * one bucket are folded from their stored summaries without decoding.
+ * Per-series buckets are finally merged into their GROUP BY groups.
+ * Series, and time partitions of long ranges, are scanned as independent
+ * tasks on a worker pool (query_hints::parallel_execution).
+ */
+
+#include "../core/result_types.h"
+#include "../core/error_codes.h"
+#include "label_index.h"
+#include "metric_storage.h"
+#include "time_series.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @enum expression_type
+ * @brief Kinds of WHERE clause expression nodes
+ */
+enum class expression_type {
+    literal,
+    string_literal,
+    identifier,
+    binary_op,
+    unary_op,
+    function_call
+};
+
+/**
+ * @enum binary_operator
+ * @brief Binary operators, comparisons yield 1 or 0
+ */
+enum class binary_operator {
+    add,
+    subtract,
+    multiply,
+    divide,
+    modulo,
+    power,
+    equal,
+    not_equal,
+    less_than,
+    less_equal,
+    greater_than,
+    greater_equal,
+    logical_and,
+    logical_or
+};
+
+/**
+ * @enum unary_operator
+ * @brief Unary operators
+ */
+enum class unary_operator {
+    negate,
+    logical_not
+};
+
+/**
+ * @enum aggregation_function
+ * @brief Aggregations available in the SELECT list
+ *
+ * rate, delta, derivative and integral are computed per series and
+ * summed across the series of a group; the others combine all samples of
+ * a group.
+ */
+enum class aggregation_function {
+    sum,
+    avg,
+    min,
+    max,
+    count,
+    stddev,
+    variance,
+    percentile,
+    rate,        ///< Counter increase per second, resets count from zero
+    delta,       ///< Last value minus first value
+    derivative,  ///< delta per second
+    integral     ///< Trapezoidal area in value x seconds
+};
+
+/**
+ * @brief Aggregation name as written in queries
+ */
+inline const char* to_string(aggregation_function function) noexcept {
+    switch (function) {
+        case aggregation_function::sum: return "sum";
+        case aggregation_function::avg: return "avg";
+        case aggregation_function::min: return "min";
+        case aggregation_function::max: return "max";
+        case aggregation_function::count: return "count";
+        case aggregation_function::stddev: return "stddev";
+        case aggregation_function::variance: return "variance";
+        case aggregation_function::percentile: return "percentile";
+        case aggregation_function::rate: return "rate";
+        case aggregation_function::delta: return "delta";
+        case aggregation_function::derivative: return "derivative";
+        case aggregation_function::integral: return "integral";
+    }
+    return "unknown";
+}
+
+struct expression_node;
+using expression_ptr = std::shared_ptr<const expression_node>;
+
+/**
+ * @struct expression_node
+ * @brief Node of a parsed WHERE clause
+ */
+struct expression_node {
+    expression_type type = expression_type::literal;
+    double number = 0.0;                    ///< Value of a literal
+    std::string text;                       ///< String literal, identifier or function name
+    binary_operator binary_op = binary_operator::add;
+    unary_operator unary_op = unary_operator::negate;
+    std::vector<expression_ptr> children;   ///< Operands or function arguments
+};
+
+/**
+ * @brief Render an expression back to query syntax
+ */
+inline std::string to_string(const expression_node& node) {
+    switch (node.type) {
+        case expression_type::literal: {
+            std::ostringstream out;
+            out << node.number;
+            return out.str();
+        }
+        case expression_type::string_literal:
+            return "'" + node.text + "'";
+        case expression_type::identifier:
+            return node.text;
+        case expression_type::unary_op:
+            return (node.unary_op == unary_operator::negate ? "-" : "NOT ") + to_string(*node.children[0]);
+        case expression_type::function_call: {
+            std::string text = node.text + "(";
+            for (size_t i = 0; i < node.children.size(); ++i) {
+                text += (i > 0 ? ", " : "") + to_string(*node.children[i]);
+            }
+            return text + ")";
+        }
+        case expression_type::binary_op: {
+            static constexpr const char* symbols[] = {
+                "+", "-", "*", "/", "%", "^", "=", "!=", "<", "<=", ">", ">=", "AND", "OR"};
+            return "(" + to_string(*node.children[0]) + " " + symbols[static_cast<int>(node.binary_op)] +
+                   " " + to_string(*node.children[1]) + ")";
+        }
+    }
+    return {};
+}
+
+/**
+ * @struct select_item
+ * @brief One column of the SELECT list
+ */
+struct select_item {
+    std::string source;                               ///< Metric name or selector as written
+    std::optional<aggregation_function> aggregation;  ///< Raw points when empty
+    double argument = 0.0;                            ///< Percentile rank (0-100)
+    std::vector<label_matcher> matchers;              ///< Series selector, set by query_optimizer
+    bool use_summaries = false;                       ///< Fold whole chunks from summaries
+
+    /**
+     * @brief Column name, such as "avg(cpu_usage)"
+     */
+    std::string column_name() const {
+        if (!aggregation) {
+            return source;
+        }
+        std::string name = std::string(to_string(*aggregation)) + "(" + source;
+        if (*aggregation == aggregation_function::percentile) {
+            std::ostringstream rank;
+            rank << argument;
+            name += ", " + rank.str();
+        }
+        return name + ")";
+    }
+};
+
+/**
+ * @struct order_by_item
+ * @brief ORDER BY column ("time" or "value") and direction
+ */
+struct order_by_item {
+    std::string column = "time";
+    bool ascending = true;
+};
+
+/**
+ * @struct parsed_query
+ * @brief Query after parsing; query_optimizer resolves it for execution
+ */
+struct parsed_query {
+    std::vector<select_item> select;
+    expression_ptr where_clause;                                   ///< Null when absent
+    std::optional<std::chrono::system_clock::time_point> from_time;  ///< Inclusive
+    std::optional<std::chrono::system_clock::time_point> to_time;    ///< Exclusive
+    std::optional<std::chrono::milliseconds> group_by_time;
+    std::vector<std::string> group_by_tags;
+    std::optional<order_by_item> order_by;
+    std::optional<size_t> limit;                                   ///< Rows per result series
+};
+
+/**
+ * @struct query_series
+ * @brief One result series in columnar form
+ */
+struct query_series {
+    std::string name;    ///< Column name, or the metric name for raw selects
+    size_t column = 0;   ///< Index of the SELECT item the series belongs to
+    label_set labels;    ///< GROUP BY labels, or the labels of a raw series
+    std::vector<std::chrono::system_clock::time_point> timestamps;
+    std::vector<double> values;
+
+    size_t size() const noexcept { return values.size(); }
+};
+
+/**
+ * @struct query_result
+ * @brief Result series in SELECT order, groups ordered by label values
+ */
+struct query_result {
+    std::vector<query_series> series;
+    size_t series_scanned = 0;     ///< Series matched by the selectors
+    size_t points_scanned = 0;     ///< Points decoded from chunks
+    size_t points_summarized = 0;  ///< Points folded from chunk summaries
+    size_t scan_tasks = 0;         ///< Series x time partition tasks executed
+    size_t points_from_cache = 0;  ///< Bucket values reused from the result cache
+};
+
+/**
+ * @struct query_hints
+ * @brief Execution options of metric_query_engine
+ */
+struct query_hints {
+    bool parallel_execution = false;          ///< Run scan tasks on a worker pool
+    size_t max_parallel_tasks = 4;            ///< Threads per query, caller included
+    std::chrono::seconds time_partition{3600};  ///< Longer ranges are scanned in partitions
+    bool enable_cache = true;                 ///< Reuse buckets of GROUP BY time queries
+    std::chrono::seconds cache_ttl{60};       ///< Cached buckets are recomputed after this
+    size_t cache_max_entries = 256;           ///< Least recently used entries are evicted
+    bool optimize_aggregations = true;  ///< Fold whole chunks from their summaries
+};
+
+/**
+ * @struct query_stats
+ * @brief Counters of metric_query_engine
+ */
+struct query_stats {
+    size_t total_queries = 0;
+    size_t failed_queries = 0;
+    size_t points_scanned = 0;
+    size_t points_summarized = 0;
+    size_t cache_hits = 0;      ///< Queries that reused cached buckets
+    size_t cache_misses = 0;    ///< Cacheable queries computed in full
+    std::chrono::microseconds total_execution_time{0};
+    std::chrono::microseconds max_execution_time{0};
+
+    std::chrono::microseconds average_execution_time() const noexcept {
+        const size_t succeeded = total_queries - failed_queries;
+        return succeeded == 0 ? std::chrono::microseconds(0)
+                              : total_execution_time / static_cast<int64_t>(succeeded);
+    }
+};
+
+/**
+ * @brief Scalar function callable from WHERE clauses
+ */
+using query_function = std::function<double(const std::vector<double>&)>;
+using query_function_table = std::unordered_map<std::string, query_function>;
+
+namespace detail {
+
+inline int64_t floor_div(int64_t a, int64_t b) noexcept {
+    return a / b - ((a % b != 0 && (a < 0) != (b < 0)) ? 1 : 0);
+}
+
+inline double ticks_to_seconds(int64_t ticks) noexcept {
+    return std::chrono::duration<double>(std::chrono::system_clock::duration(ticks)).count();
+}
+
+inline std::chrono::system_clock::time_point seconds_to_time(double seconds) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(seconds)));
+}
+
+inline double time_to_seconds(std::chrono::system_clock::time_point time) noexcept {
+    return ticks_to_seconds(time.time_since_epoch().count());
+}
+
+inline std::string to_lower(std::string_view text) {
+    std::string lower(text);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+inline std::optional<aggregation_function> aggregation_from_name(const std::string& name) {
+    static const std::unordered_map<std::string, aggregation_function> functions = {
+        {"sum", aggregation_function::sum},           {"avg", aggregation_function::avg},
+        {"mean", aggregation_function::avg},          {"min", aggregation_function::min},
+        {"max", aggregation_function::max},           {"count", aggregation_function::count},
+        {"stddev", aggregation_function::stddev},     {"variance", aggregation_function::variance},
+        {"percentile", aggregation_function::percentile}, {"rate", aggregation_function::rate},
+        {"delta", aggregation_function::delta},       {"derivative", aggregation_function::derivative},
+        {"integral", aggregation_function::integral},
+    };
+    auto it = functions.find(name);
+    return it == functions.end() ? std::nullopt : std::optional<aggregation_function>(it->second);
+}
+
+/**
+ * @brief Whether an aggregation is computed per series, then summed
+ */
+inline bool is_per_series(aggregation_function function) noexcept {
+    return function == aggregation_function::rate || function == aggregation_function::delta ||
+           function == aggregation_function::derivative || function == aggregation_function::integral;
+}
+
+/**
+ * @brief Whether an aggregation only needs count, sum, min, max, first and last
+ */
+inline bool is_summary_friendly(aggregation_function function) noexcept {
+    switch (function) {
+        case aggregation_function::sum:
+        case aggregation_function::avg:
+        case aggregation_function::min:
+        case aggregation_function::max:
+        case aggregation_function::count:
+        case aggregation_function::delta:
+        case aggregation_function::derivative:
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline double apply_binary(binary_operator op, double a, double b) noexcept {
+    switch (op) {
+        case binary_operator::add: return a + b;
+        case binary_operator::subtract: return a - b;
+        case binary_operator::multiply: return a * b;
+        case binary_operator::divide: return a / b;
+        case binary_operator::modulo: return std::fmod(a, b);
+        case binary_operator::power: return std::pow(a, b);
+        case binary_operator::equal: return a == b ? 1.0 : 0.0;
+        case binary_operator::not_equal: return a != b ? 1.0 : 0.0;
+        case binary_operator::less_than: return a < b ? 1.0 : 0.0;
+        case binary_operator::less_equal: return a <= b ? 1.0 : 0.0;
+        case binary_operator::greater_than: return a > b ? 1.0 : 0.0;
+        case binary_operator::greater_equal: return a >= b ? 1.0 : 0.0;
+        case binary_operator::logical_and: return (a != 0.0 && b != 0.0) ? 1.0 : 0.0;
+        case binary_operator::logical_or: return (a != 0.0 || b != 0.0) ? 1.0 : 0.0;
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ * @struct bucket_accumulator
+ * @brief Running aggregates of the samples in one time bucket
+ *
+ * add() and add_summary() expect samples in time order (one series);
+ * append() continues a bucket with a later run of the same series and
+ * merge() combines buckets of different series.
+ */
+struct bucket_accumulator {
+    size_t points = 0;
+    uint64_t samples = 0;
+    double sum = 0.0;
+    double mean = 0.0;      ///< Sample-weighted running mean
+    double m2 = 0.0;        ///< Sum of squared deviations from mean
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    int64_t first_ticks = 0;
+    int64_t last_ticks = 0;
+    double first_value = 0.0;
+    double last_value = 0.0;
+    double increase = 0.0;  ///< Counter increase, resets count from zero
+    double area = 0.0;      ///< Trapezoidal integral in value x seconds
+    std::vector<std::pair<double, uint32_t>> values;  ///< Kept for percentiles only
+
+    void add(int64_t ticks, double value, uint32_t count, bool keep_values) {
+        if (points == 0) {
+            first_ticks = ticks;
+            first_value = value;
+        } else {
+            const double change = value - last_value;
+            increase += change >= 0.0 ? change : value;
+            area += (value + last_value) / 2.0 * ticks_to_seconds(ticks - last_ticks);
+        }
+        last_ticks = ticks;
+        last_value = value;
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+        sum += value * count;
+        if (count > 0) {
+            const uint64_t total = samples + count;
+            const double deviation = value - mean;
+            mean += deviation * count / static_cast<double>(total);
+            m2 += deviation * (value - mean) * count;
+            samples = total;
+        }
+        if (keep_values) {
+            values.emplace_back(value, count);
+        }
+        ++points;
+    }
+
+    /**
+     * @brief Fold a chunk summary (maintains count, sum, min, max, first, last)
+     */
+    void add_summary(const time_series_summary& summary) {
+        if (points == 0) {
+            first_ticks = summary.first_ticks;
+            first_value = summary.first_value;
+        }
+        last_ticks = summary.last_ticks;
+        last_value = summary.last_value;
+        min = summary.min < min ? summary.min : min;
+        max = summary.max > max ? summary.max : max;
+        sum += summary.sum;
+        samples += summary.samples;
+        points += summary.count;
+    }
+
+    void append(const bucket_accumulator& later) {
+        if (later.points == 0) {
+            return;
+        }
+        if (points == 0) {
+            *this = later;
+            return;
+        }
+        const double change = later.first_value - last_value;
+        increase += (change >= 0.0 ? change : later.first_value) + later.increase;
+        area += (later.first_value + last_value) / 2.0 * ticks_to_seconds(later.first_ticks - last_ticks) +
+                later.area;
+        last_ticks = later.last_ticks;
+        last_value = later.last_value;
+        merge(later);
+    }
+
+    void merge(const bucket_accumulator& other) {
+        if (other.points == 0) {
+            return;
+        }
+        const uint64_t total = samples + other.samples;
+        if (total > 0) {
+            const double deviation = other.mean - mean;
+            m2 += other.m2 + deviation * deviation * static_cast<double>(samples) *
+                                 static_cast<double>(other.samples) / static_cast<double>(total);
+            mean += deviation * static_cast<double>(other.samples) / static_cast<double>(total);
+        }
+        samples = total;
+        points += other.points;
+        sum += other.sum;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+        values.insert(values.end(), other.values.begin(), other.values.end());
+    }
+
+    std::optional<double> finish(aggregation_function function, double argument) {
+        if (points == 0) {
+            return std::nullopt;
+        }
+        const double elapsed = ticks_to_seconds(last_ticks - first_ticks);
+        switch (function) {
+            case aggregation_function::sum: return sum;
+            case aggregation_function::avg:
+                return samples == 0 ? std::nullopt : std::optional<double>(sum / static_cast<double>(samples));
+            case aggregation_function::min: return min;
+            case aggregation_function::max: return max;
+            case aggregation_function::count: return static_cast<double>(samples);
+            case aggregation_function::variance:
+                return samples == 0 ? std::nullopt : std::optional<double>(m2 / static_cast<double>(samples));
+            case aggregation_function::stddev:
+                return samples == 0 ? std::nullopt : std::optional<double>(std::sqrt(m2 / static_cast<double>(samples)));
+            case aggregation_function::percentile: {
+                if (samples == 0) {
+                    return std::nullopt;
+                }
+                // Nearest rank over sample-weighted values
+                std::sort(values.begin(), values.end());
+                const auto rank = static_cast<uint64_t>(std::ceil(argument / 100.0 * static_cast<double>(samples)));
+                uint64_t seen = 0;
+                for (const auto& [value, count] : values) {
+                    seen += count;
+                    if (seen >= std::max<uint64_t>(rank, 1)) {
+                        return value;
+                    }
+                }
+                return values.back().first;
+            }
+            case aggregation_function::rate:
+                return elapsed > 0.0 ? std::optional<double>(increase / elapsed) : std::nullopt;
+            case aggregation_function::delta: return last_value - first_value;
+            case aggregation_function::derivative:
+                return elapsed > 0.0 ? std::optional<double>((last_value - first_value) / elapsed) : std::nullopt;
+            case aggregation_function::integral: return area;
+        }
+        return std::nullopt;
+    }
+};
+
+/**
+ * @brief Evaluate an expression that does not depend on a row
+ */
+inline std::optional<double> evaluate_constant(const expression_node& node, double now,
+                                               const query_function_table& functions);
+
+/**
+ * @brief Parse an ISO-8601 timestamp, such as "2025-06-01T12:30:00Z",
+ *        "2025-06-01 12:30:00.250+02:00" or "2025-06-01"
+ */
+inline std::optional<std::chrono::system_clock::time_point> parse_timestamp(std::string_view text) {
+    size_t pos = 0;
+    auto number = [&](size_t digits, int& out) {
+        if (pos + digits > text.size()) {
+            return false;
+        }
+        out = 0;
+        for (size_t i = 0; i < digits; ++i) {
+            const char c = text[pos + i];
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            out = out * 10 + (c - '0');
+        }
+        pos += digits;
+        return true;
+    };
+    auto literal = [&](char c) {
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    };
+
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    if (!number(4, year) || !literal('-') || !number(2, month) || !literal('-') || !number(2, day) ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return std::nullopt;
+    }
+
+    double fraction = 0.0;
+    int offset_minutes = 0;
+    if (literal('T') || literal(' ')) {
+        if (!number(2, hour) || !literal(':') || !number(2, minute) || hour > 23 || minute > 59) {
+            return std::nullopt;
+        }
+        if (literal(':') && (!number(2, second) || second > 60)) {
+            return std::nullopt;
+        }
+        if (literal('.')) {
+            double scale = 0.1;
+            const size_t start = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                fraction += (text[pos++] - '0') * scale;
+                scale /= 10.0;
+            }
+            if (pos == start) {
+                return std::nullopt;
+            }
+        }
+        if (!literal('Z') && pos < text.size()) {
+            const bool negative = text[pos] == '-';
+            if (!literal('+') && !literal('-')) {
+                return std::nullopt;
+            }
+            int offset_hours = 0, offset_mins = 0;
+            if (!number(2, offset_hours)) {
+                return std::nullopt;
+            }
+            literal(':');
+            if (!number(2, offset_mins)) {
+                return std::nullopt;
+            }
+            offset_minutes = (negative ? -1 : 1) * (offset_hours * 60 + offset_mins);
+        }
+    }
+    if (pos != text.size()) {
+        return std::nullopt;
+    }
+
+    // Days since the epoch in the proleptic Gregorian calendar
+    const int y = year - (month <= 2 ? 1 : 0);
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int year_of_era = y - era * 400;
+    const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    const int64_t days = static_cast<int64_t>(era) * 146097 + day_of_era - 719468;
+
+    const double seconds = static_cast<double>(days * 86400 + hour * 3600 + minute * 60 + second -
+                                               offset_minutes * 60) + fraction;
+    return seconds_to_time(seconds);
+}
+
+inline std::optional<double> evaluate_constant(const expression_node& node, double now,
+                                               const query_function_table& functions) {
+    switch (node.type) {
+        case expression_type::literal:
+            return node.number;
+        case expression_type::string_literal: {
+            auto time = parse_timestamp(node.text);
+            return time ? std::optional<double>(time_to_seconds(*time)) : std::nullopt;
+        }
+        case expression_type::identifier:
+            return std::nullopt;
+        case expression_type::unary_op: {
+            auto operand = evaluate_constant(*node.children[0], now, functions);
+            if (!operand) {
+                return std::nullopt;
+            }
+            return node.unary_op == unary_operator::negate ? -*operand : (*operand == 0.0 ? 1.0 : 0.0);
+        }
+        case expression_type::binary_op: {
+            auto lhs = evaluate_constant(*node.children[0], now, functions);
+            auto rhs = evaluate_constant(*node.children[1], now, functions);
+            if (!lhs || !rhs) {
+                return std::nullopt;
+            }
+            return apply_binary(node.binary_op, *lhs, *rhs);
+        }
+        case expression_type::function_call: {
+            std::vector<double> args;
+            for (const auto& child : node.children) {
+                auto arg = evaluate_constant(*child, now, functions);
+                if (!arg) {
+                    return std::nullopt;
+                }
+                args.push_back(*arg);
+            }
+            if (node.text == "now") {
+                return now;
+            }
+            if (node.text == "abs") {
+                return std::fabs(args[0]);
+            }
+            auto it = functions.find(node.text);
+            return it == functions.end() ? std::nullopt : std::optional<double>(it->second(args));
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @class vector_evaluator
+ * @brief Evaluates an expression over a column batch, one column at a time
+ *
+ * Intermediate columns come from a pool reused across batches, so a scan
+ * allocates only while the pool warms up.
+ */
+class vector_evaluator {
+public:
+    vector_evaluator(double now, const query_function_table& functions)
+        : now_(now), functions_(functions) {}
+
+    /**
+     * @brief Indices of the rows for which @p predicate is true (not 0 or NaN)
+     */
+    void select(const expression_node& predicate, const int64_t* ticks, const double* values, size_t size,
+                std::vector<uint32_t>& selection) {
+        auto& mask = acquire();
+        evaluate(predicate, ticks, values, size, mask);
+        selection.clear();
+        for (size_t i = 0; i < size; ++i) {
+            if (mask[i] != 0.0 && !std::isnan(mask[i])) {
+                selection.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        release();
+    }
+
+private:
+    double now_;
+    const query_function_table& functions_;
+    std::deque<std::vector<double>> pool_;  // Deque keeps references stable while growing
+    size_t depth_ = 0;
+
+    std::vector<double>& acquire() {
+        if (depth_ == pool_.size()) {
+            pool_.emplace_back();
+        }
+        return pool_[depth_++];
+    }
+
+    void release() noexcept { --depth_; }
+
+    template<typename Op>
+    static void combine(std::vector<double>& out, const std::vector<double>& rhs, size_t size, Op op) {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = op(out[i], rhs[i]);
+        }
+    }
+
+    void evaluate(const expression_node& node, const int64_t* ticks, const double* values, size_t size,
+                  std::vector<double>& out) {
+        out.resize(size);
+        switch (node.type) {
+            case expression_type::literal:
+                std::fill(out.begin(), out.end(), node.number);
+                return;
+            case expression_type::string_literal: {
+                auto time = parse_timestamp(node.text);
+                std::fill(out.begin(), out.end(),
+                          time ? time_to_seconds(*time) : std::numeric_limits<double>::quiet_NaN());
+                return;
+            }
+            case expression_type::identifier:
+                if (node.text == "value") {
+                    std::copy(values, values + size, out.begin());
+                } else {
+                    for (size_t i = 0; i < size; ++i) {
+                        out[i] = ticks_to_seconds(ticks[i]);
+                    }
+                }
+                return;
+            case expression_type::unary_op:
+                evaluate(*node.children[0], ticks, values, size, out);
+                for (size_t i = 0; i < size; ++i) {
+                    out[i] = node.unary_op == unary_operator::negate ? -out[i] : (out[i] == 0.0 ? 1.0 : 0.0);
+                }
+                return;
+            case expression_type::binary_op: {
+                evaluate(*node.children[0], ticks, values, size, out);
+                auto& rhs = acquire();
+                evaluate(*node.children[1], ticks, values, size, rhs);
+                switch (node.binary_op) {
+                    case binary_operator::add: combine(out, rhs, size, std::plus<double>()); break;
+                    case binary_operator::subtract: combine(out, rhs, size, std::minus<double>()); break;
+                    case binary_operator::multiply: combine(out, rhs, size, std::multiplies<double>()); break;
+                    case binary_operator::divide: combine(out, rhs, size, std::divides<double>()); break;
+                    case binary_operator::less_than:
+                        combine(out, rhs, size, [](double a, double b) { return a < b ? 1.0 : 0.0; });
+                        break;
+                    case binary_operator::less_equal:
+                        combine(out, rhs, size, [](double a, double b) { return a <= b ? 1.0 : 0.0; });
+                        break;
+                    case binary_operator::greater_than:
+                        combine(out, rhs, size, [](double a, double b) { return a > b ? 1.0 : 0.0; });
+                        break;
+                    case binary_operator::greater_equal:
+                        combine(out, rhs, size, [](double a, double b) { return a >= b ? 1.0 : 0.0; });
+                        break;
+                    default: {
+                        const auto op = node.binary_op;
+                        combine(out, rhs, size, [op](double a, double b) { return apply_binary(op, a, b); });
+                        break;
+                    }
+                }
+                release();
+                return;
+            }
+            case expression_type::function_call: {
+                if (node.text == "now") {
+                    std::fill(out.begin(), out.end(), now_);
+                    return;
+                }
+                if (node.text == "abs") {
+                    evaluate(*node.children[0], ticks, values, size, out);
+                    for (size_t i = 0; i < size; ++i) {
+                        out[i] = std::fabs(out[i]);
+                    }
+                    return;
+                }
+                const auto& function = functions_.at(node.text);
+                std::vector<std::vector<double>*> columns;
+                for (const auto& child : node.children) {
+                    columns.push_back(&acquire());
+                    evaluate(*child, ticks, values, size, *columns.back());
+                }
+                std::vector<double> args(columns.size());
+                for (size_t i = 0; i < size; ++i) {
+                    for (size_t a = 0; a < columns.size(); ++a) {
+                        args[a] = (*columns[a])[i];
+                    }
+                    out[i] = function(args);
+                }
+                for (size_t a = 0; a < columns.size(); ++a) {
+                    release();
+                }
+                return;
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @class query_parser
+ * @brief Recursive-descent parser for the query language
+ */
+class query_parser {
+public:
+    /**
+     * @brief Parse a query
+     * @return Parsed query, or invalid_argument with the offending position
+     */
+    common::Result<parsed_query> parse(const std::string& query) {
+        tokens_.clear();
+        pos_ = 0;
+        error_.clear();
+
+        parsed_query parsed;
+        if (!tokenize(query) || !parse_query(parsed)) {
+            return common::Result<parsed_query>::err(
+                error_info(monitoring_error_code::invalid_argument, error_, "monitoring_system").to_common_error());
+        }
+        return common::Result<parsed_query>::ok(std::move(parsed));
+    }
+
+private:
+    enum class token_type {
+        keyword_select, keyword_from, keyword_where, keyword_group, keyword_by,
+        keyword_order, keyword_limit, keyword_asc, keyword_desc,
+        keyword_and, keyword_or, keyword_not,
+        equal, not_equal, less, less_equal, greater, greater_equal,
+        plus, minus, star, slash, percent, caret, lparen, rparen, comma,
+        identifier, number, duration, string, end
+    };
+
+    struct token {
+        token_type type = token_type::end;
+        std::string text;
+        double number = 0.0;
+        size_t position = 0;
+    };
+
+    std::vector<token> tokens_;
+    size_t pos_ = 0;
+    std::string error_;
+
+    bool fail(const std::string& message) {
+        if (error_.empty()) {
+            error_ = message + " at position " + std::to_string(tokens_.empty() ? 0 : peek().position);
+        }
+        return false;
+    }
+
+    const token& peek(size_t ahead = 0) const {
+        return tokens_[std::min(pos_ + ahead, tokens_.size() - 1)];
+    }
+
+    bool accept(token_type type) {
+        if (peek().type == type) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool expect(token_type type, const char* what) {
+        return accept(type) || fail(std::string("Expected ") + what);
+    }
+
+    bool tokenize(const std::string& query) {
+        static const std::unordered_map<std::string, token_type> keywords = {
+            {"select", token_type::keyword_select}, {"from", token_type::keyword_from},
+            {"where", token_type::keyword_where},   {"group", token_type::keyword_group},
+            {"by", token_type::keyword_by},         {"order", token_type::keyword_order},
+            {"limit", token_type::keyword_limit},   {"asc", token_type::keyword_asc},
+            {"desc", token_type::keyword_desc},     {"and", token_type::keyword_and},
+            {"or", token_type::keyword_or},         {"not", token_type::keyword_not},
+        };
+        static const std::unordered_map<std::string, double> units = {
+            {"ns", 1e-9}, {"us", 1e-6}, {"ms", 1e-3}, {"s", 1.0},
+            {"m", 60.0},  {"h", 3600.0}, {"d", 86400.0}, {"w", 604800.0},
+        };
+        auto is_name_char = [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == ':' || c == '.';
+        };
+
+        size_t i = 0;
+        while (i < query.size()) {
+            const char c = query[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+                continue;
+            }
+
+            token tok;
+            tok.position = i;
+            if (std::isdigit(static_cast<unsigned char>(c))) {
+                char* end = nullptr;
+                tok.number = std::strtod(query.c_str() + i, &end);
+                i = static_cast<size_t>(end - query.c_str());
+                size_t unit_end = i;
+                while (unit_end < query.size() && std::isalpha(static_cast<unsigned char>(query[unit_end]))) {
+                    ++unit_end;
+                }
+                tok.type = token_type::number;
+                if (unit_end > i) {
+                    auto unit = units.find(query.substr(i, unit_end - i));
+                    if (unit == units.end()) {
+                        error_ = "Unknown duration unit '" + query.substr(i, unit_end - i) +
+                                 "' at position " + std::to_string(i);
+                        return false;
+                    }
+                    tok.type = token_type::duration;
+                    tok.number *= unit->second;
+                    i = unit_end;
+                }
+            } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                size_t end = i;
+                while (end < query.size() && is_name_char(query[end])) {
+                    ++end;
+                }
+                tok.text = query.substr(i, end - i);
+                auto keyword = keywords.find(detail::to_lower(tok.text));
+                tok.type = keyword == keywords.end() ? token_type::identifier : keyword->second;
+                i = end;
+            } else if (c == '\'' || c == '"') {
+                ++i;
+                while (i < query.size() && query[i] != c) {
+                    if (query[i] == '\\' && i + 1 < query.size()) {
+                        ++i;
+                    }
+                    tok.text += query[i++];
+                }
+                if (i == query.size()) {
+                    error_ = "Unterminated string at position " + std::to_string(tok.position);
+                    return false;
+                }
+                ++i;
+                tok.type = token_type::string;
+            } else {
+                const char next = i + 1 < query.size() ? query[i + 1] : '\0';
+                auto two = [&](token_type type) {
+                    tok.type = type;
+                    i += 2;
+                };
+                auto one = [&](token_type type) {
+                    tok.type = type;
+                    i += 1;
+                };
+                switch (c) {
+                    case '=': next == '=' ? two(token_type::equal) : one(token_type::equal); break;
+                    case '!':
+                        if (next != '=') {
+                            error_ = "Unexpected '!' at position " + std::to_string(i);
+                            return false;
+                        }
+                        two(token_type::not_equal);
+                        break;
+                    case '<':
+                        next == '=' ? two(token_type::less_equal)
+                                    : next == '>' ? two(token_type::not_equal) : one(token_type::less);
+                        break;
+                    case '>': next == '=' ? two(token_type::greater_equal) : one(token_type::greater); break;
+                    case '+': one(token_type::plus); break;
+                    case '-': one(token_type::minus); break;
+                    case '*': one(token_type::star); break;
+                    case '/': one(token_type::slash); break;
+                    case '%': one(token_type::percent); break;
+                    case '^': one(token_type::caret); break;
+                    case '(': one(token_type::lparen); break;
+                    case ')': one(token_type::rparen); break;
+                    case ',': one(token_type::comma); break;
+                    default:
+                        error_ = std::string("Unexpected character '") + c + "' at position " + std::to_string(i);
+                        return false;
+                }
+            }
+            tokens_.push_back(std::move(tok));
+        }
+
+        token end;
+        end.position = query.size();
+        tokens_.push_back(end);
+        return true;
+    }
+
+    bool parse_query(parsed_query& parsed) {
+        if (!expect(token_type::keyword_select, "SELECT")) {
+            return false;
+        }
+        do {
+            if (!parse_select_item(parsed.select)) {
+                return false;
+            }
+        } while (accept(token_type::comma));
+
+        std::vector<std::string> sources;
+        if (accept(token_type::keyword_from)) {
+            do {
+                std::string source;
+                if (!parse_source(source)) {
+                    return false;
+                }
+                sources.push_back(std::move(source));
+            } while (accept(token_type::comma));
+        }
+        if (!expand_sources(parsed.select, sources)) {
+            return false;
+        }
+
+        if (accept(token_type::keyword_where)) {
+            parsed.where_clause = parse_or();
+            if (!parsed.where_clause) {
+                return false;
+            }
+        }
+
+        if (accept(token_type::keyword_group)) {
+            if (!expect(token_type::keyword_by, "BY")) {
+                return false;
+            }
+            do {
+                if (!parse_group_by(parsed)) {
+                    return false;
+                }
+            } while (accept(token_type::comma));
+        }
+
+        if (accept(token_type::keyword_order)) {
+            if (!expect(token_type::keyword_by, "BY")) {
+                return false;
+            }
+            order_by_item order;
+            order.column = detail::to_lower(peek().text);
+            if (peek().type != token_type::identifier || (order.column != "time" && order.column != "value")) {
+                return fail("ORDER BY supports only time and value");
+            }
+            ++pos_;
+            order.ascending = !accept(token_type::keyword_desc);
+            if (order.ascending) {
+                accept(token_type::keyword_asc);
+            }
+            parsed.order_by = order;
+        }
+
+        if (accept(token_type::keyword_limit)) {
+            const double limit = peek().number;
+            if (peek().type != token_type::number || limit < 0 || limit != std::floor(limit)) {
+                return fail("LIMIT expects a non-negative integer");
+            }
+            ++pos_;
+            parsed.limit = static_cast<size_t>(limit);
+        }
+
+        return peek().type == token_type::end || fail("Unexpected '" + describe(peek()) + "'");
+    }
+
+    static std::string describe(const token& tok) {
+        if (!tok.text.empty()) {
+            return tok.text;
+        }
+        if (tok.type == token_type::number || tok.type == token_type::duration) {
+            std::ostringstream out;
+            out << tok.number;
+            return out.str();
+        }
+        return tok.type == token_type::end ? "end of query" : "operator";
+    }
+
+    bool parse_source(std::string& source) {
+        const token& tok = peek();
+        if (tok.type == token_type::identifier || tok.type == token_type::string) {
+            source = tok.text;
+        } else if (tok.type == token_type::star) {
+            source = "*";
+        } else {
+            return fail("Expected a metric name or series selector");
+        }
+        ++pos_;
+        return true;
+    }
+
+    bool parse_select_item(std::vector<select_item>& items) {
+        select_item item;
+        if (peek().type == token_type::identifier && peek(1).type == token_type::lparen) {
+            const auto function = detail::aggregation_from_name(detail::to_lower(peek().text));
+            if (!function) {
+                return fail("Unknown aggregation '" + peek().text + "'");
+            }
+            pos_ += 2;
+            if (!parse_source(item.source)) {
+                return false;
+            }
+            if (*function == aggregation_function::percentile) {
+                if (!expect(token_type::comma, "percentile rank")) {
+                    return false;
+                }
+                if (peek().type != token_type::number || peek().number > 100.0) {
+                    return fail("Percentile rank must be a number between 0 and 100");
+                }
+                item.argument = tokens_[pos_++].number;
+            }
+            if (!expect(token_type::rparen, "')'")) {
+                return false;
+            }
+            item.aggregation = function;
+        } else if (!parse_source(item.source)) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        return true;
+    }
+
+    bool expand_sources(std::vector<select_item>& items, const std::vector<std::string>& sources) {
+        std::vector<select_item> expanded;
+        for (auto& item : items) {
+            if (item.source != "value" && item.source != "*") {
+                expanded.push_back(std::move(item));
+                continue;
+            }
+            if (sources.empty()) {
+                return fail("Selecting '" + item.source + "' requires a FROM clause");
+            }
+            for (const auto& source : sources) {
+                select_item copy = item;
+                copy.source = source;
+                expanded.push_back(std::move(copy));
+            }
+        }
+        items = std::move(expanded);
+        return true;
+    }
+
+    bool parse_group_by(parsed_query& parsed) {
+        const token& tok = peek();
+        if (tok.type == token_type::identifier && detail::to_lower(tok.text) == "time" &&
+            peek(1).type == token_type::lparen) {
+            pos_ += 2;
+            if (peek().type != token_type::duration) {
+                return fail("GROUP BY time() expects a duration such as 1m");
+            }
+            const auto step = std::chrono::milliseconds(std::llround(tokens_[pos_++].number * 1000.0));
+            if (step.count() <= 0) {
+                return fail("GROUP BY time() interval must be at least 1ms");
+            }
+            parsed.group_by_time = step;
+            return expect(token_type::rparen, "')'");
+        }
+        if (tok.type != token_type::identifier && tok.type != token_type::string) {
+            return fail("Expected time(...) or a label name");
+        }
+        parsed.group_by_tags.push_back(tok.text);
+        ++pos_;
+        return true;
+    }
+
+    static expression_ptr make_binary(binary_operator op, expression_ptr lhs, expression_ptr rhs) {
+        auto node = std::make_shared<expression_node>();
+        node->type = expression_type::binary_op;
+        node->binary_op = op;
+        node->children = {std::move(lhs), std::move(rhs)};
+        return node;
+    }
+
+    static expression_ptr make_unary(unary_operator op, expression_ptr operand) {
+        auto node = std::make_shared<expression_node>();
+        node->type = expression_type::unary_op;
+        node->unary_op = op;
+        node->children = {std::move(operand)};
+        return node;
+    }
+
+    template<typename Next>
+    expression_ptr parse_binary_level(Next next, std::initializer_list<std::pair<token_type, binary_operator>> ops) {
+        expression_ptr lhs = (this->*next)();
+        while (lhs) {
+            auto op = std::find_if(ops.begin(), ops.end(), [this](const auto& entry) { return peek().type == entry.first; });
+            if (op == ops.end()) {
+                break;
+            }
+            ++pos_;
+            expression_ptr rhs = (this->*next)();
+            if (!rhs) {
+                return nullptr;
+            }
+            lhs = make_binary(op->second, std::move(lhs), std::move(rhs));
+        }
+        return lhs;
+    }
+
+    expression_ptr parse_or() {
+        return parse_binary_level(&query_parser::parse_and, {{token_type::keyword_or, binary_operator::logical_or}});
+    }
+
+    expression_ptr parse_and() {
+        return parse_binary_level(&query_parser::parse_not, {{token_type::keyword_and, binary_operator::logical_and}});
+    }
+
+    expression_ptr parse_not() {
+        if (accept(token_type::keyword_not)) {
+            auto operand = parse_not();
+            return operand ? make_unary(unary_operator::logical_not, std::move(operand)) : nullptr;
+        }
+        return parse_comparison();
+    }
+
+    expression_ptr parse_comparison() {
+        return parse_binary_level(&query_parser::parse_additive, {
+            {token_type::equal, binary_operator::equal},
+            {token_type::not_equal, binary_operator::not_equal},
+            {token_type::less, binary_operator::less_than},
+            {token_type::less_equal, binary_operator::less_equal},
+            {token_type::greater, binary_operator::greater_than},
+            {token_type::greater_equal, binary_operator::greater_equal},
+        });
+    }
+
+    expression_ptr parse_additive() {
+        return parse_binary_level(&query_parser::parse_multiplicative, {
+            {token_type::plus, binary_operator::add},
+            {token_type::minus, binary_operator::subtract},
+        });
+    }
+
+    expression_ptr parse_multiplicative() {
+        return parse_binary_level(&query_parser::parse_unary, {
+            {token_type::star, binary_operator::multiply},
+            {token_type::slash, binary_operator::divide},
+            {token_type::percent, binary_operator::modulo},
+        });
+    }
+
+    expression_ptr parse_unary() {
+        if (accept(token_type::minus)) {
+            auto operand = parse_unary();
+            return operand ? make_unary(unary_operator::negate, std::move(operand)) : nullptr;
+        }
+        return parse_power();
+    }
+
+    expression_ptr parse_power() {
+        expression_ptr base = parse_primary();
+        if (base && accept(token_type::caret)) {
+            expression_ptr exponent = parse_unary();  // Right associative
+            return exponent ? make_binary(binary_operator::power, std::move(base), std::move(exponent)) : nullptr;
+        }
+        return base;
+    }
+
+    expression_ptr parse_primary() {
+        const token tok = peek();
+        auto node = std::make_shared<expression_node>();
+        switch (tok.type) {
+            case token_type::number:
+            case token_type::duration:
+                ++pos_;
+                node->type = expression_type::literal;
+                node->number = tok.number;
+                return node;
+            case token_type::string:
+                ++pos_;
+                node->type = expression_type::string_literal;
+                node->text = tok.text;
+                return node;
+            case token_type::lparen: {
+                ++pos_;
+                auto inner = parse_or();
+                if (!inner || !expect(token_type::rparen, "')'")) {
+                    return nullptr;
+                }
+                return inner;
+            }
+            case token_type::identifier: {
+                ++pos_;
+                const std::string lower = detail::to_lower(tok.text);
+                if (accept(token_type::lparen)) {
+                    node->type = expression_type::function_call;
+                    node->text = lower;
+                    if (!accept(token_type::rparen)) {
+                        do {
+                            auto arg = parse_or();
+                            if (!arg) {
+                                return nullptr;
+                            }
+                            node->children.push_back(std::move(arg));
+                        } while (accept(token_type::comma));
+                        if (!expect(token_type::rparen, "')'")) {
+                            return nullptr;
+                        }
+                    }
+                    return node;
+                }
+                node->type = expression_type::identifier;
+                node->text = (lower == "time" || lower == "value") ? lower : tok.text;
+                return node;
+            }
+            default:
+                fail("Unexpected '" + describe(tok) + "'");
+                return nullptr;
+        }
+    }
+};
+
+/**
+ * @class query_optimizer
+ * @brief Resolves a parsed query into an executable plan
+ *
+ * - Top-level AND terms comparing `time` with a constant narrow the
+ *   scanned range instead of filtering rows.
+ * - Top-level AND terms `label = 'x'` / `label != 'x'` become selector
+ *   matchers, so only matching series are read; labels may not be used
+ *   anywhere else.
+ * - Without a residual filter, summary-friendly aggregations fold whole
+ *   chunks from their stored summaries.
+ */
+class query_optimizer {
+public:
+    struct optimization_result {
+        parsed_query optimized_query;
+        std::vector<std::string> optimizations_applied;
+    };
+
+    common::Result<optimization_result> optimize(parsed_query query, const query_hints& hints,
+                                                 const query_function_table& functions,
+                                                 std::chrono::system_clock::time_point now) const {
+        using result_type = common::Result<optimization_result>;
+        auto fail = [](const std::string& message) {
+            return result_type::err(
+                error_info(monitoring_error_code::invalid_argument, message, "monitoring_system").to_common_error());
+        };
+
+        optimization_result result;
+        const double now_seconds = detail::time_to_seconds(now);
+        std::vector<label_matcher> label_matchers;
+        std::vector<expression_ptr> residual;
+        bool pushed_time = false;
+
+        std::vector<expression_ptr> terms;
+        split_conjunction(query.where_clause, terms);
+        for (auto& term : terms) {
+            if (auto matcher = as_label_matcher(*term)) {
+                label_matchers.push_back(std::move(*matcher));
+                continue;
+            }
+            if (push_time_bound(*term, now_seconds, functions, query)) {
+                pushed_time = true;
+                continue;
+            }
+            std::string problem;
+            if (!validate_row_expression(*term, functions, problem)) {
+                return fail(problem);
+            }
+            residual.push_back(std::move(term));
+        }
+
+        query.where_clause = nullptr;
+        for (auto& term : residual) {
+            query.where_clause = query.where_clause
+                ? make_and(std::move(query.where_clause), std::move(term)) : std::move(term);
+        }
+        if (pushed_time) {
+            result.optimizations_applied.push_back("time range push-down");
+        }
+        if (!label_matchers.empty()) {
+            result.optimizations_applied.push_back("label predicate push-down");
+        }
+
+        if (!query.to_time) {
+            query.to_time = now;
+        }
+        if (!query.from_time) {
+            query.from_time = *query.to_time - std::chrono::hours(1);
+        }
+        if (*query.from_time >= *query.to_time) {
+            return fail("Query time range is empty");
+        }
+        if (query.select.empty()) {
+            return fail("Query selects nothing");
+        }
+
+        bool summarized = false;
+        for (auto& item : query.select) {
+            if (item.source.find('{') != std::string::npos) {
+                auto parsed = parse_label_selector(item.source);
+                if (parsed.is_err()) {
+                    return result_type::err(parsed.error());
+                }
+                item.matchers = std::move(parsed.value());
+            } else {
+                item.matchers = {label_matcher(metric_name_label, label_match_type::equal, item.source)};
+            }
+            item.matchers.insert(item.matchers.end(), label_matchers.begin(), label_matchers.end());
+
+            item.use_summaries = hints.optimize_aggregations && !query.where_clause && item.aggregation &&
+                                 detail::is_summary_friendly(*item.aggregation);
+            summarized = summarized || item.use_summaries;
+        }
+        if (summarized) {
+            result.optimizations_applied.push_back("chunk summary aggregation");
+        }
+
+        result.optimized_query = std::move(query);
+        return result_type::ok(std::move(result));
+    }
+
+private:
+    static void split_conjunction(const expression_ptr& node, std::vector<expression_ptr>& terms) {
+        if (!node) {
+            return;
+        }
+        if (node->type == expression_type::binary_op && node->binary_op == binary_operator::logical_and) {
+            split_conjunction(node->children[0], terms);
+            split_conjunction(node->children[1], terms);
+            return;
+        }
+        terms.push_back(node);
+    }
+
+    static expression_ptr make_and(expression_ptr lhs, expression_ptr rhs) {
+        auto node = std::make_shared<expression_node>();
+        node->type = expression_type::binary_op;
+        node->binary_op = binary_operator::logical_and;
+        node->children = {std::move(lhs), std::move(rhs)};
+        return node;
+    }
+
+    static bool is_label(const expression_node& node) {
+        return node.type == expression_type::identifier && node.text != "time" && node.text != "value";
+    }
+
+    static std::optional<label_matcher> as_label_matcher(const expression_node& term) {
+        if (term.type != expression_type::binary_op ||
+            (term.binary_op != binary_operator::equal && term.binary_op != binary_operator::not_equal)) {
+            return std::nullopt;
+        }
+        const auto& lhs = *term.children[0];
+        const auto& rhs = *term.children[1];
+        const expression_node* label = is_label(lhs) ? &lhs : is_label(rhs) ? &rhs : nullptr;
+        const expression_node* value = label == &lhs ? &rhs : &lhs;
+        if (label == nullptr || value->type != expression_type::string_literal) {
+            return std::nullopt;
+        }
+        return label_matcher(label->text,
+                             term.binary_op == binary_operator::equal ? label_match_type::equal
+                                                                      : label_match_type::not_equal,
+                             value->text);
+    }
+
+    static bool push_time_bound(const expression_node& term, double now, const query_function_table& functions,
+                                parsed_query& query) {
+        if (term.type != expression_type::binary_op) {
+            return false;
+        }
+        auto op = term.binary_op;
+        const expression_node* bound = nullptr;
+        if (term.children[0]->type == expression_type::identifier && term.children[0]->text == "time") {
+            bound = term.children[1].get();
+        } else if (term.children[1]->type == expression_type::identifier && term.children[1]->text == "time") {
+            bound = term.children[0].get();
+            // Mirror "c < time" into "time > c"
+            switch (op) {
+                case binary_operator::less_than: op = binary_operator::greater_than; break;
+                case binary_operator::less_equal: op = binary_operator::greater_equal; break;
+                case binary_operator::greater_than: op = binary_operator::less_than; break;
+                case binary_operator::greater_equal: op = binary_operator::less_equal; break;
+                default: break;
+            }
+        }
+        if (bound == nullptr) {
+            return false;
+        }
+        const auto value = detail::evaluate_constant(*bound, now, functions);
+        if (!value || std::isnan(*value)) {
+            return false;
+        }
+
+        const auto at = detail::seconds_to_time(*value);
+        const auto after = at + std::chrono::system_clock::duration(1);
+        auto raise_from = [&](std::chrono::system_clock::time_point t) {
+            query.from_time = query.from_time ? std::max(*query.from_time, t) : t;
+        };
+        auto lower_to = [&](std::chrono::system_clock::time_point t) {
+            query.to_time = query.to_time ? std::min(*query.to_time, t) : t;
+        };
+        switch (op) {
+            case binary_operator::greater_equal: raise_from(at); return true;
+            case binary_operator::greater_than: raise_from(after); return true;
+            case binary_operator::less_than: lower_to(at); return true;
+            case binary_operator::less_equal: lower_to(after); return true;
+            case binary_operator::equal: raise_from(at); lower_to(after); return true;
+            default: return false;
+        }
+    }
+
+    static bool validate_row_expression(const expression_node& node, const query_function_table& functions,
+                                        std::string& problem) {
+        if (is_label(node)) {
+            problem = "Label '" + node.text +
+                      "' can only be compared to a string with = or != in a top-level AND term";
+            return false;
+        }
+        if (node.type == expression_type::function_call) {
+            const size_t arity = node.children.size();
+            if (node.text == "now" ? arity != 0 : node.text == "abs" ? arity != 1 : !functions.count(node.text)) {
+                problem = "Unknown function or wrong arity: " + node.text + "()";
+                return false;
+            }
+        }
+        for (const auto& child : node.children) {
+            if (!validate_row_expression(*child, functions, problem)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @class query_worker_pool
+ * @brief Fixed set of threads that run the scan tasks of queries
+ */
+class query_worker_pool {
+public:
+    explicit query_worker_pool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back(&query_worker_pool::worker_loop, this);
+        }
+    }
+
+    ~query_worker_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    query_worker_pool(const query_worker_pool&) = delete;
+    query_worker_pool& operator=(const query_worker_pool&) = delete;
+
+    size_t size() const noexcept { return workers_.size(); }
+
+    /**
+     * @brief Run fn(i) for every i in [0, count) and wait for all of them
+     *
+     * The calling thread takes tasks too, so a query still progresses while
+     * the workers are busy with other queries.
+     */
+    template<typename Fn>
+    void run(size_t count, Fn& fn) {
+        struct batch_state {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> finished{0};
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto state = std::make_shared<batch_state>();
+        auto drain = [state, count, &fn] {
+            size_t ran = 0;
+            for (size_t i = state->next.fetch_add(1); i < count; i = state->next.fetch_add(1)) {
+                fn(i);
+                ++ran;
+            }
+            if (ran > 0 && state->finished.fetch_add(ran) + ran == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        };
+
+        const size_t helpers = std::min(workers_.size(), count > 0 ? count - 1 : 0);
+        if (helpers > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (size_t i = 0; i < helpers; ++i) {
+                    tasks_.emplace_back(drain);
+                }
+            }
+            cv_.notify_all();
+        }
+
+        drain();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&] { return state->finished.load() == count; });
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+
+    void worker_loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+/**
+ * @class query_executor
+ * @brief Runs optimized queries against a metric_storage
+ *
+ * Every column is split into one scan task per selected series and, for
+ * ranges longer than query_hints::time_partition, per time partition.
+ * Partitions are aligned to the GROUP BY interval, so a bucket is split
+ * only when the whole range is one bucket; such partials are joined in
+ * time order with bucket_accumulator::append(). With parallel_execution
+ * the tasks run on a worker pool of max_parallel_tasks threads (the caller
+ * included), started by the first query that has more than one task.
+ * Partial results are merged in plan order, so results are bit-identical
+ * whatever the thread count.
+ */
+class query_executor {
+public:
+    explicit query_executor(const metric_storage& storage, const query_hints& hints = {})
+        : storage_(storage),
+          time_partition_(hints.time_partition),
+          pool_threads_(hints.parallel_execution && hints.max_parallel_tasks > 1 ? hints.max_parallel_tasks - 1 : 0) {}
+
+    /**
+     * @brief Execute a query produced by query_optimizer
+     * @param functions Functions callable from the residual filter
+     * @param now Value of now() in the residual filter
+     */
+    common::Result<query_result> execute(const parsed_query& query, const query_function_table& functions,
+                                         std::chrono::system_clock::time_point now) const {
+        if (!query.from_time || !query.to_time) {
+            return common::Result<query_result>::err(error_info(monitoring_error_code::invalid_argument,
+                "Query has no time range; optimize it before execution", "monitoring_system").to_common_error());
+        }
+
+        query_result result;
+        const auto partitions = time_partitions(query);
+        std::vector<std::vector<std::string>> columns;
+        std::vector<scan_task> tasks;
+        for (size_t column = 0; column < query.select.size(); ++column) {
+            auto names = storage_.select_metric_names(query.select[column].matchers);
+            if (names.is_err()) {
+                return common::Result<query_result>::err(names.error());
+            }
+            std::sort(names.value().begin(), names.value().end());
+            for (size_t series = 0; series < names.value().size(); ++series) {
+                for (size_t partition = 0; partition < partitions.size(); ++partition) {
+                    tasks.push_back({column, series, partition});
+                }
+            }
+            result.series_scanned += names.value().size();
+            columns.push_back(std::move(names.value()));
+        }
+
+        std::vector<scan_output> outputs(tasks.size());
+        const double now_seconds = detail::time_to_seconds(now);
+        auto run_task = [&](size_t index) {
+            const auto& task = tasks[index];
+            const auto& item = query.select[task.column];
+            const auto& [from, to] = partitions[task.partition];
+            detail::vector_evaluator filter(now_seconds, functions);
+            outputs[index].status = scan(query, item, columns[task.column][task.series], from, to, filter,
+                                         outputs[index]);
+        };
+        if (pool_threads_ > 0 && tasks.size() > 1) {
+            worker_pool().run(tasks.size(), run_task);
+        } else {
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                run_task(i);
+            }
+        }
+        result.scan_tasks = tasks.size();
+
+        // Merge in plan order so that scheduling cannot change the result
+        size_t next = 0;
+        for (size_t column = 0; column < query.select.size(); ++column) {
+            const size_t count = columns[column].size() * partitions.size();
+            for (size_t i = next; i < next + count; ++i) {
+                if (outputs[i].status.is_err() &&
+                    outputs[i].status.error().code != static_cast<int>(monitoring_error_code::metric_not_found)) {
+                    return common::Result<query_result>::err(outputs[i].status.error());
+                }
+                result.points_scanned += outputs[i].points_scanned;
+                result.points_summarized += outputs[i].points_summarized;
+            }
+            const auto& item = query.select[column];
+            if (item.aggregation) {
+                merge_aggregates(query, column, columns[column], partitions.size(), &outputs[next], result);
+            } else {
+                merge_rows(query, column, columns[column], partitions.size(), &outputs[next], result);
+            }
+            next += count;
+        }
+        return common::Result<query_result>::ok(std::move(result));
+    }
+
+    /**
+     * @brief Apply ORDER BY and LIMIT, then append to the result unless
+     *        the series has no points
+     */
+    static void finish_series(const parsed_query& query, query_series& series, query_result& result) {
+        if (series.values.empty()) {
+            return;
+        }
+        const bool by_value = query.order_by && query.order_by->column == "value";
+        const bool ascending = !query.order_by || query.order_by->ascending;
+        if (by_value || !ascending) {
+            std::vector<size_t> order(series.size());
+            std::iota(order.begin(), order.end(), size_t{0});
+            if (by_value) {
+                std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                    return ascending ? series.values[a] < series.values[b] : series.values[a] > series.values[b];
+                });
+            } else {
+                std::reverse(order.begin(), order.end());
+            }
+
+            query_series ordered;
+            ordered.timestamps.reserve(order.size());
+            ordered.values.reserve(order.size());
+            for (size_t i : order) {
+                ordered.timestamps.push_back(series.timestamps[i]);
+                ordered.values.push_back(series.values[i]);
+            }
+            series.timestamps = std::move(ordered.timestamps);
+            series.values = std::move(ordered.values);
+        }
+        if (query.limit && series.size() > *query.limit) {
+            series.timestamps.resize(*query.limit);
+            series.values.resize(*query.limit);
+        }
+        result.series.push_back(std::move(series));
+    }
+
+private:
+    using bucket_list = std::vector<std::pair<int64_t, detail::bucket_accumulator>>;
+    using time_range = std::pair<std::chrono::system_clock::time_point, std::chrono::system_clock::time_point>;
+
+    struct scan_task {
+        size_t column;
+        size_t series;
+        size_t partition;
+    };
+
+    struct scan_output {
+        common::VoidResult status = common::ok();  // metric_not_found if cleared since selected
+        bucket_list buckets;                       // Aggregated columns
+        std::vector<int64_t> ticks;                // Raw columns
+        std::vector<double> values;
+        size_t points_scanned = 0;
+        size_t points_summarized = 0;
+    };
+
+    const metric_storage& storage_;
+    std::chrono::seconds time_partition_;
+    size_t pool_threads_;
+    mutable std::once_flag pool_started_;
+    mutable std::unique_ptr<query_worker_pool> pool_;
+
+    query_worker_pool& worker_pool() const {
+        std::call_once(pool_started_, [this] { pool_ = std::make_unique<query_worker_pool>(pool_threads_); });
+        return *pool_;
+    }
+
+    static std::chrono::system_clock::duration bucket_width(const parsed_query& query) {
+        return query.group_by_time
+            ? std::chrono::duration_cast<std::chrono::system_clock::duration>(*query.group_by_time)
+            : std::chrono::system_clock::duration::zero();
+    }
+
+    /**
+     * @brief Epoch-aligned time partitions of the query range, at least
+     *        time_partition long and a whole number of buckets
+     */
+    std::vector<time_range> time_partitions(const parsed_query& query) const {
+        const auto from = *query.from_time;
+        const auto to = *query.to_time;
+        auto span = std::chrono::duration_cast<std::chrono::system_clock::duration>(time_partition_);
+        const auto width = bucket_width(query);
+        if (width.count() > 0 && span.count() > 0) {
+            span = width * ((span.count() + width.count() - 1) / width.count());
+        }
+        if (span.count() <= 0 || to - from <= span) {
+            return {{from, to}};
+        }
+
+        std::vector<time_range> partitions;
+        int64_t index = detail::floor_div(from.time_since_epoch().count(), span.count());
+        for (auto start = from; start < to; ++index) {
+            const auto end = std::min(to, std::chrono::system_clock::time_point(span * (index + 1)));
+            partitions.emplace_back(start, end);
+            start = end;
+        }
+        return partitions;
+    }
+
+    /**
+     * @brief Scan one series over one partition into @p output
+     */
+    common::VoidResult scan(const parsed_query& query, const select_item& item, const std::string& name,
+                            std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to,
+                            detail::vector_evaluator& filter, scan_output& output) const {
+        std::vector<uint32_t> selection;
+        auto for_each_row = [&](const int64_t* ticks, const double* values, const uint32_t* counts, size_t size,
+                                auto&& row) {
+            output.points_scanned += size;
+            if (query.where_clause) {
+                filter.select(*query.where_clause, ticks, values, size, selection);
+                for (uint32_t i : selection) {
+                    row(ticks[i], values[i], counts[i]);
+                }
+            } else {
+                for (size_t i = 0; i < size; ++i) {
+                    row(ticks[i], values[i], counts[i]);
+                }
+            }
+        };
+
+        if (!item.aggregation) {
+            return storage_.scan_metric(name, from, to,
+                [&](const int64_t* ticks, const double* values, const uint32_t* counts, size_t size) {
+                    for_each_row(ticks, values, counts, size, [&output](int64_t t, double value, uint32_t) {
+                        output.ticks.push_back(t);
+                        output.values.push_back(value);
+                    });
+                });
+        }
+
+        const bool keep_values = *item.aggregation == aggregation_function::percentile;
+        const auto width = bucket_width(query).count();
+        // Rows arrive in time order, so buckets are appended
+        auto current = [&output, width](int64_t ticks) -> detail::bucket_accumulator& {
+            const int64_t bucket = width == 0 ? 0 : detail::floor_div(ticks, width);
+            if (output.buckets.empty() || output.buckets.back().first != bucket) {
+                output.buckets.emplace_back(bucket, detail::bucket_accumulator());
+            }
+            return output.buckets.back().second;
+        };
+        auto batch = [&](const int64_t* ticks, const double* values, const uint32_t* counts, size_t size) {
+            for_each_row(ticks, values, counts, size, [&](int64_t t, double value, uint32_t count) {
+                current(t).add(t, value, count, keep_values);
+            });
+        };
+        if (item.use_summaries) {
+            return storage_.scan_metric(name, from, to, bucket_width(query), batch,
+                [&](const time_series_summary& summary) {
+                    output.points_summarized += summary.count;
+                    current(summary.first_ticks).add_summary(summary);
+                });
+        }
+        return storage_.scan_metric(name, from, to, batch);
+    }
+
+    void merge_rows(const parsed_query& query, size_t column, const std::vector<std::string>& names,
+                    size_t partitions, scan_output* outputs, query_result& result) const {
+        for (size_t s = 0; s < names.size(); ++s) {
+            scan_output* parts = outputs + s * partitions;
+            if (parts[0].status.is_err()) {
+                continue;
+            }
+            query_series series;
+            series.name = names[s];
+            series.column = column;
+            for (auto& label : parse_series_name(names[s])) {
+                if (label.first != metric_name_label) {
+                    series.labels.push_back(std::move(label));
+                } else {
+                    series.name = label.second;
+                }
+            }
+            for (size_t p = 0; p < partitions; ++p) {
+                for (int64_t t : parts[p].ticks) {
+                    series.timestamps.emplace_back(std::chrono::system_clock::duration(t));
+                }
+                series.values.insert(series.values.end(), parts[p].values.begin(), parts[p].values.end());
+            }
+            finish_series(query, series, result);
+        }
+    }
+
+    void merge_aggregates(const parsed_query& query, size_t column, const std::vector<std::string>& names,
+                          size_t partitions, scan_output* outputs, query_result& result) const {
+        const auto& item = query.select[column];
+        struct group_state {
+            std::map<int64_t, detail::bucket_accumulator> buckets;
+            std::map<int64_t, double> totals;  // Per-series aggregations, summed
+        };
+
+        const auto function = *item.aggregation;
+        std::map<std::vector<std::string>, group_state> groups;
+        for (size_t s = 0; s < names.size(); ++s) {
+            scan_output* parts = outputs + s * partitions;
+            if (parts[0].status.is_err()) {
+                continue;  // Cleared since it was selected
+            }
+
+            // Join the partitions of the series; only the whole-range bucket spans several
+            bucket_list buckets = std::move(parts[0].buckets);
+            for (size_t p = 1; p < partitions; ++p) {
+                for (auto& entry : parts[p].buckets) {
+                    if (!buckets.empty() && buckets.back().first == entry.first) {
+                        buckets.back().second.append(entry.second);
+                    } else {
+                        buckets.push_back(std::move(entry));
+                    }
+                }
+            }
+
+            const label_set labels = parse_series_name(names[s]);
+            std::vector<std::string> key;
+            for (const auto& tag : query.group_by_tags) {
+                auto it = std::find_if(labels.begin(), labels.end(), [&tag](const auto& l) { return l.first == tag; });
+                key.push_back(it == labels.end() ? std::string() : it->second);
+            }
+            auto& group = groups[key];
+            for (auto& [bucket, accumulator] : buckets) {
+                if (!detail::is_per_series(function)) {
+                    group.buckets[bucket].merge(accumulator);
+                } else if (auto value = accumulator.finish(function, item.argument)) {
+                    group.totals[bucket] += *value;
+                }
+            }
+        }
+
+        const auto width = bucket_width(query);
+        for (auto& [key, group] : groups) {
+            query_series series;
+            series.name = item.column_name();
+            series.column = column;
+            for (size_t i = 0; i < key.size(); ++i) {
+                if (!key[i].empty()) {
+                    series.labels.emplace_back(query.group_by_tags[i], key[i]);
+                }
+            }
+            std::sort(series.labels.begin(), series.labels.end());
+
+            auto emit = [&](int64_t bucket, double value) {
+                series.timestamps.push_back(width.count() == 0
+                    ? *query.from_time
+                    : std::chrono::system_clock::time_point(width * bucket));
+                series.values.push_back(value);
+            };
+            if (detail::is_per_series(function)) {
+                for (const auto& [bucket, total] : group.totals) {
+                    emit(bucket, total);
+                }
+            } else {
+                for (auto& [bucket, accumulator] : group.buckets) {
+                    if (auto value = accumulator.finish(function, item.argument)) {
+                        emit(bucket, *value);
+                    }
+                }
+            }
+            finish_series(query, series, result);
+        }
+    }
+};
+
+/**
+ * @class query_result_cache
+ * @brief Bucket values of GROUP BY time queries, reused by shifted windows
+ *
+ * An entry is keyed on the normalized query plus its window length in
+ * buckets, and holds the values of the buckets that were complete (ended
+ * before the query's now) and lay wholly inside the last window. A query
+ * whose window overlaps the entry reuses those buckets and computes only
+ * the rest: the partial edge buckets and, after the window moved, the new
+ * tail. The entry is then advanced to the new window, trimming the buckets
+ * that fell off its head.
+ *
+ * Only one query refreshes an entry at a time; identical queries arriving
+ * meanwhile wait and then reuse its buckets. Entries older than cache_ttl
+ * are recomputed in full, which bounds how long late samples in cached
+ * buckets go unseen.
+ */
+class query_result_cache {
+public:
+    /**
+     * @brief Series of one result, keyed by column index and GROUP BY values
+     */
+    struct cached_series {
+        std::string name;
+        label_set labels;
+        std::map<int64_t, double> values;  ///< Bucket index to value
+    };
+    using series_map = std::map<std::pair<size_t, std::vector<std::string>>, cached_series>;
+
+    /**
+     * @brief Buckets handed to a query by acquire()
+     */
+    struct lease {
+        int64_t first_bucket = 0;  ///< Reusable buckets are [first_bucket, end_bucket)
+        int64_t end_bucket = 0;
+        series_map series;
+        size_t points = 0;         ///< Cached values in @c series
+        bool refresh = false;      ///< Caller must store() or abandon()
+    };
+
+    explicit query_result_cache(size_t max_entries) : max_entries_(max_entries) {}
+
+    /**
+     * @brief Cached buckets of [first_bucket, end_bucket) for a query
+     *
+     * Waits while another query refreshes the entry. With lease::refresh
+     * set, the entry does not cover the range yet and the caller must pass
+     * the complete range to store(), or call abandon().
+     */
+    lease acquire(const std::string& key, int64_t first_bucket, int64_t end_bucket, std::chrono::seconds ttl) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        while (it != entries_.end() && it->second.refreshing) {
+            refreshed_.wait(lock);
+            it = entries_.find(key);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (it == entries_.end()) {
+            evict_least_recently_used();
+            it = entries_.emplace(key, entry()).first;
+            it->second.computed = now;
+        } else if (now - it->second.computed >= ttl) {
+            it->second = entry();
+            it->second.computed = now;
+        }
+        auto& cached = it->second;
+        cached.last_used = now;
+
+        lease result;
+        result.first_bucket = std::max(first_bucket, cached.first_bucket);
+        result.end_bucket = std::min(end_bucket, cached.end_bucket);
+        if (result.first_bucket >= result.end_bucket) {
+            result.first_bucket = result.end_bucket = first_bucket;
+        }
+        for (const auto& [key_of_series, series] : cached.series) {
+            auto begin = series.values.lower_bound(result.first_bucket);
+            auto end = series.values.lower_bound(result.end_bucket);
+            if (begin == end) {
+                continue;
+            }
+            auto& copy = result.series[key_of_series];
+            copy.name = series.name;
+            copy.labels = series.labels;
+            copy.values.insert(begin, end);
+            result.points += copy.values.size();
+        }
+
+        result.refresh = cached.first_bucket > first_bucket || cached.end_bucket < end_bucket;
+        cached.refreshing = result.refresh;
+        return result;
+    }
+
+    /**
+     * @brief Replace an entry with the buckets [first_bucket, end_bucket) of @p series
+     */
+    void store(const std::string& key, int64_t first_bucket, int64_t end_bucket, const series_map& series) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            auto& cached = it->second;
+            cached.series.clear();
+            for (const auto& [key_of_series, values] : series) {
+                auto begin = values.values.lower_bound(first_bucket);
+                auto end = values.values.lower_bound(end_bucket);
+                if (begin != end) {
+                    auto& copy = cached.series[key_of_series];
+                    copy.name = values.name;
+                    copy.labels = values.labels;
+                    copy.values.insert(begin, end);
+                }
+            }
+            cached.first_bucket = first_bucket;
+            cached.end_bucket = end_bucket;
+            cached.refreshing = false;
+        }
+        refreshed_.notify_all();
+    }
+
+    /**
+     * @brief Give up a refresh, leaving the entry as it was
+     */
+    void abandon(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            it->second.refreshing = false;
+        }
+        refreshed_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            it = it->second.refreshing ? std::next(it) : entries_.erase(it);
+        }
+    }
+
+private:
+    struct entry {
+        series_map series;
+        int64_t first_bucket = 0;
+        int64_t end_bucket = 0;
+        std::chrono::steady_clock::time_point computed;
+        std::chrono::steady_clock::time_point last_used;
+        bool refreshing = false;
+    };
+
+    size_t max_entries_;
+    mutable std::mutex mutex_;
+    std::condition_variable refreshed_;
+    std::unordered_map<std::string, entry> entries_;
+
+    void evict_least_recently_used() {
+        while (max_entries_ > 0 && entries_.size() >= max_entries_) {
+            auto victim = entries_.end();
+            for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+                if (!it->second.refreshing && (victim == entries_.end() ||
+                                               it->second.last_used < victim->second.last_used)) {
+                    victim = it;
+                }
+            }
+            if (victim == entries_.end()) {
+                return;
+            }
+            entries_.erase(victim);
+        }
+    }
+};
+
+/**
+ * @class metric_query_engine
+ * @brief Parses, optimizes and executes queries against a metric_storage
+ *
+ * Thread-safe; queries run concurrently with each other and with ingestion.
+ */
+class metric_query_engine {
+public:
+    explicit metric_query_engine(const metric_storage& storage, query_hints hints = {})
+        : hints_(std::move(hints)), executor_(storage, hints_), cache_(hints_.cache_max_entries) {}
+
+    /**
+     * @brief Run a query
+     */
+    common::Result<query_result> query(const std::string& query_string) {
+        query_parser parser;
+        auto parsed = parser.parse(query_string);
+        if (parsed.is_err()) {
+            record_failure();
+            return common::Result<query_result>::err(parsed.error());
+        }
+        return run(parsed.value());
+    }
+
+    /**
+     * @brief Describe how a query would be executed
+     */
+    common::Result<std::string> explain(const std::string& query_string) const {
+        query_parser parser;
+        auto parsed = parser.parse(query_string);
+        if (parsed.is_err()) {
+            return common::Result<std::string>::err(parsed.error());
+        }
+        auto plan = optimizer_.optimize(std::move(parsed.value()), hints_, functions(),
+                                        std::chrono::system_clock::now());
+        if (plan.is_err()) {
+            return common::Result<std::string>::err(plan.error());
+        }
+
+        const auto& query = plan.value().optimized_query;
+        std::ostringstream out;
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        for (const auto& item : query.select) {
+            out << "scan " << item.column_name() << " {";
+            for (size_t i = 0; i < item.matchers.size(); ++i) {
+                static constexpr const char* ops[] = {"=", "!=", "=~", "!~", "^="};
+                const auto& m = item.matchers[i];
+                out << (i > 0 ? ", " : "") << m.name << ops[static_cast<int>(m.type)] << '"' << m.value << '"';
+            }
+            out << "}" << (item.use_summaries ? " using chunk summaries" : "") << "\n";
+        }
+        out << "range [" << detail::time_to_seconds(*query.from_time) << ", "
+            << detail::time_to_seconds(*query.to_time) << ")\n";
+        if (query.where_clause) {
+            out << "filter " << to_string(*query.where_clause) << "\n";
+        }
+        if (query.group_by_time || !query.group_by_tags.empty()) {
+            out << "group by";
+            const char* separator = " ";
+            if (query.group_by_time) {
+                out << separator << "time(" << query.group_by_time->count() << "ms)";
+                separator = ", ";
+            }
+            for (const auto& tag : query.group_by_tags) {
+                out << separator << tag;
+                separator = ", ";
+            }
+            out << "\n";
+        }
+        if (query.order_by) {
+            out << "order by " << query.order_by->column << (query.order_by->ascending ? " asc" : " desc") << "\n";
+        }
+        if (query.limit) {
+            out << "limit " << *query.limit << "\n";
+        }
+        for (const auto& optimization : plan.value().optimizations_applied) {
+            out << "optimization: " << optimization << "\n";
+        }
+        return common::Result<std::string>::ok(out.str());
+    }
+
+    /**
+     * @brief Parse a query once for repeated execution
+     * @return Statement id for execute_prepared()
+     *
+     * Relative times such as now() are resolved on each execution.
+     */
+    common::Result<size_t> prepare(const std::string& query_string) {
+        query_parser parser;
+        auto parsed = parser.parse(query_string);
+        if (parsed.is_err()) {
+            return common::Result<size_t>::err(parsed.error());
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        prepared_.push_back(std::move(parsed.value()));
+        return common::Result<size_t>::ok(prepared_.size() - 1);
+    }
+
+    /**
+     * @brief Run a statement returned by prepare()
+     */
+    common::Result<query_result> execute_prepared(size_t statement_id) {
+        parsed_query parsed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (statement_id >= prepared_.size()) {
+                return common::Result<query_result>::err(error_info(monitoring_error_code::not_found,
+                    "Unknown prepared statement " + std::to_string(statement_id), "monitoring_system").to_common_error());
+            }
+            parsed = prepared_[statement_id];
+        }
+        return run(parsed);
+    }
+
+    /**
+     * @brief Make a scalar function callable from WHERE clauses
+     */
+    common::VoidResult register_function(const std::string& name, query_function function) {
+        const std::string lower = detail::to_lower(name);
+        if (lower.empty() || !function || lower == "now" || lower == "abs" ||
+            detail::aggregation_from_name(lower)) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_argument,
+                "Invalid or reserved function name: " + name, "monitoring_system").to_common_error());
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        functions_[lower] = std::move(function);
+        return common::ok();
+    }
+
+    query_stats get_stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    const query_hints& hints() const noexcept { return hints_; }
+
+    /**
+     * @brief Drop cached results, e.g. after backfilling old samples
+     */
+    void clear_cache() { cache_.clear(); }
+
+private:
+    query_hints hints_;
+    query_optimizer optimizer_;
+    query_executor executor_;
+    query_result_cache cache_;
+
+    mutable std::mutex mutex_;
+    query_function_table functions_;
+    std::vector<parsed_query> prepared_;
+    query_stats stats_;
+
+    query_function_table functions() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return functions_;
+    }
+
+    void record_failure() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.total_queries;
+        ++stats_.failed_queries;
+    }
+
+    /**
+     * @brief Whether a query's buckets can be cached: every column is an
+     *        aggregate over GROUP BY time and the filter does not use now()
+     */
+    bool is_cacheable(const parsed_query& query) const {
+        if (!hints_.enable_cache || !query.group_by_time) {
+            return false;
+        }
+        for (const auto& item : query.select) {
+            if (!item.aggregation) {
+                return false;
+            }
+        }
+        std::function<bool(const expression_node&)> uses_now = [&](const expression_node& node) {
+            if (node.type == expression_type::function_call && node.text == "now") {
+                return true;
+            }
+            return std::any_of(node.children.begin(), node.children.end(),
+                               [&](const expression_ptr& child) { return uses_now(*child); });
+        };
+        return !query.where_clause || !uses_now(*query.where_clause);
+    }
+
+    /**
+     * @brief Cache key: the query without its time range, order and limit,
+     *        plus the window length in buckets
+     */
+    static std::string cache_key(const parsed_query& query, int64_t window_buckets) {
+        std::ostringstream key;
+        for (const auto& item : query.select) {
+            auto matchers = item.matchers;
+            std::sort(matchers.begin(), matchers.end(), [](const label_matcher& a, const label_matcher& b) {
+                return std::tie(a.name, a.type, a.value) < std::tie(b.name, b.type, b.value);
+            });
+            key << item.column_name() << (item.use_summaries ? "~" : "") << '{';
+            for (const auto& m : matchers) {
+                key << m.name << static_cast<int>(m.type) << '"' << m.value << "\",";
+            }
+            key << "};";
+        }
+        key << "where " << (query.where_clause ? to_string(*query.where_clause) : "") << ";step "
+            << query.group_by_time->count() << ";by";
+        for (const auto& tag : query.group_by_tags) {
+            key << ' ' << tag;
+        }
+        key << ";window " << window_buckets;
+        return key.str();
+    }
+
+    /**
+     * @brief Add the series of a result to @p merged, keyed by column and group
+     */
+    static void collect(const parsed_query& query, int64_t width, query_result& result,
+                        query_result_cache::series_map& merged) {
+        for (auto& series : result.series) {
+            std::vector<std::string> group;
+            for (const auto& tag : query.group_by_tags) {
+                auto it = std::find_if(series.labels.begin(), series.labels.end(),
+                                       [&tag](const auto& label) { return label.first == tag; });
+                group.push_back(it == series.labels.end() ? std::string() : it->second);
+            }
+            auto& target = merged[{series.column, std::move(group)}];
+            target.name = std::move(series.name);
+            target.labels = std::move(series.labels);
+            for (size_t i = 0; i < series.size(); ++i) {
+                target.values[detail::floor_div(series.timestamps[i].time_since_epoch().count(), width)] =
+                    series.values[i];
+            }
+        }
+    }
+
+    /**
+     * @brief Run a cacheable query, computing only what the cache lacks
+     */
+    common::Result<query_result> run_cached(const parsed_query& query, const query_function_table& functions,
+                                            std::chrono::system_clock::time_point now) {
+        using clock = std::chrono::system_clock;
+        const int64_t width = std::chrono::duration_cast<clock::duration>(*query.group_by_time).count();
+        const int64_t from = query.from_time->time_since_epoch().count();
+        const int64_t to = query.to_time->time_since_epoch().count();
+
+        // Cacheable buckets lie inside the range and ended before now
+        const int64_t first_bucket = -detail::floor_div(-from, width);
+        const int64_t end_bucket = std::min(detail::floor_div(to, width),
+                                            detail::floor_div(now.time_since_epoch().count(), width));
+        if (first_bucket >= end_bucket) {
+            return executor_.execute(query, functions, now);
+        }
+
+        const std::string key = cache_key(query, (to - from + width - 1) / width);
+        auto lease = cache_.acquire(key, first_bucket, end_bucket, hints_.cache_ttl);
+        struct refresh_guard {
+            query_result_cache& cache;
+            const std::string& key;
+            bool active;
+            ~refresh_guard() {
+                if (active) {
+                    cache.abandon(key);
+                }
+            }
+        } guard{cache_, key, lease.refresh};
+
+        query_result result;
+        result.points_from_cache = lease.points;
+        auto merged = std::move(lease.series);
+        parsed_query piece = query;
+        piece.order_by.reset();
+        piece.limit.reset();
+        auto compute = [&](int64_t piece_from, int64_t piece_to) -> common::VoidResult {
+            if (piece_from >= piece_to) {
+                return common::ok();
+            }
+            piece.from_time = clock::time_point(clock::duration(piece_from));
+            piece.to_time = clock::time_point(clock::duration(piece_to));
+            auto computed = executor_.execute(piece, functions, now);
+            if (computed.is_err()) {
+                return common::VoidResult::err(computed.error());
+            }
+            result.series_scanned += computed.value().series_scanned;
+            result.points_scanned += computed.value().points_scanned;
+            result.points_summarized += computed.value().points_summarized;
+            result.scan_tasks += computed.value().scan_tasks;
+            collect(query, width, computed.value(), merged);
+            return common::ok();
+        };
+
+        // Everything, or the head before and the tail after the reused buckets
+        const bool reused = lease.first_bucket < lease.end_bucket;
+        auto computed = compute(from, reused ? lease.first_bucket * width : to);
+        if (computed.is_ok() && reused) {
+            computed = compute(lease.end_bucket * width, to);
+        }
+        if (computed.is_err()) {
+            return common::Result<query_result>::err(computed.error());
+        }
+
+        if (lease.refresh) {
+            cache_.store(key, first_bucket, end_bucket, merged);
+            guard.active = false;
+        }
+
+        for (auto& [series_key, cached] : merged) {
+            query_series series;
+            series.name = std::move(cached.name);
+            series.column = series_key.first;
+            series.labels = std::move(cached.labels);
+            for (const auto& [bucket, value] : cached.values) {
+                series.timestamps.emplace_back(clock::duration(bucket * width));
+                series.values.push_back(value);
+            }
+            query_executor::finish_series(query, series, result);
+        }
+        return common::Result<query_result>::ok(std::move(result));
+    }
+
+    common::Result<query_result> run(const parsed_query& parsed) {
+        const auto started = std::chrono::steady_clock::now();
+        const auto now = std::chrono::system_clock::now();
+        const auto table = functions();
+
+        auto plan = optimizer_.optimize(parsed, hints_, table, now);
+        if (plan.is_err()) {
+            record_failure();
+            return common::Result<query_result>::err(plan.error());
+        }
+        const auto& query = plan.value().optimized_query;
+        auto result = is_cacheable(query) ? run_cached(query, table, now) : executor_.execute(query, table, now);
+        if (result.is_err()) {
+            record_failure();
+            return result;
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.total_queries;
+        stats_.points_scanned += result.value().points_scanned;
+        stats_.points_summarized += result.value().points_summarized;
+        if (is_cacheable(query)) {
+            ++(result.value().points_from_cache > 0 ? stats_.cache_hits : stats_.cache_misses);
+        }
+        stats_.total_execution_time += elapsed;
+        stats_.max_execution_time = std::max(stats_.max_execution_time, elapsed);
+        return result;
+    }
+};
+
+} } // namespace kcenon::monitoring
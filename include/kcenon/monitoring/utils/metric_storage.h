@@ -11,6 +11,8 @@
  *
  * This file provides metric storage implementation that uses ring buffers
  * for efficient incoming metric buffering and time series for historical data.
+ * Optional rollup tiers keep coarser aggregates with longer retention, and
+ * an optional write-ahead log makes stored metrics survive a crash.
  */
 
 #include "../core/result_types.h"
@@ -18,28 +20,71 @@
 #include "metric_types.h"
 #include "time_series.h"
 #include "ring_buffer.h"
+#include "label_index.h"
+#include "../storage/metric_wal.h"
+#include <algorithm>
 #include <string>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
 #include <vector>
 #include <thread>
 
 namespace kcenon { namespace monitoring {
 
+/**
+ * @struct rollup_tier_config
+ * @brief One downsampled retention tier of a metric series
+ *
+ * Raw points are folded into buckets of @c resolution as they are flushed;
+ * each closed bucket keeps its sample-weighted mean, minimum, maximum and
+ * sum, so range extremes stay exact after downsampling.
+ *
+ * A bucket stays open for late samples until a sample more than
+ * @c allowed_late_buckets buckets newer arrives; later samples for it are
+ * dropped and counted in metric_storage_stats::late_rollup_samples_dropped.
+ */
+struct rollup_tier_config {
+    std::chrono::milliseconds resolution{60000};      // Bucket width
+    std::chrono::seconds retention_period{604800};    // How long to keep buckets
+    size_t max_points = 10080;                        // Maximum buckets to keep
+    size_t allowed_late_buckets = 1;                  // Closed buckets still merging late samples
+};
+
 /**
  * @struct metric_storage_config
  * @brief Configuration for metric storage
  */
 struct metric_storage_config {
-    size_t ring_buffer_capacity = 8192;       // Ring buffer capacity (power of 2)
+    size_t ring_buffer_capacity = 8192;       // Ingest buffer slots per shard (power of 2)
+    size_t shard_count = 16;                  // Series map shards (power of 2)
     size_t max_metrics = 10000;               // Maximum number of unique metric series
     bool enable_background_processing = true;  // Enable background flushing
     std::chrono::milliseconds flush_interval{1000}; // Background flush interval
     size_t time_series_max_points = 3600;     // Max points per time series
     std::chrono::seconds retention_period{3600}; // Data retention period
+    std::vector<rollup_tier_config> rollup_tiers;   // Coarser tiers, finest first
+    std::string wal_directory;                // Write-ahead log directory (empty = disabled)
+    std::chrono::milliseconds wal_commit_interval{10}; // WAL group commit durability window
+    bool wal_wait_for_commit = false;         // Return from store calls only once logged durably
+
+    /**
+     * @brief Tiers for 1m aggregates over 7 days and 1h aggregates over 1 year
+     */
+    static std::vector<rollup_tier_config> standard_rollup_tiers() {
+        return {
+            {std::chrono::minutes(1), std::chrono::hours(24 * 7), 7 * 24 * 60},
+            {std::chrono::hours(1), std::chrono::hours(24 * 365), 365 * 24},
+        };
+    }
 
     /**
      * @brief Validate configuration
@@ -50,6 +95,11 @@ struct metric_storage_config {
                              "Ring buffer capacity must be a power of 2").to_common_error());
         }
 
+        if (shard_count == 0 || (shard_count & (shard_count - 1)) != 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                             "Shard count must be a power of 2").to_common_error());
+        }
+
         if (max_metrics == 0) {
             return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
                              "Max metrics must be positive").to_common_error());
@@ -65,6 +115,24 @@ struct metric_storage_config {
                              "Retention period must be positive").to_common_error());
         }
 
+        std::chrono::milliseconds previous{0};
+        for (const auto& tier : rollup_tiers) {
+            if (tier.resolution <= previous) {
+                return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                                 "Rollup tier resolutions must be positive and increasing").to_common_error());
+            }
+            if (tier.retention_period.count() <= 0 || tier.max_points == 0) {
+                return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                                 "Rollup tier retention and max points must be positive").to_common_error());
+            }
+            previous = tier.resolution;
+        }
+
+        if (!wal_directory.empty() && wal_commit_interval.count() <= 0) {
+            return common::VoidResult::err(error_info(monitoring_error_code::invalid_configuration,
+                             "WAL commit interval must be positive").to_common_error());
+        }
+
         return common::ok();
     }
 };
@@ -79,11 +147,32 @@ struct metric_storage_stats {
     std::atomic<size_t> active_metric_series{0};
     std::atomic<size_t> flush_count{0};
     std::atomic<size_t> failed_flushes{0};
+    std::atomic<size_t> late_rollup_samples_dropped{0};  // Samples past a tier's lateness window
+    std::atomic<size_t> unregistered_metrics_dropped{0}; // Batch metrics with no registered name
+    std::atomic<size_t> wal_append_failures{0};          // Buffered metrics the WAL did not accept
+    std::atomic<size_t> wal_commit_failures{0};          // Logged metrics whose WAL frame failed
     std::chrono::system_clock::time_point creation_time;
 
     metric_storage_stats() : creation_time(std::chrono::system_clock::now()) {}
 };
 
+/**
+ * @struct observed_sample
+ * @brief A sample as it is applied to its series, as passed to ingest observers
+ *
+ * The name view is only valid during the observer call.
+ */
+struct observed_sample {
+    std::string_view name;
+    double value = 0.0;
+    std::chrono::system_clock::time_point timestamp;
+};
+
+/**
+ * @brief Receives the samples applied by one flush of one shard
+ */
+using ingest_observer = std::function<void(const std::vector<observed_sample>&)>;
+
 /**
  * @class metric_storage
  * @brief Thread-safe metric storage with ring buffer buffering
@@ -91,53 +180,294 @@ struct metric_storage_stats {
  * Provides efficient metric storage using ring buffers for incoming data
  * and time series for historical queries. Supports background processing
  * for automatic flushing.
+ *
+ * The series map is sharded by metric name hash. Each shard has its own
+ * incoming ring buffer and lock, so ingest and flushes of unrelated metrics
+ * proceed in parallel. A flush holds only the shard's map lock shared, and
+ * exclusively just long enough to create the series of new metrics; each
+ * series then has that flush as its single writer, and queries read its
+ * published chunks without locks (see time_series), so readers are not
+ * blocked by flushes.
+ *
+ * Every shard buffer has ring_buffer_capacity slots, so buffers take
+ * shard_count * ring_buffer_capacity * sizeof(compact_metric_value) bytes
+ * (about 7 MiB with the defaults). A full shard buffer rejects new metrics
+ * with storage_full and counts them in total_metrics_dropped instead of
+ * overwriting the oldest buffered ones, because flushes read buffered
+ * metrics in place. Size ring_buffer_capacity for the ingest rate of one
+ * shard between flushes; the flusher also wakes early once a shard buffer
+ * is half full.
+ *
+ * With rollup tiers configured, every flushed point also updates the open
+ * bucket of each tier, so downsampled history is maintained incrementally
+ * and queries are answered from the coarsest tier matching their step.
+ * Tier queries take a per-series lock that the flush holds only while it
+ * updates that series' buckets.
+ *
+ * With wal_directory set, every buffered metric is also appended to a
+ * metric_wal while its shard buffer slot is claimed, so metrics rejected by
+ * a full buffer are never replayed and metrics the log rejects are never
+ * flushed. The log is group-committed every
+ * wal_commit_interval, and on construction its records are replayed into
+ * the series, so a crash loses at most one durability window (nothing,
+ * with wal_wait_for_commit).
+ *
+ * Ingest observers see every sample as it is flushed into its series, so
+ * derived state such as continuous queries is maintained incrementally.
  */
 class metric_storage {
 private:
-    mutable std::shared_mutex mutex_;
+    /**
+     * @brief Incrementally maintained rollup tier of one metric
+     */
+    struct rollup_state {
+        std::unique_ptr<time_series> series;      // Sample-weighted bucket means
+        std::unique_ptr<time_series> min_series;  // Smallest sample per bucket
+        std::unique_ptr<time_series> max_series;  // Largest sample per bucket
+        std::unique_ptr<time_series> sum_series;  // Sum of samples per bucket
+        int64_t resolution_ticks = 0;
+        int64_t allowed_late_buckets = 0;
+
+        struct open_bucket {
+            int64_t bucket = 0;
+            time_series_summary samples;
+        };
+        std::deque<open_bucket> open;  // Buckets still accepting samples, oldest first
+
+        std::chrono::system_clock::time_point bucket_start(int64_t bucket) const {
+            return std::chrono::system_clock::time_point(
+                std::chrono::system_clock::duration(bucket * resolution_ticks));
+        }
+
+        /**
+         * @return false if the sample fell behind the lateness window and was dropped
+         */
+        bool add(double value, std::chrono::system_clock::time_point timestamp) {
+            const int64_t ticks = timestamp.time_since_epoch().count();
+            int64_t bucket = ticks / resolution_ticks;
+            if (ticks < 0 && ticks % resolution_ticks != 0) {
+                --bucket;
+            }
+
+            if (!open.empty() && bucket < open.back().bucket - allowed_late_buckets) {
+                // Its bucket was already written to the tier series
+                return false;
+            }
+            if (open.empty() || bucket > open.back().bucket) {
+                open.push_back({bucket, {}});
+                while (open.front().bucket < bucket - allowed_late_buckets) {
+                    close_bucket(open.front());
+                    open.pop_front();
+                }
+            }
+
+            auto it = std::lower_bound(open.begin(), open.end(), bucket,
+                                       [](const open_bucket& candidate, int64_t target) {
+                                           return candidate.bucket < target;
+                                       });
+            if (it->bucket != bucket) {
+                it = open.insert(it, open_bucket{bucket, {}});
+            }
+            it->samples.add(ticks, value, 1);
+            return true;
+        }
+
+        void close_bucket(const open_bucket& closed) {
+            const auto start = bucket_start(closed.bucket);
+            const auto samples = static_cast<uint32_t>(closed.samples.samples);
+            series->add_point(time_point_data(start, closed.samples.mean(), samples));
+            min_series->add_point(time_point_data(start, closed.samples.min, samples));
+            max_series->add_point(time_point_data(start, closed.samples.max, samples));
+            sum_series->add_point(time_point_data(start, closed.samples.sum, samples));
+        }
+
+        size_t memory_footprint() const {
+            return series->memory_footprint() + min_series->memory_footprint() +
+                   max_series->memory_footprint() + sum_series->memory_footprint() +
+                   open.size() * sizeof(open_bucket);
+        }
+    };
+
+    /**
+     * @brief Raw series plus its rollup tiers
+     */
+    struct series_entry {
+        std::unique_ptr<time_series> raw;
+        std::vector<rollup_state> rollups;
+        mutable std::mutex rollup_mutex;  // Guards rollups; closing a bucket moves it into the tier series
+
+        /**
+         * @return Number of rollup tiers that dropped the sample as too late
+         */
+        size_t add_point(double value, std::chrono::system_clock::time_point timestamp) {
+            raw->add_point(value, timestamp);
+            if (rollups.empty()) {
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> lock(rollup_mutex);
+            size_t dropped = 0;
+            for (auto& tier : rollups) {
+                dropped += tier.add(value, timestamp) ? 0 : 1;
+            }
+            return dropped;
+        }
+    };
+
+    /**
+     * @brief One partition of the series map, selected by metric name hash
+     *
+     * Each shard has its own incoming ring buffer and lock, so producers and
+     * flushes of metrics in different shards never contend.
+     */
+    struct alignas(64) storage_shard {
+        std::mutex flush_mutex;            // Serializes consumers of incoming, i.e. series writers
+        mutable std::shared_mutex mutex;   // Guards the maps below
+        std::unique_ptr<ring_buffer<compact_metric_value>> incoming;
+
+        // Time series storage for each metric; queries keep an entry alive
+        // while they read it without the lock
+        std::unordered_map<std::string, std::shared_ptr<series_entry>> series;
+
+        // Metric name to hash mapping for fast lookup
+        std::unordered_map<uint32_t, std::string> hash_to_name;
+    };
+
     metric_storage_config config_;
     mutable metric_storage_stats stats_;
 
-    // Ring buffer for incoming metrics
-    std::unique_ptr<ring_buffer<compact_metric_value>> incoming_buffer_;
+    std::vector<std::unique_ptr<storage_shard>> shards_;
+    std::atomic<size_t> series_count_{0};
+    label_index name_index_;  // Series labels (see parse_series_name), for selector lookups
+    mutable std::mutex index_mutex_;
+    std::vector<std::string> index_names_;  // Metric name by name_index_ series id
 
-    // Time series storage for each metric
-    std::unordered_map<std::string, std::unique_ptr<time_series>> time_series_map_;
+    std::unique_ptr<metric_wal> wal_;
 
-    // Metric name to hash mapping for fast lookup
-    std::unordered_map<uint32_t, std::string> hash_to_name_;
+    // Held shared while notifying, so removal waits for running observers
+    mutable std::shared_mutex observers_mutex_;
+    std::vector<std::pair<size_t, ingest_observer>> observers_;
+    size_t next_observer_id_ = 1;
+    std::atomic<bool> has_observers_{false};
 
     // Background processing
     std::atomic<bool> running_{false};
+    std::atomic<bool> flush_requested_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
     std::thread background_thread_;
 
+    storage_shard& shard_for(uint32_t name_hash) const noexcept {
+        return *shards_[name_hash & (shards_.size() - 1)];
+    }
+
     /**
      * @brief Background processing loop
+     *
+     * Wakes every flush_interval, or early when a shard buffer passes half
+     * capacity or the storage is being destroyed.
      */
     void background_processor() {
         while (running_.load(std::memory_order_acquire)) {
-            std::this_thread::sleep_for(config_.flush_interval);
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_cv_.wait_for(lock, config_.flush_interval, [this] {
+                    return !running_.load(std::memory_order_acquire) ||
+                           flush_requested_.load(std::memory_order_acquire);
+                });
+            }
+            flush_requested_.store(false, std::memory_order_release);
             if (running_.load(std::memory_order_acquire)) {
                 flush();
             }
         }
     }
 
+    /**
+     * @brief Ask the background thread to flush once a buffer is half full
+     */
+    void maybe_request_flush(const ring_buffer<compact_metric_value>& buffer) {
+        if (!running_.load(std::memory_order_relaxed) ||
+            buffer.size() < buffer.capacity() / 2 ||
+            flush_requested_.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+
+    /**
+     * @brief Record the name for a hash, taking the exclusive lock only once
+     */
+    void register_name(storage_shard& shard, uint32_t name_hash, const std::string& name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            if (shard.hash_to_name.find(name_hash) != shard.hash_to_name.end()) {
+                return;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.hash_to_name.try_emplace(name_hash, name);
+    }
+
+    /**
+     * @brief Look up the registered name for a hash
+     */
+    static std::optional<std::string> find_name(const storage_shard& shard, uint32_t name_hash) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.hash_to_name.find(name_hash);
+        if (it == shard.hash_to_name.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
     /**
      * @brief Get or create time series for a metric
+     * @note Caller holds the shard's flush mutex and exclusive lock
      */
-    time_series* get_or_create_series(const std::string& name) {
-        auto it = time_series_map_.find(name);
-        if (it != time_series_map_.end()) {
-            return it->second.get();
+    std::shared_ptr<series_entry> get_or_create_series(storage_shard& shard, const std::string& name) {
+        auto it = shard.series.find(name);
+        if (it != shard.series.end()) {
+            return it->second;
         }
 
-        // Check if we're at capacity
-        if (time_series_map_.size() >= config_.max_metrics) {
+        // Reserve a slot against the global limit
+        size_t current = series_count_.load(std::memory_order_relaxed);
+        do {
+            if (current >= config_.max_metrics) {
+                return nullptr;
+            }
+        } while (!series_count_.compare_exchange_weak(current, current + 1,
+                                                      std::memory_order_relaxed));
+
+        auto entry = create_series_entry(name);
+        if (!entry) {
+            series_count_.fetch_sub(1, std::memory_order_relaxed);
             return nullptr;
         }
 
-        // Create new time series
+        shard.series.emplace(name, entry);
+        stats_.active_metric_series.fetch_add(1, std::memory_order_relaxed);
+
+        // Store hash mapping
+        shard.hash_to_name[hash_metric_name(name)] = name;
+        const series_id id = name_index_.add(parse_series_name(name));
+        {
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            if (index_names_.size() <= id) {
+                index_names_.resize(id + 1);
+            }
+            index_names_[id] = name;
+        }
+
+        return entry;
+    }
+
+    /**
+     * @brief Build the raw series and rollup tiers for a new metric
+     */
+    std::shared_ptr<series_entry> create_series_entry(const std::string& name) const {
         time_series_config ts_config;
         ts_config.max_points = config_.time_series_max_points;
         ts_config.retention_period = config_.retention_period;
@@ -147,14 +477,295 @@ private:
             return nullptr;
         }
 
-        auto* ptr = result.value().get();
-        time_series_map_[name] = std::move(result.value());
-        stats_.active_metric_series.fetch_add(1, std::memory_order_relaxed);
+        auto entry = std::make_shared<series_entry>();
+        entry->raw = std::move(result.value());
+
+        for (const auto& tier : config_.rollup_tiers) {
+            time_series_config tier_config;
+            tier_config.max_points = tier.max_points;
+            tier_config.retention_period = tier.retention_period;
+            tier_config.resolution = tier.resolution;
+
+            rollup_state state;
+            for (auto* target : {&state.series, &state.min_series, &state.max_series,
+                                 &state.sum_series}) {
+                auto tier_result = time_series::create(name, tier_config);
+                if (tier_result.is_err()) {
+                    return nullptr;
+                }
+                *target = std::move(tier_result.value());
+            }
+            state.resolution_ticks = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                tier.resolution).count();
+            state.allowed_late_buckets = static_cast<int64_t>(tier.allowed_late_buckets);
+            entry->rollups.push_back(std::move(state));
+        }
 
-        // Store hash mapping
-        hash_to_name_[hash_metric_name(name)] = name;
+        return entry;
+    }
+
+    /**
+     * @brief Write a metric to its shard buffer, logging it first with a WAL
+     * @param lsn Set to the metric's WAL sequence number
+     *
+     * The metric is logged while its buffer slot is claimed but unpublished,
+     * so a full buffer rejects it before it is logged, and a metric the WAL
+     * does not accept leaves only a discarded slot (name hash 0, which no
+     * name has) that flushes skip. A replay thus restores exactly the
+     * metrics reported as stored.
+     */
+    common::VoidResult buffer_metric(storage_shard& shard, const std::string& name,
+                                     compact_metric_value&& metric, uint64_t& lsn) {
+        if (!wal_) {
+            return shard.incoming->write(std::move(metric));
+        }
+        auto log = [&](const compact_metric_value& claimed) -> common::VoidResult {
+            auto logged = wal_->append(name, claimed);
+            if (logged.is_err()) {
+                stats_.wal_append_failures.fetch_add(1, std::memory_order_relaxed);
+                return common::VoidResult::err(logged.error());
+            }
+            lsn = logged.value();
+            return common::ok();
+        };
+        return shard.incoming->write(std::move(metric), log, compact_metric_value());
+    }
+
+    /**
+     * @brief Drain one shard's incoming buffer into its time series
+     * @return true if any buffered metric was applied
+     */
+    bool flush_shard(storage_shard& shard) {
+        // Serializes consumers of the shard buffer, so each series has one writer
+        std::unique_lock<std::mutex> flush_lock(shard.flush_mutex);
+
+        // Apply metrics straight from ring memory; release them afterwards
+        auto pending = shard.incoming->read_batch(shard.incoming->capacity());
+        if (pending.empty()) {
+            return false;
+        }
+
+        // Resolve each name hash once under the shared lock. Names stay put
+        // while flush_mutex is held, since only clear() erases them
+        struct resolved_series {
+            const std::string* name = nullptr;
+            std::shared_ptr<series_entry> entry;
+        };
+        std::unordered_map<uint32_t, resolved_series> resolved;
+        bool has_new_series = false;
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            pending.for_each([&](const compact_metric_value& metric) {
+                auto [it, inserted] = resolved.try_emplace(metric.metadata.name_hash);
+                if (!inserted) {
+                    return;
+                }
+                // Discarded slots (hash 0) and cleared names resolve to no series
+                auto name_it = shard.hash_to_name.find(metric.metadata.name_hash);
+                if (name_it == shard.hash_to_name.end()) {
+                    return;
+                }
+                it->second.name = &name_it->second;
+                auto series_it = shard.series.find(name_it->second);
+                if (series_it == shard.series.end()) {
+                    has_new_series = true;
+                } else {
+                    it->second.entry = series_it->second;
+                }
+            });
+        }
+
+        // Only the first flush of a metric takes the lock exclusively
+        if (has_new_series) {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            for (auto& [name_hash, series] : resolved) {
+                if (series.name != nullptr && !series.entry) {
+                    series.entry = get_or_create_series(shard, *series.name);
+                }
+            }
+        }
+
+        // Queries of this shard read the series while points are appended.
+        // Observers run after the flush mutex is released, so the samples
+        // they get view names copied here once per flush
+        const bool observed = has_observers_.load(std::memory_order_acquire);
+        std::vector<observed_sample> applied;
+        std::deque<std::string> applied_names;
+        std::unordered_map<uint32_t, std::string_view> name_views;
+        pending.for_each([&](const compact_metric_value& metric) {
+            const auto& series = resolved.find(metric.metadata.name_hash)->second;
+            if (series.name == nullptr) {
+                return;
+            }
+            if (!series.entry) {
+                stats_.failed_flushes.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            // Add data point to time series and its rollup tiers
+            count_late_rollup_samples(series.entry->add_point(metric.as_double(), metric.get_timestamp()));
+            if (observed) {
+                auto [view, inserted] = name_views.try_emplace(metric.metadata.name_hash);
+                if (inserted) {
+                    view->second = applied_names.emplace_back(*series.name);
+                }
+                applied.push_back({view->second, metric.as_double(), metric.get_timestamp()});
+            }
+        });
+
+        shard.incoming->commit(pending.size());
+        flush_lock.unlock();
+
+        // Writers and queries of this shard proceed while observers run
+        if (!applied.empty()) {
+            notify_observers(applied);
+        }
+        return true;
+    }
+
+    void count_late_rollup_samples(size_t dropped) {
+        if (dropped > 0) {
+            stats_.late_rollup_samples_dropped.fetch_add(dropped, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Pass flushed samples to the ingest observers
+     * @note Called without the shard lock held
+     */
+    void notify_observers(const std::vector<observed_sample>& applied) const {
+        std::shared_lock<std::shared_mutex> lock(observers_mutex_);
+        for (const auto& [id, observer] : observers_) {
+            observer(applied);
+        }
+    }
+
+    /**
+     * @brief Open the write-ahead log and replay it into the series
+     * @throws std::runtime_error if the log cannot be opened or read
+     */
+    void open_wal() {
+        metric_wal_config wal_config;
+        wal_config.directory = config_.wal_directory;
+        wal_config.commit_interval = config_.wal_commit_interval;
+        wal_config.retention_period = config_.retention_period;
+
+        auto wal = metric_wal::create(wal_config);
+        if (wal.is_err()) {
+            throw std::runtime_error("Cannot open metric WAL: " + wal.error().message);
+        }
+        wal_ = std::move(wal.value());
+
+        auto replayed = wal_->replay([this](const std::string& name, const compact_metric_value& metric) {
+            auto& shard = shard_for(metric.metadata.name_hash);
+            std::lock_guard<std::mutex> flush_lock(shard.flush_mutex);
+            std::shared_ptr<series_entry> series;
+            {
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+                series = get_or_create_series(shard, name);
+            }
+            if (!series) {
+                stats_.failed_flushes.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            count_late_rollup_samples(series->add_point(metric.as_double(), metric.get_timestamp()));
+        });
+        if (replayed.is_err()) {
+            throw std::runtime_error("Cannot replay metric WAL: " + replayed.error().message);
+        }
+    }
+
+    /**
+     * @brief Locate a metric's series
+     *
+     * The shard is read-locked only for the lookup. The returned entry is
+     * read without locks and outlives a concurrent clear().
+     */
+    std::shared_ptr<const series_entry> find_series(const std::string& name) const {
+        const auto& shard = shard_for(hash_metric_name(name));
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.series.find(name);
+        return it == shard.series.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Query one rollup tier, including its still-open buckets
+     *
+     * Open buckets are newer than every bucket already written to the tier
+     * series, so they extend the result in order.
+     * @note Caller holds the entry's rollup_mutex
+     */
+    static common::Result<aggregation_result> query_rollup(const rollup_state& tier,
+                                                           const time_series_query& query) {
+        auto result = tier.series->query(query);
+        if (result.is_err()) {
+            return result;
+        }
+
+        auto& aggregated = result.value();
+        for (const auto& bucket : tier.open) {
+            auto open_start = tier.bucket_start(bucket.bucket);
+            if (open_start < query.start_time || open_start >= query.end_time) {
+                continue;
+            }
 
-        return ptr;
+            time_point_data open_point(open_start, bucket.samples.mean(),
+                                       static_cast<uint32_t>(bucket.samples.samples));
+            auto index = (open_start - query.start_time) / query.step;
+            if (!aggregated.points.empty() &&
+                (aggregated.points.back().timestamp - query.start_time) / query.step == index) {
+                aggregated.points.back().merge(open_point);
+            } else {
+                aggregated.points.push_back(open_point);
+            }
+            aggregated.total_samples += bucket.samples.samples;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Summarize the buckets of one rollup tier that start in
+     *        [start_time, end_time), including its still-open buckets
+     *
+     * count is the number of stored bucket points, first/last values are
+     * bucket means, and min, max, sum and samples are exact over the raw
+     * samples those buckets hold.
+     * @note Caller holds the entry's rollup_mutex
+     */
+    static common::Result<time_series_summary> summarize_rollup(
+        const rollup_state& tier,
+        std::chrono::system_clock::time_point start_time,
+        std::chrono::system_clock::time_point end_time) {
+        auto result = tier.series->summarize(start_time, end_time);
+        if (result.is_err()) {
+            return result;
+        }
+
+        auto& summary = result.value();
+        if (summary.count > 0) {
+            summary.min = tier.min_series->summarize(start_time, end_time).value().min;
+            summary.max = tier.max_series->summarize(start_time, end_time).value().max;
+            summary.sum = 0.0;
+            tier.sum_series->scan(start_time, end_time,
+                [&summary](const int64_t*, const double* values, const uint32_t*, size_t size) {
+                    for (size_t i = 0; i < size; ++i) {
+                        summary.sum += values[i];
+                    }
+                });
+        }
+
+        for (const auto& bucket : tier.open) {
+            auto open_start = tier.bucket_start(bucket.bucket);
+            if (open_start < start_time || open_start >= end_time) {
+                continue;
+            }
+            time_series_summary open_summary = bucket.samples;
+            open_summary.count = 1;
+            open_summary.first_ticks = open_summary.last_ticks = open_start.time_since_epoch().count();
+            open_summary.first_value = open_summary.last_value = bucket.samples.mean();
+            summary.merge(open_summary);
+        }
+        return result;
     }
 
 public:
@@ -162,6 +773,7 @@ public:
      * @brief Constructor with configuration
      * @param config Metric storage configuration options
      * @throws std::invalid_argument if configuration validation fails
+     * @throws std::runtime_error if the write-ahead log cannot be recovered
      */
     explicit metric_storage(const metric_storage_config& config = {})
         : config_(config) {
@@ -172,13 +784,27 @@ public:
                                        validation.error().message);
         }
 
-        // Initialize ring buffer
+        // Initialize one ring buffer per shard, each with the full capacity,
+        // so a workload concentrated on one shard buffers as much as the
+        // single pre-sharding buffer did
         ring_buffer_config rb_config;
         rb_config.capacity = config_.ring_buffer_capacity;
-        rb_config.overwrite_old = true;
-        rb_config.batch_size = (std::min)(rb_config.capacity / 2, size_t(64));
-        if (rb_config.batch_size == 0) rb_config.batch_size = 1;
-        incoming_buffer_ = std::make_unique<ring_buffer<compact_metric_value>>(rb_config);
+        // flush_shard() applies read_batch() views in place, so writers must
+        // not lap the reader; a full shard rejects and counts new metrics
+        // (the single pre-sharding buffer overwrote the oldest instead).
+        rb_config.overwrite_old = false;
+        rb_config.batch_size = (std::max)((std::min)(rb_config.capacity / 2, size_t(64)), size_t(1));
+
+        shards_.reserve(config_.shard_count);
+        for (size_t i = 0; i < config_.shard_count; ++i) {
+            auto shard = std::make_unique<storage_shard>();
+            shard->incoming = std::make_unique<ring_buffer<compact_metric_value>>(rb_config);
+            shards_.push_back(std::move(shard));
+        }
+
+        if (!config_.wal_directory.empty()) {
+            open_wal();
+        }
 
         // Start background processing if enabled
         if (config_.enable_background_processing) {
@@ -192,7 +818,11 @@ public:
      */
     ~metric_storage() {
         if (running_.load(std::memory_order_acquire)) {
-            running_.store(false, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+                running_.store(false, std::memory_order_release);
+            }
+            wake_cv_.notify_one();
             if (background_thread_.joinable()) {
                 background_thread_.join();
             }
@@ -208,89 +838,159 @@ public:
      * @param name Metric name
      * @param value Metric value
      * @param type Metric type (default: gauge)
-     * @return Result indicating success or failure
+     * @return Result indicating whether the metric was stored
+     *
+     * With a WAL, a metric that cannot be logged is not stored either. With
+     * wal_wait_for_commit the call returns once the metric's frame is
+     * written; a failed frame is counted in wal_commit_failures, and the
+     * metric stays stored but is not durable.
      */
     common::VoidResult store_metric(const std::string& name, double value,
                             metric_type type = metric_type::gauge) {
         auto metadata = create_metric_metadata(name, type);
         compact_metric_value metric(metadata, value);
 
-        auto result = incoming_buffer_->write(std::move(metric));
-        if (result.is_ok()) {
-            stats_.total_metrics_stored.fetch_add(1, std::memory_order_relaxed);
+        // Register the name first so a concurrent flush can resolve the metric
+        auto& shard = shard_for(metadata.name_hash);
+        register_name(shard, metadata.name_hash, name);
 
-            // Store name mapping
-            std::unique_lock<std::shared_mutex> lock(mutex_);
-            if (hash_to_name_.find(metadata.name_hash) == hash_to_name_.end()) {
-                hash_to_name_[metadata.name_hash] = name;
-            }
-        } else {
+        uint64_t lsn = 0;
+        auto result = buffer_metric(shard, name, std::move(metric), lsn);
+        if (result.is_err()) {
             stats_.total_metrics_dropped.fetch_add(1, std::memory_order_relaxed);
+            return result;
         }
+        stats_.total_metrics_stored.fetch_add(1, std::memory_order_relaxed);
+        maybe_request_flush(*shard.incoming);
 
+        if (wal_ && config_.wal_wait_for_commit && wal_->wait_for_commit(lsn).is_err()) {
+            stats_.wal_commit_failures.fetch_add(1, std::memory_order_relaxed);
+        }
         return result;
     }
 
+    /**
+     * @brief Register a metric name so batches can carry it by hash alone
+     * @param name Metric name
+     *
+     * store_metric() registers names implicitly; producers that only use
+     * store_metrics_batch() register each name once up front.
+     */
+    void register_metric_name(const std::string& name) {
+        const auto name_hash = hash_metric_name(name);
+        register_name(shard_for(name_hash), name_hash, name);
+    }
+
 
     /**
      * @brief Store a batch of metrics
      * @param batch Metric batch to store
-     * @return Number of metrics successfully stored
+     * @return Number of metrics stored
+     *
+     * Metrics carry only a name hash, so their name must have been
+     * registered by store_metric() or register_metric_name(); others are
+     * rejected and counted in unregistered_metrics_dropped. With a WAL,
+     * metrics that cannot be logged are not stored and are counted in
+     * wal_append_failures. With wal_wait_for_commit the whole batch waits
+     * for a single commit; metrics whose frame failed are counted in
+     * wal_commit_failures but stay stored, as for store_metric().
      */
     size_t store_metrics_batch(const metric_batch& batch) {
         size_t stored = 0;
+        std::vector<uint64_t> lsns;
 
         for (const auto& metric : batch.metrics) {
-            compact_metric_value copy = metric;
-            auto result = incoming_buffer_->write(std::move(copy));
-            if (result.is_ok()) {
-                stored++;
-                stats_.total_metrics_stored.fetch_add(1, std::memory_order_relaxed);
-            } else {
+            auto& shard = shard_for(metric.metadata.name_hash);
+            auto name = find_name(shard, metric.metadata.name_hash);
+            if (!name) {
+                stats_.unregistered_metrics_dropped.fetch_add(1, std::memory_order_relaxed);
                 stats_.total_metrics_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
+
+            uint64_t lsn = 0;
+            auto result = buffer_metric(shard, *name, compact_metric_value(metric), lsn);
+            if (result.is_err()) {
+                stats_.total_metrics_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            stats_.total_metrics_stored.fetch_add(1, std::memory_order_relaxed);
+            maybe_request_flush(*shard.incoming);
+
+            if (wal_) {
+                lsns.push_back(lsn);
+            }
+            stored++;
         }
 
+        if (!lsns.empty() && config_.wal_wait_for_commit) {
+            stats_.wal_commit_failures.fetch_add(wal_->wait_for_commits(lsns), std::memory_order_relaxed);
+        }
         return stored;
     }
 
     /**
      * @brief Flush buffered metrics to time series
+     *
+     * Shards are flushed one at a time. Queries are not blocked while a
+     * shard is applied, except for a new metric's first flush, which
+     * briefly takes its shard's lock exclusively to create the series.
      */
     void flush() {
-        std::vector<compact_metric_value> flushed_metrics;
-        flushed_metrics.reserve(config_.ring_buffer_capacity);
-
-        // Read all available metrics from buffer
-        incoming_buffer_->read_batch(flushed_metrics, config_.ring_buffer_capacity);
-
-        if (flushed_metrics.empty()) {
-            return;
+        bool applied = false;
+        for (auto& shard : shards_) {
+            applied = flush_shard(*shard) || applied;
         }
+        if (applied) {
+            stats_.flush_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 
-        std::unique_lock<std::shared_mutex> lock(mutex_);
-
-        for (auto& metric : flushed_metrics) {
-            // Find metric name from hash
-            auto name_it = hash_to_name_.find(metric.metadata.name_hash);
-            if (name_it == hash_to_name_.end()) {
-                continue;
-            }
+    /**
+     * @brief Register a function called with the samples of every flush
+     * @return Id for remove_ingest_observer()
+     *
+     * Observers run on the flushing thread after the shard lock has been
+     * released, so they may query this storage. Shards flush concurrently,
+     * so an observer must be thread-safe, and batches from concurrent
+     * flushes may arrive out of timestamp order. An observer must not add or
+     * remove observers.
+     */
+    size_t add_ingest_observer(ingest_observer observer) {
+        std::unique_lock<std::shared_mutex> lock(observers_mutex_);
+        const size_t id = next_observer_id_++;
+        observers_.emplace_back(id, std::move(observer));
+        has_observers_.store(true, std::memory_order_release);
+        return id;
+    }
 
-            const std::string& name = name_it->second;
+    /**
+     * @brief Unregister an ingest observer, waiting for running calls
+     */
+    void remove_ingest_observer(size_t id) {
+        std::unique_lock<std::shared_mutex> lock(observers_mutex_);
+        observers_.erase(std::remove_if(observers_.begin(), observers_.end(),
+                                        [id](const auto& entry) { return entry.first == id; }),
+                         observers_.end());
+        has_observers_.store(!observers_.empty(), std::memory_order_release);
+    }
 
-            // Get or create time series
-            auto* series = get_or_create_series(name);
-            if (series == nullptr) {
-                stats_.failed_flushes.fetch_add(1, std::memory_order_relaxed);
-                continue;
-            }
+    /**
+     * @brief Make every metric stored so far durable in the write-ahead log
+     * @return Success immediately when no WAL is configured
+     */
+    common::VoidResult sync_wal() {
+        return wal_ ? wal_->sync() : common::ok();
+    }
 
-            // Add data point to time series
-            series->add_point(metric.as_double(), metric.get_timestamp());
+    /**
+     * @brief Get write-ahead log statistics, if a WAL is configured
+     */
+    std::optional<metric_wal_stats> get_wal_stats() const {
+        if (!wal_) {
+            return std::nullopt;
         }
-
-        stats_.flush_count.fetch_add(1, std::memory_order_relaxed);
+        return wal_->get_stats();
     }
 
     /**
@@ -299,15 +999,13 @@ public:
      * @return Optional containing the latest value if available
      */
     common::Result<double> get_latest_value(const std::string& name) const {
-        std::shared_lock<std::shared_mutex> lock(mutex_);
-
-        auto it = time_series_map_.find(name);
-        if (it == time_series_map_.end()) {
+        const auto entry = find_series(name);
+        if (!entry) {
             return common::Result<double>::err(error_info(monitoring_error_code::collection_failed,
                                       "Metric not found: " + name, "monitoring_system").to_common_error());
         }
 
-        return it->second->get_latest_value();
+        return entry->raw->get_latest_value();
     }
 
     /**
@@ -315,35 +1013,164 @@ public:
      * @return Vector of metric names
      */
     std::vector<std::string> get_metric_names() const {
-        std::shared_lock<std::shared_mutex> lock(mutex_);
-
         std::vector<std::string> names;
-        names.reserve(time_series_map_.size());
+        names.reserve(series_count_.load(std::memory_order_relaxed));
 
-        for (const auto& pair : time_series_map_) {
-            names.push_back(pair.first);
+        for (const auto& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            for (const auto& pair : shard->series) {
+                names.push_back(pair.first);
+            }
         }
 
         return names;
     }
 
+    /**
+     * @brief Names of the metrics matching a selector
+     * @param matchers Matchers on metric_name_label and, for metrics named
+     *        like `requests{service="auth"}`, on their labels; e.g. from
+     *        parse_label_selector("{__name__=~\"cpu_.*\"}")
+     * @return Matching metric names in no particular order
+     */
+    common::Result<std::vector<std::string>> select_metric_names(
+        const std::vector<label_matcher>& matchers) const {
+        auto selected = name_index_.select(matchers);
+        if (selected.is_err()) {
+            return common::Result<std::vector<std::string>>::err(selected.error());
+        }
+
+        std::vector<std::string> names;
+        names.reserve(selected.value().size());
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        for (series_id id : selected.value()) {
+            if (id < index_names_.size()) {
+                names.push_back(index_names_[id]);
+            }
+        }
+        return common::Result<std::vector<std::string>>::ok(std::move(names));
+    }
+
+    /**
+     * @brief Stream the raw points of a metric in [start_time, end_time)
+     * @param args Callbacks (and bucket width), see time_series::scan()
+     *
+     * The scan reads the series without locks, so flushes proceed while the
+     * callbacks run.
+     */
+    template<typename... Args>
+    common::VoidResult scan_metric(const std::string& name,
+                                   std::chrono::system_clock::time_point start_time,
+                                   std::chrono::system_clock::time_point end_time,
+                                   Args&&... args) const {
+        const auto entry = find_series(name);
+        if (!entry) {
+            return common::VoidResult::err(error_info(monitoring_error_code::metric_not_found,
+                                           "Metric not found: " + name, "monitoring_system").to_common_error());
+        }
+        entry->raw->scan(start_time, end_time, std::forward<Args>(args)...);
+        return common::ok();
+    }
+
+    /**
+     * @brief Summarize the raw points of a metric in [start_time, end_time)
+     * @see time_series::summarize()
+     */
+    common::Result<time_series_summary> summarize_metric(const std::string& name,
+                                                         std::chrono::system_clock::time_point start_time,
+                                                         std::chrono::system_clock::time_point end_time) const {
+        const auto entry = find_series(name);
+        if (!entry) {
+            return common::Result<time_series_summary>::err(error_info(monitoring_error_code::metric_not_found,
+                                                            "Metric not found: " + name, "monitoring_system").to_common_error());
+        }
+        return entry->raw->summarize(start_time, end_time);
+    }
+
+    /**
+     * @brief Summarize a metric in [start_time, end_time) from a specific tier
+     * @param tier 0 for raw data, otherwise 1 + index into config.rollup_tiers
+     *
+     * Over a rollup tier, min and max are the extremes of the raw samples in
+     * the covered buckets rather than of the bucket means.
+     * @see summarize_rollup()
+     */
+    common::Result<time_series_summary> summarize_metric(const std::string& name,
+                                                         std::chrono::system_clock::time_point start_time,
+                                                         std::chrono::system_clock::time_point end_time,
+                                                         size_t tier) const {
+        const auto entry = find_series(name);
+        if (!entry) {
+            return common::Result<time_series_summary>::err(error_info(monitoring_error_code::metric_not_found,
+                                                            "Metric not found: " + name, "monitoring_system").to_common_error());
+        }
+        if (tier > entry->rollups.size()) {
+            return common::Result<time_series_summary>::err(error_info(monitoring_error_code::invalid_argument,
+                                                            "Rollup tier out of range", "monitoring_system").to_common_error());
+        }
+        if (tier == 0) {
+            return entry->raw->summarize(start_time, end_time);
+        }
+        std::lock_guard<std::mutex> rollup_lock(entry->rollup_mutex);
+        return summarize_rollup(entry->rollups[tier - 1], start_time, end_time);
+    }
+
+    /**
+     * @brief Select the tier that answers queries with the given step
+     * @param step Query step size
+     * @return 0 for raw data, otherwise 1 + index into config.rollup_tiers
+     *
+     * The coarsest tier whose resolution evenly divides the step is used, so
+     * every step bucket is made of whole rollup buckets.
+     */
+    size_t select_tier(std::chrono::milliseconds step) const noexcept {
+        for (size_t i = config_.rollup_tiers.size(); i > 0; --i) {
+            const auto resolution = config_.rollup_tiers[i - 1].resolution;
+            if (step >= resolution && step % resolution == std::chrono::milliseconds::zero()) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
     /**
      * @brief Query metric data
      * @param name Metric name
      * @param query Query parameters
-     * @return Aggregation result
+     * @return Aggregation result, served from the tier chosen by select_tier()
      */
     common::Result<aggregation_result> query_metric(const std::string& name,
                                             const time_series_query& query) const {
-        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return query_metric(name, query, select_tier(query.step));
+    }
 
-        auto it = time_series_map_.find(name);
-        if (it == time_series_map_.end()) {
+    /**
+     * @brief Query metric data from a specific tier
+     * @param name Metric name
+     * @param query Query parameters
+     * @param tier 0 for raw data, otherwise 1 + index into config.rollup_tiers
+     * @return Aggregation result
+     */
+    common::Result<aggregation_result> query_metric(const std::string& name,
+                                            const time_series_query& query,
+                                            size_t tier) const {
+        const auto entry = find_series(name);
+        if (!entry) {
             return common::Result<aggregation_result>::err(error_info(monitoring_error_code::collection_failed,
                                                  "Metric not found: " + name, "monitoring_system").to_common_error());
         }
 
-        return it->second->query(query);
+        if (tier > entry->rollups.size()) {
+            return common::Result<aggregation_result>::err(error_info(monitoring_error_code::invalid_argument,
+                                                 "Rollup tier out of range", "monitoring_system").to_common_error());
+        }
+
+        if (tier == 0) {
+            return entry->raw->query(query);
+        }
+
+        std::lock_guard<std::mutex> rollup_lock(entry->rollup_mutex);
+        return query_rollup(entry->rollups[tier - 1], query);
     }
 
     /**
@@ -361,13 +1188,25 @@ public:
     }
 
     /**
-     * @brief Clear all stored metrics
+     * @brief Clear all stored metrics, including the write-ahead log
      */
     void clear() {
-        std::unique_lock<std::shared_mutex> lock(mutex_);
-        incoming_buffer_->clear();
-        time_series_map_.clear();
-        hash_to_name_.clear();
+        if (wal_) {
+            (void)wal_->clear();
+        }
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> flush_lock(shard->flush_mutex);
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            shard->incoming->clear();
+            series_count_.fetch_sub(shard->series.size(), std::memory_order_relaxed);
+            shard->series.clear();
+            shard->hash_to_name.clear();
+        }
+        name_index_.clear();
+        {
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            index_names_.clear();
+        }
         stats_.active_metric_series.store(0, std::memory_order_relaxed);
     }
 
@@ -375,22 +1214,28 @@ public:
      * @brief Get number of active metric series
      */
     size_t series_count() const {
-        std::shared_lock<std::shared_mutex> lock(mutex_);
-        return time_series_map_.size();
+        return series_count_.load(std::memory_order_relaxed);
     }
 
     /**
      * @brief Get memory footprint estimate
      */
     size_t memory_footprint() const {
-        std::shared_lock<std::shared_mutex> lock(mutex_);
-
         size_t total = sizeof(metric_storage);
-        total += config_.ring_buffer_capacity * sizeof(compact_metric_value);
 
-        for (const auto& pair : time_series_map_) {
-            total += pair.first.capacity();
-            total += pair.second->memory_footprint();
+        for (const auto& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            total += sizeof(storage_shard);
+            total += shard->incoming->capacity() * sizeof(compact_metric_value);
+
+            for (const auto& pair : shard->series) {
+                total += pair.first.capacity() + sizeof(series_entry);
+                total += pair.second->raw->memory_footprint();
+                std::lock_guard<std::mutex> rollup_lock(pair.second->rollup_mutex);
+                for (const auto& tier : pair.second->rollups) {
+                    total += sizeof(rollup_state) + tier.memory_footprint();
+                }
+            }
         }
 
         return total;
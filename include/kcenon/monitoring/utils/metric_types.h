@@ -31,6 +31,7 @@
 #include "../core/result_types.h"
 #include "../core/error_codes.h"
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <unordered_map>
 #include <variant>
@@ -600,14 +601,15 @@ private:
 /**
  * @brief Hash function for metric names
  */
-inline uint32_t hash_metric_name(const std::string& name) noexcept {
+inline uint32_t hash_metric_name(std::string_view name) noexcept {
     // Simple FNV-1a hash for fast metric name hashing
     uint32_t hash = 2166136261U;
     for (char c : name) {
         hash ^= static_cast<uint32_t>(c);
         hash *= 16777619U;
     }
-    return hash;
+    // 0 never names a metric, so buffers can use it for discarded slots
+    return hash != 0 ? hash : 1;
 }
 
 /**
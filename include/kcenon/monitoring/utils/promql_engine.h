@@ -0,0 +1,1532 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2021-2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file promql_engine.h
+ * @brief PromQL-compatible expressions over metric_storage
+ *
+ * Evaluates the subset of PromQL used by recording and alerting rules:
+ *
+ *     histogram_quantile(0.99, sum by (le) (rate(http_latency_bucket[5m])))
+ *     topk(3, sum without (instance) (increase(requests_total[1h])))
+ *     rate(errors_total[5m]) / ignoring(code) rate(requests_total[5m]) > bool 0.05
+ *
+ * Supported are instant and range vector selectors with `offset`, the
+ * functions rate, irate, increase, delta, idelta, the `*_over_time` family,
+ * histogram_quantile, abs, ceil, floor, sqrt, clamp_min, clamp_max, time,
+ * vector and scalar, the aggregations sum, avg, min, max, count, group,
+ * stddev, stdvar, topk, bottomk and quantile with `by`/`without`, and
+ * arithmetic, comparison (with `bool`) and set operators with one-to-one
+ * `on`/`ignoring` matching. Subqueries, `group_left`/`group_right`, `@` and
+ * native histograms are not supported.
+ *
+ * Semantics follow Prometheus 3: range selectors cover the left-open
+ * interval (t - range, t], instant selectors return the latest sample
+ * within the lookback delta, rate() and increase() add the pre-reset
+ * value on counter resets and extrapolate to the range boundaries, and a
+ * range query is evaluated at start, start + step, ... up to end.
+ *
+ * Series are resolved through the metric_storage label index, so metrics
+ * named like `http_requests_total{code="500",method="GET"}` carry their
+ * labels. Every selector decodes the chunks of its series once per query
+ * and each evaluation step works on that data by binary search.
+ */
+
+#include "../core/result_types.h"
+#include "../core/error_codes.h"
+#include "label_index.h"
+#include "metric_query_engine.h"
+#include "metric_storage.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @enum promql_value_type
+ * @brief Static type of a PromQL expression
+ */
+enum class promql_value_type {
+    scalar,
+    string,
+    instant_vector,
+    range_vector
+};
+
+inline const char* to_string(promql_value_type type) noexcept {
+    switch (type) {
+        case promql_value_type::scalar: return "scalar";
+        case promql_value_type::string: return "string";
+        case promql_value_type::instant_vector: return "instant vector";
+        case promql_value_type::range_vector: return "range vector";
+    }
+    return "unknown";
+}
+
+/**
+ * @enum promql_node_type
+ * @brief Kinds of PromQL expression nodes
+ */
+enum class promql_node_type {
+    number_literal,
+    string_literal,
+    vector_selector,
+    matrix_selector,
+    function_call,
+    aggregation,
+    binary_op,
+    unary_minus
+};
+
+struct promql_node;
+using promql_node_ptr = std::shared_ptr<const promql_node>;
+
+/**
+ * @struct promql_node
+ * @brief Type-checked PromQL expression tree node
+ */
+struct promql_node {
+    promql_node_type type = promql_node_type::number_literal;
+    promql_value_type value_type = promql_value_type::scalar;
+    double number = 0.0;
+    std::string text;                      ///< Function, aggregation or operator name; string value
+    std::vector<label_matcher> matchers;   ///< Selectors
+    std::chrono::milliseconds range{0};    ///< Matrix selectors
+    std::chrono::milliseconds offset{0};   ///< Selectors
+    std::vector<promql_node_ptr> children; ///< Arguments; aggregation parameter then operand; binary operands
+    std::vector<std::string> grouping;     ///< by/without labels of aggregations, on/ignoring labels of binary ops
+    bool without = false;                  ///< Aggregation grouping lists the dropped labels
+    bool return_bool = false;              ///< Comparison returns 0/1 instead of filtering
+    bool matching_on = false;              ///< Binary operands match on(grouping) rather than ignoring(grouping)
+};
+
+/**
+ * @struct promql_options
+ * @brief Evaluation options of promql_engine
+ */
+struct promql_options {
+    std::chrono::milliseconds lookback_delta{300000};  ///< Staleness window of instant selectors
+    size_t max_steps = 11000;                          ///< Largest number of range query steps
+};
+
+namespace detail {
+
+/**
+ * @brief Signature of a supported PromQL function
+ */
+struct promql_function_signature {
+    std::vector<promql_value_type> arguments;
+    promql_value_type result;
+};
+
+inline const std::unordered_map<std::string, promql_function_signature>& promql_functions() {
+    using t = promql_value_type;
+    static const std::unordered_map<std::string, promql_function_signature> functions = {
+        {"rate", {{t::range_vector}, t::instant_vector}},
+        {"irate", {{t::range_vector}, t::instant_vector}},
+        {"increase", {{t::range_vector}, t::instant_vector}},
+        {"delta", {{t::range_vector}, t::instant_vector}},
+        {"idelta", {{t::range_vector}, t::instant_vector}},
+        {"avg_over_time", {{t::range_vector}, t::instant_vector}},
+        {"sum_over_time", {{t::range_vector}, t::instant_vector}},
+        {"min_over_time", {{t::range_vector}, t::instant_vector}},
+        {"max_over_time", {{t::range_vector}, t::instant_vector}},
+        {"count_over_time", {{t::range_vector}, t::instant_vector}},
+        {"last_over_time", {{t::range_vector}, t::instant_vector}},
+        {"stddev_over_time", {{t::range_vector}, t::instant_vector}},
+        {"stdvar_over_time", {{t::range_vector}, t::instant_vector}},
+        {"quantile_over_time", {{t::scalar, t::range_vector}, t::instant_vector}},
+        {"histogram_quantile", {{t::scalar, t::instant_vector}, t::instant_vector}},
+        {"abs", {{t::instant_vector}, t::instant_vector}},
+        {"ceil", {{t::instant_vector}, t::instant_vector}},
+        {"floor", {{t::instant_vector}, t::instant_vector}},
+        {"sqrt", {{t::instant_vector}, t::instant_vector}},
+        {"clamp_min", {{t::instant_vector, t::scalar}, t::instant_vector}},
+        {"clamp_max", {{t::instant_vector, t::scalar}, t::instant_vector}},
+        {"time", {{}, t::scalar}},
+        {"vector", {{t::scalar}, t::instant_vector}},
+        {"scalar", {{t::instant_vector}, t::scalar}},
+    };
+    return functions;
+}
+
+inline bool is_promql_aggregation(const std::string& name) {
+    static const std::set<std::string> aggregations = {
+        "sum", "avg", "min", "max", "count", "group", "stddev", "stdvar", "topk", "bottomk", "quantile"};
+    return aggregations.count(name) > 0;
+}
+
+inline bool is_promql_comparison(const std::string& op) {
+    return op == "==" || op == "!=" || op == ">" || op == "<" || op == ">=" || op == "<=";
+}
+
+inline bool is_promql_set_operator(const std::string& op) {
+    return op == "and" || op == "or" || op == "unless";
+}
+
+inline double promql_arithmetic(const std::string& op, double a, double b) {
+    switch (op[0]) {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        case '/': return a / b;
+        case '%': return std::fmod(a, b);
+        case '^': return std::pow(a, b);
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+inline bool promql_compare(const std::string& op, double a, double b) {
+    if (op == "==") return a == b;
+    if (op == "!=") return a != b;
+    if (op == ">") return a > b;
+    if (op == "<") return a < b;
+    if (op == ">=") return a >= b;
+    return a <= b;
+}
+
+/**
+ * @brief Interpolated quantile of unsorted values, as quantile() and
+ *        quantile_over_time()
+ */
+inline double promql_quantile(double q, std::vector<double> values) {
+    if (values.empty() || std::isnan(q)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (q < 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    if (q > 1) {
+        return std::numeric_limits<double>::infinity();
+    }
+    std::sort(values.begin(), values.end());
+    const double rank = q * static_cast<double>(values.size() - 1);
+    const size_t lower = static_cast<size_t>(std::floor(rank));
+    const size_t upper = std::min(values.size() - 1, lower + 1);
+    const double weight = rank - std::floor(rank);
+    return values[lower] * (1 - weight) + values[upper] * weight;
+}
+
+/**
+ * @brief rate(), increase() and delta() over the samples of one range
+ *
+ * Counters add the value before each reset. The result is extrapolated to
+ * the range boundaries when the first or last sample is within 110% of the
+ * average sample interval of them, and by half an interval otherwise;
+ * counters are never extrapolated below zero.
+ */
+inline std::optional<double> promql_extrapolated_rate(const int64_t* ticks, const double* values, size_t n,
+                                                      int64_t range_start, int64_t range_end,
+                                                      bool is_counter, bool is_rate) {
+    if (n < 2) {
+        return std::nullopt;
+    }
+
+    double result = values[n - 1] - values[0];
+    if (is_counter) {
+        for (size_t i = 1; i < n; ++i) {
+            if (values[i] < values[i - 1]) {
+                result += values[i - 1];
+            }
+        }
+    }
+
+    double duration_to_start = ticks_to_seconds(ticks[0] - range_start);
+    double duration_to_end = ticks_to_seconds(range_end - ticks[n - 1]);
+    const double sampled_interval = ticks_to_seconds(ticks[n - 1] - ticks[0]);
+    const double average_interval = sampled_interval / static_cast<double>(n - 1);
+    const double threshold = average_interval * 1.1;
+
+    if (duration_to_start >= threshold) {
+        duration_to_start = average_interval / 2;
+    }
+    if (is_counter && result > 0 && values[0] >= 0) {
+        const double duration_to_zero = sampled_interval * (values[0] / result);
+        duration_to_start = std::min(duration_to_start, duration_to_zero);
+    }
+    if (duration_to_end >= threshold) {
+        duration_to_end = average_interval / 2;
+    }
+
+    double factor = (sampled_interval + duration_to_start + duration_to_end) / sampled_interval;
+    if (is_rate) {
+        factor /= ticks_to_seconds(range_end - range_start);
+    }
+    return result * factor;
+}
+
+/**
+ * @brief irate() and idelta() from the last two samples of one range
+ */
+inline std::optional<double> promql_instant_rate(const int64_t* ticks, const double* values, size_t n,
+                                                 bool is_rate) {
+    if (n < 2) {
+        return std::nullopt;
+    }
+    const double last = values[n - 1];
+    const double previous = values[n - 2];
+    const double interval = ticks_to_seconds(ticks[n - 1] - ticks[n - 2]);
+    if (interval == 0) {
+        return std::nullopt;
+    }
+    if (!is_rate) {
+        return last - previous;
+    }
+    // A reset restarts the counter from zero
+    return (last < previous ? last : last - previous) / interval;
+}
+
+/**
+ * @brief Quantile of a classic histogram given (upper bound, cumulative
+ *        count) buckets, as histogram_quantile()
+ */
+inline double promql_bucket_quantile(double q, std::vector<std::pair<double, double>> buckets) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if (std::isnan(q)) {
+        return nan;
+    }
+    if (q < 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    if (q > 1) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    std::sort(buckets.begin(), buckets.end());
+    if (buckets.empty() || !std::isinf(buckets.back().first) || buckets.back().first < 0) {
+        return nan;
+    }
+
+    // Buckets with the same bound are summed, and counts are forced to be
+    // monotonic to absorb scrapes that raced with observations
+    std::vector<std::pair<double, double>> merged;
+    for (const auto& bucket : buckets) {
+        if (!merged.empty() && merged.back().first == bucket.first) {
+            merged.back().second += bucket.second;
+        } else {
+            merged.push_back(bucket);
+        }
+    }
+    for (size_t i = 1; i < merged.size(); ++i) {
+        merged[i].second = std::max(merged[i].second, merged[i - 1].second);
+    }
+    if (merged.size() < 2) {
+        return nan;
+    }
+
+    const double observations = merged.back().second;
+    if (observations == 0) {
+        return nan;
+    }
+    double rank = q * observations;
+    const size_t b = static_cast<size_t>(std::lower_bound(merged.begin(), merged.end() - 1, rank,
+        [](const std::pair<double, double>& bucket, double r) { return bucket.second < r; }) - merged.begin());
+
+    if (b == merged.size() - 1) {
+        return merged[merged.size() - 2].first;
+    }
+    if (b == 0 && merged[0].first <= 0) {
+        return merged[0].first;
+    }
+
+    double bucket_start = 0;
+    const double bucket_end = merged[b].first;
+    double count = merged[b].second;
+    if (b > 0) {
+        bucket_start = merged[b - 1].first;
+        count -= merged[b - 1].second;
+        rank -= merged[b - 1].second;
+    }
+    return bucket_start + (bucket_end - bucket_start) * (rank / count);
+}
+
+inline label_set promql_drop_name(label_set labels) {
+    labels.erase(std::remove_if(labels.begin(), labels.end(),
+                                [](const auto& label) { return label.first == metric_name_label; }),
+                 labels.end());
+    return labels;
+}
+
+/**
+ * @brief Labels kept (keep == true) or dropped by a label list; dropping
+ *        always removes __name__
+ */
+inline label_set promql_filter_labels(const label_set& labels, const std::vector<std::string>& names, bool keep) {
+    label_set result;
+    for (const auto& label : labels) {
+        const bool listed = std::find(names.begin(), names.end(), label.first) != names.end();
+        if (keep ? listed : (!listed && label.first != metric_name_label)) {
+            result.push_back(label);
+        }
+    }
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @class promql_parser
+ * @brief Recursive descent parser and type checker for PromQL expressions
+ */
+class promql_parser {
+public:
+    /**
+     * @brief Parse an expression
+     * @return Expression tree, or invalid_argument with the offending position
+     */
+    common::Result<promql_node_ptr> parse(const std::string& expression) {
+        tokens_.clear();
+        pos_ = 0;
+        error_.clear();
+
+        promql_node_ptr root;
+        if (tokenize(expression)) {
+            root = parse_binary(0);
+            if (root && peek().type != token_type::end) {
+                fail("Unexpected '" + peek().text + "'");
+                root.reset();
+            }
+        }
+        if (!root) {
+            return common::Result<promql_node_ptr>::err(
+                error_info(monitoring_error_code::invalid_argument, error_, "monitoring_system").to_common_error());
+        }
+        return common::Result<promql_node_ptr>::ok(std::move(root));
+    }
+
+private:
+    enum class token_type {
+        identifier, number, duration, string, selector, op,
+        lparen, rparen, lbracket, rbracket, comma, end
+    };
+
+    struct token {
+        token_type type = token_type::end;
+        std::string text;
+        double number = 0.0;
+        int64_t milliseconds = 0;
+        size_t position = 0;
+    };
+
+    std::vector<token> tokens_;
+    size_t pos_ = 0;
+    std::string error_;
+
+    std::nullptr_t fail(const std::string& message) {
+        if (error_.empty()) {
+            error_ = message + " at position " + std::to_string(tokens_.empty() ? 0 : peek().position);
+        }
+        return nullptr;
+    }
+
+    const token& peek(size_t ahead = 0) const {
+        return tokens_[std::min(pos_ + ahead, tokens_.size() - 1)];
+    }
+
+    bool accept(token_type type) {
+        if (peek().type == type) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool accept_keyword(const char* keyword) {
+        if (peek().type == token_type::identifier && detail::to_lower(peek().text) == keyword) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool expect(token_type type, const char* what) {
+        if (accept(type)) {
+            return true;
+        }
+        fail(std::string("Expected ") + what);
+        return false;
+    }
+
+    bool tokenize(const std::string& text) {
+        static const std::vector<std::pair<std::string, int64_t>> units = {
+            {"ms", 1}, {"s", 1000}, {"m", 60000}, {"h", 3600000},
+            {"d", 86400000}, {"w", 604800000}, {"y", 31536000000},
+        };
+        auto is_name_char = [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == ':';
+        };
+        auto error_at = [this](const std::string& message, size_t position) {
+            error_ = message + " at position " + std::to_string(position);
+            return false;
+        };
+
+        size_t i = 0;
+        while (i < text.size()) {
+            const char c = text[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+                continue;
+            }
+            if (c == '#') {
+                while (i < text.size() && text[i] != '\n') {
+                    ++i;
+                }
+                continue;
+            }
+
+            token tok;
+            tok.position = i;
+            const char next = i + 1 < text.size() ? text[i + 1] : '\0';
+            if (std::isdigit(static_cast<unsigned char>(c)) ||
+                (c == '.' && std::isdigit(static_cast<unsigned char>(next)))) {
+                char* end = nullptr;
+                tok.number = std::strtod(text.c_str() + i, &end);
+                const size_t number_end = static_cast<size_t>(end - text.c_str());
+                if (number_end < text.size() && std::isalpha(static_cast<unsigned char>(text[number_end]))) {
+                    // Durations are integers with units, possibly chained as in 1h30m
+                    size_t j = i;
+                    while (j < text.size() && std::isdigit(static_cast<unsigned char>(text[j]))) {
+                        int64_t amount = 0;
+                        while (j < text.size() && std::isdigit(static_cast<unsigned char>(text[j]))) {
+                            amount = amount * 10 + (text[j++] - '0');
+                        }
+                        size_t unit_end = j;
+                        while (unit_end < text.size() && std::isalpha(static_cast<unsigned char>(text[unit_end]))) {
+                            ++unit_end;
+                        }
+                        const std::string unit = text.substr(j, unit_end - j);
+                        auto found = std::find_if(units.begin(), units.end(),
+                                                  [&unit](const auto& u) { return u.first == unit; });
+                        if (found == units.end()) {
+                            return error_at("Invalid duration unit '" + unit + "'", j);
+                        }
+                        tok.milliseconds += amount * found->second;
+                        j = unit_end;
+                    }
+                    if (j < text.size() && (is_name_char(text[j]) || text[j] == '.')) {
+                        return error_at("Invalid duration", i);
+                    }
+                    tok.type = token_type::duration;
+                    tok.text = text.substr(i, j - i);
+                    i = j;
+                } else {
+                    tok.type = token_type::number;
+                    tok.text = text.substr(i, number_end - i);
+                    i = number_end;
+                }
+            } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == ':') {
+                size_t end = i;
+                while (end < text.size() && is_name_char(text[end])) {
+                    ++end;
+                }
+                tok.type = token_type::identifier;
+                tok.text = text.substr(i, end - i);
+                i = end;
+            } else if (c == '"' || c == '\'' || c == '`') {
+                ++i;
+                while (i < text.size() && text[i] != c) {
+                    if (text[i] == '\\' && c != '`' && i + 1 < text.size()) {
+                        ++i;
+                        tok.text += text[i] == 'n' ? '\n' : text[i] == 't' ? '\t' : text[i];
+                        ++i;
+                        continue;
+                    }
+                    tok.text += text[i++];
+                }
+                if (i == text.size()) {
+                    return error_at("Unterminated string", tok.position);
+                }
+                ++i;
+                tok.type = token_type::string;
+            } else if (c == '{') {
+                // The matcher list is handed to parse_label_selector() whole
+                char quote = '\0';
+                size_t end = i + 1;
+                for (; end < text.size(); ++end) {
+                    if (quote != '\0') {
+                        if (text[end] == '\\' && quote != '`') {
+                            ++end;
+                        } else if (text[end] == quote) {
+                            quote = '\0';
+                        }
+                    } else if (text[end] == '"' || text[end] == '\'' || text[end] == '`') {
+                        quote = text[end];
+                    } else if (text[end] == '}') {
+                        break;
+                    }
+                }
+                if (end >= text.size()) {
+                    return error_at("Unterminated label matchers", tok.position);
+                }
+                tok.type = token_type::selector;
+                tok.text = text.substr(i, end + 1 - i);
+                i = end + 1;
+            } else {
+                static const char* const operators[] = {
+                    "==", "!=", ">=", "<=", "+", "-", "*", "/", "%", "^", ">", "<"};
+                auto single = [&](token_type type) {
+                    tok.type = type;
+                    tok.text = std::string(1, c);
+                    ++i;
+                };
+                switch (c) {
+                    case '(': single(token_type::lparen); break;
+                    case ')': single(token_type::rparen); break;
+                    case '[': single(token_type::lbracket); break;
+                    case ']': single(token_type::rbracket); break;
+                    case ',': single(token_type::comma); break;
+                    default: {
+                        for (const char* op : operators) {
+                            if (text.compare(i, std::char_traits<char>::length(op), op) == 0) {
+                                tok.type = token_type::op;
+                                tok.text = op;
+                                break;
+                            }
+                        }
+                        if (tok.type != token_type::op) {
+                            return error_at(std::string("Unexpected character '") + c + "'", i);
+                        }
+                        i += tok.text.size();
+                    }
+                }
+            }
+            tokens_.push_back(std::move(tok));
+        }
+
+        token end;
+        end.position = text.size();
+        tokens_.push_back(end);
+        return true;
+    }
+
+    /**
+     * @brief Binary operator at the cursor and its precedence, lowest first
+     */
+    std::optional<std::pair<std::string, int>> peek_operator() const {
+        const token& tok = peek();
+        if (tok.type == token_type::op) {
+            const std::string& op = tok.text;
+            if (op == "^") return std::make_pair(op, 6);
+            if (op == "*" || op == "/" || op == "%") return std::make_pair(op, 5);
+            if (op == "+" || op == "-") return std::make_pair(op, 4);
+            return std::make_pair(op, 3);
+        }
+        if (tok.type == token_type::identifier) {
+            const std::string keyword = detail::to_lower(tok.text);
+            if (keyword == "and" || keyword == "unless") return std::make_pair(keyword, 2);
+            if (keyword == "or") return std::make_pair(keyword, 1);
+        }
+        return std::nullopt;
+    }
+
+    promql_node_ptr parse_binary(int min_precedence) {
+        auto lhs = parse_unary();
+        while (lhs) {
+            auto op = peek_operator();
+            if (!op || op->second < min_precedence) {
+                break;
+            }
+            ++pos_;
+
+            auto node = std::make_shared<promql_node>();
+            node->type = promql_node_type::binary_op;
+            node->text = op->first;
+            if (accept_keyword("bool")) {
+                if (!detail::is_promql_comparison(node->text)) {
+                    return fail("bool modifier on non-comparison operator " + node->text);
+                }
+                node->return_bool = true;
+            }
+            const bool on = accept_keyword("on");
+            if (on || accept_keyword("ignoring")) {
+                node->matching_on = on;
+                if (!parse_label_list(node->grouping)) {
+                    return nullptr;
+                }
+            }
+            if (accept_keyword("group_left") || accept_keyword("group_right")) {
+                return fail("Many-to-one matching is not supported");
+            }
+
+            // ^ is right associative
+            auto rhs = parse_binary(op->first == "^" ? op->second : op->second + 1);
+            if (!rhs) {
+                return nullptr;
+            }
+            node->children = {lhs, rhs};
+            lhs = check_binary(node);
+        }
+        return lhs;
+    }
+
+    promql_node_ptr check_binary(const std::shared_ptr<promql_node>& node) {
+        const auto lhs = node->children[0]->value_type;
+        const auto rhs = node->children[1]->value_type;
+        auto operand = [](promql_value_type type) {
+            return type == promql_value_type::scalar || type == promql_value_type::instant_vector;
+        };
+        if (!operand(lhs) || !operand(rhs)) {
+            return fail("Binary operator " + node->text + " needs scalar or instant vector operands, got " +
+                        to_string(lhs) + " and " + to_string(rhs));
+        }
+        const bool vectors = lhs == promql_value_type::instant_vector && rhs == promql_value_type::instant_vector;
+        if (detail::is_promql_set_operator(node->text) && !vectors) {
+            return fail("Set operator " + node->text + " needs instant vector operands");
+        }
+        if (!node->grouping.empty() && !vectors) {
+            return fail("Vector matching needs instant vector operands");
+        }
+        const bool scalars = lhs == promql_value_type::scalar && rhs == promql_value_type::scalar;
+        if (scalars && detail::is_promql_comparison(node->text) && !node->return_bool) {
+            return fail("Comparisons between scalars must use the bool modifier");
+        }
+        node->value_type = scalars ? promql_value_type::scalar : promql_value_type::instant_vector;
+        return node;
+    }
+
+    promql_node_ptr parse_unary() {
+        if (peek().type == token_type::op && (peek().text == "-" || peek().text == "+")) {
+            const bool negate = peek().text == "-";
+            ++pos_;
+            // Unary minus binds looser than ^, so -2^2 is -4
+            auto operand = parse_binary(6);
+            if (!operand || !negate) {
+                return operand;
+            }
+            if (operand->value_type != promql_value_type::scalar &&
+                operand->value_type != promql_value_type::instant_vector) {
+                return fail("Unary minus needs a scalar or instant vector");
+            }
+            if (operand->type == promql_node_type::number_literal) {
+                auto literal = std::make_shared<promql_node>(*operand);
+                literal->number = -literal->number;
+                return literal;
+            }
+            auto node = std::make_shared<promql_node>();
+            node->type = promql_node_type::unary_minus;
+            node->value_type = operand->value_type;
+            node->children = {operand};
+            return node;
+        }
+        return parse_postfix(parse_primary());
+    }
+
+    promql_node_ptr parse_postfix(promql_node_ptr node) {
+        while (node) {
+            if (accept(token_type::lbracket)) {
+                if (node->type != promql_node_type::vector_selector || node->offset.count() != 0) {
+                    return fail("Ranges are only allowed on vector selectors");
+                }
+                if (peek().type != token_type::duration) {
+                    return fail("Expected range duration");
+                }
+                auto matrix = std::make_shared<promql_node>(*node);
+                matrix->type = promql_node_type::matrix_selector;
+                matrix->value_type = promql_value_type::range_vector;
+                matrix->range = std::chrono::milliseconds(peek().milliseconds);
+                ++pos_;
+                if (peek().type == token_type::identifier && peek().text.rfind(':', 0) == 0) {
+                    return fail("Subqueries are not supported");
+                }
+                if (!expect(token_type::rbracket, "']'")) {
+                    return nullptr;
+                }
+                if (matrix->range.count() <= 0) {
+                    return fail("Range must be positive");
+                }
+                node = matrix;
+            } else if (accept_keyword("offset")) {
+                if (node->type != promql_node_type::vector_selector &&
+                    node->type != promql_node_type::matrix_selector) {
+                    return fail("offset is only allowed on selectors");
+                }
+                const bool negative = peek().type == token_type::op && peek().text == "-";
+                if (negative) {
+                    ++pos_;
+                }
+                if (peek().type != token_type::duration) {
+                    return fail("Expected offset duration");
+                }
+                auto shifted = std::make_shared<promql_node>(*node);
+                shifted->offset = std::chrono::milliseconds(negative ? -peek().milliseconds : peek().milliseconds);
+                ++pos_;
+                node = shifted;
+            } else {
+                break;
+            }
+        }
+        return node;
+    }
+
+    promql_node_ptr parse_primary() {
+        const token& tok = peek();
+        switch (tok.type) {
+            case token_type::number: {
+                ++pos_;
+                auto node = std::make_shared<promql_node>();
+                node->number = tok.number;
+                return node;
+            }
+            case token_type::string: {
+                ++pos_;
+                auto node = std::make_shared<promql_node>();
+                node->type = promql_node_type::string_literal;
+                node->value_type = promql_value_type::string;
+                node->text = tok.text;
+                return node;
+            }
+            case token_type::lparen: {
+                ++pos_;
+                auto inner = parse_binary(0);
+                if (!inner || !expect(token_type::rparen, "')'")) {
+                    return nullptr;
+                }
+                return inner;
+            }
+            case token_type::selector:
+                return parse_selector("");
+            case token_type::identifier:
+                break;
+            default:
+                return fail(tok.type == token_type::end ? "Unexpected end of expression"
+                                                        : "Unexpected '" + tok.text + "'");
+        }
+
+        const std::string lower = detail::to_lower(tok.text);
+        if (lower == "inf" || lower == "nan") {
+            ++pos_;
+            auto node = std::make_shared<promql_node>();
+            node->number = lower == "inf" ? std::numeric_limits<double>::infinity()
+                                          : std::numeric_limits<double>::quiet_NaN();
+            return node;
+        }
+        const token_type after = peek(1).type;
+        const bool grouping_follows = peek(1).type == token_type::identifier &&
+            (detail::to_lower(peek(1).text) == "by" || detail::to_lower(peek(1).text) == "without");
+        if (detail::is_promql_aggregation(lower) && (after == token_type::lparen || grouping_follows)) {
+            return parse_aggregation();
+        }
+        if (after == token_type::lparen) {
+            return parse_function();
+        }
+        ++pos_;
+        return parse_selector(tok.text);
+    }
+
+    promql_node_ptr parse_selector(const std::string& metric) {
+        std::string text = metric;
+        if (peek().type == token_type::selector) {
+            text += peek().text;
+            ++pos_;
+        }
+        auto matchers = parse_label_selector(text);
+        if (matchers.is_err()) {
+            return fail(matchers.error().message);
+        }
+        // As in Prometheus, some matcher must reject the empty label value
+        auto matches_empty = [](const label_matcher& m) {
+            switch (m.type) {
+                case label_match_type::equal:
+                case label_match_type::prefix:
+                    return m.value.empty();
+                case label_match_type::not_equal:
+                    return !m.value.empty();
+                default:
+                    try {
+                        return std::regex_match("", std::regex(m.value)) == (m.type == label_match_type::regex);
+                    } catch (const std::regex_error&) {
+                        return false;
+                    }
+            }
+        };
+        const auto& list = matchers.value();
+        if (std::all_of(list.begin(), list.end(), matches_empty)) {
+            return fail("Vector selector must contain at least one non-empty matcher");
+        }
+
+        auto node = std::make_shared<promql_node>();
+        node->type = promql_node_type::vector_selector;
+        node->value_type = promql_value_type::instant_vector;
+        node->text = text;
+        node->matchers = std::move(matchers.value());
+        return node;
+    }
+
+    bool parse_label_list(std::vector<std::string>& labels) {
+        if (!expect(token_type::lparen, "'('")) {
+            return false;
+        }
+        while (!accept(token_type::rparen)) {
+            if (peek().type != token_type::identifier) {
+                fail("Expected label name");
+                return false;
+            }
+            labels.push_back(peek().text);
+            ++pos_;
+            if (!accept(token_type::comma) && peek().type != token_type::rparen) {
+                fail("Expected ',' or ')'");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parse_grouping(promql_node& node, bool& seen) {
+        const bool by = accept_keyword("by");
+        if (!by && !accept_keyword("without")) {
+            return true;
+        }
+        if (seen) {
+            fail("Aggregation has more than one grouping clause");
+            return false;
+        }
+        seen = true;
+        node.without = !by;
+        return parse_label_list(node.grouping);
+    }
+
+    promql_node_ptr parse_aggregation() {
+        auto node = std::make_shared<promql_node>();
+        node->type = promql_node_type::aggregation;
+        node->value_type = promql_value_type::instant_vector;
+        node->text = detail::to_lower(peek().text);
+        ++pos_;
+
+        bool grouped = false;
+        if (!parse_grouping(*node, grouped) || !expect(token_type::lparen, "'('")) {
+            return nullptr;
+        }
+        const bool parameterized = node->text == "topk" || node->text == "bottomk" || node->text == "quantile";
+        if (parameterized) {
+            auto parameter = parse_binary(0);
+            if (!parameter || !expect(token_type::comma, "','")) {
+                return nullptr;
+            }
+            if (parameter->value_type != promql_value_type::scalar) {
+                return fail(node->text + " parameter must be a scalar");
+            }
+            node->children.push_back(parameter);
+        }
+        auto operand = parse_binary(0);
+        if (!operand || !expect(token_type::rparen, "')'") || !parse_grouping(*node, grouped)) {
+            return nullptr;
+        }
+        if (operand->value_type != promql_value_type::instant_vector) {
+            return fail(node->text + " needs an instant vector, got " + to_string(operand->value_type));
+        }
+        node->children.push_back(operand);
+        return node;
+    }
+
+    promql_node_ptr parse_function() {
+        const std::string name = peek().text;
+        const auto& functions = detail::promql_functions();
+        auto signature = functions.find(name);
+        if (signature == functions.end()) {
+            return fail("Unknown function '" + name + "'");
+        }
+        pos_ += 2;
+
+        auto node = std::make_shared<promql_node>();
+        node->type = promql_node_type::function_call;
+        node->value_type = signature->second.result;
+        node->text = name;
+        while (!accept(token_type::rparen)) {
+            auto argument = parse_binary(0);
+            if (!argument) {
+                return nullptr;
+            }
+            node->children.push_back(argument);
+            if (!accept(token_type::comma) && peek().type != token_type::rparen) {
+                return fail("Expected ',' or ')'");
+            }
+        }
+
+        const auto& expected = signature->second.arguments;
+        if (node->children.size() != expected.size()) {
+            return fail(name + "() takes " + std::to_string(expected.size()) + " arguments, got " +
+                        std::to_string(node->children.size()));
+        }
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (node->children[i]->value_type != expected[i]) {
+                return fail(name + "() argument " + std::to_string(i + 1) + " must be a " +
+                            to_string(expected[i]) + ", got " + to_string(node->children[i]->value_type));
+            }
+        }
+        return node;
+    }
+};
+
+/**
+ * @class promql_engine
+ * @brief Evaluates PromQL expressions over metric_storage
+ *
+ * Results use the query_result layout of metric_query_engine: one
+ * query_series per label set, named after its __name__ label (empty once a
+ * function or operator has dropped it), with __name__ removed from labels.
+ * A scalar result is a single unnamed series. Series are ordered by label
+ * set.
+ */
+class promql_engine {
+public:
+    explicit promql_engine(const metric_storage& storage, promql_options options = {})
+        : storage_(storage), options_(std::move(options)) {}
+
+    /**
+     * @brief Evaluate an instant query at one time
+     */
+    common::Result<query_result> query(const std::string& expression,
+                                       std::chrono::system_clock::time_point time) const {
+        return query_range(expression, time, time, std::chrono::milliseconds(1));
+    }
+
+    /**
+     * @brief Evaluate a range query at start, start + step, ... up to end
+     */
+    common::Result<query_result> query_range(const std::string& expression,
+                                             std::chrono::system_clock::time_point start,
+                                             std::chrono::system_clock::time_point end,
+                                             std::chrono::milliseconds step) const {
+        promql_parser parser;
+        auto parsed = parser.parse(expression);
+        if (parsed.is_err()) {
+            return common::Result<query_result>::err(parsed.error());
+        }
+        return evaluate(parsed.value(), start, end, step);
+    }
+
+    /**
+     * @brief Evaluate a parsed expression, such as a rule parsed once and
+     *        evaluated on every rule group interval
+     */
+    common::Result<query_result> evaluate(const promql_node_ptr& expression,
+                                          std::chrono::system_clock::time_point start,
+                                          std::chrono::system_clock::time_point end,
+                                          std::chrono::milliseconds step) const {
+        if (!expression) {
+            return fail("Empty expression");
+        }
+        if (expression->value_type != promql_value_type::scalar &&
+            expression->value_type != promql_value_type::instant_vector) {
+            return fail(std::string("Expression must evaluate to a scalar or instant vector, got ") +
+                        to_string(expression->value_type));
+        }
+        if (step.count() <= 0) {
+            return fail("Step must be positive");
+        }
+        if (end < start) {
+            return fail("End time is before start time");
+        }
+        const int64_t step_ticks = to_ticks(step);
+        const int64_t first = start.time_since_epoch().count();
+        const int64_t last = end.time_since_epoch().count();
+        if (static_cast<uint64_t>(last - first) / static_cast<uint64_t>(step_ticks) >= options_.max_steps) {
+            return fail("Range query exceeds " + std::to_string(options_.max_steps) + " steps");
+        }
+
+        context ctx;
+        ctx.lookback = to_ticks(options_.lookback_delta);
+        auto loaded = load(*expression, first, last, ctx);
+        if (loaded.is_err()) {
+            return common::Result<query_result>::err(loaded.error());
+        }
+
+        std::map<label_set, query_series> output;
+        for (int64_t t = first; t <= last; t += step_ticks) {
+            const auto timestamp = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(t));
+            value result = eval(*expression, t, ctx);
+            if (!ctx.error.empty()) {
+                return fail(ctx.error);
+            }
+            if (result.type == promql_value_type::scalar) {
+                result.samples = {{label_set(), result.scalar}};
+            }
+            for (auto& sample : result.samples) {
+                auto& series = output[sample.labels];
+                if (!series.timestamps.empty() && series.timestamps.back() == timestamp) {
+                    return fail("Vector cannot contain metrics with the same label set");
+                }
+                series.timestamps.push_back(timestamp);
+                series.values.push_back(sample.value);
+            }
+        }
+
+        query_result result = std::move(ctx.stats);
+        for (auto& [labels, series] : output) {
+            for (const auto& label : labels) {
+                if (label.first == metric_name_label) {
+                    series.name = label.second;
+                } else {
+                    series.labels.push_back(label);
+                }
+            }
+            result.series.push_back(std::move(series));
+        }
+        return common::Result<query_result>::ok(std::move(result));
+    }
+
+    const promql_options& options() const noexcept { return options_; }
+
+private:
+    struct sample {
+        label_set labels;
+        double value = 0.0;
+    };
+
+    struct value {
+        promql_value_type type = promql_value_type::instant_vector;
+        double scalar = 0.0;
+        std::vector<sample> samples;
+    };
+
+    /// Decoded points of one selected series
+    struct series_data {
+        label_set labels;
+        std::vector<int64_t> ticks;
+        std::vector<double> values;
+    };
+
+    struct context {
+        int64_t lookback = 0;
+        std::unordered_map<const promql_node*, std::vector<series_data>> series;
+        query_result stats;
+        std::string error;
+    };
+
+    const metric_storage& storage_;
+    promql_options options_;
+
+    static common::Result<query_result> fail(const std::string& message) {
+        return common::Result<query_result>::err(
+            error_info(monitoring_error_code::invalid_argument, message, "monitoring_system").to_common_error());
+    }
+
+    static int64_t to_ticks(std::chrono::milliseconds duration) {
+        return std::chrono::duration_cast<std::chrono::system_clock::duration>(duration).count();
+    }
+
+    static value scalar_value(double number) {
+        value result;
+        result.type = promql_value_type::scalar;
+        result.scalar = number;
+        return result;
+    }
+
+    /**
+     * @brief Decode the points every selector needs for the whole query
+     */
+    common::VoidResult load(const promql_node& node, int64_t first, int64_t last, context& ctx) const {
+        for (const auto& child : node.children) {
+            auto loaded = load(*child, first, last, ctx);
+            if (loaded.is_err()) {
+                return loaded;
+            }
+        }
+        if (node.type != promql_node_type::vector_selector && node.type != promql_node_type::matrix_selector) {
+            return common::ok();
+        }
+
+        auto names = storage_.select_metric_names(node.matchers);
+        if (names.is_err()) {
+            return common::VoidResult::err(names.error());
+        }
+        const int64_t window = node.type == promql_node_type::matrix_selector ? to_ticks(node.range) : ctx.lookback;
+        const int64_t to = last - to_ticks(node.offset);
+        const int64_t from = first - to_ticks(node.offset) - window;
+        auto time_at = [](int64_t ticks) {
+            return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+        };
+
+        auto& selected = ctx.series[&node];
+        for (const auto& name : names.value()) {
+            series_data data;
+            // (from, to] as the half-open [from + 1, to + 1) that scan() takes
+            auto scanned = storage_.scan_metric(name, time_at(from + 1), time_at(to + 1),
+                [&data](const int64_t* ticks, const double* values, const uint32_t*, size_t size) {
+                    data.ticks.insert(data.ticks.end(), ticks, ticks + size);
+                    data.values.insert(data.values.end(), values, values + size);
+                });
+            if (scanned.is_err()) {
+                if (scanned.error().code != static_cast<int>(monitoring_error_code::metric_not_found)) {
+                    return scanned;
+                }
+                continue;
+            }
+            ++ctx.stats.series_scanned;
+            ctx.stats.points_scanned += data.ticks.size();
+            if (!data.ticks.empty()) {
+                data.labels = parse_series_name(name);
+                selected.push_back(std::move(data));
+            }
+        }
+        return common::ok();
+    }
+
+    value eval(const promql_node& node, int64_t t, context& ctx) const {
+        switch (node.type) {
+            case promql_node_type::number_literal:
+                return scalar_value(node.number);
+            case promql_node_type::vector_selector:
+                return eval_selector(node, t, ctx);
+            case promql_node_type::function_call:
+                return eval_function(node, t, ctx);
+            case promql_node_type::aggregation:
+                return eval_aggregation(node, t, ctx);
+            case promql_node_type::binary_op:
+                return eval_binary(node, t, ctx);
+            case promql_node_type::unary_minus: {
+                value operand = eval(*node.children[0], t, ctx);
+                operand.scalar = -operand.scalar;
+                for (auto& s : operand.samples) {
+                    s.labels = detail::promql_drop_name(std::move(s.labels));
+                    s.value = -s.value;
+                }
+                return operand;
+            }
+            default:
+                // Strings and range vectors are rejected by the type checker
+                ctx.error = "Unexpected " + std::string(to_string(node.value_type));
+                return value();
+        }
+    }
+
+    value eval_selector(const promql_node& node, int64_t t, context& ctx) const {
+        value result;
+        const int64_t reference = t - to_ticks(node.offset);
+        for (const auto& series : ctx.series[&node]) {
+            auto it = std::upper_bound(series.ticks.begin(), series.ticks.end(), reference);
+            if (it == series.ticks.begin() || *(it - 1) <= reference - ctx.lookback) {
+                continue;
+            }
+            result.samples.push_back({series.labels, series.values[static_cast<size_t>(it - series.ticks.begin()) - 1]});
+        }
+        return result;
+    }
+
+    value eval_function(const promql_node& node, int64_t t, context& ctx) const {
+        const std::string& name = node.text;
+        if (name == "time") {
+            return scalar_value(detail::ticks_to_seconds(t));
+        }
+        if (name == "vector") {
+            value result;
+            result.samples.push_back({label_set(), eval(*node.children[0], t, ctx).scalar});
+            return result;
+        }
+        if (name == "scalar") {
+            value operand = eval(*node.children[0], t, ctx);
+            return scalar_value(operand.samples.size() == 1 ? operand.samples[0].value
+                                                            : std::numeric_limits<double>::quiet_NaN());
+        }
+        if (name == "histogram_quantile") {
+            return eval_histogram_quantile(eval(*node.children[0], t, ctx).scalar,
+                                           eval(*node.children[1], t, ctx));
+        }
+        if (node.children.back()->type == promql_node_type::matrix_selector) {
+            const double parameter = node.children.size() > 1 ? eval(*node.children[0], t, ctx).scalar : 0.0;
+            return eval_range_function(node, *node.children.back(), parameter, t, ctx);
+        }
+
+        value operand = eval(*node.children[0], t, ctx);
+        const double bound = node.children.size() > 1 ? eval(*node.children[1], t, ctx).scalar : 0.0;
+        for (auto& s : operand.samples) {
+            s.labels = detail::promql_drop_name(std::move(s.labels));
+            if (name == "abs") {
+                s.value = std::fabs(s.value);
+            } else if (name == "ceil") {
+                s.value = std::ceil(s.value);
+            } else if (name == "floor") {
+                s.value = std::floor(s.value);
+            } else if (name == "sqrt") {
+                s.value = std::sqrt(s.value);
+            } else if (name == "clamp_min") {
+                s.value = std::max(s.value, bound);
+            } else if (name == "clamp_max") {
+                s.value = std::min(s.value, bound);
+            }
+        }
+        return operand;
+    }
+
+    value eval_range_function(const promql_node& node, const promql_node& matrix, double parameter,
+                              int64_t t, context& ctx) const {
+        const std::string& name = node.text;
+        const int64_t range_end = t - to_ticks(matrix.offset);
+        const int64_t range_start = range_end - to_ticks(matrix.range);
+
+        value result;
+        for (const auto& series : ctx.series[&matrix]) {
+            const auto begin = std::upper_bound(series.ticks.begin(), series.ticks.end(), range_start);
+            const auto end = std::upper_bound(begin, series.ticks.end(), range_end);
+            const size_t n = static_cast<size_t>(end - begin);
+            if (n == 0) {
+                continue;
+            }
+            const int64_t* ticks = &*begin;
+            const double* values = series.values.data() + (begin - series.ticks.begin());
+
+            std::optional<double> out;
+            if (name == "rate" || name == "increase" || name == "delta") {
+                out = detail::promql_extrapolated_rate(ticks, values, n, range_start, range_end,
+                                                       name != "delta", name == "rate");
+            } else if (name == "irate" || name == "idelta") {
+                out = detail::promql_instant_rate(ticks, values, n, name == "irate");
+            } else if (name == "count_over_time") {
+                out = static_cast<double>(n);
+            } else if (name == "last_over_time") {
+                out = values[n - 1];
+            } else if (name == "min_over_time" || name == "max_over_time") {
+                const bool min = name == "min_over_time";
+                double extreme = values[0];
+                for (size_t i = 1; i < n; ++i) {
+                    // NaN is only kept when there is nothing else
+                    if ((min ? values[i] < extreme : values[i] > extreme) || std::isnan(extreme)) {
+                        extreme = values[i];
+                    }
+                }
+                out = extreme;
+            } else if (name == "quantile_over_time") {
+                out = detail::promql_quantile(parameter, std::vector<double>(values, values + n));
+            } else {
+                double mean = 0.0;
+                double m2 = 0.0;
+                double sum = 0.0;
+                for (size_t i = 0; i < n; ++i) {
+                    sum += values[i];
+                    const double d = values[i] - mean;
+                    mean += d / static_cast<double>(i + 1);
+                    m2 += d * (values[i] - mean);
+                }
+                if (name == "sum_over_time") {
+                    out = sum;
+                } else if (name == "avg_over_time") {
+                    out = mean;
+                } else if (name == "stdvar_over_time") {
+                    out = m2 / static_cast<double>(n);
+                } else {
+                    out = std::sqrt(m2 / static_cast<double>(n));
+                }
+            }
+
+            if (out) {
+                result.samples.push_back({name == "last_over_time" ? series.labels
+                                                                  : detail::promql_drop_name(series.labels),
+                                          *out});
+            }
+        }
+        return result;
+    }
+
+    static value eval_histogram_quantile(double q, const value& buckets) {
+        std::map<label_set, std::vector<std::pair<double, double>>> histograms;
+        for (const auto& s : buckets.samples) {
+            auto le = std::find_if(s.labels.begin(), s.labels.end(),
+                                   [](const auto& label) { return label.first == "le"; });
+            if (le == s.labels.end()) {
+                continue;
+            }
+            char* end = nullptr;
+            const double bound = std::strtod(le->second.c_str(), &end);
+            if (end == le->second.c_str() || *end != '\0') {
+                continue;
+            }
+            histograms[detail::promql_filter_labels(s.labels, {"le"}, false)].emplace_back(bound, s.value);
+        }
+
+        value result;
+        for (auto& [labels, histogram] : histograms) {
+            result.samples.push_back({labels, detail::promql_bucket_quantile(q, std::move(histogram))});
+        }
+        return result;
+    }
+
+    value eval_aggregation(const promql_node& node, int64_t t, context& ctx) const {
+        const std::string& op = node.text;
+        const double parameter = node.children.size() > 1 ? eval(*node.children[0], t, ctx).scalar : 0.0;
+        value operand = eval(*node.children.back(), t, ctx);
+
+        std::map<label_set, std::vector<sample>> groups;
+        for (auto& s : operand.samples) {
+            auto key = detail::promql_filter_labels(s.labels, node.grouping, !node.without);
+            groups[std::move(key)].push_back(std::move(s));
+        }
+
+        value result;
+        for (auto& [key, members] : groups) {
+            if (op == "topk" || op == "bottomk") {
+                if (!(parameter >= 1)) {
+                    continue;
+                }
+                const bool top = op == "topk";
+                // NaN sorts last in both directions
+                std::stable_sort(members.begin(), members.end(), [top](const sample& a, const sample& b) {
+                    if (std::isnan(a.value) || std::isnan(b.value)) {
+                        return !std::isnan(a.value) && std::isnan(b.value);
+                    }
+                    return top ? a.value > b.value : a.value < b.value;
+                });
+                const size_t k = static_cast<size_t>(std::min(parameter, static_cast<double>(members.size())));
+                for (size_t i = 0; i < k; ++i) {
+                    result.samples.push_back(std::move(members[i]));
+                }
+                continue;
+            }
+
+            double out = 0.0;
+            if (op == "sum") {
+                for (const auto& s : members) {
+                    out += s.value;
+                }
+            } else if (op == "count") {
+                out = static_cast<double>(members.size());
+            } else if (op == "group") {
+                out = 1.0;
+            } else if (op == "min" || op == "max") {
+                out = members[0].value;
+                for (const auto& s : members) {
+                    if ((op == "min" ? s.value < out : s.value > out) || std::isnan(out)) {
+                        out = s.value;
+                    }
+                }
+            } else if (op == "quantile") {
+                std::vector<double> values;
+                for (const auto& s : members) {
+                    values.push_back(s.value);
+                }
+                out = detail::promql_quantile(parameter, std::move(values));
+            } else {
+                double mean = 0.0;
+                double m2 = 0.0;
+                for (size_t i = 0; i < members.size(); ++i) {
+                    const double d = members[i].value - mean;
+                    mean += d / static_cast<double>(i + 1);
+                    m2 += d * (members[i].value - mean);
+                }
+                const double variance = m2 / static_cast<double>(members.size());
+                out = op == "avg" ? mean : op == "stdvar" ? variance : std::sqrt(variance);
+            }
+            result.samples.push_back({key, out});
+        }
+        return result;
+    }
+
+    value eval_binary(const promql_node& node, int64_t t, context& ctx) const {
+        const std::string& op = node.text;
+        value lhs = eval(*node.children[0], t, ctx);
+        value rhs = eval(*node.children[1], t, ctx);
+        const bool comparison = detail::is_promql_comparison(op);
+
+        if (lhs.type == promql_value_type::scalar && rhs.type == promql_value_type::scalar) {
+            return scalar_value(comparison ? (detail::promql_compare(op, lhs.scalar, rhs.scalar) ? 1.0 : 0.0)
+                                           : detail::promql_arithmetic(op, lhs.scalar, rhs.scalar));
+        }
+
+        // Arithmetic and bool comparisons produce new values without a metric name
+        auto combine = [&](label_set labels, double a, double b, double kept, value& out) {
+            if (!comparison) {
+                out.samples.push_back({detail::promql_drop_name(std::move(labels)), detail::promql_arithmetic(op, a, b)});
+            } else if (node.return_bool) {
+                out.samples.push_back({detail::promql_drop_name(std::move(labels)),
+                                       detail::promql_compare(op, a, b) ? 1.0 : 0.0});
+            } else if (detail::promql_compare(op, a, b)) {
+                out.samples.push_back({std::move(labels), kept});
+            }
+        };
+
+        value result;
+        if (lhs.type == promql_value_type::scalar || rhs.type == promql_value_type::scalar) {
+            const bool scalar_left = lhs.type == promql_value_type::scalar;
+            value& vector = scalar_left ? rhs : lhs;
+            const double number = scalar_left ? lhs.scalar : rhs.scalar;
+            for (auto& s : vector.samples) {
+                const double a = scalar_left ? number : s.value;
+                const double b = scalar_left ? s.value : number;
+                combine(std::move(s.labels), a, b, s.value, result);
+            }
+            return result;
+        }
+
+        auto signature = [&node](const label_set& labels) {
+            return detail::promql_filter_labels(labels, node.grouping, node.matching_on);
+        };
+
+        if (detail::is_promql_set_operator(op)) {
+            std::set<label_set> right;
+            for (const auto& s : rhs.samples) {
+                right.insert(signature(s.labels));
+            }
+            std::set<label_set> left;
+            for (auto& s : lhs.samples) {
+                auto key = signature(s.labels);
+                const bool matched = right.count(key) > 0;
+                left.insert(std::move(key));
+                if (op == "or" || (op == "and") == matched) {
+                    result.samples.push_back(std::move(s));
+                }
+            }
+            if (op == "or") {
+                for (auto& s : rhs.samples) {
+                    if (left.count(signature(s.labels)) == 0) {
+                        result.samples.push_back(std::move(s));
+                    }
+                }
+            }
+            return result;
+        }
+
+        std::map<label_set, const sample*> right;
+        for (const auto& s : rhs.samples) {
+            if (!right.emplace(signature(s.labels), &s).second) {
+                ctx.error = "Found duplicate series for the match group on the right hand side of " + op;
+                return value();
+            }
+        }
+        std::set<label_set> matched;
+        for (auto& s : lhs.samples) {
+            auto key = signature(s.labels);
+            auto match = right.find(key);
+            if (match == right.end()) {
+                continue;
+            }
+            if (matched.count(key) > 0) {
+                ctx.error = "Found duplicate series for the match group on the left hand side of " + op;
+                return value();
+            }
+            matched.insert(key);
+            // on() keeps only the matching labels, ignoring() drops the ignored ones
+            label_set labels;
+            if (node.matching_on) {
+                labels = std::move(key);
+            } else {
+                for (auto& label : s.labels) {
+                    if (std::find(node.grouping.begin(), node.grouping.end(), label.first) == node.grouping.end()) {
+                        labels.push_back(std::move(label));
+                    }
+                }
+            }
+            combine(std::move(labels), s.value, match->second->value, s.value, result);
+        }
+        return result;
+    }
+};
+
+} } // namespace kcenon::monitoring
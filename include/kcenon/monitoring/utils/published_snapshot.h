@@ -0,0 +1,138 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file published_snapshot.h
+ * @brief Single-writer publication of immutable snapshots to lock-free readers
+ *
+ * A writer replaces the current snapshot with an atomic pointer swap, and
+ * readers pin whatever snapshot is current without taking a lock. Replaced
+ * snapshots are reclaimed with two alternating reader epochs, so a snapshot
+ * is freed only once every reader that could have seen it has finished.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+/**
+ * @class published_snapshot
+ * @brief Pointer to an immutable T that readers load without locks
+ *
+ * Readers announce themselves in the counter of the current epoch and then
+ * load the pointer. A published snapshot is retired into the list of the
+ * epoch it was replaced in; the writer advances the epoch only when no
+ * reader of the previous epoch remains, at which point the snapshots
+ * retired two epochs ago are unreachable and freed.
+ *
+ * publish() must be serialized by the caller. A reader that is preempted
+ * while holding a snapshot only delays reclamation; it never blocks the
+ * writer or other readers.
+ */
+template<typename T>
+class published_snapshot {
+public:
+    /**
+     * @class reader
+     * @brief Keeps one snapshot alive for the reader's lifetime
+     */
+    class reader {
+    public:
+        ~reader() {
+            owner_->readers_[slot_].fetch_sub(1);
+        }
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        const T& operator*() const noexcept { return *snapshot_; }
+        const T* operator->() const noexcept { return snapshot_; }
+
+    private:
+        friend class published_snapshot;
+
+        reader(const published_snapshot* owner, size_t slot, const T* snapshot) noexcept
+            : owner_(owner), slot_(slot), snapshot_(snapshot) {}
+
+        const published_snapshot* owner_;
+        size_t slot_;
+        const T* snapshot_;
+    };
+
+    explicit published_snapshot(std::unique_ptr<T> initial)
+        : current_(initial.release()) {}
+
+    ~published_snapshot() {
+        delete current_.load();
+    }
+
+    published_snapshot(const published_snapshot&) = delete;
+    published_snapshot& operator=(const published_snapshot&) = delete;
+
+    /**
+     * @brief Pin the current snapshot
+     *
+     * Retries only if the epoch advanced between announcing and validating
+     * the reader, which requires a concurrent publish().
+     */
+    reader read() const noexcept {
+        for (;;) {
+            const uint64_t epoch = epoch_.load();
+            const size_t slot = static_cast<size_t>(epoch & 1);
+            readers_[slot].fetch_add(1);
+            if (epoch_.load() == epoch) {
+                return reader(this, slot, current_.load());
+            }
+            readers_[slot].fetch_sub(1);
+        }
+    }
+
+    /**
+     * @brief The current snapshot, for the writer only
+     */
+    const T& current() const noexcept {
+        return *current_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Replace the current snapshot
+     * @note Calls must be serialized by the caller
+     */
+    void publish(std::unique_ptr<T> next) {
+        T* replaced = current_.exchange(next.release());
+        const uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+        retired_[epoch & 1].emplace_back(replaced);
+
+        // Readers of the previous epoch may still hold snapshots retired in
+        // it; once they are gone, those retired the epoch before are free
+        const size_t previous = static_cast<size_t>((epoch + 1) & 1);
+        if (readers_[previous].load() == 0) {
+            retired_[previous].clear();
+            epoch_.store(epoch + 1);
+        }
+    }
+
+    /**
+     * @brief Number of replaced snapshots not yet freed
+     * @note For the writer only
+     */
+    size_t retired_count() const noexcept {
+        return retired_[0].size() + retired_[1].size();
+    }
+
+private:
+    std::atomic<T*> current_;
+    std::atomic<uint64_t> epoch_{0};
+    mutable std::atomic<size_t> readers_[2] = {0, 0};
+    std::vector<std::unique_ptr<T>> retired_[2];
+};
+
+} } // namespace kcenon::monitoring
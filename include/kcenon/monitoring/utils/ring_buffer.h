@@ -25,6 +25,7 @@
 #include <vector>
 #include <chrono>
 #include <cstddef>
+#include <span>
 #include <type_traits>
 
 namespace kcenon { namespace monitoring {
@@ -123,6 +124,48 @@ struct ring_buffer_stats {
     }
 };
 
+/**
+ * @struct ring_buffer_view
+ * @brief Zero-copy view of the readable region of a ring buffer
+ * @tparam T The element type
+ *
+ * The readable region wraps around the end of the storage at most once, so
+ * it is exposed as up to two contiguous spans in FIFO order: @c first, then
+ * @c second. The view stays valid until the matching ring_buffer::commit().
+ */
+template<typename T>
+struct ring_buffer_view {
+    std::span<const T> first;
+    std::span<const T> second;
+
+    /**
+     * @brief Total number of elements in the view
+     */
+    size_t size() const noexcept {
+        return first.size() + second.size();
+    }
+
+    /**
+     * @brief Check if the view holds no elements
+     */
+    bool empty() const noexcept {
+        return first.empty() && second.empty();
+    }
+
+    /**
+     * @brief Visit every element in FIFO order
+     */
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& item : first) {
+            fn(item);
+        }
+        for (const auto& item : second) {
+            fn(item);
+        }
+    }
+};
+
 /**
  * @class ring_buffer
  * @brief Lock-free ring buffer with atomic operations
@@ -131,6 +174,12 @@ struct ring_buffer_stats {
  * This implementation uses atomic operations for thread-safety and
  * provides efficient circular buffer semantics with configurable
  * overflow behavior.
+ *
+ * Read and write indices are monotonic positions; a slot is
+ * @c position & (capacity - 1). A writer claims a position, moves its item
+ * into the slot and then publishes it by storing @c position + 1 in the
+ * slot's sequence. Readers only consume published slots, so a slot that a
+ * concurrent producer has claimed but not yet filled ends the readable run.
  */
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -147,9 +196,14 @@ private:
     alignas(64) std::atomic<size_t> read_index_{0};   // Cache line aligned
 
     std::unique_ptr<T[]> buffer_;
+    std::unique_ptr<std::atomic<size_t>[]> sequences_;  // Last published position + 1 per slot
     ring_buffer_config config_;
     mutable ring_buffer_stats stats_;
 
+    // Consumer-side state of the outstanding read_batch() view
+    size_t view_start_{0};
+    size_t view_size_{0};
+
     /**
      * @brief Get the mask for efficient modulo operation
      */
@@ -161,46 +215,58 @@ private:
      * @brief Check if buffer is full
      */
     bool is_full_unsafe(size_t write_idx, size_t read_idx) const noexcept {
-        return ((write_idx + 1) & get_mask()) == read_idx;
+        // A stale write index may trail a read index loaded after it
+        return write_idx > read_idx && write_idx - read_idx >= get_mask();
     }
 
     /**
-     * @brief Check if buffer is empty
+     * @brief Check whether the item at @p position has been fully written
      */
-    bool is_empty_unsafe(size_t write_idx, size_t read_idx) const noexcept {
-        return write_idx == read_idx;
+    bool is_published(size_t position) const noexcept {
+        return sequences_[position & get_mask()].load(std::memory_order_acquire) == position + 1;
     }
 
-public:
     /**
-     * @brief Constructor with configuration
-     * @param config Ring buffer configuration options
-     * @throws std::invalid_argument if configuration validation fails
+     * @brief Mark the item at @p position as readable
+     *
+     * The sequence only moves forward, so a writer that was lapped while
+     * filling a slot cannot hide the newer item that replaced it.
      */
-    explicit ring_buffer(const ring_buffer_config& config = {})
-        : buffer_(std::make_unique<T[]>(config.capacity))
-        , config_(config) {
+    void publish(size_t position) noexcept {
+        auto& sequence = sequences_[position & get_mask()];
+        size_t current = sequence.load(std::memory_order_relaxed);
+        while (current < position + 1 &&
+               !sequence.compare_exchange_weak(current, position + 1,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+    }
 
-        // Validate configuration
-        auto validation = config_.validate();
-        if (validation.is_err()) {
-            throw std::invalid_argument("Invalid ring buffer configuration: " +
-                                      validation.error().message);
+    /**
+     * @brief Move the read index forward to @p target unless it is already past
+     */
+    void advance_read_index(size_t expected, size_t target) noexcept {
+        while (expected < target &&
+               !read_index_.compare_exchange_weak(expected, target,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
         }
     }
 
-    // Non-copyable but moveable
-    ring_buffer(const ring_buffer&) = delete;
-    ring_buffer& operator=(const ring_buffer&) = delete;
-    ring_buffer(ring_buffer&&) = default;
-    ring_buffer& operator=(ring_buffer&&) = default;
+    /**
+     * @brief Check if buffer is empty
+     */
+    bool is_empty_unsafe(size_t write_idx, size_t read_idx) const noexcept {
+        return write_idx == read_idx;
+    }
 
     /**
-     * @brief Write a single element to the buffer
-     * @param item Item to write
-     * @return Result indicating success or failure
+     * @brief Claim the next write position
+     * @return Claimed position, or an error if the buffer is full or contended
+     *
+     * The claimed slot must be published, since readers stop at it until it is.
      */
-    common::VoidResult write(T&& item) {
+    common::Result<size_t> claim() {
         stats_.total_writes.fetch_add(1, std::memory_order_relaxed);
 
         // Atomically claim a write slot using CAS loop to avoid ABA problem
@@ -220,7 +286,7 @@ public:
                     // Advance read index to overwrite oldest data
                     // Use strong CAS in a loop to ensure it succeeds
                     size_t expected_read = current_read;
-                    size_t new_read = (current_read + 1) & get_mask();
+                    size_t new_read = current_read + 1;
 
                     // Try to advance read index with strong CAS
                     // If it fails, another thread already advanced it, which is fine
@@ -241,7 +307,7 @@ public:
 
                     // Provide more detailed error information
                     size_t current_size = size();
-                    return common::VoidResult::err(error_info(monitoring_error_code::storage_full,
+                    return common::Result<size_t>::err(error_info(monitoring_error_code::storage_full,
                                      "Ring buffer is full (size: " +
                                      std::to_string(current_size) +
                                      "/" + std::to_string(config_.capacity) +
@@ -250,12 +316,12 @@ public:
                 }
             }
 
-            new_write = (current_write + 1) & get_mask();
+            new_write = current_write + 1;
 
             // Prevent infinite loop in case of extreme contention
             if (++retry_count > max_retries) {
                 stats_.failed_writes.fetch_add(1, std::memory_order_relaxed);
-                return common::VoidResult::err(error_info(monitoring_error_code::collection_failed,
+                return common::Result<size_t>::err(error_info(monitoring_error_code::collection_failed,
                                  "Failed to write to ring buffer after " +
                                  std::to_string(max_retries) + " retries (high contention)").to_common_error());
             }
@@ -265,15 +331,85 @@ public:
                                                      std::memory_order_acq_rel,
                                                      std::memory_order_acquire));
 
-        // Write the item to the claimed slot
-        buffer_[current_write] = std::move(item);
+        return common::ok(current_write);
+    }
 
-        // Memory fence ensures data write completes before index update is visible
-        std::atomic_thread_fence(std::memory_order_release);
+public:
+    /**
+     * @brief Constructor with configuration
+     * @param config Ring buffer configuration options
+     * @throws std::invalid_argument if configuration validation fails
+     */
+    explicit ring_buffer(const ring_buffer_config& config = {})
+        : buffer_(std::make_unique<T[]>(config.capacity))
+        , sequences_(std::make_unique<std::atomic<size_t>[]>(config.capacity))
+        , config_(config) {
+
+        // Validate configuration
+        auto validation = config_.validate();
+        if (validation.is_err()) {
+            throw std::invalid_argument("Invalid ring buffer configuration: " +
+                                      validation.error().message);
+        }
+    }
+
+    // Non-copyable but moveable
+    ring_buffer(const ring_buffer&) = delete;
+    ring_buffer& operator=(const ring_buffer&) = delete;
+    ring_buffer(ring_buffer&&) = default;
+    ring_buffer& operator=(ring_buffer&&) = default;
+
+    /**
+     * @brief Write a single element to the buffer
+     * @param item Item to write
+     * @return Result indicating success or failure
+     */
+    common::VoidResult write(T&& item) {
+        auto position = claim();
+        if (position.is_err()) {
+            return common::VoidResult::err(position.error());
+        }
+
+        // Write the item to the claimed slot, then make it visible to readers
+        buffer_[position.value() & get_mask()] = std::move(item);
+        publish(position.value());
 
         return common::ok();
     }
 
+    /**
+     * @brief Write an element that a second step must accept before it is readable
+     * @param item Item to write
+     * @param admit Called with @p item once its slot is claimed and before it
+     *        is published, e.g. to log it; returns a VoidResult
+     * @param placeholder Published in the slot instead of @p item if
+     *        @p admit fails, for consumers to skip
+     * @return Error from claiming the slot or from @p admit
+     *
+     * Unlike writing after @p admit, a full buffer rejects the item before
+     * @p admit runs; unlike admitting after writing, a failed @p admit never
+     * leaves the item readable. Readers wait at the claimed slot meanwhile,
+     * so @p admit should be brief.
+     */
+    template<typename Admit>
+    common::VoidResult write(T&& item, Admit&& admit, T placeholder) {
+        auto position = claim();
+        if (position.is_err()) {
+            return common::VoidResult::err(position.error());
+        }
+
+        common::VoidResult admitted = admit(static_cast<const T&>(item));
+        if (admitted.is_ok()) {
+            buffer_[position.value() & get_mask()] = std::move(item);
+        } else {
+            stats_.failed_writes.fetch_add(1, std::memory_order_relaxed);
+            buffer_[position.value() & get_mask()] = std::move(placeholder);
+        }
+        publish(position.value());
+
+        return admitted;
+    }
+
     /**
      * @brief Write multiple elements in batch
      * @param items Vector of items to write
@@ -314,18 +450,17 @@ public:
         size_t current_read = read_index_.load(std::memory_order_acquire);
         size_t current_write = write_index_.load(std::memory_order_acquire);
 
-        if (is_empty_unsafe(current_write, current_read)) {
+        if (is_empty_unsafe(current_write, current_read) || !is_published(current_read)) {
             stats_.failed_reads.fetch_add(1, std::memory_order_relaxed);
             return common::VoidResult::err(error_info(monitoring_error_code::collection_failed,
                              "Ring buffer is empty").to_common_error());
         }
 
         // Read the item
-        item = std::move(buffer_[current_read]);
+        item = std::move(buffer_[current_read & get_mask()]);
 
         // Update read index
-        size_t new_read = (current_read + 1) & get_mask();
-        read_index_.store(new_read, std::memory_order_release);
+        advance_read_index(current_read, current_read + 1);
 
         return common::ok();
     }
@@ -360,6 +495,68 @@ public:
         return read_count;
     }
 
+    /**
+     * @brief Get a zero-copy view of ready elements without consuming them
+     * @param max_count Maximum number of elements to expose
+     * @return View of up to @p max_count elements in FIFO order
+     *
+     * Elements stay in the buffer until commit() releases them, so consumers
+     * can process or serialize them in place. The view ends before the first
+     * slot a producer has claimed but not yet published. Only one view may
+     * be outstanding; a new call replaces the previous one. Like read(),
+     * this is a single-consumer operation.
+     *
+     * @warning With overwrite_old enabled, writers that lap the reader may
+     *          overwrite elements while they are being viewed. Use
+     *          overwrite_old = false when consumers need stable views.
+     */
+    ring_buffer_view<T> read_batch(size_t max_count = SIZE_MAX) noexcept {
+        size_t current_read = read_index_.load(std::memory_order_acquire);
+        size_t current_write = write_index_.load(std::memory_order_acquire);
+
+        size_t available = current_write > current_read ? current_write - current_read : 0;
+        size_t limit = (std::min)(available, max_count);
+        size_t count = 0;
+        while (count < limit && is_published(current_read + count)) {
+            ++count;
+        }
+
+        size_t start = current_read & get_mask();
+        size_t first_count = (std::min)(count, config_.capacity - start);
+
+        view_start_ = current_read;
+        view_size_ = count;
+
+        ring_buffer_view<T> view;
+        view.first = std::span<const T>(buffer_.get() + start, first_count);
+        view.second = std::span<const T>(buffer_.get(), count - first_count);
+        return view;
+    }
+
+    /**
+     * @brief Release elements exposed by the last read_batch() view
+     * @param count Number of leading view elements to release
+     * @return Number of elements released (clamped to the view size)
+     *
+     * Partial commits are allowed; the remainder of the view stays valid.
+     */
+    size_t commit(size_t count) noexcept {
+        count = (std::min)(count, view_size_);
+        if (count == 0) {
+            return 0;
+        }
+
+        // An overwriting writer may already have moved the read index past
+        // the committed range, in which case nothing is left to release
+        const size_t target = view_start_ + count;
+        advance_read_index(view_start_, target);
+
+        view_start_ = target;
+        view_size_ -= count;
+        stats_.total_reads.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
     /**
      * @brief Peek at the next item without removing it
      * @param item Reference to store the peeked item
@@ -369,12 +566,12 @@ public:
         size_t current_read = read_index_.load(std::memory_order_acquire);
         size_t current_write = write_index_.load(std::memory_order_acquire);
 
-        if (is_empty_unsafe(current_write, current_read)) {
+        if (is_empty_unsafe(current_write, current_read) || !is_published(current_read)) {
             return common::VoidResult::err(error_info(monitoring_error_code::collection_failed,
                              "Ring buffer is empty").to_common_error());
         }
 
-        item = buffer_[current_read]; // Copy, don't move
+        item = buffer_[current_read & get_mask()]; // Copy, don't move
         return common::ok();
     }
 
@@ -382,16 +579,11 @@ public:
      * @brief Get current number of elements in buffer
      */
     size_t size() const noexcept {
-        size_t write_idx = write_index_.load(std::memory_order_acquire);
         size_t read_idx = read_index_.load(std::memory_order_acquire);
+        size_t write_idx = write_index_.load(std::memory_order_acquire);
 
-        // Handle wraparound correctly
-        if (write_idx >= read_idx) {
-            return write_idx - read_idx;
-        } else {
-            // Wraparound case: write has wrapped around but read hasn't
-            return config_.capacity - read_idx + write_idx;
-        }
+        // Positions are monotonic; the read index never passes the write index
+        return write_idx > read_idx ? write_idx - read_idx : 0;
     }
 
     /**
@@ -423,6 +615,11 @@ public:
     void clear() noexcept {
         write_index_.store(0, std::memory_order_release);
         read_index_.store(0, std::memory_order_release);
+        for (size_t i = 0; i < config_.capacity; ++i) {
+            sequences_[i].store(0, std::memory_order_relaxed);
+        }
+        view_start_ = 0;
+        view_size_ = 0;
     }
 
     /**
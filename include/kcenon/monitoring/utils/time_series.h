@@ -17,13 +17,18 @@
 #include "../core/error_codes.h"
 #include "metric_types.h"
 #include "ring_buffer.h"
+#include "time_series_chunk.h"
+#include "published_snapshot.h"
+#include <atomic>
 #include <chrono>
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <type_traits>
 
 namespace kcenon { namespace monitoring {
 
@@ -35,8 +40,9 @@ struct time_series_config {
     std::chrono::seconds retention_period{3600};      // How long to keep data
     std::chrono::milliseconds resolution{1000};       // Time resolution for aggregation
     size_t max_points = 3600;                         // Maximum data points to store
-    bool enable_compression = true;                    // Enable data compression
-    double compression_threshold = 0.01;              // Threshold for compression
+    size_t chunk_points = 256;                        // Points per sealed compressed chunk
+    bool enable_compression = true;                    // Deprecated: storage is always lossless-compressed
+    double compression_threshold = 0.01;              // Deprecated: unused
     
     /**
      * @brief Validate configuration
@@ -60,6 +66,12 @@ struct time_series_config {
             return common::VoidResult::err(err.to_common_error());
         }
 
+        if (chunk_points < 2) {
+            error_info err(monitoring_error_code::invalid_configuration,
+                          "Chunk points must be at least 2");
+            return common::VoidResult::err(err.to_common_error());
+        }
+
         return common::ok();
     }
 };
@@ -204,75 +216,425 @@ struct aggregation_result {
 
 /**
  * @class time_series
- * @brief Thread-safe time series data storage
+ * @brief Thread-safe time series data storage with lock-free readers
+ *
+ * Points are stored losslessly in Gorilla-encoded chunks (see
+ * time_series_chunk.h): immutable sealed chunks of config.chunk_points
+ * points plus one open head block that receives appends. An out-of-order
+ * point re-encodes only the chunk it lands in.
+ *
+ * Readers never take a lock. The sealed chunks and the head block form a
+ * series_view published through a published_snapshot. An in-order append
+ * writes the next head slot and publishes it with a release store of the
+ * head size; sealing, trimming, out-of-order inserts and clear() publish a
+ * new view instead, which shares the chunk array and head of the previous
+ * one where they are unchanged. The head keeps its (at most chunk_points)
+ * points unencoded, because readers decode it while the writer appends.
+ * Writers are serialized by a mutex that readers never take.
  */
 class time_series {
 private:
-    mutable std::mutex mutex_;
-    std::vector<time_point_data> data_;
+    using clock_type = std::chrono::system_clock;
+    using chunk_ptr = std::shared_ptr<const time_series_chunk>;
+
+    static constexpr size_t initial_head_capacity = 16;
+
+    /**
+     * @brief Open block of unencoded points, appended in place by the writer
+     *
+     * Points below size are published and never modified again.
+     */
+    struct head_block {
+        explicit head_block(size_t block_capacity)
+            : points(std::make_unique<time_point_data[]>(block_capacity)),
+              capacity(block_capacity) {}
+
+        std::unique_ptr<time_point_data[]> points;
+        size_t capacity;
+        std::atomic<size_t> size{0};
+    };
+
+    /**
+     * @brief Append-only slots of sealed chunks shared by successive views
+     *
+     * Slots below the end of a published view are never modified, so a
+     * sealed chunk is published by filling the next slot; replacing a
+     * chunk copies the live slots into a new array.
+     */
+    struct chunk_array {
+        explicit chunk_array(size_t array_capacity)
+            : slots(std::make_unique<chunk_ptr[]>(array_capacity)), capacity(array_capacity) {}
+
+        std::unique_ptr<chunk_ptr[]> slots;
+        size_t capacity;
+    };
+
+    /**
+     * @brief Immutable window of sealed chunks plus the head block
+     *
+     * Trimming drops whole chunks by advancing first and the oldest points
+     * of the first chunk by counting them in front_skip, so neither
+     * re-encodes a chunk.
+     */
+    struct series_view {
+        std::shared_ptr<chunk_array> chunks;
+        size_t first = 0;          // Live slots are [first, last)
+        size_t last = 0;
+        size_t front_skip = 0;     // Dropped leading points of the first live chunk
+        size_t sealed_points = 0;  // Live points in sealed chunks
+        std::shared_ptr<head_block> head;
+
+        const chunk_ptr* begin() const noexcept { return chunks->slots.get() + first; }
+        const chunk_ptr* end() const noexcept { return chunks->slots.get() + last; }
+        size_t chunk_count() const noexcept { return last - first; }
+    };
+
+    /**
+     * @brief The points of a head block published when it was read
+     */
+    struct head_points {
+        const time_point_data* points = nullptr;
+        size_t count = 0;
+
+        template<typename Fn>
+        void for_each(Fn&& fn) const {
+            for (size_t i = 0; i < count; ++i) {
+                fn(to_ticks(points[i].timestamp), points[i].value, points[i].sample_count);
+            }
+        }
+
+        time_series_summary summary() const noexcept {
+            time_series_summary result;
+            for_each([&result](int64_t ticks, double value, uint32_t sample_count) {
+                result.add(ticks, value, sample_count);
+            });
+            return result;
+        }
+
+        size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+        int64_t first_ticks() const noexcept { return to_ticks(points[0].timestamp); }
+        int64_t last_ticks() const noexcept { return to_ticks(points[count - 1].timestamp); }
+    };
+
+    /**
+     * @brief The first live chunk minus its front_skip dropped points
+     */
+    struct trimmed_chunk {
+        const time_series_chunk& chunk;
+        size_t skip;
+
+        template<typename Fn>
+        void for_each(Fn&& fn) const {
+            size_t index = 0;
+            chunk.for_each([&](int64_t ticks, double value, uint32_t count) {
+                if (index++ >= skip) {
+                    fn(ticks, value, count);
+                }
+            });
+        }
+
+        time_series_summary summary() const {
+            time_series_summary result;
+            for_each([&result](int64_t ticks, double value, uint32_t count) {
+                result.add(ticks, value, count);
+            });
+            return result;
+        }
+
+        size_t size() const noexcept { return chunk.size() - skip; }
+    };
+
     time_series_config config_;
     std::string series_name_;
+    std::mutex write_mutex_;  // Serializes writers; readers never take it
+    published_snapshot<series_view> view_;
     size_t insertion_count_ = 0;  // Track insertions for periodic maintenance
-    
+
+    static int64_t to_ticks(clock_type::time_point time) noexcept {
+        return static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    static clock_type::time_point from_ticks(int64_t ticks) noexcept {
+        return clock_type::time_point(clock_type::duration(ticks));
+    }
+
     /**
-     * @brief Cleanup old data points
+     * @brief Decode a chunk into plain data points
      */
-    void cleanup_old_data() {
-        auto cutoff = std::chrono::system_clock::now() - config_.retention_period;
-        
-        auto it = std::remove_if(data_.begin(), data_.end(),
-            [cutoff](const time_point_data& point) {
-                return !point.is_valid(cutoff);
-            });
-        
-        data_.erase(it, data_.end());
+    template<typename Chunk>
+    static std::vector<time_point_data> decode(const Chunk& chunk) {
+        std::vector<time_point_data> points;
+        points.reserve(chunk.size());
+        chunk.for_each([&points](int64_t ticks, double value, uint32_t count) {
+            points.emplace_back(from_ticks(ticks), value, count);
+        });
+        return points;
     }
-    
+
+    /**
+     * @brief Encode a sorted range of points into a sealed chunk
+     */
+    template<typename It>
+    static chunk_ptr encode(It first, It last) {
+        time_series_chunk_builder builder;
+        for (; first != last; ++first) {
+            builder.append(to_ticks(first->timestamp), first->value, first->sample_count);
+        }
+        return std::make_shared<const time_series_chunk>(builder.seal());
+    }
+
+    /**
+     * @brief Copy a sorted range of points into a new head block
+     */
+    template<typename It>
+    std::shared_ptr<head_block> make_head(It first, It last, size_t min_capacity = 0) const {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        auto head = std::make_shared<head_block>(
+            (std::max)({count, min_capacity, (std::min)(initial_head_capacity, config_.chunk_points)}));
+        std::copy(first, last, head->points.get());
+        head->size.store(count, std::memory_order_relaxed);  // Published with its view
+        return head;
+    }
+
+    std::unique_ptr<series_view> empty_view() const {
+        auto view = std::make_unique<series_view>();
+        view->chunks = std::make_shared<chunk_array>(config_.max_points / config_.chunk_points + 2);
+        view->head = make_head(static_cast<const time_point_data*>(nullptr),
+                               static_cast<const time_point_data*>(nullptr));
+        return view;
+    }
+
+    static head_points published_points(const series_view& view) noexcept {
+        return {view.head->points.get(), view.head->size.load(std::memory_order_acquire)};
+    }
+
+    static size_t point_count(const series_view& view) noexcept {
+        return view.sealed_points + view.head->size.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Visit every chunk that may hold points in [start, end), then
+     *        the head, as fn(chunk) with a time_series_chunk, trimmed_chunk
+     *        or head_points
+     */
+    template<typename Fn>
+    static void for_each_chunk(const series_view& view, int64_t start, int64_t end, Fn&& fn) {
+        const chunk_ptr* it = std::partition_point(view.begin(), view.end(),
+            [start](const chunk_ptr& chunk) { return chunk->last_ticks() < start; });
+        for (; it != view.end() && (*it)->first_ticks() < end; ++it) {
+            if (it == view.begin() && view.front_skip > 0) {
+                fn(trimmed_chunk{**it, view.front_skip});
+            } else {
+                fn(**it);
+            }
+        }
+        const head_points head = published_points(view);
+        if (!head.empty() && head.last_ticks() >= start && head.first_ticks() < end) {
+            fn(head);
+        }
+    }
+
+    /**
+     * @brief Publish a copy of the current view after @p edit has changed it
+     * @note Caller holds write_mutex_; references into the replaced view
+     *       must not be used after the next publication
+     */
+    template<typename Edit>
+    void republish(Edit&& edit) {
+        auto next = std::make_unique<series_view>(view_.current());
+        edit(*next);
+        view_.publish(std::move(next));
+    }
+
+    /**
+     * @brief Move the live chunks of @p view into a new array
+     * @param capacity Slots of the new array, at least chunk_count()
+     */
+    static void copy_chunks(series_view& view, size_t capacity) {
+        auto chunks = std::make_shared<chunk_array>(capacity);
+        std::copy(view.begin(), view.end(), chunks->slots.get());
+        view.last = view.chunk_count();
+        view.first = 0;
+        view.chunks = std::move(chunks);
+    }
+
+    /**
+     * @brief Append a sealed chunk to @p view
+     *
+     * The slot after the view's last one is unused by every published view
+     * sharing the array, so it is filled in place.
+     */
+    void append_chunk(series_view& view, chunk_ptr chunk) const {
+        if (view.last == view.chunks->capacity) {
+            copy_chunks(view, (std::max)(2 * view.chunk_count() + 2,
+                                         config_.max_points / config_.chunk_points + 2));
+        }
+        view.sealed_points += chunk->size();
+        view.chunks->slots[view.last++] = std::move(chunk);
+    }
+
     /**
-     * @brief Compress data if enabled
+     * @brief Encode the head of @p view into a sealed chunk and start a new head
      */
-    void compress_data() {
-        if (!config_.enable_compression || data_.size() < 3) {
+    void seal_head(series_view& view) const {
+        const head_block& head = *view.head;
+        const size_t count = head.size.load(std::memory_order_relaxed);
+        append_chunk(view, encode(head.points.get(), head.points.get() + count));
+        view.head = make_head(head.points.get(), head.points.get());
+    }
+
+    /**
+     * @brief Add a point, keeping chronological order
+     * @note Caller holds write_mutex_
+     */
+    void insert_point(const time_point_data& point) {
+        const int64_t ticks = to_ticks(point.timestamp);
+        const series_view& view = view_.current();
+        const size_t head_size = view.head->size.load(std::memory_order_relaxed);
+        const bool empty = view.chunk_count() == 0 && head_size == 0;
+
+        // Fast path: newest point is written into the head and published
+        // by the size store, without a new view
+        if (empty || ticks >= (head_size > 0 ? to_ticks(view.head->points[head_size - 1].timestamp)
+                                             : view.end()[-1]->last_ticks())) {
+            if (head_size == view.head->capacity) {
+                const time_point_data* points = view.head->points.get();
+                const size_t grown = (std::min)(view.head->capacity * 2, config_.chunk_points);
+                republish([&](series_view& next) {
+                    next.head = make_head(points, points + head_size, grown);
+                });
+            }
+
+            head_block& head = *view_.current().head;
+            head.points[head_size] = point;
+            head.size.store(head_size + 1, std::memory_order_release);
+            if (head_size + 1 >= config_.chunk_points) {
+                republish([this](series_view& next) { seal_head(next); });
+            }
             return;
         }
-        
-        // Simple compression: remove points that don't add significant information
-        std::vector<time_point_data> compressed;
-        compressed.reserve(data_.size());
-        
-        if (!data_.empty()) {
-            compressed.push_back(data_[0]);
-            
-            for (size_t i = 1; i < data_.size() - 1; ++i) {
-                const auto& prev = data_[i - 1];
-                const auto& curr = data_[i];
-                const auto& next = data_[i + 1];
-                
-                // Check if current point is significantly different from linear interpolation
-                double expected = prev.value + (next.value - prev.value) * 
-                    (std::chrono::duration<double>(curr.timestamp - prev.timestamp).count() /
-                     std::chrono::duration<double>(next.timestamp - prev.timestamp).count());
-                
-                if (std::abs(curr.value - expected) > config_.compression_threshold) {
-                    compressed.push_back(curr);
+
+        // Out of order: re-encode the chunk holding the insertion position,
+        // i.e. the first chunk whose last point is later than this one
+        auto by_time = [](const time_point_data& a, const time_point_data& b) {
+            return a.timestamp < b.timestamp;
+        };
+        const chunk_ptr* target = std::partition_point(view.begin(), view.end(),
+            [ticks](const chunk_ptr& chunk) { return chunk->last_ticks() <= ticks; });
+
+        if (target == view.end()) {
+            auto points = decode(published_points(view));
+            points.insert(std::upper_bound(points.begin(), points.end(), point, by_time), point);
+            republish([&](series_view& next) {
+                next.head = make_head(points.begin(), points.end());
+                if (points.size() >= config_.chunk_points) {
+                    seal_head(next);
+                }
+            });
+            return;
+        }
+
+        const auto index = static_cast<size_t>(target - view.begin());
+        const size_t skip = index == 0 ? view.front_skip : 0;
+        auto points = skip > 0 ? decode(trimmed_chunk{**target, skip}) : decode(**target);
+        points.insert(std::upper_bound(points.begin(), points.end(), point, by_time), point);
+        republish([&](series_view& next) {
+            const bool split = points.size() >= 2 * config_.chunk_points;
+            copy_chunks(next, next.chunks->capacity + (split ? 1 : 0));
+            chunk_ptr* slot = next.chunks->slots.get() + index;
+            if (split) {
+                auto middle = points.begin() + static_cast<std::ptrdiff_t>(points.size() / 2);
+                std::move_backward(slot + 1, next.chunks->slots.get() + next.last,
+                                   next.chunks->slots.get() + next.last + 1);
+                slot[0] = encode(points.begin(), middle);
+                slot[1] = encode(middle, points.end());
+                ++next.last;
+            } else {
+                *slot = encode(points.begin(), points.end());
+            }
+            if (index == 0) {
+                next.front_skip = 0;
+            }
+            ++next.sealed_points;
+        });
+    }
+
+    /**
+     * @brief Drop the @p count oldest points
+     * @note Caller holds write_mutex_
+     */
+    void drop_oldest(size_t count) {
+        republish([&](series_view& next) {
+            while (count > 0 && next.chunk_count() > 0) {
+                const size_t remaining = next.begin()[0]->size() - next.front_skip;
+                if (remaining > count) {
+                    next.front_skip += count;
+                    next.sealed_points -= count;
+                    return;
                 }
+                count -= remaining;
+                next.sealed_points -= remaining;
+                next.front_skip = 0;
+                ++next.first;
             }
-            
-            if (data_.size() > 1) {
-                compressed.push_back(data_.back());
+
+            // Dropped chunks stay referenced by their slots; release them
+            // once they would make up a quarter of the array
+            if (next.first > 0 && next.first * 4 >= next.chunks->capacity) {
+                copy_chunks(next, next.chunks->capacity);
+            }
+
+            if (count > 0) {
+                auto points = decode(published_points(next));
+                next.head = make_head(points.begin() + static_cast<std::ptrdiff_t>(count),
+                                      points.end());
+            }
+        });
+    }
+
+    /**
+     * @brief Cleanup old data points
+     * @note Caller holds write_mutex_
+     */
+    void cleanup_old_data() {
+        const int64_t cutoff = to_ticks(clock_type::now() - config_.retention_period);
+        const series_view& view = view_.current();
+
+        size_t expired = 0;
+        for (const chunk_ptr* it = view.begin(); it != view.end(); ++it) {
+            const size_t skip = it == view.begin() ? view.front_skip : 0;
+            if ((*it)->first_ticks() >= cutoff) {
+                break;
+            }
+            if ((*it)->last_ticks() >= cutoff) {
+                trimmed_chunk{**it, skip}.for_each([&expired, cutoff](int64_t ticks, double, uint32_t) {
+                    expired += ticks < cutoff ? 1 : 0;
+                });
+                break;
             }
+            expired += (*it)->size() - skip;
+        }
+        const head_points head = published_points(view);
+        if (expired == view.sealed_points && !head.empty() && head.first_ticks() < cutoff) {
+            head.for_each([&expired, cutoff](int64_t ticks, double, uint32_t) {
+                expired += ticks < cutoff ? 1 : 0;
+            });
+        }
+
+        if (expired > 0) {
+            drop_oldest(expired);
         }
-        
-        data_ = std::move(compressed);
     }
-    
+
     /**
      * @brief Ensure data size doesn't exceed maximum
+     * @note Caller holds write_mutex_
      */
     void enforce_size_limit() {
-        if (data_.size() > config_.max_points) {
-            size_t remove_count = data_.size() - config_.max_points;
-            data_.erase(data_.begin(), data_.begin() + remove_count);
+        const size_t count = point_count(view_.current());
+        if (count > config_.max_points) {
+            drop_oldest(count - config_.max_points);
         }
     }
 
@@ -280,9 +642,7 @@ private:
      * @brief Private constructor (use create() factory method)
      */
     time_series(const std::string& name, const time_series_config& config)
-        : config_(config), series_name_(name) {
-        data_.reserve(config_.max_points);
-    }
+        : config_(config), series_name_(name), view_(empty_view()) {}
 
 public:
     /**
@@ -301,69 +661,61 @@ public:
 
         return common::ok(std::unique_ptr<time_series>(new time_series(name, config)));
     }
-    
+
     /**
      * @brief Add a data point
      */
     common::VoidResult add_point(double value,
                                  std::chrono::system_clock::time_point timestamp =
                                  std::chrono::system_clock::now()) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        time_point_data point(timestamp, value);
-
-        // Optimize: if timestamp is newest, append directly (O(1) vs O(n))
-        if (data_.empty() || point.timestamp >= data_.back().timestamp) {
-            data_.push_back(point);
-        } else {
-            // Insert in chronological order only when necessary
-            auto it = std::upper_bound(data_.begin(), data_.end(), point,
-                [](const time_point_data& a, const time_point_data& b) {
-                    return a.timestamp < b.timestamp;
-                });
+        std::lock_guard<std::mutex> lock(write_mutex_);
 
-            data_.insert(it, point);
-        }
+        insert_point(time_point_data(timestamp, value));
 
         // Perform maintenance periodically (every 100 insertions) instead of every time
         ++insertion_count_;
         if (insertion_count_ % 100 == 0) {
             cleanup_old_data();
-            compress_data();
             enforce_size_limit();
         }
 
         return common::ok();
     }
-    
+
+    /**
+     * @brief Add a pre-aggregated data point
+     */
+    common::VoidResult add_point(const time_point_data& point) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+
+        insert_point(point);
+
+        ++insertion_count_;
+        if (insertion_count_ % 100 == 0) {
+            cleanup_old_data();
+            enforce_size_limit();
+        }
+
+        return common::ok();
+    }
+
     /**
      * @brief Add multiple data points
      */
     common::VoidResult add_points(const std::vector<time_point_data>& points) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(write_mutex_);
 
         for (const auto& point : points) {
-            // Optimize: if timestamp is newest, append directly
-            if (data_.empty() || point.timestamp >= data_.back().timestamp) {
-                data_.push_back(point);
-            } else {
-                auto it = std::upper_bound(data_.begin(), data_.end(), point,
-                    [](const time_point_data& a, const time_point_data& b) {
-                        return a.timestamp < b.timestamp;
-                    });
-
-                data_.insert(it, point);
-            }
+            insert_point(point);
         }
 
         // Perform maintenance after batch insert
         cleanup_old_data();
-        compress_data();
         enforce_size_limit();
 
         return common::ok();
     }
-    
+
     /**
      * @brief Query data for a time range
      */
@@ -375,124 +727,285 @@ public:
                           validation.error().message, "monitoring_system").to_common_error());
         }
 
-        std::lock_guard<std::mutex> lock(mutex_);
+        const auto view = view_.read();
 
         aggregation_result result;
         result.query_start = query.start_time;
         result.query_end = query.end_time;
 
-        // Find data points in the time range
-        auto start_it = std::lower_bound(data_.begin(), data_.end(), query.start_time,
-            [](const time_point_data& point, std::chrono::system_clock::time_point time) {
-                return point.timestamp < time;
-            });
+        const int64_t start = to_ticks(query.start_time);
+        const int64_t end = to_ticks(query.end_time);
+        const auto step = static_cast<int64_t>(
+            std::chrono::duration_cast<clock_type::duration>(query.step).count());
 
-        auto end_it = std::upper_bound(data_.begin(), data_.end(), query.end_time,
-            [](std::chrono::system_clock::time_point time, const time_point_data& point) {
-                return time < point.timestamp;
-            });
+        // Points arrive in order, so each step bucket is complete once the
+        // next one starts
+        bool has_bucket = false;
+        int64_t bucket = 0;
+        time_point_data aggregated_point;
 
-        if (start_it == end_it) {
-            return common::ok(std::move(result));  // No data in range
-        }
+        auto enter_bucket = [&](int64_t index) {
+            if (has_bucket && index == bucket) {
+                return;
+            }
+            if (has_bucket) {
+                result.points.push_back(aggregated_point);
+            }
+            aggregated_point = time_point_data();
+            aggregated_point.timestamp = query.start_time + query.step * index + query.step / 2;
+            bucket = index;
+            has_bucket = true;
+        };
+
+        auto visit = [&](int64_t ticks, double value, uint32_t count) {
+            if (ticks < start || ticks >= end) {
+                return;
+            }
+            enter_bucket((ticks - start) / step);
+            aggregated_point.merge(time_point_data(from_ticks(ticks), value, count));
+            result.total_samples += count;
+        };
+
+        // A chunk that lies inside the range and within one step bucket is
+        // folded in from its summary without decoding
+        auto scan = [&](const auto& chunk) {
+            const auto& summary = chunk.summary();
+            if (summary.first_ticks >= start && summary.last_ticks < end && summary.samples > 0 &&
+                (summary.first_ticks - start) / step == (summary.last_ticks - start) / step) {
+                enter_bucket((summary.first_ticks - start) / step);
+                aggregated_point.merge(time_point_data(from_ticks(summary.last_ticks),
+                                                       summary.mean(),
+                                                       static_cast<uint32_t>(summary.samples)));
+                result.total_samples += summary.samples;
+            } else {
+                chunk.for_each(visit);
+            }
+        };
 
-        // Aggregate data by step size
-        auto current_step_start = query.start_time;
+        for_each_chunk(*view, start, end, scan);
 
-        while (current_step_start < query.end_time) {
-            auto current_step_end = current_step_start + query.step;
-            if (current_step_end > query.end_time) {
-                current_step_end = query.end_time;
-            }
+        if (has_bucket) {
+            result.points.push_back(aggregated_point);
+        }
 
-            // Find points in this step
-            std::vector<time_point_data> step_points;
-            for (auto it = start_it; it != end_it; ++it) {
-                if (it->timestamp >= current_step_start && it->timestamp < current_step_end) {
-                    step_points.push_back(*it);
-                    result.total_samples += it->sample_count;
-                }
-            }
+        return common::ok(std::move(result));
+    }
 
-            // Aggregate points in this step
-            if (!step_points.empty()) {
-                time_point_data aggregated_point;
-                aggregated_point.timestamp = current_step_start + query.step / 2;  // Middle of step
+    /**
+     * @brief Aggregate all points in [start_time, end_time)
+     *
+     * Chunks fully inside the range contribute their precomputed summary;
+     * only the (at most two) chunks straddling a boundary are decoded, so
+     * the cost is O(chunks) rather than O(points).
+     */
+    common::Result<time_series_summary> summarize(
+        std::chrono::system_clock::time_point start_time,
+        std::chrono::system_clock::time_point end_time) const {
+        if (start_time >= end_time) {
+            return common::Result<time_series_summary>::err(
+                error_info(monitoring_error_code::invalid_argument,
+                          "Start time must be before end time", "monitoring_system").to_common_error());
+        }
 
-                for (const auto& point : step_points) {
-                    aggregated_point.merge(point);
-                }
+        const auto view = view_.read();
 
-                result.points.push_back(aggregated_point);
+        const int64_t start = to_ticks(start_time);
+        const int64_t end = to_ticks(end_time);
+
+        time_series_summary result;
+        auto scan = [&](const auto& chunk) {
+            const auto& summary = chunk.summary();
+            if (summary.first_ticks >= start && summary.last_ticks < end) {
+                result.merge(summary);
+                return;
             }
+            chunk.for_each([&](int64_t ticks, double value, uint32_t count) {
+                if (ticks >= start && ticks < end) {
+                    result.add(ticks, value, count);
+                }
+            });
+        };
 
-            current_step_start = current_step_end;
-        }
+        for_each_chunk(*view, start, end, scan);
 
         return common::ok(std::move(result));
     }
-    
+
+    /**
+     * @brief Stream the points in [start_time, end_time) as column batches
+     * @param fn Called as fn(const int64_t* ticks, const double* values,
+     *        const uint32_t* counts, size_t size) once per overlapping
+     *        chunk, in chronological order; ticks are system_clock ticks
+     *
+     * @p fn sees the points published when the scan started; writers are
+     * not blocked while it runs.
+     */
+    template<typename Fn>
+    void scan(std::chrono::system_clock::time_point start_time,
+              std::chrono::system_clock::time_point end_time,
+              Fn&& fn) const {
+        scan(start_time, end_time, clock_type::duration::zero(), std::forward<Fn>(fn), nullptr);
+    }
+
+    /**
+     * @brief Stream points as column batches, passing chunks that need no
+     *        decoding as summaries
+     * @param bucket_width Width of the caller's epoch-aligned aggregation
+     *        buckets; zero treats the whole range as one bucket
+     * @param summary_fn Called as summary_fn(const time_series_summary&)
+     *        instead of @p fn for a chunk that lies inside the range and
+     *        within one bucket
+     */
+    template<typename Fn, typename SummaryFn>
+    void scan(std::chrono::system_clock::time_point start_time,
+              std::chrono::system_clock::time_point end_time,
+              clock_type::duration bucket_width,
+              Fn&& fn, SummaryFn&& summary_fn) const {
+        constexpr bool use_summaries = !std::is_same_v<std::decay_t<SummaryFn>, std::nullptr_t>;
+        const auto view = view_.read();
+
+        const int64_t start = to_ticks(start_time);
+        const int64_t end = to_ticks(end_time);
+        const int64_t width = bucket_width.count();
+        auto bucket_of = [width](int64_t ticks) {
+            return ticks / width - ((ticks % width != 0 && ticks < 0) ? 1 : 0);
+        };
+
+        std::vector<int64_t> ticks;
+        std::vector<double> values;
+        std::vector<uint32_t> counts;
+        auto emit = [&](const auto& chunk) {
+            if constexpr (use_summaries) {
+                const auto& summary = chunk.summary();
+                if (summary.count > 0 && summary.first_ticks >= start && summary.last_ticks < end &&
+                    (width == 0 || bucket_of(summary.first_ticks) == bucket_of(summary.last_ticks))) {
+                    summary_fn(summary);
+                    return;
+                }
+            }
+            ticks.clear();
+            values.clear();
+            counts.clear();
+            chunk.for_each([&](int64_t t, double value, uint32_t count) {
+                if (t >= start && t < end) {
+                    ticks.push_back(t);
+                    values.push_back(value);
+                    counts.push_back(count);
+                }
+            });
+            if (!ticks.empty()) {
+                fn(ticks.data(), values.data(), counts.data(), ticks.size());
+            }
+        };
+
+        for_each_chunk(*view, start, end, emit);
+    }
+
     /**
      * @brief Get current number of data points
      */
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return data_.size();
+        return point_count(*view_.read());
     }
-    
+
     /**
      * @brief Check if series is empty
      */
     bool empty() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return data_.empty();
+        return size() == 0;
     }
-    
+
     /**
      * @brief Get series name
      */
     const std::string& name() const noexcept {
         return series_name_;
     }
-    
+
     /**
      * @brief Get configuration
      */
     const time_series_config& get_config() const noexcept {
         return config_;
     }
-    
+
     /**
      * @brief Clear all data
      */
     void clear() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        data_.clear();
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        view_.publish(empty_view());
     }
-    
+
     /**
      * @brief Get latest value
      */
     common::Result<double> get_latest_value() const {
-        std::lock_guard<std::mutex> lock(mutex_);
+        const auto view = view_.read();
+        const head_points head = published_points(*view);
 
-        if (data_.empty()) {
+        if (!head.empty()) {
+            return common::ok(head.points[head.count - 1].value);
+        }
+        if (view->chunk_count() == 0) {
             return common::Result<double>::err(
                 error_info(monitoring_error_code::collection_failed,
                           "No data available", "monitoring_system").to_common_error());
         }
 
-        return common::ok(data_.back().value);
+        return common::ok(view->end()[-1]->last_value());
     }
-    
+
+    /**
+     * @brief Get all stored points in chronological order (decoded)
+     */
+    std::vector<time_point_data> get_points() const {
+        const auto view = view_.read();
+        std::vector<time_point_data> points;
+        points.reserve(point_count(*view));
+        for_each_chunk(*view, (std::numeric_limits<int64_t>::min)(),
+                       (std::numeric_limits<int64_t>::max)(), [&points](const auto& chunk) {
+            chunk.for_each([&points](int64_t ticks, double value, uint32_t count) {
+                points.emplace_back(from_ticks(ticks), value, count);
+            });
+        });
+        return points;
+    }
+
+    /**
+     * @brief Get number of sealed (immutable) chunks
+     */
+    size_t sealed_chunk_count() const {
+        return view_.read()->chunk_count();
+    }
+
+    /**
+     * @brief Get encoded payload size in bytes, excluding bookkeeping
+     *
+     * Points in the head are counted at their unencoded size.
+     */
+    size_t encoded_bytes() const {
+        const auto view = view_.read();
+        size_t total = published_points(*view).count * sizeof(time_point_data);
+        for (const chunk_ptr* it = view->begin(); it != view->end(); ++it) {
+            total += (*it)->encoded_bytes();
+        }
+        return total;
+    }
+
     /**
      * @brief Get memory footprint in bytes
      */
     size_t memory_footprint() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return sizeof(time_series) + 
-               data_.capacity() * sizeof(time_point_data) +
-               series_name_.capacity();
+        const auto view = view_.read();
+        size_t total = sizeof(time_series) + sizeof(series_view) +
+                       sizeof(chunk_array) + view->chunks->capacity * sizeof(chunk_ptr) +
+                       sizeof(head_block) + view->head->capacity * sizeof(time_point_data) +
+                       series_name_.capacity();
+        for (const chunk_ptr* it = view->begin(); it != view->end(); ++it) {
+            total += (*it)->memory_bytes();
+        }
+        return total;
     }
 };
 
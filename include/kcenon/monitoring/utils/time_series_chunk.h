@@ -0,0 +1,590 @@
+#pragma once
+
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+/**
+ * @file time_series_chunk.h
+ * @brief Gorilla-style lossless chunk encoding for time series samples
+ *
+ * Samples are (timestamp ticks, double value, sample count) triples. A chunk
+ * stores the first timestamp verbatim and then a bit stream with:
+ * - timestamps as delta-of-delta in a per-chunk unit (1s, 1ms, 1us or one
+ *   clock tick, whichever is the coarsest that divides every delta), using
+ *   variable-width buckets so regular intervals cost a single bit;
+ * - values XORed with their predecessor, storing only the meaningful bits
+ *   and reusing the previous leading/trailing-zero window when possible;
+ * - sample counts as one bit when 1, which is the common case.
+ *
+ * Regular-interval series typically take 1-2 bytes per sample instead of
+ * the 24 bytes of an uncompressed time_point_data.
+ *
+ * Every chunk also carries a time_series_summary (count, sum, min, max,
+ * first/last value and time bounds) so range aggregations only decode the
+ * chunks that straddle a range boundary.
+ *
+ * Reference: Pelkonen et al., "Gorilla: A Fast, Scalable, In-Memory Time
+ * Series Database", VLDB 2015.
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace kcenon { namespace monitoring {
+
+namespace detail {
+
+/**
+ * @brief MSB-first bit stream writer
+ *
+ * The last byte is always kept in the buffer (partially filled), so the
+ * stream can be decoded at any time without a finalize step.
+ */
+class chunk_bit_writer {
+public:
+    void write_bits(uint64_t value, unsigned bits) {
+        while (bits > 0) {
+            const unsigned used = static_cast<unsigned>(bit_count_ & 7);
+            if (used == 0) {
+                bytes_.push_back(0);
+            }
+            const unsigned room = 8 - used;
+            const unsigned take = bits < room ? bits : room;
+            const auto piece = static_cast<uint8_t>(
+                (value >> (bits - take)) & ((1u << take) - 1));
+            bytes_.back() |= static_cast<uint8_t>(piece << (room - take));
+            bits -= take;
+            bit_count_ += take;
+        }
+    }
+
+    void write_bit(bool bit) { write_bits(bit ? 1 : 0, 1); }
+
+    const uint8_t* data() const noexcept { return bytes_.data(); }
+    size_t bit_count() const noexcept { return bit_count_; }
+    size_t byte_count() const noexcept { return bytes_.size(); }
+    size_t capacity() const noexcept { return bytes_.capacity(); }
+
+    void clear() noexcept {
+        bytes_.clear();
+        bit_count_ = 0;
+    }
+
+private:
+    std::vector<uint8_t> bytes_;
+    size_t bit_count_ = 0;
+};
+
+/**
+ * @brief MSB-first bit stream reader with a 64-bit window
+ */
+class chunk_bit_reader {
+public:
+    chunk_bit_reader(const uint8_t* data, size_t bit_count) noexcept
+        : data_(data), byte_count_((bit_count + 7) / 8) {}
+
+    uint64_t read_bits(unsigned bits) noexcept {
+        if (bits == 0) {
+            return 0;
+        }
+        if (bits > 56) {
+            const uint64_t high = read_bits(bits - 32);
+            return (high << 32) | read_bits(32);
+        }
+        const uint64_t window = load_window() << (position_ & 7);
+        position_ += bits;
+        return window >> (64 - bits);
+    }
+
+    bool read_bit() noexcept {
+        const size_t byte = position_ >> 3;
+        const unsigned shift = 7 - static_cast<unsigned>(position_ & 7);
+        ++position_;
+        return ((data_[byte] >> shift) & 1) != 0;
+    }
+
+    /**
+     * @brief Count leading one bits, up to @p limit, consuming them plus the
+     *        terminating zero when present
+     */
+    unsigned read_unary(unsigned limit) noexcept {
+        unsigned ones = 0;
+        while (ones < limit && read_bit()) {
+            ++ones;
+        }
+        return ones;
+    }
+
+private:
+    uint64_t load_window() const noexcept {
+        const size_t byte = position_ >> 3;
+        uint64_t window = 0;
+        if (byte + 8 <= byte_count_) {
+            for (size_t i = 0; i < 8; ++i) {
+                window = (window << 8) | data_[byte + i];
+            }
+        } else {
+            for (size_t i = 0; i < 8; ++i) {
+                window = (window << 8) | (byte + i < byte_count_ ? data_[byte + i] : 0);
+            }
+        }
+        return window;
+    }
+
+    const uint8_t* data_;
+    size_t byte_count_;
+    size_t position_ = 0;
+};
+
+/// Timestamp units tried per chunk, coarsest first (in clock ticks)
+inline constexpr int64_t chunk_time_units[] = {1'000'000'000, 1'000'000, 1'000, 1};
+
+inline int64_t coarsest_unit_dividing(int64_t delta, int64_t current) noexcept {
+    for (int64_t unit : chunk_time_units) {
+        if (unit <= current && current % unit == 0 && delta % unit == 0) {
+            return unit;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Delta-of-delta bucket: control bits, payload width
+ */
+struct dod_bucket {
+    unsigned control_ones;  ///< Number of leading '1' control bits
+    unsigned payload_bits;
+};
+
+inline constexpr dod_bucket dod_buckets[] = {
+    {1, 7}, {2, 9}, {3, 12}, {4, 32}, {5, 64}
+};
+
+inline bool fits_signed(int64_t value, unsigned bits) noexcept {
+    if (bits >= 64) {
+        return true;
+    }
+    const int64_t limit = int64_t{1} << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+inline int64_t sign_extend(uint64_t raw, unsigned bits) noexcept {
+    if (bits >= 64) {
+        return static_cast<int64_t>(raw);
+    }
+    const uint64_t sign = uint64_t{1} << (bits - 1);
+    return static_cast<int64_t>((raw ^ sign) - sign);
+}
+
+/**
+ * @brief Gorilla XOR encoder for a stream of doubles
+ *
+ * Each value is XORed with its predecessor; only the meaningful bits are
+ * stored, reusing the previous leading/trailing-zero window when it fits.
+ * The first value is written by the caller and passed to reset().
+ */
+class xor_value_encoder {
+public:
+    void reset(uint64_t first_bits) noexcept {
+        prev_value_bits_ = first_bits;
+        prev_leading_ = no_window;
+        prev_trailing_ = 0;
+    }
+
+    void write(chunk_bit_writer& writer, uint64_t value_bits) {
+        const uint64_t x = value_bits ^ prev_value_bits_;
+        prev_value_bits_ = value_bits;
+        if (x == 0) {
+            writer.write_bit(false);
+            return;
+        }
+        writer.write_bit(true);
+
+        unsigned leading = static_cast<unsigned>(std::countl_zero(x));
+        const unsigned trailing = static_cast<unsigned>(std::countr_zero(x));
+        if (leading > 31) {
+            leading = 31;
+        }
+
+        if (prev_leading_ != no_window && leading >= prev_leading_ && trailing >= prev_trailing_) {
+            writer.write_bit(false);
+            const unsigned meaningful = 64 - prev_leading_ - prev_trailing_;
+            writer.write_bits(x >> prev_trailing_, meaningful);
+            return;
+        }
+
+        const unsigned meaningful = 64 - leading - trailing;
+        writer.write_bit(true);
+        writer.write_bits(leading, 5);
+        writer.write_bits(meaningful & 63, 6);   // 64 is stored as 0
+        writer.write_bits(x >> trailing, meaningful);
+        prev_leading_ = leading;
+        prev_trailing_ = trailing;
+    }
+
+    uint64_t last_bits() const noexcept { return prev_value_bits_; }
+
+private:
+    static constexpr unsigned no_window = 0xff;
+
+    uint64_t prev_value_bits_ = 0;
+    unsigned prev_leading_ = no_window;
+    unsigned prev_trailing_ = 0;
+};
+
+/**
+ * @brief Decoder matching xor_value_encoder
+ */
+class xor_value_decoder {
+public:
+    explicit xor_value_decoder(uint64_t first_bits) noexcept : value_bits_(first_bits) {}
+
+    uint64_t read(chunk_bit_reader& reader) noexcept {
+        if (reader.read_bit()) {
+            if (reader.read_bit()) {
+                leading_ = static_cast<unsigned>(reader.read_bits(5));
+                unsigned meaningful = static_cast<unsigned>(reader.read_bits(6));
+                if (meaningful == 0) {
+                    meaningful = 64;
+                }
+                trailing_ = 64 - leading_ - meaningful;
+            }
+            const unsigned meaningful = 64 - leading_ - trailing_;
+            value_bits_ ^= reader.read_bits(meaningful) << trailing_;
+        }
+        return value_bits_;
+    }
+
+private:
+    uint64_t value_bits_;
+    unsigned leading_ = 0;
+    unsigned trailing_ = 0;
+};
+
+/**
+ * @brief Encoder state shared by the open head chunk
+ */
+class chunk_stream_encoder {
+public:
+    void append(int64_t ticks, double value, uint32_t count) {
+        const uint64_t value_bits = std::bit_cast<uint64_t>(value);
+
+        if (count_ == 0) {
+            first_ticks_ = ticks;
+            writer_.write_bits(value_bits, 64);
+            values_.reset(value_bits);
+        } else {
+            const int64_t delta = (ticks - prev_ticks_) / unit_;
+            write_dod(delta - prev_delta_);
+            prev_delta_ = delta;
+            values_.write(writer_, value_bits);
+        }
+
+        if (count == 1) {
+            writer_.write_bit(false);
+        } else {
+            writer_.write_bit(true);
+            writer_.write_bits(count, 32);
+        }
+
+        prev_ticks_ = ticks;
+        ++count_;
+    }
+
+    void reset(int64_t unit) noexcept {
+        writer_.clear();
+        unit_ = unit;
+        count_ = 0;
+        first_ticks_ = 0;
+        prev_ticks_ = 0;
+        prev_delta_ = 0;
+        values_.reset(0);
+    }
+
+    const chunk_bit_writer& writer() const noexcept { return writer_; }
+    uint32_t count() const noexcept { return count_; }
+    int64_t unit() const noexcept { return unit_; }
+    int64_t first_ticks() const noexcept { return first_ticks_; }
+    int64_t last_ticks() const noexcept { return prev_ticks_; }
+    double last_value() const noexcept { return std::bit_cast<double>(values_.last_bits()); }
+
+private:
+    void write_dod(int64_t dod) {
+        if (dod == 0) {
+            writer_.write_bit(false);
+            return;
+        }
+        for (const auto& bucket : dod_buckets) {
+            if (fits_signed(dod, bucket.payload_bits)) {
+                // '1' x control_ones, then '0' unless this is the widest bucket
+                writer_.write_bits((uint64_t{1} << bucket.control_ones) - 1, bucket.control_ones);
+                if (bucket.control_ones < dod_buckets[std::size(dod_buckets) - 1].control_ones) {
+                    writer_.write_bit(false);
+                }
+                writer_.write_bits(static_cast<uint64_t>(dod), bucket.payload_bits);
+                return;
+            }
+        }
+    }
+
+    chunk_bit_writer writer_;
+    int64_t unit_ = 1;
+    uint32_t count_ = 0;
+    int64_t first_ticks_ = 0;
+    int64_t prev_ticks_ = 0;
+    int64_t prev_delta_ = 0;
+    xor_value_encoder values_;
+};
+
+/**
+ * @brief Decode a chunk stream, calling fn(ticks, value, count) per sample
+ */
+template<typename Fn>
+void decode_chunk_stream(const uint8_t* data, size_t bit_count, uint32_t count,
+                         int64_t first_ticks, int64_t unit, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    chunk_bit_reader reader(data, bit_count);
+    constexpr unsigned max_control = dod_buckets[std::size(dod_buckets) - 1].control_ones;
+
+    int64_t ticks = first_ticks;
+    int64_t delta = 0;
+    uint64_t value_bits = reader.read_bits(64);
+    xor_value_decoder values(value_bits);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            const unsigned ones = reader.read_unary(max_control);
+            if (ones > 0) {
+                const unsigned bits = dod_buckets[ones - 1].payload_bits;
+                delta += sign_extend(reader.read_bits(bits), bits);
+            }
+            ticks += delta * unit;
+
+            value_bits = values.read(reader);
+        }
+
+        uint32_t sample_count = 1;
+        if (reader.read_bit()) {
+            sample_count = static_cast<uint32_t>(reader.read_bits(32));
+        }
+
+        fn(ticks, std::bit_cast<double>(value_bits), sample_count);
+    }
+}
+
+} // namespace detail
+
+/**
+ * @struct time_series_summary
+ * @brief Aggregates over a time-ordered run of samples
+ */
+struct time_series_summary {
+    size_t count = 0;               ///< Number of stored points
+    uint64_t samples = 0;           ///< Sum of per-point sample counts
+    double sum = 0.0;               ///< Sum of value * sample count
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double first_value = 0.0;
+    double last_value = 0.0;
+    int64_t first_ticks = 0;
+    int64_t last_ticks = 0;
+
+    /**
+     * @brief Add a sample later than every sample seen so far
+     */
+    void add(int64_t ticks, double value, uint32_t sample_count) noexcept {
+        if (count == 0) {
+            first_ticks = ticks;
+            first_value = value;
+        }
+        last_ticks = ticks;
+        last_value = value;
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+        sum += value * sample_count;
+        samples += sample_count;
+        ++count;
+    }
+
+    /**
+     * @brief Append the summary of a later run of samples
+     */
+    void merge(const time_series_summary& other) noexcept {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        last_ticks = other.last_ticks;
+        last_value = other.last_value;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+        sum += other.sum;
+        samples += other.samples;
+        count += other.count;
+    }
+
+    /**
+     * @brief Sample-weighted mean, 0 when empty
+     */
+    double mean() const noexcept {
+        return samples > 0 ? sum / static_cast<double>(samples) : 0.0;
+    }
+};
+
+/**
+ * @class time_series_chunk
+ * @brief Immutable, sealed block of encoded samples
+ */
+class time_series_chunk {
+public:
+    time_series_chunk() = default;
+    time_series_chunk(time_series_chunk&&) noexcept = default;
+    time_series_chunk& operator=(time_series_chunk&&) noexcept = default;
+
+    /**
+     * @brief Visit samples in order as fn(ticks, value, count)
+     */
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        detail::decode_chunk_stream(data_.get(), bit_count_, count_, summary_.first_ticks,
+                                    unit_, std::forward<Fn>(fn));
+    }
+
+    uint32_t size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+    int64_t first_ticks() const noexcept { return summary_.first_ticks; }
+    int64_t last_ticks() const noexcept { return summary_.last_ticks; }
+    double last_value() const noexcept { return summary_.last_value; }
+    const time_series_summary& summary() const noexcept { return summary_; }
+
+    /**
+     * @brief Bytes of encoded payload
+     */
+    size_t encoded_bytes() const noexcept { return (bit_count_ + 7) / 8; }
+
+    /**
+     * @brief Total heap and inline bytes held by this chunk
+     */
+    size_t memory_bytes() const noexcept { return sizeof(*this) + encoded_bytes(); }
+
+private:
+    friend class time_series_chunk_builder;
+
+    std::unique_ptr<uint8_t[]> data_;
+    time_series_summary summary_;
+    int64_t unit_ = 1;
+    uint32_t bit_count_ = 0;
+    uint32_t count_ = 0;
+};
+
+/**
+ * @class time_series_chunk_builder
+ * @brief Open, appendable chunk that is sealed into a time_series_chunk
+ *
+ * The timestamp unit is chosen from the samples seen so far; a sample that
+ * does not fit the current unit re-encodes the chunk at a finer one, which
+ * happens at most three times per chunk.
+ */
+class time_series_chunk_builder {
+public:
+    time_series_chunk_builder() { encoder_.reset(detail::chunk_time_units[0]); }
+
+    /**
+     * @brief Append a sample
+     */
+    void append(int64_t ticks, double value, uint32_t count = 1) {
+        if (encoder_.count() > 0) {
+            const int64_t delta = ticks - encoder_.first_ticks();
+            if (delta % encoder_.unit() != 0) {
+                reencode(detail::coarsest_unit_dividing(delta, encoder_.unit()));
+            }
+        }
+        encoder_.append(ticks, value, count);
+        summary_.add(ticks, value, count);
+    }
+
+    /**
+     * @brief Visit samples in order as fn(ticks, value, count)
+     */
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        const auto& writer = encoder_.writer();
+        detail::decode_chunk_stream(writer.data(), writer.bit_count(), encoder_.count(),
+                                    encoder_.first_ticks(), encoder_.unit(),
+                                    std::forward<Fn>(fn));
+    }
+
+    /**
+     * @brief Produce an immutable chunk and reset the builder
+     */
+    time_series_chunk seal() {
+        const auto& writer = encoder_.writer();
+
+        time_series_chunk chunk;
+        chunk.count_ = encoder_.count();
+        chunk.summary_ = summary_;
+        chunk.unit_ = encoder_.unit();
+        chunk.bit_count_ = static_cast<uint32_t>(writer.bit_count());
+        chunk.data_ = std::make_unique<uint8_t[]>(writer.byte_count());
+        if (writer.byte_count() > 0) {
+            std::memcpy(chunk.data_.get(), writer.data(), writer.byte_count());
+        }
+
+        clear();
+        return chunk;
+    }
+
+    void clear() noexcept {
+        encoder_.reset(detail::chunk_time_units[0]);
+        summary_ = time_series_summary();
+    }
+
+    uint32_t size() const noexcept { return encoder_.count(); }
+    bool empty() const noexcept { return encoder_.count() == 0; }
+    int64_t first_ticks() const noexcept { return encoder_.first_ticks(); }
+    int64_t last_ticks() const noexcept { return encoder_.last_ticks(); }
+    double last_value() const noexcept { return encoder_.last_value(); }
+    const time_series_summary& summary() const noexcept { return summary_; }
+    size_t encoded_bytes() const noexcept { return encoder_.writer().byte_count(); }
+    size_t memory_bytes() const noexcept { return sizeof(*this) + encoder_.writer().capacity(); }
+
+private:
+    struct sample {
+        int64_t ticks;
+        double value;
+        uint32_t count;
+    };
+
+    void reencode(int64_t unit) {
+        std::vector<sample> samples;
+        samples.reserve(encoder_.count());
+        for_each([&samples](int64_t ticks, double value, uint32_t count) {
+            samples.push_back({ticks, value, count});
+        });
+
+        encoder_.reset(unit);
+        for (const auto& s : samples) {
+            encoder_.append(s.ticks, s.value, s.count);
+        }
+    }
+
+    detail::chunk_stream_encoder encoder_;
+    time_series_summary summary_;
+};
+
+} } // namespace kcenon::monitoring
@@ -8,11 +8,14 @@
  */
 
 #include <kcenon/monitoring/core/performance_monitor.h>
+#include <kcenon/monitoring/exporters/metric_exporters.h>
 #include <kcenon/monitoring/utils/hot_path_helper.h>
 #include <kcenon/monitoring/utils/statistics.h>
 #include <shared_mutex>
 #include <deque>
 #include <limits>
+#include <string_view>
+#include <type_traits>
 
 // Platform-specific headers for system metrics
 #if defined(__APPLE__)
@@ -360,10 +363,13 @@ std::vector<system_metrics> system_monitor::get_history(std::chrono::seconds dur
 }
 
 // performance_monitor additional methods
-common::Result<metrics_snapshot> performance_monitor::collect() {
-    metrics_snapshot snapshot;
-    snapshot.capture_time = std::chrono::system_clock::now();
-    snapshot.source_id = name_;
+template<typename Snapshot>
+void performance_monitor::append_collected_metrics(Snapshot& snapshot) {
+    {
+        // Size up front: arena storage released by vector growth is not reused
+        std::shared_lock<std::shared_mutex> lock(metrics_mutex_);
+        snapshot.metrics.reserve(snapshot.metrics.size() + 4 + tagged_metrics_.size());
+    }
 
     // Add system metrics
     auto system_metrics_result = system_monitor_.get_current_metrics();
@@ -377,23 +383,67 @@ common::Result<metrics_snapshot> performance_monitor::collect() {
         snapshot.add_metric("thread_count", static_cast<double>(sys_metrics.thread_count));
     }
 
-    // Add profiler metrics
-    auto profiler_metrics = profiler_.get_all_metrics();
-    for (const auto& perf_metric : profiler_metrics) {
-        // Add the metric value (using mean duration as the primary metric)
-        snapshot.add_metric(perf_metric.operation_name,
-                          static_cast<double>(perf_metric.mean_duration.count()));
-    }
+    // Add profiler metrics (using mean duration as the primary metric)
+    profiler_.for_each_mean_duration([&snapshot](const std::string& operation,
+                                                 std::chrono::nanoseconds mean) {
+        snapshot.add_metric(operation, static_cast<double>(mean.count()));
+    });
 
     // Add tagged metrics (counters, gauges, histograms)
-    auto tagged = get_all_tagged_metrics();
-    for (const auto& metric : tagged) {
-        snapshot.add_metric(metric.name, metric.value, metric.tags);
+    std::shared_lock<std::shared_mutex> lock(metrics_mutex_);
+    for (const auto& [key, data] : tagged_metrics_) {
+        // The name is the key up to the first ';'
+        const std::string_view name = std::string_view(key).substr(0, key.find(';'));
+        if constexpr (std::is_same_v<Snapshot, metrics_snapshot>) {
+            snapshot.add_metric(std::string(name), data->value, data->tags);
+        } else {
+            snapshot.add_metric(name, data->value, data->tags);
+        }
     }
+}
 
+common::Result<metrics_snapshot> performance_monitor::collect() {
+    metrics_snapshot snapshot;
+    snapshot.capture_time = std::chrono::system_clock::now();
+    snapshot.source_id = name_;
+
+    append_collected_metrics(snapshot);
     return common::ok(snapshot);
 }
 
+common::VoidResult performance_monitor::collect_into(arena_metrics_snapshot& snapshot) {
+    snapshot.capture_time = std::chrono::system_clock::now();
+    if (snapshot.source_id.empty()) {
+        snapshot.source_id = name_;
+    }
+
+    append_collected_metrics(snapshot);
+    return common::ok();
+}
+
+common::VoidResult performance_monitor::collect_and_export(
+    std::span<metric_exporter_interface* const> exporters) {
+    std::lock_guard<std::mutex> lock(cycle_mutex_);
+    collection_cycle cycle(cycle_arena_, name_);
+
+    auto collected = collect_into(cycle.snapshot());
+    if (collected.is_err()) {
+        return collected;
+    }
+
+    common::VoidResult result = common::ok();
+    for (auto* exporter : exporters) {
+        if (exporter == nullptr) {
+            continue;
+        }
+        auto exported = exporter->export_arena_snapshot(cycle.snapshot());
+        if (exported.is_err() && result.is_ok()) {
+            result = exported;
+        }
+    }
+    return result;
+}
+
 common::Result<bool> performance_monitor::check_thresholds() const {
     return common::ok(true); // Stub implementation
 }
@@ -507,9 +557,17 @@ common::VoidResult performance_monitor::record_metric_internal(
         metrics_mutex_,
         key,
         []() { return std::make_unique<metric_data>(); },
-        [&type, &tags](metric_data& d) {
+        [this, &type, &tags, &name, &key](metric_data& d) {
             d.type = type;
             d.tags = tags;
+
+            label_set labels{{metric_name_label, name}};
+            labels.insert(labels.end(), tags.begin(), tags.end());
+            const series_id id = tagged_index_.add(labels);
+            if (tagged_keys_.size() <= id) {
+                tagged_keys_.resize(id + 1);
+            }
+            tagged_keys_[id].push_back(key);
         }
     );
 
@@ -558,24 +616,53 @@ std::vector<tagged_metric> performance_monitor::get_all_tagged_metrics() const {
 
     result.reserve(tagged_metrics_.size());
     for (const auto& [key, data] : tagged_metrics_) {
-        // Extract name from key (everything before first ';' or entire key)
-        std::string name = key;
-        auto semicolon_pos = key.find(';');
-        if (semicolon_pos != std::string::npos) {
-            name = key.substr(0, semicolon_pos);
+        result.push_back(to_tagged_metric(key, *data));
+    }
+
+    return result;
+}
+
+common::Result<std::vector<tagged_metric>> performance_monitor::find_tagged_metrics(
+    const std::vector<label_matcher>& matchers) const {
+    std::shared_lock<std::shared_mutex> lock(metrics_mutex_);
+
+    auto ids = tagged_index_.select(matchers);
+    if (ids.is_err()) {
+        return common::Result<std::vector<tagged_metric>>::err(ids.error());
+    }
+
+    std::vector<tagged_metric> result;
+    result.reserve(ids.value().size());
+    for (series_id id : ids.value()) {
+        for (const auto& key : tagged_keys_[id]) {
+            auto it = tagged_metrics_.find(key);
+            if (it != tagged_metrics_.end()) {
+                result.push_back(to_tagged_metric(key, *it->second));
+            }
         }
+    }
 
-        tagged_metric metric(name, data->value, data->type, data->tags);
-        metric.timestamp = data->last_update;
-        result.push_back(std::move(metric));
+    return common::Result<std::vector<tagged_metric>>::ok(std::move(result));
+}
+
+tagged_metric performance_monitor::to_tagged_metric(const std::string& key, const metric_data& data) {
+    // Extract name from key (everything before first ';' or entire key)
+    std::string name = key;
+    auto semicolon_pos = key.find(';');
+    if (semicolon_pos != std::string::npos) {
+        name = key.substr(0, semicolon_pos);
     }
 
-    return result;
+    tagged_metric metric(name, data.value, data.type, data.tags);
+    metric.timestamp = data.last_update;
+    return metric;
 }
 
 void performance_monitor::clear_all_metrics() {
     std::unique_lock<std::shared_mutex> lock(metrics_mutex_);
     tagged_metrics_.clear();
+    tagged_index_.clear();
+    tagged_keys_.clear();
 }
 
 // Global instance
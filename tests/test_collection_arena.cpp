@@ -0,0 +1,208 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/core/collection_arena.h>
+#include <kcenon/monitoring/interfaces/monitoring_core.h>
+#include <kcenon/monitoring/exporters/metric_exporters.h>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+class fixed_collector : public metrics_collector {
+public:
+    kcenon::common::Result<metrics_snapshot> collect() override {
+        metrics_snapshot snapshot;
+        snapshot.source_id = "fixed";
+        snapshot.add_metric("requests_total", 42.0, {{"route", "/api"}});
+        snapshot.add_metric("latency_ms", 3.5);
+        return kcenon::common::ok(snapshot);
+    }
+
+    std::string get_name() const override { return "fixed_collector"; }
+    bool is_enabled() const override { return true; }
+    kcenon::common::VoidResult set_enabled(bool) override { return kcenon::common::ok(); }
+    kcenon::common::VoidResult initialize() override { return kcenon::common::ok(); }
+    kcenon::common::VoidResult cleanup() override { return kcenon::common::ok(); }
+};
+
+void fill_cycle(arena_metrics_snapshot& snapshot, int count) {
+    snapshot.reserve(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        auto& metric = snapshot.add_metric("metric_with_a_fairly_long_name_" + std::to_string(i), i);
+        metric.add_tag("environment_tag_key", "production_environment_value");
+    }
+}
+
+} // namespace
+
+TEST(CollectionArenaTest, ArenaSnapshotBasicOperations) {
+    collection_arena arena;
+    arena_metrics_snapshot snapshot(arena.resource());
+    snapshot.source_id = "node-1";
+
+    snapshot.add_metric("cpu_usage", 55.0);
+    std::unordered_map<std::string, std::string> tags{{"method", "GET"}};
+    snapshot.add_metric("http_requests_total", 10.0, tags);
+
+    EXPECT_EQ(snapshot.metrics.size(), 2u);
+    EXPECT_EQ(snapshot.get_metric("cpu_usage").value_or(-1.0), 55.0);
+    EXPECT_FALSE(snapshot.get_metric("missing").has_value());
+    EXPECT_EQ(snapshot.metrics[1].get_tag("method").value_or(""), "GET");
+    EXPECT_EQ(snapshot.metrics[1].name.get_allocator().resource(), arena.resource());
+    EXPECT_GT(arena.bytes_in_use(), 0u);
+}
+
+TEST(CollectionArenaTest, ResetGrowsRetainedBufferToHighWaterMark) {
+    collection_arena_config config;
+    config.initial_capacity = 1024;
+    collection_arena arena(config);
+
+    {
+        collection_cycle cycle(arena, "grow");
+        fill_cycle(cycle.snapshot(), 200);
+    }
+
+    auto stats = arena.get_stats();
+    EXPECT_EQ(stats.cycles, 1u);
+    EXPECT_GT(stats.upstream_allocations, 0u);
+    EXPECT_GT(stats.retained_capacity, 1024u);
+    EXPECT_GE(stats.retained_capacity, stats.last_cycle_bytes);
+    EXPECT_EQ(arena.bytes_in_use(), 0u);
+
+    // Same-shaped cycles now fit into the retained buffer
+    const auto spilled = stats.upstream_allocations;
+    for (int i = 0; i < 5; ++i) {
+        collection_cycle cycle(arena, "steady");
+        fill_cycle(cycle.snapshot(), 200);
+    }
+    stats = arena.get_stats();
+    EXPECT_EQ(stats.cycles, 6u);
+    EXPECT_EQ(stats.upstream_allocations, spilled);
+}
+
+TEST(CollectionArenaTest, GrowthRespectsRetainedCapacityLimit) {
+    collection_arena_config config;
+    config.initial_capacity = 1024;
+    config.max_retained_capacity = 4096;
+    collection_arena arena(config);
+
+    {
+        collection_cycle cycle(arena);
+        fill_cycle(cycle.snapshot(), 500);
+    }
+    EXPECT_EQ(arena.retained_capacity(), 4096u);
+
+    config.adaptive_growth = false;
+    collection_arena fixed(config);
+    {
+        collection_cycle cycle(fixed);
+        fill_cycle(cycle.snapshot(), 500);
+    }
+    EXPECT_EQ(fixed.retained_capacity(), 1024u);
+}
+
+TEST(CollectionArenaTest, RejectsInvalidConfiguration) {
+    collection_arena_config config;
+    config.initial_capacity = 0;
+    EXPECT_THROW(collection_arena{config}, std::invalid_argument);
+
+    config.initial_capacity = 8192;
+    config.max_retained_capacity = 4096;
+    EXPECT_THROW(collection_arena{config}, std::invalid_argument);
+}
+
+TEST(CollectionArenaTest, MaterializeProducesOwningSnapshot) {
+    collection_arena arena;
+    metrics_snapshot owned;
+    {
+        collection_cycle cycle(arena, "source-a");
+        auto& metric = cycle.snapshot().add_metric("queue_depth", 7.0);
+        metric.add_tag("queue", "ingest");
+        owned = materialize(cycle.snapshot());
+    }
+
+    ASSERT_EQ(owned.metrics.size(), 1u);
+    EXPECT_EQ(owned.source_id, "source-a");
+    EXPECT_EQ(owned.metrics[0].name, "queue_depth");
+    EXPECT_EQ(owned.metrics[0].value, 7.0);
+    EXPECT_EQ(owned.metrics[0].tags.at("queue"), "ingest");
+}
+
+TEST(CollectionArenaTest, DefaultCollectIntoCopiesCollectResult) {
+    collection_arena arena;
+    fixed_collector collector;
+
+    collection_cycle cycle(arena);
+    ASSERT_TRUE(collector.collect_into(cycle.snapshot()).is_ok());
+
+    const auto& snapshot = cycle.snapshot();
+    EXPECT_EQ(snapshot.source_id, "fixed");
+    ASSERT_EQ(snapshot.metrics.size(), 2u);
+    EXPECT_EQ(snapshot.get_metric("requests_total").value_or(0.0), 42.0);
+    EXPECT_EQ(snapshot.metrics[0].get_tag("route").value_or(""), "/api");
+}
+
+TEST(CollectionArenaTest, ArenaExportMatchesHeapExport) {
+    metric_export_config config;
+    config.endpoint = "http://prometheus:9090";
+    config.format = metric_export_format::prometheus_text;
+    config.instance_id = "test_instance";
+
+    prometheus_exporter arena_exporter(config);
+    prometheus_exporter heap_exporter(config);
+
+    collection_arena arena;
+    {
+        collection_cycle cycle(arena, "web");
+        cycle.snapshot().add_metric("http.requests.total", 12.0).add_tag("code", "200");
+        cycle.snapshot().add_metric("memory_usage_bytes", 2048.0);
+
+        ASSERT_TRUE(arena_exporter.export_arena_snapshot(cycle.snapshot()).is_ok());
+        ASSERT_TRUE(heap_exporter.export_snapshot(materialize(cycle.snapshot())).is_ok());
+    }
+
+    // The exporter must not reference arena memory after the cycle ended
+    auto text = arena_exporter.get_metrics_text();
+    EXPECT_EQ(text, heap_exporter.get_metrics_text());
+    EXPECT_NE(text.find("http_requests_total"), std::string::npos);
+}
+
+TEST(CollectionArenaTest, ArenaExportLabelsMatchConvertSnapshot) {
+    metric_export_config config;
+    config.format = metric_export_format::prometheus_text;
+    config.instance_id = "test_instance";
+    config.labels["region"] = "eu";
+    config.labels["source"] = "configured";
+
+    prometheus_exporter exporter(config);
+
+    collection_arena arena;
+    collection_cycle cycle(arena, "web");
+    auto& requests = cycle.snapshot().add_metric("http.requests.total", 12.0);
+    requests.add_tag("status-code", "200");
+    requests.add_tag("region", "us");
+    requests.add_tag("region", "ap");
+    cycle.snapshot().add_metric("queue depth", 3.0).add_tag("path", "a\"b\\c");
+
+    ASSERT_TRUE(exporter.export_arena_snapshot(cycle.snapshot()).is_ok());
+
+    // Reference rendering through the owning conversion
+    prometheus_series_registry expected;
+    for (const auto& metric : exporter.convert_snapshot(cycle.snapshot())) {
+        expected.upsert(metric);
+    }
+    std::string expected_text;
+    expected.render(expected_text);
+
+    auto text = exporter.get_metrics_text();
+    EXPECT_EQ(text, expected_text);
+    EXPECT_NE(text.find("region=\"ap\""), std::string::npos);
+    EXPECT_NE(text.find("status_code=\"200\""), std::string::npos);
+}
@@ -0,0 +1,283 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/utils/aggregation_processor.h>
+#include <kcenon/monitoring/utils/continuous_query.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+const std::vector<std::string> latency_series = {
+    R"(http_latency{endpoint="/a",host="x"})",
+    R"(http_latency{endpoint="/a",host="y"})",
+    R"(http_latency{endpoint="/b",host="x"})",
+};
+
+class ContinuousQueryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        metric_storage_config config;
+        config.enable_background_processing = false;
+        config.ring_buffer_capacity = 1 << 12;
+        storage_ = std::make_unique<metric_storage>(config);
+
+        // Register the names before any engine observes the storage
+        for (const auto& name : latency_series) {
+            ASSERT_TRUE(storage_->store_metric(name, 0.0).is_ok());
+        }
+        ASSERT_TRUE(storage_->store_metric("requests_total", 0.0).is_ok());
+        storage_->flush();
+
+        const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        base_ = (now - 1000) / 60 * 60;  // Panes are epoch-aligned
+    }
+
+    std::chrono::system_clock::time_point at(int64_t offset) const {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(base_ + offset));
+    }
+
+    /// One sample per second and series in [from, to)
+    void ingest(int from, int to) {
+        metric_batch batch;
+        for (int i = from; i < to; ++i) {
+            for (size_t s = 0; s < latency_series.size(); ++s) {
+                add(batch, latency_series[s], static_cast<double>((i * 7 + static_cast<int>(s) * 13) % 50), i);
+            }
+            add(batch, "requests_total", 3.0 * (i % 100), i);  // Resets every 100 seconds
+        }
+        ASSERT_EQ(storage_->store_metrics_batch(batch), batch.metrics.size());
+        storage_->flush();
+    }
+
+    void add(metric_batch& batch, const std::string& name, double value, int offset) {
+        compact_metric_value metric(create_metric_metadata(name, metric_type::gauge), value);
+        metric.timestamp_us = static_cast<uint64_t>((base_ + offset) * 1000000);
+        batch.add_metric(std::move(metric));
+    }
+
+    /// The same query over [window_start, window_end) computed from scratch
+    query_result recompute(const std::string& select, const std::string& filter, const std::string& group_by,
+                           const continuous_query_result& latest) {
+        const auto seconds = [](std::chrono::system_clock::time_point t) {
+            return std::to_string(std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count());
+        };
+        std::string query = select + " WHERE time >= " + seconds(latest.window_start) +
+                            " AND time < " + seconds(latest.window_end);
+        if (!filter.empty()) {
+            query += " AND " + filter;
+        }
+        if (!group_by.empty()) {
+            query += " GROUP BY " + group_by;
+        }
+        metric_query_engine engine(*storage_);
+        auto result = engine.query(query);
+        EXPECT_TRUE(result.is_ok()) << query << ": " << (result.is_err() ? result.error().message : "");
+        return result.is_ok() ? result.value() : query_result{};
+    }
+
+    static void expect_same(const query_result& expected, const query_result& actual) {
+        ASSERT_EQ(expected.series.size(), actual.series.size());
+        for (size_t i = 0; i < expected.series.size(); ++i) {
+            EXPECT_EQ(expected.series[i].name, actual.series[i].name);
+            EXPECT_EQ(expected.series[i].labels, actual.series[i].labels);
+            ASSERT_EQ(actual.series[i].size(), 1u);
+            ASSERT_EQ(expected.series[i].size(), 1u);
+            EXPECT_NEAR(expected.series[i].values[0], actual.series[i].values[0], 1e-9)
+                << actual.series[i].name;
+        }
+    }
+
+    std::shared_ptr<const continuous_query_result> latest(continuous_query_engine& engine, size_t id) {
+        auto result = engine.latest(id);
+        EXPECT_TRUE(result.is_ok());
+        return result.is_ok() ? result.value() : std::make_shared<continuous_query_result>();
+    }
+
+    std::unique_ptr<metric_storage> storage_;
+    int64_t base_ = 0;
+};
+
+} // namespace
+
+TEST_F(ContinuousQueryTest, SlidingResultsMatchFullRecomputation) {
+    continuous_query_engine engine(*storage_);
+    const std::string select =
+        "SELECT percentile(http_latency, 99), avg(http_latency), max(http_latency), count(http_latency)";
+    continuous_query_options options;
+    options.window = std::chrono::seconds(60);
+    options.resolution = std::chrono::seconds(5);
+    auto id = engine.register_query(select + " GROUP BY endpoint", options);
+    ASSERT_TRUE(id.is_ok()) << id.error().message;
+    EXPECT_TRUE(latest(engine, id.value())->result.series.empty());
+
+    // Grows into the window, then slides across several panes per batch
+    int from = 0;
+    for (int end : {30, 60, 61, 97, 150, 151, 240}) {
+        ingest(from, end);
+        from = end;
+
+        auto snapshot = latest(engine, id.value());
+        EXPECT_EQ(snapshot->window_end, at((end - 1) / 5 * 5 + 5));
+        EXPECT_EQ(snapshot->window_end - snapshot->window_start, std::chrono::seconds(60));
+        expect_same(recompute(select, "", "endpoint", *snapshot), snapshot->result);
+        ASSERT_EQ(snapshot->result.series.size(), 8u);
+        EXPECT_EQ(snapshot->result.series[0].timestamps[0], snapshot->window_end);
+    }
+}
+
+TEST_F(ContinuousQueryTest, PerSeriesRatesAndFiltersMatchRecomputation) {
+    continuous_query_engine engine(*storage_);
+    continuous_query_options options;
+    options.window = std::chrono::seconds(50);
+    options.resolution = std::chrono::seconds(10);
+
+    auto rate = engine.register_query("SELECT rate(requests_total), delta(requests_total)", options);
+    ASSERT_TRUE(rate.is_ok()) << rate.error().message;
+    const std::string filtered_select = "SELECT sum(http_latency), min(http_latency)";
+    auto filtered = engine.register_query(filtered_select + " WHERE host = 'x' AND value >= 10 GROUP BY endpoint",
+                                          options);
+    ASSERT_TRUE(filtered.is_ok()) << filtered.error().message;
+
+    ingest(0, 125);  // The window [80 s, 130 s) spans the counter reset at 100 s
+    auto rates = latest(engine, rate.value());
+    expect_same(recompute("SELECT rate(requests_total), delta(requests_total)", "", "", *rates), rates->result);
+    EXPECT_NEAR(rates->result.series[0].values[0], 129.0 / 44.0, 1e-9);
+
+    auto sums = latest(engine, filtered.value());
+    expect_same(recompute(filtered_select, "host = 'x' AND value >= 10", "endpoint", *sums), sums->result);
+    ASSERT_EQ(sums->result.series.size(), 4u);
+    EXPECT_EQ(sums->result.series[0].labels, (label_set{{"endpoint", "/a"}}));
+}
+
+TEST_F(ContinuousQueryTest, WindowsExpireAndLateSamplesAreDropped) {
+    continuous_query_engine engine(*storage_);
+    continuous_query_options options;
+    options.window = std::chrono::seconds(30);
+    options.resolution = std::chrono::seconds(1);
+    auto id = engine.register_query("SELECT count(http_latency) GROUP BY host", options);
+    ASSERT_TRUE(id.is_ok());
+
+    ingest(0, 100);
+    auto full = latest(engine, id.value());
+    ASSERT_EQ(full->result.series.size(), 2u);
+    EXPECT_DOUBLE_EQ(full->result.series[0].values[0], 60.0);  // host x: two series x 30 s
+    EXPECT_DOUBLE_EQ(full->result.series[1].values[0], 30.0);
+
+    // Samples before the window are counted as late and not applied
+    const auto before = engine.get_stats();
+    ingest(10, 20);
+    const auto after = engine.get_stats();
+    EXPECT_EQ(after.late_samples - before.late_samples, 30u);
+    EXPECT_EQ(latest(engine, id.value())->version, full->version);
+
+    // Without new samples the window slides on advance()
+    engine.advance(at(115));
+    auto partial = latest(engine, id.value());
+    EXPECT_DOUBLE_EQ(partial->result.series[0].values[0], 2.0 * 14);  // [86 s, 116 s) holds 86..99
+    engine.advance(at(200));
+    EXPECT_TRUE(latest(engine, id.value())->result.series.empty());
+    EXPECT_EQ(engine.get_stats().queries, 1u);
+}
+
+TEST_F(ContinuousQueryTest, RejectsQueriesThatCannotSlide) {
+    continuous_query_engine engine(*storage_);
+    for (const char* query : {"SELECT http_latency", "SELECT avg(http_latency) GROUP BY time(1m)",
+                              "SELECT avg(http_latency) WHERE time >= now() - 1h",
+                              "SELECT avg(http_latency) WHERE value > now()",
+                              "SELECT avg(http_latency) ORDER BY value DESC", "SELECT avg(http_latency) LIMIT 3",
+                              "SELECT avg('http_latency{host=~\"(\"}')", "not a query"}) {
+        EXPECT_TRUE(engine.register_query(query).is_err()) << query;
+    }
+    continuous_query_options options;
+    options.resolution = options.window * 2;
+    EXPECT_TRUE(engine.register_query("SELECT avg(http_latency)", options).is_err());
+
+    auto id = engine.register_query("SELECT avg(http_latency)");
+    ASSERT_TRUE(id.is_ok());
+    EXPECT_TRUE(engine.remove_query(id.value()).is_ok());
+    EXPECT_TRUE(engine.remove_query(id.value()).is_err());
+    EXPECT_TRUE(engine.latest(id.value()).is_err());
+
+    // Removed queries no longer receive samples
+    ingest(0, 10);
+    EXPECT_EQ(engine.get_stats().samples_applied, 0u);
+}
+
+TEST_F(ContinuousQueryTest, FedByAggregationProcessorObservations) {
+    continuous_query_engine engine;
+    aggregation_processor processor;
+    const size_t observer = processor.add_ingest_observer(engine.observer());
+    auto id = engine.register_query("SELECT sum(response_time), count(response_time)");
+    ASSERT_TRUE(id.is_ok());
+
+    for (int i = 1; i <= 10; ++i) {
+        ASSERT_TRUE(processor.process_observation("response_time", i).is_ok());
+    }
+    auto snapshot = latest(engine, id.value());
+    ASSERT_EQ(snapshot->result.series.size(), 2u);
+    EXPECT_DOUBLE_EQ(snapshot->result.series[0].values[0], 55.0);
+    EXPECT_DOUBLE_EQ(snapshot->result.series[1].values[0], 10.0);
+
+    processor.remove_ingest_observer(observer);
+    ASSERT_TRUE(processor.process_observation("response_time", 100).is_ok());
+    EXPECT_EQ(latest(engine, id.value())->version, snapshot->version);
+}
+
+TEST_F(ContinuousQueryTest, ReadersPollWhileBackgroundFlushesIngest) {
+    metric_storage_config config;
+    config.ring_buffer_capacity = 1 << 10;
+    config.flush_interval = std::chrono::milliseconds(5);
+    metric_storage storage(config);
+
+    continuous_query_engine engine(storage);
+    continuous_query_options options;
+    options.window = std::chrono::seconds(10);
+    options.resolution = std::chrono::milliseconds(500);
+    auto id = engine.register_query("SELECT count(load), max(load) GROUP BY core", options);
+    ASSERT_TRUE(id.is_ok());
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    std::atomic<size_t> reads{0};
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last_version = 0;
+            while (!done.load()) {
+                auto snapshot = engine.latest(id.value());
+                ASSERT_TRUE(snapshot.is_ok());
+                EXPECT_GE(snapshot.value()->version, last_version);
+                last_version = snapshot.value()->version;
+                reads.fetch_add(1);
+            }
+        });
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_TRUE(storage.store_metric("load{core=\"" + std::to_string(i % 4) + "\"}", i).is_ok());
+    }
+    storage.flush();
+    done.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    auto snapshot = engine.latest(id.value());
+    ASSERT_TRUE(snapshot.is_ok());
+    ASSERT_EQ(snapshot.value()->result.series.size(), 8u);
+    double total = 0;
+    for (size_t core = 0; core < 4; ++core) {
+        total += snapshot.value()->result.series[core].values[0];
+    }
+    EXPECT_DOUBLE_EQ(total, 2000.0);
+    EXPECT_GT(reads.load(), 0u);
+}
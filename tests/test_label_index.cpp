@@ -0,0 +1,218 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/utils/label_index.h>
+#include <kcenon/monitoring/utils/metric_storage.h>
+#include <kcenon/monitoring/core/performance_monitor.h>
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+const std::vector<std::string> services = {"auth", "billing", "checkout", "search"};
+const std::vector<std::string> endpoints = {"/api/login", "/api/logout", "/api/v2/items", "/health", "/metrics"};
+
+label_set make_labels(int i) {
+    label_set labels = {{"service", services[i % services.size()]},
+                        {"endpoint", endpoints[(i / 4) % endpoints.size()]},
+                        {"instance", "host-" + std::to_string(i % 1009)}};
+    if (i % 3 == 0) {
+        labels.emplace_back("canary", "true");
+    }
+    return labels;
+}
+
+// Reference semantics: an absent label behaves like an empty value
+bool brute_force_matches(const label_set& labels, const std::vector<label_matcher>& matchers) {
+    for (const auto& m : matchers) {
+        std::string value;
+        for (const auto& [name, v] : labels) {
+            if (name == m.name) {
+                value = v;
+            }
+        }
+        bool ok = false;
+        switch (m.type) {
+            case label_match_type::equal: ok = value == m.value; break;
+            case label_match_type::not_equal: ok = value != m.value; break;
+            case label_match_type::regex: ok = std::regex_match(value, std::regex(m.value)); break;
+            case label_match_type::not_regex: ok = !std::regex_match(value, std::regex(m.value)); break;
+            case label_match_type::prefix: ok = value.rfind(m.value, 0) == 0; break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(LabelIndexTest, ParsesSelectors) {
+    auto parsed = parse_label_selector(R"( http_requests_total { service="auth", endpoint =~ "/api/.*",code!~'5..' , env!="dev\"x"} )");
+    ASSERT_TRUE(parsed.is_ok());
+    const auto& m = parsed.value();
+    ASSERT_EQ(m.size(), 5u);
+    EXPECT_EQ(m[0].name, "__name__");
+    EXPECT_EQ(m[0].value, "http_requests_total");
+    EXPECT_EQ(m[1].type, label_match_type::equal);
+    EXPECT_EQ(m[2].type, label_match_type::regex);
+    EXPECT_EQ(m[2].value, "/api/.*");
+    EXPECT_EQ(m[3].type, label_match_type::not_regex);
+    EXPECT_EQ(m[3].value, "5..");
+    EXPECT_EQ(m[4].type, label_match_type::not_equal);
+    EXPECT_EQ(m[4].value, "dev\"x");
+
+    EXPECT_TRUE(parse_label_selector("cpu_usage").is_ok());
+    EXPECT_TRUE(parse_label_selector("{}").is_err());
+    EXPECT_TRUE(parse_label_selector("{service=auth}").is_err());
+    EXPECT_TRUE(parse_label_selector("{service=\"auth\"").is_err());
+    EXPECT_TRUE(parse_label_selector("{service~\"auth\"}").is_err());
+    EXPECT_TRUE(parse_label_selector("cpu extra").is_err());
+}
+
+TEST(LabelIndexTest, SelectionMatchesBruteForce) {
+    label_index index;
+    std::vector<label_set> all;
+    for (int i = 0; i < 3000; ++i) {
+        all.push_back(make_labels(i));
+        EXPECT_EQ(index.add(all.back()), static_cast<series_id>(i));
+    }
+    EXPECT_EQ(index.size(), 3000u);
+
+    const std::vector<std::string> selectors = {
+        R"({service="auth"})",
+        R"({service="auth", endpoint=~"/api/.*"})",
+        "{endpoint=~\"/api/log(in|out)\", instance=\"host-3\"}",
+        R"({service!="auth", canary="true"})",
+        R"({canary=""})",
+        R"({canary!=""})",
+        R"({service=~"a.*|s.*", endpoint!~"/api/.*"})",
+        R"({instance=~"host-1.?"})",
+        R"({service=~".*"})",
+        R"({service="nope"})",
+        R"({missing=~".+"})",
+        R"({missing="", service="search"})",
+        R"({endpoint=~"/health"})",
+    };
+    for (const auto& text : selectors) {
+        auto matchers = parse_label_selector(text);
+        ASSERT_TRUE(matchers.is_ok()) << text;
+        auto selected = index.select(matchers.value());
+        ASSERT_TRUE(selected.is_ok()) << text;
+
+        std::vector<series_id> expected;
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (brute_force_matches(all[i], matchers.value())) {
+                expected.push_back(static_cast<series_id>(i));
+            }
+        }
+        EXPECT_EQ(selected.value(), expected) << text;
+    }
+
+    std::vector<label_matcher> prefix = {{"instance", label_match_type::prefix, "host-2"},
+                                         {"service", label_match_type::equal, "billing"}};
+    std::vector<series_id> expected;
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (brute_force_matches(all[i], prefix)) {
+            expected.push_back(static_cast<series_id>(i));
+        }
+    }
+    EXPECT_EQ(index.select(prefix).value(), expected);
+}
+
+TEST(LabelIndexTest, RemoveKeepsPostingsConsistent) {
+    label_index index;
+    for (int i = 0; i < 200; ++i) {
+        index.add(make_labels(i));
+    }
+    EXPECT_EQ(index.add(make_labels(5)), 5u);
+    EXPECT_EQ(index.find(make_labels(7)).value(), 7u);
+
+    for (series_id id = 0; id < 200; id += 2) {
+        EXPECT_TRUE(index.remove(id));
+    }
+    EXPECT_FALSE(index.remove(0));
+    EXPECT_FALSE(index.remove(1000));
+    EXPECT_EQ(index.size(), 100u);
+    EXPECT_FALSE(index.find(make_labels(0)).has_value());
+    EXPECT_FALSE(index.labels(0).has_value());
+
+    // Even ids covered services auth and checkout, which are now gone
+    EXPECT_EQ(index.label_values("service"), (std::vector<std::string>{"billing", "search"}));
+    auto selected = index.select(parse_label_selector(R"({service=~"auth|billing"})").value());
+    ASSERT_TRUE(selected.is_ok());
+    EXPECT_EQ(selected.value().size(), 50u);
+    for (series_id id : selected.value()) {
+        EXPECT_EQ(id % 4, 1u);
+    }
+
+    // Re-adding a removed label set allocates a fresh id
+    EXPECT_EQ(index.add(make_labels(0)), 200u);
+    EXPECT_EQ(index.label_names(), (std::vector<std::string>{"canary", "endpoint", "instance", "service"}));
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.add(make_labels(0)), 0u);
+}
+
+TEST(LabelIndexTest, InvalidRegexIsReported) {
+    label_index index;
+    index.add(make_labels(0));
+    auto result = index.select({{"service", label_match_type::regex, "(unclosed"}});
+    EXPECT_TRUE(result.is_err());
+}
+
+TEST(LabelIndexTest, PerformanceMonitorFindsTaggedMetrics) {
+    performance_monitor monitor("label_index_test");
+    for (int i = 0; i < 100; ++i) {
+        tag_map tags = {{"service", services[i % services.size()]},
+                        {"endpoint", endpoints[i % endpoints.size()]}};
+        ASSERT_TRUE(monitor.record_counter("requests_total", 1.0, tags).is_ok());
+        ASSERT_TRUE(monitor.record_gauge("latency_ms", i * 1.0, tags).is_ok());
+    }
+
+    auto found = monitor.find_tagged_metrics(
+        parse_label_selector(R"(requests_total{service="auth", endpoint=~"/api/.*"})").value());
+    ASSERT_TRUE(found.is_ok());
+    // Each (service, endpoint) pair recurs every 20 samples; auth sees three /api/ endpoints
+    ASSERT_EQ(found.value().size(), 3u);
+    for (const auto& metric : found.value()) {
+        EXPECT_EQ(metric.name, "requests_total");
+        EXPECT_EQ(metric.tags.at("service"), "auth");
+        EXPECT_EQ(metric.value, 5.0);
+    }
+
+    auto latency = monitor.find_tagged_metrics({{"__name__", label_match_type::equal, "latency_ms"}});
+    ASSERT_TRUE(latency.is_ok());
+    EXPECT_EQ(latency.value().size(), 20u);
+
+    monitor.clear_all_metrics();
+    EXPECT_TRUE(monitor.find_tagged_metrics({{"__name__", label_match_type::regex, ".+"}}).value().empty());
+}
+
+TEST(LabelIndexTest, MetricStorageSelectsMetricNames) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    metric_storage storage(config);
+    for (const auto* name : {"cpu_usage", "cpu_temperature", "memory_usage", "disk_io"}) {
+        ASSERT_TRUE(storage.store_metric(name, 1.0).is_ok());
+    }
+    storage.flush();
+
+    auto names = storage.select_metric_names(parse_label_selector(R"({__name__=~"cpu_.*"})").value());
+    ASSERT_TRUE(names.is_ok());
+    std::sort(names.value().begin(), names.value().end());
+    EXPECT_EQ(names.value(), (std::vector<std::string>{"cpu_temperature", "cpu_usage"}));
+
+    storage.clear();
+    EXPECT_TRUE(storage.select_metric_names(parse_label_selector("cpu_usage").value()).value().empty());
+}
@@ -283,7 +283,7 @@ TEST_F(MetricExportersTest, StatsDExporterBasicFunctionality) {
     config.port = 8125;
     config.format = metric_export_format::statsd_plain;
     
-    statsd_exporter exporter(config);
+    statsd_exporter exporter(config, create_stub_udp_transport());
     
     // Export monitoring data
     std::vector<monitoring_data> data_batch = {test_data_};
@@ -448,7 +448,7 @@ TEST_F(MetricExportersTest, LargeMetricBatch) {
     config.format = metric_export_format::statsd_plain;
     config.max_batch_size = 50; // Smaller than batch size
     
-    statsd_exporter exporter(config);
+    statsd_exporter exporter(config, create_stub_udp_transport());
     auto result = exporter.export_metrics(large_batch);
     EXPECT_TRUE(result.is_ok());
     
@@ -601,7 +601,7 @@ TEST(UdpTransportTest, DefaultTransportCreation) {
     auto transport = create_default_udp_transport();
     ASSERT_TRUE(transport);
     EXPECT_TRUE(transport->is_available());
-    // Default transport should work (either stub or network)
+    // Default transport should work (socket, network or stub)
 }
 
 // ============================================================================
@@ -953,4 +953,177 @@ TEST_F(MetricExportersTest, OtlpExporterWithCustomGrpcTransport) {
 
     auto stats = exporter.get_stats();
     EXPECT_GT(stats["transport_requests_sent"], 0);
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Prometheus series registry (pre-rendered exposition)
+// ============================================================================
+
+TEST_F(MetricExportersTest, PrometheusSnapshotExportDeduplicatesSeries) {
+    metric_export_config config;
+    config.endpoint = "http://prometheus:9090";
+    config.format = metric_export_format::prometheus_text;
+
+    prometheus_exporter exporter(config);
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(exporter.export_snapshot(test_snapshot_).is_ok());
+    }
+
+    auto stats = exporter.get_stats();
+    EXPECT_EQ(stats["current_metrics_count"], 5u);
+    EXPECT_EQ(stats["current_families_count"], 5u);
+
+    // A changed value rewrites only the value text of that series
+    test_snapshot_.metrics[2].value = 70.25;
+    ASSERT_TRUE(exporter.export_snapshot(test_snapshot_).is_ok());
+    auto text = exporter.get_metrics_text();
+    EXPECT_NE(text.find("disk_usage_percent{"), std::string::npos);
+    EXPECT_NE(text.find(" 70.25 "), std::string::npos);
+    EXPECT_EQ(text.find(" 68.3 "), std::string::npos);
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 5u);
+    EXPECT_EQ(exporter.get_stats()["exposition_bytes"], text.size());
+}
+
+TEST_F(MetricExportersTest, PrometheusExportMetricsReplacesSeries) {
+    metric_export_config config;
+    config.endpoint = "http://prometheus:9090";
+    config.format = metric_export_format::prometheus_text;
+
+    prometheus_exporter exporter(config);
+
+    monitoring_data first("api");
+    first.add_metric("requests_total", 1.0);
+    first.add_metric("queue_depth", 4.0);
+    ASSERT_TRUE(exporter.export_metrics({first}).is_ok());
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 2u);
+
+    monitoring_data second("api");
+    second.add_metric("requests_total", 2.0);
+    ASSERT_TRUE(exporter.export_metrics({second}).is_ok());
+
+    auto text = exporter.get_metrics_text();
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 1u);
+    EXPECT_EQ(text.find("queue_depth"), std::string::npos);
+    EXPECT_EQ(text,
+              "# HELP requests_total Metric from api\n"
+              "# TYPE requests_total counter\n"
+              "requests_total{component=\"api\"} 2 " +
+              std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+                  second.get_timestamp().time_since_epoch()).count()) + "\n");
+}
+
+TEST_F(MetricExportersTest, PrometheusSweepsEachSourceAgainstItsOwnExport) {
+    metric_export_config config;
+    config.endpoint = "http://prometheus:9090";
+    config.format = metric_export_format::prometheus_text;
+
+    prometheus_exporter exporter(config);
+
+    monitoring_data batch("api");
+    batch.add_metric("requests_total", 1.0);
+    ASSERT_TRUE(exporter.export_metrics({batch}).is_ok());
+    ASSERT_TRUE(exporter.export_snapshot(test_snapshot_).is_ok());
+
+    metrics_snapshot other;
+    other.source_id = "agent";
+    other.add_metric("agent_up", 1.0);
+    ASSERT_TRUE(exporter.export_snapshot(other).is_ok());
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 7u);
+
+    // A batch export keeps every snapshot series
+    ASSERT_TRUE(exporter.export_metrics({batch}).is_ok());
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 7u);
+
+    // A snapshot drops only the series its own source stopped reporting
+    test_snapshot_.metrics.pop_back();
+    ASSERT_TRUE(exporter.export_snapshot(test_snapshot_).is_ok());
+    auto text = exporter.get_metrics_text();
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 6u);
+    EXPECT_EQ(text.find("network_bytes_out"), std::string::npos);
+    EXPECT_NE(text.find("agent_up{source=\"agent\"}"), std::string::npos);
+    EXPECT_NE(text.find("requests_total{component=\"api\"}"), std::string::npos);
+
+    ASSERT_TRUE(exporter.export_metrics({}).is_ok());
+    EXPECT_EQ(exporter.get_stats()["current_metrics_count"], 5u);
+}
+
+TEST(PrometheusSeriesRegistryTest, GroupsFamiliesAndSortsLabels) {
+    prometheus_series_registry registry;
+
+    prometheus_metric_data metric;
+    metric.name = "http_requests_total";
+    metric.type = metric_type::counter;
+    metric.help_text = "Requests";
+    metric.value = 3;
+    metric.labels = {{"status", "200"}, {"method", "GET"}};
+    registry.upsert(metric);
+
+    metric.labels = {{"status", "500"}, {"method", "say \"hi\"\n"}};
+    metric.value = 1;
+    registry.upsert(metric);
+
+    std::string text;
+    EXPECT_EQ(registry.render(text), registry.byte_size());
+    EXPECT_EQ(text,
+              "# HELP http_requests_total Requests\n"
+              "# TYPE http_requests_total counter\n"
+              "http_requests_total{method=\"GET\",status=\"200\"} 3\n"
+              "http_requests_total{method=\"say \\\"hi\\\"\\n\",status=\"500\"} 1\n");
+    EXPECT_EQ(registry.series_count(), 2u);
+    EXPECT_EQ(registry.family_count(), 1u);
+
+    // Only the first series is refreshed; the sweep drops the other one
+    registry.begin_generation();
+    metric.labels = {{"method", "GET"}, {"status", "200"}};
+    metric.value = 4;
+    registry.upsert(metric);
+    EXPECT_EQ(registry.sweep(), 1u);
+
+    registry.render(text);
+    EXPECT_EQ(text,
+              "# HELP http_requests_total Requests\n"
+              "# TYPE http_requests_total counter\n"
+              "http_requests_total{method=\"GET\",status=\"200\"} 4\n");
+    EXPECT_EQ(registry.byte_size(), text.size());
+
+    registry.begin_generation();
+    EXPECT_EQ(registry.sweep(), 1u);
+    EXPECT_EQ(registry.family_count(), 0u);
+    EXPECT_EQ(registry.byte_size(), 0u);
+    registry.render(text);
+    EXPECT_TRUE(text.empty());
+}
+
+TEST(PrometheusSeriesRegistryTest, ScrapeReusesBufferForManySeries) {
+    prometheus_series_registry registry;
+
+    prometheus_metric_data metric;
+    metric.type = metric_type::gauge;
+    metric.help_text = "Per-shard gauge";
+    for (int family = 0; family < 20; ++family) {
+        metric.name = "shard_metric_" + std::to_string(family);
+        for (int i = 0; i < 10000; ++i) {
+            metric.labels = {{"shard", std::to_string(i)}, {"region", "eu"}};
+            metric.value = i * 0.5;
+            registry.upsert(metric);
+        }
+    }
+    EXPECT_EQ(registry.series_count(), 200000u);
+    EXPECT_EQ(registry.family_count(), 20u);
+
+    std::string buffer;
+    registry.render(buffer);
+    EXPECT_EQ(buffer.size(), registry.byte_size());
+    const auto* data = buffer.data();
+
+    // Updating values keeps the exposition size exact and the buffer reusable
+    metric.name = "shard_metric_3";
+    metric.labels = {{"shard", "7"}, {"region", "eu"}};
+    metric.value = 1.0;
+    registry.upsert(metric);
+    registry.render(buffer);
+    EXPECT_EQ(buffer.size(), registry.byte_size());
+    EXPECT_EQ(buffer.data(), data);
+    EXPECT_NE(buffer.find("shard_metric_3{region=\"eu\",shard=\"7\"} 1\n"), std::string::npos);
+}
@@ -0,0 +1,491 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/utils/metric_query_engine.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+constexpr int sample_count = 600;
+
+class MetricQueryEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        metric_storage_config config;
+        config.enable_background_processing = false;
+        config.ring_buffer_capacity = 1 << 12;
+        storage_ = std::make_unique<metric_storage>(config);
+
+        // One sample per second over ten minutes, starting on a 10 minute boundary
+        const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        base_ = (now - 1800) / 600 * 600;
+
+        ingest("cpu_usage", [](int i) { return static_cast<double>(i); });
+        ingest("requests_total", [](int i) { return 2.0 * (i % 300); });  // Counter reset halfway
+        ingest(R"(http_latency{host="a",service="api"})", [](int i) { return static_cast<double>(i % 10); });
+        ingest(R"(http_latency{host="b",service="api"})", [](int i) { return 100.0 + i % 10; });
+        ingest(R"(http_latency{host="a",service="web"})", [](int) { return 5.0; });
+    }
+
+    template<typename Fn>
+    void ingest(const std::string& name, Fn value_at) {
+        // Registers the name; the sample lands at now(), outside queried ranges
+        ASSERT_TRUE(storage_->store_metric(name, 0.0).is_ok());
+
+        metric_batch batch;
+        const auto metadata = create_metric_metadata(name, metric_type::gauge);
+        for (int i = 0; i < sample_count; ++i) {
+            compact_metric_value metric(metadata, value_at(i));
+            metric.timestamp_us = static_cast<uint64_t>((base_ + i) * 1000000);
+            batch.add_metric(std::move(metric));
+        }
+        ASSERT_EQ(storage_->store_metrics_batch(batch), static_cast<size_t>(sample_count));
+        storage_->flush();
+    }
+
+    std::string range(int from = 0, int to = sample_count) const {
+        return "time >= " + std::to_string(base_ + from) + " AND time < " + std::to_string(base_ + to);
+    }
+
+    std::chrono::system_clock::time_point at(int64_t offset) const {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(base_ + offset));
+    }
+
+    query_result run(const std::string& query, query_hints hints = {}) {
+        metric_query_engine engine(*storage_, hints);
+        auto result = engine.query(query);
+        EXPECT_TRUE(result.is_ok()) << query << ": " << (result.is_err() ? result.error().message : "");
+        return result.is_ok() ? result.value() : query_result{};
+    }
+
+    std::unique_ptr<metric_storage> storage_;
+    int64_t base_ = 0;
+};
+
+} // namespace
+
+TEST(MetricQueryParserTest, ParsesFullQuery) {
+    query_parser parser;
+    auto parsed = parser.parse(
+        "select AVG(cpu_usage), percentile('http_latency{service=\"api\"}', 99) "
+        "WHERE value > 2 * 5 AND host = 'a' AND time >= now() - 1h "
+        "GROUP BY time(30s), host ORDER BY value DESC LIMIT 5");
+    ASSERT_TRUE(parsed.is_ok()) << parsed.error().message;
+
+    const auto& query = parsed.value();
+    ASSERT_EQ(query.select.size(), 2u);
+    EXPECT_EQ(query.select[0].column_name(), "avg(cpu_usage)");
+    EXPECT_EQ(query.select[1].aggregation, aggregation_function::percentile);
+    EXPECT_DOUBLE_EQ(query.select[1].argument, 99.0);
+    EXPECT_EQ(query.select[1].source, R"(http_latency{service="api"})");
+    ASSERT_TRUE(query.where_clause);
+    EXPECT_EQ(to_string(*query.where_clause),
+              "(((value > (2 * 5)) AND (host = 'a')) AND (time >= (now() - 3600)))");
+    EXPECT_EQ(query.group_by_time, std::chrono::milliseconds(30000));
+    EXPECT_EQ(query.group_by_tags, std::vector<std::string>{"host"});
+    ASSERT_TRUE(query.order_by);
+    EXPECT_EQ(query.order_by->column, "value");
+    EXPECT_FALSE(query.order_by->ascending);
+    EXPECT_EQ(query.limit, 5u);
+}
+
+TEST(MetricQueryParserTest, RejectsMalformedQueries) {
+    query_parser parser;
+    for (const char* query : {"", "avg(cpu)", "SELECT", "SELECT median(cpu)", "SELECT cpu WHERE",
+                              "SELECT cpu GROUP BY time(0s)", "SELECT cpu LIMIT -1", "SELECT cpu ORDER BY host",
+                              "SELECT max(value)", "SELECT cpu WHERE value > 'open", "SELECT cpu extra",
+                              "SELECT cpu GROUP BY time(5x)"}) {
+        EXPECT_TRUE(parser.parse(query).is_err()) << query;
+    }
+}
+
+TEST(MetricQueryParserTest, ParsesTimestamps) {
+    using std::chrono::seconds;
+    const auto epoch = std::chrono::system_clock::time_point();
+    EXPECT_EQ(detail::parse_timestamp("1970-01-02"), epoch + seconds(86400));
+    EXPECT_EQ(detail::parse_timestamp("2000-03-01T00:00:00Z"), epoch + seconds(951868800));
+    EXPECT_EQ(detail::parse_timestamp("1970-01-01 01:00:00+01:00"), epoch);
+    EXPECT_EQ(detail::parse_timestamp("1970-01-01T00:00:01.5Z"), epoch + std::chrono::milliseconds(1500));
+    EXPECT_FALSE(detail::parse_timestamp("1970-13-01"));
+    EXPECT_FALSE(detail::parse_timestamp("yesterday"));
+}
+
+TEST_F(MetricQueryEngineTest, AggregatesByTimeBucket) {
+    const std::string query = "SELECT avg(cpu_usage), count(cpu_usage) WHERE " + range() + " GROUP BY time(1m)";
+    auto result = run(query);
+    ASSERT_EQ(result.series.size(), 2u);
+
+    const auto& avg = result.series[0];
+    EXPECT_EQ(avg.name, "avg(cpu_usage)");
+    ASSERT_EQ(avg.size(), 10u);
+    for (size_t k = 0; k < avg.size(); ++k) {
+        EXPECT_EQ(avg.timestamps[k], at(60 * static_cast<int64_t>(k)));
+        EXPECT_DOUBLE_EQ(avg.values[k], 60.0 * k + 29.5);
+        EXPECT_DOUBLE_EQ(result.series[1].values[k], 60.0);
+    }
+
+    // Chunks (256 points) inside one bucket are folded from their summaries
+    // and give the same result as decoding every point
+    query_hints decode_all;
+    decode_all.optimize_aggregations = false;
+    for (const char* step : {"1m", "5m"}) {
+        const std::string bucketed = "SELECT avg(cpu_usage), min(cpu_usage), delta(cpu_usage) WHERE " + range() +
+                                     " GROUP BY time(" + step + ")";
+        auto summarized = run(bucketed);
+        auto decoded = run(bucketed, decode_all);
+        EXPECT_EQ(decoded.points_summarized, 0u);
+        EXPECT_EQ(decoded.points_scanned, 3u * sample_count);
+        ASSERT_EQ(summarized.series.size(), 3u);
+        ASSERT_EQ(decoded.series.size(), 3u);
+        for (size_t i = 0; i < 3; ++i) {
+            EXPECT_EQ(summarized.series[i].values, decoded.series[i].values) << step;
+            EXPECT_EQ(summarized.series[i].timestamps, decoded.series[i].timestamps) << step;
+        }
+        EXPECT_EQ(summarized.points_summarized, std::string(step) == "5m" ? 3u * 256 : 0u) << step;
+    }
+}
+
+TEST_F(MetricQueryEngineTest, AggregationsMatchBruteForce) {
+    std::vector<double> selected;
+    for (int i = 0; i < sample_count; ++i) {
+        if (i > 100 && i % 3 != 0) {
+            selected.push_back(i);
+        }
+    }
+    const double n = static_cast<double>(selected.size());
+    const double sum = std::accumulate(selected.begin(), selected.end(), 0.0);
+    double m2 = 0.0;
+    for (double v : selected) {
+        m2 += (v - sum / n) * (v - sum / n);
+    }
+
+    const std::string filter = " WHERE value > 100 AND value % 3 != 0 AND " + range();
+    auto single = [&](const std::string& function) {
+        auto result = run("SELECT " + function + filter);
+        EXPECT_EQ(result.series.size(), 1u) << function;
+        EXPECT_EQ(result.series.empty() ? 0u : result.series[0].size(), 1u) << function;
+        return result.series.empty() || result.series[0].values.empty() ? NAN : result.series[0].values[0];
+    };
+    EXPECT_DOUBLE_EQ(single("sum(cpu_usage)"), sum);
+    EXPECT_DOUBLE_EQ(single("count(cpu_usage)"), n);
+    EXPECT_DOUBLE_EQ(single("min(cpu_usage)"), selected.front());
+    EXPECT_DOUBLE_EQ(single("max(cpu_usage)"), selected.back());
+    EXPECT_DOUBLE_EQ(single("mean(cpu_usage)"), sum / n);
+    EXPECT_NEAR(single("variance(cpu_usage)"), m2 / n, 1e-6);
+    EXPECT_NEAR(single("stddev(cpu_usage)"), std::sqrt(m2 / n), 1e-9);
+    EXPECT_DOUBLE_EQ(single("percentile(cpu_usage, 90)"),
+                     selected[static_cast<size_t>(std::ceil(0.9 * n)) - 1]);
+}
+
+TEST_F(MetricQueryEngineTest, RateDeltaAndIntegralArePerSeries) {
+    auto result = run("SELECT rate(requests_total), delta(requests_total), integral(cpu_usage) WHERE " + range());
+    ASSERT_EQ(result.series.size(), 3u);
+
+    // 2 per second except across the reset, where the new value (0) counts
+    const double increase = 2.0 * (sample_count - 2);
+    EXPECT_DOUBLE_EQ(result.series[0].values.at(0), increase / (sample_count - 1));
+    EXPECT_DOUBLE_EQ(result.series[1].values.at(0), 2.0 * 299);
+    EXPECT_DOUBLE_EQ(result.series[2].values.at(0), (sample_count - 1) * (sample_count - 1) / 2.0);
+
+    // Per-series values are summed across a group
+    auto grouped = run("SELECT delta('http_latency{service=\"api\"}') WHERE " + range(0, 10));
+    ASSERT_EQ(grouped.series.size(), 1u);
+    EXPECT_DOUBLE_EQ(grouped.series[0].values.at(0), 18.0);
+}
+
+TEST_F(MetricQueryEngineTest, GroupsByLabelsWithPushedDownPredicates) {
+    const std::string query = "SELECT max(http_latency), min(http_latency) WHERE service = 'api' AND " + range() +
+                              " GROUP BY host";
+    auto result = run(query);
+    EXPECT_EQ(result.series_scanned, 4u);  // Two selected series per column
+    ASSERT_EQ(result.series.size(), 4u);
+    EXPECT_EQ(result.series[0].labels, (label_set{{"host", "a"}}));
+    EXPECT_DOUBLE_EQ(result.series[0].values.at(0), 9.0);
+    EXPECT_EQ(result.series[1].labels, (label_set{{"host", "b"}}));
+    EXPECT_DOUBLE_EQ(result.series[1].values.at(0), 109.0);
+    EXPECT_EQ(result.series[2].name, "min(http_latency)");
+    EXPECT_DOUBLE_EQ(result.series[3].values.at(0), 100.0);
+
+    metric_query_engine engine(*storage_);
+    auto plan = engine.explain(query);
+    ASSERT_TRUE(plan.is_ok());
+    EXPECT_NE(plan.value().find(R"(service="api")"), std::string::npos) << plan.value();
+    EXPECT_NE(plan.value().find("optimization: time range push-down"), std::string::npos);
+    EXPECT_NE(plan.value().find("optimization: label predicate push-down"), std::string::npos);
+    EXPECT_EQ(plan.value().find("filter"), std::string::npos);
+
+    // Labels elsewhere cannot be evaluated per row
+    EXPECT_TRUE(engine.query("SELECT max(http_latency) WHERE host = 'a' OR value > 1").is_err());
+    EXPECT_TRUE(engine.query("SELECT max(http_latency) WHERE host > 1").is_err());
+}
+
+TEST_F(MetricQueryEngineTest, RawSelectOrdersAndLimits) {
+    auto result = run("SELECT cpu_usage WHERE " + range() + " ORDER BY value DESC LIMIT 3");
+    ASSERT_EQ(result.series.size(), 1u);
+    EXPECT_EQ(result.series[0].name, "cpu_usage");
+    EXPECT_EQ(result.series[0].values, (std::vector<double>{599, 598, 597}));
+    EXPECT_EQ(result.series[0].timestamps.front(), at(599));
+
+    auto labelled = run("SELECT 'http_latency{service=\"web\"}' WHERE " + range(10, 20) + " ORDER BY time DESC");
+    ASSERT_EQ(labelled.series.size(), 1u);
+    EXPECT_EQ(labelled.series[0].name, "http_latency");
+    EXPECT_EQ(labelled.series[0].labels, (label_set{{"host", "a"}, {"service", "web"}}));
+    ASSERT_EQ(labelled.series[0].size(), 10u);
+    EXPECT_EQ(labelled.series[0].timestamps.front(), at(19));
+}
+
+TEST_F(MetricQueryEngineTest, FromClauseExpandsSources) {
+    auto result = run("SELECT max(value) FROM cpu_usage, requests_total WHERE " + range());
+    ASSERT_EQ(result.series.size(), 2u);
+    EXPECT_EQ(result.series[0].name, "max(cpu_usage)");
+    EXPECT_DOUBLE_EQ(result.series[0].values.at(0), 599.0);
+    EXPECT_DOUBLE_EQ(result.series[1].values.at(0), 598.0);
+}
+
+TEST_F(MetricQueryEngineTest, PreparedStatementsAndCustomFunctions) {
+    metric_query_engine engine(*storage_);
+    EXPECT_TRUE(engine.register_function("avg", [](const std::vector<double>&) { return 0.0; }).is_err());
+    ASSERT_TRUE(engine.register_function("double_it", [](const std::vector<double>& args) {
+        return args.at(0) * 2.0;
+    }).is_ok());
+
+    auto statement = engine.prepare("SELECT count(cpu_usage) WHERE double_it(value) > 1000 AND " + range());
+    ASSERT_TRUE(statement.is_ok());
+    for (int i = 0; i < 2; ++i) {
+        auto result = engine.execute_prepared(statement.value());
+        ASSERT_TRUE(result.is_ok());
+        EXPECT_DOUBLE_EQ(result.value().series.at(0).values.at(0), 99.0);
+    }
+    EXPECT_TRUE(engine.execute_prepared(statement.value() + 1).is_err());
+    EXPECT_TRUE(engine.query("SELECT count(cpu_usage) WHERE unknown(value) > 1").is_err());
+
+    const auto stats = engine.get_stats();
+    EXPECT_EQ(stats.total_queries, 3u);
+    EXPECT_EQ(stats.failed_queries, 1u);
+    EXPECT_EQ(stats.points_scanned, 2u * sample_count);
+}
+
+TEST_F(MetricQueryEngineTest, DefaultsToTheHourBeforeTheEndTime) {
+    // The registration samples at now() fall after the end time
+    auto result = run("SELECT count(cpu_usage) WHERE time < now() - 15m");
+    ASSERT_EQ(result.series.size(), 1u);
+    EXPECT_DOUBLE_EQ(result.series[0].values.at(0), sample_count);
+
+    // Every sample of the last hour, including the registration sample
+    auto recent = run("SELECT count(cpu_usage)");
+    ASSERT_EQ(recent.series.size(), 1u);
+    EXPECT_DOUBLE_EQ(recent.series[0].values.at(0), sample_count + 1.0);
+}
+
+TEST_F(MetricQueryEngineTest, ParallelResultsDoNotDependOnThreadCount) {
+    constexpr int fleet_size = 48;
+    for (int s = 0; s < fleet_size; ++s) {
+        const std::string name = "fleet_latency{instance=\"i" + std::to_string(s) + "\",service=\"s" +
+                                 std::to_string(s % 4) + "\"}";
+        ingest(name, [s](int i) { return 100.0 * std::sin(0.1 * i + s) + s / 3.0; });
+    }
+
+    const std::string query = "SELECT sum(fleet_latency), avg(fleet_latency), stddev(fleet_latency), "
+                              "rate(fleet_latency), percentile(fleet_latency, 95) WHERE value > -50 AND " +
+                              range() + " GROUP BY time(1m), service";
+    auto run_with = [&](bool parallel, size_t threads) {
+        query_hints hints;
+        hints.parallel_execution = parallel;
+        hints.max_parallel_tasks = threads;
+        hints.time_partition = std::chrono::minutes(2);
+        return run(query, hints);
+    };
+
+    const auto serial = run_with(false, 1);
+    EXPECT_EQ(serial.scan_tasks, 5u * fleet_size * 5);  // Five 2-minute partitions per series
+    ASSERT_EQ(serial.series.size(), 5u * 4);
+    for (const auto& series : serial.series) {
+        EXPECT_EQ(series.size(), 10u);
+    }
+    for (size_t threads : {2, 3, 8}) {
+        const auto parallel = run_with(true, threads);
+        EXPECT_EQ(parallel.points_scanned, serial.points_scanned);
+        ASSERT_EQ(parallel.series.size(), serial.series.size());
+        for (size_t i = 0; i < serial.series.size(); ++i) {
+            EXPECT_EQ(parallel.series[i].name, serial.series[i].name);
+            EXPECT_EQ(parallel.series[i].labels, serial.series[i].labels);
+            EXPECT_EQ(parallel.series[i].timestamps, serial.series[i].timestamps);
+            EXPECT_EQ(parallel.series[i].values, serial.series[i].values) << threads << " threads";
+        }
+    }
+}
+
+#if defined(__linux__)
+TEST_F(MetricQueryEngineTest, WorkerPoolStartsWithTheFirstParallelQuery) {
+    auto thread_count = [] {
+        size_t count = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator("/proc/self/task")) {
+            ++count;
+        }
+        return count;
+    };
+    const size_t before = thread_count();
+
+    // The default hints run queries on the calling thread
+    metric_query_engine serial(*storage_);
+    EXPECT_FALSE(serial.hints().parallel_execution);
+    ASSERT_TRUE(serial.query("SELECT avg(http_latency) WHERE " + range()).is_ok());
+    EXPECT_EQ(thread_count(), before);
+
+    query_hints hints;
+    hints.parallel_execution = true;
+    hints.max_parallel_tasks = 4;
+    metric_query_engine parallel(*storage_, hints);
+    EXPECT_EQ(thread_count(), before);
+    ASSERT_TRUE(parallel.query("SELECT avg(http_latency) WHERE " + range()).is_ok());
+    EXPECT_EQ(thread_count(), before + 3);
+}
+#endif
+
+TEST_F(MetricQueryEngineTest, TimePartitionsJoinRangeWideBuckets) {
+    query_hints hints;
+    hints.parallel_execution = true;
+    hints.max_parallel_tasks = 4;
+    hints.time_partition = std::chrono::seconds(40);
+
+    auto result = run("SELECT rate(requests_total), delta(requests_total), integral(cpu_usage), "
+                      "count(cpu_usage) WHERE " + range(), hints);
+    EXPECT_EQ(result.scan_tasks, 4u * 15);
+    ASSERT_EQ(result.series.size(), 4u);
+    EXPECT_DOUBLE_EQ(result.series[0].values.at(0), 2.0 * (sample_count - 2) / (sample_count - 1));
+    EXPECT_DOUBLE_EQ(result.series[1].values.at(0), 2.0 * 299);
+    EXPECT_DOUBLE_EQ(result.series[2].values.at(0), (sample_count - 1) * (sample_count - 1) / 2.0);
+    EXPECT_DOUBLE_EQ(result.series[3].values.at(0), sample_count);
+}
+
+TEST_F(MetricQueryEngineTest, CachedWindowsMatchFullComputation) {
+    query_hints uncached;
+    uncached.enable_cache = false;
+    metric_query_engine engine(*storage_);
+
+    auto window = [&](int shift) {
+        // Five minutes, deliberately not aligned to the one-minute buckets
+        return "SELECT avg(cpu_usage), max(http_latency), rate(requests_total) WHERE " +
+               range(7 + shift, 307 + shift) + " GROUP BY time(1m), host";
+    };
+    for (int step = 0; step < 5; ++step) {
+        auto cached = engine.query(window(60 * step));
+        ASSERT_TRUE(cached.is_ok());
+        const auto expected = run(window(60 * step), uncached);
+
+        ASSERT_EQ(cached.value().series.size(), expected.series.size());
+        for (size_t i = 0; i < expected.series.size(); ++i) {
+            EXPECT_EQ(cached.value().series[i].name, expected.series[i].name);
+            EXPECT_EQ(cached.value().series[i].labels, expected.series[i].labels);
+            EXPECT_EQ(cached.value().series[i].timestamps, expected.series[i].timestamps);
+            EXPECT_EQ(cached.value().series[i].values, expected.series[i].values) << "step " << step;
+        }
+
+        if (step == 0) {
+            EXPECT_EQ(cached.value().points_from_cache, 0u);
+        } else {
+            // Four of the five whole buckets are reused; only the edges and the new tail are scanned
+            EXPECT_GT(cached.value().points_from_cache, 0u);
+            EXPECT_LT(cached.value().points_scanned + cached.value().points_summarized,
+                      (expected.points_scanned + expected.points_summarized) / 2);
+        }
+    }
+
+    const auto stats = engine.get_stats();
+    EXPECT_EQ(stats.cache_misses, 1u);
+    EXPECT_EQ(stats.cache_hits, 4u);
+
+    // A different window length or filter is another entry
+    ASSERT_TRUE(engine.query("SELECT avg(cpu_usage), max(http_latency), rate(requests_total) WHERE " +
+                             range(7, 367) + " GROUP BY time(1m), host").is_ok());
+    EXPECT_EQ(engine.get_stats().cache_misses, 2u);
+}
+
+TEST_F(MetricQueryEngineTest, CachedDuplicateColumnsStaySeparate) {
+    query_hints uncached;
+    uncached.enable_cache = false;
+    metric_query_engine engine(*storage_);
+
+    auto window = [&](int shift) {
+        return "SELECT avg(http_latency), avg(http_latency), max(cpu_usage), avg(http_latency) WHERE " +
+               range(7 + shift, 307 + shift) + " GROUP BY time(1m), host";
+    };
+    for (int step = 0; step < 3; ++step) {
+        auto cached = engine.query(window(60 * step));
+        ASSERT_TRUE(cached.is_ok());
+        const auto expected = run(window(60 * step), uncached);
+
+        ASSERT_EQ(expected.series.size(), 7u);
+        ASSERT_EQ(cached.value().series.size(), expected.series.size());
+        for (size_t i = 0; i < expected.series.size(); ++i) {
+            EXPECT_EQ(expected.series[i].column, i < 2 ? 0u : i < 4 ? 1u : i < 5 ? 2u : 3u);
+            EXPECT_EQ(cached.value().series[i].column, expected.series[i].column);
+            EXPECT_EQ(cached.value().series[i].name, expected.series[i].name);
+            EXPECT_EQ(cached.value().series[i].labels, expected.series[i].labels);
+            EXPECT_EQ(cached.value().series[i].timestamps, expected.series[i].timestamps);
+            EXPECT_EQ(cached.value().series[i].values, expected.series[i].values) << "step " << step;
+        }
+    }
+    EXPECT_EQ(engine.get_stats().cache_hits, 2u);
+}
+
+TEST_F(MetricQueryEngineTest, CacheHonorsTtlAndSkipsUncacheableQueries) {
+    query_hints hints;
+    hints.cache_ttl = std::chrono::seconds(0);
+    metric_query_engine expiring(*storage_, hints);
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_TRUE(expiring.query("SELECT sum(cpu_usage) WHERE " + range() + " GROUP BY time(1m)").is_ok());
+    }
+    EXPECT_EQ(expiring.get_stats().cache_hits, 0u);
+    EXPECT_EQ(expiring.get_stats().cache_misses, 2u);
+
+    metric_query_engine engine(*storage_);
+    for (const std::string& query : {"SELECT sum(cpu_usage) WHERE " + range(),
+                                     "SELECT cpu_usage WHERE " + range() + " GROUP BY time(1m)",
+                                     "SELECT sum(cpu_usage) WHERE value < now() AND " + range() + " GROUP BY time(1m)"}) {
+        ASSERT_TRUE(engine.query(query).is_ok()) << query;
+        ASSERT_TRUE(engine.query(query).is_ok()) << query;
+    }
+    EXPECT_EQ(engine.get_stats().cache_hits + engine.get_stats().cache_misses, 0u);
+}
+
+TEST_F(MetricQueryEngineTest, ConcurrentIdenticalQueriesShareOneRefresh) {
+    metric_query_engine engine(*storage_);
+    const std::string query = "SELECT avg(http_latency) WHERE " + range(0, 360) + " GROUP BY time(1m), service";
+    const auto expected = run(query);
+
+    constexpr int viewers = 20;
+    std::vector<query_result> results(viewers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < viewers; ++i) {
+        threads.emplace_back([&, i] { results[i] = engine.query(query).value(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // One viewer computes the buckets, the others wait for and reuse them
+    const auto stats = engine.get_stats();
+    EXPECT_EQ(stats.cache_misses, 1u);
+    EXPECT_EQ(stats.cache_hits, static_cast<size_t>(viewers - 1));
+    EXPECT_EQ(stats.points_scanned + stats.points_summarized, expected.points_scanned + expected.points_summarized);
+    for (const auto& result : results) {
+        ASSERT_EQ(result.series.size(), expected.series.size());
+        for (size_t i = 0; i < expected.series.size(); ++i) {
+            EXPECT_EQ(result.series[i].values, expected.series[i].values);
+        }
+    }
+}
@@ -7,7 +7,10 @@
 #include <kcenon/monitoring/utils/metric_types.h>
 #include <kcenon/monitoring/utils/time_series.h>
 #include <kcenon/monitoring/utils/metric_storage.h>
+#include <atomic>
 #include <chrono>
+#include <future>
+#include <string>
 #include <thread>
 #include <vector>
 #include <random>
@@ -110,6 +113,129 @@ TEST_F(MetricStorageTest, RingBufferBatchOperations) {
     }
 }
 
+TEST_F(MetricStorageTest, RingBufferZeroCopyBatchView) {
+    ring_buffer_config config;
+    config.capacity = 8;
+    config.batch_size = 4;
+    config.overwrite_old = false;
+    ring_buffer<int> buffer(config);
+
+    // Advance indices so the readable region wraps around the end
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_TRUE(buffer.write(std::move(i)).is_ok());
+    }
+    std::vector<int> drained;
+    buffer.read_batch(drained, 4);
+    for (int i = 6; i < 11; ++i) {
+        ASSERT_TRUE(buffer.write(std::move(i)).is_ok());
+    }
+
+    auto view = buffer.read_batch();
+    ASSERT_EQ(view.size(), 7u);
+    EXPECT_FALSE(view.second.empty());
+    EXPECT_EQ(buffer.size(), 7u);  // Nothing consumed before commit
+
+    std::vector<int> seen;
+    view.for_each([&seen](int v) { seen.push_back(v); });
+    EXPECT_EQ(seen, (std::vector<int>{4, 5, 6, 7, 8, 9, 10}));
+
+    // Partial commit keeps the rest of the view valid
+    EXPECT_EQ(buffer.commit(3), 3u);
+    EXPECT_EQ(buffer.size(), 4u);
+    EXPECT_EQ(buffer.commit(10), 4u);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.commit(1), 0u);
+
+    // Buffer is writable again after the commit
+    EXPECT_TRUE(buffer.write(11).is_ok());
+    auto next = buffer.read_batch(1);
+    ASSERT_EQ(next.size(), 1u);
+    EXPECT_EQ(next.first[0], 11);
+}
+
+TEST_F(MetricStorageTest, RingBufferViewSkipsUnpublishedSlots) {
+    ring_buffer_config config;
+    config.capacity = 64;
+    config.batch_size = 32;
+    config.overwrite_old = false;
+    ring_buffer<std::string> buffer(config);
+
+    constexpr int producers = 4;
+    constexpr int per_producer = 5000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&buffer, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                std::string item = std::to_string(p) + ":" + std::to_string(i);
+                while (buffer.write(std::string(item)).is_err()) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Every viewed slot must hold a fully written item, in per-producer order
+    std::vector<int> next(producers, 0);
+    int consumed = 0;
+    bool intact = true;
+    while (consumed < producers * per_producer) {
+        auto view = buffer.read_batch();
+        view.for_each([&](const std::string& item) {
+            auto colon = item.find(':');
+            if (colon == std::string::npos) {
+                intact = false;
+                return;
+            }
+            int p = std::stoi(item.substr(0, colon));
+            intact = intact && std::stoi(item.substr(colon + 1)) == next[p]++;
+        });
+        consumed += static_cast<int>(buffer.commit(view.size()));
+        if (view.empty()) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_TRUE(intact);
+    EXPECT_EQ(next, std::vector<int>(producers, per_producer));
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST_F(MetricStorageTest, RingBufferAdmittedWrites) {
+    ring_buffer_config config;
+    config.capacity = 4;
+    config.batch_size = 4;
+    config.overwrite_old = false;
+    ring_buffer<int> buffer(config);
+
+    int admitted = 0;
+    auto accept = [&admitted](const int&) -> kcenon::common::VoidResult {
+        ++admitted;
+        return kcenon::common::ok();
+    };
+    auto reject = [&admitted](const int&) -> kcenon::common::VoidResult {
+        ++admitted;
+        return kcenon::common::VoidResult::err(
+            error_info(monitoring_error_code::storage_write_failed, "rejected").to_common_error());
+    };
+
+    EXPECT_TRUE(buffer.write(1, accept, -1).is_ok());
+    EXPECT_TRUE(buffer.write(2, reject, -1).is_err());
+    EXPECT_TRUE(buffer.write(3, accept, -1).is_ok());
+
+    // A full buffer rejects the item before it is admitted
+    EXPECT_TRUE(buffer.write(4, accept, -1).is_err());
+    EXPECT_EQ(admitted, 3);
+
+    // The rejected item's slot holds the placeholder
+    auto view = buffer.read_batch();
+    std::vector<int> items;
+    view.for_each([&items](int item) { items.push_back(item); });
+    EXPECT_EQ(items, (std::vector<int>{1, -1, 3}));
+}
+
 TEST_F(MetricStorageTest, RingBufferPeek) {
     ring_buffer<int> buffer;
     
@@ -247,6 +373,227 @@ TEST_F(MetricStorageTest, TimeSeriesQuery) {
     EXPECT_LE(summary.max_value, 50.0);
 }
 
+TEST_F(MetricStorageTest, TimeSeriesLosslessRoundTrip) {
+    time_series_config config;
+    config.chunk_points = 16;
+    config.retention_period = std::chrono::hours(24);
+
+    auto series_result = time_series::create("lossless", config);
+    ASSERT_TRUE(series_result.is_ok());
+    auto& series = series_result.value();
+
+    // Irregular nanosecond offsets, noisy values and a few late arrivals
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<int64_t> jitter(1, 5'000'000);
+    std::uniform_real_distribution<double> noise(-1000.0, 1000.0);
+
+    auto base = std::chrono::system_clock::now();
+    std::vector<std::pair<std::chrono::system_clock::time_point, double>> expected;
+    auto timestamp = base;
+    for (int i = 0; i < 200; ++i) {
+        timestamp += std::chrono::nanoseconds(jitter(rng));
+        expected.emplace_back(timestamp, i % 3 == 0 ? 42.0 : noise(rng));
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (i % 37 == 5) {
+            continue;
+        }
+        ASSERT_TRUE(series->add_point(expected[i].second, expected[i].first).is_ok());
+    }
+    for (size_t i = 5; i < expected.size(); i += 37) {
+        ASSERT_TRUE(series->add_point(expected[i].second, expected[i].first).is_ok());
+    }
+
+    EXPECT_EQ(series->size(), expected.size());
+    EXPECT_GT(series->sealed_chunk_count(), 0u);
+
+    auto points = series->get_points();
+    ASSERT_EQ(points.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(points[i].timestamp, expected[i].first);
+        EXPECT_EQ(points[i].value, expected[i].second);
+    }
+
+    auto latest = series->get_latest_value();
+    ASSERT_TRUE(latest.is_ok());
+    EXPECT_EQ(latest.value(), expected.back().second);
+}
+
+TEST_F(MetricStorageTest, TimeSeriesCompressesRegularSamples) {
+    time_series_config config;
+    config.max_points = 10000;
+    config.retention_period = std::chrono::hours(24);
+
+    auto series_result = time_series::create("regular", config);
+    ASSERT_TRUE(series_result.is_ok());
+    auto& series = series_result.value();
+
+    auto start = std::chrono::time_point_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now() - std::chrono::hours(2));
+    for (int i = 0; i < 4096; ++i) {
+        series->add_point(50.0 + (i % 4) * 0.5, start + std::chrono::seconds(i));
+    }
+
+    ASSERT_EQ(series->size(), 4096u);
+    EXPECT_LT(series->encoded_bytes(), 4096u * 2);
+    EXPECT_LT(series->memory_footprint(), 4096u * 4);
+}
+
+TEST_F(MetricStorageTest, TimeSeriesTrimsToMaxPoints) {
+    time_series_config config;
+    config.max_points = 150;
+    config.chunk_points = 32;
+    config.retention_period = std::chrono::hours(24);
+
+    auto series_result = time_series::create("trimmed", config);
+    ASSERT_TRUE(series_result.is_ok());
+    auto& series = series_result.value();
+
+    auto start = std::chrono::system_clock::now() - std::chrono::hours(1);
+    std::vector<time_point_data> batch;
+    for (int i = 0; i < 400; ++i) {
+        batch.emplace_back(start + std::chrono::seconds(i), static_cast<double>(i));
+    }
+    ASSERT_TRUE(series->add_points(batch).is_ok());
+
+    ASSERT_EQ(series->size(), 150u);
+    auto points = series->get_points();
+    EXPECT_EQ(points.front().value, 250.0);
+    EXPECT_EQ(points.back().value, 399.0);
+
+    // A late point lands in the partly trimmed oldest chunk
+    ASSERT_TRUE(series->add_point(249.5, start + std::chrono::milliseconds(249500)).is_ok());
+    points = series->get_points();
+    ASSERT_EQ(points.size(), 151u);
+    EXPECT_EQ(points[0].value, 249.5);
+    EXPECT_EQ(points[1].value, 250.0);
+    EXPECT_EQ(series->summarize(start, start + std::chrono::hours(1)).value().count, 151u);
+
+    config.chunk_points = 1;
+    EXPECT_TRUE(time_series::create("invalid", config).is_err());
+}
+
+TEST_F(MetricStorageTest, TimeSeriesRangeSummaryUsesChunkSummaries) {
+    time_series_config config;
+    config.max_points = 100000;
+    config.chunk_points = 64;
+    config.retention_period = std::chrono::hours(48);
+
+    auto series_result = time_series::create("summarized", config);
+    ASSERT_TRUE(series_result.is_ok());
+    auto& series = series_result.value();
+
+    auto start = std::chrono::time_point_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now() - std::chrono::hours(24));
+    std::vector<double> values;
+    for (int i = 0; i < 20000; ++i) {
+        values.push_back(static_cast<double>((i * 7919) % 1000));
+        series->add_point(values.back(), start + std::chrono::seconds(i));
+    }
+
+    // Range boundaries deliberately fall inside chunks
+    const int from = 1001;
+    const int to = 17777;
+    auto summary = series->summarize(start + std::chrono::seconds(from),
+                                     start + std::chrono::seconds(to));
+    ASSERT_TRUE(summary.is_ok());
+
+    double sum = 0.0;
+    double min_value = values[from];
+    double max_value = values[from];
+    for (int i = from; i < to; ++i) {
+        sum += values[i];
+        min_value = std::min(min_value, values[i]);
+        max_value = std::max(max_value, values[i]);
+    }
+
+    const auto& s = summary.value();
+    EXPECT_EQ(s.count, static_cast<size_t>(to - from));
+    EXPECT_EQ(s.samples, static_cast<uint64_t>(to - from));
+    EXPECT_DOUBLE_EQ(s.sum, sum);
+    EXPECT_EQ(s.min, min_value);
+    EXPECT_EQ(s.max, max_value);
+    EXPECT_EQ(s.first_value, values[from]);
+    EXPECT_EQ(s.last_value, values[to - 1]);
+
+    EXPECT_TRUE(series->summarize(start, start).is_err());
+
+    // Step buckets spanning many whole chunks agree with a point scan
+    time_series_query query(start + std::chrono::seconds(from),
+                            start + std::chrono::seconds(to),
+                            std::chrono::hours(1));
+    auto result = series->query(query);
+    ASSERT_TRUE(result.is_ok());
+    EXPECT_EQ(result.value().total_samples, static_cast<size_t>(to - from));
+    ASSERT_EQ(result.value().points.size(), 5u);
+    EXPECT_NEAR(result.value().get_average(), sum / (to - from), 1e-9);
+
+    const auto& first_bucket = result.value().points.front();
+    double bucket_sum = 0.0;
+    for (int i = from; i < from + 3600; ++i) {
+        bucket_sum += values[i];
+    }
+    EXPECT_EQ(first_bucket.sample_count, 3600u);
+    EXPECT_NEAR(first_bucket.value, bucket_sum / 3600, 1e-9);
+    EXPECT_EQ(first_bucket.timestamp, start + std::chrono::seconds(from + 3599));
+}
+
+TEST_F(MetricStorageTest, TimeSeriesReadersSeeConsistentSnapshotsDuringAppends) {
+    time_series_config config;
+    config.max_points = 500;
+    config.chunk_points = 8;
+    config.retention_period = std::chrono::hours(24);
+
+    auto series_result = time_series::create("concurrent", config);
+    ASSERT_TRUE(series_result.is_ok());
+    auto& series = series_result.value();
+
+    // One writer appends, seals and trims while readers decode the series;
+    // every read must be a gap-free run of consecutive points
+    constexpr int total = 20000;
+    auto start = std::chrono::system_clock::now() - std::chrono::hours(1);
+    std::atomic<bool> done{false};
+    std::atomic<size_t> reads{0};
+    std::atomic<size_t> torn_reads{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            do {
+                auto points = series->get_points();
+                for (size_t i = 1; i < points.size(); ++i) {
+                    if (points[i].value != points[i - 1].value + 1.0 ||
+                        points[i].timestamp != start + std::chrono::milliseconds(
+                                                           static_cast<int>(points[i].value))) {
+                        torn_reads++;
+                        break;
+                    }
+                }
+                auto summary = series->summarize(start, start + std::chrono::hours(1));
+                if (summary.is_ok() && summary.value().count > 0 &&
+                    summary.value().last_value - summary.value().first_value + 1.0 !=
+                        static_cast<double>(summary.value().count)) {
+                    torn_reads++;
+                }
+                reads++;
+            } while (!done.load());
+        });
+    }
+
+    for (int i = 0; i < total; ++i) {
+        series->add_point(static_cast<double>(i), start + std::chrono::milliseconds(i));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_GT(reads.load(), 0u);
+    EXPECT_EQ(torn_reads.load(), 0u);
+    EXPECT_EQ(series->size(), config.max_points);
+    EXPECT_EQ(series->get_latest_value().value(), total - 1.0);
+}
+
 // Metric Storage Tests
 TEST_F(MetricStorageTest, MetricStorageBasicOperations) {
     metric_storage_config config;
@@ -379,6 +726,283 @@ TEST_F(MetricStorageTest, MetricStorageThreadSafety) {
 }
 
 // Configuration Validation Tests
+TEST_F(MetricStorageTest, MetricStorageShardedIngest) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.ring_buffer_capacity = 4096;
+    config.shard_count = 16;
+    metric_storage storage(config);
+
+    const int num_threads = 8;
+    const int metrics_per_thread = 64;
+    const int points_per_metric = 50;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&storage, t]() {
+            for (int p = 0; p < points_per_metric; ++p) {
+                for (int m = 0; m < metrics_per_thread; ++m) {
+                    storage.store_metric("shard_" + std::to_string(t) + "_" + std::to_string(m),
+                                         static_cast<double>(p));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    storage.flush();
+
+    EXPECT_EQ(storage.get_stats().total_metrics_stored.load(),
+              static_cast<size_t>(num_threads * metrics_per_thread * points_per_metric));
+    EXPECT_EQ(storage.series_count(), static_cast<size_t>(num_threads * metrics_per_thread));
+    EXPECT_EQ(storage.get_metric_names().size(), storage.series_count());
+
+    time_series_query query;
+    query.end_time = std::chrono::system_clock::now() + std::chrono::seconds(1);
+    auto result = storage.query_metric("shard_3_17", query);
+    ASSERT_TRUE(result.is_ok());
+    EXPECT_EQ(result.value().total_samples, static_cast<size_t>(points_per_metric));
+
+    auto latest = storage.get_latest_value("shard_7_63");
+    ASSERT_TRUE(latest.is_ok());
+    EXPECT_EQ(latest.value(), points_per_metric - 1.0);
+
+    storage.clear();
+    EXPECT_EQ(storage.series_count(), 0u);
+
+    config.shard_count = 3;
+    EXPECT_TRUE(config.validate().is_err());
+}
+
+TEST_F(MetricStorageTest, MetricStorageFullShardRejectsNewMetrics) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.ring_buffer_capacity = 64;
+    config.shard_count = 1;
+    metric_storage storage(config);
+
+    // Buffered metrics are never overwritten; overflow is rejected and counted
+    size_t accepted = 0;
+    double last_accepted = -1.0;
+    for (int i = 0; i < 100; ++i) {
+        if (storage.store_metric("bounded", static_cast<double>(i)).is_ok()) {
+            ++accepted;
+            last_accepted = static_cast<double>(i);
+        }
+    }
+    ASSERT_GT(accepted, 0u);
+    ASSERT_LT(accepted, 100u);
+    EXPECT_EQ(storage.get_stats().total_metrics_dropped.load(), 100u - accepted);
+
+    storage.flush();
+
+    time_series_query query;
+    query.end_time = std::chrono::system_clock::now() + std::chrono::seconds(1);
+    auto result = storage.query_metric("bounded", query);
+    ASSERT_TRUE(result.is_ok());
+    EXPECT_EQ(result.value().total_samples, accepted);
+
+    auto latest = storage.get_latest_value("bounded");
+    ASSERT_TRUE(latest.is_ok());
+    EXPECT_EQ(latest.value(), last_accepted);
+
+    // Space is released once the shard is flushed
+    EXPECT_TRUE(storage.store_metric("bounded", 1000.0).is_ok());
+}
+
+TEST_F(MetricStorageTest, MetricStorageShardBufferHoldsFullCapacity) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.ring_buffer_capacity = 1024;
+    config.shard_count = 16;
+    metric_storage storage(config);
+
+    // A single hot metric may use its shard's whole buffer
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(storage.store_metric("hot", static_cast<double>(i)).is_ok());
+    }
+    EXPECT_EQ(storage.get_stats().total_metrics_dropped.load(), 0u);
+
+    storage.flush();
+    auto latest = storage.get_latest_value("hot");
+    ASSERT_TRUE(latest.is_ok());
+    EXPECT_EQ(latest.value(), 999.0);
+}
+
+TEST_F(MetricStorageTest, MetricStorageObserversRunOutsideShardLock) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.shard_count = 1;
+    metric_storage storage(config);
+
+    // Querying and storing into the flushed shard must not deadlock
+    std::vector<std::string> names;
+    double latest = -1.0;
+    storage.add_ingest_observer([&](const std::vector<observed_sample>& samples) {
+        for (const auto& sample : samples) {
+            names.emplace_back(sample.name);
+        }
+        auto value = storage.get_latest_value("observed_metric");
+        if (value.is_ok()) {
+            latest = value.value();
+        }
+        (void)storage.store_metric("observer_output", static_cast<double>(samples.size()));
+    });
+
+    ASSERT_TRUE(storage.store_metric("observed_metric", 1.0).is_ok());
+    ASSERT_TRUE(storage.store_metric("observed_metric", 2.0).is_ok());
+    ASSERT_TRUE(storage.store_metric("other_metric", 3.0).is_ok());
+    storage.flush();
+
+    EXPECT_EQ(names, (std::vector<std::string>{"observed_metric", "observed_metric", "other_metric"}));
+    EXPECT_EQ(latest, 2.0);
+    EXPECT_EQ(storage.get_stats().total_metrics_stored.load(), 4u);
+}
+
+TEST_F(MetricStorageTest, MetricStorageFlushProceedsDuringScan) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.shard_count = 1;
+    metric_storage storage(config);
+
+    ASSERT_TRUE(storage.store_metric("scanned_metric", 1.0).is_ok());
+    storage.flush();
+    ASSERT_TRUE(storage.store_metric("scanned_metric", 2.0).is_ok());
+
+    // A flush into the scanned series completes while the scan callback
+    // runs, and the scan keeps reading the points published when it started
+    auto now = std::chrono::system_clock::now();
+    std::future<void> flusher;
+    bool flushed_during_scan = false;
+    size_t scanned = 0;
+    auto result = storage.scan_metric("scanned_metric", now - std::chrono::hours(1),
+                                      now + std::chrono::hours(1),
+        [&](const int64_t*, const double*, const uint32_t*, size_t size) {
+            scanned += size;
+            flusher = std::async(std::launch::async, [&storage] { storage.flush(); });
+            flushed_during_scan =
+                flusher.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+        });
+    flusher.wait();
+
+    ASSERT_TRUE(result.is_ok());
+    EXPECT_TRUE(flushed_during_scan);
+    EXPECT_EQ(scanned, 1u);
+    EXPECT_EQ(storage.get_latest_value("scanned_metric").value(), 2.0);
+}
+
+TEST_F(MetricStorageTest, MetricStorageRollupTiers) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.time_series_max_points = 100;
+    config.shard_count = 1;
+    config.rollup_tiers = metric_storage_config::standard_rollup_tiers();
+    ASSERT_TRUE(config.validate().is_ok());
+
+    metric_storage storage(config);
+
+    EXPECT_EQ(storage.select_tier(std::chrono::seconds(10)), 0u);
+    EXPECT_EQ(storage.select_tier(std::chrono::seconds(90)), 0u);
+    EXPECT_EQ(storage.select_tier(std::chrono::minutes(1)), 1u);
+    EXPECT_EQ(storage.select_tier(std::chrono::minutes(5)), 1u);
+    EXPECT_EQ(storage.select_tier(std::chrono::hours(1)), 2u);
+    EXPECT_EQ(storage.select_tier(std::chrono::hours(24)), 2u);
+
+    // Register the name, then backfill three hours of 10s samples
+    ASSERT_TRUE(storage.store_metric("cpu", 0.0).is_ok());
+    storage.flush();
+
+    auto base = std::chrono::ceil<std::chrono::hours>(std::chrono::system_clock::now()) +
+                std::chrono::hours(1);
+    metric_batch batch;
+    auto metadata = create_metric_metadata("cpu", metric_type::gauge);
+    for (int i = 0; i < 1080; ++i) {
+        compact_metric_value metric(metadata, static_cast<double>(i));
+        metric.timestamp_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            (base + std::chrono::seconds(10 * i)).time_since_epoch()).count());
+        batch.add_metric(std::move(metric));
+    }
+    EXPECT_EQ(storage.store_metrics_batch(batch), 1080u);
+    storage.flush();
+
+    // Hourly query is served from the 1h tier, including the open bucket
+    time_series_query hourly(base, base + std::chrono::hours(3), std::chrono::hours(1));
+    auto hours = storage.query_metric("cpu", hourly);
+    ASSERT_TRUE(hours.is_ok());
+    ASSERT_EQ(hours.value().points.size(), 3u);
+    EXPECT_EQ(hours.value().total_samples, 1080u);
+    for (int h = 0; h < 3; ++h) {
+        EXPECT_EQ(hours.value().points[h].sample_count, 360u);
+        EXPECT_DOUBLE_EQ(hours.value().points[h].value, 360.0 * h + 179.5);
+    }
+
+    time_series_query minutely(base, base + std::chrono::hours(3), std::chrono::minutes(1));
+    auto minutes = storage.query_metric("cpu", minutely);
+    ASSERT_TRUE(minutes.is_ok());
+    EXPECT_EQ(minutes.value().points.size(), 180u);
+    EXPECT_EQ(minutes.value().total_samples, 1080u);
+
+    // Raw data is trimmed to roughly time_series_max_points samples
+    auto raw = storage.query_metric("cpu", hourly, 0);
+    ASSERT_TRUE(raw.is_ok());
+    EXPECT_LT(raw.value().total_samples, 1080u);
+
+    EXPECT_TRUE(storage.query_metric("cpu", hourly, 3).is_err());
+
+    // Rolled-up extremes are those of the raw samples, not of bucket means
+    for (size_t tier : {1u, 2u}) {
+        auto summary = storage.summarize_metric("cpu", base, base + std::chrono::hours(3), tier);
+        ASSERT_TRUE(summary.is_ok());
+        EXPECT_EQ(summary.value().samples, 1080u);
+        EXPECT_DOUBLE_EQ(summary.value().min, 0.0);
+        EXPECT_DOUBLE_EQ(summary.value().max, 1079.0);
+        EXPECT_DOUBLE_EQ(summary.value().sum, 1079.0 * 1080.0 / 2.0);
+    }
+    auto second_hour = storage.summarize_metric("cpu", base + std::chrono::hours(1),
+                                                base + std::chrono::hours(2), 2);
+    ASSERT_TRUE(second_hour.is_ok());
+    EXPECT_EQ(second_hour.value().count, 1u);
+    EXPECT_DOUBLE_EQ(second_hour.value().min, 360.0);
+    EXPECT_DOUBLE_EQ(second_hour.value().max, 719.0);
+
+    auto store_late = [&](std::chrono::system_clock::time_point at, double value) {
+        metric_batch late;
+        compact_metric_value metric(metadata, value);
+        metric.timestamp_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            at.time_since_epoch()).count());
+        late.add_metric(std::move(metric));
+        EXPECT_EQ(storage.store_metrics_batch(late), 1u);
+        storage.flush();
+    };
+
+    // A sample behind every tier's lateness window is dropped and counted
+    store_late(base + std::chrono::seconds(5), -10.0);
+    EXPECT_EQ(storage.get_stats().late_rollup_samples_dropped.load(), 2u);
+    auto unchanged = storage.summarize_metric("cpu", base, base + std::chrono::hours(3), 2);
+    ASSERT_TRUE(unchanged.is_ok());
+    EXPECT_DOUBLE_EQ(unchanged.value().min, 0.0);
+    EXPECT_EQ(unchanged.value().samples, 1080u);
+
+    // A late sample inside the window merges into its bucket instead of adding one
+    store_late(base + std::chrono::hours(1) + std::chrono::seconds(5), -5.0);
+    EXPECT_EQ(storage.get_stats().late_rollup_samples_dropped.load(), 3u);  // Only the 1m tier
+    auto with_late = storage.summarize_metric("cpu", base, base + std::chrono::hours(3), 2);
+    ASSERT_TRUE(with_late.is_ok());
+    EXPECT_EQ(with_late.value().count, 3u);
+    EXPECT_DOUBLE_EQ(with_late.value().min, -5.0);
+    EXPECT_EQ(with_late.value().samples, 1081u);
+    auto hours_with_late = storage.query_metric("cpu", hourly);
+    ASSERT_TRUE(hours_with_late.is_ok());
+    ASSERT_EQ(hours_with_late.value().points.size(), 3u);
+    EXPECT_EQ(hours_with_late.value().points[1].sample_count, 361u);
+
+    EXPECT_TRUE(storage.summarize_metric("cpu", base, base + std::chrono::hours(3), 3).is_err());
+
+    config.rollup_tiers = {{std::chrono::hours(1)}, {std::chrono::minutes(1)}};
+    EXPECT_TRUE(config.validate().is_err());
+}
+
 TEST_F(MetricStorageTest, ConfigurationValidation) {
     // Test invalid ring buffer capacity (not power of 2)
     ring_buffer_config invalid_ring_config;
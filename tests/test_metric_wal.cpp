@@ -0,0 +1,416 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/storage/metric_wal.h>
+#include <kcenon/monitoring/utils/metric_storage.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+class MetricWalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("metric_wal_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) +
+                "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    metric_wal_config make_config() const {
+        metric_wal_config config;
+        config.directory = dir_.string();
+        config.commit_interval = std::chrono::milliseconds(2);
+        config.sync_on_commit = false;
+        return config;
+    }
+
+    static uint64_t now_us() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    static compact_metric_value make_metric(const std::string& name, int i, uint64_t base_us) {
+        compact_metric_value metric;
+        metric.metadata = create_metric_metadata(name, i % 2 == 0 ? metric_type::gauge : metric_type::counter);
+        switch (i % 3) {
+            case 0: metric.value = i * 0.25; break;
+            case 1: metric.value = static_cast<int64_t>(-i); break;
+            default: metric.value = "member-" + std::to_string(i); break;
+        }
+        metric.timestamp_us = base_us + static_cast<uint64_t>(i) * 1000;
+        return metric;
+    }
+
+    std::vector<std::filesystem::path> segment_files() const {
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+            files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::filesystem::path dir_;
+};
+
+struct replayed_record {
+    std::string name;
+    compact_metric_value metric;
+};
+
+std::vector<replayed_record> replay_all(metric_wal& wal) {
+    std::vector<replayed_record> records;
+    auto result = wal.replay([&records](const std::string& name, const compact_metric_value& metric) {
+        records.push_back({name, metric});
+    });
+    EXPECT_TRUE(result.is_ok());
+    return records;
+}
+
+} // namespace
+
+TEST_F(MetricWalTest, ReplaysCommittedRecordsAfterRestart) {
+    const std::vector<std::string> names = {"cpu", "memory", "requests"};
+    const uint64_t base = now_us();
+    {
+        auto wal = metric_wal::create(make_config());
+        ASSERT_TRUE(wal.is_ok());
+        for (int i = 0; i < 300; ++i) {
+            ASSERT_TRUE(wal.value()->append(names[i % 3], make_metric(names[i % 3], i, base)).is_ok());
+        }
+        ASSERT_TRUE(wal.value()->sync().is_ok());
+        EXPECT_EQ(wal.value()->get_stats().committed_records, 300u);
+    }
+
+    auto wal = metric_wal::create(make_config());
+    ASSERT_TRUE(wal.is_ok());
+    auto records = replay_all(*wal.value());
+    ASSERT_EQ(records.size(), 300u);
+    for (int i = 0; i < 300; ++i) {
+        const auto expected = make_metric(names[i % 3], i, base);
+        EXPECT_EQ(records[i].name, names[i % 3]);
+        EXPECT_EQ(records[i].metric.metadata.name_hash, expected.metadata.name_hash);
+        EXPECT_EQ(records[i].metric.metadata.type, expected.metadata.type);
+        EXPECT_EQ(records[i].metric.value, expected.value);
+        EXPECT_EQ(records[i].metric.timestamp_us, expected.timestamp_us);
+    }
+    EXPECT_EQ(wal.value()->get_stats().replayed_records, 300u);
+}
+
+TEST_F(MetricWalTest, TruncatesTornFrameOnRecovery) {
+    const uint64_t base = now_us();
+    {
+        auto wal = metric_wal::create(make_config());
+        ASSERT_TRUE(wal.is_ok());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(wal.value()->append("cpu", make_metric("cpu", i, base)).is_ok());
+        }
+    }
+
+    auto files = segment_files();
+    ASSERT_EQ(files.size(), 1u);
+    const auto intact_size = std::filesystem::file_size(files[0]);
+
+    // Simulate a crash in the middle of writing the next frame
+    {
+        std::ofstream out(files[0], std::ios::binary | std::ios::app);
+        const char partial[] = {'M', 'W', 'A', 'L', 0x30, 0, 0, 0, 1, 0, 0};
+        out.write(partial, sizeof(partial));
+    }
+
+    auto wal = metric_wal::create(make_config());
+    ASSERT_TRUE(wal.is_ok());
+    EXPECT_EQ(replay_all(*wal.value()).size(), 10u);
+    EXPECT_EQ(wal.value()->get_stats().recovered_bytes, 11u);
+    EXPECT_EQ(std::filesystem::file_size(files[0]), intact_size);
+}
+
+TEST_F(MetricWalTest, GroupCommitSharesSyncsAcrossWriters) {
+    auto config = make_config();
+    config.commit_interval = std::chrono::milliseconds(5);
+    config.sync_on_commit = true;
+
+    auto wal = metric_wal::create(config);
+    ASSERT_TRUE(wal.is_ok());
+
+    constexpr int writers = 8;
+    constexpr int per_writer = 50;
+    const uint64_t base = now_us();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < writers; ++t) {
+        threads.emplace_back([&wal, t, base] {
+            const std::string name = "writer_" + std::to_string(t);
+            for (int i = 0; i < per_writer; ++i) {
+                auto lsn = wal.value()->append(name, make_metric(name, i, base));
+                ASSERT_TRUE(lsn.is_ok());
+                EXPECT_TRUE(wal.value()->wait_for_commit(lsn.value()).is_ok());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = wal.value()->get_stats();
+    EXPECT_EQ(stats.committed_records, static_cast<uint64_t>(writers * per_writer));
+    EXPECT_EQ(stats.syncs, stats.commits);
+    EXPECT_LT(stats.commits, static_cast<uint64_t>(writers * per_writer));
+}
+
+TEST_F(MetricWalTest, RotatesSegmentsAndDropsExpiredOnes) {
+    auto config = make_config();
+    config.segment_size_bytes = 4096;
+    config.max_pending_bytes = 1024;
+
+    auto wal = metric_wal::create(config);
+    ASSERT_TRUE(wal.is_ok());
+
+    // Samples from long before the retention period
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_TRUE(wal.value()->append("old_metric", make_metric("old_metric", i, 1000)).is_ok());
+    }
+    ASSERT_TRUE(wal.value()->sync().is_ok());
+
+    auto stats = wal.value()->get_stats();
+    EXPECT_GT(stats.segments_removed, 0u);
+    EXPECT_EQ(segment_files().size(), stats.segments);
+    EXPECT_LE(stats.segments, 2u);
+
+    ASSERT_TRUE(wal.value()->clear().is_ok());
+    EXPECT_EQ(segment_files().size(), 1u);
+}
+
+TEST_F(MetricWalTest, MetricStorageRecoversUnflushedMetrics) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.wal_directory = dir_.string();
+    config.wal_commit_interval = std::chrono::milliseconds(2);
+
+    {
+        metric_storage storage(config);
+        for (int i = 0; i < 50; ++i) {
+            ASSERT_TRUE(storage.store_metric("cpu_usage", i * 1.0).is_ok());
+            ASSERT_TRUE(storage.store_metric("memory_usage", 100.0 + i).is_ok());
+        }
+        ASSERT_TRUE(storage.sync_wal().is_ok());
+        // Destroyed without flushing: the ring buffer contents are lost
+    }
+
+    metric_storage recovered(config);
+    EXPECT_EQ(recovered.series_count(), 2u);
+    auto cpu = recovered.get_latest_value("cpu_usage");
+    ASSERT_TRUE(cpu.is_ok());
+    EXPECT_DOUBLE_EQ(cpu.value(), 49.0);
+    auto memory = recovered.get_latest_value("memory_usage");
+    ASSERT_TRUE(memory.is_ok());
+    EXPECT_DOUBLE_EQ(memory.value(), 149.0);
+    EXPECT_EQ(recovered.get_wal_stats()->replayed_records, 100u);
+
+    recovered.clear();
+    metric_storage emptied(config);
+    EXPECT_EQ(emptied.series_count(), 0u);
+}
+
+TEST_F(MetricWalTest, WaitForCommitMakesEachStoreDurable) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.wal_directory = dir_.string();
+    config.wal_wait_for_commit = true;
+
+    {
+        metric_storage storage(config);
+        ASSERT_TRUE(storage.store_metric("requests_total", 7.0, metric_type::counter).is_ok());
+        EXPECT_EQ(storage.get_wal_stats()->committed_records, 1u);
+    }
+
+    metric_storage recovered(config);
+    auto value = recovered.get_latest_value("requests_total");
+    ASSERT_TRUE(value.is_ok());
+    EXPECT_DOUBLE_EQ(value.value(), 7.0);
+}
+
+TEST_F(MetricWalTest, RejectedMetricsAreNotReplayed) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.ring_buffer_capacity = 64;
+    config.shard_count = 1;
+    config.wal_directory = dir_.string();
+
+    size_t accepted = 0;
+    {
+        metric_storage storage(config);
+        for (int i = 0; i < 100; ++i) {
+            if (storage.store_metric("bounded", static_cast<double>(i)).is_ok()) {
+                ++accepted;
+            }
+        }
+        ASSERT_LT(accepted, 100u);
+        ASSERT_TRUE(storage.sync_wal().is_ok());
+        EXPECT_EQ(storage.get_wal_stats()->committed_records, accepted);
+    }
+
+    metric_storage recovered(config);
+    EXPECT_EQ(recovered.get_wal_stats()->replayed_records, accepted);
+    auto value = recovered.get_latest_value("bounded");
+    ASSERT_TRUE(value.is_ok());
+    EXPECT_DOUBLE_EQ(value.value(), static_cast<double>(accepted - 1));
+}
+
+TEST_F(MetricWalTest, BatchLogsRegisteredMetricsOnly) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.wal_directory = dir_.string();
+    config.wal_wait_for_commit = true;
+
+    {
+        metric_storage storage(config);
+        storage.register_metric_name("batch_total");
+
+        metric_batch batch;
+        for (int i = 0; i < 10; ++i) {
+            batch.add_metric(compact_metric_value(
+                create_metric_metadata("batch_total", metric_type::counter), static_cast<double>(i)));
+        }
+        batch.add_metric(compact_metric_value(
+            create_metric_metadata("never_registered", metric_type::gauge), 1.0));
+
+        EXPECT_EQ(storage.store_metrics_batch(batch), 10u);
+        const auto& stats = storage.get_stats();
+        EXPECT_EQ(stats.unregistered_metrics_dropped.load(), 1u);
+        EXPECT_EQ(stats.total_metrics_dropped.load(), 1u);
+        EXPECT_EQ(stats.wal_append_failures.load(), 0u);
+        EXPECT_EQ(stats.wal_commit_failures.load(), 0u);
+        EXPECT_EQ(storage.get_wal_stats()->committed_records, 10u);
+    }
+
+    metric_storage recovered(config);
+    EXPECT_EQ(recovered.series_count(), 1u);
+    auto value = recovered.get_latest_value("batch_total");
+    ASSERT_TRUE(value.is_ok());
+    EXPECT_DOUBLE_EQ(value.value(), 9.0);
+}
+
+#if defined(__linux__)
+
+TEST_F(MetricWalTest, BatchCountsFailedCommitsAsStored) {
+    metric_storage_config config;
+    config.enable_background_processing = false;
+    config.wal_directory = dir_.string();
+    config.wal_wait_for_commit = true;
+
+    auto* previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit original{};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &original), 0);
+    {
+        metric_storage storage(config);
+        ASSERT_TRUE(storage.store_metric("blob", 0.0).is_ok());
+
+        metric_batch batch;
+        compact_metric_value large(create_metric_metadata("blob", metric_type::gauge), 0.0);
+        large.value = std::string(64 * 1024, 'x');
+        batch.add_metric(std::move(large));
+
+        auto files = segment_files();
+        ASSERT_EQ(files.size(), 1u);
+        rlimit limited = original;
+        limited.rlim_cur = static_cast<rlim_t>(std::filesystem::file_size(files[0]) + 4096);
+        ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limited), 0);
+
+        // The metric is stored and flushed, only not durable
+        EXPECT_EQ(storage.store_metrics_batch(batch), 1u);
+        ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &original), 0);
+
+        const auto& stats = storage.get_stats();
+        EXPECT_EQ(stats.wal_commit_failures.load(), 1u);
+        EXPECT_EQ(stats.total_metrics_stored.load(), 2u);
+        storage.flush();
+        const auto now = std::chrono::system_clock::now();
+        auto summary = storage.summarize_metric("blob", now - std::chrono::hours(1), now + std::chrono::hours(1));
+        ASSERT_TRUE(summary.is_ok());
+        EXPECT_EQ(summary.value().count, 2u);
+    }
+    ::setrlimit(RLIMIT_FSIZE, &original);
+    std::signal(SIGXFSZ, previous_handler);
+}
+
+TEST_F(MetricWalTest, FailedCommitsDoNotCorruptLaterFrames) {
+    const uint64_t base = now_us();
+    compact_metric_value large = make_metric("blob", 2, base);
+    large.value = std::string(64 * 1024, 'x');
+
+    auto* previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit original{};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &original), 0);
+
+    uint64_t failed_first = 0;
+    uint64_t committed_between = 0;
+    {
+        auto wal = metric_wal::create(make_config());
+        ASSERT_TRUE(wal.is_ok());
+        ASSERT_TRUE(wal.value()->append("cpu", make_metric("cpu", 0, base)).is_ok());
+        ASSERT_TRUE(wal.value()->sync().is_ok());
+
+        // Writes past this size fail, so the large frames are cut short
+        auto files = segment_files();
+        ASSERT_EQ(files.size(), 1u);
+        rlimit limited = original;
+        limited.rlim_cur = static_cast<rlim_t>(std::filesystem::file_size(files[0]) + 4096);
+        ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limited), 0);
+
+        auto first = wal.value()->append("blob", large);
+        ASSERT_TRUE(first.is_ok());
+        failed_first = first.value();
+        EXPECT_TRUE(wal.value()->sync().is_err());
+
+        auto between = wal.value()->append("cpu", make_metric("cpu", 3, base));
+        ASSERT_TRUE(between.is_ok());
+        committed_between = between.value();
+        EXPECT_TRUE(wal.value()->sync().is_ok());
+
+        ASSERT_TRUE(wal.value()->append("blob", large).is_ok());
+        EXPECT_TRUE(wal.value()->sync().is_err());
+
+        ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &original), 0);
+
+        // The second failure must not hide the first one
+        EXPECT_TRUE(wal.value()->wait_for_commit(failed_first).is_err());
+        EXPECT_TRUE(wal.value()->wait_for_commit(committed_between).is_ok());
+        EXPECT_EQ(wal.value()->get_stats().failed_commits, 2u);
+
+        ASSERT_TRUE(wal.value()->append("cpu", make_metric("cpu", 6, base)).is_ok());
+        EXPECT_TRUE(wal.value()->sync().is_ok());
+    }
+    ::setrlimit(RLIMIT_FSIZE, &original);
+    std::signal(SIGXFSZ, previous_handler);
+
+    // Frames written after a failure follow the last good frame directly
+    auto wal = metric_wal::create(make_config());
+    ASSERT_TRUE(wal.is_ok());
+    auto records = replay_all(*wal.value());
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[0].metric.timestamp_us, make_metric("cpu", 0, base).timestamp_us);
+    EXPECT_EQ(records[1].metric.timestamp_us, make_metric("cpu", 3, base).timestamp_us);
+    EXPECT_EQ(records[2].metric.timestamp_us, make_metric("cpu", 6, base).timestamp_us);
+    EXPECT_EQ(wal.value()->get_stats().recovered_bytes, 0u);
+}
+
+#endif // __linux__
@@ -11,6 +11,8 @@
 #include <vector>
 #include <random>
 #include <functional>
+#include <memory_resource>
+#include <string>
 
 using namespace kcenon::monitoring;
 
@@ -506,6 +508,268 @@ TEST_F(OptimizationTest, MemoryPoolAllocateObjectOversized) {
     EXPECT_TRUE(result.is_err());
 }
 
+// Memory Pool: O(1) ownership across grown chunks
+TEST_F(OptimizationTest, MemoryPoolOwnershipAcrossChunks) {
+    memory_pool_config config;
+    config.initial_blocks = 8;
+    config.max_blocks = 64;
+    config.block_size = 32;
+
+    memory_pool pool(config);
+
+    std::vector<void*> allocated;
+    for (int i = 0; i < 64; ++i) {
+        auto result = pool.allocate();
+        ASSERT_TRUE(result.is_ok()) << "Failed to allocate block " << i;
+        allocated.push_back(result.value());
+    }
+    EXPECT_EQ(pool.total_blocks(), 64);
+    EXPECT_TRUE(pool.allocate().is_err());
+
+    for (auto* ptr : allocated) {
+        EXPECT_TRUE(pool.owns(ptr));
+    }
+
+    // Interior pointers and foreign memory are rejected
+    EXPECT_FALSE(pool.owns(static_cast<char*>(allocated.front()) + 4));
+    int foreign_value = 0;
+    EXPECT_FALSE(pool.owns(&foreign_value));
+    EXPECT_TRUE(pool.deallocate(static_cast<char*>(allocated.front()) + 4).is_err());
+
+    for (auto* ptr : allocated) {
+        EXPECT_TRUE(pool.deallocate(ptr).is_ok());
+    }
+    EXPECT_EQ(pool.available_blocks(), 64);
+}
+
+// Memory Pool: blocks cached by an exiting thread are returned to the pool
+TEST_F(OptimizationTest, MemoryPoolThreadCacheFlushedOnThreadExit) {
+    memory_pool_config config;
+    config.initial_blocks = 64;
+    config.max_blocks = 64;
+    config.block_size = 64;
+    config.use_thread_local_cache = true;
+    config.thread_cache_size = 16;
+
+    memory_pool pool(config);
+
+    std::thread worker([&pool]() {
+        std::vector<void*> blocks;
+        for (int i = 0; i < 40; ++i) {
+            auto result = pool.allocate();
+            ASSERT_TRUE(result.is_ok());
+            blocks.push_back(result.value());
+        }
+        for (auto* ptr : blocks) {
+            EXPECT_TRUE(pool.deallocate(ptr).is_ok());
+        }
+    });
+    worker.join();
+
+    // Every block must be reachable from another thread once the worker exited
+    std::vector<void*> blocks;
+    for (int i = 0; i < 64; ++i) {
+        auto result = pool.allocate();
+        ASSERT_TRUE(result.is_ok()) << "Block " << i << " stranded in exited thread's cache";
+        blocks.push_back(result.value());
+    }
+    for (auto* ptr : blocks) {
+        EXPECT_TRUE(pool.deallocate(ptr).is_ok());
+    }
+
+    const auto& stats = pool.get_statistics();
+    EXPECT_EQ(stats.total_allocations.load(), 104);
+    EXPECT_EQ(stats.total_deallocations.load(), 104);
+}
+
+// Memory Pool: blocks freed on a different thread than they were allocated on
+TEST_F(OptimizationTest, MemoryPoolCrossThreadDeallocation) {
+    memory_pool_config config;
+    config.initial_blocks = 256;
+    config.max_blocks = 0;
+    config.block_size = 64;
+    config.use_thread_local_cache = true;
+
+    memory_pool pool(config);
+    lockfree_queue<void*> handoff(lockfree_queue_config{.initial_capacity = 4096, .max_capacity = 4096});
+
+    const int total = 4000;
+    std::thread producer([&]() {
+        for (int i = 0; i < total; ++i) {
+            auto result = pool.allocate();
+            ASSERT_TRUE(result.is_ok());
+            *static_cast<int*>(result.value()) = i;
+            while (!handoff.push(result.value()).value()) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int freed = 0;
+    while (freed < total) {
+        auto result = handoff.pop();
+        if (result.is_err()) {
+            std::this_thread::yield();
+            continue;
+        }
+        EXPECT_TRUE(pool.deallocate(result.value()).is_ok());
+        ++freed;
+    }
+    producer.join();
+
+    EXPECT_EQ(pool.available_blocks(), pool.total_blocks());
+}
+
+// Memory Pool: max_blocks = 0 keeps growing well past the initial chunk directory
+TEST_F(OptimizationTest, MemoryPoolUnboundedGrowth) {
+    memory_pool_config config;
+    config.initial_blocks = 8;
+    config.max_blocks = 0;
+    config.block_size = 16;
+
+    memory_pool pool(config);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 8 * 1024; ++i) {
+        auto result = pool.allocate();
+        ASSERT_TRUE(result.is_ok()) << "Unbounded pool exhausted after " << i << " blocks";
+        blocks.push_back(result.value());
+    }
+    EXPECT_GE(pool.total_blocks(), 8u * 1024u);
+
+    for (auto* ptr : blocks) {
+        EXPECT_TRUE(pool.owns(ptr));
+        EXPECT_TRUE(pool.deallocate(ptr).is_ok());
+    }
+    EXPECT_EQ(pool.available_blocks(), pool.total_blocks());
+}
+
+// Memory Pool: a moved-from pool is empty rather than dangling
+TEST_F(OptimizationTest, MemoryPoolMovedFromIsEmpty) {
+    memory_pool source;
+    auto block = source.allocate();
+    ASSERT_TRUE(block.is_ok());
+
+    memory_pool target(std::move(source));
+    EXPECT_TRUE(target.owns(block.value()));
+    EXPECT_TRUE(target.deallocate(block.value()).is_ok());
+
+    EXPECT_TRUE(source.allocate().is_err());
+    EXPECT_TRUE(source.deallocate(block.value()).is_err());
+    EXPECT_FALSE(source.owns(block.value()));
+    EXPECT_EQ(source.total_blocks(), 0u);
+    EXPECT_EQ(source.available_blocks(), 0u);
+    EXPECT_EQ(source.get_statistics().total_allocations.load(), 0u);
+    source.reset_statistics();
+}
+
+// Memory Pool: blocks honour the alignment and fill each chunk's span
+TEST_F(OptimizationTest, MemoryPoolAlignedBlocksFillChunk) {
+    memory_pool_config config;
+    config.initial_blocks = 64;
+    config.max_blocks = 0;
+    config.block_size = 160;  // 64 * 160 rounds up to a 16 KiB span
+    memory_pool filled(config);
+    EXPECT_EQ(filled.total_blocks(), 16384u / 160u);
+
+    config.initial_blocks = 10;
+    config.max_blocks = 20;
+    config.block_size = 24;
+    config.alignment = 16;
+    memory_pool aligned(config);
+    EXPECT_EQ(aligned.block_size(), 24u);
+    EXPECT_LE(aligned.total_blocks(), 20u);
+
+    std::vector<void*> blocks;
+    while (true) {
+        auto result = aligned.allocate();
+        if (result.is_err()) {
+            break;
+        }
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(result.value()) % 16, 0u);
+        EXPECT_TRUE(aligned.owns(result.value()));
+        blocks.push_back(result.value());
+    }
+    EXPECT_EQ(blocks.size(), 20u);
+    for (auto* ptr : blocks) {
+        EXPECT_TRUE(aligned.deallocate(ptr).is_ok());
+    }
+}
+
+// Invalid configurations are rejected at construction
+TEST_F(OptimizationTest, PoolsRejectInvalidConfiguration) {
+    memory_pool_config pool_config;
+    pool_config.block_size = 12;
+    EXPECT_THROW(memory_pool{pool_config}, std::invalid_argument);
+
+    size_class_pool_config class_config;
+    class_config.max_block_size = 8;
+    EXPECT_THROW(size_class_pool{class_config}, std::invalid_argument);
+
+    class_config = size_class_pool_config{};
+    class_config.initial_blocks_per_class = 128;
+    class_config.max_blocks_per_class = 64;
+    EXPECT_THROW(size_class_pool{class_config}, std::invalid_argument);
+}
+
+// Size-class pool: requests are routed to the smallest fitting class
+TEST_F(OptimizationTest, SizeClassPoolRoutesBySize) {
+    size_class_pool_config config;
+    config.max_block_size = 1024;
+    EXPECT_TRUE(config.validate());
+
+    size_class_pool pool(config);
+    EXPECT_EQ(pool.max_block_size(), 1024);
+    EXPECT_GT(pool.size_class_count(), 8);
+
+    for (size_t size : {1, 16, 17, 100, 128, 129, 500, 1000, 1024}) {
+        size_t index = pool.size_class_of(size);
+        ASSERT_LT(index, pool.size_class_count());
+        EXPECT_GE(pool.class_block_size(index), size);
+        if (index > 0) {
+            EXPECT_LT(pool.class_block_size(index - 1), size);
+        }
+
+        auto result = pool.allocate(size);
+        ASSERT_TRUE(result.is_ok()) << "Failed to allocate " << size << " bytes";
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(result.value()) % size_class_pool::block_alignment, 0u);
+        EXPECT_TRUE(pool.owns(result.value()));
+        EXPECT_TRUE(pool.deallocate(result.value(), size).is_ok());
+    }
+
+    EXPECT_EQ(pool.size_class_of(1025), pool.size_class_count());
+    EXPECT_TRUE(pool.allocate(1025).is_err());
+}
+
+// pmr adapter: containers allocate from the pool, oversized requests go upstream
+TEST_F(OptimizationTest, PoolMemoryResourceBacksPmrContainers) {
+    pool_memory_resource resource;
+
+    {
+        std::pmr::vector<std::pmr::string> names(&resource);
+        for (int i = 0; i < 200; ++i) {
+            names.emplace_back("metric.name.that.does.not.fit.sso." + std::to_string(i));
+        }
+        EXPECT_EQ(names.size(), 200u);
+        EXPECT_TRUE(resource.pool().owns(names.back().data()));
+        EXPECT_EQ(names[42], "metric.name.that.does.not.fit.sso.42");
+    }
+
+    // Over-aligned and oversized requests are served by the upstream resource
+    void* aligned = resource.allocate(64, 64);
+    EXPECT_FALSE(resource.pool().owns(aligned));
+    resource.deallocate(aligned, 64, 64);
+
+    void* large = resource.allocate(8192);
+    EXPECT_FALSE(resource.pool().owns(large));
+    resource.deallocate(large, 8192);
+
+    for (size_t i = 0; i < resource.pool().size_class_count(); ++i) {
+        const auto& class_pool = resource.pool().class_pool(i);
+        EXPECT_EQ(class_pool.available_blocks(), class_pool.total_blocks());
+    }
+}
+
 // SIMD Aggregator Tests
 TEST_F(OptimizationTest, SIMDAggregatorBasicOperations) {
     simd_config config;
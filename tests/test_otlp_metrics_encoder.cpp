@@ -0,0 +1,488 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/exporters/otlp_metrics_encoder.h>
+#include <kcenon/monitoring/exporters/metric_exporters.h>
+#include <kcenon/monitoring/exporters/grpc_transport.h>
+#include <kcenon/monitoring/exporters/http_transport.h>
+
+#include <bit>
+#include <cstring>
+#include <map>
+#include <thread>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+/**
+ * Minimal protobuf reader used to check the encoder output: decodes one
+ * message level into (field number -> list of raw values).
+ */
+struct pb_field {
+    uint32_t wire_type{0};
+    uint64_t number{0};        // varint / fixed64 payload
+    std::vector<uint8_t> bytes; // length-delimited payload
+};
+
+using pb_message = std::multimap<uint32_t, pb_field>;
+
+uint64_t read_varint(const std::vector<uint8_t>& data, std::size_t& pos) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (true) {
+        EXPECT_LT(pos, data.size());
+        if (pos >= data.size()) return value;
+        uint8_t b = data[pos++];
+        value |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) break;
+        shift += 7;
+    }
+    return value;
+}
+
+pb_message decode(const std::vector<uint8_t>& data) {
+    pb_message msg;
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        uint64_t tag = read_varint(data, pos);
+        pb_field field;
+        field.wire_type = static_cast<uint32_t>(tag & 7);
+        if (field.wire_type == 0) {
+            field.number = read_varint(data, pos);
+        } else if (field.wire_type == 1) {
+            EXPECT_LE(pos + 8, data.size());
+            for (int i = 0; i < 8; ++i) {
+                field.number |= static_cast<uint64_t>(data[pos + i]) << (8 * i);
+            }
+            pos += 8;
+        } else if (field.wire_type == 2) {
+            uint64_t len = read_varint(data, pos);
+            EXPECT_LE(pos + len, data.size());
+            field.bytes.assign(data.begin() + pos, data.begin() + pos + len);
+            pos += len;
+        } else {
+            ADD_FAILURE() << "unexpected wire type " << field.wire_type;
+            break;
+        }
+        msg.emplace(static_cast<uint32_t>(tag >> 3), std::move(field));
+    }
+    EXPECT_EQ(pos, data.size());
+    return msg;
+}
+
+const pb_field& one(const pb_message& msg, uint32_t field) {
+    EXPECT_EQ(msg.count(field), 1u) << "field " << field;
+    return msg.find(field)->second;
+}
+
+std::vector<pb_message> all(const pb_message& msg, uint32_t field) {
+    std::vector<pb_message> out;
+    auto [begin, end] = msg.equal_range(field);
+    for (auto it = begin; it != end; ++it) {
+        out.push_back(decode(it->second.bytes));
+    }
+    return out;
+}
+
+std::string as_string(const pb_field& f) {
+    return std::string(f.bytes.begin(), f.bytes.end());
+}
+
+double as_double(const pb_field& f) {
+    return std::bit_cast<double>(f.number);
+}
+
+std::vector<uint64_t> packed_fixed64(const pb_field& f) {
+    std::vector<uint64_t> out(f.bytes.size() / 8);
+    std::memcpy(out.data(), f.bytes.data(), out.size() * 8);
+    return out;
+}
+
+int32_t unzigzag(uint64_t v) {
+    return static_cast<int32_t>((v >> 1) ^ (~(v & 1) + 1));
+}
+
+/// Decode request -> first resource -> first scope -> metrics
+std::vector<pb_message> decode_metrics(const std::vector<uint8_t>& bytes) {
+    auto request = decode(bytes);
+    auto resources = all(request, 1);
+    EXPECT_EQ(resources.size(), 1u);
+    auto scopes = all(resources.at(0), 2);
+    EXPECT_EQ(scopes.size(), 1u);
+    return all(scopes.at(0), 2);
+}
+
+} // namespace
+
+TEST(OtlpMetricsEncoderTest, GaugeMatchesReferenceBytes) {
+    otlp_export_request request;
+    auto& rm = request.resource_metrics.emplace_back();
+    auto& sm = rm.scope_metrics.emplace_back();
+    auto& metric = sm.metrics.emplace_back();
+    metric.name = "g";
+    metric.type = otlp_metric_type::gauge;
+    metric.number_points.emplace_back().value = 1.0;
+
+    otlp_metrics_encoder encoder;
+    const auto& bytes = encoder.encode(request);
+
+    // Hand-assembled ExportMetricsServiceRequest for the same tree
+    std::vector<uint8_t> expected = {
+        0x0A, 0x18,                   // resource_metrics, 24 bytes
+        0x0A, 0x00,                   //   resource {}
+        0x12, 0x14,                   //   scope_metrics, 20 bytes
+        0x0A, 0x00,                   //     scope {}
+        0x12, 0x10,                   //     metrics, 16 bytes
+        0x0A, 0x01, 'g',              //       name
+        0x2A, 0x0B,                   //       gauge, 11 bytes
+        0x0A, 0x09,                   //         data_points, 9 bytes
+        0x21,                         //           as_double
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F,
+    };
+    EXPECT_EQ(bytes, expected);
+    EXPECT_EQ(encoder.encoded_size(request), expected.size());
+}
+
+TEST(OtlpMetricsEncoderTest, EncodesResourceScopeAndSum) {
+    otlp_export_request request;
+    auto& rm = request.resource_metrics.emplace_back();
+    rm.resource_attributes = {{"service.name", "api"}, {"host.name", "node-1"}};
+    auto& sm = rm.scope_metrics.emplace_back();
+    sm.scope_name = "monitoring_system";
+    sm.scope_version = "2.0.0";
+    sm.scope_attributes = {{"library", "core"}};
+
+    auto& metric = sm.metrics.emplace_back();
+    metric.name = "requests_total";
+    metric.description = "Handled requests";
+    metric.unit = "1";
+    metric.type = otlp_metric_type::sum;
+    metric.temporality = otlp_aggregation_temporality::delta;
+    metric.is_monotonic = true;
+    auto& point = metric.number_points.emplace_back();
+    point.attributes = {{"method", "GET"}};
+    point.start_time_unix_nano = 1000;
+    point.time_unix_nano = 2000;
+    point.value = std::int64_t{-42};
+
+    otlp_metrics_encoder encoder;
+    const auto& bytes = encoder.encode(request);
+
+    auto request_msg = decode(bytes);
+    auto resource_metrics = all(request_msg, 1);
+    ASSERT_EQ(resource_metrics.size(), 1u);
+
+    auto resource = decode(one(resource_metrics[0], 1).bytes);
+    auto resource_attrs = all(resource, 1);
+    ASSERT_EQ(resource_attrs.size(), 2u);
+    EXPECT_EQ(as_string(one(resource_attrs[0], 1)), "service.name");
+    EXPECT_EQ(as_string(one(decode(one(resource_attrs[0], 2).bytes), 1)), "api");
+    EXPECT_EQ(as_string(one(resource_attrs[1], 1)), "host.name");
+
+    auto scope_metrics = all(resource_metrics[0], 2);
+    ASSERT_EQ(scope_metrics.size(), 1u);
+    auto scope = decode(one(scope_metrics[0], 1).bytes);
+    EXPECT_EQ(as_string(one(scope, 1)), "monitoring_system");
+    EXPECT_EQ(as_string(one(scope, 2)), "2.0.0");
+    EXPECT_EQ(all(scope, 3).size(), 1u);
+
+    auto metrics = all(scope_metrics[0], 2);
+    ASSERT_EQ(metrics.size(), 1u);
+    EXPECT_EQ(as_string(one(metrics[0], 1)), "requests_total");
+    EXPECT_EQ(as_string(one(metrics[0], 2)), "Handled requests");
+    EXPECT_EQ(as_string(one(metrics[0], 3)), "1");
+
+    auto sum = decode(one(metrics[0], 7).bytes);
+    EXPECT_EQ(one(sum, 2).number, 1u);  // AGGREGATION_TEMPORALITY_DELTA
+    EXPECT_EQ(one(sum, 3).number, 1u);  // is_monotonic
+    auto points = all(sum, 1);
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_EQ(one(points[0], 2).number, 1000u);
+    EXPECT_EQ(one(points[0], 3).number, 2000u);
+    EXPECT_EQ(static_cast<int64_t>(one(points[0], 6).number), -42);
+    EXPECT_EQ(points[0].count(4), 0u);
+    EXPECT_EQ(all(points[0], 7).size(), 1u);
+}
+
+TEST(OtlpMetricsEncoderTest, EncodesHistogramAndSummary) {
+    otlp_export_request request;
+    auto& sm = request.resource_metrics.emplace_back().scope_metrics.emplace_back();
+
+    auto& histogram = sm.metrics.emplace_back();
+    histogram.name = "latency";
+    histogram.type = otlp_metric_type::histogram;
+    auto& hp = histogram.histogram_points.emplace_back();
+    hp.time_unix_nano = 5;
+    hp.count = 6;
+    hp.sum = 0.0;  // present even though zero
+    hp.explicit_bounds = {0.1, 0.5};
+    hp.bucket_counts = {1, 2, 3};
+    hp.max = 0.9;
+
+    auto& summary = sm.metrics.emplace_back();
+    summary.name = "size";
+    summary.type = otlp_metric_type::summary;
+    auto& sp = summary.summary_points.emplace_back();
+    sp.count = 4;
+    sp.sum = 10.0;
+    sp.quantile_values = {{0.5, 2.0}, {0.99, 4.5}};
+
+    otlp_metrics_encoder encoder;
+    auto metrics = decode_metrics(encoder.encode(request));
+    ASSERT_EQ(metrics.size(), 2u);
+
+    auto hist = decode(one(metrics[0], 9).bytes);
+    EXPECT_EQ(one(hist, 2).number, 2u);  // cumulative by default
+    auto hpoints = all(hist, 1);
+    ASSERT_EQ(hpoints.size(), 1u);
+    EXPECT_EQ(one(hpoints[0], 4).number, 6u);
+    EXPECT_EQ(as_double(one(hpoints[0], 5)), 0.0);
+    EXPECT_EQ(packed_fixed64(one(hpoints[0], 6)), (std::vector<uint64_t>{1, 2, 3}));
+    auto bounds = packed_fixed64(one(hpoints[0], 7));
+    ASSERT_EQ(bounds.size(), 2u);
+    EXPECT_EQ(std::bit_cast<double>(bounds[0]), 0.1);
+    EXPECT_EQ(std::bit_cast<double>(bounds[1]), 0.5);
+    EXPECT_EQ(hpoints[0].count(11), 0u);
+    EXPECT_EQ(as_double(one(hpoints[0], 12)), 0.9);
+
+    auto summ = decode(one(metrics[1], 11).bytes);
+    auto spoints = all(summ, 1);
+    ASSERT_EQ(spoints.size(), 1u);
+    EXPECT_EQ(one(spoints[0], 4).number, 4u);
+    EXPECT_EQ(as_double(one(spoints[0], 5)), 10.0);
+    auto quantiles = all(spoints[0], 6);
+    ASSERT_EQ(quantiles.size(), 2u);
+    EXPECT_EQ(as_double(one(quantiles[1], 1)), 0.99);
+    EXPECT_EQ(as_double(one(quantiles[1], 2)), 4.5);
+}
+
+TEST(OtlpMetricsEncoderTest, EncodesExponentialHistogram) {
+    otlp_export_request request;
+    auto& sm = request.resource_metrics.emplace_back().scope_metrics.emplace_back();
+    auto& metric = sm.metrics.emplace_back();
+    metric.name = "exp";
+    metric.type = otlp_metric_type::exponential_histogram;
+    metric.temporality = otlp_aggregation_temporality::delta;
+    auto& point = metric.exponential_histogram_points.emplace_back();
+    point.attributes = {{"k", "v"}};
+    point.count = 300;
+    point.sum = 12.5;
+    point.scale = -3;
+    point.zero_count = 2;
+    point.positive.offset = -5;
+    point.positive.bucket_counts = {1, 200, 0, 97};
+    point.zero_threshold = 1e-9;
+
+    otlp_metrics_encoder encoder;
+    auto metrics = decode_metrics(encoder.encode(request));
+    ASSERT_EQ(metrics.size(), 1u);
+
+    auto exp = decode(one(metrics[0], 10).bytes);
+    EXPECT_EQ(one(exp, 2).number, 1u);
+    auto points = all(exp, 1);
+    ASSERT_EQ(points.size(), 1u);
+    const auto& p = points[0];
+    EXPECT_EQ(all(p, 1).size(), 1u);
+    EXPECT_EQ(one(p, 4).number, 300u);
+    EXPECT_EQ(as_double(one(p, 5)), 12.5);
+    EXPECT_EQ(unzigzag(one(p, 6).number), -3);
+    EXPECT_EQ(one(p, 7).number, 2u);
+    EXPECT_EQ(p.count(9), 0u);  // empty negative range omitted
+    EXPECT_EQ(as_double(one(p, 14)), 1e-9);
+
+    auto positive = decode(one(p, 8).bytes);
+    EXPECT_EQ(unzigzag(one(positive, 1).number), -5);
+    const auto& packed = one(positive, 2).bytes;
+    std::vector<uint64_t> counts;
+    std::size_t pos = 0;
+    while (pos < packed.size()) {
+        counts.push_back(read_varint(packed, pos));
+    }
+    EXPECT_EQ(counts, (std::vector<uint64_t>{1, 200, 0, 97}));
+}
+
+TEST(OtlpMetricsEncoderTest, ReusesBuffersAcrossEncodes) {
+    otlp_export_request request;
+    auto& sm = request.resource_metrics.emplace_back().scope_metrics.emplace_back();
+    for (int i = 0; i < 50; ++i) {
+        auto& metric = sm.metrics.emplace_back();
+        metric.name = "metric_" + std::to_string(i);
+        metric.number_points.emplace_back().value = static_cast<double>(i);
+    }
+
+    otlp_metrics_encoder encoder;
+    std::vector<uint8_t> out;
+    const std::size_t first = encoder.encode(request, out);
+    const auto* data = out.data();
+    const auto capacity = out.capacity();
+
+    const auto copy = out;
+    for (int round = 0; round < 10; ++round) {
+        EXPECT_EQ(encoder.encode(request, out), first);
+        EXPECT_EQ(out.data(), data);
+        EXPECT_EQ(out.capacity(), capacity);
+        EXPECT_EQ(out, copy);
+    }
+}
+
+TEST(OtlpMetricsEncoderTest, BuildGaugeRequestGroupsByResource) {
+    otel_resource a;
+    a.add_attribute("service.name", "a");
+    otel_resource b;
+    b.add_attribute("service.name", "b");
+
+    std::vector<otel_metric_data> metrics(3);
+    metrics[0].name = "m0";
+    metrics[0].resource = a;
+    metrics[1].name = "m1";
+    metrics[1].resource = a;
+    metrics[2].name = "m2";
+    metrics[2].resource = b;
+    metrics[2].value = 3.5;
+    metrics[2].add_attribute("tag", "x");
+
+    otlp_export_request request;
+    build_otlp_gauge_request(metrics, request);
+    ASSERT_EQ(request.resource_metrics.size(), 2u);
+    EXPECT_EQ(request.resource_metrics[0].scope_metrics[0].metrics.size(), 2u);
+    ASSERT_EQ(request.resource_metrics[1].scope_metrics[0].metrics.size(), 1u);
+    const auto& m2 = request.resource_metrics[1].scope_metrics[0].metrics[0];
+    EXPECT_EQ(m2.name, "m2");
+    EXPECT_EQ(std::get<double>(m2.number_points[0].value), 3.5);
+    EXPECT_EQ(m2.number_points[0].attributes.size(), 1u);
+
+    // Rebuilding with fewer metrics shrinks the reused request
+    metrics.resize(1);
+    build_otlp_gauge_request(metrics, request);
+    ASSERT_EQ(request.resource_metrics.size(), 1u);
+    EXPECT_EQ(request.resource_metrics[0].scope_metrics[0].metrics.size(), 1u);
+}
+
+TEST(OtlpMetricsEncoderTest, ExporterSendsProtobufOverGrpc) {
+    auto stub_grpc = std::make_unique<stub_grpc_transport>();
+    std::vector<uint8_t> captured;
+    stub_grpc->set_response_handler([&](const grpc_request& request) {
+        captured = request.body;
+        grpc_response response;
+        response.status_code = 0;
+        return response;
+    });
+
+    metric_export_config config;
+    config.endpoint = "otlp-collector";
+    config.port = 4317;
+    config.format = metric_export_format::otlp_grpc;
+
+    otlp_metrics_exporter exporter(config, create_service_resource("svc", "1.0.0"),
+                                   std::make_unique<stub_http_transport>(),
+                                   std::move(stub_grpc));
+
+    monitoring_data data("web");
+    data.add_metric("cpu_usage_percent", 75.5);
+    ASSERT_TRUE(exporter.export_metrics({data}).is_ok());
+
+    auto metrics = decode_metrics(captured);
+    ASSERT_EQ(metrics.size(), 1u);
+    auto gauge = decode(one(metrics[0], 5).bytes);
+    auto points = all(gauge, 1);
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_EQ(as_double(one(points[0], 4)), 75.5);
+
+    // Typed request path
+    otlp_export_request request;
+    auto& metric = request.resource_metrics.emplace_back().scope_metrics.emplace_back()
+                       .metrics.emplace_back();
+    metric.name = "requests_total";
+    metric.type = otlp_metric_type::sum;
+    metric.is_monotonic = true;
+    metric.number_points.emplace_back().value = std::int64_t{7};
+    ASSERT_TRUE(exporter.export_otlp_request(request).is_ok());
+    metrics = decode_metrics(captured);
+    ASSERT_EQ(metrics.size(), 1u);
+    EXPECT_EQ(metrics[0].count(7), 1u);
+}
+
+TEST(OtlpMetricsEncoderTest, ExporterSerializesConcurrentExports) {
+    auto stub_grpc = std::make_unique<stub_grpc_transport>();
+    std::vector<std::vector<uint8_t>> bodies;
+    stub_grpc->set_response_handler([&](const grpc_request& request) {
+        bodies.push_back(request.body);
+        grpc_response response;
+        response.status_code = 0;
+        return response;
+    });
+
+    metric_export_config config;
+    config.endpoint = "otlp-collector";
+    config.port = 4317;
+    config.format = metric_export_format::otlp_grpc;
+
+    otlp_metrics_exporter exporter(config, create_service_resource("svc", "1.0.0"),
+                                   std::make_unique<stub_http_transport>(),
+                                   std::move(stub_grpc));
+
+    constexpr int threads = 4;
+    constexpr int exports_per_thread = 50;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&exporter, t] {
+            for (int i = 0; i < exports_per_thread; ++i) {
+                if (t % 2 == 0) {
+                    monitoring_data data("web");
+                    data.add_metric("thread_" + std::to_string(t), static_cast<double>(i));
+                    EXPECT_TRUE(exporter.export_metrics({data}).is_ok());
+                } else {
+                    otlp_export_request request;
+                    auto& metric = request.resource_metrics.emplace_back().scope_metrics.emplace_back()
+                                       .metrics.emplace_back();
+                    metric.name = "thread_" + std::to_string(t);
+                    metric.type = otlp_metric_type::gauge;
+                    metric.number_points.emplace_back().value = static_cast<double>(i);
+                    EXPECT_TRUE(exporter.export_otlp_request(request).is_ok());
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Every body is a complete request for exactly one metric
+    ASSERT_EQ(bodies.size(), static_cast<size_t>(threads * exports_per_thread));
+    for (const auto& body : bodies) {
+        auto metrics = decode_metrics(body);
+        ASSERT_EQ(metrics.size(), 1u);
+        EXPECT_EQ(as_string(one(metrics[0], 1)).rfind("thread_", 0), 0u);
+    }
+    EXPECT_EQ(exporter.get_stats()["exported_metrics"], static_cast<size_t>(threads * exports_per_thread));
+}
+
+TEST(OtlpMetricsEncoderTest, ExporterRejectsTypedRequestForJson) {
+    auto stub_http = std::make_unique<stub_http_transport>();
+    std::string captured;
+    stub_http->set_response_handler([&](const http_request& request) {
+        captured.assign(request.body.begin(), request.body.end());
+        http_response response;
+        response.status_code = 200;
+        return response;
+    });
+
+    metric_export_config config;
+    config.endpoint = "http://otlp-collector";
+    config.port = 4318;
+    config.format = metric_export_format::otlp_http_json;
+
+    otlp_metrics_exporter exporter(config, create_service_resource("svc", "1.0.0"),
+                                   std::move(stub_http), std::make_unique<stub_grpc_transport>());
+
+    EXPECT_TRUE(exporter.export_otlp_request(otlp_export_request{}).is_err());
+
+    monitoring_data data("web");
+    data.add_metric("cpu", 1.0);
+    ASSERT_TRUE(exporter.export_metrics({data}).is_ok());
+    EXPECT_NE(captured.find("\"resourceMetrics\""), std::string::npos);
+}
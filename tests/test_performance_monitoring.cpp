@@ -9,11 +9,15 @@
 
 #include <gtest/gtest.h>
 #include <kcenon/monitoring/core/performance_monitor.h>
+#include <kcenon/monitoring/exporters/metric_exporters.h>
 
+#include <algorithm>
 #include <chrono>
+#include <map>
 #include <random>
 #include <set>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 using namespace kcenon::monitoring;
@@ -293,6 +297,109 @@ TEST_F(PerformanceMonitoringTest, PerformanceMonitorCollect) {
     // System metrics may or may not be present depending on platform
 }
 
+TEST_F(PerformanceMonitoringTest, CollectIntoMatchesCollect) {
+    monitor.get_profiler().record_sample("arena_op", std::chrono::nanoseconds(3000000), true);
+    monitor.get_profiler().record_sample("arena_op", std::chrono::nanoseconds(5000000), true);
+    ASSERT_TRUE(monitor.record_counter("requests_total", 3, {{"method", "GET"}}).is_ok());
+    ASSERT_TRUE(monitor.record_gauge("queue_depth", 12.5).is_ok());
+
+    auto heap = monitor.collect();
+    ASSERT_TRUE(heap.is_ok());
+
+    collection_arena arena;
+    arena_metrics_snapshot arena_snapshot(arena.resource());
+    ASSERT_TRUE(monitor.collect_into(arena_snapshot).is_ok());
+    EXPECT_EQ(arena_snapshot.source_id, "performance_monitor");
+
+    // System metrics are sampled per call; compare everything else
+    const std::set<std::string> sampled = {"cpu_usage", "memory_usage", "memory_bytes", "thread_count"};
+    std::vector<std::tuple<std::string, double, std::map<std::string, std::string>>> expected;
+    for (const auto& metric : heap.value().metrics) {
+        if (sampled.count(metric.name) == 0) {
+            expected.emplace_back(metric.name, metric.value,
+                                  std::map<std::string, std::string>(metric.tags.begin(), metric.tags.end()));
+        }
+    }
+    std::vector<std::tuple<std::string, double, std::map<std::string, std::string>>> actual;
+    for (const auto& metric : arena_snapshot.metrics) {
+        if (sampled.count(std::string(metric.name)) == 0) {
+            std::map<std::string, std::string> tags;
+            for (const auto& [key, value] : metric.tags) {
+                tags.emplace(std::string(key), std::string(value));
+            }
+            actual.emplace_back(std::string(metric.name), metric.value, std::move(tags));
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(actual, expected);
+
+    auto mean = heap.value().get_metric("arena_op");
+    ASSERT_TRUE(mean.has_value());
+    EXPECT_DOUBLE_EQ(*mean, 4000000.0);
+}
+
+namespace {
+
+// Records what each cycle exported, reading the arena snapshot in place
+class recording_exporter : public metric_exporter_interface {
+public:
+    kcenon::common::VoidResult export_metrics(const std::vector<monitoring_data>&) override { return kcenon::common::ok(); }
+    kcenon::common::VoidResult export_snapshot(const metrics_snapshot&) override { return kcenon::common::ok(); }
+    kcenon::common::VoidResult export_arena_snapshot(const arena_metrics_snapshot& snapshot) override {
+        ++cycles;
+        source_id = std::string(snapshot.source_id);
+        requests = snapshot.get_metric("requests_total");
+        if (fail) {
+            return kcenon::common::VoidResult::err(error_info(monitoring_error_code::operation_failed,
+                "export failed").to_common_error());
+        }
+        return kcenon::common::ok();
+    }
+    kcenon::common::VoidResult flush() override { return kcenon::common::ok(); }
+    kcenon::common::VoidResult shutdown() override { return kcenon::common::ok(); }
+    std::unordered_map<std::string, std::size_t> get_stats() const override { return {}; }
+
+    int cycles = 0;
+    bool fail = false;
+    std::string source_id;
+    std::optional<double> requests;
+};
+
+} // namespace
+
+TEST_F(PerformanceMonitoringTest, CollectAndExportUsesCycleArena) {
+    ASSERT_TRUE(monitor.record_counter("requests_total", 7, {{"method", "GET"}}).is_ok());
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(monitor.record_gauge("gauge_" + std::to_string(i), i, {{"shard", std::to_string(i)}}).is_ok());
+    }
+
+    recording_exporter first;
+    recording_exporter second;
+    std::vector<metric_exporter_interface*> exporters = {&first, &second};
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(monitor.collect_and_export(exporters).is_ok());
+    }
+    EXPECT_EQ(first.cycles, 4);
+    EXPECT_EQ(second.cycles, 4);
+    EXPECT_EQ(first.source_id, "performance_monitor");
+    ASSERT_TRUE(first.requests.has_value());
+    EXPECT_DOUBLE_EQ(*first.requests, 7.0);
+
+    // A stable metric set stays within the retained arena buffer
+    const auto warm = monitor.get_cycle_arena_stats();
+    EXPECT_EQ(warm.cycles, 4u);
+    EXPECT_EQ(warm.current_cycle_bytes, 0u);
+    EXPECT_GT(warm.last_cycle_bytes, 0u);
+    ASSERT_TRUE(monitor.collect_and_export(first).is_ok());
+    EXPECT_EQ(monitor.get_cycle_arena_stats().upstream_allocations, warm.upstream_allocations);
+
+    // Later exporters still run after a failure, whose error is returned
+    first.fail = true;
+    EXPECT_TRUE(monitor.collect_and_export(exporters).is_err());
+    EXPECT_EQ(second.cycles, 5);
+}
+
 TEST_F(PerformanceMonitoringTest, ThresholdChecking) {
     monitor.set_cpu_threshold(0.0);  // Set impossibly low threshold
     monitor.set_memory_threshold(0.0);
@@ -0,0 +1,371 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/exporters/prometheus_http_server.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace kcenon::monitoring;
+
+#if defined(__linux__)
+
+namespace {
+
+/// Blocking loopback client speaking just enough HTTP/1.1 for the tests
+class test_client {
+public:
+    /// @param receive_buffer SO_RCVBUF to request; 0 keeps the default
+    explicit test_client(std::uint16_t port, int receive_buffer = 0) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        timeval timeout{5, 0};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (receive_buffer > 0) {
+            ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected_ = ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    ~test_client() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool connected() const { return connected_; }
+
+    void send_raw(const std::string& data) {
+        ASSERT_EQ(::send(fd_, data.data(), data.size(), MSG_NOSIGNAL),
+                  static_cast<ssize_t>(data.size()));
+    }
+
+    struct response {
+        int status{0};
+        std::string headers;
+        std::string body;
+
+        std::string header(const std::string& name) const {
+            auto pos = headers.find("\r\n" + name + ": ");
+            if (pos == std::string::npos) return {};
+            pos += name.size() + 4;
+            return headers.substr(pos, headers.find("\r\n", pos) - pos);
+        }
+    };
+
+    /// Read one response; bodies are delimited by Content-Length
+    response read_response(bool head_request = false) {
+        response r;
+        std::size_t header_end;
+        while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) return r;
+        }
+        r.headers = buffer_.substr(0, header_end + 2);
+        r.status = std::stoi(r.headers.substr(9, 3));
+        buffer_.erase(0, header_end + 4);
+
+        const std::size_t length = head_request ? 0 : std::stoul(r.header("Content-Length"));
+        while (buffer_.size() < length) {
+            if (!fill()) return r;
+        }
+        r.body = buffer_.substr(0, length);
+        buffer_.erase(0, length);
+        return r;
+    }
+
+    /// Pause before each receive, to model a slow reader
+    std::chrono::milliseconds read_delay{0};
+
+    /// True once the server has closed the connection
+    bool closed_by_peer() {
+        char c;
+        return ::recv(fd_, &c, 1, 0) == 0;
+    }
+
+private:
+    bool fill() {
+        std::this_thread::sleep_for(read_delay);
+        char chunk[65536];
+        const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer_.append(chunk, static_cast<std::size_t>(n));
+        return true;
+    }
+
+    int fd_{-1};
+    bool connected_{false};
+    std::string buffer_;
+};
+
+std::string get(const std::string& path, const std::string& extra = "") {
+    return "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" + extra + "\r\n";
+}
+
+} // namespace
+
+class PrometheusHttpServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        metric_export_config config;
+        config.endpoint = "http://localhost";
+        config.format = metric_export_format::prometheus_text;
+        exporter_ = std::make_unique<prometheus_exporter>(config);
+
+        monitoring_data data("api");
+        for (int i = 0; i < 200; ++i) {
+            data.add_metric("requests_total_" + std::to_string(i), i * 1.5);
+        }
+        ASSERT_TRUE(exporter_->export_metrics({data}).is_ok());
+
+        server_config_.bind_address = "127.0.0.1";
+        server_config_.port = 0;
+    }
+
+    std::unique_ptr<prometheus_exporter> exporter_;
+    prometheus_http_server_config server_config_;
+};
+
+TEST_F(PrometheusHttpServerTest, ServesMetricsWithKeepAlive) {
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+    ASSERT_NE(server.port(), 0);
+    EXPECT_TRUE(server.start().is_err());
+
+    test_client client(server.port());
+    ASSERT_TRUE(client.connected());
+
+    const auto expected = exporter_->get_metrics_text();
+    for (int i = 0; i < 3; ++i) {
+        client.send_raw(get("/metrics"));
+        auto r = client.read_response();
+        EXPECT_EQ(r.status, 200);
+        EXPECT_EQ(r.header("Content-Type"), "text/plain; version=0.0.4; charset=utf-8");
+        EXPECT_EQ(r.header("Connection"), "keep-alive");
+        EXPECT_EQ(r.body, expected);
+    }
+
+    // Pipelined requests are answered in order on the same connection
+    client.send_raw(get("/metrics?x=1") + get("/missing") + "HEAD /metrics HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(client.read_response().status, 200);
+    EXPECT_EQ(client.read_response().status, 404);
+    auto head = client.read_response(true);
+    EXPECT_EQ(head.status, 200);
+    EXPECT_EQ(head.header("Content-Length"), std::to_string(expected.size()));
+
+    auto stats = server.get_stats();
+    EXPECT_EQ(stats.connections_accepted, 1u);
+    EXPECT_EQ(stats.requests_served, 6u);
+    EXPECT_EQ(stats.scrapes_served, 5u);
+
+    server.stop();
+    EXPECT_FALSE(server.is_running());
+}
+
+TEST_F(PrometheusHttpServerTest, StreamsLargeExpositionAcrossPartialWrites) {
+    monitoring_data data("bulk");
+    for (int i = 0; i < 60000; ++i) {
+        data.add_metric("bulk_series_with_a_reasonably_long_name_" + std::to_string(i), i);
+    }
+    ASSERT_TRUE(exporter_->export_metrics({data}).is_ok());
+    const auto expected = exporter_->get_metrics_text();
+    ASSERT_GT(expected.size(), 4u << 20);
+
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    test_client client(server.port());
+    client.send_raw(get("/metrics") + get("/metrics"));
+    // Let the server fill the socket buffer before reading
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(client.read_response().body, expected);
+    EXPECT_EQ(client.read_response().body, expected);
+}
+
+TEST_F(PrometheusHttpServerTest, ThrottlesPipeliningClientThatDoesNotRead) {
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    test_client client(server.port());
+    ASSERT_TRUE(client.connected());
+
+    // Far more response bytes than the socket buffers can hold
+    const std::size_t requests = 2000;
+    const auto expected = exporter_->get_metrics_text();
+    ASSERT_GT(expected.size() * requests, 16u << 20);
+
+    std::string batch;
+    for (std::size_t i = 0; i < requests; ++i) {
+        batch += get("/metrics");
+    }
+    client.send_raw(batch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Parsing stops while responses are queued, so output stays bounded
+    const auto served_before_reading = server.get_stats().requests_served;
+    EXPECT_LT(served_before_reading, requests / 2);
+
+    for (std::size_t i = 0; i < requests; ++i) {
+        auto r = client.read_response();
+        ASSERT_EQ(r.status, 200) << "response " << i;
+        ASSERT_EQ(r.body.size(), expected.size());
+    }
+    EXPECT_EQ(server.get_stats().requests_served, requests);
+}
+
+TEST_F(PrometheusHttpServerTest, ClosesWhenRequested) {
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    {
+        test_client client(server.port());
+        client.send_raw(get("/metrics", "Connection: close\r\n"));
+        auto r = client.read_response();
+        EXPECT_EQ(r.status, 200);
+        EXPECT_EQ(r.header("Connection"), "close");
+        EXPECT_TRUE(client.closed_by_peer());
+    }
+    {
+        test_client client(server.port());
+        client.send_raw("GET /metrics HTTP/1.0\r\n\r\n");
+        EXPECT_EQ(client.read_response().status, 200);
+        EXPECT_TRUE(client.closed_by_peer());
+    }
+    {
+        test_client client(server.port());
+        client.send_raw("POST /metrics HTTP/1.1\r\nContent-Length: 2\r\n\r\nhi");
+        auto r = client.read_response();
+        EXPECT_EQ(r.status, 405);
+        EXPECT_EQ(r.header("Allow"), "GET, HEAD");
+        EXPECT_TRUE(client.closed_by_peer());
+    }
+    {
+        test_client client(server.port());
+        client.send_raw("garbage\r\n\r\n");
+        EXPECT_EQ(client.read_response().status, 400);
+    }
+    {
+        test_client client(server.port());
+        client.send_raw("GET /metrics HTTP/1.1\r\nX-Long: " + std::string(10000, 'a'));
+        EXPECT_EQ(client.read_response().status, 431);
+    }
+}
+
+TEST_F(PrometheusHttpServerTest, ClosesIdleConnections) {
+    server_config_.idle_timeout = std::chrono::milliseconds(100);
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    test_client client(server.port());
+    client.send_raw(get("/metrics"));
+    EXPECT_EQ(client.read_response().status, 200);
+    EXPECT_TRUE(client.closed_by_peer());
+    EXPECT_EQ(server.get_stats().active_connections, 0u);
+}
+
+TEST_F(PrometheusHttpServerTest, SlowReaderIsNotIdle) {
+    monitoring_data data("bulk");
+    for (int i = 0; i < 60000; ++i) {
+        data.add_metric("bulk_series_with_a_reasonably_long_name_" + std::to_string(i), i);
+    }
+    ASSERT_TRUE(exporter_->export_metrics({data}).is_ok());
+    const auto expected = exporter_->get_metrics_text();
+
+    server_config_.idle_timeout = std::chrono::milliseconds(300);
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    // Draining the body takes several idle timeouts, but the server keeps
+    // making progress on sends the whole time
+    // A small receive window keeps the server sending in small steps
+    test_client client(server.port(), 32 * 1024);
+    client.read_delay = std::chrono::milliseconds(5);
+    client.send_raw(get("/metrics"));
+    EXPECT_EQ(client.read_response().body, expected);
+}
+
+TEST_F(PrometheusHttpServerTest, LimitsConnections) {
+    server_config_.max_connections = 1;
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    test_client first(server.port());
+    first.send_raw(get("/metrics"));
+    EXPECT_EQ(first.read_response().status, 200);
+
+    test_client second(server.port());
+    EXPECT_TRUE(second.closed_by_peer());
+    EXPECT_EQ(server.get_stats().connections_rejected, 1u);
+}
+
+TEST_F(PrometheusHttpServerTest, NegotiatesGzip) {
+    prometheus_http_server server(*exporter_, server_config_);
+    ASSERT_TRUE(server.start().is_ok());
+
+    test_client client(server.port());
+    client.send_raw(get("/metrics", "Accept-Encoding: gzip;q=0\r\n"));
+    auto plain = client.read_response();
+    EXPECT_TRUE(plain.header("Content-Encoding").empty());
+    EXPECT_EQ(plain.body, exporter_->get_metrics_text());
+
+    client.send_raw(get("/metrics", "Accept-Encoding: deflate, gzip\r\n"));
+    auto compressed = client.read_response();
+    EXPECT_EQ(compressed.status, 200);
+#ifdef MONITORING_HAS_ZLIB
+    EXPECT_EQ(compressed.header("Content-Encoding"), "gzip");
+    EXPECT_LT(compressed.body.size(), plain.body.size());
+
+    z_stream stream{};
+    ASSERT_EQ(inflateInit2(&stream, 15 + 16), Z_OK);
+    std::string inflated(plain.body.size() + 16, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(compressed.body.data());
+    stream.avail_in = static_cast<uInt>(compressed.body.size());
+    stream.next_out = reinterpret_cast<Bytef*>(inflated.data());
+    stream.avail_out = static_cast<uInt>(inflated.size());
+    EXPECT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+    inflated.resize(stream.total_out);
+    inflateEnd(&stream);
+    EXPECT_EQ(inflated, plain.body);
+    EXPECT_EQ(server.get_stats().gzip_responses, 1u);
+#else
+    EXPECT_TRUE(compressed.header("Content-Encoding").empty());
+#endif
+}
+
+TEST_F(PrometheusHttpServerTest, ReportsBindFailure) {
+    prometheus_http_server first(*exporter_, server_config_);
+    ASSERT_TRUE(first.start().is_ok());
+
+    auto config = server_config_;
+    config.port = first.port();
+    prometheus_http_server second(*exporter_, config);
+    EXPECT_TRUE(second.start().is_err());
+
+    config.bind_address = "not-an-address";
+    prometheus_http_server third(*exporter_, config);
+    EXPECT_TRUE(third.start().is_err());
+}
+
+#else
+
+TEST(PrometheusHttpServerTest, UnsupportedPlatform) {
+    metric_export_config config;
+    config.endpoint = "http://localhost";
+    prometheus_exporter exporter(config);
+    prometheus_http_server server(exporter);
+    EXPECT_TRUE(server.start().is_err());
+}
+
+#endif
@@ -0,0 +1,113 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/exporters/prometheus_text_format.h>
+#include <kcenon/monitoring/exporters/metric_exporters.h>
+
+#include <cctype>
+#include <random>
+#include <regex>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+// The regex-based implementations the table-driven helpers replace
+std::string reference_sanitize(std::string_view name, const char* invalid) {
+    std::string sanitized(name);
+    sanitized = std::regex_replace(sanitized, std::regex(invalid), "_");
+    if (!sanitized.empty() && !std::isalpha(sanitized[0]) && sanitized[0] != '_') {
+        sanitized = "_" + sanitized;
+    }
+    return sanitized;
+}
+
+std::string reference_metric_name(std::string_view name) {
+    return reference_sanitize(name, "[^a-zA-Z0-9_:]");
+}
+
+std::string reference_label_name(std::string_view name) {
+    return reference_sanitize(name, "[^a-zA-Z0-9_]");
+}
+
+std::string reference_escape(const std::string& value) {
+    std::string escaped = value;
+    escaped = std::regex_replace(escaped, std::regex("\\\\"), "\\\\");
+    escaped = std::regex_replace(escaped, std::regex("\""), "\\\"");
+    escaped = std::regex_replace(escaped, std::regex("\n"), "\\n");
+    return escaped;
+}
+
+std::vector<std::string> sample_inputs() {
+    std::vector<std::string> inputs = {
+        "", "_", ":", "0", "a", "http.requests-total", "123_invalid_start",
+        "special@chars#metric", ":leading_colon", "ns:sub:metric", "9:x",
+        "with space", "tab\there", "new\nline", "quote\"d", "back\\slash",
+        "caf\xc3\xa9", "\xff\xfe", std::string("nul\0byte", 8),
+        "a\\\"b\nc\\\\\"\"\n\n", std::string(40, '"'), std::string(33, 'x') + "\\",
+    };
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> length(0, 70);
+    std::uniform_int_distribution<int> byte(0, 255);
+    const std::string interesting = "\\\"\n:_.-aZ09 ";
+    std::uniform_int_distribution<std::size_t> pick(0, interesting.size() - 1);
+    for (int i = 0; i < 500; ++i) {
+        std::string s(static_cast<std::size_t>(length(rng)), '\0');
+        for (auto& c : s) {
+            c = (byte(rng) & 1) ? interesting[pick(rng)] : static_cast<char>(byte(rng));
+        }
+        inputs.push_back(std::move(s));
+    }
+    return inputs;
+}
+
+} // namespace
+
+TEST(PrometheusTextFormatTest, SanitizersMatchRegexImplementation) {
+    for (const auto& input : sample_inputs()) {
+        EXPECT_EQ(prometheus_sanitize_metric_name(input), reference_metric_name(input));
+        EXPECT_EQ(prometheus_sanitize_label_name(input), reference_label_name(input));
+    }
+}
+
+TEST(PrometheusTextFormatTest, EscapingMatchesRegexImplementation) {
+    for (const auto& input : sample_inputs()) {
+        std::string escaped;
+        prometheus_append_escaped_label_value(escaped, input);
+        EXPECT_EQ(escaped, reference_escape(input));
+        EXPECT_EQ(prometheus_metric_data::escape_label_value(input), reference_escape(input));
+    }
+}
+
+TEST(PrometheusTextFormatTest, FindEscapeScansWholeValue) {
+    std::string value(100, 'a');
+    EXPECT_EQ(prometheus_find_label_escape(value), std::string_view::npos);
+
+    for (std::size_t pos : {0u, 15u, 16u, 31u, 64u, 99u}) {
+        std::string hit = value;
+        hit[pos] = '"';
+        EXPECT_EQ(prometheus_find_label_escape(hit), pos);
+        EXPECT_EQ(prometheus_find_label_escape(hit, pos + 1), std::string_view::npos);
+    }
+}
+
+TEST(PrometheusTextFormatTest, AppendReusesDestination) {
+    std::string out;
+    out.reserve(256);
+    const auto* data = out.data();
+    for (int i = 0; i < 100; ++i) {
+        out.clear();
+        prometheus_append_metric_name(out, "http.requests-total");
+        out += '{';
+        prometheus_append_label_name(out, "status-code");
+        out += "=\"";
+        prometheus_append_escaped_label_value(out, "say \"hi\"");
+        out += "\"}";
+    }
+    EXPECT_EQ(out, "http_requests_total{status_code=\"say \\\"hi\\\"\"}");
+    EXPECT_EQ(out.data(), data);
+}
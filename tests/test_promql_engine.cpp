@@ -0,0 +1,306 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/utils/promql_engine.h>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+constexpr int sample_count = 600;
+
+class PromqlEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        metric_storage_config config;
+        config.enable_background_processing = false;
+        config.ring_buffer_capacity = 1 << 12;
+        storage_ = std::make_unique<metric_storage>(config);
+
+        // One sample per second over ten minutes
+        const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        base_ = (now - 1800) / 600 * 600;
+
+        ingest("cpu_usage", [](int i) { return static_cast<double>(i); });
+        ingest("requests_total", [](int i) { return 2.0 * (i % 300); });  // Counter reset halfway
+        ingest(R"(http_latency{host="a",service="api"})", [](int i) { return static_cast<double>(i % 10); });
+        ingest(R"(http_latency{host="b",service="api"})", [](int i) { return 100.0 + i % 10; });
+        ingest(R"(http_latency{host="a",service="web"})", [](int) { return 5.0; });
+
+        // Per second: one observation <= 0.1, two in (0.1, 0.5], one in (0.5, 1], one above
+        const std::vector<std::pair<std::string, double>> buckets = {
+            {"0.1", 1}, {"0.5", 3}, {"1", 4}, {"+Inf", 5}};
+        for (const auto& [le, per_second] : buckets) {
+            const double rate = per_second;
+            ingest("duration_seconds_bucket{le=\"" + le + "\"}", [rate](int i) { return rate * i; });
+        }
+    }
+
+    template<typename Fn>
+    void ingest(const std::string& name, Fn value_at) {
+        // Registers the name; the sample lands at now(), outside queried ranges
+        ASSERT_TRUE(storage_->store_metric(name, 0.0).is_ok());
+
+        metric_batch batch;
+        const auto metadata = create_metric_metadata(name, metric_type::gauge);
+        for (int i = 0; i < sample_count; ++i) {
+            compact_metric_value metric(metadata, value_at(i));
+            metric.timestamp_us = static_cast<uint64_t>((base_ + i) * 1000000);
+            batch.add_metric(std::move(metric));
+        }
+        ASSERT_EQ(storage_->store_metrics_batch(batch), static_cast<size_t>(sample_count));
+        storage_->flush();
+    }
+
+    std::chrono::system_clock::time_point at(int64_t offset) const {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(base_ + offset));
+    }
+
+    query_result instant(const std::string& expression, int64_t offset) {
+        promql_engine engine(*storage_);
+        auto result = engine.query(expression, at(offset));
+        EXPECT_TRUE(result.is_ok()) << expression << ": " << (result.is_err() ? result.error().message : "");
+        return result.is_ok() ? result.value() : query_result{};
+    }
+
+    /// Value of the only series of an instant query
+    double single(const std::string& expression, int64_t offset) {
+        auto result = instant(expression, offset);
+        EXPECT_EQ(result.series.size(), 1u) << expression;
+        return result.series.size() == 1 ? result.series[0].values.at(0)
+                                         : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    std::unique_ptr<metric_storage> storage_;
+    int64_t base_ = 0;
+};
+
+} // namespace
+
+TEST(PromqlParserTest, ParsesAndTypeChecksExpressions) {
+    promql_parser parser;
+    auto parsed = parser.parse(
+        "histogram_quantile(0.9, sum by (le) (rate(duration_seconds_bucket{job=~\"api|web\"}[5m] offset 1m)))");
+    ASSERT_TRUE(parsed.is_ok()) << parsed.error().message;
+    const auto& root = *parsed.value();
+    EXPECT_EQ(root.type, promql_node_type::function_call);
+    EXPECT_EQ(root.value_type, promql_value_type::instant_vector);
+    const auto& sum = *root.children[1];
+    EXPECT_EQ(sum.type, promql_node_type::aggregation);
+    EXPECT_EQ(sum.grouping, std::vector<std::string>{"le"});
+    EXPECT_FALSE(sum.without);
+    const auto& matrix = *sum.children[0]->children[0];
+    EXPECT_EQ(matrix.type, promql_node_type::matrix_selector);
+    EXPECT_EQ(matrix.range, std::chrono::minutes(5));
+    EXPECT_EQ(matrix.offset, std::chrono::minutes(1));
+    ASSERT_EQ(matrix.matchers.size(), 2u);
+    EXPECT_EQ(matrix.matchers[1].type, label_match_type::regex);
+
+    // Grouping may follow the operand, durations chain, ^ is right associative
+    auto trailing = parser.parse("sum(rate(x[1h30m])) without (instance) > bool 2 ^ 3 ^ 2");
+    ASSERT_TRUE(trailing.is_ok()) << trailing.error().message;
+    EXPECT_TRUE(trailing.value()->return_bool);
+    EXPECT_TRUE(trailing.value()->children[0]->without);
+    EXPECT_EQ(trailing.value()->children[0]->children[0]->children[0]->range, std::chrono::minutes(90));
+    EXPECT_EQ(trailing.value()->children[1]->children[1]->type, promql_node_type::binary_op);
+
+    auto negated = parser.parse("-2 ^ 2");
+    ASSERT_TRUE(negated.is_ok());
+    EXPECT_EQ(negated.value()->type, promql_node_type::unary_minus);
+
+    for (const char* expression : {
+             "", "rate(x)", "sum(x[5m])", "x[5m] + 1", "1 > 2", "unknown_fn(x)", "topk(x)",
+             "x[5m:1m]", "rate(x[5m], 1)", "{job=~\".*\"}", "x and 1", "x + on(a) group_left y",
+             "x{a=\"b\"", "x offset", "sum by (a) (x) by (b)", "(x", "x @ 100", "1 + bool 2"}) {
+        EXPECT_TRUE(parser.parse(expression).is_err()) << expression;
+    }
+}
+
+TEST_F(PromqlEngineTest, RateAndIncreaseExtrapolateLikePrometheus) {
+    // 60 samples in (t - 60s, t], 2 per second: extrapolated to the full minute
+    EXPECT_DOUBLE_EQ(single("rate(requests_total[1m])", 200), 2.0);
+    EXPECT_DOUBLE_EQ(single("increase(requests_total[1m])", 200), 120.0);
+
+    // The reset from 598 to 0 at 300s adds the pre-reset value: 542 -> 598, 0 -> 60
+    EXPECT_DOUBLE_EQ(single("rate(requests_total[1m])", 330), 116.0 / 59.0);
+    EXPECT_DOUBLE_EQ(single("increase(requests_total[2m])", 360), 236.0 * 120.0 / 119.0);
+
+    // The series starts at 0 inside the range, so the start is not extrapolated below zero
+    EXPECT_DOUBLE_EQ(single("increase(requests_total[1m])", 30), 60.0);
+    EXPECT_DOUBLE_EQ(single("rate(requests_total[1m])", 30), 1.0);
+
+    // irate uses the last two samples and restarts from zero after a reset
+    EXPECT_DOUBLE_EQ(single("irate(requests_total[1m])", 200), 2.0);
+    EXPECT_DOUBLE_EQ(single("irate(requests_total[1m])", 300), 0.0);
+    EXPECT_DOUBLE_EQ(single("idelta(requests_total[1m])", 300), -598.0);
+
+    // delta() does not treat the drop as a reset
+    EXPECT_NEAR(single("delta(requests_total[1m])", 330), (60.0 - 542.0) * 60.0 / 59.0, 1e-9);
+
+    // A single sample in range has no rate
+    EXPECT_TRUE(instant("rate(requests_total[1s])", 200).series.empty());
+    EXPECT_EQ(instant("rate(requests_total[1m])", 200).series[0].name, "");
+}
+
+TEST_F(PromqlEngineTest, OverTimeFunctionsMatchBruteForce) {
+    // cpu_usage is i at second i, so (40, 100] holds 41..100
+    EXPECT_DOUBLE_EQ(single("avg_over_time(cpu_usage[1m])", 100), 70.5);
+    EXPECT_DOUBLE_EQ(single("sum_over_time(cpu_usage[1m])", 100), 4230.0);
+    EXPECT_DOUBLE_EQ(single("min_over_time(cpu_usage[1m])", 100), 41.0);
+    EXPECT_DOUBLE_EQ(single("max_over_time(cpu_usage[1m])", 100), 100.0);
+    EXPECT_DOUBLE_EQ(single("count_over_time(cpu_usage[1m])", 100), 60.0);
+    EXPECT_DOUBLE_EQ(single("last_over_time(cpu_usage[1m])", 100), 100.0);
+    EXPECT_DOUBLE_EQ(single("quantile_over_time(0.5, cpu_usage[1m])", 100), 70.5);
+    EXPECT_DOUBLE_EQ(single("quantile_over_time(0.25, cpu_usage[1m])", 100), 55.75);
+    EXPECT_NEAR(single("stddev_over_time(cpu_usage[1m])", 100), std::sqrt((60.0 * 60.0 - 1) / 12), 1e-9);
+    EXPECT_NEAR(single("stdvar_over_time(cpu_usage[1m])", 100), (60.0 * 60.0 - 1) / 12, 1e-9);
+    EXPECT_DOUBLE_EQ(single("avg_over_time(cpu_usage[1m] offset 30s)", 100), 40.5);
+
+    EXPECT_EQ(instant("last_over_time(cpu_usage[1m])", 100).series[0].name, "cpu_usage");
+    EXPECT_EQ(instant("avg_over_time(cpu_usage[1m])", 100).series[0].name, "");
+}
+
+TEST_F(PromqlEngineTest, InstantSelectorsHonorLookback) {
+    EXPECT_DOUBLE_EQ(single("cpu_usage", 100), 100.0);
+    EXPECT_DOUBLE_EQ(single("cpu_usage offset 1m", 100), 40.0);
+    // The last sample is at 599s and stays visible for five minutes
+    EXPECT_DOUBLE_EQ(single("cpu_usage", 599 + 299), 599.0);
+    EXPECT_TRUE(instant("cpu_usage", 599 + 300).series.empty());
+    EXPECT_TRUE(instant("cpu_usage", -1).series.empty());
+
+    auto labelled = instant(R"(http_latency{service="api",host!="b"})", 105);
+    ASSERT_EQ(labelled.series.size(), 1u);
+    EXPECT_EQ(labelled.series[0].name, "http_latency");
+    EXPECT_EQ(labelled.series[0].labels, (label_set{{"host", "a"}, {"service", "api"}}));
+    EXPECT_DOUBLE_EQ(labelled.series[0].values[0], 5.0);
+    EXPECT_EQ(labelled.series_scanned, 1u);
+}
+
+TEST_F(PromqlEngineTest, AggregatesByAndWithoutLabels) {
+    // At 105s: api/a = 5, api/b = 105, web/a = 5
+    auto by_service = instant("sum by (service) (http_latency)", 105);
+    ASSERT_EQ(by_service.series.size(), 2u);
+    EXPECT_EQ(by_service.series[0].labels, (label_set{{"service", "api"}}));
+    EXPECT_DOUBLE_EQ(by_service.series[0].values[0], 110.0);
+    EXPECT_EQ(by_service.series[1].labels, (label_set{{"service", "web"}}));
+    EXPECT_DOUBLE_EQ(by_service.series[1].values[0], 5.0);
+
+    auto without_host = instant("avg(http_latency) without (host)", 105);
+    ASSERT_EQ(without_host.series.size(), 2u);
+    EXPECT_EQ(without_host.series[0].name, "");
+    EXPECT_DOUBLE_EQ(without_host.series[0].values[0], 55.0);
+
+    EXPECT_DOUBLE_EQ(single("max(http_latency)", 105), 105.0);
+    EXPECT_DOUBLE_EQ(single("min(http_latency)", 105), 5.0);
+    EXPECT_DOUBLE_EQ(single("count(http_latency)", 105), 3.0);
+    EXPECT_DOUBLE_EQ(single("stddev(http_latency)", 105), std::sqrt(2.0 * 100.0 * 100.0 / 9.0));
+    EXPECT_DOUBLE_EQ(single("quantile(0.5, http_latency)", 105), 5.0);
+
+    // topk keeps the series' own labels
+    auto top = instant("topk(1, http_latency)", 105);
+    ASSERT_EQ(top.series.size(), 1u);
+    EXPECT_EQ(top.series[0].name, "http_latency");
+    EXPECT_EQ(top.series[0].labels, (label_set{{"host", "b"}, {"service", "api"}}));
+    EXPECT_EQ(instant("bottomk(2, http_latency) by (service)", 105).series.size(), 3u);
+    EXPECT_TRUE(instant("topk(0, http_latency)", 105).series.empty());
+}
+
+TEST_F(PromqlEngineTest, HistogramQuantileInterpolatesBuckets) {
+    const std::string rates = "sum by (le) (rate(duration_seconds_bucket[1m]))";
+    EXPECT_NEAR(single("histogram_quantile(0.5, " + rates + ")", 200), 0.1 + 0.4 * 0.75, 1e-9);
+    EXPECT_NEAR(single("histogram_quantile(0.7, " + rates + ")", 200), 0.75, 1e-9);
+    EXPECT_NEAR(single("histogram_quantile(0.1, " + rates + ")", 200), 0.05, 1e-9);
+    // Ranks in the +Inf bucket report the highest finite bound
+    EXPECT_DOUBLE_EQ(single("histogram_quantile(0.95, " + rates + ")", 200), 1.0);
+    EXPECT_TRUE(std::isinf(single("histogram_quantile(2, " + rates + ")", 200)));
+    // Without a +Inf bucket the quantile is undefined
+    EXPECT_TRUE(std::isnan(single(
+        "histogram_quantile(0.5, sum by (le) (rate(duration_seconds_bucket{le!=\"+Inf\"}[1m])))", 200)));
+
+    EXPECT_DOUBLE_EQ(detail::promql_bucket_quantile(0.5, {{1, 10}, {2, 8}, {INFINITY, 20}}), 1.0);
+}
+
+TEST_F(PromqlEngineTest, BinaryOperatorsMatchAndFilter) {
+    EXPECT_DOUBLE_EQ(single("rate(requests_total[1m]) * 60", 200), 120.0);
+    EXPECT_DOUBLE_EQ(single("2 ^ 3 ^ 2", 0), 512.0);
+    EXPECT_DOUBLE_EQ(single("-2 ^ 2", 0), -4.0);
+    EXPECT_DOUBLE_EQ(single("1 < bool 2", 0), 1.0);
+
+    // Filtering keeps the metric name and value, bool drops the name
+    auto filtered = instant("http_latency > 50", 105);
+    ASSERT_EQ(filtered.series.size(), 1u);
+    EXPECT_EQ(filtered.series[0].name, "http_latency");
+    EXPECT_DOUBLE_EQ(filtered.series[0].values[0], 105.0);
+    auto flags = instant("http_latency > bool 50", 105);
+    ASSERT_EQ(flags.series.size(), 3u);
+    EXPECT_EQ(flags.series[0].name, "");
+    EXPECT_EQ(instant("50 < http_latency", 105).series.size(), 1u);
+
+    // One-to-one matching on all labels but the name, or on() a subset
+    auto ratio = instant("sum by (service) (http_latency) / count by (service) (http_latency)", 105);
+    ASSERT_EQ(ratio.series.size(), 2u);
+    EXPECT_DOUBLE_EQ(ratio.series[0].values[0], 55.0);
+    auto per_host = instant(R"(http_latency{host="b"} / ignoring(host) sum by (service) (http_latency))", 105);
+    ASSERT_EQ(per_host.series.size(), 1u);
+    EXPECT_EQ(per_host.series[0].labels, (label_set{{"service", "api"}}));
+    EXPECT_NEAR(per_host.series[0].values[0], 105.0 / 110.0, 1e-12);
+
+    promql_engine engine(*storage_);
+    // Two api series fall into one match group
+    EXPECT_TRUE(engine.query(R"(http_latency{service="api"} / on(service) sum by (service) (http_latency))",
+                             at(105)).is_err());
+
+    EXPECT_EQ(instant(R"(http_latency and http_latency{host="a"})", 105).series.size(), 2u);
+    EXPECT_EQ(instant(R"(http_latency unless http_latency{host="a"})", 105).series.size(), 1u);
+    EXPECT_EQ(instant(R"(http_latency{host="a"} or cpu_usage)", 105).series.size(), 3u);
+    EXPECT_DOUBLE_EQ(single("clamp_max(cpu_usage, 50)", 105), 50.0);
+    EXPECT_DOUBLE_EQ(single("scalar(cpu_usage) + time() - time()", 105), 105.0);
+}
+
+TEST_F(PromqlEngineTest, RangeQueriesEvaluateAtEachStep) {
+    promql_engine engine(*storage_);
+    const std::string expression = "sum by (service) (rate(http_latency[1m])) + 0 * avg_over_time(cpu_usage[30s])";
+    auto result = engine.query_range("rate(requests_total[1m]) + cpu_usage", at(60), at(127),
+                                     std::chrono::seconds(15));
+    ASSERT_TRUE(result.is_ok()) << result.error().message;
+    ASSERT_EQ(result.value().series.size(), 1u);
+    const auto& series = result.value().series[0];
+    // Steps start at start, not at a multiple of the step, and stop at end
+    ASSERT_EQ(series.size(), 5u);
+    for (size_t i = 0; i < series.size(); ++i) {
+        const int64_t offset = 60 + 15 * static_cast<int64_t>(i);
+        EXPECT_EQ(series.timestamps[i], at(offset));
+        EXPECT_DOUBLE_EQ(series.values[i], single("rate(requests_total[1m]) + cpu_usage", offset));
+    }
+    // (0s, 127s] for the range, (-240s, 127s] within the lookback of the instant selector
+    EXPECT_EQ(result.value().points_scanned, 127u + 128u);
+
+    // Series appear in the steps where they have values
+    auto partial = engine.query_range("cpu_usage > 590", at(580), at(600), std::chrono::seconds(5));
+    ASSERT_TRUE(partial.is_ok());
+    ASSERT_EQ(partial.value().series.size(), 1u);
+    EXPECT_EQ(partial.value().series[0].size(), 2u);
+
+    EXPECT_TRUE(engine.query_range("cpu_usage", at(60), at(0), std::chrono::seconds(1)).is_err());
+    EXPECT_TRUE(engine.query_range("cpu_usage", at(0), at(60), std::chrono::seconds(0)).is_err());
+    EXPECT_TRUE(engine.query_range("cpu_usage", at(0), at(600), std::chrono::milliseconds(1)).is_err());
+    EXPECT_TRUE(engine.query("cpu_usage[1m]", at(60)).is_err());
+    EXPECT_TRUE(engine.query(expression, at(60)).is_ok());
+
+    // Parsed rules can be evaluated repeatedly
+    promql_parser parser;
+    auto rule = parser.parse("max_over_time(cpu_usage[1m])");
+    ASSERT_TRUE(rule.is_ok());
+    auto evaluated = engine.evaluate(rule.value(), at(100), at(100), std::chrono::seconds(1));
+    ASSERT_TRUE(evaluated.is_ok());
+    EXPECT_DOUBLE_EQ(evaluated.value().series[0].values[0], 100.0);
+}
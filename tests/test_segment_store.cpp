@@ -0,0 +1,828 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/storage/segment_store.h>
+#include <kcenon/monitoring/storage/storage_backends.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+class SegmentStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("segment_store_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) +
+                "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    segment_store_config make_config() const {
+        segment_store_config config;
+        config.directory = dir_.string();
+        config.block_records = 4;
+        config.sync_on_flush = false;
+        return config;
+    }
+
+    static metrics_snapshot make_snapshot(int i) {
+        metrics_snapshot snapshot;
+        snapshot.source_id = "host-" + std::to_string(i % 3);
+        snapshot.capture_time = std::chrono::system_clock::time_point(std::chrono::seconds(1700000000 + i));
+        snapshot.add_metric("cpu_usage", i * 0.5, {{"core", std::to_string(i % 4)}});
+        snapshot.add_metric("memory_bytes", 1024.0 * i);
+        snapshot.metrics[0].timestamp = snapshot.capture_time;
+        snapshot.metrics[1].timestamp = snapshot.capture_time - std::chrono::milliseconds(250);
+        return snapshot;
+    }
+
+    // Many metrics sharing names and tags across snapshots, like real scrapes
+    static metrics_snapshot make_dense_snapshot(int i) {
+        metrics_snapshot snapshot;
+        snapshot.source_id = "web-01";
+        snapshot.capture_time = std::chrono::system_clock::time_point(std::chrono::seconds(1700000000 + i * 10));
+        for (int m = 0; m < 20; ++m) {
+            snapshot.add_metric("http_requests_total_" + std::to_string(m), 1000.0 + i,
+                                {{"service", "checkout"}, {"region", "eu-west-1"}});
+            snapshot.metrics.back().timestamp = snapshot.capture_time;
+        }
+        return snapshot;
+    }
+
+    std::vector<std::filesystem::path> segment_files() const {
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+            files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::filesystem::path dir_;
+};
+
+void expect_same(const metrics_snapshot& a, const metrics_snapshot& b) {
+    EXPECT_EQ(a.source_id, b.source_id);
+    EXPECT_EQ(a.capture_time, b.capture_time);
+    ASSERT_EQ(a.metrics.size(), b.metrics.size());
+    for (size_t i = 0; i < a.metrics.size(); ++i) {
+        EXPECT_EQ(a.metrics[i].name, b.metrics[i].name);
+        EXPECT_EQ(a.metrics[i].value, b.metrics[i].value);
+        EXPECT_EQ(a.metrics[i].timestamp, b.metrics[i].timestamp);
+        EXPECT_EQ(a.metrics[i].tags, b.metrics[i].tags);
+    }
+}
+
+} // namespace
+
+TEST_F(SegmentStoreTest, RoundTripAcrossReopen) {
+    {
+        auto store = segment_store::create(make_config());
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+
+        // Unflushed records are readable before they reach disk
+        EXPECT_EQ(store.value()->get_stats().pending_records, 2u);
+        auto last = store.value()->read(9);
+        ASSERT_TRUE(last.is_ok());
+        expect_same(last.value(), make_snapshot(9));
+    }
+
+    auto store = segment_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    ASSERT_EQ(store.value()->size(), 10u);
+
+    auto range = store.value()->read_range(3, 100);
+    ASSERT_TRUE(range.is_ok());
+    ASSERT_EQ(range.value().size(), 7u);
+    for (int i = 0; i < 7; ++i) {
+        expect_same(range.value()[i], make_snapshot(i + 3));
+    }
+    EXPECT_TRUE(store.value()->read(10).is_err());
+
+    // Appends continue after recovered data
+    ASSERT_TRUE(store.value()->append(make_snapshot(10)).is_ok());
+    auto appended = store.value()->read(10);
+    ASSERT_TRUE(appended.is_ok());
+    expect_same(appended.value(), make_snapshot(10));
+}
+
+TEST_F(SegmentStoreTest, TruncatesTornTailOnRecovery) {
+    {
+        auto store = segment_store::create(make_config());
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+
+    auto files = segment_files();
+    ASSERT_EQ(files.size(), 1u);
+    const auto intact_size = std::filesystem::file_size(files[0]);
+
+    // Simulate a crash in the middle of writing a third block
+    {
+        std::ofstream out(files[0], std::ios::binary | std::ios::app);
+        const char partial[] = {'M', 'B', 'L', 'K', 0x40, 0, 0, 0, 2};
+        out.write(partial, sizeof(partial));
+    }
+
+    auto store = segment_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    EXPECT_EQ(store.value()->size(), 8u);
+    EXPECT_EQ(store.value()->get_stats().recovered_bytes, 9u);
+    EXPECT_EQ(std::filesystem::file_size(files[0]), intact_size);
+}
+
+TEST_F(SegmentStoreTest, CorruptBlockDropsItAndEverythingAfter) {
+    {
+        auto store = segment_store::create(make_config());
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 12; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+
+    auto files = segment_files();
+    ASSERT_EQ(files.size(), 1u);
+    const auto size = std::filesystem::file_size(files[0]);
+
+    // Flip a payload byte in the last block
+    {
+        std::fstream io(files[0], std::ios::binary | std::ios::in | std::ios::out);
+        io.seekp(static_cast<std::streamoff>(size - 3));
+        io.put('\x7f');
+    }
+
+    auto store = segment_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    EXPECT_EQ(store.value()->size(), 8u);
+    EXPECT_GT(store.value()->get_stats().recovered_bytes, 0u);
+    expect_same(store.value()->read(7).value(), make_snapshot(7));
+}
+
+TEST_F(SegmentStoreTest, UnreadableSegmentsAreKeptOnOpen) {
+    {
+        auto store = segment_store::create(make_config());
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+
+    auto files = segment_files();
+    ASSERT_EQ(files.size(), 1u);
+    const auto size = std::filesystem::file_size(files[0]);
+    auto patch_byte = [&files](std::streamoff offset, char value) {
+        std::fstream io(files[0], std::ios::binary | std::ios::in | std::ios::out);
+        io.seekp(offset);
+        io.put(value);
+    };
+
+    // A segment from a newer format version fails the open and stays as it is
+    patch_byte(8, static_cast<char>(segment_store::format_version + 1));
+    EXPECT_TRUE(segment_store::create(make_config()).is_err());
+    ASSERT_TRUE(std::filesystem::exists(files[0]));
+    EXPECT_EQ(std::filesystem::file_size(files[0]), size);
+    patch_byte(8, static_cast<char>(segment_store::format_version));
+    ASSERT_EQ(segment_store::create(make_config()).value()->size(), 8u);
+
+    // An unrecognized header is moved aside rather than deleted
+    patch_byte(0, 'X');
+    auto store = segment_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    EXPECT_EQ(store.value()->size(), 0u);
+    EXPECT_EQ(store.value()->get_stats().corrupt_segments, 1u);
+    const auto quarantined = files[0].string() + ".corrupt";
+    ASSERT_TRUE(std::filesystem::exists(quarantined));
+    EXPECT_EQ(std::filesystem::file_size(quarantined), size);
+}
+
+TEST_F(SegmentStoreTest, RotatesSegmentsAndAppliesRetention) {
+    auto config = make_config();
+    config.segment_size_bytes = 4096;
+    config.max_records = 100;
+
+    auto store = segment_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+    for (int i = 0; i < 400; ++i) {
+        ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+    }
+    ASSERT_TRUE(store.value()->flush().is_ok());
+
+    auto stats = store.value()->get_stats();
+    EXPECT_EQ(store.value()->size(), 100u);
+    EXPECT_GT(stats.segments_rotated, 2u);
+    EXPECT_GT(stats.segments_removed, 0u);
+    EXPECT_EQ(segment_files().size(), stats.segments);
+    for (const auto& file : segment_files()) {
+        EXPECT_LE(std::filesystem::file_size(file), config.segment_size_bytes);
+    }
+    expect_same(store.value()->read(0).value(), make_snapshot(300));
+    expect_same(store.value()->read(99).value(), make_snapshot(399));
+
+    store.value().reset();
+    auto reopened = segment_store::create(config);
+    ASSERT_TRUE(reopened.is_ok());
+    EXPECT_EQ(reopened.value()->size(), 100u);
+    expect_same(reopened.value()->read(0).value(), make_snapshot(300));
+
+    ASSERT_TRUE(reopened.value()->clear().is_ok());
+    EXPECT_EQ(reopened.value()->size(), 0u);
+    EXPECT_EQ(segment_files().size(), 1u);
+}
+
+TEST_F(SegmentStoreTest, FileBackendSurvivesRestart) {
+    storage_config config;
+    config.type = storage_backend_type::file_binary;
+    config.path = dir_.string();
+    config.max_capacity = 50;
+    config.batch_size = 10;
+
+    {
+        file_storage_backend backend(config);
+        for (int i = 0; i < 25; ++i) {
+            ASSERT_TRUE(backend.store(make_snapshot(i)).is_ok());
+        }
+        ASSERT_TRUE(backend.flush().is_ok());
+        EXPECT_GT(backend.get_stats()["disk_bytes"], 0u);
+    }
+
+    file_storage_backend restarted(config);
+    EXPECT_EQ(restarted.size(), 25u);
+    auto snapshot = restarted.retrieve(24);
+    ASSERT_TRUE(snapshot.is_ok());
+    expect_same(snapshot.value(), make_snapshot(24));
+}
+
+TEST_F(SegmentStoreTest, ColumnarBlocksRoundTripAcrossReopen) {
+    auto config = make_config();
+    config.block_format = segment_block_format::columnar;
+    {
+        auto store = segment_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+        EXPECT_EQ(store.value()->get_stats().blocks_written, 2u);
+        expect_same(store.value()->read(9).value(), make_snapshot(9));
+        expect_same(store.value()->read(5).value(), make_snapshot(5));
+    }
+
+    // Row-format readers and writers can share the directory
+    auto store = segment_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    ASSERT_EQ(store.value()->size(), 10u);
+    for (int i = 0; i < 10; ++i) {
+        expect_same(store.value()->read(i).value(), make_snapshot(i));
+    }
+    ASSERT_TRUE(store.value()->append(make_snapshot(10)).is_ok());
+    expect_same(store.value()->read(10).value(), make_snapshot(10));
+}
+
+TEST_F(SegmentStoreTest, ColumnarBlocksAreSmallerThanRows) {
+    size_t bytes[2] = {};
+    const segment_block_format formats[2] = {segment_block_format::row, segment_block_format::columnar};
+    for (int f = 0; f < 2; ++f) {
+        auto config = make_config();
+        config.directory = (dir_ / std::to_string(f)).string();
+        config.block_records = 50;
+        config.block_format = formats[f];
+        auto store = segment_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(store.value()->append(make_dense_snapshot(i)).is_ok());
+        }
+        ASSERT_TRUE(store.value()->flush().is_ok());
+        bytes[f] = store.value()->get_stats().disk_bytes;
+        expect_same(store.value()->read(123).value(), make_dense_snapshot(123));
+    }
+    EXPECT_LT(bytes[1] * 5, bytes[0]);
+}
+
+TEST_F(SegmentStoreTest, ScanMetricsReturnsOnlySelectedSeries) {
+    auto config = make_config();
+    config.block_format = segment_block_format::columnar;
+    config.max_records = 7;
+
+    auto store = segment_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+    }
+
+    // Snapshots 3..9 are retained: a partial block, a whole block and the open block
+    std::vector<std::pair<std::chrono::system_clock::time_point, double>> samples;
+    auto scanned = store.value()->scan_metrics({"cpu_usage"},
+        [&samples](const std::string& name, std::chrono::system_clock::time_point timestamp, double value) {
+            EXPECT_EQ(name, "cpu_usage");
+            samples.emplace_back(timestamp, value);
+        });
+    ASSERT_TRUE(scanned.is_ok());
+    ASSERT_EQ(samples.size(), 7u);
+    for (int i = 0; i < 7; ++i) {
+        const auto expected = make_snapshot(i + 3).metrics[0];
+        EXPECT_EQ(samples[i].first, expected.timestamp);
+        EXPECT_EQ(samples[i].second, expected.value);
+    }
+
+    size_t all = 0;
+    ASSERT_TRUE(store.value()->scan_metrics({}, [&all](const std::string&, auto, double) { ++all; }).is_ok());
+    EXPECT_EQ(all, 14u);
+}
+
+TEST(BlockCompressionTest, Lz4RoundTripsAndReadsReferenceBlocks) {
+    std::mt19937 rng(42);
+    std::vector<std::vector<uint8_t>> inputs = {{}, {'a'}, std::vector<uint8_t>(12, 'x'),
+                                                std::vector<uint8_t>(13, 'x'), std::vector<uint8_t>(100000, 0)};
+    std::vector<uint8_t> noise(70000);
+    for (auto& byte : noise) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    inputs.push_back(noise);
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "cpu_usage{core=\"" + std::to_string(i % 8) + "\"} " + std::to_string(i * 0.5) + "\n";
+    }
+    inputs.emplace_back(text.begin(), text.end());
+
+    for (const auto& input : inputs) {
+        std::vector<uint8_t> compressed;
+        detail::lz4_block_codec::compress(input.data(), input.size(), compressed);
+        std::vector<uint8_t> output(input.size());
+        ASSERT_TRUE(detail::lz4_block_codec::decompress(compressed.data(), compressed.size(),
+                                                        output.data(), output.size()));
+        EXPECT_EQ(output, input);
+    }
+
+    std::vector<uint8_t> compressed;
+    detail::lz4_block_codec::compress(reinterpret_cast<const uint8_t*>(text.data()), text.size(), compressed);
+    EXPECT_LT(compressed.size() * 4, text.size());
+
+    // Blocks as produced by the reference LZ4 implementation
+    const uint8_t literals_only[] = {0x50, 'h', 'e', 'l', 'l', 'o'};
+    const uint8_t overlapping_match[] = {0x32, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'a', 'b', 'c', 'a', 'b'};
+    uint8_t out[16] = {};
+    ASSERT_TRUE(detail::lz4_block_codec::decompress(literals_only, sizeof(literals_only), out, 5));
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(out), 5), "hello");
+    ASSERT_TRUE(detail::lz4_block_codec::decompress(overlapping_match, sizeof(overlapping_match), out, 14));
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(out), 14), "abcabcabcabcab");
+
+    // Offsets before the start of the output are rejected
+    const uint8_t bad_offset[] = {0x10, 'a', 0x05, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    EXPECT_FALSE(detail::lz4_block_codec::decompress(bad_offset, sizeof(bad_offset), out, 10));
+}
+
+TEST_F(SegmentStoreTest, CompressedBlocksRoundTripAcrossReopen) {
+    const segment_block_format formats[2] = {segment_block_format::row, segment_block_format::columnar};
+    for (int f = 0; f < 2; ++f) {
+        auto config = make_config();
+        config.directory = (dir_ / std::to_string(f)).string();
+        config.block_records = 50;
+        config.block_format = formats[f];
+        config.compression = compression_algorithm::lz4;
+        {
+            auto store = segment_store::create(config);
+            ASSERT_TRUE(store.is_ok());
+            for (int i = 0; i < 120; ++i) {
+                ASSERT_TRUE(store.value()->append(make_dense_snapshot(i)).is_ok());
+            }
+            ASSERT_TRUE(store.value()->flush().is_ok());
+            const auto stats = store.value()->get_stats();
+            EXPECT_LT(stats.stored_payload_bytes * (f == 0 ? 5 : 2), stats.payload_bytes);
+        }
+
+        auto store = segment_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        ASSERT_EQ(store.value()->size(), 120u);
+        for (int i : {0, 49, 50, 119}) {
+            expect_same(store.value()->read(i).value(), make_dense_snapshot(i));
+        }
+
+        size_t samples = 0;
+        ASSERT_TRUE(store.value()->scan_metrics({"http_requests_total_3"},
+            [&samples](const std::string&, auto, double value) {
+                EXPECT_EQ(value, 1000.0 + samples);
+                ++samples;
+            }).is_ok());
+        EXPECT_EQ(samples, 120u);
+    }
+}
+
+TEST_F(SegmentStoreTest, OptionalCodecsFollowBuildConfiguration) {
+    for (auto codec : {compression_algorithm::gzip, compression_algorithm::zstd}) {
+        auto config = make_config();
+        config.compression = codec;
+        auto store = segment_store::create(config);
+        if (!detail::compression_available(codec)) {
+            EXPECT_TRUE(store.is_err());
+            continue;
+        }
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(store.value()->append(make_dense_snapshot(i)).is_ok());
+        }
+        store.value().reset();
+
+        auto reopened = segment_store::create(config);
+        ASSERT_TRUE(reopened.is_ok());
+        ASSERT_EQ(reopened.value()->size(), 10u);
+        expect_same(reopened.value()->read(7).value(), make_dense_snapshot(7));
+        ASSERT_TRUE(reopened.value()->clear().is_ok());
+    }
+}
+
+TEST_F(SegmentStoreTest, BlocksInUnavailableCodecsAreNeverTruncated) {
+    for (auto codec : {compression_algorithm::gzip, compression_algorithm::zstd}) {
+        auto config = make_config();
+        config.directory = (dir_ / std::to_string(static_cast<int>(codec))).string();
+        config.compression = detail::compression_available(codec) ? codec : compression_algorithm::lz4;
+        {
+            auto store = segment_store::create(config);
+            ASSERT_TRUE(store.is_ok());
+            for (int i = 0; i < 10; ++i) {
+                ASSERT_TRUE(store.value()->append(make_dense_snapshot(i)).is_ok());
+            }
+        }
+
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(config.directory)) {
+            files.push_back(entry.path());
+        }
+        ASSERT_EQ(files.size(), 1u);
+        if (!detail::compression_available(codec)) {
+            // Stand in for a build that has the codec: relabel each compressed
+            // block and reseal its CRC, so the blocks are intact but unreadable
+            std::ifstream in(files[0], std::ios::binary);
+            std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+            auto get_u32 = [&bytes](size_t at) {
+                return static_cast<uint32_t>(bytes[at]) | static_cast<uint32_t>(bytes[at + 1]) << 8 |
+                       static_cast<uint32_t>(bytes[at + 2]) << 16 | static_cast<uint32_t>(bytes[at + 3]) << 24;
+            };
+            size_t relabeled = 0;
+            for (size_t offset = segment_store::segment_header_size; offset < bytes.size();) {
+                const uint32_t length = get_u32(offset + 4);
+                const size_t payload = offset + segment_store::block_header_size;
+                if (get_u32(offset) == segment_store::compressed_block_magic) {
+                    bytes[payload + 4] = static_cast<uint8_t>(codec);
+                    const uint32_t crc = detail::crc32(bytes.data() + payload, length);
+                    for (int b = 0; b < 4; ++b) {
+                        bytes[offset + 12 + b] = static_cast<uint8_t>(crc >> (8 * b));
+                    }
+                    ++relabeled;
+                }
+                offset = payload + length;
+            }
+            ASSERT_GT(relabeled, 0u);
+            std::ofstream(files[0], std::ios::binary | std::ios::trunc)
+                .write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+        const auto size = std::filesystem::file_size(files[0]);
+
+        for (auto reader_codec : {compression_algorithm::none, compression_algorithm::lz4}) {
+            auto reader = config;
+            reader.compression = reader_codec;
+            auto reopened = segment_store::create(reader);
+            if (!detail::compression_available(codec)) {
+                // The open fails instead of truncating the blocks as a torn tail
+                EXPECT_TRUE(reopened.is_err());
+                EXPECT_EQ(std::filesystem::file_size(files[0]), size);
+                continue;
+            }
+            ASSERT_TRUE(reopened.is_ok());
+            ASSERT_EQ(reopened.value()->size(), 10u);
+            EXPECT_EQ(reopened.value()->get_stats().recovered_bytes, 0u);
+            expect_same(reopened.value()->read(9).value(), make_dense_snapshot(9));
+        }
+    }
+}
+
+TEST_F(SegmentStoreTest, CompactionMergesSmallSegments) {
+    for (auto format : {segment_block_format::row, segment_block_format::columnar}) {
+        auto config = make_config();
+        config.segment_size_bytes = 4096;
+        config.block_format = format;
+        config.compression = format == segment_block_format::columnar ? compression_algorithm::lz4
+                                                                      : compression_algorithm::none;
+        {
+            auto store = segment_store::create(config);
+            ASSERT_TRUE(store.is_ok());
+            for (int i = 0; i < 400; ++i) {
+                ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+            }
+        }
+        const size_t before = segment_files().size();
+        ASSERT_GT(before, 4u);
+
+        config.segment_size_bytes = 64 * 1024;
+        config.compaction_merge_bytes = 8192;
+        auto store = segment_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        ASSERT_TRUE(store.value()->compact().is_ok());
+
+        auto stats = store.value()->get_stats();
+        EXPECT_GT(stats.compactions, 0u);
+        EXPECT_EQ(stats.segments_compacted, before - 1);
+        EXPECT_EQ(stats.segments, 2u);
+        EXPECT_EQ(segment_files().size(), stats.segments);
+        ASSERT_EQ(store.value()->size(), 400u);
+        for (int i = 0; i < 400; i += 37) {
+            expect_same(store.value()->read(static_cast<size_t>(i)).value(), make_snapshot(i));
+        }
+
+        // Appends continue in a fresh segment after the merged one
+        ASSERT_TRUE(store.value()->append(make_snapshot(400)).is_ok());
+        store.value().reset();
+        auto reopened = segment_store::create(config);
+        ASSERT_TRUE(reopened.is_ok());
+        ASSERT_EQ(reopened.value()->size(), 401u);
+        expect_same(reopened.value()->read(0).value(), make_snapshot(0));
+        expect_same(reopened.value()->read(399).value(), make_snapshot(399));
+        expect_same(reopened.value()->read(400).value(), make_snapshot(400));
+        ASSERT_TRUE(reopened.value()->clear().is_ok());
+    }
+}
+
+TEST_F(SegmentStoreTest, CompactionRollsUpOldSegments) {
+    auto config = make_config();
+    config.segment_size_bytes = 4096;
+    config.rollup_after = std::chrono::seconds(1);
+    config.rollup_resolution = std::chrono::seconds(60);
+
+    {
+        auto ingest = segment_store::create(config);
+        ASSERT_TRUE(ingest.is_ok());
+        for (int i = 0; i < 300; ++i) {
+            ASSERT_TRUE(ingest.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    // One rewrite takes every closed segment, so each bucket is rolled once
+    config.segment_size_bytes = 256 * 1024;
+    auto store = segment_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+    ASSERT_TRUE(store.value()->compact().is_ok());
+
+    // Everything but the active segment became per-source, per-minute means
+    const auto stats = store.value()->get_stats();
+    const size_t rolled = stats.snapshots_rolled_up;
+    ASSERT_GT(rolled, 0u);
+    ASSERT_LT(rolled, 300u);
+    const size_t rollups = store.value()->size() - (300 - rolled);
+
+    std::map<std::pair<int64_t, std::string>, std::pair<double, int>> expected;
+    for (size_t i = 0; i < rolled; ++i) {
+        const auto snapshot = make_snapshot(static_cast<int>(i));
+        const int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(
+            snapshot.capture_time.time_since_epoch()).count();
+        auto& entry = expected[{seconds - seconds % 60, snapshot.source_id}];
+        entry.first += snapshot.metrics[1].value;
+        ++entry.second;
+    }
+    ASSERT_EQ(rollups, expected.size());
+
+    auto check = [&](segment_store& reader) {
+        auto all = reader.read_range(0, reader.size());
+        ASSERT_TRUE(all.is_ok());
+        ASSERT_EQ(all.value().size(), rollups + 300 - rolled);
+        for (size_t i = 0; i < rollups; ++i) {
+            const auto& rollup = all.value()[i];
+            const int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(
+                rollup.capture_time.time_since_epoch()).count();
+            EXPECT_EQ(seconds % 60, 0);
+            const auto it = expected.find({seconds, rollup.source_id});
+            ASSERT_NE(it, expected.end());
+
+            // One memory series plus one cpu series per core tag seen
+            const auto memory = std::find_if(rollup.metrics.begin(), rollup.metrics.end(),
+                [](const metric_value& metric) { return metric.name == "memory_bytes"; });
+            ASSERT_NE(memory, rollup.metrics.end());
+            EXPECT_DOUBLE_EQ(memory->value, it->second.first / it->second.second);
+            EXPECT_EQ(memory->timestamp, rollup.capture_time);
+            EXPECT_GE(rollup.metrics.size(), 2u);
+        }
+        expect_same(all.value()[rollups], make_snapshot(static_cast<int>(rolled)));
+        expect_same(all.value().back(), make_snapshot(299));
+    };
+    check(*store.value());
+
+    // Rollup segments are marked as such and left alone afterwards
+    store.value().reset();
+    auto reopened = segment_store::create(config);
+    ASSERT_TRUE(reopened.is_ok());
+    check(*reopened.value());
+    ASSERT_TRUE(reopened.value()->compact().is_ok());
+    EXPECT_EQ(reopened.value()->get_stats().snapshots_rolled_up, 0u);
+    check(*reopened.value());
+}
+
+TEST_F(SegmentStoreTest, CompactionAppliesRetentionPeriod) {
+    auto config = make_config();
+    config.segment_size_bytes = 4096;
+    config.retention_period = std::chrono::seconds(1);
+
+    auto now_snapshot = [](int i) {
+        auto snapshot = make_snapshot(i);
+        snapshot.capture_time = std::chrono::system_clock::now();
+        return snapshot;
+    };
+
+    auto store = segment_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(store.value()->append(now_snapshot(i)).is_ok());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    ASSERT_TRUE(store.value()->compact().is_ok());
+
+    // Whole closed segments are deleted without a rewrite
+    auto stats = store.value()->get_stats();
+    EXPECT_GT(stats.segments_expired, 0u);
+    EXPECT_EQ(stats.compactions, 0u);
+    EXPECT_EQ(stats.segments, 1u);
+    EXPECT_LT(store.value()->size(), 200u);
+    EXPECT_EQ(segment_files().size(), 1u);
+    ASSERT_TRUE(store.value()->clear().is_ok());
+
+    // Rewrites drop snapshots captured before the retention period
+    config.retention_period = std::chrono::seconds(3600);
+    {
+        auto ingest = segment_store::create(config);
+        ASSERT_TRUE(ingest.is_ok());
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(ingest.value()->append(i % 2 == 0 ? make_snapshot(i) : now_snapshot(i)).is_ok());
+        }
+    }
+    config.segment_size_bytes = 64 * 1024;
+    config.compaction_merge_bytes = 8192;
+    auto merging = segment_store::create(config);
+    ASSERT_TRUE(merging.is_ok());
+    ASSERT_TRUE(merging.value()->compact().is_ok());
+    stats = merging.value()->get_stats();
+    EXPECT_GT(stats.compactions, 0u);
+    EXPECT_GT(stats.snapshots_expired, 0u);
+    EXPECT_EQ(merging.value()->size(), 200u - stats.snapshots_expired);
+    auto all = merging.value()->read_range(0, merging.value()->size());
+    ASSERT_TRUE(all.is_ok());
+    EXPECT_EQ(all.value().back().metrics[1].value, make_snapshot(199).metrics[1].value);
+}
+
+TEST_F(SegmentStoreTest, InterruptedCompactionIsRecoveredOnOpen) {
+    auto config = make_config();
+    config.segment_size_bytes = 4096;
+    {
+        auto store = segment_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+    const auto originals = segment_files();
+    const auto backup = dir_.string() + "_backup";
+    std::filesystem::remove_all(backup);
+    std::filesystem::copy(dir_, backup);
+
+    config.segment_size_bytes = 64 * 1024;
+    config.compaction_merge_bytes = 8192;
+    {
+        auto store = segment_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        ASSERT_TRUE(store.value()->compact().is_ok());
+        ASSERT_LT(segment_files().size(), originals.size());
+    }
+
+    // A crash after the rename but before the inputs were deleted, with a
+    // stray temporary file from a later rewrite
+    for (const auto& file : originals) {
+        if (!std::filesystem::exists(file)) {
+            std::filesystem::copy_file(std::filesystem::path(backup) / file.filename(), file);
+        }
+    }
+    std::ofstream(originals.back().string() + ".tmp") << "partial";
+    std::filesystem::remove_all(backup);
+
+    auto recovered = segment_store::create(config);
+    ASSERT_TRUE(recovered.is_ok());
+    EXPECT_GT(recovered.value()->get_stats().superseded_segments, 0u);
+    ASSERT_EQ(recovered.value()->size(), 200u);
+    for (int i = 0; i < 200; i += 13) {
+        expect_same(recovered.value()->read(static_cast<size_t>(i)).value(), make_snapshot(i));
+    }
+    for (const auto& file : segment_files()) {
+        EXPECT_EQ(file.extension(), ".seg");
+    }
+}
+
+TEST_F(SegmentStoreTest, BackgroundCompactorStopsPromptlyUnderBudget) {
+    auto config = make_config();
+    config.segment_size_bytes = 64 * 1024;
+    config.compaction_merge_bytes = 8192;
+    config.compaction_interval = std::chrono::milliseconds(10);
+    config.compaction_io_bytes_per_sec = 64 * 1024;
+
+    {
+        auto small = make_config();
+        small.segment_size_bytes = 4096;
+        auto ingest = segment_store::create(small);
+        ASSERT_TRUE(ingest.is_ok());
+        for (int i = 0; i < 400; ++i) {
+            ASSERT_TRUE(ingest.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+
+    // Ingest and reads continue while the compactor rewrites under its budget
+    auto store = segment_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+    for (int i = 400; i < 500; ++i) {
+        ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        expect_same(store.value()->read(static_cast<size_t>(i / 2)).value(), make_snapshot(i / 2));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (store.value()->get_stats().compactions == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GT(store.value()->get_stats().compactions, 0u);
+    ASSERT_EQ(store.value()->size(), 500u);
+    expect_same(store.value()->read(123).value(), make_snapshot(123));
+
+    const auto start = std::chrono::steady_clock::now();
+    store.value().reset();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    auto reopened = segment_store::create(make_config());
+    ASSERT_TRUE(reopened.is_ok());
+    ASSERT_EQ(reopened.value()->size(), 500u);
+    expect_same(reopened.value()->read(399).value(), make_snapshot(399));
+    expect_same(reopened.value()->read(499).value(), make_snapshot(499));
+}
+
+#if defined(__linux__)
+
+TEST_F(SegmentStoreTest, FailedFlushIsRetriedAtTheDurableOffset) {
+    auto* previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit original{};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &original), 0);
+
+    {
+        auto store = segment_store::create(make_config());
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+
+        // The next block is cut short a few bytes past the durable prefix
+        auto files = segment_files();
+        ASSERT_EQ(files.size(), 1u);
+        rlimit limited = original;
+        limited.rlim_cur = static_cast<rlim_t>(std::filesystem::file_size(files[0]) + 16);
+        ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limited), 0);
+
+        for (int i = 4; i < 7; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+        EXPECT_TRUE(store.value()->append(make_snapshot(7)).is_err());
+
+        ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &original), 0);
+        ASSERT_TRUE(store.value()->flush().is_ok());
+        for (int i = 8; i < 12; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+    ::setrlimit(RLIMIT_FSIZE, &original);
+    std::signal(SIGXFSZ, previous_handler);
+
+    auto store = segment_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    ASSERT_EQ(store.value()->size(), 12u);
+    for (int i = 0; i < 12; ++i) {
+        auto snapshot = store.value()->read(static_cast<size_t>(i));
+        ASSERT_TRUE(snapshot.is_ok());
+        expect_same(snapshot.value(), make_snapshot(i));
+    }
+}
+
+#endif // __linux__
@@ -0,0 +1,257 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/exporters/shm_metric_transport.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef MONITORING_HAS_POSIX_SHM
+#include <sys/wait.h>
+#endif
+
+using namespace kcenon::monitoring;
+
+#ifdef MONITORING_HAS_POSIX_SHM
+
+namespace {
+
+std::string unique_segment_name(const std::string& suffix) {
+    return "/kcenon_mon_test_" + std::to_string(::getpid()) + "_" + suffix;
+}
+
+} // namespace
+
+TEST(ShmMetricTransportTest, RecordRoundTripInProcess) {
+    auto writer_result = shm_metric_writer::create(unique_segment_name("roundtrip"));
+    ASSERT_TRUE(writer_result.is_ok());
+    auto& writer = writer_result.value();
+
+    auto reader_result = shm_metric_reader::attach(writer->name());
+    ASSERT_TRUE(reader_result.is_ok());
+    auto& reader = reader_result.value();
+    EXPECT_EQ(reader->layout_version(), shm_layout::version);
+    EXPECT_EQ(reader->capacity(), writer->capacity());
+
+    shm_metric_record record;
+    EXPECT_TRUE(reader->read(record).is_err());
+
+    writer->write("http_requests_total", 12.0, metric_type::counter);
+    writer->write("a_metric_name_that_is_longer_than_thirty_two_bytes", 1.5);
+
+    ASSERT_TRUE(reader->read(record).is_ok());
+    EXPECT_EQ(record.get_name(), "http_requests_total");
+    EXPECT_EQ(record.value, 12.0);
+    EXPECT_EQ(record.type, metric_type::counter);
+    EXPECT_EQ(record.name_hash, hash_metric_name("http_requests_total"));
+
+    ASSERT_TRUE(reader->read(record).is_ok());
+    EXPECT_EQ(record.get_name().size(), shm_metric_record::max_name_length);
+    EXPECT_EQ(record.name_hash,
+              hash_metric_name("a_metric_name_that_is_longer_than_thirty_two_bytes"));
+    EXPECT_EQ(reader->backlog(), 0u);
+}
+
+TEST(ShmMetricTransportTest, LappedReaderSkipsToOldestRecord) {
+    shm_ring_config config;
+    config.capacity = 16;
+    auto writer = shm_metric_writer::create(unique_segment_name("lapped"), config).value();
+    auto reader = shm_metric_reader::attach(writer->name()).value();
+
+    for (int i = 0; i < 40; ++i) {
+        writer->write("queue_depth", static_cast<double>(i));
+    }
+
+    std::vector<shm_metric_record> records;
+    EXPECT_EQ(reader->read_batch(records, 100), 16u);
+    EXPECT_EQ(reader->get_stats().records_dropped, 24u);
+    ASSERT_EQ(records.size(), 16u);
+    EXPECT_EQ(records.front().value, 24.0);
+    EXPECT_EQ(records.back().value, 39.0);
+}
+
+TEST(ShmMetricTransportTest, ConcurrentWritersLappingRingNeverStallReader) {
+    shm_ring_config config;
+    config.capacity = 2;
+    auto writer = shm_metric_writer::create(unique_segment_name("lapping"), config).value();
+    auto reader = shm_metric_reader::attach(writer->name()).value();
+
+    constexpr int writers = 8;
+    constexpr int per_writer = 20000;
+    std::atomic<bool> done{false};
+    bool intact = true;
+    std::thread consumer([&]() {
+        shm_metric_record record;
+        while (!done.load()) {
+            if (reader->read(record).is_ok()) {
+                intact = intact && record.get_name() == "lap_metric" &&
+                         record.name_hash == hash_metric_name("lap_metric");
+            }
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&writer]() {
+            for (int i = 0; i < per_writer; ++i) {
+                writer->write("lap_metric", static_cast<double>(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done = true;
+    consumer.join();
+    EXPECT_TRUE(intact);
+
+    // Every slot sequence moved forward, so the reader reaches the newest record
+    writer->write("sentinel", -1.0);
+    std::vector<shm_metric_record> records;
+    reader->read_batch(records, 1000);
+    ASSERT_FALSE(records.empty());
+    EXPECT_EQ(records.back().get_name(), "sentinel");
+    EXPECT_EQ(reader->backlog(), 0u);
+
+    const auto& stats = reader->get_stats();
+    EXPECT_EQ(stats.records_read + stats.records_dropped, writer->records_written());
+}
+
+TEST(ShmMetricTransportTest, WriterThatDiedMidCopyDoesNotHangOthers) {
+    shm_ring_config config;
+    config.capacity = 4;
+    auto writer = shm_metric_writer::create(unique_segment_name("stalled"), config).value();
+    writer->write("queue_depth", 0.0);
+    writer->write("queue_depth", 1.0);
+
+    // Another process claims sequence 2 and dies before publishing it
+    int fd = ::shm_open(writer->name().c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    const auto size = shm_layout::segment_size(config.capacity);
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    ASSERT_NE(base, MAP_FAILED);
+    auto* hdr = static_cast<shm_layout::segment_header*>(base);
+    const uint64_t stalled = hdr->write_cursor.fetch_add(1);
+    shm_layout::slots(base)[stalled & 3].sequence.store(2 * stalled + 1);
+
+    // Lapping onto the stalled slot skips this record instead of waiting forever
+    for (int i = 3; i < 9; ++i) {
+        writer->write("queue_depth", static_cast<double>(i));
+    }
+    EXPECT_EQ(writer->records_skipped(), 1u);
+    EXPECT_EQ(shm_layout::slots(base)[stalled & 3].sequence.load(), 2 * stalled + 1);
+
+    // Readers give the stalled slot up after the same bound
+    auto reader = shm_metric_reader::attach(writer->name()).value();
+    std::vector<shm_metric_record> records;
+    ASSERT_EQ(reader->read_batch(records, 100), 3u);
+    EXPECT_EQ(records[0].value, 5.0);
+    EXPECT_EQ(records[1].value, 7.0);
+    EXPECT_EQ(records[2].value, 8.0);
+    EXPECT_EQ(reader->get_stats().stalled_records, 1u);
+    EXPECT_EQ(reader->get_stats().records_dropped, 1u);
+    EXPECT_EQ(reader->backlog(), 0u);
+    ::munmap(base, size);
+}
+
+TEST(ShmMetricTransportTest, AttachRejectsForeignSegment) {
+    const auto name = unique_segment_name("foreign");
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::ftruncate(fd, 4096), 0);
+    ::close(fd);
+
+    auto result = shm_metric_reader::attach(name);
+    EXPECT_TRUE(result.is_err());
+    ::shm_unlink(name.c_str());
+
+    EXPECT_TRUE(shm_metric_reader::attach(unique_segment_name("missing")).is_err());
+
+    shm_ring_config bad;
+    bad.capacity = 1000;
+    EXPECT_TRUE(shm_metric_writer::create(unique_segment_name("bad"), bad).is_err());
+}
+
+TEST(ShmMetricTransportTest, WriterAndReaderInSeparateProcesses) {
+    constexpr int total = 5000;
+    shm_ring_config config;
+    config.capacity = 8192;
+    auto writer = shm_metric_writer::create(unique_segment_name("xproc"), config).value();
+
+    int ready[2];
+    ASSERT_EQ(::pipe(ready), 0);
+
+    pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // Agent process: attach, signal readiness, then poll without syscalls
+        ::close(ready[0]);
+        auto attached = shm_metric_reader::attach(writer->name(), shm_read_start::latest);
+        char flag = attached.is_ok() ? 1 : 0;
+        (void)!::write(ready[1], &flag, 1);
+        if (!attached.is_ok()) {
+            ::_exit(2);
+        }
+        auto& reader = attached.value();
+
+        int expected = 0;
+        std::vector<shm_metric_record> records;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        while (expected < total && std::chrono::steady_clock::now() < deadline) {
+            records.clear();
+            reader->read_batch(records, 256);
+            for (const auto& record : records) {
+                if (record.value != static_cast<double>(expected) ||
+                    record.get_name() != "cross_process_metric") {
+                    ::_exit(3);
+                }
+                ++expected;
+            }
+        }
+        ::_exit(expected == total && reader->get_stats().records_dropped == 0 ? 0 : 4);
+    }
+
+    ::close(ready[1]);
+    char flag = 0;
+    ASSERT_EQ(::read(ready[0], &flag, 1), 1);
+    ::close(ready[0]);
+    ASSERT_EQ(flag, 1);
+
+    for (int i = 0; i < total; ++i) {
+        writer->write("cross_process_metric", static_cast<double>(i));
+    }
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_EQ(writer->records_written(), static_cast<uint64_t>(total));
+}
+
+#if defined(__linux__)
+TEST(ShmMetricTransportTest, AnonymousSegmentAttachesByDescriptor) {
+    auto writer = shm_metric_writer::create_anonymous().value();
+    EXPECT_TRUE(writer->name().empty());
+
+    auto reader = shm_metric_reader::attach_fd(writer->fd()).value();
+    writer->write("memfd_metric", 3.0);
+
+    shm_metric_record record;
+    ASSERT_TRUE(reader->read(record).is_ok());
+    EXPECT_EQ(record.get_name(), "memfd_metric");
+    EXPECT_EQ(record.value, 3.0);
+}
+#endif
+
+#else
+
+TEST(ShmMetricTransportTest, UnsupportedPlatformReportsError) {
+    EXPECT_TRUE(shm_metric_writer::create("/unsupported").is_err());
+}
+
+#endif
@@ -0,0 +1,265 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/storage/snapshot_text_log.h>
+#include <kcenon/monitoring/storage/storage_backends.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+class SnapshotTextLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("snapshot_text_log_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) +
+                "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    snapshot_text_log_config make_config(snapshot_text_format format) const {
+        snapshot_text_log_config config;
+        config.path = (dir_ / (format == snapshot_text_format::csv ? "metrics.csv" : "metrics.json")).string();
+        config.format = format;
+        config.batch_records = 4;
+        config.sync_on_flush = false;
+        return config;
+    }
+
+    static metrics_snapshot make_snapshot(int i) {
+        metrics_snapshot snapshot;
+        snapshot.source_id = "host-" + std::to_string(i % 3);
+        snapshot.capture_time = std::chrono::system_clock::time_point(std::chrono::seconds(1700000000 + i));
+        snapshot.add_metric("cpu_usage", i * 0.5, {{"core", std::to_string(i % 4)}});
+        snapshot.add_metric("memory_bytes", 1024.0 * i);
+        snapshot.metrics[0].timestamp = snapshot.capture_time;
+        snapshot.metrics[1].timestamp = snapshot.capture_time - std::chrono::milliseconds(250);
+        return snapshot;
+    }
+
+    // Text that needs quoting or escaping in both formats
+    static metrics_snapshot make_awkward_snapshot() {
+        metrics_snapshot snapshot;
+        snapshot.source_id = "web, \"primary\"";
+        snapshot.capture_time = std::chrono::system_clock::time_point(std::chrono::seconds(1700000500));
+        snapshot.add_metric("latency,p99", 12.25, {{"path", "/a\"b\"\n\tc"}, {"unicode", "\xC3\xA9\x01"}});
+        snapshot.add_metric("idle", std::nan(""));
+        snapshot.add_metric("overflow", -HUGE_VAL);
+        for (auto& metric : snapshot.metrics) {
+            metric.timestamp = snapshot.capture_time;
+        }
+        return snapshot;
+    }
+
+    static void expect_same(const metrics_snapshot& expected, const metrics_snapshot& actual) {
+        EXPECT_EQ(actual.source_id, expected.source_id);
+        EXPECT_EQ(actual.capture_time, expected.capture_time);
+        ASSERT_EQ(actual.metrics.size(), expected.metrics.size());
+        for (size_t i = 0; i < expected.metrics.size(); ++i) {
+            EXPECT_EQ(actual.metrics[i].name, expected.metrics[i].name);
+            if (std::isnan(expected.metrics[i].value)) {
+                EXPECT_TRUE(std::isnan(actual.metrics[i].value));
+            } else {
+                EXPECT_EQ(actual.metrics[i].value, expected.metrics[i].value);
+            }
+            EXPECT_EQ(actual.metrics[i].timestamp, expected.metrics[i].timestamp);
+            EXPECT_EQ(actual.metrics[i].tags, expected.metrics[i].tags);
+        }
+    }
+
+    static std::string read_file(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path dir_;
+};
+
+} // namespace
+
+TEST_F(SnapshotTextLogTest, RoundTripAcrossReopen) {
+    for (auto format : {snapshot_text_format::json_lines, snapshot_text_format::csv}) {
+        SCOPED_TRACE(format == snapshot_text_format::csv ? "csv" : "json_lines");
+        const auto config = make_config(format);
+
+        metrics_snapshot empty;
+        empty.source_id = "idle-host";
+        empty.capture_time = std::chrono::system_clock::time_point(std::chrono::seconds(1700000999));
+        {
+            auto log = snapshot_text_log::create(config);
+            ASSERT_TRUE(log.is_ok());
+            for (int i = 0; i < 6; ++i) {
+                ASSERT_TRUE(log.value()->append(make_snapshot(i)).is_ok());
+            }
+            ASSERT_TRUE(log.value()->append(make_awkward_snapshot()).is_ok());
+            ASSERT_TRUE(log.value()->append(empty).is_ok());
+            ASSERT_TRUE(log.value()->flush().is_ok());
+        }
+
+        auto reopened = snapshot_text_log::create(config);
+        ASSERT_TRUE(reopened.is_ok());
+        ASSERT_EQ(reopened.value()->size(), 8u);
+        for (int i = 0; i < 6; ++i) {
+            expect_same(make_snapshot(i), reopened.value()->read(static_cast<size_t>(i)).value());
+        }
+        expect_same(make_awkward_snapshot(), reopened.value()->read(6).value());
+        expect_same(empty, reopened.value()->read(7).value());
+        std::filesystem::remove(config.path);
+    }
+}
+
+TEST_F(SnapshotTextLogTest, WritesJsonLinesAndCsvText) {
+    auto json_config = make_config(snapshot_text_format::json_lines);
+    auto csv_config = make_config(snapshot_text_format::csv);
+    {
+        auto json = snapshot_text_log::create(json_config);
+        auto csv = snapshot_text_log::create(csv_config);
+        ASSERT_TRUE(json.is_ok());
+        ASSERT_TRUE(csv.is_ok());
+        for (int i = 0; i < 3; ++i) {
+            ASSERT_TRUE(json.value()->append(make_snapshot(i)).is_ok());
+            ASSERT_TRUE(csv.value()->append(make_snapshot(i)).is_ok());
+        }
+    }
+
+    const auto json_text = read_file(json_config.path);
+    EXPECT_EQ(std::count(json_text.begin(), json_text.end(), '\n'), 3);
+    EXPECT_EQ(json_text.rfind("{\"capture_time_ns\":1700000000000000000,\"source_id\":\"host-0\","
+                              "\"metrics\":[{\"name\":\"cpu_usage\",\"value\":0,", 0), 0u);
+
+    const auto csv_text = read_file(csv_config.path);
+    EXPECT_EQ(csv_text.rfind("snapshot,capture_time_ns,source_id,name,value,timestamp_ns,tags\n"
+                             "0,1700000000000000000,host-0,cpu_usage,0,1700000000000000000,\"{\"\"core\"\":\"\"0\"\"}\"\n"
+                             "0,1700000000000000000,host-0,memory_bytes,0,1699999999750000000,{}\n"
+                             "1,", 0), 0u);
+    EXPECT_EQ(std::count(csv_text.begin(), csv_text.end(), '\n'), 7);
+}
+
+TEST_F(SnapshotTextLogTest, TruncatesTornTailOnOpen) {
+    for (auto format : {snapshot_text_format::json_lines, snapshot_text_format::csv}) {
+        SCOPED_TRACE(format == snapshot_text_format::csv ? "csv" : "json_lines");
+        const auto config = make_config(format);
+        {
+            auto log = snapshot_text_log::create(config);
+            ASSERT_TRUE(log.is_ok());
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_TRUE(log.value()->append(make_snapshot(i)).is_ok());
+            }
+        }
+        const auto intact = std::filesystem::file_size(config.path);
+        {
+            std::ofstream out(config.path, std::ios::binary | std::ios::app);
+            out << (format == snapshot_text_format::csv ? "3,1700000003000000000,host-0,cpu" : "{\"capture_time_ns\":17");
+        }
+
+        auto reopened = snapshot_text_log::create(config);
+        ASSERT_TRUE(reopened.is_ok());
+        EXPECT_EQ(reopened.value()->size(), 3u);
+        EXPECT_GT(reopened.value()->get_stats().recovered_bytes, 0u);
+        EXPECT_EQ(std::filesystem::file_size(config.path), intact);
+
+        ASSERT_TRUE(reopened.value()->append(make_snapshot(3)).is_ok());
+        ASSERT_TRUE(reopened.value()->flush().is_ok());
+        reopened.value().reset();
+
+        auto again = snapshot_text_log::create(config);
+        ASSERT_TRUE(again.is_ok());
+        ASSERT_EQ(again.value()->size(), 4u);
+        expect_same(make_snapshot(3), again.value()->read(3).value());
+        std::filesystem::remove(config.path);
+    }
+}
+
+TEST_F(SnapshotTextLogTest, MalformedRecordFailsOpenAndKeepsFile) {
+    const auto config = make_config(snapshot_text_format::json_lines);
+    {
+        std::ofstream out(config.path, std::ios::binary);
+        out << "{\"capture_time_ns\":1,\"source_id\":\"a\",\"metrics\":[]}\n";
+        out << "not json\n";
+    }
+    const auto size = std::filesystem::file_size(config.path);
+
+    auto log = snapshot_text_log::create(config);
+    ASSERT_TRUE(log.is_err());
+    EXPECT_EQ(std::filesystem::file_size(config.path), size);
+
+    const auto csv_config = make_config(snapshot_text_format::csv);
+    {
+        std::ofstream out(csv_config.path, std::ios::binary);
+        out << "time,value\n1,2\n";
+    }
+    EXPECT_TRUE(snapshot_text_log::create(csv_config).is_err());
+}
+
+TEST_F(SnapshotTextLogTest, RetentionRewritesTheFile) {
+    for (auto format : {snapshot_text_format::json_lines, snapshot_text_format::csv}) {
+        SCOPED_TRACE(format == snapshot_text_format::csv ? "csv" : "json_lines");
+        auto config = make_config(format);
+        config.max_records = 4;
+        config.batch_records = 1;
+        {
+            auto log = snapshot_text_log::create(config);
+            ASSERT_TRUE(log.is_ok());
+            for (int i = 0; i < 20; ++i) {
+                ASSERT_TRUE(log.value()->append(make_snapshot(i)).is_ok());
+            }
+            EXPECT_EQ(log.value()->size(), 4u);
+            EXPECT_GT(log.value()->get_stats().rewrites, 0u);
+            expect_same(make_snapshot(16), log.value()->read(0).value());
+        }
+
+        const auto text = read_file(config.path);
+        const auto rows_per_snapshot = format == snapshot_text_format::csv ? 2 : 1;
+        EXPECT_LE(std::count(text.begin(), text.end(), '\n'), 8 * rows_per_snapshot + 1);
+
+        auto reopened = snapshot_text_log::create(config);
+        ASSERT_TRUE(reopened.is_ok());
+        ASSERT_EQ(reopened.value()->size(), 4u);
+        for (int i = 0; i < 4; ++i) {
+            expect_same(make_snapshot(16 + i), reopened.value()->read(static_cast<size_t>(i)).value());
+        }
+
+        ASSERT_TRUE(reopened.value()->clear().is_ok());
+        EXPECT_EQ(reopened.value()->size(), 0u);
+        reopened.value().reset();
+        EXPECT_EQ(snapshot_text_log::create(config).value()->size(), 0u);
+        std::filesystem::remove(config.path);
+    }
+}
+
+TEST_F(SnapshotTextLogTest, FileBackendWritesTextFilesAtPath) {
+    for (auto type : {storage_backend_type::file_json, storage_backend_type::file_csv}) {
+        storage_config config;
+        config.type = type;
+        config.path = (dir_ / (type == storage_backend_type::file_csv ? "metrics.csv" : "metrics.json")).string();
+        config.max_capacity = 10;
+        config.batch_size = 10;
+        {
+            file_storage_backend backend(config);
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_TRUE(backend.store(make_snapshot(i)).is_ok());
+            }
+            EXPECT_EQ(backend.get_stats()["pending_snapshots"], 3u);
+            ASSERT_TRUE(backend.flush().is_ok());
+        }
+        EXPECT_TRUE(std::filesystem::is_regular_file(config.path));
+
+        file_storage_backend restarted(config);
+        ASSERT_EQ(restarted.size(), 3u);
+        expect_same(make_snapshot(2), restarted.retrieve(2).value());
+    }
+}
@@ -0,0 +1,225 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/storage/storage_backends.h>
+
+#ifdef MONITORING_HAS_SQLITE
+
+#include <kcenon/monitoring/storage/sqlite_store.h>
+#include <filesystem>
+#include <string>
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+const auto base_time = std::chrono::system_clock::time_point(std::chrono::seconds(1700000000));
+
+class SqliteStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("sqlite_store_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) +
+                "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    sqlite_store_config make_config() const {
+        sqlite_store_config config;
+        config.path = (dir_ / "history.db").string();
+        config.batch_records = 16;
+        config.commit_interval = std::chrono::milliseconds(20);
+        return config;
+    }
+
+    static metrics_snapshot make_snapshot(int i) {
+        metrics_snapshot snapshot;
+        snapshot.source_id = "edge-" + std::to_string(i % 3);
+        snapshot.capture_time = base_time + std::chrono::seconds(i);
+        snapshot.add_metric("cpu_usage", i * 0.5, {{"core", std::to_string(i % 4)}, {"note", "a \"quoted\"\n\\value"}});
+        snapshot.add_metric("memory_bytes", 1024.0 * i);
+        snapshot.metrics[0].timestamp = snapshot.capture_time;
+        snapshot.metrics[1].timestamp = snapshot.capture_time - std::chrono::milliseconds(250);
+        return snapshot;
+    }
+
+    std::filesystem::path dir_;
+};
+
+void expect_same(const metrics_snapshot& a, const metrics_snapshot& b) {
+    EXPECT_EQ(a.source_id, b.source_id);
+    EXPECT_EQ(a.capture_time, b.capture_time);
+    ASSERT_EQ(a.metrics.size(), b.metrics.size());
+    for (size_t i = 0; i < a.metrics.size(); ++i) {
+        EXPECT_EQ(a.metrics[i].name, b.metrics[i].name);
+        EXPECT_EQ(a.metrics[i].value, b.metrics[i].value);
+        EXPECT_EQ(a.metrics[i].timestamp, b.metrics[i].timestamp);
+        EXPECT_EQ(a.metrics[i].tags, b.metrics[i].tags);
+    }
+}
+
+} // namespace
+
+TEST_F(SqliteStoreTest, RoundTripAcrossReopenInBatches) {
+    {
+        auto store = sqlite_store::create(make_config());
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 250; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+        ASSERT_TRUE(store.value()->flush().is_ok());
+
+        const auto stats = store.value()->get_stats();
+        EXPECT_EQ(stats.snapshots_written, 250u);
+        EXPECT_EQ(stats.value_rows_written, 500u);
+        EXPECT_LT(stats.transactions, 250u / 4);
+        EXPECT_EQ(stats.pending_records, 0u);
+    }
+
+    auto store = sqlite_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+    ASSERT_EQ(store.value()->size(), 250u);
+    auto all = store.value()->read_range(0, 1000);
+    ASSERT_TRUE(all.is_ok());
+    ASSERT_EQ(all.value().size(), 250u);
+    for (int i = 0; i < 250; ++i) {
+        expect_same(all.value()[i], make_snapshot(i));
+    }
+
+    // New snapshots continue after the recovered ones
+    ASSERT_TRUE(store.value()->append(make_snapshot(250)).is_ok());
+    expect_same(store.value()->read(250).value(), make_snapshot(250));
+    EXPECT_TRUE(store.value()->read(251).is_err());
+}
+
+TEST_F(SqliteStoreTest, QueuedSnapshotsAreReadableBeforeCommit) {
+    auto config = make_config();
+    config.batch_records = 1000;
+    config.commit_interval = std::chrono::hours(1);
+    auto store = sqlite_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+    }
+    EXPECT_EQ(store.value()->get_stats().pending_records, 10u);
+    EXPECT_EQ(store.value()->get_stats().transactions, 0u);
+    expect_same(store.value()->read(3).value(), make_snapshot(3));
+
+    ASSERT_TRUE(store.value()->flush().is_ok());
+    EXPECT_EQ(store.value()->get_stats().pending_records, 0u);
+    EXPECT_EQ(store.value()->get_stats().transactions, 1u);
+
+    // Reads straddling committed and queued snapshots
+    for (int i = 10; i < 15; ++i) {
+        ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+    }
+    auto range = store.value()->read_range(8, 4);
+    ASSERT_TRUE(range.is_ok());
+    ASSERT_EQ(range.value().size(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        expect_same(range.value()[i], make_snapshot(8 + i));
+    }
+}
+
+TEST_F(SqliteStoreTest, RetentionAndTimeIndexedReads) {
+    auto config = make_config();
+    config.max_records = 50;
+    {
+        auto store = sqlite_store::create(config);
+        ASSERT_TRUE(store.is_ok());
+        for (int i = 0; i < 120; ++i) {
+            ASSERT_TRUE(store.value()->append(make_snapshot(i)).is_ok());
+        }
+        ASSERT_TRUE(store.value()->flush().is_ok());
+        EXPECT_EQ(store.value()->size(), 50u);
+        expect_same(store.value()->read(0).value(), make_snapshot(70));
+
+        auto window = store.value()->read_time_range(base_time + std::chrono::seconds(80),
+                                                     base_time + std::chrono::seconds(90));
+        ASSERT_TRUE(window.is_ok());
+        ASSERT_EQ(window.value().size(), 10u);
+        expect_same(window.value().front(), make_snapshot(80));
+
+        // Expired snapshots are not returned even if the range covers them
+        auto expired = store.value()->read_time_range(base_time, base_time + std::chrono::seconds(75));
+        ASSERT_TRUE(expired.is_ok());
+        EXPECT_EQ(expired.value().size(), 5u);
+
+        auto cpu = store.value()->read_metric("cpu_usage", base_time + std::chrono::seconds(100),
+                                              base_time + std::chrono::seconds(200));
+        ASSERT_TRUE(cpu.is_ok());
+        ASSERT_EQ(cpu.value().size(), 20u);
+        EXPECT_EQ(cpu.value().front().second, 50.0);
+        EXPECT_EQ(cpu.value().back().first, base_time + std::chrono::seconds(119));
+    }
+
+    auto store = sqlite_store::create(config);
+    ASSERT_TRUE(store.is_ok());
+    EXPECT_EQ(store.value()->size(), 50u);
+    expect_same(store.value()->read(49).value(), make_snapshot(119));
+
+    ASSERT_TRUE(store.value()->clear().is_ok());
+    EXPECT_EQ(store.value()->size(), 0u);
+    EXPECT_TRUE(store.value()->read_time_range(base_time, base_time + std::chrono::hours(1)).value().empty());
+}
+
+TEST_F(SqliteStoreTest, UsesWalJournalMode) {
+    auto store = sqlite_store::create(make_config());
+    ASSERT_TRUE(store.is_ok());
+
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open((dir_ / "history.db").string().c_str(), &db), SQLITE_OK);
+    sqlite3_stmt* stmt = nullptr;
+    ASSERT_EQ(sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1, &stmt, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_STREQ(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), "wal");
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
+
+TEST_F(SqliteStoreTest, RejectsInvalidConfiguration) {
+    auto config = make_config();
+    config.table_prefix = "metrics; DROP TABLE x";
+    EXPECT_TRUE(sqlite_store::create(config).is_err());
+
+    config = make_config();
+    config.path = (dir_ / "missing" / "history.db").string();
+    EXPECT_TRUE(sqlite_store::create(config).is_err());
+}
+
+TEST_F(SqliteStoreTest, DatabaseBackendPersistsAcrossRestart) {
+    storage_config config;
+    config.type = storage_backend_type::database_sqlite;
+    config.path = (dir_ / "backend.db").string();
+    config.table_name = "edge";
+    config.max_capacity = 100;
+    config.batch_size = 10;
+    {
+        database_storage_backend backend(config);
+        for (int i = 0; i < 30; ++i) {
+            ASSERT_TRUE(backend.store(make_snapshot(i)).is_ok());
+        }
+        ASSERT_TRUE(backend.flush().is_ok());
+        EXPECT_EQ(backend.get_stats()["pending_snapshots"], 0u);
+    }
+
+    database_storage_backend backend(config);
+    EXPECT_EQ(backend.size(), 30u);
+    expect_same(backend.retrieve(29).value(), make_snapshot(29));
+    auto window = backend.retrieve_time_range(base_time + std::chrono::seconds(10),
+                                              base_time + std::chrono::seconds(12));
+    ASSERT_TRUE(window.is_ok());
+    ASSERT_EQ(window.value().size(), 2u);
+    expect_same(window.value()[1], make_snapshot(11));
+}
+
+#endif // MONITORING_HAS_SQLITE
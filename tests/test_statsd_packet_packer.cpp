@@ -0,0 +1,302 @@
+// BSD 3-Clause License
+// Copyright (c) 2025, 🍀☀🌕🌥 🌊
+// See the LICENSE file in the project root for full license information.
+
+
+#include <gtest/gtest.h>
+#include <kcenon/monitoring/exporters/metric_exporters.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace kcenon::monitoring;
+
+namespace {
+
+statsd_metric_data make_counter(const std::string& name, double value) {
+    statsd_metric_data metric;
+    metric.name = name;
+    metric.type = metric_type::counter;
+    metric.value = value;
+    return metric;
+}
+
+std::string as_string(std::span<const uint8_t> packet) {
+    return std::string(reinterpret_cast<const char*>(packet.data()), packet.size());
+}
+
+/// Transport that records every datagram it is given
+class recording_udp_transport : public stub_udp_transport {
+public:
+    using udp_transport::send;
+
+    kcenon::common::VoidResult send(std::span<const uint8_t> data) override {
+        datagrams.push_back(as_string(data));
+        return stub_udp_transport::send(data);
+    }
+
+    kcenon::common::VoidResult send_batch(std::span<const std::span<const uint8_t>> batch) override {
+        ++batch_calls;
+        return udp_transport::send_batch(batch);
+    }
+
+    std::vector<std::string> datagrams;
+    std::size_t batch_calls{0};
+};
+
+} // namespace
+
+TEST(StatsdPacketPackerTest, PacksLinesUpToPayloadLimit) {
+    // Each "m_N:1|c" line is 7 bytes; two lines plus a separator is 15
+    statsd_packet_packer packer(15);
+    for (int i = 0; i < 5; ++i) {
+        packer.add(make_counter("m_" + std::to_string(i), 1), false);
+    }
+
+    auto packets = packer.finish();
+    ASSERT_EQ(packets.size(), 3u);
+    EXPECT_EQ(as_string(packets[0]), "m_0:1|c\nm_1:1|c");
+    EXPECT_EQ(as_string(packets[1]), "m_2:1|c\nm_3:1|c");
+    EXPECT_EQ(as_string(packets[2]), "m_4:1|c");
+    EXPECT_EQ(packer.oversized_lines(), 0u);
+}
+
+TEST(StatsdPacketPackerTest, OversizedLineGetsOwnPacket) {
+    statsd_packet_packer packer(16);
+    packer.add(make_counter("a", 1), false);
+    packer.add(make_counter("a_very_long_metric_name", 1), false);
+    packer.add(make_counter("b", 2), false);
+
+    auto packets = packer.finish();
+    ASSERT_EQ(packets.size(), 3u);
+    EXPECT_EQ(as_string(packets[0]), "a:1|c");
+    EXPECT_EQ(as_string(packets[1]), "a_very_long_metric_name:1|c");
+    EXPECT_EQ(as_string(packets[2]), "b:2|c");
+    EXPECT_EQ(packer.oversized_lines(), 1u);
+}
+
+TEST(StatsdPacketPackerTest, ResetReusesBuffer) {
+    statsd_packet_packer packer(1432);
+    packer.add(make_counter("first", 1), false);
+    EXPECT_EQ(packer.finish().size(), 1u);
+
+    packer.reset();
+    EXPECT_EQ(packer.packet_count(), 0u);
+    EXPECT_TRUE(packer.finish().empty());
+
+    packer.add(make_counter("second", 2), false);
+    auto packets = packer.finish();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(as_string(packets[0]), "second:2|c");
+}
+
+TEST(StatsdPacketPackerTest, AppendMatchesStreamFormatting) {
+    statsd_metric_data metric;
+    metric.name = "latency";
+    metric.type = metric_type::timer;
+    metric.value = 0.123456789;
+    metric.sample_rate = 0.25;
+
+    std::ostringstream expected;
+    expected << "latency:" << metric.value << "|ms|@" << metric.sample_rate;
+    EXPECT_EQ(metric.to_statsd_format(), expected.str());
+}
+
+TEST(StatsdPacketPackerTest, ExporterSplitsLargeExportIntoOneBatch) {
+    metric_export_config config;
+    config.endpoint = "127.0.0.1";
+    config.port = 8125;
+    config.format = metric_export_format::statsd_plain;
+    config.max_packet_size = 64;
+
+    auto transport = std::make_unique<recording_udp_transport>();
+    auto* recorder = transport.get();
+    statsd_exporter exporter(config, std::move(transport));
+
+    metrics_snapshot snapshot;
+    for (int i = 0; i < 40; ++i) {
+        snapshot.add_metric("series_" + std::to_string(i), i);
+    }
+    ASSERT_TRUE(exporter.export_snapshot(snapshot).is_ok());
+
+    EXPECT_EQ(recorder->batch_calls, 1u);
+    ASSERT_GT(recorder->datagrams.size(), 1u);
+
+    std::size_t lines = 0;
+    for (const auto& datagram : recorder->datagrams) {
+        EXPECT_LE(datagram.size(), config.max_packet_size);
+        EXPECT_NE(datagram.front(), '\n');
+        EXPECT_NE(datagram.back(), '\n');
+        lines += static_cast<std::size_t>(std::count(datagram.begin(), datagram.end(), '\n')) + 1;
+    }
+    EXPECT_EQ(lines, 40u);
+
+    auto stats = exporter.get_stats();
+    EXPECT_EQ(stats["sent_packets"], recorder->datagrams.size());
+    EXPECT_EQ(stats["last_export_packets"], recorder->datagrams.size());
+    EXPECT_EQ(stats["oversized_lines"], 0u);
+}
+
+TEST(StatsdPacketPackerTest, SnapshotLinesMatchConvertSnapshot) {
+    metric_export_config config;
+    config.endpoint = "127.0.0.1";
+    config.port = 8125;
+    config.format = metric_export_format::statsd_datadog;
+    config.instance_id = "node-7";
+    config.labels["env"] = "prod";
+
+    auto transport = std::make_unique<recording_udp_transport>();
+    auto* recorder = transport.get();
+    statsd_exporter exporter(config, std::move(transport));
+
+    metrics_snapshot snapshot;
+    snapshot.source_id = "web";
+    snapshot.add_metric("http.request  duration", 0.125, {{"route", "/api"}});
+    snapshot.add_metric("Jobs.Total", 9, {{"env", "staging"}});
+    snapshot.add_metric("queue_depth", 3);
+    ASSERT_TRUE(exporter.export_snapshot(snapshot).is_ok());
+    ASSERT_EQ(recorder->datagrams.size(), 1u);
+
+    // Tag order is unspecified in the owning conversion, so compare the
+    // metric part and the tag sets separately
+    auto split = [](const std::string& line) {
+        const auto tags_at = line.find("|#");
+        std::vector<std::string> tags;
+        if (tags_at != std::string::npos) {
+            std::stringstream stream(line.substr(tags_at + 2));
+            for (std::string tag; std::getline(stream, tag, ',');) {
+                tags.push_back(tag);
+            }
+            std::sort(tags.begin(), tags.end());
+        }
+        return std::make_pair(line.substr(0, tags_at), tags);
+    };
+
+    std::vector<std::string> lines;
+    std::stringstream stream(recorder->datagrams[0]);
+    for (std::string line; std::getline(stream, line);) {
+        lines.push_back(line);
+    }
+    const auto expected = exporter.convert_snapshot(snapshot);
+    ASSERT_EQ(lines.size(), expected.size());
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        EXPECT_EQ(split(lines[i]), split(expected[i].to_statsd_format(true))) << lines[i];
+    }
+    EXPECT_EQ(split(lines[0]).first, "http_request_duration:0.125|ms");
+    EXPECT_NE(lines[1].find("env:staging"), std::string::npos);
+    EXPECT_EQ(lines[1].find("env:prod"), std::string::npos);
+}
+
+TEST(StatsdPacketPackerTest, DataLinesMatchConvertMonitoringData) {
+    metric_export_config config;
+    config.endpoint = "127.0.0.1";
+    config.port = 8125;
+    config.format = metric_export_format::statsd_datadog;
+    config.instance_id = "node-7";
+    config.labels["env"] = "prod";
+
+    auto transport = std::make_unique<recording_udp_transport>();
+    auto* recorder = transport.get();
+    statsd_exporter exporter(config, std::move(transport));
+
+    monitoring_data data("checkout");
+    data.add_metric("request.latency", 0.5);
+    data.add_metric("orders_total", 12);
+    data.add_tag("env", "canary");
+    ASSERT_TRUE(exporter.export_metrics({data}).is_ok());
+    ASSERT_EQ(recorder->datagrams.size(), 1u);
+
+    auto sorted_line = [](std::string line) {
+        const auto tags_at = line.find("|#");
+        std::vector<std::string> tags;
+        std::stringstream stream(line.substr(tags_at + 2));
+        for (std::string tag; std::getline(stream, tag, ',');) {
+            tags.push_back(tag);
+        }
+        std::sort(tags.begin(), tags.end());
+        return std::make_pair(line.substr(0, tags_at), tags);
+    };
+
+    std::vector<std::pair<std::string, std::vector<std::string>>> lines;
+    std::stringstream stream(recorder->datagrams[0]);
+    for (std::string line; std::getline(stream, line);) {
+        lines.push_back(sorted_line(line));
+    }
+    std::vector<std::pair<std::string, std::vector<std::string>>> expected;
+    for (const auto& metric : exporter.convert_monitoring_data(data)) {
+        expected.push_back(sorted_line(metric.to_statsd_format(true)));
+    }
+    std::sort(lines.begin(), lines.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(lines, expected);
+    EXPECT_NE(recorder->datagrams[0].find("env:canary"), std::string::npos);
+    EXPECT_EQ(recorder->datagrams[0].find("env:prod"), std::string::npos);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(StatsdPacketPackerTest, DefaultTransportSendsNativeBatches) {
+    EXPECT_EQ(create_default_udp_transport()->name(), "socket");
+}
+#endif
+
+#if defined(__linux__)
+
+TEST(SocketUdpTransportTest, SendBatchDeliversEachDatagram) {
+    const int receiver = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(receiver, 0);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ASSERT_EQ(::bind(receiver, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(::getsockname(receiver, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+
+    timeval tv{2, 0};
+    ::setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    socket_udp_transport transport;
+    ASSERT_TRUE(transport.connect("127.0.0.1", ntohs(addr.sin_port)).is_ok());
+
+    // More than one sendmmsg() call's worth of datagrams
+    const std::size_t count = socket_udp_transport::max_batch + 6;
+    std::vector<std::string> payloads;
+    std::vector<std::span<const uint8_t>> datagrams;
+    for (std::size_t i = 0; i < count; ++i) {
+        payloads.push_back("m_" + std::to_string(i) + ":1|c");
+    }
+    for (const auto& payload : payloads) {
+        datagrams.emplace_back(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+    }
+
+    ASSERT_TRUE(transport.send_batch(datagrams).is_ok());
+
+    for (std::size_t i = 0; i < count; ++i) {
+        char buffer[128];
+        const ssize_t n = ::recv(receiver, buffer, sizeof(buffer), 0);
+        ASSERT_GT(n, 0);
+        EXPECT_EQ(std::string(buffer, static_cast<std::size_t>(n)), payloads[i]);
+    }
+
+    auto stats = transport.get_statistics();
+    EXPECT_EQ(stats.packets_sent, count);
+    EXPECT_EQ(stats.send_failures, 0u);
+
+    transport.disconnect();
+    EXPECT_FALSE(transport.is_connected());
+    EXPECT_TRUE(transport.send_batch(datagrams).is_err());
+    ::close(receiver);
+}
+
+#endif // __linux__